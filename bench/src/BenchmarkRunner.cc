@@ -0,0 +1,212 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "BenchmarkRunner.h"
+
+#include <algorithm>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+using namespace degate;
+
+/**
+ * Escape a string for JSON.
+ */
+static std::string json_escape(std::string const& str)
+{
+	std::ostringstream os;
+	for (char c : str)
+	{
+		switch (c)
+		{
+		case '"': os << "\\\""; break;
+		case '\\': os << "\\\\"; break;
+		case '\n': os << "\\n"; break;
+		case '\t': os << "\\t"; break;
+		default:
+			if (static_cast<unsigned char>(c) < 0x20)
+				os << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+			else
+				os << c;
+		}
+	}
+	return os.str();
+}
+
+BenchmarkRunner::BenchmarkRunner(unsigned int runs, std::string const& filter) :
+	runs(std::max(runs, 1u)),
+	filter(filter)
+{
+}
+
+bool BenchmarkRunner::is_selected(std::string const& name) const
+{
+	return filter.empty() || name.find(filter) != std::string::npos;
+}
+
+bool BenchmarkRunner::run(std::string const& name, benchmark_function const& benchmark,
+                          setup_function const& setup)
+{
+	if (!is_selected(name))
+		return true;
+
+	result res;
+	res.name = name;
+	res.items = 0;
+	res.runs = 0;
+	res.min_seconds = res.median_seconds = res.max_seconds = 0;
+	res.failed = false;
+
+	std::vector<double> timings;
+
+	std::cerr << "Running " << name << " " << std::flush;
+
+	try
+	{
+		for (unsigned int i = 0; i < runs; i++)
+		{
+			if (setup)
+				setup();
+
+			auto start = std::chrono::steady_clock::now();
+			res.items = benchmark();
+			auto stop = std::chrono::steady_clock::now();
+
+			timings.push_back(std::chrono::duration<double>(stop - start).count());
+			std::cerr << "." << std::flush;
+		}
+	}
+	catch (std::exception const& e)
+	{
+		res.failed = true;
+		res.error = e.what();
+	}
+
+	if (!timings.empty())
+	{
+		std::sort(timings.begin(), timings.end());
+		res.runs = timings.size();
+		res.min_seconds = timings.front();
+		res.median_seconds = timings[timings.size() / 2];
+		res.max_seconds = timings.back();
+	}
+
+	if (res.failed)
+		std::cerr << " failed: " << res.error << std::endl;
+	else
+		std::cerr << " " << res.median_seconds << " s" << std::endl;
+
+	results.push_back(res);
+	return !res.failed;
+}
+
+void BenchmarkRunner::add_property(std::string const& key, std::string const& value)
+{
+	properties.push_back(std::make_pair(key, value));
+}
+
+void BenchmarkRunner::write_json(std::ostream& os) const
+{
+	os << std::setprecision(9);
+	os << "{" << std::endl;
+
+	os << "  \"properties\": {";
+	for (size_t i = 0; i < properties.size(); i++)
+	{
+		os << (i == 0 ? "" : ",") << std::endl
+		   << "    \"" << json_escape(properties[i].first) << "\": \"" << json_escape(properties[i].second) << "\"";
+	}
+	os << std::endl << "  }," << std::endl;
+
+	os << "  \"results\": [";
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		result const& r = results[i];
+		os << (i == 0 ? "" : ",") << std::endl
+		   << "    {\"name\": \"" << json_escape(r.name) << "\""
+		   << ", \"runs\": " << r.runs
+		   << ", \"items\": " << r.items
+		   << ", \"min_seconds\": " << r.min_seconds
+		   << ", \"median_seconds\": " << r.median_seconds
+		   << ", \"max_seconds\": " << r.max_seconds
+		   << ", \"items_per_second\": " << (r.median_seconds > 0 ? r.items / r.median_seconds : 0)
+		   << ", \"failed\": " << (r.failed ? "true" : "false");
+
+		if (r.failed)
+			os << ", \"error\": \"" << json_escape(r.error) << "\"";
+
+		os << "}";
+	}
+	os << std::endl << "  ]" << std::endl;
+	os << "}" << std::endl;
+}
+
+void BenchmarkRunner::write_csv(std::ostream& os) const
+{
+	os << std::setprecision(9);
+	os << "name,runs,items,min_seconds,median_seconds,max_seconds,items_per_second,failed" << std::endl;
+
+	for (result const& r : results)
+	{
+		os << r.name << ","
+		   << r.runs << ","
+		   << r.items << ","
+		   << r.min_seconds << ","
+		   << r.median_seconds << ","
+		   << r.max_seconds << ","
+		   << (r.median_seconds > 0 ? r.items / r.median_seconds : 0) << ","
+		   << (r.failed ? 1 : 0) << std::endl;
+	}
+}
+
+void BenchmarkRunner::write_table(std::ostream& os) const
+{
+	for (auto const& p : properties)
+		os << std::left << std::setw(24) << p.first << " : " << p.second << std::endl;
+	os << std::endl;
+
+	os << std::left << std::setw(36) << "Benchmark"
+	   << std::right << std::setw(14) << "Median [s]"
+	   << std::setw(14) << "Min [s]"
+	   << std::setw(16) << "Items/s" << std::endl;
+
+	for (result const& r : results)
+	{
+		os << std::left << std::setw(36) << r.name << std::right;
+
+		if (r.failed)
+		{
+			os << "  failed: " << r.error << std::endl;
+			continue;
+		}
+
+		os << std::fixed << std::setprecision(4)
+		   << std::setw(14) << r.median_seconds
+		   << std::setw(14) << r.min_seconds
+		   << std::setprecision(0)
+		   << std::setw(16) << (r.median_seconds > 0 ? r.items / r.median_seconds : 0)
+		   << std::endl;
+		os.unsetf(std::ios_base::floatfield);
+	}
+}
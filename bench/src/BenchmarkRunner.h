@@ -0,0 +1,124 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __BENCHMARKRUNNER_H__
+#define __BENCHMARKRUNNER_H__
+
+#include <chrono>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace degate
+{
+	/**
+	 * Runs benchmarks and collects their timings.
+	 *
+	 * Each benchmark is run a number of times. The runner records the minimum,
+	 * the median and the maximum wall clock time and the number of items that
+	 * were processed per run, so that throughputs can be compared between releases.
+	 */
+	class BenchmarkRunner
+	{
+	public:
+
+		/**
+		 * The timing of a single benchmark.
+		 */
+		struct result
+		{
+			std::string name;
+			unsigned long long items;
+			unsigned int runs;
+			double min_seconds, median_seconds, max_seconds;
+			bool failed;
+			std::string error;
+		};
+
+		/**
+		 * A benchmark function. It returns the number of items it processed.
+		 */
+		typedef std::function<unsigned long long()> benchmark_function;
+
+		/**
+		 * A function that is called before each run and that is not timed.
+		 */
+		typedef std::function<void()> setup_function;
+
+		/**
+		 * Create a benchmark runner.
+		 * @param runs The number of times each benchmark is run.
+		 * @param filter Run only benchmarks whose name contains this string. Empty means all.
+		 */
+		BenchmarkRunner(unsigned int runs = 3, std::string const& filter = "");
+
+		/**
+		 * Check if a benchmark is selected by the filter.
+		 */
+		bool is_selected(std::string const& name) const;
+
+		/**
+		 * Time a benchmark. Exceptions are caught and recorded as failure.
+		 * @param name The name of the benchmark, e.g. "tile_cache.random_access".
+		 * @param benchmark The function to time.
+		 * @param setup An optional function, that is called before each run.
+		 * @return Returns false, if the benchmark failed.
+		 */
+		bool run(std::string const& name, benchmark_function const& benchmark,
+		         setup_function const& setup = setup_function());
+
+		/**
+		 * Get the results.
+		 */
+		std::vector<result> const& get_results() const { return results; }
+
+		/**
+		 * Add a property that describes the benchmark environment, e.g. the number of gates.
+		 */
+		void add_property(std::string const& key, std::string const& value);
+
+		/**
+		 * Write the results as JSON document.
+		 */
+		void write_json(std::ostream& os) const;
+
+		/**
+		 * Write the results as CSV table with a header line.
+		 */
+		void write_csv(std::ostream& os) const;
+
+		/**
+		 * Write the results as human readable table.
+		 */
+		void write_table(std::ostream& os) const;
+
+	private:
+
+		unsigned int runs;
+		std::string filter;
+		std::vector<result> results;
+		std::vector<std::pair<std::string, std::string>> properties;
+	};
+}
+
+#endif
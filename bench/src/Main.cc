@@ -0,0 +1,599 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "BenchmarkRunner.h"
+#include "ProjectGenerator.h"
+
+#include "Core/Project/Project.h"
+#include "Core/Project/ProjectExporter.h"
+#include "Core/Project/ProjectImporter.h"
+#include "Core/LogicModel/LogicModel.h"
+#include "Core/LogicModel/LogicModelHelper.h"
+#include "Core/LogicModel/Module.h"
+#include "Core/LogicModel/ConnectivityGraph.h"
+#include "Core/LogicModel/LookupSubcircuit.h"
+#include "Core/Image/Image.h"
+#include "Core/Image/Manipulation/ScalingManager.h"
+#include "Core/Image/CompressedTilePack.h"
+#include "Core/Matching/TemplateMatching.h"
+#include "Core/Matching/ViaMatching.h"
+#include "Core/Matching/WireMatching.h"
+#include "Core/RuleCheck/ERCNet.h"
+#include "Core/RuleCheck/ERCOpenPorts.h"
+#include "Core/Generator/VerilogNetlistWriter.h"
+#include "Core/Utils/FileSystem.h"
+#include "Prerequisites.h"
+
+#ifdef SYS_WINDOWS
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <vector>
+
+using namespace degate;
+
+/**
+ * Results of read benchmarks are stored here, so that the reads are not optimized away.
+ */
+static volatile unsigned long long sink;
+
+/**
+ * Redirect stdout to stderr.
+ * @return Returns a file descriptor for the original stdout.
+ */
+static int redirect_stdout()
+{
+	fflush(stdout);
+#ifdef SYS_WINDOWS
+	int fd = _dup(_fileno(stdout));
+	_dup2(_fileno(stderr), _fileno(stdout));
+#else
+	int fd = dup(fileno(stdout));
+	dup2(fileno(stderr), fileno(stdout));
+#endif
+	return fd;
+}
+
+/**
+ * Restore stdout, that was redirected by redirect_stdout().
+ */
+static void restore_stdout(int fd)
+{
+	std::cout.flush();
+	fflush(stdout);
+#ifdef SYS_WINDOWS
+	_dup2(fd, _fileno(stdout));
+	_close(fd);
+#else
+	dup2(fd, fileno(stdout));
+	close(fd);
+#endif
+}
+
+/**
+ * An output stream that discards everything, but counts the written bytes.
+ */
+class CountingBuffer : public std::streambuf
+{
+public:
+
+	unsigned long long count = 0;
+
+protected:
+
+	int overflow(int c) override
+	{
+		count++;
+		return c;
+	}
+
+	std::streamsize xsputn(const char*, std::streamsize n) override
+	{
+		count += n;
+		return n;
+	}
+};
+
+/**
+ * The command line options.
+ */
+struct options
+{
+	unsigned long gates = 10000;
+	unsigned int templates = 8;
+	unsigned int template_size = 24;
+	bool images = true;
+	unsigned int seed = 1;
+	unsigned int runs = 3;
+	unsigned int match_size = 1024;
+	std::string filter;
+	std::string format = "json";
+	std::string output;
+	std::string directory;
+	bool keep = false;
+};
+
+static void print_usage(const char* name)
+{
+	std::cerr
+		<< "Usage: " << name << " [options]" << std::endl
+		<< std::endl
+		<< "Generate a synthetic project and time degate's hot paths." << std::endl
+		<< std::endl
+		<< "  --gates N          Number of gates (default 10000)." << std::endl
+		<< "  --templates N      Number of gate templates (default 8)." << std::endl
+		<< "  --template-size N  Width and height of gate templates in pixel (default 24)." << std::endl
+		<< "  --no-images        Do not generate background images. Image benchmarks are skipped." << std::endl
+		<< "  --seed N           Seed for the generated background images (default 1)." << std::endl
+		<< "  --runs N           Number of runs per benchmark (default 3)." << std::endl
+		<< "  --match-size N     Width and height of the region for matching benchmarks (default 1024)." << std::endl
+		<< "  --filter STR       Run only benchmarks whose name contains STR." << std::endl
+		<< "  --format FMT       Output format: json, csv or table (default json)." << std::endl
+		<< "  --output FILE      Write the results to FILE instead of stdout." << std::endl
+		<< "  --directory DIR    Generate the project in DIR (default: a temporary directory)." << std::endl
+		<< "  --keep             Do not remove the generated project." << std::endl;
+}
+
+static bool parse_options(int argc, char** argv, options& opts)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg(argv[i]);
+		bool has_value = i + 1 < argc;
+
+		if (arg == "--gates" && has_value) opts.gates = std::strtoul(argv[++i], nullptr, 10);
+		else if (arg == "--templates" && has_value) opts.templates = std::strtoul(argv[++i], nullptr, 10);
+		else if (arg == "--template-size" && has_value) opts.template_size = std::strtoul(argv[++i], nullptr, 10);
+		else if (arg == "--no-images") opts.images = false;
+		else if (arg == "--seed" && has_value) opts.seed = std::strtoul(argv[++i], nullptr, 10);
+		else if (arg == "--runs" && has_value) opts.runs = std::strtoul(argv[++i], nullptr, 10);
+		else if (arg == "--match-size" && has_value) opts.match_size = std::strtoul(argv[++i], nullptr, 10);
+		else if (arg == "--filter" && has_value) opts.filter = argv[++i];
+		else if (arg == "--format" && has_value) opts.format = argv[++i];
+		else if (arg == "--output" && has_value) opts.output = argv[++i];
+		else if (arg == "--directory" && has_value) opts.directory = argv[++i];
+		else if (arg == "--keep") opts.keep = true;
+		else return false;
+	}
+
+	return opts.format == "json" || opts.format == "csv" || opts.format == "table";
+}
+
+/**
+ * Remove all gates from a layer, e.g. gates that were inserted by a matching run.
+ */
+static void remove_gates(LogicModel_shptr lmodel, Layer_shptr layer)
+{
+	std::vector<Gate_shptr> gates;
+	for (LogicModel::gate_collection::iterator iter = lmodel->gates_begin(); iter != lmodel->gates_end(); ++iter)
+		if (iter->second->get_layer() == layer)
+			gates.push_back(iter->second);
+
+	for (auto& gate : gates)
+		lmodel->remove_object(gate);
+}
+
+static void run_image_benchmarks(BenchmarkRunner& runner, options const& opts, Project_shptr project)
+{
+	LogicModel_shptr lmodel = project->get_logic_model();
+	Layer_shptr logic_layer = lmodel->get_layer(1);
+	Layer_shptr metal_layer = lmodel->get_layer(2);
+	Layer_shptr transistor_layer = lmodel->get_layer(0);
+
+	BackgroundImage_shptr img = logic_layer->get_image();
+	const unsigned int width = img->get_width(), height = img->get_height();
+	const unsigned long long pixels = (unsigned long long)width * height;
+
+	// tile cache access patterns
+
+	runner.run("tile_cache.row_scan", [&]()
+	{
+		std::vector<BackgroundImage::pixel_type> row(width);
+		for (unsigned int y = 0; y < height; y++)
+			img->raw_copy_row(row.data(), 0, y, width);
+		return pixels;
+	});
+
+	runner.run("tile_cache.column_scan", [&]()
+	{
+		unsigned long long sum = 0;
+		for (unsigned int x = 0; x < width; x += 7)
+			for (unsigned int y = 0; y < height; y++)
+				sum += img->get_pixel(x, y);
+		sink = sum;
+		return (unsigned long long)((width + 6) / 7) * height;
+	});
+
+	runner.run("tile_cache.random_access", [&]()
+	{
+		const unsigned long long accesses = 1000000;
+		std::mt19937 rng(opts.seed);
+		std::uniform_int_distribution<unsigned int> dx(0, width - 1), dy(0, height - 1);
+		unsigned long long sum = 0;
+		for (unsigned long long i = 0; i < accesses; i++)
+			sum += img->get_pixel(dx(rng), dy(rng));
+		sink = sum;
+		return accesses;
+	});
+
+	// compressed tiles, the image is opened again for each run to start with a cold cache
+
+	if (runner.is_selected("tile_cache.compressed_row_scan") || runner.is_selected("tile_cache.compressed_column_scan"))
+	{
+		std::string compressed_dir = create_temp_directory();
+		{
+			BackgroundImage_shptr copy(new BackgroundImage(width, height, compressed_dir, true));
+			copy_image<BackgroundImage, BackgroundImage>(copy, img);
+		}
+		CompressedTilePack::convert_directory(compressed_dir);
+
+		std::string compressed_file = join_pathes(compressed_dir, COMPRESSED_TILE_PACK_FILENAME);
+		std::ifstream compressed_in(compressed_file.c_str(), std::ios::binary | std::ios::ate);
+		runner.add_property("tile_compression_ratio",
+		                    std::to_string(static_cast<double>(pixels * sizeof(BackgroundImage::pixel_type)) /
+			                    static_cast<double>(compressed_in.tellg())));
+		compressed_in.close();
+
+		BackgroundImage_shptr compressed_img;
+
+		runner.run("tile_cache.compressed_row_scan", [&]()
+		{
+			std::vector<BackgroundImage::pixel_type> row(width);
+			for (unsigned int y = 0; y < height; y++)
+				compressed_img->raw_copy_row(row.data(), 0, y, width);
+			return pixels;
+		}, [&]()
+		{
+			compressed_img.reset();
+			compressed_img.reset(new BackgroundImage(width, height, compressed_dir, true));
+		});
+
+		runner.run("tile_cache.compressed_column_scan", [&]()
+		{
+			unsigned long long sum = 0;
+			for (unsigned int x = 0; x < width; x += 7)
+				for (unsigned int y = 0; y < height; y++)
+					sum += compressed_img->get_pixel(x, y);
+			sink = sum;
+			return (unsigned long long)((width + 6) / 7) * height;
+		}, [&]()
+		{
+			compressed_img.reset();
+			compressed_img.reset(new BackgroundImage(width, height, compressed_dir, true));
+		});
+
+		compressed_img.reset();
+		remove_directory(compressed_dir);
+	}
+
+	// pyramid building
+
+	BackgroundImage_shptr pyramid_img;
+	std::string pyramid_dir;
+
+	runner.run("pyramid.build", [&]()
+	{
+		ScalingManager<BackgroundImage> sm(pyramid_img, pyramid_dir);
+		sm.create_scalings();
+		return pixels;
+	}, [&]()
+	{
+		pyramid_img.reset();
+		pyramid_dir = create_temp_directory();
+		pyramid_img.reset(new BackgroundImage(width, height, pyramid_dir, false));
+		copy_image<BackgroundImage, BackgroundImage>(pyramid_img, img);
+	});
+
+	pyramid_img.reset();
+
+	// matching
+
+	const unsigned int match_size = std::min(opts.match_size, std::min(width, height));
+	const BoundingBox match_bbox(0, match_size - 1, 0, match_size - 1);
+	const unsigned long long match_pixels = (unsigned long long)match_size * match_size;
+
+	std::list<GateTemplate_shptr> templates;
+	GateLibrary_shptr glib = lmodel->get_gate_library();
+	for (GateLibrary::template_iterator iter = glib->begin(); iter != glib->end(); ++iter)
+		templates.push_back(iter->second);
+
+	std::list<Gate::ORIENTATION> orientations;
+	orientations.push_back(Gate::ORIENTATION_NORMAL);
+
+	// Matches are inserted into the empty transistor layer, so that the placed
+	// gates on the logic layer do not hide the background.
+	runner.run("matching.template", [&]()
+	{
+		TemplateMatchingNormal matching;
+		matching.set_templates(templates);
+		matching.set_orientations(orientations);
+		matching.set_layers(logic_layer, transistor_layer);
+		matching.set_threshold_hc(0.4);
+		matching.set_threshold_detection(0.7);
+		matching.set_max_step_size(2);
+		matching.set_scaling_factor(1);
+		matching.init(match_bbox, project);
+		matching.run();
+		return match_pixels;
+	}, [&]()
+	{
+		remove_gates(lmodel, transistor_layer);
+	});
+
+	remove_gates(lmodel, transistor_layer);
+
+	lmodel->set_current_layer(metal_layer->get_layer_pos());
+
+	runner.run("matching.via", [&]()
+	{
+		ViaMatching matching;
+		matching.set_diameter(5);
+		matching.set_merge_n_vias(4);
+		matching.init(match_bbox, project);
+		matching.run();
+		return match_pixels;
+	});
+
+	runner.run("matching.wire", [&]()
+	{
+		WireMatching matching;
+		matching.set_wire_diameter(3);
+		matching.init(match_bbox, project);
+		matching.run();
+		return match_pixels;
+	});
+
+	lmodel->set_current_layer(logic_layer->get_layer_pos());
+}
+
+static void run_benchmarks(BenchmarkRunner& runner, options const& opts, Project_shptr generated)
+{
+	std::string directory = generated->get_project_directory();
+
+	// project export and import
+
+	LogicModel_shptr lmodel = generated->get_logic_model();
+	unsigned long long objects = std::distance(lmodel->objects_begin(), lmodel->objects_end());
+
+	runner.run("project.export", [&]()
+	{
+		ProjectExporter exporter;
+		exporter.export_all(directory, generated);
+		return objects;
+	});
+
+	// The import benchmarks need an exported project.
+	if (!runner.is_selected("project.export"))
+	{
+		ProjectExporter exporter;
+		exporter.export_all(directory, generated);
+	}
+
+	Project_shptr project;
+
+	runner.run("project.import", [&]()
+	{
+		ProjectImporter importer;
+		project = importer.import_all(directory);
+		return objects;
+	}, [&]()
+	{
+		project.reset();
+	});
+
+	runner.run("project.import_all_layers", [&]()
+	{
+		ProjectImporter importer;
+		project = importer.import_all(directory);
+		project->get_layer_loader()->wait_loaded();
+		for (LogicModel::layer_collection::iterator iter = project->get_logic_model()->layers_begin();
+		     iter != project->get_logic_model()->layers_end(); ++iter)
+			(*iter)->load();
+		return objects;
+	}, [&]()
+	{
+		project.reset();
+	});
+
+	// Continue with the imported project, if import is benchmarked.
+	if (project == nullptr)
+		project = generated;
+
+	lmodel = project->get_logic_model();
+
+	if (opts.images && lmodel->get_layer(1)->has_background_image())
+		run_image_benchmarks(runner, opts, project);
+
+	// snapshots (deep clone of the whole project, e.g. for undo)
+
+	runner.run("project.snapshot", [&]()
+	{
+		ProjectSnapshot_shptr snapshot = project->create_snapshot("benchmark");
+		return (unsigned long long)std::distance(lmodel->objects_begin(), lmodel->objects_end());
+	});
+
+	// autoconnect
+
+	BoundingBox bbox(project->get_bounding_box());
+
+	runner.run("autoconnect.metal", [&]()
+	{
+		Layer_shptr layer = lmodel->get_layer(2);
+		autoconnect_objects(lmodel, layer, bbox);
+		return (unsigned long long)std::distance(layer->objects_begin(), layer->objects_end());
+	});
+
+	runner.run("autoconnect.interlayer", [&]()
+	{
+		Layer_shptr layer = lmodel->get_layer(1);
+		autoconnect_interlayer_objects(lmodel, layer, bbox);
+		return (unsigned long long)std::distance(layer->objects_begin(), layer->objects_end());
+	});
+
+	// electrical rule checks
+
+	unsigned long long nets = std::distance(lmodel->nets_begin(), lmodel->nets_end());
+
+	runner.run("erc.net", [&]()
+	{
+		ERCNet erc;
+		erc.run(lmodel);
+		return nets;
+	});
+
+	runner.run("erc.open_ports", [&]()
+	{
+		ERCOpenPorts erc;
+		erc.run(lmodel);
+		return (unsigned long long)lmodel->get_gates_count();
+	});
+
+	// netlist analyses
+
+	runner.run("netlist.connectivity_graph", [&]()
+	{
+		ConnectivityGraph graph(*lmodel);
+		return (unsigned long long)graph.get_gates_count();
+	});
+
+	runner.run("netlist.register_chains", [&]()
+	{
+		// Each row of generated gates is a chain of inverters.
+		SubcircuitPattern pattern;
+		pattern.element_logic_class = "inverter";
+		pattern.element_input_port = "A";
+		pattern.element_output_port = "Y";
+		pattern.tap_logic_classes.clear();
+
+		LookupSubcircuit lookup(lmodel);
+		lookup.search(pattern);
+		return (unsigned long long)lmodel->get_gates_count();
+	});
+
+	// Verilog export
+
+	if (runner.is_selected("verilog.export"))
+	{
+		determine_module_ports_for_root(lmodel);
+
+		runner.run("verilog.export", [&]()
+		{
+			CountingBuffer buffer;
+			std::ostream os(&buffer);
+
+			VerilogNetlistWriter writer(lmodel->get_main_module());
+			writer.write(os);
+			return (unsigned long long)lmodel->get_gates_count();
+		});
+	}
+}
+
+int main(int argc, char** argv)
+{
+	options opts;
+	if (!parse_options(argc, argv, opts))
+	{
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	bool remove_directory_on_exit = false;
+	if (opts.directory.empty())
+	{
+		opts.directory = create_temp_directory();
+		remove_directory_on_exit = !opts.keep;
+	}
+	else if (!is_directory(opts.directory))
+		create_directory(opts.directory);
+
+	// Debug messages that are printed by the core while benchmarks run go to stderr,
+	// so that the results on stdout remain machine-readable.
+	int stdout_fd = redirect_stdout();
+
+	BenchmarkRunner runner(opts.runs, opts.filter);
+
+	int ret = 0;
+
+	try
+	{
+		ProjectGenerator generator;
+		generator.set_gates(opts.gates);
+		generator.set_templates(opts.templates);
+		generator.set_template_size(opts.template_size);
+		generator.set_background_images(opts.images);
+		generator.set_seed(opts.seed);
+
+		std::cerr << "Generate project with " << opts.gates << " gates in " << opts.directory << std::endl;
+
+		auto start = std::chrono::steady_clock::now();
+		Project_shptr project = generator.generate(opts.directory);
+		auto stop = std::chrono::steady_clock::now();
+
+		LogicModel_shptr lmodel = project->get_logic_model();
+
+		runner.add_property("gates", std::to_string(lmodel->get_gates_count()));
+		runner.add_property("vias", std::to_string(lmodel->get_vias_count()));
+		runner.add_property("nets", std::to_string(std::distance(lmodel->nets_begin(), lmodel->nets_end())));
+		runner.add_property("templates", std::to_string(opts.templates));
+		runner.add_property("width", std::to_string(project->get_width()));
+		runner.add_property("height", std::to_string(project->get_height()));
+		runner.add_property("background_images", opts.images ? "true" : "false");
+		runner.add_property("runs", std::to_string(opts.runs));
+		runner.add_property("generator_seconds",
+		                    std::to_string(std::chrono::duration<double>(stop - start).count()));
+
+		run_benchmarks(runner, opts, project);
+	}
+	catch (std::exception const& e)
+	{
+		std::cerr << "Error: " << e.what() << std::endl;
+		ret = 1;
+	}
+
+	for (auto const& r : runner.get_results())
+		if (r.failed) ret = 1;
+
+	restore_stdout(stdout_fd);
+
+	std::ofstream file;
+	if (!opts.output.empty())
+		file.open(opts.output.c_str());
+	std::ostream& os = opts.output.empty() ? std::cout : file;
+
+	if (opts.format == "csv") runner.write_csv(os);
+	else if (opts.format == "table") runner.write_table(os);
+	else runner.write_json(os);
+
+	if (remove_directory_on_exit)
+		remove_directory(opts.directory);
+
+	return ret;
+}
@@ -0,0 +1,270 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "ProjectGenerator.h"
+
+#include "Core/LogicModel/LogicModel.h"
+#include "Core/LogicModel/LogicModelHelper.h"
+#include "Core/LogicModel/Gate/Gate.h"
+#include "Core/LogicModel/Gate/GatePort.h"
+#include "Core/LogicModel/Gate/GateTemplate.h"
+#include "Core/LogicModel/Gate/GateTemplatePort.h"
+#include "Core/LogicModel/Via/Via.h"
+#include "Core/LogicModel/Wire/Wire.h"
+#include "Core/LogicModel/Net.h"
+#include "Core/Utils/FileSystem.h"
+
+#include <cmath>
+#include <vector>
+
+#define GENERATOR_LAYER_TRANSISTOR 0
+#define GENERATOR_LAYER_LOGIC 1
+#define GENERATOR_LAYER_METAL 2
+
+#define GENERATOR_WIRE_DIAMETER 3
+#define GENERATOR_VIA_DIAMETER 5
+
+using namespace degate;
+
+ProjectGenerator::ProjectGenerator() :
+	gates(10000),
+	templates(8),
+	template_size(24),
+	background_images(true),
+	seed(1),
+	columns(1)
+{
+}
+
+/**
+ * A cheap deterministic hash for background noise.
+ */
+static inline unsigned int noise(unsigned int x, unsigned int y, unsigned int seed)
+{
+	unsigned int h = x * 374761393u + y * 668265263u + seed * 2246822519u;
+	h = (h ^ (h >> 13)) * 1274126177u;
+	return h ^ (h >> 16);
+}
+
+unsigned int ProjectGenerator::get_pixel(unsigned int layer, unsigned int x, unsigned int y) const
+{
+	const unsigned int pitch = get_pitch();
+	const unsigned int offset = pitch / 4;
+	const unsigned int column = x / pitch, row = y / pitch;
+	const unsigned long gate = (unsigned long)row * columns + column;
+
+	unsigned int value = 40 + (noise(x, y, seed) & 0x1f);
+
+	if (column >= columns || gate >= gates)
+		return MERGE_CHANNELS(value, value, value, 255u);
+
+	// local coordinates within the gate
+	const int lx = (int)(x % pitch) - (int)offset;
+	const int ly = (int)(y % pitch) - (int)offset;
+	const int size = template_size;
+	const bool in_gate = lx >= 0 && ly >= 0 && lx < size && ly < size;
+
+	if (layer == GENERATOR_LAYER_LOGIC && in_gate)
+	{
+		// each template has its own texture
+		const unsigned int tmpl = gate % templates;
+		const bool stripe = ((lx * (tmpl % 3 + 1) + ly * (tmpl / 3 + 1)) / 3) % 2 == 0;
+		value = (stripe ? 170 : 90) + (noise(x, y, seed) & 0x0f);
+
+		if (lx == 0 || ly == 0 || lx == size - 1 || ly == size - 1)
+			value = 220;
+	}
+	else if (layer == GENERATOR_LAYER_TRANSISTOR && in_gate)
+	{
+		if ((lx / 4 + ly / 6) % 2 == 0)
+			value += 60;
+	}
+	else if (layer == GENERATOR_LAYER_METAL)
+	{
+		// a wire from the output port of a gate to the input port of the next gate in the row
+		const int wire_y = size / 2;
+		const int out_x = size - 3;
+		const int in_x = (int)pitch + 2;
+		const bool has_next = column + 1 < columns && gate + 1 < gates;
+
+		if (has_next && std::abs(ly - wire_y) <= GENERATOR_WIRE_DIAMETER / 2 && lx >= out_x && lx <= in_x)
+			value = 200;
+
+		const int r = GENERATOR_VIA_DIAMETER / 2;
+		if (has_next && std::abs(ly - wire_y) <= r && std::abs(lx - out_x) <= r)
+			value = 250;
+
+		// input via of this gate: it belongs to the connection from the previous gate
+		if (column > 0 && std::abs(ly - wire_y) <= r && std::abs(lx - 2) <= r)
+			value = 250;
+	}
+
+	return MERGE_CHANNELS(value, value, value, 255u);
+}
+
+void ProjectGenerator::render_background_image(Project_shptr project, unsigned int layer_pos,
+                                               std::string const& directory) const
+{
+	LogicModel_shptr lmodel = project->get_logic_model();
+	Layer_shptr layer = lmodel->get_layer(layer_pos);
+
+	boost::format fmter("layer_%1%.dimg");
+	fmter % layer_pos;
+	std::string image_directory = join_pathes(directory, fmter.str());
+	create_directory(image_directory);
+
+	BackgroundImage_shptr img(new BackgroundImage(project->get_width(), project->get_height(), image_directory));
+
+	for (unsigned int y = 0; y < img->get_height(); y++)
+		for (unsigned int x = 0; x < img->get_width(); x++)
+			img->set_pixel(x, y, get_pixel(layer_pos, x, y));
+
+	layer->set_image(img);
+}
+
+Project_shptr ProjectGenerator::generate(std::string const& directory)
+{
+	if (!is_directory(directory))
+		throw InvalidPathException("The directory for the generated project must exist.");
+
+	const unsigned int pitch = get_pitch();
+	const unsigned int offset = pitch / 4;
+
+	columns = std::max(1u, (unsigned int)std::ceil(std::sqrt((double)gates)));
+	const unsigned int rows = std::max(1ul, (gates + columns - 1) / columns);
+
+	const unsigned int width = std::max(256u, columns * pitch);
+	const unsigned int height = std::max(256u, rows * pitch);
+
+	Project_shptr project = std::make_shared<Project>(width, height, directory, 3);
+	project->set_name("Synthetic project");
+	project->set_description("A project generated for benchmarks.");
+
+	LogicModel_shptr lmodel = project->get_logic_model();
+	lmodel->get_layer(GENERATOR_LAYER_TRANSISTOR)->set_layer_type(Layer::TRANSISTOR);
+	lmodel->get_layer(GENERATOR_LAYER_LOGIC)->set_layer_type(Layer::LOGIC);
+	lmodel->get_layer(GENERATOR_LAYER_METAL)->set_layer_type(Layer::METAL);
+
+	const diameter_t port_diameter = project->get_default_port_diameter();
+
+	// gate library
+	std::vector<GateTemplate_shptr> library;
+	for (unsigned int i = 0; i < templates; i++)
+	{
+		GateTemplate_shptr tmpl(new GateTemplate(template_size, template_size));
+		tmpl->set_object_id(lmodel->get_new_object_id());
+		tmpl->set_name("cell_" + std::to_string(i));
+		tmpl->set_logic_class("inverter");
+
+		GateTemplatePort_shptr in(new GateTemplatePort(2, template_size / 2, GateTemplatePort::PORT_TYPE_IN));
+		in->set_object_id(lmodel->get_new_object_id());
+		in->set_name("A");
+		tmpl->add_template_port(in);
+
+		GateTemplatePort_shptr out(new GateTemplatePort(template_size - 3, template_size / 2, GateTemplatePort::PORT_TYPE_OUT));
+		out->set_object_id(lmodel->get_new_object_id());
+		out->set_name("Y");
+		tmpl->add_template_port(out);
+
+		tmpl->set_implementation(GateTemplate::VERILOG,
+		                         "module " + tmpl->get_name() + " (A, Y);\n"
+		                         "  input A;\n  output Y;\n  assign Y = ~A;\nendmodule\n\n");
+
+		lmodel->add_gate_template(tmpl);
+		library.push_back(tmpl);
+	}
+
+	// gates, wires, vias and nets
+	GatePort_shptr previous_out;
+
+	for (unsigned long i = 0; i < gates; i++)
+	{
+		const unsigned int column = i % columns;
+		const unsigned int row = i / columns;
+		const unsigned int x = column * pitch + offset;
+		const unsigned int y = row * pitch + offset;
+
+		GateTemplate_shptr tmpl = library[i % templates];
+
+		Gate_shptr gate(new Gate(x, x + template_size - 1, y, y + template_size - 1, Gate::ORIENTATION_NORMAL));
+		gate->set_object_id(lmodel->get_new_object_id());
+		gate->set_gate_template(tmpl);
+
+		GatePort_shptr ports[2];
+		unsigned int p = 0;
+		for (GateTemplate::port_iterator iter = tmpl->ports_begin(); iter != tmpl->ports_end() && p < 2; ++iter, p++)
+		{
+			ports[p].reset(new GatePort(gate, *iter, port_diameter));
+			ports[p]->set_object_id(lmodel->get_new_object_id());
+			gate->add_port(ports[p]);
+		}
+
+		lmodel->add_object(GENERATOR_LAYER_LOGIC, gate);
+
+		if (column > 0 && previous_out != nullptr)
+		{
+			GatePort_shptr in = ports[0];
+
+			Via_shptr via_out(new Via(previous_out->get_x(), previous_out->get_y(),
+			                          GENERATOR_VIA_DIAMETER, Via::DIRECTION_DOWN));
+			Via_shptr via_in(new Via(in->get_x(), in->get_y(), GENERATOR_VIA_DIAMETER, Via::DIRECTION_DOWN));
+			Wire_shptr wire(new Wire(previous_out->get_x(), previous_out->get_y(),
+			                         in->get_x(), in->get_y(), GENERATOR_WIRE_DIAMETER));
+
+			lmodel->add_object(GENERATOR_LAYER_METAL, via_out);
+			lmodel->add_object(GENERATOR_LAYER_METAL, via_in);
+			lmodel->add_object(GENERATOR_LAYER_METAL, wire);
+
+			Net_shptr net(new Net());
+			lmodel->add_net(net);
+
+			previous_out->set_net(net);
+			via_out->set_net(net);
+			wire->set_net(net);
+			via_in->set_net(net);
+			in->set_net(net);
+		}
+
+		previous_out = ports[1];
+	}
+
+	// background images and template images
+	if (background_images)
+	{
+		render_background_image(project, GENERATOR_LAYER_TRANSISTOR, directory);
+		render_background_image(project, GENERATOR_LAYER_LOGIC, directory);
+		render_background_image(project, GENERATOR_LAYER_METAL, directory);
+
+		for (unsigned int i = 0; i < templates && i < gates; i++)
+		{
+			const unsigned int x = (i % columns) * pitch + offset;
+			const unsigned int y = (i / columns) * pitch + offset;
+
+			grab_template_images(lmodel, library[i],
+			                     BoundingBox(x, x + template_size - 1, y, y + template_size - 1));
+		}
+	}
+
+	lmodel->set_current_layer(GENERATOR_LAYER_LOGIC);
+
+	return project;
+}
@@ -0,0 +1,103 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __PROJECTGENERATOR_H__
+#define __PROJECTGENERATOR_H__
+
+#include "Core/Project/Project.h"
+
+#include <string>
+
+namespace degate
+{
+	/**
+	 * Generate synthetic projects for benchmarks.
+	 *
+	 * A generated project has a transistor, a logic and a metal layer. Gates are
+	 * placed on the logic layer in a regular grid. Neighbouring gates in a row are
+	 * connected by a wire with a via at each end on the metal layer, every connection
+	 * being a net. Optionally, background images are rendered for all layers: each
+	 * gate template has its own texture, wires and vias are drawn on the metal layer.
+	 * The generator is deterministic for a given seed.
+	 */
+	class ProjectGenerator
+	{
+	public:
+
+		ProjectGenerator();
+
+		/**
+		 * Set the number of gates to place.
+		 */
+		void set_gates(unsigned long gates) { this->gates = gates; }
+
+		/**
+		 * Set the number of gate templates in the gate library.
+		 */
+		void set_templates(unsigned int templates) { this->templates = std::max(templates, 1u); }
+
+		/**
+		 * Set the width and height of gate templates in pixel.
+		 */
+		void set_template_size(unsigned int template_size) { this->template_size = std::max(template_size, 12u); }
+
+		/**
+		 * Enable or disable the generation of background images.
+		 */
+		void set_background_images(bool background_images) { this->background_images = background_images; }
+
+		/**
+		 * Set the seed for the background noise.
+		 */
+		void set_seed(unsigned int seed) { this->seed = seed; }
+
+		/**
+		 * Generate a project.
+		 * @param directory The project directory. It must exist. Background images are stored here.
+		 * @return Returns the generated project. It is not exported.
+		 */
+		Project_shptr generate(std::string const& directory);
+
+		/**
+		 * Get the distance between two gates in a row or a column.
+		 */
+		unsigned int get_pitch() const { return 2 * template_size; }
+
+	private:
+
+		unsigned int get_pixel(unsigned int layer, unsigned int x, unsigned int y) const;
+
+		void render_background_image(Project_shptr project, unsigned int layer, std::string const& directory) const;
+
+	private:
+
+		unsigned long gates;
+		unsigned int templates;
+		unsigned int template_size;
+		bool background_images;
+		unsigned int seed;
+
+		unsigned int columns;
+	};
+}
+
+#endif
@@ -37,6 +37,27 @@ size_t Configuration::get_max_tile_cache_size() const
 	return boost::lexical_cast<size_t>(cs);
 }
 
+size_t Configuration::get_max_temp_memory_size() const
+{
+	char* ms = getenv("DEGATE_TEMP_MEMORY_SIZE");
+	if (ms == nullptr) return 256;
+	return boost::lexical_cast<size_t>(ms);
+}
+
+size_t Configuration::get_small_temp_image_size() const
+{
+	char* is = getenv("DEGATE_SMALL_TEMP_IMAGE_SIZE");
+	if (is == nullptr) return 1024;
+	return boost::lexical_cast<size_t>(is);
+}
+
+bool Configuration::use_tile_compression() const
+{
+	char* tc = getenv("DEGATE_TILE_COMPRESSION");
+	if (tc == nullptr) return false;
+	return std::string(tc) == "1";
+}
+
 std::string Configuration::get_servers_uri_pattern() const
 {
 	char* uri_pattern = getenv("DEGATE_SERVER_URI_PATTERN");
@@ -46,6 +46,32 @@ namespace degate {
     size_t get_max_tile_cache_size() const;
 
 
+    /**
+     * Get the amount of memory for temporary images in MB.
+     * @return If the environment variable DEGATE_TEMP_MEMORY_SIZE is set,
+     *   its value. Else the default size is returned. That is 256 MB.
+     */
+    size_t get_max_temp_memory_size() const;
+
+
+    /**
+     * Get the size of temporary images in KB, up to which they are always
+     * kept in memory, even if the memory for temporary images is used up.
+     * @return If the environment variable DEGATE_SMALL_TEMP_IMAGE_SIZE is set,
+     *   its value. Else the default size is returned. That is 1024 KB.
+     */
+    size_t get_small_temp_image_size() const;
+
+
+    /**
+     * Check if new persistent images (e.g. background images) are stored
+     * with compressed tiles.
+     * @return If the environment variable DEGATE_TILE_COMPRESSION is set
+     *   to 1, true. Else false is returned.
+     */
+    bool use_tile_compression() const;
+
+
     /**
      * Get the URI address pattern for the collaboration server.
      * It is a pattern, because it holds a placeholder for the channel ID.
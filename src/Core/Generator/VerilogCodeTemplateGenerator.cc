@@ -43,9 +43,13 @@ VerilogCodeTemplateGenerator::~VerilogCodeTemplateGenerator()
 }
 
 std::string VerilogCodeTemplateGenerator::generate() const
+{
+	return generate_common() + generate_definition();
+}
+
+std::string VerilogCodeTemplateGenerator::generate_definition() const
 {
 	return
-		generate_common() +
 		generate_header() +
 		generate_module(entity_name, generate_port_list()) +
 		generate_port_definition() +
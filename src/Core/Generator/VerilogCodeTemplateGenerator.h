@@ -46,6 +46,12 @@ namespace degate
 
 		virtual std::string generate() const;
 
+		/**
+		 * Generate the code for the entity itself, without the common code
+		 * that generate() puts in front of it.
+		 */
+		virtual std::string generate_definition() const;
+
 		typedef std::map<std::string, std::string> port_map_type;
 
 	protected:
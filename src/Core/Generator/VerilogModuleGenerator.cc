@@ -25,6 +25,9 @@
 #include <boost/foreach.hpp>
 #include <boost/algorithm/string/join.hpp>
 
+#include <unordered_map>
+#include <algorithm>
+
 using namespace boost;
 using namespace degate;
 
@@ -50,6 +53,19 @@ VerilogModuleGenerator::~VerilogModuleGenerator()
 {
 }
 
+std::string VerilogModuleGenerator::generate_gate_template_code(GateTemplate_shptr gtmpl)
+{
+	try
+	{
+		return gtmpl->get_implementation(GateTemplate::VERILOG);
+	}
+	catch (CollectionLookupException const& ex)
+	{
+		// maybe we should pass the exception?
+		return "// Error: failed to lookup Verilog implementation for module " + gtmpl->get_name() + ".\n\n";
+	}
+}
+
 
 std::string VerilogModuleGenerator::generate_common_code_for_gates(Module_shptr module,
                                                                    std::set<GateTemplate_shptr>& already_dumped) const
@@ -67,16 +83,7 @@ std::string VerilogModuleGenerator::generate_common_code_for_gates(Module_shptr
 			{
 				if (already_dumped.find(gtmpl) == already_dumped.end())
 				{
-					try
-					{
-						common_code += gtmpl->get_implementation(GateTemplate::VERILOG);
-					}
-					catch (CollectionLookupException const& ex)
-					{
-						// maybe we should pass the exception?
-						common_code += "// Error: failed to lookup Verilog implementation for module " + gtmpl->
-							get_name() + ".\n\n";
-					}
+					common_code += generate_gate_template_code(gtmpl);
 					already_dumped.insert(gtmpl);
 				}
 			}
@@ -105,114 +112,132 @@ std::string VerilogModuleGenerator::generate_common() const
 
 std::string VerilogModuleGenerator::generate_impl(std::string const& logic_class /* unused parameter */) const
 {
-	std::string impl;
-	std::string wire_definitions;
+	typedef std::unordered_map<object_id_t /* net */, std::string> net_names_table;
+	typedef std::unordered_map<GatePort const*, std::string const*> module_port_names_table;
 
-	unsigned int wire_counter = 0;
+	// size the tables once for all gate and sub-module ports
+	size_t num_ports = 0;
+	for (Module::gate_collection::const_iterator iter = mod->gates_begin(); iter != mod->gates_end(); ++iter)
+		num_ports += (*iter)->get_ports_number();
+	for (Module::module_collection::const_iterator iter = mod->modules_begin(); iter != mod->modules_end(); ++iter)
+		num_ports += std::distance((*iter)->ports_begin(), (*iter)->ports_end());
 
-	typedef std::map<object_id_t /* net */, std::string> net_names_table;
 	net_names_table nets;
+	nets.reserve(num_ports);
 
+	// Reverse lookup for module ports. If a gate port is used for several module ports,
+	// the first name wins, as in Module::lookup_module_port_name().
+	module_port_names_table module_port_names;
+	module_port_names.reserve(std::distance(mod->ports_begin(), mod->ports_end()));
+	for (Module::port_collection::const_iterator iter = mod->ports_begin(); iter != mod->ports_end(); ++iter)
+		module_port_names.emplace(iter->second.get(), &iter->first);
+
+	unsigned int wire_counter = 0;
 
 	// generate signal names
 	for (Module::gate_collection::const_iterator iter = mod->gates_begin();
 	     iter != mod->gates_end(); ++iter)
 	{
 		Gate_shptr gate = *iter;
-		GateTemplate_shptr gate_tmpl = gate->get_gate_template();
 		for (Gate::port_const_iterator p_iter = gate->ports_begin(); p_iter != gate->ports_end(); ++p_iter)
 		{
 			const GatePort_shptr gport = *p_iter;
 			if (gport->is_connected())
 			{
-				const Net_shptr net = gport->get_net();
+				const object_id_t net_id = gport->get_net()->get_object_id();
 
 				// first, check if the gate port is directly adjacent to a module port
-				boost::optional<std::string> is_module_port = mod->lookup_module_port_name(gport);
-				if (is_module_port)
+				module_port_names_table::const_iterator is_module_port = module_port_names.find(gport.get());
+				if (is_module_port != module_port_names.end())
 				{
-					nets[net->get_object_id()] = *is_module_port;
+					nets[net_id] = *is_module_port->second;
 				}
-				else if (nets.find(net->get_object_id()) == nets.end())
+				else if (nets.find(net_id) == nets.end())
 				{
-					boost::format f("w%1%");
-					f % (wire_counter++);
-					nets[net->get_object_id()] = f.str();
+					nets[net_id] = "w" + std::to_string(wire_counter++);
 				}
 			}
 		}
 	}
 
-
 	for (Module::module_collection::const_iterator iter = mod->modules_begin();
 	     iter != mod->modules_end(); ++iter)
 	{
 		Module_shptr sub = *iter;
-		std::list<std::string> ports;
 
 		// iterate over its module ports
 		for (Module::port_collection::const_iterator p_iter = sub->ports_begin();
 		     p_iter != sub->ports_end(); ++p_iter)
 		{
-			std::string const& submod_port_name = p_iter->first;
 			const GatePort_shptr gport = p_iter->second;
-
 			if (gport->is_connected())
-			{
-				const Net_shptr net = gport->get_net();
-
-				nets[net->get_object_id()] = submod_port_name;
-			}
+				nets[gport->get_net()->get_object_id()] = p_iter->first;
 		}
 	}
 
 
-	// genereate wire definitions
-	BOOST_FOREACH(net_names_table::value_type const& v, nets)
+	// genereate wire definitions, ordered by net ID
+	std::vector<net_names_table::value_type const*> sorted_nets;
+	sorted_nets.reserve(nets.size());
+	for (net_names_table::const_iterator iter = nets.begin(); iter != nets.end(); ++iter)
+		sorted_nets.push_back(&*iter);
+
+	std::sort(sorted_nets.begin(), sorted_nets.end(),
+	          [](net_names_table::value_type const* a, net_names_table::value_type const* b)
+	          {
+		          return a->first < b->first;
+	          });
+
+	std::string wire_definitions;
+	for (auto v : sorted_nets)
 	{
-		if (!mod->exists_module_port_name(v.second))
-			wire_definitions += "  wire " + v.second + ";\n";
+		if (!mod->exists_module_port_name(v->second))
+			wire_definitions.append("  wire ").append(v->second).append(";\n");
 	}
 
+	std::string impl;
+	impl.reserve(64 * num_ports);
+
+	auto net_name = [&](GatePort_shptr const& gport) -> std::string const&
+	{
+		return nets[gport->get_net()->get_object_id()];
+	};
 
-	// place single standard cells
+	auto place_instance = [&](std::string const& type_name, std::string const& instance_name,
+	                          std::vector<std::pair<std::string, std::string const*>> const& ports)
+	{
+		impl.append("  ").append(type_name).append(" ").append(instance_name).append(" (\n");
+		for (size_t i = 0; i < ports.size(); i++)
+		{
+			if (i > 0) impl.append(",\n");
+			impl.append("    .").append(ports[i].first).append(" (").append(*ports[i].second).append(")");
+		}
+		impl.append(" );\n\n");
+	};
 
+	std::vector<std::pair<std::string, std::string const*>> ports;
+
+	// place single standard cells
 	for (Module::gate_collection::const_iterator iter = mod->gates_begin();
 	     iter != mod->gates_end(); ++iter)
 	{
 		Gate_shptr gate = *iter;
 		GateTemplate_shptr gate_tmpl = gate->get_gate_template();
 
-		std::list<std::string> ports;
-
+		ports.clear();
 		for (Gate::port_const_iterator p_iter = gate->ports_begin(); p_iter != gate->ports_end(); ++p_iter)
 		{
 			const GatePort_shptr gport = *p_iter;
-			const GateTemplatePort_shptr tmpl_port = gport->get_template_port();
 
 			if (gport->is_connected())
 			{
-				const Net_shptr net = gport->get_net();
-
-				std::string port_name = generate_identifier(tmpl_port->get_name());
+				std::string port_name = generate_identifier(gport->get_template_port()->get_name());
 				std::transform(port_name.begin(), port_name.end(), port_name.begin(), ::tolower);
-
-				boost::format f("    .%1% (%2%)");
-				f % port_name
-					% nets[net->get_object_id()];
-				ports.push_back(f.str());
+				ports.emplace_back(port_name, &net_name(gport));
 			}
 		}
 
-
-		boost::format gate_placement("  %1% %2% (\n"
-			"%3% );\n\n");
-		gate_placement
-			% generate_identifier(gate_tmpl->get_name(), "dg_")
-			% generate_identifier(gate->get_name())
-			% boost::algorithm::join(ports, ",\n");
-
-		impl += gate_placement.str();
+		place_instance(generate_identifier(gate_tmpl->get_name(), "dg_"), generate_identifier(gate->get_name()), ports);
 	}
 
 
@@ -221,39 +246,20 @@ std::string VerilogModuleGenerator::generate_impl(std::string const& logic_class
 	     iter != mod->modules_end(); ++iter)
 	{
 		Module_shptr sub = *iter;
-		std::list<std::string> ports;
 
-		// iterate over its module ports
+		ports.clear();
 		for (Module::port_collection::const_iterator p_iter = sub->ports_begin();
 		     p_iter != sub->ports_end(); ++p_iter)
 		{
-			std::string const& submod_port_name = p_iter->first;
-			const GatePort_shptr gport = p_iter->second;
-
-			if (gport->is_connected())
-			{
-				const Net_shptr net = gport->get_net();
-
-				boost::format f("    .%1% (%2%)");
-				f % submod_port_name
-					% nets[net->get_object_id()];
-				ports.push_back(f.str());
-			}
+			if (p_iter->second->is_connected())
+				ports.emplace_back(p_iter->first, &net_name(p_iter->second));
 		}
 
-
-		boost::format gate_placement("  %1% %2% (\n"
-			"%3% );\n\n");
-		gate_placement
-			% generate_identifier(sub->get_entity_name() != "" ? sub->get_entity_name() : sub->get_name(), "dg_")
-			% generate_identifier(sub->get_name())
-			% boost::algorithm::join(ports, ",\n");
-
-		impl += gate_placement.str();
+		place_instance(generate_identifier(sub->get_entity_name() != "" ? sub->get_entity_name() : sub->get_name(), "dg_"),
+		               generate_identifier(sub->get_name()), ports);
 	}
 
 
-	// place sub-modules
 	return
 		(wire_definitions != "" ? "  // net definitions\n" : "") +
 		wire_definitions + "\n" +
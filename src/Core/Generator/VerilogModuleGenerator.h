@@ -43,6 +43,12 @@ namespace degate
 
 		virtual ~VerilogModuleGenerator();
 
+		/**
+		 * Get the Verilog implementation of a gate template. If the template has
+		 * no Verilog implementation, a comment is returned instead.
+		 */
+		static std::string generate_gate_template_code(GateTemplate_shptr gtmpl);
+
 	protected:
 
 		virtual std::string generate_common() const;
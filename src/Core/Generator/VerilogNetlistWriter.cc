@@ -0,0 +1,109 @@
+/* -*-c++-*-
+
+ This file is part of the IC reverse engineering tool degate.
+
+ Copyright 2008, 2009, 2010 by Martin Schobert
+
+ Degate is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ any later version.
+
+ Degate is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <Core/Generator/VerilogNetlistWriter.h>
+#include <Core/Generator/VerilogModuleGenerator.h>
+#include <Core/Utils/ParallelFor.h>
+
+#include <boost/thread.hpp>
+
+using namespace degate;
+
+VerilogNetlistWriter::VerilogNetlistWriter(Module_shptr root, bool do_not_output_gates, unsigned int threads) :
+	root(root),
+	no_gates(do_not_output_gates),
+	threads(threads)
+{
+	if (root == nullptr)
+		throw InvalidPointerException("Invalid pointer passed to VerilogNetlistWriter().");
+
+	if (this->threads == 0)
+		this->threads = std::max(boost::thread::hardware_concurrency(), 1u);
+}
+
+VerilogNetlistWriter::~VerilogNetlistWriter()
+{
+}
+
+void VerilogNetlistWriter::collect_items(Module_shptr module, std::set<GateTemplate const*>& already_dumped,
+                                         std::vector<netlist_item>& items) const
+{
+	if (!no_gates)
+	{
+		for (Module::gate_collection::const_iterator iter = module->gates_begin();
+		     iter != module->gates_end(); ++iter)
+		{
+			if (GateTemplate_shptr gtmpl = (*iter)->get_gate_template())
+			{
+				if (already_dumped.insert(gtmpl.get()).second)
+					items.push_back({gtmpl, Module_shptr()});
+			}
+		}
+	}
+
+	// sub-modules are defined before the module that instantiates them
+	for (Module::module_collection::const_iterator iter = module->modules_begin();
+	     iter != module->modules_end(); ++iter)
+	{
+		collect_items(*iter, already_dumped, items);
+		items.push_back({GateTemplate_shptr(), *iter});
+	}
+}
+
+std::string VerilogNetlistWriter::generate_item(netlist_item const& item) const
+{
+	if (item.gate_template != nullptr)
+		return VerilogModuleGenerator::generate_gate_template_code(item.gate_template);
+
+	VerilogModuleGenerator codegen(item.module, item.module != root || no_gates);
+	return codegen.generate_definition();
+}
+
+void VerilogNetlistWriter::write(std::ostream& os) const
+{
+	std::vector<netlist_item> items;
+	std::set<GateTemplate const*> already_dumped;
+
+	collect_items(root, already_dumped, items);
+	items.push_back({GateTemplate_shptr(), root});
+
+	const size_t batch_size = threads * VERILOG_NETLIST_MODULES_PER_THREAD;
+	std::vector<std::string> code(std::min(batch_size, items.size()));
+
+	for (size_t batch_start = 0; batch_start < items.size(); batch_start += batch_size)
+	{
+		const size_t n = std::min(batch_start + batch_size, items.size()) - batch_start;
+
+		parallel_for(n, [&](size_t i)
+		{
+			code[i] = generate_item(items[batch_start + i]);
+		}, threads);
+
+		// write in netlist order
+		for (size_t i = 0; i < n; i++)
+		{
+			os << code[i];
+			std::string().swap(code[i]);
+		}
+	}
+
+	os << std::flush;
+}
@@ -0,0 +1,91 @@
+/* -*-c++-*-
+
+ This file is part of the IC reverse engineering tool degate.
+
+ Copyright 2008, 2009, 2010 by Martin Schobert
+
+ Degate is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ any later version.
+
+ Degate is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __VERILOGNETLISTWRITER_H__
+#define __VERILOGNETLISTWRITER_H__
+
+#include <Core/LogicModel/Module.h>
+
+#include <ostream>
+#include <set>
+#include <vector>
+
+/**
+ * Number of module definitions a single thread generates per batch. The
+ * netlist writer keeps at most one batch of module definitions in memory.
+ */
+#define VERILOG_NETLIST_MODULES_PER_THREAD 16
+
+namespace degate
+{
+	/**
+	 * Writes a Verilog netlist for a module hierarchy to an output stream.
+	 *
+	 * The output is the same as VerilogModuleGenerator::generate() for the root
+	 * module, except that a module definition nested deeper than one level is
+	 * written only once. Module definitions are generated in parallel, batch
+	 * by batch, and are written in a deterministic order.
+	 */
+	class VerilogNetlistWriter
+	{
+	public:
+
+		/**
+		 * Create a netlist writer.
+		 * @param root The top module of the netlist.
+		 * @param do_not_output_gates If true, the implementations of the gate templates are not written.
+		 * @param threads The number of worker threads. If zero, the number of CPU cores is used.
+		 * @exception InvalidPointerException This exception is thrown, if \p root is a nullptr pointer.
+		 */
+		VerilogNetlistWriter(Module_shptr root, bool do_not_output_gates = false, unsigned int threads = 0);
+
+		~VerilogNetlistWriter();
+
+		/**
+		 * Write the netlist.
+		 */
+		void write(std::ostream& os) const;
+
+	private:
+
+		/**
+		 * An element of the netlist: either a gate template implementation or a module definition.
+		 */
+		struct netlist_item
+		{
+			GateTemplate_shptr gate_template;
+			Module_shptr module;
+		};
+
+		void collect_items(Module_shptr module, std::set<GateTemplate const*>& already_dumped,
+		                   std::vector<netlist_item>& items) const;
+
+		std::string generate_item(netlist_item const& item) const;
+
+	private:
+
+		Module_shptr root;
+		bool no_gates;
+		unsigned int threads;
+	};
+}
+
+#endif
@@ -0,0 +1,613 @@
+/* -*-c++-*-
+
+ This file is part of the IC reverse engineering tool degate.
+
+ Copyright 2008, 2009, 2010 by Martin Schobert
+
+ Degate is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ any later version.
+
+ Degate is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "Core/Image/CompressedTilePack.h"
+#include "Core/Image/TilePack.h"
+#include "Core/Utils/FileSystem.h"
+
+#include <QByteArray>
+
+#include <algorithm>
+#include <cstring>
+
+#include <boost/format.hpp>
+
+using namespace degate;
+
+CompressedTilePack::CompressedTilePack(std::string const& filename,
+                                       unsigned int tile_width_exp,
+                                       unsigned int tiles_x, unsigned int tiles_y,
+                                       unsigned int pixel_size) :
+	filename(filename),
+	tile_width_exp(tile_width_exp),
+	tiles_x(std::max(tiles_x, 1u)),
+	tiles_y(std::max(tiles_y, 1u)),
+	pixel_size(pixel_size),
+	tile_bytes(static_cast<size_t>(pixel_size) << (2 * tile_width_exp)),
+	file_end(0),
+	unused_bytes(0),
+	index_modified(false),
+	active_tasks(0),
+	stop_requested(false)
+{
+	if (!file_exists(filename))
+	{
+		// Create a new file with an empty index.
+		std::ofstream out(filename.c_str(), std::ios::binary);
+		if (!out)
+			throw DegateRuntimeException("Can't create the compressed tile pack file " + filename);
+
+		index.resize(static_cast<size_t>(this->tiles_x) * this->tiles_y, index_entry{0, 0, 0});
+		index_modified = true;
+	}
+
+	file.open(filename.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+	if (!file)
+		throw DegateRuntimeException("Can't open the compressed tile pack file " + filename);
+
+	if (index_modified)
+	{
+		write_index();
+		index_modified = false;
+	}
+	else
+	{
+		header hdr;
+		if (!file.read(reinterpret_cast<char*>(&hdr), sizeof(header)) ||
+			hdr.magic != COMPRESSED_TILE_PACK_MAGIC ||
+			hdr.version != COMPRESSED_TILE_PACK_VERSION)
+		{
+			throw DegateRuntimeException("The file " + filename + " is not a compressed tile pack file.");
+		}
+
+		if (hdr.tile_width_exp != tile_width_exp ||
+			hdr.pixel_size != pixel_size ||
+			hdr.tiles_x < this->tiles_x ||
+			hdr.tiles_y < this->tiles_y)
+		{
+			boost::format fmter("The compressed tile pack file %1% has a tile layout of %2%x%3% tiles with 2^%4% "
+				"pixel and %5% bytes per pixel. Expected %6%x%7% tiles with 2^%8% pixel and %9% bytes per pixel.");
+			fmter % filename % hdr.tiles_x % hdr.tiles_y % hdr.tile_width_exp % hdr.pixel_size
+				% this->tiles_x % this->tiles_y % tile_width_exp % pixel_size;
+			throw DegateRuntimeException(fmter.str());
+		}
+
+		this->tiles_x = hdr.tiles_x;
+		this->tiles_y = hdr.tiles_y;
+
+		index.resize(static_cast<size_t>(this->tiles_x) * this->tiles_y);
+		if (!file.read(reinterpret_cast<char*>(index.data()), index.size() * sizeof(index_entry)))
+			throw DegateRuntimeException("Can't read the index of the compressed tile pack file " + filename);
+
+		file.seekg(0, std::ios::end);
+		uint64_t file_size = static_cast<uint64_t>(file.tellg());
+
+		file_end = sizeof(header) + index.size() * sizeof(index_entry);
+		uint64_t used_bytes = 0;
+
+		for (index_entry const& entry : index)
+		{
+			if (entry.size > 0 && (entry.offset < file_end || entry.offset + entry.size > file_size))
+				throw DegateRuntimeException("The index of the compressed tile pack file " + filename + " is corrupted.");
+
+			used_bytes += entry.size;
+		}
+
+		unused_bytes = file_size - file_end - used_bytes;
+		file_end = file_size;
+	}
+
+	if (file_end == 0)
+		file_end = sizeof(header) + index.size() * sizeof(index_entry);
+
+	unsigned int threads = std::min(std::max(boost::thread::hardware_concurrency(), 1u),
+	                                static_cast<unsigned int>(COMPRESSED_TILE_PACK_MAX_THREADS));
+	for (unsigned int i = 0; i < threads; i++)
+		workers.create_thread(boost::bind(&CompressedTilePack::run, this));
+}
+
+CompressedTilePack::~CompressedTilePack()
+{
+	try
+	{
+		flush();
+	}
+	catch (std::exception const& e)
+	{
+		debug(TM, "Failed to flush the compressed tile pack file %s: %s", filename.c_str(), e.what());
+	}
+
+	{
+		boost::mutex::scoped_lock lock(mutex);
+		stop_requested = true;
+	}
+	condition.notify_all();
+	workers.join_all();
+
+	// Reclaim the space of overwritten tiles, if it is worth it.
+	if (unused_bytes > file_end / 4 && unused_bytes > tile_bytes)
+	{
+		try
+		{
+			compact();
+		}
+		catch (std::exception const& e)
+		{
+			debug(TM, "Failed to compact the compressed tile pack file %s: %s", filename.c_str(), e.what());
+		}
+	}
+}
+
+size_t CompressedTilePack::get_index(tile_t const& tile) const
+{
+	if (tile.first >= tiles_x || tile.second >= tiles_y)
+	{
+		boost::format fmter("Tile %1%/%2% is out of the range of the compressed tile pack file %3%.");
+		fmter % tile.first % tile.second % filename;
+		throw DegateRuntimeException(fmter.str());
+	}
+
+	return static_cast<size_t>(tile.second) * tiles_x + tile.first;
+}
+
+void CompressedTilePack::encode(uint8_t const* src, std::vector<uint8_t>& dst) const
+{
+	// Split the pixel bytes into planes and store the difference to the previous byte of a plane.
+	dst.resize(tile_bytes);
+
+	const size_t pixels = tile_bytes / pixel_size;
+	for (unsigned int plane = 0; plane < pixel_size; plane++)
+	{
+		uint8_t* out = dst.data() + plane * pixels;
+		uint8_t prev = 0;
+
+		for (size_t i = 0; i < pixels; i++)
+		{
+			uint8_t v = src[i * pixel_size + plane];
+			out[i] = static_cast<uint8_t>(v - prev);
+			prev = v;
+		}
+	}
+
+	QByteArray compressed = qCompress(reinterpret_cast<const uchar*>(dst.data()), static_cast<int>(dst.size()),
+	                                  COMPRESSED_TILE_PACK_LEVEL);
+	dst.assign(compressed.constData(), compressed.constData() + compressed.size());
+}
+
+void CompressedTilePack::decode(std::vector<uint8_t> const& src, uint8_t* dst) const
+{
+	QByteArray data = qUncompress(reinterpret_cast<const uchar*>(src.data()), static_cast<int>(src.size()));
+	if (static_cast<size_t>(data.size()) != tile_bytes)
+		throw DegateRuntimeException("A tile of the compressed tile pack file " + filename + " is corrupted.");
+
+	const uint8_t* in = reinterpret_cast<const uint8_t*>(data.constData());
+	const size_t pixels = tile_bytes / pixel_size;
+	for (unsigned int plane = 0; plane < pixel_size; plane++)
+	{
+		uint8_t v = 0;
+		for (size_t i = 0; i < pixels; i++)
+		{
+			v = static_cast<uint8_t>(v + in[plane * pixels + i]);
+			dst[i * pixel_size + plane] = v;
+		}
+	}
+}
+
+void CompressedTilePack::read_tile(unsigned int tile_x, unsigned int tile_y, void* dst)
+{
+	tile_t tile(tile_x, tile_y);
+	size_t i = get_index(tile);
+	index_entry entry;
+
+	{
+		boost::mutex::scoped_lock lock(mutex);
+
+		auto p = pending.find(tile);
+		if (p != pending.end())
+		{
+			memcpy(dst, p->second->data(), tile_bytes);
+			return;
+		}
+
+		auto w = failed.find(tile);
+		if (w != failed.end())
+		{
+			memcpy(dst, w->second->data(), tile_bytes);
+			return;
+		}
+
+		auto f = prefetched.find(tile);
+		if (f != prefetched.end())
+		{
+			memcpy(dst, f->second->data(), tile_bytes);
+			prefetched.erase(f);
+			prefetched_order.remove(tile);
+			return;
+		}
+
+		entry = index[i];
+	}
+
+	if (entry.size == 0)
+	{
+		memset(dst, 0, tile_bytes);
+		return;
+	}
+
+	// Data in the file is never overwritten while the file is open, so the entry stays valid.
+	std::vector<uint8_t> compressed(entry.size);
+	{
+		boost::mutex::scoped_lock lock(file_mutex);
+		file.seekg(static_cast<std::streamoff>(entry.offset));
+		if (!file.read(reinterpret_cast<char*>(compressed.data()), entry.size))
+		{
+			file.clear();
+			throw DegateRuntimeException("Can't read a tile of the compressed tile pack file " + filename);
+		}
+	}
+
+	decode(compressed, static_cast<uint8_t*>(dst));
+}
+
+void CompressedTilePack::write_tile(unsigned int tile_x, unsigned int tile_y, void const* src)
+{
+	tile_t tile(tile_x, tile_y);
+	get_index(tile);
+
+	buffer_shptr data = std::make_shared<std::vector<uint8_t>>(static_cast<uint8_t const*>(src),
+	                                                           static_cast<uint8_t const*>(src) + tile_bytes);
+
+	boost::mutex::scoped_lock lock(mutex);
+
+	while (pending.size() >= COMPRESSED_TILE_PACK_MAX_PENDING && pending.find(tile) == pending.end())
+		condition.wait(lock);
+
+	// A newer version replaces the pending one, a prefetched version is outdated.
+	pending[tile] = data;
+	failed.erase(tile);
+	if (prefetched.erase(tile) > 0)
+		prefetched_order.remove(tile);
+
+	tasks.push_back(task{true, tile, data});
+	condition.notify_all();
+}
+
+void CompressedTilePack::prefetch(unsigned int tile_x, unsigned int tile_y)
+{
+	if (tile_x >= tiles_x || tile_y >= tiles_y)
+		return;
+
+	tile_t tile(tile_x, tile_y);
+
+	boost::mutex::scoped_lock lock(mutex);
+
+	if (index[get_index(tile)].size == 0 ||
+		pending.find(tile) != pending.end() ||
+		failed.find(tile) != failed.end() ||
+		prefetched.find(tile) != prefetched.end() ||
+		prefetch_requested.find(tile) != prefetch_requested.end())
+	{
+		return;
+	}
+
+	prefetch_requested.insert(tile);
+	tasks.push_back(task{false, tile, buffer_shptr()});
+	condition.notify_all();
+}
+
+void CompressedTilePack::run()
+{
+	boost::mutex::scoped_lock lock(mutex);
+
+	while (true)
+	{
+		while (tasks.empty() && !stop_requested)
+			condition.wait(lock);
+
+		if (tasks.empty())
+			break;
+
+		task t = tasks.front();
+		tasks.pop_front();
+		active_tasks++;
+
+		try
+		{
+			if (t.write)
+			{
+				// Skip outdated versions.
+				auto current = pending.find(t.tile);
+				if (current != pending.end() && current->second == t.data)
+				{
+					lock.unlock();
+
+					std::vector<uint8_t> compressed;
+					encode(t.data->data(), compressed);
+
+					lock.lock();
+					uint64_t offset = file_end;
+					file_end += compressed.size();
+					lock.unlock();
+
+					bool written;
+					{
+						boost::mutex::scoped_lock file_lock(file_mutex);
+						file.seekp(static_cast<std::streamoff>(offset));
+						// Flush, so that errors show up before the index refers to the tile.
+						written = static_cast<bool>(file.write(reinterpret_cast<const char*>(compressed.data()),
+						                                       compressed.size()).flush());
+						if (!written)
+							file.clear();
+					}
+
+					lock.lock();
+
+					index_entry& entry = index[get_index(t.tile)];
+					auto p = pending.find(t.tile);
+
+					if (!written)
+					{
+						// Keep the tile in memory, flush() reports the error.
+						debug(TM, "Can't write a tile to the compressed tile pack file %s", filename.c_str());
+						write_error = "Can't write a tile to the compressed tile pack file " + filename;
+						unused_bytes += compressed.size();
+
+						if (p != pending.end() && p->second == t.data)
+						{
+							failed[t.tile] = t.data;
+							pending.erase(p);
+						}
+					}
+					else if (p != pending.end() && p->second == t.data)
+					{
+						unused_bytes += entry.size;
+						entry.offset = offset;
+						entry.size = static_cast<uint32_t>(compressed.size());
+						index_modified = true;
+						pending.erase(p);
+					}
+					else
+						unused_bytes += compressed.size();
+				}
+			}
+			else
+			{
+				index_entry entry = index[get_index(t.tile)];
+				lock.unlock();
+
+				buffer_shptr data = std::make_shared<std::vector<uint8_t>>(tile_bytes);
+				std::vector<uint8_t> compressed(entry.size);
+				{
+					boost::mutex::scoped_lock file_lock(file_mutex);
+					file.seekg(static_cast<std::streamoff>(entry.offset));
+					file.read(reinterpret_cast<char*>(compressed.data()), entry.size);
+					if (!file) file.clear();
+				}
+				decode(compressed, data->data());
+
+				lock.lock();
+
+				// The tile might have been written in the meantime.
+				if (pending.find(t.tile) == pending.end() && failed.find(t.tile) == failed.end() &&
+				    index[get_index(t.tile)].offset == entry.offset)
+				{
+					prefetched[t.tile] = data;
+					prefetched_order.push_back(t.tile);
+
+					while (prefetched_order.size() > COMPRESSED_TILE_PACK_MAX_PREFETCHED)
+					{
+						prefetched.erase(prefetched_order.front());
+						prefetched_order.pop_front();
+					}
+				}
+			}
+		}
+		catch (std::exception const& e)
+		{
+			if (!lock.owns_lock()) lock.lock();
+			debug(TM, "A compressed tile pack task failed: %s", e.what());
+		}
+
+		if (!t.write)
+			prefetch_requested.erase(t.tile);
+
+		active_tasks--;
+		condition.notify_all();
+	}
+}
+
+void CompressedTilePack::flush()
+{
+	boost::mutex::scoped_lock lock(mutex);
+
+	while (!tasks.empty() || active_tasks > 0)
+		condition.wait(lock);
+
+	// Try once more to write tiles that could not be written (e.g. the disk was full).
+	if (!failed.empty())
+	{
+		for (auto const& f : failed)
+		{
+			pending[f.first] = f.second;
+			tasks.push_back(task{true, f.first, f.second});
+		}
+
+		failed.clear();
+		write_error.clear();
+		condition.notify_all();
+
+		while (!tasks.empty() || active_tasks > 0)
+			condition.wait(lock);
+	}
+
+	if (!write_error.empty())
+		throw DegateRuntimeException(write_error);
+
+	if (!pending.empty() || !failed.empty())
+		throw DegateRuntimeException("Failed to write all tiles to the compressed tile pack file " + filename);
+
+	if (index_modified)
+	{
+		write_index();
+		index_modified = false;
+	}
+}
+
+uint64_t CompressedTilePack::get_compressed_size()
+{
+	boost::mutex::scoped_lock lock(mutex);
+	return file_end - unused_bytes;
+}
+
+void CompressedTilePack::write_index()
+{
+	header hdr;
+	hdr.magic = COMPRESSED_TILE_PACK_MAGIC;
+	hdr.version = COMPRESSED_TILE_PACK_VERSION;
+	hdr.tile_width_exp = tile_width_exp;
+	hdr.pixel_size = pixel_size;
+	hdr.tiles_x = tiles_x;
+	hdr.tiles_y = tiles_y;
+	hdr.reserved = 0;
+
+	boost::mutex::scoped_lock file_lock(file_mutex);
+
+	file.seekp(0);
+	file.write(reinterpret_cast<const char*>(&hdr), sizeof(header));
+	file.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(index_entry));
+	file.flush();
+
+	if (!file)
+	{
+		file.clear();
+		throw DegateRuntimeException("Can't write the index of the compressed tile pack file " + filename);
+	}
+}
+
+void CompressedTilePack::compact()
+{
+	// Copy the used tiles into a new file, then replace the old one.
+	std::string temp_filename = filename + ".tmp";
+	std::ofstream out(temp_filename.c_str(), std::ios::binary | std::ios::trunc);
+
+	std::vector<index_entry> new_index(index.size(), index_entry{0, 0, 0});
+	uint64_t offset = sizeof(header) + index.size() * sizeof(index_entry);
+
+	out.seekp(static_cast<std::streamoff>(offset));
+
+	std::vector<char> data;
+	for (size_t i = 0; i < index.size(); i++)
+	{
+		if (index[i].size == 0)
+			continue;
+
+		data.resize(index[i].size);
+		file.seekg(static_cast<std::streamoff>(index[i].offset));
+		file.read(data.data(), data.size());
+		out.write(data.data(), data.size());
+
+		new_index[i].offset = offset;
+		new_index[i].size = index[i].size;
+		offset += index[i].size;
+	}
+
+	if (!file || !out)
+	{
+		out.close();
+		remove_file(temp_filename);
+		throw DegateRuntimeException("Can't compact the compressed tile pack file " + filename);
+	}
+
+	file.close();
+	index.swap(new_index);
+	file_end = offset;
+	unused_bytes = 0;
+
+	out.close();
+	file.open(temp_filename.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+	write_index();
+	file.close();
+
+	move_file(temp_filename, filename);
+}
+
+bool CompressedTilePack::is_compressed_tile_pack_directory(std::string const& directory)
+{
+	return file_exists(join_pathes(directory, COMPRESSED_TILE_PACK_FILENAME));
+}
+
+unsigned int CompressedTilePack::convert_directory(std::string const& directory, unsigned int pixel_size,
+                                                   bool recursive)
+{
+	unsigned int converted = 0;
+
+	if (recursive)
+	{
+		for (std::string const& path : read_directory(directory, true))
+			if (is_directory(path))
+				converted += convert_directory(path, pixel_size, true);
+	}
+
+	if (is_compressed_tile_pack_directory(directory))
+		return converted;
+
+	// Tile files are converted to a tile pack first, that also gives us the tile layout.
+	if (TilePack::is_tile_file_directory(directory))
+		TilePack::convert_directory(directory, pixel_size, false);
+
+	if (!TilePack::is_tile_pack_directory(directory))
+		return converted;
+
+	std::string pack_filename = join_pathes(directory, TILE_PACK_FILENAME);
+	std::string compressed_filename = join_pathes(directory, COMPRESSED_TILE_PACK_FILENAME);
+	std::string temp_filename = compressed_filename + ".tmp";
+	remove_file(temp_filename);
+
+	{
+		unsigned int tile_width_exp = 0;
+		unsigned int tiles_x = 0;
+		unsigned int tiles_y = 0;
+		TilePack::get_layout(pack_filename, tile_width_exp, tiles_x, tiles_y, pixel_size);
+
+		debug(TM, "Compress %d tiles in %s.", (int)(tiles_x * tiles_y), directory.c_str());
+
+		TilePack pack(pack_filename, tile_width_exp, tiles_x, tiles_y, pixel_size, false);
+		CompressedTilePack compressed(temp_filename, tile_width_exp, tiles_x, tiles_y, pixel_size);
+
+		for (unsigned int y = 0; y < tiles_y; y++)
+			for (unsigned int x = 0; x < tiles_x; x++)
+			{
+				// Tiles that were never written are not stored.
+				const uint8_t* data = static_cast<const uint8_t*>(pack.get_tile(x, y));
+				if (std::any_of(data, data + pack.get_tile_bytes(), [](uint8_t v) { return v != 0; }))
+					compressed.write_tile(x, y, data);
+				pack.release_tile(x, y);
+			}
+
+		compressed.flush();
+	}
+
+	move_file(temp_filename, compressed_filename);
+	remove_file(pack_filename);
+
+	return converted + 1;
+}
@@ -0,0 +1,250 @@
+/* -*-c++-*-
+
+ This file is part of the IC reverse engineering tool degate.
+
+ Copyright 2008, 2009, 2010 by Martin Schobert
+
+ Degate is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ any later version.
+
+ Degate is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#ifndef __COMPRESSEDTILEPACK_H__
+#define __COMPRESSEDTILEPACK_H__
+
+#include "Prerequisites.h"
+#include "Globals.h"
+
+#include <string>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <map>
+#include <set>
+#include <deque>
+#include <list>
+#include <fstream>
+
+#include <boost/utility.hpp>
+#include <boost/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+/**
+ * The name of the file that holds all compressed tiles of a tile based image.
+ */
+#define COMPRESSED_TILE_PACK_FILENAME "tiles.zpack"
+
+#define COMPRESSED_TILE_PACK_MAGIC 0x5a544744 // "DGTZ"
+#define COMPRESSED_TILE_PACK_VERSION 1
+
+/**
+ * The zlib compression level. Tiles are written often, so favour speed.
+ */
+#define COMPRESSED_TILE_PACK_LEVEL 1
+
+/**
+ * The maximum number of compression threads.
+ */
+#define COMPRESSED_TILE_PACK_MAX_THREADS 4
+
+/**
+ * The maximum number of tiles that wait for compression. Writers block if
+ * there are more, so that memory usage is bounded.
+ */
+#define COMPRESSED_TILE_PACK_MAX_PENDING 16
+
+/**
+ * The maximum number of tiles that are decompressed ahead of time.
+ */
+#define COMPRESSED_TILE_PACK_MAX_PREFETCHED 8
+
+namespace degate
+{
+	/**
+	 * A single file that stores all tiles of a tile based image in compressed form.
+	 *
+	 * The file starts with a header and an index with file offset and size of each
+	 * tile, followed by the compressed tile data. Before compression with zlib the
+	 * bytes of a tile are split into one plane per pixel byte and delta coded, which
+	 * works well for the smooth content of die shots.
+	 *
+	 * Written tiles are compressed on worker threads and appended to the file. Tiles
+	 * can be prefetched, they are then decompressed on a worker thread and handed out
+	 * by the next read_tile() call. Space of overwritten tiles is reclaimed when the
+	 * file is closed.
+	 *
+	 * The object is thread safe.
+	 */
+	class CompressedTilePack : boost::noncopyable
+	{
+	public:
+
+		/**
+		 * Open or create a compressed tile pack file.
+		 * @param filename The path of the file.
+		 * @param tile_width_exp The width and height of a tile as exponent to the base 2.
+		 * @param tiles_x The number of tiles in a row.
+		 * @param tiles_y The number of tiles in a column.
+		 * @param pixel_size The size of a pixel in bytes.
+		 * @exception DegateRuntimeException This exception is thrown if the file cannot be
+		 *   opened or if an existing file has a different tile layout.
+		 */
+		CompressedTilePack(std::string const& filename,
+		                   unsigned int tile_width_exp,
+		                   unsigned int tiles_x, unsigned int tiles_y,
+		                   unsigned int pixel_size);
+
+		/**
+		 * Write all pending tiles, reclaim unused space and close the file.
+		 */
+		~CompressedTilePack();
+
+		/**
+		 * Read and decompress a tile. Tiles that were never written are zero.
+		 * @param tile_x The tile column.
+		 * @param tile_y The tile row.
+		 * @param dst A buffer of get_tile_bytes() bytes.
+		 */
+		void read_tile(unsigned int tile_x, unsigned int tile_y, void* dst);
+
+		/**
+		 * Write a tile. The data is copied and compressed on a worker thread.
+		 * @param tile_x The tile column.
+		 * @param tile_y The tile row.
+		 * @param src A buffer of get_tile_bytes() bytes.
+		 */
+		void write_tile(unsigned int tile_x, unsigned int tile_y, void const* src);
+
+		/**
+		 * Decompress a tile on a worker thread, it will be read soon.
+		 * Requests for tiles that are out of range are ignored.
+		 */
+		void prefetch(unsigned int tile_x, unsigned int tile_y);
+
+		/**
+		 * Wait for all pending tiles and write the index.
+		 * Tiles that could not be written are kept in memory and written again.
+		 * @exception DegateRuntimeException This exception is thrown if tiles could not be written.
+		 */
+		void flush();
+
+		/**
+		 * Get the size of a tile in bytes.
+		 */
+		size_t get_tile_bytes() const { return tile_bytes; }
+
+		/**
+		 * Get the size of the compressed data of all tiles.
+		 */
+		uint64_t get_compressed_size();
+
+		std::string const& get_filename() const { return filename; }
+
+		/**
+		 * Check if a directory holds a compressed tile pack file.
+		 */
+		static bool is_compressed_tile_pack_directory(std::string const& directory);
+
+		/**
+		 * Convert a directory with a tile pack file or with one file per tile (N_M.dat)
+		 * into a compressed tile pack file. The old files are removed after the conversion.
+		 * @param directory The image directory.
+		 * @param pixel_size The size of a pixel in bytes.
+		 * @param recursive If true, image directories within the directory are converted, too.
+		 * @return Returns the number of converted directories.
+		 */
+		static unsigned int convert_directory(std::string const& directory,
+		                                      unsigned int pixel_size = 4,
+		                                      bool recursive = true);
+
+	private:
+
+		struct header
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint32_t tile_width_exp;
+			uint32_t pixel_size;
+			uint32_t tiles_x;
+			uint32_t tiles_y;
+			uint64_t reserved;
+		};
+
+		struct index_entry
+		{
+			uint64_t offset;
+			uint32_t size;
+			uint32_t reserved;
+		};
+
+		typedef std::shared_ptr<std::vector<uint8_t>> buffer_shptr;
+		typedef std::pair<unsigned int, unsigned int> tile_t;
+
+		struct task
+		{
+			bool write;
+			tile_t tile;
+			buffer_shptr data;
+		};
+
+		void run();
+		void write_index();
+		void compact();
+		size_t get_index(tile_t const& tile) const;
+
+		void encode(uint8_t const* src, std::vector<uint8_t>& dst) const;
+		void decode(std::vector<uint8_t> const& src, uint8_t* dst) const;
+
+	private:
+
+		std::string filename;
+		unsigned int tile_width_exp;
+		unsigned int tiles_x, tiles_y;
+		unsigned int pixel_size;
+		size_t tile_bytes;
+
+		std::fstream file;
+		boost::mutex file_mutex;
+
+		// Protects everything below.
+		boost::mutex mutex;
+		boost::condition_variable condition;
+
+		std::vector<index_entry> index;
+		uint64_t file_end;
+		uint64_t unused_bytes;
+		bool index_modified;
+
+		std::deque<task> tasks;
+		unsigned int active_tasks;
+		std::map<tile_t, buffer_shptr> pending;
+
+		// Tiles that could not be written and the last write error (@see flush()).
+		std::map<tile_t, buffer_shptr> failed;
+		std::string write_error;
+
+		std::map<tile_t, buffer_shptr> prefetched;
+		std::list<tile_t> prefetched_order;
+		std::set<tile_t> prefetch_requested;
+
+		bool stop_requested;
+		boost::thread_group workers;
+	};
+
+	typedef std::shared_ptr<CompressedTilePack> CompressedTilePack_shptr;
+}
+
+#endif
@@ -26,23 +26,40 @@
 #include <Core/Utils/DegateExceptions.h>
 #include <Core/Image/TypeConstraints.h>
 #include <Core/Image/Manipulation/ImageManipulation.h>
+#include <Core/Utils/ParallelFor.h>
 
 #include <fstream>
 #include <iostream>
+#include <vector>
+#include <cmath>
 #include <boost/format.hpp>
+#include <boost/thread.hpp>
 
 namespace degate
 {
+	/**
+	 * Fixed-bin histogram over image values.
+	 *
+	 * The counts are stored in an array with one entry per class. The class of a
+	 * value is computed arithmetically from the lower bound and the class width,
+	 * so adding a value is O(1).
+	 */
 	template <typename KeyType, typename ValueType>
 	class ImageHistogram
 	{
 	private:
-		typedef std::map<KeyType, ValueType> map_type;
-		map_type histogram;
-		unsigned int counts;
+		typedef std::vector<size_t> bins_type;
+		bins_type bins;
+		size_t counts;
 
 		double from, to, class_width;
 
+		/**
+		 * Minimal number of rows a worker thread has to process in add_area(),
+		 * otherwise the area is processed in the calling thread.
+		 */
+		static const unsigned int min_rows_per_thread = 64;
+
 	protected:
 
 		void check_bounding_box(BoundingBox const& bb, ImageBase_shptr img) const
@@ -61,18 +78,95 @@ namespace degate
 				throw DegateRuntimeException("Bounding box has zero size");
 		}
 
-		KeyType to_class(ValueType v, ValueType from, ValueType to, ValueType class_width) const
+		/**
+		 * Get the class (bin index) of a value. Values outside of the histogram
+		 * range are put into the first or the last class.
+		 */
+		inline unsigned int to_class(KeyType v) const
+		{
+			if (v <= from) return 0;
+
+			double c = (v - from) / class_width;
+			if (c >= bins.size()) return bins.size() - 1;
+			else return static_cast<unsigned int>(c);
+		}
+
+		/**
+		 * Add all pixels of the rows \p min_y to \p max_y (inclusive) of an area to \p dst_bins.
+		 *
+		 * Each row is copied with raw_copy_row(), so tiles are accessed once per row and
+		 * not once per pixel.
+		 */
+		template <class ImageType, class EvaluateFunc>
+		void add_rows(std::shared_ptr<ImageType> img,
+		              unsigned int min_x, unsigned int max_x,
+		              unsigned int min_y, unsigned int max_y,
+		              bins_type& dst_bins) const
 		{
-			//unsigned int classes = (to - from) / class_width;
-			//unsigned int class_num = v / class_width;
-			//KeyType cl = v * class_width;
+			unsigned int width = max_x - min_x + 1;
+			std::vector<typename ImageType::pixel_type> row(width);
+
+			for (unsigned int y = min_y; y <= max_y; y++)
+			{
+				img->raw_copy_row(&row[0], min_x, y, width);
+
+				for (unsigned int x = 0; x < width; x++)
+					dst_bins[to_class(EvaluateFunc::func(row[x]))]++;
+			}
+		}
 
-			unsigned int c = 0;
-			for (ValueType i = from; i < to; i += class_width, c++)
+		/**
+		 * Add all pixels of an image area to the histogram. The value of a pixel
+		 * is calculated via \p EvaluateFunc::func().
+		 *
+		 * Large areas are split into bands of rows. Each band is processed by its own
+		 * thread into a partial histogram and the partial histograms are merged afterwards.
+		 */
+		template <class ImageType, class EvaluateFunc>
+		void add_area(std::shared_ptr<ImageType> img, BoundingBox const& bb)
+		{
+			check_bounding_box(bb, img);
+
+			unsigned int min_x = (unsigned int)bb.get_min_x(), max_x = (unsigned int)bb.get_max_x();
+			unsigned int min_y = (unsigned int)bb.get_min_y(), max_y = (unsigned int)bb.get_max_y();
+			unsigned int rows = max_y - min_y + 1;
+
+			unsigned int threads = std::min(std::max(boost::thread::hardware_concurrency(), 1u),
+			                                std::max(rows / min_rows_per_thread, 1u));
+
+			if (threads == 1)
+			{
+				add_rows<ImageType, EvaluateFunc>(img, min_x, max_x, min_y, max_y, bins);
+			}
+			else
 			{
-				if (v >= (ValueType)c * class_width && v < (ValueType)(c + 1) * class_width)
-					return (ValueType)c * class_width;
+				std::vector<bins_type> partial_bins(threads, bins_type(bins.size(), 0));
+
+				unsigned int rows_per_thread = rows / threads;
+
+				parallel_for(threads, [&](size_t i)
+				{
+					unsigned int band_min_y = min_y + i * rows_per_thread;
+					unsigned int band_max_y = i + 1 == threads ? max_y : band_min_y + rows_per_thread - 1;
+
+					add_rows<ImageType, EvaluateFunc>(img, min_x, max_x, band_min_y, band_max_y, partial_bins[i]);
+				}, threads);
+
+				for (unsigned int i = 0; i < threads; i++)
+					merge_bins(partial_bins[i]);
 			}
+
+			counts += (size_t)(max_x - min_x + 1) * rows;
+		}
+
+	private:
+
+		void merge_bins(bins_type const& other_bins)
+		{
+			assert(other_bins.size() == bins.size());
+
+			for (unsigned int c = 0; c < bins.size(); c++)
+				bins[c] += other_bins[c];
 		}
 
 	public:
@@ -83,6 +177,12 @@ namespace degate
 			to(_to),
 			class_width(_class_width)
 		{
+			assert(_to > _from && _class_width > 0);
+
+			// The range is inclusive, \p _to gets its own class.
+			// Add a small epsilon, else rounding errors may drop the last class.
+			unsigned int classes = static_cast<unsigned int>(std::floor((_to - _from) / _class_width + 1e-9)) + 1;
+			bins.resize(classes, 0);
 		}
 
 		virtual ~ImageHistogram()
@@ -91,34 +191,52 @@ namespace degate
 
 		virtual void add(KeyType k)
 		{
-			histogram[to_class(k, from, to, class_width)] += 1;
+			bins[to_class(k)] += 1;
 			counts++;
 		}
 
 		virtual ValueType get(KeyType k) const
 		{
 			if (counts == 0) return 0;
-
-			else
-			{
-				typename map_type::const_iterator found = histogram.find(to_class(k, from, to, class_width));
-				if (found == histogram.end()) return 0;
-				else return (*found).second / (double)counts;
-			}
+			else return bins[to_class(k)] / (double)counts;
 		}
 
 		virtual ValueType get_for_rgb(rgba_pixel_t) const = 0;
 
+		/**
+		 * Merge the counts of another histogram into this histogram. Both
+		 * histograms must have the same range and class width. This can be
+		 * used to combine partial histograms, which were filled by different threads.
+		 */
+		void merge(ImageHistogram const& other)
+		{
+			if (from != other.from || to != other.to || class_width != other.class_width)
+				throw DegateRuntimeException("Can't merge histograms with different classes.");
+
+			merge_bins(other.bins);
+			counts += other.counts;
+		}
+
+		/**
+		 * Get the total number of values, that were added to the histogram.
+		 */
+		size_t get_counts() const
+		{
+			return counts;
+		}
+
 		virtual void save_histogram(std::string const& path) const
 		{
 			std::ofstream histogram_file;
 			histogram_file.open(path.c_str());
 
 			if (counts > 0)
-				for (typename map_type::const_iterator iter = histogram.begin(); iter != histogram.end(); ++iter)
+				for (unsigned int c = 0; c < bins.size(); c++)
 				{
-					double frequency = (*iter).second / (double)counts;
-					histogram_file << (*iter).first << " " << frequency << std::endl;
+					if (bins[c] == 0) continue;
+
+					double frequency = bins[c] / (double)counts;
+					histogram_file << from + c * class_width << " " << frequency << std::endl;
 				}
 
 			histogram_file.close();
@@ -128,6 +246,12 @@ namespace degate
 
 	class HueImageHistogram : public ImageHistogram<double, double>
 	{
+	private:
+		struct rgba_to_hue_calculation
+		{
+			static double func(rgba_pixel_t pix) { return rgba_to_hue(pix); }
+		};
+
 	public:
 
 		HueImageHistogram() : ImageHistogram<double, double>(0, 360, 1)
@@ -138,11 +262,7 @@ namespace degate
 		void add_area(std::shared_ptr<ImageType> img, BoundingBox const& bb)
 		{
 			assert_is_multi_channel_image<ImageType>();
-			check_bounding_box(bb, img);
-
-			for (unsigned int y = (unsigned int)bb.get_min_y(); y <= (unsigned int)bb.get_max_y(); y++)
-				for (unsigned int x = (unsigned int)bb.get_min_x(); x <= (unsigned int)bb.get_max_x(); x++)
-					add(rgba_to_hue(img->get_pixel(x, y)));
+			ImageHistogram<double, double>::add_area<ImageType, rgba_to_hue_calculation>(img, bb);
 		}
 
 
@@ -155,6 +275,12 @@ namespace degate
 
 	class SaturationImageHistogram : public ImageHistogram<double, double>
 	{
+	private:
+		struct rgba_to_sat_calculation
+		{
+			static double func(rgba_pixel_t pix) { return rgba_to_saturation(pix); }
+		};
+
 	public:
 
 		SaturationImageHistogram() : ImageHistogram<double, double>(0, 1, 0.01)
@@ -165,11 +291,7 @@ namespace degate
 		void add_area(std::shared_ptr<ImageType> img, BoundingBox const& bb)
 		{
 			assert_is_multi_channel_image<ImageType>();
-			check_bounding_box(bb, img);
-
-			for (unsigned int y = (unsigned int)bb.get_min_y(); y <= (unsigned int)bb.get_max_y(); y++)
-				for (unsigned int x = (unsigned int)bb.get_min_x(); x <= (unsigned int)bb.get_max_x(); x++)
-					add(rgba_to_saturation(img->get_pixel(x, y)));
+			ImageHistogram<double, double>::add_area<ImageType, rgba_to_sat_calculation>(img, bb);
 		}
 
 		virtual double get_for_rgb(rgba_pixel_t pixel) const
@@ -180,6 +302,12 @@ namespace degate
 
 	class LightnessImageHistogram : public ImageHistogram<double, double>
 	{
+	private:
+		struct rgba_to_lightness_calculation
+		{
+			static double func(rgba_pixel_t pix) { return rgba_to_lightness(pix); }
+		};
+
 	public:
 
 		LightnessImageHistogram() : ImageHistogram<double, double>(0, 255, 1)
@@ -190,11 +318,7 @@ namespace degate
 		void add_area(std::shared_ptr<ImageType> img, BoundingBox const& bb)
 		{
 			assert_is_multi_channel_image<ImageType>();
-			check_bounding_box(bb, img);
-
-			for (unsigned int y = (unsigned int)bb.get_min_y(); y <= (unsigned int)bb.get_max_y(); y++)
-				for (unsigned int x = (unsigned int)bb.get_min_x(); x <= (unsigned int)bb.get_max_x(); x++)
-					add(rgba_to_lightness(img->get_pixel(x, y)));
+			ImageHistogram<double, double>::add_area<ImageType, rgba_to_lightness_calculation>(img, bb);
 		}
 
 		virtual double get_for_rgb(rgba_pixel_t pixel) const
@@ -206,6 +330,12 @@ namespace degate
 
 	class RedChannelImageHistogram : public ImageHistogram<double, double>
 	{
+	private:
+		struct red_channel_calculation
+		{
+			static double func(rgba_pixel_t pix) { return MASK_R(pix); }
+		};
+
 	public:
 
 		RedChannelImageHistogram() : ImageHistogram<double, double>(0, 255, 1)
@@ -216,12 +346,7 @@ namespace degate
 		void add_area(std::shared_ptr<ImageType> img, BoundingBox const& bb)
 		{
 			assert_is_multi_channel_image<ImageType>();
-			check_bounding_box(bb, img);
-
-			for (unsigned int y = (unsigned int)bb.get_min_y(); y <= (unsigned int)bb.get_max_y(); y++)
-				for (unsigned int x = (unsigned int)bb.get_min_x(); x <= (unsigned int)bb.get_max_x(); x++)
-
-					add(MASK_R(img->get_pixel(x, y)));
+			ImageHistogram<double, double>::add_area<ImageType, red_channel_calculation>(img, bb);
 		}
 
 
@@ -234,6 +359,12 @@ namespace degate
 
 	class GreenChannelImageHistogram : public ImageHistogram<double, double>
 	{
+	private:
+		struct green_channel_calculation
+		{
+			static double func(rgba_pixel_t pix) { return MASK_G(pix); }
+		};
+
 	public:
 
 		GreenChannelImageHistogram() : ImageHistogram<double, double>(0, 255, 1)
@@ -244,11 +375,7 @@ namespace degate
 		void add_area(std::shared_ptr<ImageType> img, BoundingBox const& bb)
 		{
 			assert_is_multi_channel_image<ImageType>();
-			check_bounding_box(bb, img);
-
-			for (unsigned int y = (unsigned int)bb.get_min_y(); y <= (unsigned int)bb.get_max_y(); y++)
-				for (unsigned int x = (unsigned int)bb.get_min_x(); x <= (unsigned int)bb.get_max_x(); x++)
-					add(MASK_G(img->get_pixel(x, y)));
+			ImageHistogram<double, double>::add_area<ImageType, green_channel_calculation>(img, bb);
 		}
 
 		virtual double get_for_rgb(rgba_pixel_t pixel) const
@@ -260,6 +387,12 @@ namespace degate
 
 	class BlueChannelImageHistogram : public ImageHistogram<double, double>
 	{
+	private:
+		struct blue_channel_calculation
+		{
+			static double func(rgba_pixel_t pix) { return MASK_B(pix); }
+		};
+
 	public:
 
 		BlueChannelImageHistogram() : ImageHistogram<double, double>(0, 255, 1)
@@ -270,11 +403,7 @@ namespace degate
 		void add_area(std::shared_ptr<ImageType> img, BoundingBox const& bb)
 		{
 			assert_is_multi_channel_image<ImageType>();
-			check_bounding_box(bb, img);
-
-			for (unsigned int y = (unsigned int)bb.get_min_y(); y <= (unsigned int)bb.get_max_y(); y++)
-				for (unsigned int x = (unsigned int)bb.get_min_x(); x <= (unsigned int)bb.get_max_x(); x++)
-					add(MASK_B(img->get_pixel(x, y)));
+			ImageHistogram<double, double>::add_area<ImageType, blue_channel_calculation>(img, bb);
 		}
 
 		virtual double get_for_rgb(rgba_pixel_t pixel) const
@@ -0,0 +1,494 @@
+/* -*-c++-*-
+
+ This file is part of the IC reverse engineering tool degate.
+
+ Copyright 2008, 2009, 2010 by Martin Schobert
+
+ Degate is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ any later version.
+
+ Degate is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "Core/Image/Manipulation/ImageRegistration.h"
+#include "Core/Utils/ParallelFor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+
+using namespace degate;
+
+typedef std::complex<double> complex_type;
+
+/**
+ * In place radix-2 FFT of \p n values (n is a power of two).
+ */
+static void fft(complex_type* data, unsigned int n, bool inverse)
+{
+	// bit reversal permutation
+	for (unsigned int i = 1, j = 0; i < n; i++)
+	{
+		unsigned int bit = n >> 1;
+		for (; j & bit; bit >>= 1)
+			j ^= bit;
+		j ^= bit;
+
+		if (i < j)
+			std::swap(data[i], data[j]);
+	}
+
+	for (unsigned int len = 2; len <= n; len <<= 1)
+	{
+		const double angle = (inverse ? 2.0 : -2.0) * M_PI / len;
+
+		for (unsigned int k = 0; k < len / 2; k++)
+		{
+			const complex_type w(cos(angle * k), sin(angle * k));
+
+			for (unsigned int i = 0; i < n; i += len)
+			{
+				const complex_type u = data[i + k];
+				const complex_type v = data[i + k + len / 2] * w;
+				data[i + k] = u + v;
+				data[i + k + len / 2] = u - v;
+			}
+		}
+	}
+
+	if (inverse)
+	{
+		for (unsigned int i = 0; i < n; i++)
+			data[i] /= n;
+	}
+}
+
+/**
+ * In place 2D FFT of \p size * \p size values, row after row.
+ */
+static void fft_2d(std::vector<complex_type>& data, unsigned int size, bool inverse)
+{
+	for (unsigned int y = 0; y < size; y++)
+		fft(&data[static_cast<size_t>(y) * size], size, inverse);
+
+	std::vector<complex_type> column(size);
+
+	for (unsigned int x = 0; x < size; x++)
+	{
+		for (unsigned int y = 0; y < size; y++)
+			column[y] = data[static_cast<size_t>(y) * size + x];
+
+		fft(column.data(), size, inverse);
+
+		for (unsigned int y = 0; y < size; y++)
+			data[static_cast<size_t>(y) * size + x] = column[y];
+	}
+}
+
+/**
+ * Subtract the mean and apply a Hann window, to suppress the image borders.
+ */
+static void prepare_window(std::vector<float> const& pixels, unsigned int size, std::vector<complex_type>& out)
+{
+	double mean = 0;
+	for (float p : pixels)
+		mean += p;
+	mean /= pixels.size();
+
+	std::vector<double> hann(size);
+	for (unsigned int i = 0; i < size; i++)
+		hann[i] = 0.5 - 0.5 * cos(2.0 * M_PI * i / (size - 1));
+
+	out.resize(pixels.size());
+
+	for (unsigned int y = 0; y < size; y++)
+		for (unsigned int x = 0; x < size; x++)
+		{
+			const size_t i = static_cast<size_t>(y) * size + x;
+			out[i] = complex_type((pixels[i] - mean) * hann[x] * hann[y], 0);
+		}
+}
+
+/**
+ * Get the subpixel offset of a peak from its neighbours (parabola fit).
+ */
+static double get_subpixel_offset(double left, double center, double right)
+{
+	const double denominator = left - 2 * center + right;
+	if (denominator >= 0)
+		return 0;
+
+	return std::max(-0.5, std::min(0.5, 0.5 * (left - right) / denominator));
+}
+
+double degate::phase_correlation(std::vector<float> const& reference, std::vector<float> const& moving,
+                                 unsigned int size, double* dx, double* dy)
+{
+	assert(size > 1 && (size & (size - 1)) == 0);
+	assert(reference.size() == static_cast<size_t>(size) * size);
+	assert(moving.size() == reference.size());
+
+	std::vector<complex_type> f_ref, f_mov;
+	prepare_window(reference, size, f_ref);
+	prepare_window(moving, size, f_mov);
+
+	fft_2d(f_ref, size, false);
+	fft_2d(f_mov, size, false);
+
+	// normalized cross power spectrum
+	for (size_t i = 0; i < f_ref.size(); i++)
+	{
+		const complex_type r = f_mov[i] * std::conj(f_ref[i]);
+		const double magnitude = std::abs(r);
+		f_ref[i] = magnitude > 1e-12 ? r / magnitude : complex_type(0, 0);
+	}
+
+	fft_2d(f_ref, size, true);
+
+	size_t peak = 0;
+	for (size_t i = 1; i < f_ref.size(); i++)
+	{
+		if (f_ref[i].real() > f_ref[peak].real())
+			peak = i;
+	}
+
+	const unsigned int px = peak % size, py = peak / size;
+	const unsigned int mask = size - 1;
+
+	auto value = [&](unsigned int x, unsigned int y) { return f_ref[static_cast<size_t>(y & mask) * size + (x & mask)].real(); };
+
+	const double peak_value = value(px, py);
+
+	*dx = (px > size / 2 ? static_cast<double>(px) - size : px) +
+		get_subpixel_offset(value(px - 1, py), peak_value, value(px + 1, py));
+	*dy = (py > size / 2 ? static_cast<double>(py) - size : py) +
+		get_subpixel_offset(value(px, py - 1), peak_value, value(px, py + 1));
+
+	return peak_value;
+}
+
+/**
+ * Least squares fit, without outlier removal.
+ */
+static AffineTransform fit_least_squares(std::vector<PointCorrespondence> const& points)
+{
+	assert(!points.empty());
+
+	double mean_mx = 0, mean_my = 0, mean_rx = 0, mean_ry = 0;
+	for (auto const& p : points)
+	{
+		mean_mx += p.moving_x;
+		mean_my += p.moving_y;
+		mean_rx += p.reference_x;
+		mean_ry += p.reference_y;
+	}
+
+	const double n = points.size();
+	mean_mx /= n;
+	mean_my /= n;
+	mean_rx /= n;
+	mean_ry /= n;
+
+	// normal equations with centered points
+	double suu = 0, suv = 0, svv = 0, sux = 0, svx = 0, suy = 0, svy = 0;
+	for (auto const& p : points)
+	{
+		const double u = p.moving_x - mean_mx, v = p.moving_y - mean_my;
+		const double x = p.reference_x - mean_rx, y = p.reference_y - mean_ry;
+
+		suu += u * u;
+		suv += u * v;
+		svv += v * v;
+		sux += u * x;
+		svx += v * x;
+		suy += u * y;
+		svy += v * y;
+	}
+
+	const double det = suu * svv - suv * suv;
+
+	// Less than three points or collinear points: translation only.
+	if (points.size() < 3 || det <= 1e-9 * std::max(suu * svv, 1.0))
+		return AffineTransform::translation(mean_rx - mean_mx, mean_ry - mean_my);
+
+	const double a = (sux * svv - svx * suv) / det;
+	const double b = (svx * suu - sux * suv) / det;
+	const double c = (suy * svv - svy * suv) / det;
+	const double d = (svy * suu - suy * suv) / det;
+
+	return AffineTransform(a, b, c, d,
+	                       mean_rx - a * mean_mx - b * mean_my,
+	                       mean_ry - c * mean_mx - d * mean_my);
+}
+
+AffineTransform degate::fit_affine_transform(std::vector<PointCorrespondence> const& correspondences)
+{
+	if (correspondences.empty())
+		return AffineTransform();
+
+	std::vector<PointCorrespondence> inliers = correspondences;
+	AffineTransform transform;
+
+	for (unsigned int iteration = 0; iteration < 3; iteration++)
+	{
+		transform = fit_least_squares(inliers);
+
+		std::vector<double> residuals;
+		for (auto const& p : inliers)
+		{
+			double x, y;
+			transform.apply(p.moving_x, p.moving_y, &x, &y);
+			residuals.push_back(std::hypot(x - p.reference_x, y - p.reference_y));
+		}
+
+		std::vector<double> sorted = residuals;
+		std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+		const double threshold = std::max(3 * sorted[sorted.size() / 2], 1.0);
+
+		std::vector<PointCorrespondence> remaining;
+		for (size_t i = 0; i < inliers.size(); i++)
+		{
+			if (residuals[i] <= threshold)
+				remaining.push_back(inliers[i]);
+		}
+
+		if (remaining.size() == inliers.size())
+			break;
+
+		inliers.swap(remaining);
+	}
+
+	return transform;
+}
+
+/**
+ * Read a greyscale window of \p size * \p size pixels with the upper left corner at (min_x, min_y).
+ * Pixels outside of the image are set to the mean of the pixels inside.
+ * @return Returns the fraction of the window that is inside the image.
+ */
+static double read_window(BackgroundImage_shptr img, int min_x, int min_y, unsigned int size,
+                          std::vector<float>& window, double* stddev)
+{
+	window.assign(static_cast<size_t>(size) * size, 0);
+
+	const int width = img->get_width(), height = img->get_height();
+	const int from_x = std::max(min_x, 0), to_x = std::min(min_x + static_cast<int>(size), width);
+	const int from_y = std::max(min_y, 0), to_y = std::min(min_y + static_cast<int>(size), height);
+
+	*stddev = 0;
+	if (from_x >= to_x || from_y >= to_y)
+		return 0;
+
+	std::vector<rgba_pixel_t> row(to_x - from_x);
+	double sum = 0, squared_sum = 0;
+
+	for (int y = from_y; y < to_y; y++)
+	{
+		img->raw_copy_row(row.data(), from_x, y, row.size());
+
+		float* dst = &window[static_cast<size_t>(y - min_y) * size + (from_x - min_x)];
+		for (size_t x = 0; x < row.size(); x++)
+		{
+			dst[x] = RGBA_TO_GS_BY_VAL(row[x]);
+			sum += dst[x];
+			squared_sum += static_cast<double>(dst[x]) * dst[x];
+		}
+	}
+
+	const double n = static_cast<double>(to_x - from_x) * (to_y - from_y);
+	const double mean = sum / n;
+	*stddev = std::sqrt(std::max(squared_sum / n - mean * mean, 0.0));
+
+	for (int y = 0; y < static_cast<int>(size); y++)
+		for (int x = 0; x < static_cast<int>(size); x++)
+		{
+			if (x + min_x < from_x || x + min_x >= to_x || y + min_y < from_y || y + min_y >= to_y)
+				window[static_cast<size_t>(y) * size + x] = static_cast<float>(mean);
+		}
+
+	return n / (static_cast<double>(size) * size);
+}
+
+/**
+ * Get the largest power of two, that is not larger than \p value.
+ */
+static unsigned int get_power_of_two_below(unsigned int value)
+{
+	unsigned int p = 1;
+	while (p * 2 <= value)
+		p *= 2;
+	return p;
+}
+
+namespace
+{
+	/**
+	 * A window of a reference image and the window of a moving image, where the
+	 * content of the reference window is expected.
+	 */
+	struct RegistrationWindow
+	{
+		unsigned int pair;         // index of the moving image
+		int ref_x, ref_y;          // upper left corner of the reference window
+		int moving_x, moving_y;    // upper left corner of the moving window
+		std::vector<float> reference, moving;
+		double dx, dy, peak;
+	};
+}
+
+std::vector<AffineTransform> degate::register_images(std::vector<ScalingManager_shptr> const& images)
+{
+	const unsigned int n = images.size();
+	std::vector<AffineTransform> result(n);
+
+	if (n < 2)
+		return result;
+
+	// Scaling levels of all images, the coarsest first.
+	std::vector<unsigned int> levels;
+	for (double step : images[0]->get_zoom_steps())
+	{
+		const unsigned int level = lrint(step);
+		bool common = true;
+
+		for (auto const& smgr : images)
+		{
+			if (lrint(smgr->get_image(level).first) != level)
+				common = false;
+		}
+
+		if (common)
+			levels.insert(levels.begin(), level);
+	}
+
+	// For each image (but the first), the transformation to the previous image.
+	std::vector<AffineTransform> pair_transforms(n);
+
+	// Translation between the coarsest images.
+	{
+		const unsigned int level = levels.front();
+
+		BackgroundImage_shptr first = images[0]->get_image(level).second;
+		unsigned int size = 1;
+		while (size < std::max(first->get_width(), first->get_height()))
+			size *= 2;
+		size = std::min<unsigned int>(size, IMAGE_REGISTRATION_MAX_GLOBAL_SIZE);
+
+		const int min_x = (static_cast<int>(first->get_width()) - static_cast<int>(size)) / 2;
+		const int min_y = (static_cast<int>(first->get_height()) - static_cast<int>(size)) / 2;
+
+		std::vector<std::vector<float>> windows(n);
+		for (unsigned int i = 0; i < n; i++)
+		{
+			double stddev;
+			read_window(images[i]->get_image(level).second, min_x, min_y, size, windows[i], &stddev);
+		}
+
+		parallel_for_ranges(n - 1, [&](unsigned int from, unsigned int to)
+		{
+			for (unsigned int i = from + 1; i < to + 1; i++)
+			{
+				double dx, dy;
+				if (phase_correlation(windows[i - 1], windows[i], size, &dx, &dy) >= IMAGE_REGISTRATION_MIN_PEAK)
+					pair_transforms[i] = AffineTransform::translation(-dx * level, -dy * level);
+			}
+		});
+	}
+
+	// Refine from coarse to fine levels.
+	for (unsigned int level : levels)
+	{
+		const unsigned int width = images[0]->get_image(level).second->get_width();
+		const unsigned int height = images[0]->get_image(level).second->get_height();
+
+		const unsigned int size = std::min<unsigned int>(IMAGE_REGISTRATION_WINDOW_SIZE,
+		                                                 get_power_of_two_below(std::min(width, height)));
+		if (size < 16)
+			continue;
+
+		std::vector<RegistrationWindow> windows;
+
+		// Read the windows.
+		for (unsigned int i = 1; i < n; i++)
+		{
+			BackgroundImage_shptr reference = images[i - 1]->get_image(level).second;
+			BackgroundImage_shptr moving = images[i]->get_image(level).second;
+			const AffineTransform inverse = pair_transforms[i].inverse();
+
+			for (unsigned int gy = 0; gy < IMAGE_REGISTRATION_GRID_SIZE; gy++)
+				for (unsigned int gx = 0; gx < IMAGE_REGISTRATION_GRID_SIZE; gx++)
+				{
+					RegistrationWindow w;
+					w.pair = i;
+					w.ref_x = lrint((gx + 0.5) * width / IMAGE_REGISTRATION_GRID_SIZE) - static_cast<int>(size / 2);
+					w.ref_y = lrint((gy + 0.5) * height / IMAGE_REGISTRATION_GRID_SIZE) - static_cast<int>(size / 2);
+
+					// The expected position in the moving image.
+					double x, y;
+					inverse.apply((w.ref_x + size / 2.0) * level, (w.ref_y + size / 2.0) * level, &x, &y);
+					w.moving_x = lrint(x / level - size / 2.0);
+					w.moving_y = lrint(y / level - size / 2.0);
+
+					double ref_stddev, moving_stddev;
+					if (read_window(reference, w.ref_x, w.ref_y, size, w.reference, &ref_stddev) < 0.75 ||
+					    ref_stddev < IMAGE_REGISTRATION_MIN_STDDEV)
+						continue;
+					if (read_window(moving, w.moving_x, w.moving_y, size, w.moving, &moving_stddev) < 0.75 ||
+					    moving_stddev < IMAGE_REGISTRATION_MIN_STDDEV)
+						continue;
+
+					windows.push_back(std::move(w));
+				}
+		}
+
+		// Compare the windows.
+		parallel_for_ranges(windows.size(), [&](unsigned int from, unsigned int to)
+		{
+			for (unsigned int i = from; i < to; i++)
+				windows[i].peak = phase_correlation(windows[i].reference, windows[i].moving, size,
+				                                    &windows[i].dx, &windows[i].dy);
+		});
+
+		// Fit the transformations.
+		std::vector<std::vector<PointCorrespondence>> correspondences(n);
+		for (auto const& w : windows)
+		{
+			if (w.peak < IMAGE_REGISTRATION_MIN_PEAK)
+				continue;
+
+			PointCorrespondence p;
+			p.reference_x = (w.ref_x + size / 2.0) * level;
+			p.reference_y = (w.ref_y + size / 2.0) * level;
+			p.moving_x = (w.moving_x + size / 2.0 + w.dx) * level;
+			p.moving_y = (w.moving_y + size / 2.0 + w.dy) * level;
+			correspondences[w.pair].push_back(p);
+		}
+
+		for (unsigned int i = 1; i < n; i++)
+		{
+			if (correspondences[i].empty())
+				continue;
+
+			const AffineTransform t = fit_affine_transform(correspondences[i]);
+
+			// Keep the last estimation, if the fit is implausible (e.g. too few matching windows).
+			const double det = t.get_a() * t.get_d() - t.get_b() * t.get_c();
+			if (det > 0.8 && det < 1.25)
+				pair_transforms[i] = t;
+		}
+	}
+
+	for (unsigned int i = 1; i < n; i++)
+		result[i] = result[i - 1] * pair_transforms[i];
+
+	return result;
+}
@@ -0,0 +1,107 @@
+/* -*-c++-*-
+
+ This file is part of the IC reverse engineering tool degate.
+
+ Copyright 2008, 2009, 2010 by Martin Schobert
+
+ Degate is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ any later version.
+
+ Degate is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __IMAGEREGISTRATION_H__
+#define __IMAGEREGISTRATION_H__
+
+#include "Core/Image/Image.h"
+#include "Core/Image/Manipulation/ScalingManager.h"
+#include "Core/Primitive/AffineTransform.h"
+
+#include <vector>
+
+/**
+ * Size of the windows that are compared to refine a registration (a power of two).
+ */
+#define IMAGE_REGISTRATION_WINDOW_SIZE 128
+
+/**
+ * Maximum size of the window that is compared to estimate the translation between
+ * the coarsest scaled images (a power of two).
+ */
+#define IMAGE_REGISTRATION_MAX_GLOBAL_SIZE 1024
+
+/**
+ * Number of windows per row and per column that are compared on each scaling level.
+ */
+#define IMAGE_REGISTRATION_GRID_SIZE 8
+
+/**
+ * Minimal height of the phase correlation peak for a window to be used.
+ */
+#define IMAGE_REGISTRATION_MIN_PEAK 0.05
+
+/**
+ * Minimal standard deviation of the greyscale values of a window to be used (windows without structure are skipped).
+ */
+#define IMAGE_REGISTRATION_MIN_STDDEV 2.0
+
+namespace degate
+{
+	/**
+	 * A point in a reference image and the corresponding point in a moving image.
+	 */
+	struct PointCorrespondence
+	{
+		double reference_x, reference_y;
+		double moving_x, moving_y;
+	};
+
+	/**
+	 * Estimate the translation between two greyscale images with phase correlation.
+	 * @param reference The reference image, \p size * \p size pixels, row after row.
+	 * @param moving The moving image, \p size * \p size pixels, row after row.
+	 * @param size The width and height of the images. It must be a power of two.
+	 * @param dx The x offset of the content of the moving image: moving(x + dx, y + dy) matches reference(x, y).
+	 * @param dy The y offset of the content of the moving image.
+	 * @return Returns the height of the correlation peak (up to 1). The higher the peak, the more
+	 *   reliable is the estimation.
+	 */
+	double phase_correlation(std::vector<float> const& reference, std::vector<float> const& moving,
+	                         unsigned int size, double* dx, double* dy);
+
+	/**
+	 * Fit an affine transformation, that maps moving points to reference points, with least squares.
+	 * Correspondences with large residuals are dropped and the transformation is fitted again.
+	 * @return Returns the transformation. With less than three (or only collinear) points,
+	 *   this is a translation. Without points, this is the identity.
+	 */
+	AffineTransform fit_affine_transform(std::vector<PointCorrespondence> const& correspondences);
+
+	/**
+	 * Register a stack of images, e.g. the background images of the layers.
+	 *
+	 * Each image is registered to the previous one. The translation is estimated with phase
+	 * correlation on the coarsest scaled images. Then, from coarse to fine scaling levels,
+	 * windows on a grid are compared with phase correlation and an affine transformation is
+	 * fitted to the window offsets. The last refinement is on the unscaled images.
+	 *
+	 * Images are read from the calling thread only, comparisons run in parallel.
+	 * The images must not be aligned (@see StoragePolicy_Tile::set_alignment()).
+	 *
+	 * @param images The scaling managers of the images. The scaled images must exist.
+	 * @return Returns for each image the transformation from its coordinates to the coordinates
+	 *   of the first image. The first transformation is the identity.
+	 */
+	std::vector<AffineTransform> register_images(std::vector<ScalingManager_shptr> const& images);
+}
+
+#endif
@@ -0,0 +1,83 @@
+/* -*-c++-*-
+
+ This file is part of the IC reverse engineering tool degate.
+
+ Copyright 2008, 2009, 2010 by Martin Schobert
+
+ Degate is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ any later version.
+
+ Degate is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "Core/Image/Manipulation/IntegralBand.h"
+
+#include <algorithm>
+
+using namespace degate;
+
+IntegralBand::IntegralBand() :
+	min_x(0), min_y(0), width(0), height(0)
+{
+}
+
+bool IntegralBand::load(BackgroundImage_shptr img,
+                        unsigned int min_x, unsigned int min_y,
+                        unsigned int width, unsigned int height)
+{
+	assert(img != nullptr);
+
+	this->min_x = std::min(min_x, img->get_width());
+	this->min_y = std::min(min_y, img->get_height());
+	this->width = std::min(width, img->get_width() - this->min_x);
+	this->height = std::min(height, img->get_height() - this->min_y);
+
+	if (this->width == 0 || this->height == 0)
+	{
+		this->width = this->height = 0;
+		return false;
+	}
+
+	const size_t stride = this->width + 1;
+
+	greyscale.resize(static_cast<size_t>(this->width) * this->height);
+	sum_table.assign(stride * (this->height + 1), 0);
+	squared_sum_table.assign(stride * (this->height + 1), 0);
+	row_buffer.resize(this->width);
+
+	for (unsigned int r = 0; r < this->height; r++)
+	{
+		img->raw_copy_row(row_buffer.data(), this->min_x, this->min_y + r, this->width);
+
+		gs_byte_pixel_t* gs = &greyscale[static_cast<size_t>(r) * this->width];
+		const sum_type* sum_above = &sum_table[r * stride];
+		const sum_type* squared_sum_above = &squared_sum_table[r * stride];
+		sum_type* sum = &sum_table[(r + 1) * stride];
+		sum_type* squared_sum = &squared_sum_table[(r + 1) * stride];
+
+		sum_type row_sum = 0, row_squared_sum = 0;
+
+		for (unsigned int x = 0; x < this->width; x++)
+		{
+			const gs_byte_pixel_t g = RGBA_TO_GS_BY_VAL(row_buffer[x]);
+			gs[x] = g;
+
+			row_sum += g;
+			row_squared_sum += static_cast<sum_type>(g) * g;
+
+			sum[x + 1] = sum_above[x + 1] + row_sum;
+			squared_sum[x + 1] = squared_sum_above[x + 1] + row_squared_sum;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,161 @@
+/* -*-c++-*-
+
+ This file is part of the IC reverse engineering tool degate.
+
+ Copyright 2008, 2009, 2010 by Martin Schobert
+
+ Degate is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ any later version.
+
+ Degate is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __INTEGRALBAND_H__
+#define __INTEGRALBAND_H__
+
+#include "Core/Image/Image.h"
+#include "Core/Image/Manipulation/IntegralImageManager.h"
+
+#include <vector>
+
+namespace degate
+{
+	/**
+	 * Greyscale version of a rectangular part of a background image with its summation tables.
+	 *
+	 * An IntegralBand provides the same queries as an IntegralImage, in coordinates of the
+	 * whole image, but only for the rectangle it was loaded for. It is held in memory and
+	 * can be reloaded for another rectangle, reusing its buffers. This is used to match
+	 * templates along grid lines, where only narrow bands of the image are searched.
+	 *
+	 * @see IntegralImage
+	 */
+	class IntegralBand
+	{
+	public:
+
+		typedef IntegralImage::sum_type sum_type;
+
+	private:
+
+		unsigned int min_x, min_y;
+		unsigned int width, height;
+
+		std::vector<gs_byte_pixel_t> greyscale;
+		std::vector<sum_type> sum_table;
+		std::vector<sum_type> squared_sum_table;
+		std::vector<rgba_pixel_t> row_buffer;
+
+		inline sum_type get_area(std::vector<sum_type> const& table,
+		                         unsigned int min_x, unsigned int min_y,
+		                         unsigned int max_x, unsigned int max_y) const
+		{
+			assert(min_x >= this->min_x && min_y >= this->min_y);
+			assert(min_x <= max_x && max_x - this->min_x < width);
+			assert(min_y <= max_y && max_y - this->min_y < height);
+
+			const size_t stride = width + 1;
+			const sum_type* top = &table[(min_y - this->min_y) * stride];
+			const sum_type* bottom = &table[(max_y - this->min_y + 1) * stride];
+
+			min_x -= this->min_x;
+			max_x -= this->min_x;
+
+			return bottom[max_x + 1] - bottom[min_x] - top[max_x + 1] + top[min_x];
+		}
+
+	public:
+
+		/**
+		 * Create an empty band.
+		 */
+		IntegralBand();
+
+		/**
+		 * Load a rectangle of a background image.
+		 * The rectangle is clipped to the image.
+		 * @return Returns false, if the clipped rectangle is empty.
+		 */
+		bool load(BackgroundImage_shptr img,
+		          unsigned int min_x, unsigned int min_y,
+		          unsigned int width, unsigned int height);
+
+		/**
+		 * Get the left edge of the band, in image coordinates.
+		 */
+		unsigned int get_min_x() const { return min_x; }
+
+		/**
+		 * Get the upper edge of the band, in image coordinates.
+		 */
+		unsigned int get_min_y() const { return min_y; }
+
+		/**
+		 * Get the width of the band.
+		 */
+		unsigned int get_width() const { return width; }
+
+		/**
+		 * Get the height of the band.
+		 */
+		unsigned int get_height() const { return height; }
+
+		/**
+		 * Check if a rectangle of \p w x \p h pixels at (\p x, \p y) is within the band.
+		 */
+		bool contains(unsigned int x, unsigned int y, unsigned int w, unsigned int h) const
+		{
+			return x >= min_x && y >= min_y &&
+				x - min_x + w <= width && y - min_y + h <= height;
+		}
+
+		/**
+		 * Get a greyscale pixel.
+		 */
+		inline gs_byte_pixel_t get_pixel(unsigned int x, unsigned int y) const
+		{
+			return *get_row(x, y);
+		}
+
+		/**
+		 * Get a pointer to the greyscale pixels of a row, starting at \p x.
+		 * Pixels of a row are contiguous.
+		 */
+		inline const gs_byte_pixel_t* get_row(unsigned int x, unsigned int y) const
+		{
+			assert(contains(x, y, 1, 1));
+			return &greyscale[static_cast<size_t>(y - min_y) * width + (x - min_x)];
+		}
+
+		/**
+		 * Get the sum of the greyscale values of a rectangle.
+		 * The coordinates are inclusive.
+		 */
+		inline sum_type get_sum(unsigned int min_x, unsigned int min_y,
+		                        unsigned int max_x, unsigned int max_y) const
+		{
+			return get_area(sum_table, min_x, min_y, max_x, max_y);
+		}
+
+		/**
+		 * Get the sum of the squared greyscale values of a rectangle.
+		 * The coordinates are inclusive.
+		 */
+		inline sum_type get_squared_sum(unsigned int min_x, unsigned int min_y,
+		                                unsigned int max_x, unsigned int max_y) const
+		{
+			return get_area(squared_sum_table, min_x, min_y, max_x, max_y);
+		}
+	};
+}
+
+#endif
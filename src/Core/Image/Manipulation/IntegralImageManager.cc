@@ -0,0 +1,301 @@
+/* -*-c++-*-
+
+ This file is part of the IC reverse engineering tool degate.
+
+ Copyright 2008, 2009, 2010 by Martin Schobert
+
+ Degate is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ any later version.
+
+ Degate is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <Core/Image/Manipulation/IntegralImageManager.h>
+#include <Core/Image/TilePack.h>
+#include <Core/Image/CompressedTilePack.h>
+#include <Core/Utils/FileSystem.h>
+#include <Core/Utils/ParallelFor.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include <boost/filesystem/operations.hpp>
+
+#ifdef SYS_UNIX
+#include <sys/stat.h>
+#endif
+
+using namespace degate;
+
+IntegralImage::IntegralImage(unsigned int width, unsigned int height, std::string const& file_prefix) :
+	width(width), height(height)
+{
+	assert(width > 0 && height > 0);
+
+	greyscale = std::make_shared<MemoryMap<gs_byte_pixel_t>>(width, height,
+	                                                         MAP_STORAGE_TYPE_PERSISTENT_FILE,
+	                                                         file_prefix + ".gs");
+	sum_table = std::make_shared<MemoryMap<sum_type>>(width + 1, height + 1,
+	                                                  MAP_STORAGE_TYPE_PERSISTENT_FILE,
+	                                                  file_prefix + ".sum");
+	squared_sum_table = std::make_shared<MemoryMap<sum_type>>(width + 1, height + 1,
+	                                                          MAP_STORAGE_TYPE_PERSISTENT_FILE,
+	                                                          file_prefix + ".sqsum");
+}
+
+void IntegralImage::get_average_and_stddev(unsigned int min_x, unsigned int min_y,
+                                           unsigned int max_x, unsigned int max_y,
+                                           double* avg, double* stddev) const
+{
+	const double n = static_cast<double>(max_x - min_x + 1) * static_cast<double>(max_y - min_y + 1);
+
+	const double mean = static_cast<double>(get_sum(min_x, min_y, max_x, max_y)) / n;
+	const double variance = static_cast<double>(get_squared_sum(min_x, min_y, max_x, max_y)) / n - mean * mean;
+
+	*avg = mean;
+	*stddev = variance > 0 ? sqrt(variance) : 0;
+}
+
+
+IntegralImageManager::IntegralImageManager(ScalingManager_shptr scaling_manager, std::string const& directory) :
+	scaling_manager(scaling_manager), directory(directory)
+{
+	assert(scaling_manager != nullptr);
+}
+
+std::string IntegralImageManager::get_file_prefix(unsigned int scaling) const
+{
+	std::ostringstream name;
+	name << "integral_" << scaling;
+	return join_pathes(directory, name.str());
+}
+
+std::string IntegralImageManager::get_info_filename(unsigned int scaling) const
+{
+	return get_file_prefix(scaling) + ".info";
+}
+
+/**
+ * Get the size and the last modification time of a file. The time is as precise as
+ * the system provides it, packed tiles are rewritten in place and may change within a second.
+ */
+static std::string get_file_signature(std::string const& path)
+{
+	std::ostringstream signature;
+	signature << boost::filesystem::file_size(path) << " ";
+
+#if defined(SYS_LINUX)
+	struct stat st;
+	if (stat(path.c_str(), &st) == 0)
+	{
+		signature << st.st_mtim.tv_sec << "." << st.st_mtim.tv_nsec;
+		return signature.str();
+	}
+#elif defined(SYS_APPLE)
+	struct stat st;
+	if (stat(path.c_str(), &st) == 0)
+	{
+		signature << st.st_mtimespec.tv_sec << "." << st.st_mtimespec.tv_nsec;
+		return signature.str();
+	}
+#endif
+
+	signature << boost::filesystem::last_write_time(path);
+	return signature.str();
+}
+
+std::string IntegralImageManager::get_image_signature(BackgroundImage_shptr img) const
+{
+	std::time_t last_write = 0;
+	unsigned int tiles = 0;
+
+	for (auto const& file : read_directory(img->get_directory(), true))
+	{
+		if (is_file(file) && get_file_suffix(file) == "dat")
+		{
+			last_write = std::max(last_write, boost::filesystem::last_write_time(file));
+			tiles++;
+		}
+	}
+
+	std::ostringstream signature;
+	signature << img->get_width() << " " << img->get_height() << " " << img->get_tile_size() << " "
+		<< tiles << " " << last_write;
+
+	// Tiles in a (compressed) tile pack file.
+	for (std::string const& name : {std::string(TILE_PACK_FILENAME), std::string(COMPRESSED_TILE_PACK_FILENAME)})
+	{
+		std::string file = join_pathes(img->get_directory(), name);
+		if (is_file(file))
+			signature << " " << name << " " << get_file_signature(file);
+	}
+
+	// Integral images of aligned images are computed from the aligned pixels.
+	if (!img->get_alignment().is_identity())
+		signature << " " << img->get_alignment().to_string();
+
+	return signature.str();
+}
+
+bool IntegralImageManager::is_stored(unsigned int scaling, std::string const& signature) const
+{
+	std::ifstream info(get_info_filename(scaling));
+	if (!info.is_open())
+		return false;
+
+	unsigned int version = 0;
+	std::string stored_signature;
+
+	info >> version;
+	info.ignore();
+	std::getline(info, stored_signature);
+
+	return version == INTEGRAL_IMAGE_FILE_VERSION && stored_signature == signature;
+}
+
+void IntegralImageManager::remove_files(unsigned int scaling) const
+{
+	const std::string prefix = get_file_prefix(scaling);
+
+	for (auto const& suffix : {".info", ".gs", ".sum", ".sqsum"})
+	{
+		if (file_exists(prefix + suffix))
+			remove_file(prefix + suffix);
+	}
+}
+
+void IntegralImageManager::compute(BackgroundImage_shptr img, IntegralImage_shptr integral_image) const
+{
+	typedef IntegralImage::sum_type sum_type;
+
+	const unsigned int width = img->get_width(), height = img->get_height();
+	const unsigned int tile_size = img->get_tile_size();
+
+	MemoryMap<gs_byte_pixel_t>& greyscale = *integral_image->greyscale;
+	MemoryMap<sum_type>& sum_table = *integral_image->sum_table;
+	MemoryMap<sum_type>& squared_sum_table = *integral_image->squared_sum_table;
+
+	// The first row of the summation tables is zero (the first column is set per row).
+	memset(sum_table.get_pointer(0, 0), 0, (width + 1) * sizeof(sum_type));
+	memset(squared_sum_table.get_pointer(0, 0), 0, (width + 1) * sizeof(sum_type));
+
+	std::vector<rgba_pixel_t> band(static_cast<size_t>(width) * tile_size);
+
+	// Process the image band by band, a band is a row of tiles.
+	for (unsigned int band_y = 0; band_y < height; band_y += tile_size)
+	{
+		const unsigned int rows = std::min(tile_size, height - band_y);
+
+		// Greyscale values and prefix sums along each row.
+		parallel_for_ranges(rows, [&](unsigned int from, unsigned int to)
+		{
+			for (unsigned int r = from; r < to; r++)
+			{
+				rgba_pixel_t* src = &band[static_cast<size_t>(r) * width];
+				img->raw_copy_row(src, 0, band_y + r, width);
+
+				gs_byte_pixel_t* gs = greyscale.get_pointer(0, band_y + r);
+				sum_type* sum = sum_table.get_pointer(0, band_y + r + 1);
+				sum_type* squared_sum = squared_sum_table.get_pointer(0, band_y + r + 1);
+
+				sum_type row_sum = 0, row_squared_sum = 0;
+				sum[0] = 0;
+				squared_sum[0] = 0;
+
+				for (unsigned int x = 0; x < width; x++)
+				{
+					const gs_byte_pixel_t g = RGBA_TO_GS_BY_VAL(src[x]);
+					gs[x] = g;
+
+					row_sum += g;
+					row_squared_sum += static_cast<sum_type>(g) * g;
+
+					sum[x + 1] = row_sum;
+					squared_sum[x + 1] = row_squared_sum;
+				}
+			}
+		}, INTEGRAL_IMAGE_MIN_LINES_PER_THREAD);
+
+		// Add the rows above. Rows are processed in order, columns in parallel.
+		parallel_for_ranges(width + 1, [&](unsigned int from, unsigned int to)
+		{
+			for (unsigned int y = band_y + 1; y <= band_y + rows; y++)
+			{
+				const sum_type* sum_above = sum_table.get_pointer(0, y - 1);
+				const sum_type* squared_sum_above = squared_sum_table.get_pointer(0, y - 1);
+				sum_type* sum = sum_table.get_pointer(0, y);
+				sum_type* squared_sum = squared_sum_table.get_pointer(0, y);
+
+				for (unsigned int x = from; x < to; x++)
+				{
+					sum[x] += sum_above[x];
+					squared_sum[x] += squared_sum_above[x];
+				}
+			}
+		}, INTEGRAL_IMAGE_MIN_LINES_PER_THREAD);
+	}
+}
+
+std::pair<unsigned int, IntegralImage_shptr> IntegralImageManager::get_integral_image(double request_scaling)
+{
+	boost::mutex::scoped_lock lock(mutex);
+
+	ScalingManager<BackgroundImage>::image_map_element element = scaling_manager->get_image(request_scaling);
+	assert(element.second != nullptr);
+
+	const unsigned int scaling = lrint(element.first);
+
+	auto iter = integral_images.find(scaling);
+	if (iter != integral_images.end())
+		return std::make_pair(scaling, iter->second);
+
+	BackgroundImage_shptr img = element.second;
+	const std::string signature = get_image_signature(img);
+	const bool stored = is_stored(scaling, signature);
+
+	if (!stored)
+	{
+		debug(TM, "compute integral image for scaling %d", scaling);
+		remove_files(scaling);
+	}
+
+	IntegralImage_shptr integral_image = std::make_shared<IntegralImage>(img->get_width(), img->get_height(),
+	                                                                     get_file_prefix(scaling));
+
+	if (!stored)
+	{
+		compute(img, integral_image);
+
+		// Written last, so an interrupted computation is never taken as valid.
+		std::ofstream info(get_info_filename(scaling));
+		info << INTEGRAL_IMAGE_FILE_VERSION << std::endl << signature << std::endl;
+	}
+
+	integral_images[scaling] = integral_image;
+
+	return std::make_pair(scaling, integral_image);
+}
+
+void IntegralImageManager::invalidate()
+{
+	boost::mutex::scoped_lock lock(mutex);
+
+	integral_images.clear();
+
+	for (double scaling : scaling_manager->get_zoom_steps())
+		remove_files(lrint(scaling));
+}
@@ -0,0 +1,229 @@
+/* -*-c++-*-
+
+ This file is part of the IC reverse engineering tool degate.
+
+ Copyright 2008, 2009, 2010 by Martin Schobert
+
+ Degate is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ any later version.
+
+ Degate is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __INTEGRALIMAGEMANAGER_H__
+#define __INTEGRALIMAGEMANAGER_H__
+
+#include "Core/Image/Image.h"
+#include "Core/Image/Manipulation/ScalingManager.h"
+#include "Core/Utils/MemoryMap.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <boost/thread.hpp>
+
+/**
+ * Version of the integral image files. Files with another version are recomputed.
+ */
+#define INTEGRAL_IMAGE_FILE_VERSION 1
+
+/**
+ * Minimal number of rows (or columns) handled by a thread while computing integral images.
+ */
+#define INTEGRAL_IMAGE_MIN_LINES_PER_THREAD 64
+
+namespace degate
+{
+	/**
+	 * Greyscale version of a background image with its summation tables (integral images).
+	 *
+	 * The summation tables hold exact 64 bit sums of the greyscale values and of the
+	 * squared greyscale values. They have an additional first row and column of zeros,
+	 * so the sum over any rectangle needs exactly four lookups.
+	 *
+	 * All data are memory mapped files, an IntegralImage is created by the IntegralImageManager.
+	 */
+	class IntegralImage
+	{
+		friend class IntegralImageManager;
+
+	public:
+
+		typedef uint64_t sum_type;
+
+	private:
+
+		unsigned int width, height;
+
+		std::shared_ptr<MemoryMap<gs_byte_pixel_t>> greyscale;
+		std::shared_ptr<MemoryMap<sum_type>> sum_table;
+		std::shared_ptr<MemoryMap<sum_type>> squared_sum_table;
+
+		inline sum_type get_area(MemoryMap<sum_type> const& table,
+		                         unsigned int min_x, unsigned int min_y,
+		                         unsigned int max_x, unsigned int max_y) const
+		{
+			assert(min_x <= max_x && max_x < width);
+			assert(min_y <= max_y && max_y < height);
+
+			const sum_type* top = table.get_pointer(0, min_y);
+			const sum_type* bottom = table.get_pointer(0, max_y + 1);
+
+			return bottom[max_x + 1] - bottom[min_x] - top[max_x + 1] + top[min_x];
+		}
+
+	public:
+
+		/**
+		 * Map the files of an integral image.
+		 * @param width The width of the image.
+		 * @param height The height of the image.
+		 * @param file_prefix The path prefix for the greyscale and summation table files.
+		 */
+		IntegralImage(unsigned int width, unsigned int height, std::string const& file_prefix);
+
+		/**
+		 * Get the width of the image.
+		 */
+		unsigned int get_width() const { return width; }
+
+		/**
+		 * Get the height of the image.
+		 */
+		unsigned int get_height() const { return height; }
+
+		/**
+		 * Check if a rectangle of \p w x \p h pixels at (\p x, \p y) is within the image.
+		 */
+		bool contains(unsigned int x, unsigned int y, unsigned int w, unsigned int h) const
+		{
+			return x + w <= width && y + h <= height;
+		}
+
+		/**
+		 * Get a greyscale pixel.
+		 */
+		inline gs_byte_pixel_t get_pixel(unsigned int x, unsigned int y) const
+		{
+			return *greyscale->get_pointer(x, y);
+		}
+
+		/**
+		 * Get a pointer to the greyscale pixels of a row, starting at \p x.
+		 * Pixels of a row are contiguous.
+		 */
+		inline const gs_byte_pixel_t* get_row(unsigned int x, unsigned int y) const
+		{
+			assert(x < width && y < height);
+			return greyscale->get_pointer(x, y);
+		}
+
+		/**
+		 * Get the sum of the greyscale values of a rectangle.
+		 * The coordinates are inclusive.
+		 */
+		inline sum_type get_sum(unsigned int min_x, unsigned int min_y,
+		                        unsigned int max_x, unsigned int max_y) const
+		{
+			return get_area(*sum_table, min_x, min_y, max_x, max_y);
+		}
+
+		/**
+		 * Get the sum of the squared greyscale values of a rectangle.
+		 * The coordinates are inclusive.
+		 */
+		inline sum_type get_squared_sum(unsigned int min_x, unsigned int min_y,
+		                                unsigned int max_x, unsigned int max_y) const
+		{
+			return get_area(*squared_sum_table, min_x, min_y, max_x, max_y);
+		}
+
+		/**
+		 * Get the average and the standard deviation of the greyscale values of a rectangle.
+		 * The coordinates are inclusive.
+		 */
+		void get_average_and_stddev(unsigned int min_x, unsigned int min_y,
+		                            unsigned int max_x, unsigned int max_y,
+		                            double* avg, double* stddev) const;
+	};
+
+	typedef std::shared_ptr<IntegralImage> IntegralImage_shptr;
+
+
+	/**
+	 * The IntegralImageManager holds the integral images of the images of a ScalingManager.
+	 *
+	 * Integral images are computed once per scaling level, on demand. The computation reads the
+	 * background image band by band (a row of tiles) and processes each band in parallel.
+	 * The result is stored in the directory of the background image (the layer directory), so
+	 * it is reused by later matching runs and after reloading the project.
+	 *
+	 * Stored integral images are recomputed if the background image files changed.
+	 * After modifying a background image in place, call invalidate().
+	 *
+	 * @see ScalingManager
+	 */
+	class IntegralImageManager
+	{
+	private:
+
+		ScalingManager_shptr scaling_manager;
+		std::string directory;
+
+		std::map<unsigned int, IntegralImage_shptr> integral_images;
+		boost::mutex mutex;
+
+		std::string get_file_prefix(unsigned int scaling) const;
+		std::string get_info_filename(unsigned int scaling) const;
+
+		/**
+		 * Get a signature of the image files (number and last modification time of tile
+		 * files, size and last modification time of tile pack files).
+		 */
+		std::string get_image_signature(BackgroundImage_shptr img) const;
+
+		bool is_stored(unsigned int scaling, std::string const& signature) const;
+		void remove_files(unsigned int scaling) const;
+
+		/**
+		 * Compute the greyscale image and the summation tables.
+		 */
+		void compute(BackgroundImage_shptr img, IntegralImage_shptr integral_image) const;
+
+	public:
+
+		/**
+		 * Create an integral image manager.
+		 * @param scaling_manager The scaling manager with the background images.
+		 * @param directory The directory where integral images are stored (the directory
+		 *   of the background image).
+		 */
+		IntegralImageManager(ScalingManager_shptr scaling_manager, std::string const& directory);
+
+		/**
+		 * Get the integral image for a scaling. The scaling is selected as
+		 * with ScalingManager::get_image().
+		 * The integral image is loaded or computed if necessary. This method is thread safe.
+		 * @return Returns a std::pair with the real scaling factor and the integral image.
+		 */
+		std::pair<unsigned int, IntegralImage_shptr> get_integral_image(double request_scaling);
+
+		/**
+		 * Drop all integral images and remove their files.
+		 */
+		void invalidate();
+	};
+
+	typedef std::shared_ptr<IntegralImageManager> IntegralImageManager_shptr;
+}
+
+#endif
@@ -0,0 +1,362 @@
+/* -*-c++-*-
+
+ This file is part of the IC reverse engineering tool degate.
+
+ Copyright 2008, 2009, 2010 by Martin Schobert
+
+ Degate is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ any later version.
+
+ Degate is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "Core/Image/Manipulation/MosaicStitching.h"
+#include "Core/Image/Manipulation/ImageRegistration.h"
+#include "Core/Image/ImageHelper.h"
+#include "Core/Utils/FileSystem.h"
+#include "Core/Utils/ParallelFor.h"
+
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <list>
+#include <sstream>
+
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+
+using namespace degate;
+
+/**
+ * Read a greyscale window of \p size * \p size pixels with the upper left corner at (min_x, min_y).
+ * The window must be inside of the image.
+ */
+static void read_window(TempImage_RGBA_shptr img, unsigned int min_x, unsigned int min_y, unsigned int size,
+                        std::vector<float>& window)
+{
+	window.resize(static_cast<size_t>(size) * size);
+
+	for (unsigned int y = 0; y < size; y++)
+		for (unsigned int x = 0; x < size; x++)
+			window[static_cast<size_t>(y) * size + x] = img->get_pixel_as<gs_byte_pixel_t>(min_x + x, min_y + y);
+}
+
+namespace
+{
+	/**
+	 * Two overlapping frames. The windows show the same part of the mosaic, if the
+	 * frames are at their nominal positions.
+	 */
+	struct FramePair
+	{
+		unsigned int first, second;
+		std::vector<float> first_window, second_window;
+		unsigned int size;
+		double dx, dy, peak;
+	};
+
+	/**
+	 * Measured offset between two frames: position of \p second minus position of \p first.
+	 */
+	struct FrameOffset
+	{
+		unsigned int first, second;
+		double dx, dy, weight;
+	};
+}
+
+MosaicStitcher::MosaicStitcher(std::vector<MosaicFrame> const& frames, frame_loader_type const& frame_loader)
+	: frames(frames), frame_loader(frame_loader)
+{
+	if (!this->frame_loader)
+		this->frame_loader = [](MosaicFrame const& frame) { return load_image<TempImage_RGBA>(frame.image_file); };
+
+	for (auto const& frame : frames)
+	{
+		positions_x.push_back(frame.x);
+		positions_y.push_back(frame.y);
+	}
+}
+
+std::vector<MosaicFrame> MosaicStitcher::read_frame_grid(std::string const& grid_file)
+{
+	std::ifstream file(grid_file);
+	if (!file.is_open())
+	{
+		boost::format fmter("Error in read_frame_grid(): The frame grid file %1% cannot be opened.");
+		fmter % grid_file;
+		throw InvalidPathException(fmter.str());
+	}
+
+	const std::string directory = get_basedir(grid_file);
+	std::vector<MosaicFrame> frames;
+
+	std::string line;
+	for (unsigned int line_number = 1; std::getline(file, line); line_number++)
+	{
+		std::istringstream stream(line);
+
+		MosaicFrame frame;
+		std::string rest;
+
+		if (!(stream >> frame.image_file) || frame.image_file[0] == '#')
+			continue;
+
+		if (!(stream >> frame.x >> frame.y) || (stream >> rest))
+		{
+			boost::format fmter("Error in read_frame_grid(): Cannot parse line %1% of the frame grid file %2%.");
+			fmter % line_number % grid_file;
+			throw InvalidFileFormatException(fmter.str());
+		}
+
+		if (!boost::filesystem::path(frame.image_file).is_absolute())
+			frame.image_file = join_pathes(directory, frame.image_file);
+
+		frames.push_back(frame);
+	}
+
+	return frames;
+}
+
+std::vector<unsigned int> MosaicStitcher::get_frame_order(bool refined) const
+{
+	std::vector<unsigned int> order(frames.size());
+	for (unsigned int i = 0; i < order.size(); i++)
+		order[i] = i;
+
+	std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b)
+	{
+		if (refined)
+			return lrint(positions_y[a]) < lrint(positions_y[b]) ||
+				(lrint(positions_y[a]) == lrint(positions_y[b]) && positions_x[a] < positions_x[b]);
+
+		return frames[a].y < frames[b].y || (frames[a].y == frames[b].y && frames[a].x < frames[b].x);
+	});
+
+	return order;
+}
+
+void MosaicStitcher::refine_positions()
+{
+	struct LoadedFrame
+	{
+		unsigned int index;
+		TempImage_RGBA_shptr image;
+	};
+
+	std::list<LoadedFrame> loaded_frames;
+	std::vector<FramePair> pairs;
+	std::vector<FrameOffset> offsets;
+
+	// Compare the collected frame pairs in parallel.
+	auto compare_pairs = [&]()
+	{
+		parallel_for_ranges(pairs.size(), [&](unsigned int from, unsigned int to)
+		{
+			for (unsigned int i = from; i < to; i++)
+				pairs[i].peak = phase_correlation(pairs[i].first_window, pairs[i].second_window, pairs[i].size,
+				                                  &pairs[i].dx, &pairs[i].dy);
+		});
+
+		for (auto const& p : pairs)
+		{
+			// Offsets of more than a quarter of the window are not reliable.
+			if (p.peak < MOSAIC_STITCHING_MIN_PEAK || std::abs(p.dx) > p.size / 4.0 || std::abs(p.dy) > p.size / 4.0)
+				continue;
+
+			FrameOffset offset;
+			offset.first = p.first;
+			offset.second = p.second;
+			offset.dx = frames[p.second].x - frames[p.first].x - p.dx;
+			offset.dy = frames[p.second].y - frames[p.first].y - p.dy;
+			offset.weight = p.peak;
+			offsets.push_back(offset);
+		}
+
+		pairs.clear();
+	};
+
+	for (unsigned int index : get_frame_order(false))
+	{
+		MosaicFrame const& frame = frames[index];
+		TempImage_RGBA_shptr image = frame_loader(frame);
+
+		// Frames above this frame cannot overlap any of the following frames.
+		loaded_frames.remove_if([&](LoadedFrame const& f)
+		{
+			return frames[f.index].y + static_cast<int>(f.image->get_height()) <= frame.y;
+		});
+
+		for (auto const& f : loaded_frames)
+		{
+			MosaicFrame const& other = frames[f.index];
+
+			const int min_x = std::max(other.x, frame.x);
+			const int max_x = std::min(other.x + static_cast<int>(f.image->get_width()),
+			                           frame.x + static_cast<int>(image->get_width()));
+			const int min_y = std::max(other.y, frame.y);
+			const int max_y = std::min(other.y + static_cast<int>(f.image->get_height()),
+			                           frame.y + static_cast<int>(image->get_height()));
+
+			if (max_x - min_x < MOSAIC_STITCHING_MIN_WINDOW_SIZE || max_y - min_y < MOSAIC_STITCHING_MIN_WINDOW_SIZE)
+				continue;
+
+			FramePair pair;
+			pair.first = f.index;
+			pair.second = index;
+			pair.size = MOSAIC_STITCHING_MIN_WINDOW_SIZE;
+			while (pair.size * 2 <= static_cast<unsigned int>(std::min(max_x - min_x, max_y - min_y)) &&
+			       pair.size * 2 <= MOSAIC_STITCHING_MAX_WINDOW_SIZE)
+				pair.size *= 2;
+
+			// the window in the center of the overlap
+			const int window_x = (min_x + max_x - static_cast<int>(pair.size)) / 2;
+			const int window_y = (min_y + max_y - static_cast<int>(pair.size)) / 2;
+
+			read_window(f.image, window_x - other.x, window_y - other.y, pair.size, pair.first_window);
+			read_window(image, window_x - frame.x, window_y - frame.y, pair.size, pair.second_window);
+
+			pairs.push_back(std::move(pair));
+		}
+
+		loaded_frames.push_back({index, image});
+
+		if (pairs.size() >= MOSAIC_STITCHING_BATCH_SIZE)
+			compare_pairs();
+	}
+
+	compare_pairs();
+
+	// Fit the positions to the offsets (Gauss-Seidel iterations on the least squares problem).
+	std::vector<std::vector<unsigned int>> frame_offsets(frames.size());
+	for (unsigned int i = 0; i < offsets.size(); i++)
+	{
+		frame_offsets[offsets[i].first].push_back(i);
+		frame_offsets[offsets[i].second].push_back(i);
+	}
+
+	for (unsigned int iteration = 0; iteration < 1000; iteration++)
+	{
+		double max_change = 0;
+
+		for (unsigned int i = 0; i < frames.size(); i++)
+		{
+			double sum_weight = MOSAIC_STITCHING_NOMINAL_WEIGHT;
+			double sum_x = MOSAIC_STITCHING_NOMINAL_WEIGHT * frames[i].x;
+			double sum_y = MOSAIC_STITCHING_NOMINAL_WEIGHT * frames[i].y;
+
+			for (unsigned int o : frame_offsets[i])
+			{
+				FrameOffset const& offset = offsets[o];
+
+				if (offset.first == i)
+				{
+					sum_x += offset.weight * (positions_x[offset.second] - offset.dx);
+					sum_y += offset.weight * (positions_y[offset.second] - offset.dy);
+				}
+				else
+				{
+					sum_x += offset.weight * (positions_x[offset.first] + offset.dx);
+					sum_y += offset.weight * (positions_y[offset.first] + offset.dy);
+				}
+
+				sum_weight += offset.weight;
+			}
+
+			const double x = sum_x / sum_weight, y = sum_y / sum_weight;
+			max_change = std::max(max_change, std::max(std::abs(x - positions_x[i]), std::abs(y - positions_y[i])));
+
+			positions_x[i] = x;
+			positions_y[i] = y;
+		}
+
+		if (max_change < 0.01)
+			break;
+	}
+}
+
+void MosaicStitcher::stitch(BackgroundImage_shptr image) const
+{
+	if (image == nullptr)
+		throw InvalidPointerException("Error in stitch(): invalid image pointer.");
+
+	const int width = image->get_width(), height = image->get_height();
+
+	// Weighted sums of the red, green and blue channel and the sum of the weights, per pixel.
+	// Only rows, that following frames can change, are kept.
+	std::deque<std::vector<float>> rows;
+	int first_row = 0;
+
+	auto write_rows = [&](int end_row)
+	{
+		for (; first_row < std::min(end_row, height); first_row++)
+		{
+			std::vector<float> row;
+			if (!rows.empty())
+			{
+				row.swap(rows.front());
+				rows.pop_front();
+			}
+			else
+				row.assign(4 * static_cast<size_t>(width), 0);
+
+			for (int x = 0; x < width; x++)
+			{
+				const float* sum = &row[4 * static_cast<size_t>(x)];
+				if (sum[3] <= 0)
+				{
+					image->set_pixel(x, first_row, 0);
+					continue;
+				}
+
+				const rgba_pixel_t r = lrint(sum[0] / sum[3]), g = lrint(sum[1] / sum[3]), b = lrint(sum[2] / sum[3]);
+				image->set_pixel(x, first_row, MERGE_CHANNELS(r, g, b, 0xff));
+			}
+		}
+	};
+
+	for (unsigned int index : get_frame_order(true))
+	{
+		const int frame_x = lrint(positions_x[index]), frame_y = lrint(positions_y[index]);
+
+		// Frames are sorted by their position, rows above this frame are done.
+		write_rows(frame_y);
+
+		TempImage_RGBA_shptr frame = frame_loader(frames[index]);
+		const int frame_width = frame->get_width(), frame_height = frame->get_height();
+
+		for (int y = std::max(0, -frame_y); y < frame_height && frame_y + y < height; y++)
+		{
+			while (first_row + static_cast<int>(rows.size()) <= frame_y + y)
+				rows.emplace_back(4 * static_cast<size_t>(width), 0);
+
+			std::vector<float>& row = rows[frame_y + y - first_row];
+
+			// The weight decreases towards the frame borders.
+			const float weight_y = std::min(y + 1, frame_height - y);
+
+			for (int x = std::max(0, -frame_x); x < frame_width && frame_x + x < width; x++)
+			{
+				const float weight = weight_y * std::min(x + 1, frame_width - x);
+				const rgba_pixel_t pixel = frame->get_pixel(x, y);
+
+				float* sum = &row[4 * static_cast<size_t>(frame_x + x)];
+				sum[0] += weight * MASK_R(pixel);
+				sum[1] += weight * MASK_G(pixel);
+				sum[2] += weight * MASK_B(pixel);
+				sum[3] += weight;
+			}
+		}
+	}
+
+	write_rows(height);
+}
@@ -0,0 +1,141 @@
+/* -*-c++-*-
+
+ This file is part of the IC reverse engineering tool degate.
+
+ Copyright 2008, 2009, 2010 by Martin Schobert
+
+ Degate is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ any later version.
+
+ Degate is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __MOSAICSTITCHING_H__
+#define __MOSAICSTITCHING_H__
+
+#include "Core/Image/Image.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * Maximum size of the window that is compared in the overlap of two frames (a power of two).
+ */
+#define MOSAIC_STITCHING_MAX_WINDOW_SIZE 256
+
+/**
+ * Minimum size of the window that is compared in the overlap of two frames (a power of two).
+ * Frames with a smaller overlap are not compared.
+ */
+#define MOSAIC_STITCHING_MIN_WINDOW_SIZE 16
+
+/**
+ * Number of frame pairs that are compared at once (in parallel).
+ */
+#define MOSAIC_STITCHING_BATCH_SIZE 64
+
+/**
+ * Minimal height of the phase correlation peak for a frame pair to be used.
+ */
+#define MOSAIC_STITCHING_MIN_PEAK 0.05
+
+/**
+ * Weight of the nominal frame positions, relative to a phase correlation peak of 1.
+ */
+#define MOSAIC_STITCHING_NOMINAL_WEIGHT 0.001
+
+namespace degate
+{
+	/**
+	 * A frame of an image mosaic, e.g. a single microscope image.
+	 */
+	struct MosaicFrame
+	{
+		std::string image_file;
+
+		// nominal position of the upper left corner (e.g. from the microscope stage)
+		int x, y;
+	};
+
+	/**
+	 * Stitch a grid of overlapping frames into one background image.
+	 *
+	 * Frames are processed from top to bottom and each frame is loaded once per pass. Only
+	 * the frames of one frame row and the blended rows, that can still change, are kept,
+	 * so the memory usage does not depend on the number of frames.
+	 */
+	class MosaicStitcher
+	{
+	public:
+
+		typedef std::function<TempImage_RGBA_shptr(MosaicFrame const&)> frame_loader_type;
+
+	private:
+
+		std::vector<MosaicFrame> frames;
+		frame_loader_type frame_loader;
+
+		// refined frame positions
+		std::vector<double> positions_x, positions_y;
+
+		/**
+		 * Get the frame indices, sorted by the nominal (\p refined is false) or refined positions.
+		 */
+		std::vector<unsigned int> get_frame_order(bool refined) const;
+
+	public:
+
+		/**
+		 * Create a stitcher.
+		 * @param frames The frames and their nominal positions.
+		 * @param frame_loader Loads the image of a frame. By default, the image file is loaded.
+		 */
+		MosaicStitcher(std::vector<MosaicFrame> const& frames,
+		               frame_loader_type const& frame_loader = frame_loader_type());
+
+		/**
+		 * Read a frame grid file. Each line describes a frame: the image file name and the
+		 * nominal x and y position, separated by white space. Empty lines and lines starting with '#'
+		 * are ignored. Relative image file names are relative to the directory of the grid file.
+		 * @exception InvalidPathException This exception is thrown, if the file cannot be opened.
+		 * @exception InvalidFileFormatException This exception is thrown, if a line cannot be parsed.
+		 */
+		static std::vector<MosaicFrame> read_frame_grid(std::string const& grid_file);
+
+		/**
+		 * Refine the frame positions. The overlap of neighbouring frames is compared with phase
+		 * correlation (in parallel), then the positions are fitted to the measured offsets and,
+		 * with a low weight, to the nominal positions.
+		 * Without refinement, the nominal positions are used.
+		 */
+		void refine_positions();
+
+		/**
+		 * Get the x position of a frame.
+		 */
+		double get_position_x(unsigned int frame) const { return positions_x.at(frame); }
+
+		/**
+		 * Get the y position of a frame.
+		 */
+		double get_position_y(unsigned int frame) const { return positions_y.at(frame); }
+
+		/**
+		 * Blend the frames into an image. Pixels are weighted by their distance to the frame border,
+		 * so seams fade out. Parts of frames outside of the image are cut off, pixels without frames are black.
+		 */
+		void stitch(BackgroundImage_shptr image) const;
+	};
+}
+
+#endif
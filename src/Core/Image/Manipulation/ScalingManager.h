@@ -177,6 +177,18 @@ namespace degate
 			}
 		}
 
+		/**
+		 * Set the alignment of the images.
+		 * Create the scaled images first, scaled images are created from the aligned image.
+		 * @param alignment The alignment in coordinates of the unscaled image.
+		 * @see StoragePolicy_Tile::set_alignment()
+		 */
+		void set_alignment(AffineTransform const& alignment)
+		{
+			for (typename image_map::iterator iter = images.begin(); iter != images.end(); ++iter)
+				iter->second->set_alignment(alignment.scaled(iter->first));
+		}
+
 		/**
 		 * Get the image with the nearest scaling value to the requested scaling.
 		 * @return Returns a std::pair<double, shared_ptr> with the scaling
@@ -89,6 +89,55 @@ namespace degate
 		typedef gs_byte_pixel_t pixel_type;
 		static bool is_single_channel() { return true; }
 	};
+
+
+	/* -------------------------------------------------------------------------- *
+	 * pixel interpolation
+	 * -------------------------------------------------------------------------- */
+
+	/**
+	 * Bilinear interpolation between the pixels p00 (x, y), p10 (x + 1, y),
+	 * p01 (x, y + 1) and p11 (x + 1, y + 1).
+	 * @param fx The fractional part of the x position.
+	 * @param fy The fractional part of the y position.
+	 */
+	inline gs_double_pixel_t interpolate_pixel(gs_double_pixel_t p00, gs_double_pixel_t p10,
+	                                           gs_double_pixel_t p01, gs_double_pixel_t p11,
+	                                           double fx, double fy)
+	{
+		const double top = p00 + (p10 - p00) * fx;
+		const double bottom = p01 + (p11 - p01) * fx;
+		return top + (bottom - top) * fy;
+	}
+
+	inline gs_byte_pixel_t interpolate_pixel(gs_byte_pixel_t p00, gs_byte_pixel_t p10,
+	                                         gs_byte_pixel_t p01, gs_byte_pixel_t p11,
+	                                         double fx, double fy)
+	{
+		return static_cast<gs_byte_pixel_t>(interpolate_pixel(static_cast<double>(p00), static_cast<double>(p10),
+		                                                      static_cast<double>(p01), static_cast<double>(p11),
+		                                                      fx, fy) + 0.5);
+	}
+
+	/**
+	 * Each channel is interpolated on its own.
+	 */
+	inline rgba_pixel_t interpolate_pixel(rgba_pixel_t p00, rgba_pixel_t p10,
+	                                      rgba_pixel_t p01, rgba_pixel_t p11,
+	                                      double fx, double fy)
+	{
+		rgba_pixel_t result = 0;
+
+		for (unsigned int shift = 0; shift < 32; shift += 8)
+		{
+			result |= static_cast<rgba_pixel_t>(
+				interpolate_pixel(static_cast<gs_byte_pixel_t>(p00 >> shift), static_cast<gs_byte_pixel_t>(p10 >> shift),
+				                  static_cast<gs_byte_pixel_t>(p01 >> shift), static_cast<gs_byte_pixel_t>(p11 >> shift),
+				                  fx, fy)) << shift;
+		}
+
+		return result;
+	}
 }
 
 #endif
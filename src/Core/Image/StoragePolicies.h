@@ -26,6 +26,7 @@
 #include "Core/Utils/MemoryMap.h"
 #include "Core/Configuration.h"
 #include "Core/Utils/FileSystem.h"
+#include "Core/Utils/TempStoragePool.h"
 
 namespace degate
 {
@@ -110,6 +111,14 @@ namespace degate
 		{
 			memory_map.raw_copy(dst_buf);
 		}
+
+		/**
+		 * Copy \p n pixels of row \p src_y, starting at column \p src_x, into a buffer.
+		 */
+		void raw_copy_row(void* dst_buf, unsigned int src_x, unsigned int src_y, unsigned int n) const
+		{
+			memory_map.raw_copy_row(dst_buf, src_x, src_y, n);
+		}
 	};
 
 
@@ -140,6 +149,20 @@ namespace degate
 		{
 		}
 
+	protected:
+
+		/**
+		 * Create a temporary storage, that is either in \p buffer or in a temporary file.
+		 */
+		StoragePolicy_File(unsigned int _width,
+		                   unsigned int _height,
+		                   std::shared_ptr<void> const& buffer) :
+			memory_map(_width, _height, buffer)
+		{
+		}
+
+	public:
+
 		inline typename PixelPolicy::pixel_type get_pixel(unsigned int x,
 		                                                  unsigned int y) const
 		{
@@ -159,11 +182,23 @@ namespace degate
 		{
 			memory_map.raw_copy(dst_buf);
 		}
+
+		/**
+		 * Copy \p n pixels of row \p src_y, starting at column \p src_x, into a buffer.
+		 */
+		void raw_copy_row(void* dst_buf, unsigned int src_x, unsigned int src_y, unsigned int n) const
+		{
+			memory_map.raw_copy_row(dst_buf, src_x, src_y, n);
+		}
 	};
 
 
 	/**
-	 * Storage policy for image objects that are stored in a temporary file.
+	 * Storage policy for temporary image objects.
+	 *
+	 * Small images, and images that fit into the memory budget for temporary
+	 * images, are stored in a memory buffer from the TempStoragePool. Other
+	 * images are stored in a temporary file.
 	 */
 	template <class PixelPolicy>
 	class StoragePolicy_TempFile : public StoragePolicy_File<PixelPolicy>
@@ -172,13 +207,24 @@ namespace degate
 		StoragePolicy_TempFile(unsigned int _width,
 		                       unsigned int _height) :
 			StoragePolicy_File<PixelPolicy>(_width, _height,
-			                                generate_temp_file_pattern(),
-			                                false)
+			                                TempStoragePool::get_instance().acquire(
+				                                static_cast<size_t>(_width) * _height *
+				                                sizeof(typename PixelPolicy::pixel_type)))
 		{
 		}
 
 		virtual ~StoragePolicy_TempFile()
 		{
+			if (is_stored_in_file())
+				TempStoragePool::get_instance().release_temp_file();
+		}
+
+		/**
+		 * Check if the image is stored in a temporary file.
+		 */
+		bool is_stored_in_file() const
+		{
+			return !this->memory_map.get_filename().empty();
 		}
 	};
 
@@ -24,17 +24,26 @@
 
 #include "Core/Utils/MemoryMap.h"
 #include "Core/Utils/FileSystem.h"
+#include "Core/Image/TilePack.h"
+#include "Core/Image/CompressedTilePack.h"
 #include "Core/Configuration.h"
 
+#include <algorithm>
+#include <atomic>
 #include <string>
 #include <map>
 #include <memory>
+#include <vector>
 #include <ctime>
 #include <utility> // for make_pair
 #include <iostream>
 #include <iomanip>
 
 #include <chrono>
+#include <cstdlib>
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/recursive_mutex.hpp>
 
 static void get_clock(struct timespec* ts)
 {
@@ -56,6 +65,12 @@ static void get_clock(struct timespec* ts)
 
 // #define TILECACHE_DEBUG
 
+/**
+ * The number of tiles that are decompressed ahead of time in the direction
+ * of tile accesses (compressed tiles only).
+ */
+#define TILE_CACHE_READ_AHEAD 2
+
 /**
  * Overloaded comparison operator for timespec-structs.
  * @return Returns true, if \p a is completely before \p b. Else
@@ -73,10 +88,25 @@ namespace degate
 	class TileCacheBase
 	{
 	public:
-		virtual void cleanup_cache() = 0;
+		/**
+		 * Remove the oldest tile from the cache.
+		 * @return Returns false, if there was no tile to remove.
+		 */
+		virtual bool cleanup_cache() = 0;
 		virtual void print() const = 0;
 	};
 
+	/**
+	 * The GlobalTileCache limits the memory used by all tile caches.
+	 *
+	 * If a tile cache needs memory, the least recently used tile caches
+	 * release their oldest tiles. Because of this, tile caches can be changed
+	 * from any thread that reads an image.
+	 *
+	 * The global cache has its own mutex, it is held while tile caches release
+	 * tiles. A tile cache must therefore not call the global cache while it
+	 * holds its own mutex.
+	 */
 	class GlobalTileCache : public SingletonBase<GlobalTileCache>
 	{
 		friend class SingletonBase<GlobalTileCache>;
@@ -91,6 +121,9 @@ namespace degate
 
 		cache_t cache;
 
+		// Recursive, a tile cache that requests memory might be asked to release memory.
+		mutable boost::recursive_mutex mutex;
+
 	private:
 
 		GlobalTileCache() : allocated_memory(0)
@@ -99,44 +132,46 @@ namespace degate
 			max_cache_memory = conf.get_max_tile_cache_size() * 1024 * 1024;
 		}
 
-		void remove_oldest()
+		/**
+		 * Remove the oldest tile of the least recently used tile cache.
+		 * @return Returns false, if no tile cache had a tile to remove. Tile caches
+		 *   that are still loading their tiles hold memory, but have no tiles yet.
+		 */
+		bool remove_oldest()
 		{
-			struct timespec now;
-			GET_CLOCK(now);
-
-			TileCacheBase* oldest = nullptr;
-
+			std::vector<std::pair<struct timespec, TileCacheBase*>> holders;
 			for (cache_t::iterator iter = cache.begin(); iter != cache.end(); ++iter)
-			{
-				cache_entry_t& entry = iter->second;
-				if (entry.first < now)
-				{
-					now.tv_sec = entry.first.tv_sec;
-					now.tv_nsec = entry.first.tv_nsec;
-					oldest = iter->first;
-				}
-			}
+				holders.push_back(std::make_pair(iter->second.first, iter->first));
+
+			std::sort(holders.begin(), holders.end(),
+			          [](std::pair<struct timespec, TileCacheBase*> const& a,
+			             std::pair<struct timespec, TileCacheBase*> const& b)
+			          {
+				          return a.first < b.first;
+			          });
 
-			if (oldest)
+			for (auto const& holder : holders)
 			{
 #ifdef TILECACHE_DEBUG
-	debug(TM, "Will call cleanup on %p", oldest);
+	debug(TM, "Will call cleanup on %p", holder.second);
 #endif
-				oldest->cleanup_cache();
+				if (holder.second->cleanup_cache())
+					return true;
 			}
-			else
-			{
+
 #ifdef TILECACHE_DEBUG
 	debug(TM, "there is nothing to free.");
 	print_table();
 #endif
-			}
+			return false;
 		}
 
 	public:
 
 		void print_table() const
 		{
+			boost::recursive_mutex::scoped_lock lock(mutex);
+
 			std::cout << "Global Image Tile Cache:\n"
 				<< "Used memory : " << allocated_memory << " bytes\n"
 				<< "Max memory  : " << max_cache_memory << " bytes\n\n"
@@ -160,50 +195,52 @@ namespace degate
 
 		bool request_cache_memory(TileCacheBase* requestor, size_t amount)
 		{
+			boost::recursive_mutex::scoped_lock lock(mutex);
+
 #ifdef TILECACHE_DEBUG
       debug(TM, "Local cache %p requests %d bytes.", requestor, amount);
 #endif
-			while (allocated_memory + amount > max_cache_memory)
+			bool freed = true;
+			while (allocated_memory + amount > max_cache_memory && freed)
 			{
 #ifdef TILECACHE_DEBUG
 	debug(TM, "Try to free memory");
 #endif
-				remove_oldest();
+				freed = remove_oldest();
 			}
 
-			if (allocated_memory + amount <= max_cache_memory)
-			{
-				struct timespec now;
-				GET_CLOCK(now);
+			// The memory is taken in any case. Tiles that are loaded right now
+			// can't be removed, the limit is exceeded until they are cached.
+			if (!freed)
+				debug(TM, "Can't free memory, the tile cache exceeds its limit.");
 
-				cache_t::iterator found = cache.find(requestor);
-				if (found == cache.end())
-				{
-					cache[requestor] = std::make_pair(now, amount);
-				}
-				else
-				{
-					cache_entry_t& entry = found->second;
-					entry.first.tv_sec = now.tv_sec;
-					entry.first.tv_nsec = now.tv_nsec;
-					entry.second += amount;
-				}
+			struct timespec now;
+			GET_CLOCK(now);
+
+			cache_t::iterator found = cache.find(requestor);
+			if (found == cache.end())
+			{
+				cache[requestor] = std::make_pair(now, amount);
+			}
+			else
+			{
+				cache_entry_t& entry = found->second;
+				entry.first.tv_sec = now.tv_sec;
+				entry.first.tv_nsec = now.tv_nsec;
+				entry.second += amount;
+			}
 
-				allocated_memory += amount;
+			allocated_memory += amount;
 #ifdef TILECACHE_DEBUG
 	print_table();
 #endif
-				return true;
-			}
-
-			debug(TM, "Can't free memory.");
-
-			print_table();
-			return false;
+			return freed;
 		}
 
 		void release_cache_memory(TileCacheBase* requestor, size_t amount)
 		{
+			boost::recursive_mutex::scoped_lock lock(mutex);
+
 #ifdef TILECACHE_DEBUG
       debug(TM, "Local cache %p releases %d bytes.", requestor, amount);
 #endif
@@ -250,6 +287,16 @@ namespace degate
 	};
 
 
+	/**
+	 * The way a TileCache stores its tiles.
+	 */
+	enum TILE_STORAGE_TYPE
+	{
+		TILE_STORAGE_TYPE_FILES = 0,      // One file per tile, as written by older versions.
+		TILE_STORAGE_TYPE_PACK = 1,       // A TilePack file.
+		TILE_STORAGE_TYPE_COMPRESSED = 2, // A CompressedTilePack file.
+	};
+
 	/**
 	 * The TileCache class handles caching of image tiles.
 	 *
@@ -260,6 +307,23 @@ namespace degate
 	 * requirement is around
 	 * \p _min_cache_tiles*sizeof(PixelPolicy::pixel_type)*(2^_tile_width_exp)^2 ,
 	 * where \p sizeof(PixelPolicy::pixel_type) is the size of a pixel.
+	 *
+	 * Tiles are stored in a single TilePack file per directory. Directories
+	 * from older degate versions, that store one file per tile, are still
+	 * read and written in their original format.
+	 *
+	 * Persistent images can be stored compressed (see CompressedTilePack and
+	 * Configuration::use_tile_compression()). Cached tiles are then held
+	 * decompressed, modified tiles are compressed again when they leave the
+	 * cache. The direction of tile accesses is tracked and the next tiles in
+	 * that direction are decompressed ahead of time.
+	 *
+	 * A tile cache can be used from several threads. Each thread remembers the
+	 * last tile it got, it is returned again without locking while it stays in
+	 * the cache. Otherwise the cache mutex is only held to look up and to add
+	 * tiles, tiles are loaded and written back without it. Returned tiles stay
+	 * valid while they are referenced, even if they are removed from the cache
+	 * meanwhile.
 	 */
 
 	template <class PixelPolicy>
@@ -270,20 +334,95 @@ namespace degate
 	private:
 
 		typedef std::shared_ptr<MemoryMap<typename PixelPolicy::pixel_type>> MemoryMap_shptr;
+
+		struct cache_entry
+		{
+			MemoryMap_shptr tile;
+			struct timespec last_access;
+			unsigned int tile_num_x, tile_num_y;
+			bool modified;
+		};
+
 		typedef std::map<std::string, // filename
-		                 std::pair<MemoryMap_shptr, struct timespec>> cache_type;
+		                 cache_entry> cache_type;
+
+		/**
+		 * The last tile a thread got from a tile cache. It is valid while the
+		 * generation of the tile cache is unchanged (@see generation).
+		 */
+		struct current_tile_slot
+		{
+			unsigned long generation;
+			unsigned int tile_num_x, tile_num_y;
+			bool writable;
+			std::weak_ptr<MemoryMap<typename PixelPolicy::pixel_type>> tile;
+		};
 
 		const std::string directory;
 		const unsigned int tile_width_exp;
 		const bool persistent;
 
+		// Number of tiles in a row and in a column.
+		const unsigned int tiles_x;
+		const unsigned int tiles_y;
+
+		const TILE_STORAGE_TYPE storage_type;
+
+		// The tile pack file. It is opened with the first tile access.
+		TilePack_shptr pack;
+		CompressedTilePack_shptr compressed_pack;
+
 		cache_type cache;
 
-		// Used for caching the working tile.
-		mutable MemoryMap_shptr current_tile;
-		mutable unsigned curr_tile_num_x;
-		mutable unsigned curr_tile_num_y;
+		// Modified tiles that were removed from the cache and are written back right now.
+		std::map<std::string, MemoryMap_shptr> storing;
+
+		// Incremented when a modified tile is removed from the cache. A tile that
+		// was loaded meanwhile might be outdated.
+		unsigned long stores;
 
+		// The last loaded tile, it gives the access direction for read-ahead.
+		int last_loaded_x;
+		int last_loaded_y;
+
+		// Changes if tiles leave the cache. The values are unique among all tile caches.
+		std::atomic<unsigned long> generation;
+
+		// Guards the cache, never held while the GlobalTileCache is called.
+		mutable boost::mutex mutex;
+
+		/**
+		 * Select the storage type for a directory. Existing directories keep their format.
+		 */
+		static TILE_STORAGE_TYPE get_storage_type(std::string const& directory, bool persistent)
+		{
+			if (TilePack::is_tile_file_directory(directory)) return TILE_STORAGE_TYPE_FILES;
+			if (CompressedTilePack::is_compressed_tile_pack_directory(directory)) return TILE_STORAGE_TYPE_COMPRESSED;
+			if (TilePack::is_tile_pack_directory(directory)) return TILE_STORAGE_TYPE_PACK;
+
+			if (persistent && Configuration::get_instance().use_tile_compression())
+				return TILE_STORAGE_TYPE_COMPRESSED;
+
+			return TILE_STORAGE_TYPE_PACK;
+		}
+
+		/**
+		 * Get a new generation value.
+		 */
+		static unsigned long next_generation()
+		{
+			static std::atomic<unsigned long> last_generation(0);
+			return ++last_generation;
+		}
+
+		/**
+		 * Get the last tile of the calling thread.
+		 */
+		static current_tile_slot& get_current_tile_slot()
+		{
+			static thread_local current_tile_slot slot = current_tile_slot();
+			return slot;
+		}
 
 	public:
 
@@ -292,15 +431,26 @@ namespace degate
 		 * @param _directory The directory where all the tiles are for a TileImage.
 		 * @param _tile_width_exp
 		 * @param _persistent
+		 * @param _tiles_x The number of tiles in a row.
+		 * @param _tiles_y The number of tiles in a column.
 		 */
 
 		TileCache(std::string const& _directory,
 		          unsigned int _tile_width_exp,
 		          bool _persistent,
+		          unsigned int _tiles_x,
+		          unsigned int _tiles_y,
 		          unsigned int _min_cache_tiles = 4) :
 			directory(_directory),
 			tile_width_exp(_tile_width_exp),
-			persistent(_persistent)
+			persistent(_persistent),
+			tiles_x(_tiles_x),
+			tiles_y(_tiles_y),
+			storage_type(get_storage_type(_directory, _persistent)),
+			stores(0),
+			last_loaded_x(-1),
+			last_loaded_y(-1),
+			generation(next_generation())
 		{
 		}
 
@@ -315,26 +465,52 @@ namespace degate
 
 		void release_memory()
         {
-            if (cache.size() > 0)
+            cache_type entries;
+            CompressedTilePack_shptr compressed;
+
             {
+                boost::mutex::scoped_lock lock(mutex);
+
+                entries.swap(cache);
+                generation = next_generation();
+                compressed = compressed_pack;
+
+                // Tiles that are still in use keep the pack alive.
+                pack.reset();
+                compressed_pack.reset();
+            }
+
+            if (entries.size() > 0)
+            {
+                for (typename cache_type::iterator iter = entries.begin(); iter != entries.end(); ++iter)
+                    store(iter->second, compressed);
+
                 GlobalTileCache& gtc = GlobalTileCache::get_instance();
-                gtc.release_cache_memory(this, cache.size() * get_image_size());
-                current_tile.reset();
-                cache.clear();
+                gtc.release_cache_memory(this, entries.size() * get_image_size());
             }
         }
 
+		/**
+		 * Get the way tiles are stored.
+		 */
+		TILE_STORAGE_TYPE get_storage_type() const
+		{
+			return storage_type;
+		}
+
 		void print() const override
 		{
+			boost::mutex::scoped_lock lock(mutex);
+
 			for (typename cache_type::const_iterator iter = cache.begin();
 			     iter != cache.end(); ++iter)
 			{
 				std::cout << "\t+ "
 					<< directory << "/"
 					<< (*iter).first << " "
-					<< (*iter).second.second.tv_sec
+					<< (*iter).second.last_access.tv_sec
 					<< "/"
-					<< (*iter).second.second.tv_nsec
+					<< (*iter).second.last_access.tv_nsec
 					<< std::endl;
 			}
 		}
@@ -350,82 +526,230 @@ namespace degate
 		std::shared_ptr<MemoryMap<typename PixelPolicy::pixel_type>>
 		inline get_tile(unsigned int x, unsigned int y)
 		{
-			unsigned int tile_num_x = x >> tile_width_exp;
-			unsigned int tile_num_y = y >> tile_width_exp;
+			return get_tile(x, y, false);
+		}
+
+		/**
+		 * Get a tile that will be modified.
+		 *
+		 * @see get_tile()
+		 */
+
+		std::shared_ptr<MemoryMap<typename PixelPolicy::pixel_type>>
+		inline get_tile_for_writing(unsigned int x, unsigned int y)
+		{
+			return get_tile(x, y, true);
+		}
+
+	protected:
+
+		/**
+		 * Remove the oldest entry from the cache.
+		 */
+		bool cleanup_cache() override
+		{
+			std::string filename;
+			cache_entry entry;
+			CompressedTilePack_shptr compressed;
 
-			if (!(current_tile != nullptr &&
-				tile_num_x == curr_tile_num_x &&
-				tile_num_y == curr_tile_num_y))
 			{
-				// create a file name from tile number
-				char filename[PATH_MAX];
-				snprintf(filename, sizeof(filename), "%d_%d.dat", tile_num_x, tile_num_y);
-				//debug(TM, "filename is: [%s]", filename);
+				boost::mutex::scoped_lock lock(mutex);
+
+				if (cache.size() == 0) return false;
+
+				struct timespec oldest_clock_val;
+				GET_CLOCK(oldest_clock_val);
+
+				typename cache_type::iterator oldest = cache.begin();
+
+				for (typename cache_type::iterator iter = cache.begin();
+				     iter != cache.end(); ++iter)
+				{
+					struct timespec clock_val = (*iter).second.last_access;
+					if (clock_val < oldest_clock_val)
+					{
+						oldest_clock_val.tv_sec = clock_val.tv_sec;
+						oldest_clock_val.tv_nsec = clock_val.tv_nsec;
+						oldest = iter;
+					}
+				}
+
+				assert(oldest != cache.end());
 
-				// if filename/ object is not in cache, load the tile
-				typename cache_type::const_iterator iter = cache.find(filename);
+				// The tile must not be modified by threads that got it before.
+				generation = next_generation();
 
-				if (iter == cache.end())
+				filename = (*oldest).first;
+				entry = (*oldest).second;
+				cache.erase(oldest);
+
+				// Until it is written, the tile is taken from here if it is needed again.
+				if (needs_store(entry))
 				{
-					//cleanup_cache();
-					GlobalTileCache& gtc = GlobalTileCache::get_instance();
-					bool ok = gtc.request_cache_memory(this, get_image_size());
-					assert(ok == true);
-					struct timespec now;
-					GET_CLOCK(now);
-
-					cache[filename] = std::make_pair(load(filename), now);
+					compressed = compressed_pack;
+					storing[filename] = entry.tile;
+					stores++;
+				}
+			}
 #ifdef TILECACHE_DEBUG
-	  gtc.print_table();
+      debug(TM, "local cache: %d entries after remove\n", cache.size());
 #endif
-				}
 
-				current_tile = cache[filename].first;
-				curr_tile_num_x = tile_num_x;
-				curr_tile_num_y = tile_num_y;
+			if (compressed != nullptr)
+			{
+				store(entry, compressed);
+
+				boost::mutex::scoped_lock lock(mutex);
+				storing.erase(filename);
 			}
 
-			return current_tile;
+			entry.tile.reset(); // explicit reset of smart pointer
+
+			GlobalTileCache& gtc = GlobalTileCache::get_instance();
+			gtc.release_cache_memory(this, get_image_size());
+
+			return true;
 		}
 
-	protected:
+
+	private:
 
 		/**
-		 * Remove the oldest entry from the cache.
+		 * Get a tile, @see get_tile().
+		 * @param for_writing Mark the tile as modified.
 		 */
-		void cleanup_cache() override
+		MemoryMap_shptr get_tile(unsigned int x, unsigned int y, bool for_writing)
 		{
-			if (cache.size() == 0) return;
+			const unsigned int tile_num_x = x >> tile_width_exp;
+			const unsigned int tile_num_y = y >> tile_width_exp;
+
+			// The working tile of this thread.
+			current_tile_slot& slot = get_current_tile_slot();
+			if (slot.generation == generation.load() &&
+				slot.tile_num_x == tile_num_x && slot.tile_num_y == tile_num_y &&
+				(slot.writable || !for_writing))
+			{
+				MemoryMap_shptr tile = slot.tile.lock();
+				if (tile != nullptr)
+					return tile;
+			}
 
-			struct timespec oldest_clock_val;
-			GET_CLOCK(oldest_clock_val);
+			// create a file name from tile number, it is also used as key for packed tiles
+			char filename[PATH_MAX];
+			snprintf(filename, sizeof(filename), "%d_%d.dat", tile_num_x, tile_num_y);
 
-			typename cache_type::iterator oldest = cache.begin();
+			MemoryMap_shptr cached_tile = find_tile(filename, for_writing, slot);
+			if (cached_tile != nullptr)
+				return cached_tile;
 
-			for (typename cache_type::iterator iter = cache.begin();
-			     iter != cache.end(); ++iter)
+			GlobalTileCache& gtc = GlobalTileCache::get_instance();
+			gtc.request_cache_memory(this, get_image_size());
+
+			while (true)
 			{
-				struct timespec clock_val = (*iter).second.second;
-				if (clock_val < oldest_clock_val)
+				MemoryMap_shptr tile;
+				unsigned long stores_before;
+				std::vector<std::pair<int, int>> read_ahead;
+
 				{
-					oldest_clock_val.tv_sec = clock_val.tv_sec;
-					oldest_clock_val.tv_nsec = clock_val.tv_nsec;
-					oldest = iter;
+					boost::mutex::scoped_lock lock(mutex);
+
+					stores_before = stores;
+
+					typename std::map<std::string, MemoryMap_shptr>::iterator found = storing.find(filename);
+					if (found != storing.end())
+						tile = found->second;
+					else
+						prepare_load(tile_num_x, tile_num_y, read_ahead);
 				}
-			}
 
-			assert(oldest != cache.end());
-			(*oldest).second.first.reset(); // explicit reset of smart pointer
-			cache.erase(oldest);
+				const bool loaded = tile == nullptr;
+
+				if (loaded)
+				{
+					switch (storage_type)
+					{
+					case TILE_STORAGE_TYPE_FILES:
+						tile = load(filename);
+						break;
+					case TILE_STORAGE_TYPE_PACK:
+						tile = load(tile_num_x, tile_num_y);
+						break;
+					case TILE_STORAGE_TYPE_COMPRESSED:
+						tile = load_compressed(tile_num_x, tile_num_y, read_ahead);
+						break;
+					}
+				}
+
+				bool cached;
+
+				{
+					boost::mutex::scoped_lock lock(mutex);
+
+					typename cache_type::iterator iter = cache.find(filename);
+					cached = iter != cache.end();
+
+					if (!cached)
+					{
+						// A modified tile was written while the tile was loaded, load it again.
+						if (loaded && stores != stores_before && storage_type == TILE_STORAGE_TYPE_COMPRESSED)
+							continue;
+
+						cache_entry entry;
+						GET_CLOCK(entry.last_access);
+						entry.tile_num_x = tile_num_x;
+						entry.tile_num_y = tile_num_y;
+						entry.modified = !loaded; // a tile that is written right now
+						entry.tile = tile;
+
+						iter = cache.insert(std::make_pair(std::string(filename), entry)).first;
+					}
+
+					use_entry(iter->second, for_writing, slot);
+					tile = iter->second.tile;
+				}
+
+				// An other thread loaded the tile meanwhile.
+				if (cached)
+					gtc.release_cache_memory(this, get_image_size());
+
 #ifdef TILECACHE_DEBUG
-      debug(TM, "local cache: %d entries after remove\n", cache.size());
+	  gtc.print_table();
 #endif
-			GlobalTileCache& gtc = GlobalTileCache::get_instance();
-			gtc.release_cache_memory(this, get_image_size());
+				return tile;
+			}
 		}
 
+		/**
+		 * Look up a tile in the cache and make it the working tile of the thread.
+		 * @return Returns nullptr, if the tile is not in the cache.
+		 */
+		MemoryMap_shptr find_tile(std::string const& filename, bool for_writing, current_tile_slot& slot)
+		{
+			boost::mutex::scoped_lock lock(mutex);
 
-	private:
+			typename cache_type::iterator iter = cache.find(filename);
+			if (iter == cache.end())
+				return MemoryMap_shptr();
+
+			use_entry(iter->second, for_writing, slot);
+			return iter->second.tile;
+		}
+
+		/**
+		 * Make a cache entry the working tile of the calling thread. The cache mutex must be held.
+		 */
+		void use_entry(cache_entry& entry, bool for_writing, current_tile_slot& slot)
+		{
+			if (for_writing)
+				entry.modified = true;
+
+			slot.generation = generation.load();
+			slot.tile_num_x = entry.tile_num_x;
+			slot.tile_num_y = entry.tile_num_y;
+			slot.writable = entry.modified;
+			slot.tile = entry.tile;
+		}
 
 		/**
 		 * Get image size in bytes.
@@ -435,6 +759,55 @@ namespace degate
 			return sizeof(typename PixelPolicy::pixel_type) * (1 << tile_width_exp) * (1 << tile_width_exp);
 		}
 
+		/**
+		 * Open the tile pack file and get the tiles to read ahead. The cache mutex must be held.
+		 */
+		void prepare_load(unsigned int tile_num_x, unsigned int tile_num_y,
+		                  std::vector<std::pair<int, int>>& read_ahead)
+		{
+			if (storage_type == TILE_STORAGE_TYPE_PACK && pack == nullptr)
+			{
+				if (!file_exists(directory)) create_directory(directory);
+
+				pack = std::make_shared<TilePack>(join_pathes(directory, TILE_PACK_FILENAME),
+				                                  tile_width_exp, tiles_x, tiles_y,
+				                                  sizeof(typename PixelPolicy::pixel_type),
+				                                  persistent);
+			}
+
+			if (storage_type != TILE_STORAGE_TYPE_COMPRESSED)
+				return;
+
+			if (compressed_pack == nullptr)
+			{
+				if (!file_exists(directory)) create_directory(directory);
+
+				compressed_pack = std::make_shared<CompressedTilePack>(
+					join_pathes(directory, COMPRESSED_TILE_PACK_FILENAME),
+					tile_width_exp, tiles_x, tiles_y,
+					sizeof(typename PixelPolicy::pixel_type));
+			}
+
+			// Read ahead, if the tile is a neighbour of the last loaded tile.
+			int dx = static_cast<int>(tile_num_x) - last_loaded_x;
+			int dy = static_cast<int>(tile_num_y) - last_loaded_y;
+
+			if (last_loaded_x >= 0 && (dx != 0 || dy != 0) && abs(dx) <= 1 && abs(dy) <= 1)
+			{
+				for (int i = 1; i <= TILE_CACHE_READ_AHEAD; i++)
+				{
+					int next_x = static_cast<int>(tile_num_x) + i * dx;
+					int next_y = static_cast<int>(tile_num_y) + i * dy;
+
+					if (next_x >= 0 && next_y >= 0 && !is_cached(next_x, next_y))
+						read_ahead.push_back(std::make_pair(next_x, next_y));
+				}
+			}
+
+			last_loaded_x = tile_num_x;
+			last_loaded_y = tile_num_y;
+		}
+
 		/**
 		 * Load a tile from an image file.
 		 * @param filename Just the name of the file to load. The filename is
@@ -452,6 +825,91 @@ namespace degate
 
 			return mem;
 		}
+
+		/**
+		 * Load a tile from the tile pack file. The tile is a view into the mapped
+		 * file. If the last reference to the tile is dropped, the kernel is told
+		 * that the memory can be released.
+		 */
+		std::shared_ptr<MemoryMap<typename PixelPolicy::pixel_type>>
+		load(unsigned int tile_num_x, unsigned int tile_num_y) const
+		{
+			TilePack_shptr tile_pack;
+			{
+				boost::mutex::scoped_lock lock(mutex);
+				tile_pack = pack;
+			}
+
+			TilePack* p = tile_pack.get();
+			typename PixelPolicy::pixel_type* data =
+				static_cast<typename PixelPolicy::pixel_type*>(p->get_tile(tile_num_x, tile_num_y));
+
+			return MemoryMap_shptr(new MemoryMap<typename PixelPolicy::pixel_type>
+			                       (1 << tile_width_exp, 1 << tile_width_exp, data, tile_pack),
+			                       [p, tile_num_x, tile_num_y](MemoryMap<typename PixelPolicy::pixel_type>* mem)
+			                       {
+				                       // The view holds the pack, release the tile before it is gone.
+				                       p->release_tile(tile_num_x, tile_num_y);
+				                       delete mem;
+			                       });
+		}
+
+		/**
+		 * Decompress a tile from the compressed tile pack file into memory and
+		 * decompress the tiles in \p read_ahead ahead of time.
+		 */
+		std::shared_ptr<MemoryMap<typename PixelPolicy::pixel_type>>
+		load_compressed(unsigned int tile_num_x, unsigned int tile_num_y,
+		                std::vector<std::pair<int, int>> const& read_ahead) const
+		{
+			CompressedTilePack_shptr compressed;
+			{
+				boost::mutex::scoped_lock lock(mutex);
+				compressed = compressed_pack;
+			}
+
+			MemoryMap_shptr mem(new MemoryMap<typename PixelPolicy::pixel_type>
+				(1 << tile_width_exp, 1 << tile_width_exp));
+
+			compressed->read_tile(tile_num_x, tile_num_y, mem->get_pointer(0, 0));
+
+			for (auto const& next : read_ahead)
+				compressed->prefetch(next.first, next.second);
+
+			return mem;
+		}
+
+		/**
+		 * Check if a tile is in the cache. The cache mutex must be held.
+		 */
+		bool is_cached(unsigned int tile_num_x, unsigned int tile_num_y) const
+		{
+			char filename[PATH_MAX];
+			snprintf(filename, sizeof(filename), "%d_%d.dat", tile_num_x, tile_num_y);
+			return cache.find(filename) != cache.end();
+		}
+
+		/**
+		 * Check if a tile must be written back when it leaves the cache.
+		 */
+		bool needs_store(cache_entry const& entry) const
+		{
+			return storage_type == TILE_STORAGE_TYPE_COMPRESSED && entry.modified;
+		}
+
+		/**
+		 * Write a modified tile back to the compressed tile pack file. The tile
+		 * is compressed on a worker thread. For other storage types tiles are
+		 * mapped files, modifications are written by the system.
+		 */
+		void store(cache_entry& entry, CompressedTilePack_shptr const& compressed)
+		{
+			if (needs_store(entry) && compressed != nullptr)
+			{
+				compressed->write_tile(entry.tile_num_x, entry.tile_num_y, entry.tile->get_pointer(0, 0));
+				entry.modified = false;
+			}
+		}
 	}; // end of class TileCache
 }
 
@@ -26,8 +26,20 @@
 #include "PixelPolicies.h"
 #include "StoragePolicies.h"
 #include "Core/Utils/FileSystem.h"
+#include "Core/Primitive/AffineTransform.h"
 #include "TileCache.h"
 
+#include <atomic>
+#include <cmath>
+#include <list>
+
+/**
+ * The number of aligned tiles, that are kept in memory per image.
+ *
+ * @see StoragePolicy_Tile::set_alignment()
+ */
+#define TILE_ALIGNMENT_CACHE_SIZE 8
+
 namespace degate
 {
 	/**
@@ -60,6 +72,20 @@ namespace degate
 
 		unsigned int tiles_number;
 
+		// The size of the image in pixels, rounded up to full tiles.
+		unsigned int padded_width, padded_height;
+
+		// Alignment of the image and its inverse (@see set_alignment()).
+		// The alignment and the aligned tiles are guarded by the alignment mutex,
+		// the flag is checked first, so reads of unaligned images don't lock it.
+		AffineTransform alignment, inverse_alignment;
+		std::atomic<bool> aligned;
+		mutable boost::mutex alignment_mutex;
+
+		// Aligned tiles, the most recently used first.
+		typedef std::list<std::pair<std::pair<unsigned int, unsigned int>, MemoryMap_shptr>> aligned_tile_list;
+		mutable aligned_tile_list aligned_tiles;
+
 	private:
 
 
@@ -91,9 +117,9 @@ namespace degate
 		 *
 		 * @param _width The minimum width of the image.
 		 * @param _height The minimum height of the image.
-		 * @param _directory A tile based image is stored in multiple
-		 *      files. This directory specifies the place where
-		 *      the files are stored. If the directory doen't exits, it is created.
+		 * @param _directory A tile based image is stored in a tile pack file
+		 *      (see TilePack). This directory specifies the place where
+		 *      the file is stored. If the directory doen't exits, it is created.
 		 * @param _persistent This boolean value indicates whether the image files
 		 *      are removed on object destruction.
 		 * @param _tile_width_exp The width (and height) for image tiles. This
@@ -109,12 +135,18 @@ namespace degate
 			tile_width_exp(_tile_width_exp),
 			offset_bitmask((1 << _tile_width_exp) - 1),
 			directory(_directory),
-			tile_cache(_directory, _tile_width_exp, _persistent)
+			tile_cache(_directory, _tile_width_exp, _persistent,
+			           (_width + (1 << _tile_width_exp) - 1) >> _tile_width_exp,
+			           (_height + (1 << _tile_width_exp) - 1) >> _tile_width_exp)
 		{
 			if (!file_exists(_directory)) create_directory(_directory);
 
 			double temp_tile_size = 1 << _tile_width_exp;
 			tiles_number = static_cast<unsigned>(ceil(static_cast<double>(_width) / temp_tile_size)) * static_cast<unsigned>(ceil(static_cast<double>(_height) / temp_tile_size));
+
+			padded_width = calc_real_size(_width, _tile_width_exp);
+			padded_height = calc_real_size(_height, _tile_width_exp);
+			aligned = false;
 		}
 
 		/**
@@ -151,6 +183,28 @@ namespace degate
 		 */
 		bool is_persistent() const { return persistent; }
 
+		/**
+		 * Set the alignment of the image. The alignment maps image coordinates to aligned
+		 * coordinates. Pixels are then read in aligned coordinates: aligned tiles are
+		 * interpolated from the image tiles on first access, the image itself is not
+		 * changed. Pixels are still written in image coordinates.
+		 * @exception DegateRuntimeException This exception is thrown, if the alignment is not invertible.
+		 */
+		void set_alignment(AffineTransform const& new_alignment)
+		{
+			boost::mutex::scoped_lock lock(alignment_mutex);
+
+			inverse_alignment = new_alignment.inverse();
+			alignment = new_alignment;
+			aligned = !alignment.is_identity();
+			aligned_tiles.clear();
+		}
+
+		/**
+		 * Get the alignment of the image.
+		 */
+		AffineTransform const& get_alignment() const { return alignment; }
+
 
 		inline typename PixelPolicy::pixel_type get_pixel(unsigned int x, unsigned int y) const;
 
@@ -161,9 +215,126 @@ namespace degate
 		 */
 		void raw_copy(void* dst_buf, unsigned int src_x, unsigned int src_y) const
 		{
-			MemoryMap_shptr mem = tile_cache.get_tile(src_x, src_y);
+			MemoryMap_shptr mem = get_tile_for_reading(src_x, src_y);
 			mem->raw_copy(dst_buf);
 		}
+
+		/**
+		 * Copy \p n pixels of row \p src_y, starting at column \p src_x, into a buffer.
+		 * The row might span multiple tiles. Each touched tile is copied with a single memcpy.
+		 */
+		void raw_copy_row(void* dst_buf, unsigned int src_x, unsigned int src_y, unsigned int n) const
+		{
+			typename PixelPolicy::pixel_type* dst = static_cast<typename PixelPolicy::pixel_type*>(dst_buf);
+
+			while (n > 0)
+			{
+				unsigned int offset_x = src_x & offset_bitmask;
+				unsigned int chunk = std::min(n, get_tile_size() - offset_x);
+
+				MemoryMap_shptr mem = get_tile_for_reading(src_x, src_y);
+				mem->raw_copy_row(dst, offset_x, src_y & offset_bitmask, chunk);
+
+				dst += chunk;
+				src_x += chunk;
+				n -= chunk;
+			}
+		}
+
+	private:
+
+		/**
+		 * Get the tile, that holds pixel (x, y), for reading. If the image is aligned,
+		 * this is the aligned tile.
+		 */
+		inline MemoryMap_shptr get_tile_for_reading(unsigned int x, unsigned int y) const
+		{
+			if (!aligned)
+				return tile_cache.get_tile(x, y);
+
+			boost::mutex::scoped_lock lock(alignment_mutex);
+			return aligned ? get_aligned_tile(x, y) : tile_cache.get_tile(x, y);
+		}
+
+		MemoryMap_shptr get_aligned_tile(unsigned int x, unsigned int y) const
+		{
+			const std::pair<unsigned int, unsigned int> key(x >> tile_width_exp, y >> tile_width_exp);
+
+			if (!aligned_tiles.empty() && aligned_tiles.front().first == key)
+				return aligned_tiles.front().second;
+
+			for (typename aligned_tile_list::iterator iter = aligned_tiles.begin();
+			     iter != aligned_tiles.end(); ++iter)
+			{
+				if (iter->first == key)
+				{
+					aligned_tiles.splice(aligned_tiles.begin(), aligned_tiles, iter);
+					return iter->second;
+				}
+			}
+
+			MemoryMap_shptr tile = create_aligned_tile(key.first, key.second);
+
+			aligned_tiles.push_front(std::make_pair(key, tile));
+			if (aligned_tiles.size() > TILE_ALIGNMENT_CACHE_SIZE)
+				aligned_tiles.pop_back();
+
+			return tile;
+		}
+
+		/**
+		 * Interpolate an aligned tile from the image tiles.
+		 */
+		MemoryMap_shptr create_aligned_tile(unsigned int tile_num_x, unsigned int tile_num_y) const
+		{
+			typedef typename PixelPolicy::pixel_type pixel_type;
+
+			const unsigned int tile_size = get_tile_size();
+			MemoryMap_shptr tile = std::make_shared<MemoryMap<pixel_type>>(tile_size, tile_size);
+
+			// The image tile of the last pixel.
+			MemoryMap_shptr src;
+			int src_tile_x = -1, src_tile_y = -1;
+
+			auto get_src_pixel = [&](int x, int y) -> pixel_type
+			{
+				if (x < 0 || y < 0 || x >= static_cast<int>(padded_width) || y >= static_cast<int>(padded_height))
+					return pixel_type();
+
+				if ((x >> tile_width_exp) != src_tile_x || (y >> tile_width_exp) != src_tile_y)
+				{
+					src = tile_cache.get_tile(x, y);
+					src_tile_x = x >> tile_width_exp;
+					src_tile_y = y >> tile_width_exp;
+				}
+
+				return src->get(x & offset_bitmask, y & offset_bitmask);
+			};
+
+			for (unsigned int row = 0; row < tile_size; row++)
+			{
+				double src_x, src_y;
+				inverse_alignment.apply(tile_num_x * tile_size, tile_num_y * tile_size + row, &src_x, &src_y);
+
+				pixel_type* dst = tile->get_pointer(0, row);
+
+				for (unsigned int col = 0; col < tile_size; col++)
+				{
+					const double floor_x = std::floor(src_x), floor_y = std::floor(src_y);
+					const int x0 = static_cast<int>(floor_x), y0 = static_cast<int>(floor_y);
+
+					if (x0 >= -1 && y0 >= -1 && x0 < static_cast<int>(padded_width) && y0 < static_cast<int>(padded_height))
+						dst[col] = interpolate_pixel(get_src_pixel(x0, y0), get_src_pixel(x0 + 1, y0),
+						                             get_src_pixel(x0, y0 + 1), get_src_pixel(x0 + 1, y0 + 1),
+						                             src_x - floor_x, src_y - floor_y);
+
+					src_x += inverse_alignment.get_a();
+					src_y += inverse_alignment.get_c();
+				}
+			}
+
+			return tile;
+		}
 	};
 
 	template <class PixelPolicy>
@@ -171,7 +342,7 @@ namespace degate
 	StoragePolicy_Tile<PixelPolicy>::get_pixel(unsigned int x,
 	                                           unsigned int y) const
 	{
-		MemoryMap_shptr mem = tile_cache.get_tile(x, y);
+		MemoryMap_shptr mem = get_tile_for_reading(x, y);
 		return mem->get(x & offset_bitmask, y & offset_bitmask);
 	}
 
@@ -180,8 +351,15 @@ namespace degate
 	StoragePolicy_Tile<PixelPolicy>::set_pixel(unsigned int x, unsigned int y,
 	                                           typename PixelPolicy::pixel_type new_val)
 	{
-		MemoryMap_shptr mem = tile_cache.get_tile(x, y);
+		MemoryMap_shptr mem = tile_cache.get_tile_for_writing(x, y);
 		mem->set(x & offset_bitmask, y & offset_bitmask, new_val);
+
+		// Aligned tiles are interpolated again on the next read.
+		if (aligned)
+		{
+			boost::mutex::scoped_lock lock(alignment_mutex);
+			aligned_tiles.clear();
+		}
 	}
 }
 
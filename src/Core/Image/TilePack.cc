@@ -0,0 +1,439 @@
+/* -*-c++-*-
+
+ This file is part of the IC reverse engineering tool degate.
+
+ Copyright 2008, 2009, 2010 by Martin Schobert
+
+ Degate is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ any later version.
+
+ Degate is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include "Core/Image/TilePack.h"
+#include "Core/Utils/FileSystem.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <list>
+#include <vector>
+
+#include <boost/format.hpp>
+
+#if defined(SYS_WINDOWS)
+#define NOMINMAX
+#include <Windows.h>
+#include <winioctl.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace degate;
+
+/**
+ * Parse a tile file name of the form "X_Y.dat".
+ */
+static bool parse_tile_filename(std::string const& name, unsigned int& tile_x, unsigned int& tile_y)
+{
+	char suffix[5] = {0};
+	return sscanf(name.c_str(), "%u_%u.%4s", &tile_x, &tile_y, suffix) == 3 && std::string(suffix) == "dat";
+}
+
+TilePack::TilePack(std::string const& filename,
+                   unsigned int tile_width_exp,
+                   unsigned int tiles_x, unsigned int tiles_y,
+                   unsigned int pixel_size,
+                   bool persistent) :
+	filename(filename),
+	tile_width_exp(tile_width_exp),
+	tiles_x(std::max(tiles_x, 1u)),
+	tiles_y(std::max(tiles_y, 1u)),
+	pixel_size(pixel_size),
+	persistent(persistent),
+	tile_bytes(static_cast<size_t>(pixel_size) << (2 * tile_width_exp)),
+	file_size(0),
+#ifdef SYS_WINDOWS
+	file(INVALID_HANDLE_VALUE),
+	mapping(nullptr),
+#else
+	file(-1),
+#endif
+	mem(nullptr)
+{
+	header hdr;
+	bool created = false;
+
+#ifdef SYS_WINDOWS
+
+	file = CreateFileA(filename.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+	                   OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		throw DegateRuntimeException("Can't open the tile pack file " + filename);
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size))
+	{
+		unmap();
+		throw DegateRuntimeException("Can't get the size of the tile pack file " + filename);
+	}
+	file_size = static_cast<uint64_t>(size.QuadPart);
+
+	if (file_size >= sizeof(header))
+	{
+		DWORD read = 0;
+		if (!ReadFile(file, &hdr, sizeof(header), &read, nullptr) || read != sizeof(header))
+		{
+			unmap();
+			throw DegateRuntimeException("Can't read the header of the tile pack file " + filename);
+		}
+	}
+
+#else
+
+	file = open(filename.c_str(), O_RDWR | O_CREAT, 0600);
+	if (file == -1)
+		throw DegateRuntimeException("Can't open the tile pack file " + filename);
+
+	struct stat inf;
+	if (fstat(file, &inf) < 0)
+	{
+		unmap();
+		throw DegateRuntimeException("Can't get the size of the tile pack file " + filename);
+	}
+	file_size = static_cast<uint64_t>(inf.st_size);
+
+	if (file_size >= sizeof(header) && pread(file, &hdr, sizeof(header), 0) != sizeof(header))
+	{
+		unmap();
+		throw DegateRuntimeException("Can't read the header of the tile pack file " + filename);
+	}
+
+#endif
+
+	const uint64_t tiles = static_cast<uint64_t>(this->tiles_x) * this->tiles_y;
+
+	if (file_size == 0)
+	{
+		// Create a new file. The data area is not written, so that the file stays sparse.
+		created = true;
+
+		hdr.magic = TILE_PACK_MAGIC;
+		hdr.version = TILE_PACK_VERSION;
+		hdr.tile_width_exp = tile_width_exp;
+		hdr.pixel_size = pixel_size;
+		hdr.tiles_x = this->tiles_x;
+		hdr.tiles_y = this->tiles_y;
+		hdr.data_offset = (sizeof(header) + tiles * sizeof(uint64_t) + TILE_PACK_ALIGNMENT - 1) /
+			TILE_PACK_ALIGNMENT * TILE_PACK_ALIGNMENT;
+
+		file_size = hdr.data_offset + tiles * tile_bytes;
+
+#ifdef SYS_WINDOWS
+		DWORD returned = 0;
+		DeviceIoControl(file, FSCTL_SET_SPARSE, nullptr, 0, nullptr, 0, &returned, nullptr);
+
+		LARGE_INTEGER end;
+		end.QuadPart = static_cast<LONGLONG>(file_size);
+		if (!SetFilePointerEx(file, end, nullptr, FILE_BEGIN) || !SetEndOfFile(file))
+#else
+		if (ftruncate(file, static_cast<off_t>(file_size)) != 0)
+#endif
+		{
+			unmap();
+			throw DegateRuntimeException("Can't resize the tile pack file " + filename);
+		}
+	}
+	else if (file_size < sizeof(header) ||
+	         hdr.magic != TILE_PACK_MAGIC ||
+	         hdr.version != TILE_PACK_VERSION)
+	{
+		unmap();
+		throw DegateRuntimeException("The file " + filename + " is not a tile pack file.");
+	}
+	else if (hdr.tile_width_exp != tile_width_exp ||
+	         hdr.pixel_size != pixel_size ||
+	         hdr.tiles_x < this->tiles_x ||
+	         hdr.tiles_y < this->tiles_y)
+	{
+		unmap();
+		boost::format fmter("The tile pack file %1% has a tile layout of %2%x%3% tiles with 2^%4% pixel "
+			"and %5% bytes per pixel. Expected %6%x%7% tiles with 2^%8% pixel and %9% bytes per pixel.");
+		fmter % filename % hdr.tiles_x % hdr.tiles_y % hdr.tile_width_exp % hdr.pixel_size
+			% this->tiles_x % this->tiles_y % tile_width_exp % pixel_size;
+		throw DegateRuntimeException(fmter.str());
+	}
+	else
+	{
+		// An existing file may have more tiles, e.g. if it was converted from tile files.
+		this->tiles_x = hdr.tiles_x;
+		this->tiles_y = hdr.tiles_y;
+	}
+
+	map(created);
+
+	if (created)
+	{
+		memcpy(mem, &hdr, sizeof(header));
+
+		uint64_t* index = get_index();
+		for (uint64_t i = 0; i < tiles; i++)
+			index[i] = hdr.data_offset + i * tile_bytes;
+	}
+	else
+	{
+		// Check the index.
+		uint64_t* index = get_index();
+		for (uint64_t i = 0; i < static_cast<uint64_t>(this->tiles_x) * this->tiles_y; i++)
+		{
+			if (index[i] < sizeof(header) || index[i] + tile_bytes > file_size)
+			{
+				unmap();
+				throw DegateRuntimeException("The index of the tile pack file " + filename + " is corrupted.");
+			}
+		}
+	}
+}
+
+TilePack::~TilePack()
+{
+	if (persistent)
+		flush();
+
+	unmap();
+}
+
+void TilePack::map(bool created)
+{
+#ifdef SYS_WINDOWS
+
+	mapping = CreateFileMapping(file, nullptr, PAGE_READWRITE, 0, 0, nullptr);
+	if (mapping == nullptr)
+	{
+		unmap();
+		throw DegateRuntimeException("Can't map the tile pack file " + filename);
+	}
+
+	mem = static_cast<uint8_t*>(MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0));
+	if (mem == nullptr)
+	{
+		unmap();
+		throw DegateRuntimeException("Can't map the tile pack file " + filename);
+	}
+
+#else
+
+	void* p = mmap(nullptr, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+	if (p == MAP_FAILED)
+	{
+		unmap();
+		throw DegateRuntimeException("Can't map the tile pack file " + filename);
+	}
+	mem = static_cast<uint8_t*>(p);
+
+	// Tiles are accessed in an arbitrary order, read-ahead is done per tile.
+	madvise(mem, file_size, MADV_RANDOM);
+
+#endif
+}
+
+void TilePack::unmap()
+{
+#ifdef SYS_WINDOWS
+	if (mem != nullptr) UnmapViewOfFile(mem);
+	if (mapping != nullptr) CloseHandle(mapping);
+	if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+	mapping = nullptr;
+	file = INVALID_HANDLE_VALUE;
+#else
+	if (mem != nullptr) munmap(mem, file_size);
+	if (file != -1) close(file);
+	file = -1;
+#endif
+	mem = nullptr;
+}
+
+uint64_t* TilePack::get_index() const
+{
+	return reinterpret_cast<uint64_t*>(mem + sizeof(header));
+}
+
+uint8_t* TilePack::get_tile_pointer(unsigned int tile_x, unsigned int tile_y) const
+{
+	if (tile_x >= tiles_x || tile_y >= tiles_y)
+	{
+		boost::format fmter("Tile %1%/%2% is out of the range of the tile pack file %3%.");
+		fmter % tile_x % tile_y % filename;
+		throw DegateRuntimeException(fmter.str());
+	}
+
+	return mem + get_index()[static_cast<size_t>(tile_y) * tiles_x + tile_x];
+}
+
+void* TilePack::get_tile(unsigned int tile_x, unsigned int tile_y)
+{
+	uint8_t* tile = get_tile_pointer(tile_x, tile_y);
+
+#ifndef SYS_WINDOWS
+	madvise(tile, tile_bytes, MADV_WILLNEED);
+#endif
+
+	return tile;
+}
+
+void TilePack::release_tile(unsigned int tile_x, unsigned int tile_y)
+{
+	uint8_t* tile = get_tile_pointer(tile_x, tile_y);
+
+#ifdef SYS_WINDOWS
+	// Remove the pages from the working set. Modified pages are written back by the system.
+	VirtualUnlock(tile, tile_bytes);
+#else
+	// For a shared file mapping this drops the pages from the process, the data
+	// (modified or not) is kept in the page cache and is written to the file.
+	madvise(tile, tile_bytes, MADV_DONTNEED);
+#endif
+}
+
+void TilePack::flush()
+{
+	if (mem == nullptr)
+		return;
+
+#ifdef SYS_WINDOWS
+	FlushViewOfFile(mem, 0);
+#else
+	msync(mem, file_size, MS_SYNC);
+#endif
+}
+
+bool TilePack::is_tile_pack_directory(std::string const& directory)
+{
+	return file_exists(join_pathes(directory, TILE_PACK_FILENAME));
+}
+
+void TilePack::get_layout(std::string const& filename,
+                          unsigned int& tile_width_exp,
+                          unsigned int& tiles_x, unsigned int& tiles_y,
+                          unsigned int& pixel_size)
+{
+	header hdr;
+	std::ifstream in(filename.c_str(), std::ios::binary);
+
+	if (!in.read(reinterpret_cast<char*>(&hdr), sizeof(header)) ||
+		hdr.magic != TILE_PACK_MAGIC ||
+		hdr.version != TILE_PACK_VERSION)
+	{
+		throw DegateRuntimeException("The file " + filename + " is not a tile pack file.");
+	}
+
+	tile_width_exp = hdr.tile_width_exp;
+	tiles_x = hdr.tiles_x;
+	tiles_y = hdr.tiles_y;
+	pixel_size = hdr.pixel_size;
+}
+
+bool TilePack::is_tile_file_directory(std::string const& directory)
+{
+	if (!is_directory(directory))
+		return false;
+
+	unsigned int tile_x, tile_y;
+	for (std::string const& name : read_directory(directory))
+		if (parse_tile_filename(name, tile_x, tile_y))
+			return true;
+
+	return false;
+}
+
+unsigned int TilePack::convert_directory(std::string const& directory, unsigned int pixel_size, bool recursive)
+{
+	unsigned int converted = 0;
+
+	if (recursive)
+	{
+		for (std::string const& path : read_directory(directory, true))
+			if (is_directory(path))
+				converted += convert_directory(path, pixel_size, true);
+	}
+
+	if (!is_tile_file_directory(directory) || is_tile_pack_directory(directory))
+		return converted;
+
+	// Collect tiles and determine the tile layout.
+	struct tile_file
+	{
+		std::string path;
+		unsigned int x, y;
+	};
+
+	std::vector<tile_file> tiles;
+	unsigned int tiles_x = 0, tiles_y = 0;
+	uint64_t size = 0;
+
+	for (std::string const& name : read_directory(directory))
+	{
+		tile_file t;
+		if (!parse_tile_filename(name, t.x, t.y))
+			continue;
+
+		t.path = join_pathes(directory, name);
+
+		std::ifstream in(t.path.c_str(), std::ios::binary | std::ios::ate);
+		uint64_t file_size = static_cast<uint64_t>(in.tellg());
+		if (size != 0 && file_size != size)
+			throw DegateRuntimeException("The tile files in " + directory + " differ in size.");
+		size = file_size;
+
+		tiles_x = std::max(tiles_x, t.x + 1);
+		tiles_y = std::max(tiles_y, t.y + 1);
+		tiles.push_back(t);
+	}
+
+	unsigned int tile_width_exp = 0;
+	while ((static_cast<uint64_t>(pixel_size) << (2 * tile_width_exp)) < size && tile_width_exp < 16)
+		tile_width_exp++;
+
+	if ((static_cast<uint64_t>(pixel_size) << (2 * tile_width_exp)) != size)
+		throw DegateRuntimeException("The tile files in " + directory + " have an unexpected size.");
+
+	debug(TM, "Convert %d tiles in %s into a tile pack.", (int)tiles.size(), directory.c_str());
+
+	std::string pack_filename = join_pathes(directory, TILE_PACK_FILENAME);
+	std::string temp_filename = pack_filename + ".tmp";
+	remove_file(temp_filename);
+
+	{
+		TilePack pack(temp_filename, tile_width_exp, tiles_x, tiles_y, pixel_size);
+
+		for (tile_file const& t : tiles)
+		{
+			std::ifstream in(t.path.c_str(), std::ios::binary);
+			in.read(static_cast<char*>(pack.get_tile(t.x, t.y)), size);
+			if (!in)
+				throw DegateRuntimeException("Can't read the tile file " + t.path);
+			pack.release_tile(t.x, t.y);
+		}
+	}
+
+	// The tile pack is complete, replace the tile files.
+	move_file(temp_filename, pack_filename);
+
+	for (tile_file const& t : tiles)
+		remove_file(t.path);
+
+	return converted + 1;
+}
@@ -0,0 +1,190 @@
+/* -*-c++-*-
+
+ This file is part of the IC reverse engineering tool degate.
+
+ Copyright 2008, 2009, 2010 by Martin Schobert
+
+ Degate is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ any later version.
+
+ Degate is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#ifndef __TILEPACK_H__
+#define __TILEPACK_H__
+
+#include "Prerequisites.h"
+#include "Globals.h"
+
+#include <string>
+#include <cstdint>
+#include <memory>
+#include <boost/utility.hpp>
+
+/**
+ * The name of the file that holds all tiles of a tile based image.
+ */
+#define TILE_PACK_FILENAME "tiles.pack"
+
+#define TILE_PACK_MAGIC 0x50544744 // "DGTP"
+#define TILE_PACK_VERSION 1
+
+/**
+ * Alignment of tile data in a tile pack file. It is a multiple of the page size
+ * and of the allocation granularity on Windows.
+ */
+#define TILE_PACK_ALIGNMENT 65536
+
+namespace degate
+{
+	/**
+	 * A single file that stores all tiles of a tile based image.
+	 *
+	 * The file starts with a header and an index with the file offset of each tile,
+	 * followed by the tile data. The file is created sparse and mapped into memory
+	 * once. Tiles are handed out as pointers into the mapping. Access hints are
+	 * given to the kernel: the mapping is accessed randomly, a tile that is
+	 * requested will be needed soon and a tile that is released can be dropped
+	 * from the process memory (it remains in the file).
+	 *
+	 * This replaces the one file per tile layout (N_M.dat files) of older degate
+	 * versions. Use TilePack::convert_directory() to migrate such a directory.
+	 */
+	class TilePack : boost::noncopyable
+	{
+	public:
+
+		/**
+		 * Open or create a tile pack file.
+		 * @param filename The path of the file.
+		 * @param tile_width_exp The width and height of a tile as exponent to the base 2.
+		 * @param tiles_x The number of tiles in a row.
+		 * @param tiles_y The number of tiles in a column.
+		 * @param pixel_size The size of a pixel in bytes.
+		 * @param persistent If false, modified tiles are not flushed to the file on close.
+		 * @exception DegateRuntimeException This exception is thrown if the file cannot be
+		 *   created or mapped or if an existing file has a different tile layout.
+		 */
+		TilePack(std::string const& filename,
+		         unsigned int tile_width_exp,
+		         unsigned int tiles_x, unsigned int tiles_y,
+		         unsigned int pixel_size,
+		         bool persistent = true);
+
+		/**
+		 * Flush (if persistent) and unmap the file.
+		 */
+		~TilePack();
+
+		/**
+		 * Get a pointer to the data of a tile.
+		 * @param tile_x The tile column.
+		 * @param tile_y The tile row.
+		 * @return Returns a pointer into the mapped file.
+		 */
+		void* get_tile(unsigned int tile_x, unsigned int tile_y);
+
+		/**
+		 * Tell the kernel, that a tile is not used anymore. The data is kept.
+		 */
+		void release_tile(unsigned int tile_x, unsigned int tile_y);
+
+		/**
+		 * Write modified tiles back to the file.
+		 */
+		void flush();
+
+		/**
+		 * Get the size of a tile in bytes.
+		 */
+		size_t get_tile_bytes() const { return tile_bytes; }
+
+		std::string const& get_filename() const { return filename; }
+
+		/**
+		 * Check if a directory holds a tile pack file.
+		 */
+		static bool is_tile_pack_directory(std::string const& directory);
+
+		/**
+		 * Read the tile layout of a tile pack file.
+		 * @exception DegateRuntimeException This exception is thrown if the file is not a tile pack file.
+		 */
+		static void get_layout(std::string const& filename,
+		                       unsigned int& tile_width_exp,
+		                       unsigned int& tiles_x, unsigned int& tiles_y,
+		                       unsigned int& pixel_size);
+
+		/**
+		 * Check if a directory holds tiles in the old format with one file per tile.
+		 */
+		static bool is_tile_file_directory(std::string const& directory);
+
+		/**
+		 * Convert a directory with one file per tile (N_M.dat) into a tile pack file.
+		 * The tile files are removed after the conversion.
+		 * @param directory The image directory.
+		 * @param pixel_size The size of a pixel in bytes.
+		 * @param recursive If true, image directories within the directory (e.g.
+		 *   the scaling_N.dimg directories of a background image) are converted, too.
+		 * @return Returns the number of converted directories.
+		 * @exception DegateRuntimeException This exception is thrown if the tile files
+		 *   have an unexpected size or if they differ in size.
+		 */
+		static unsigned int convert_directory(std::string const& directory,
+		                                      unsigned int pixel_size = 4,
+		                                      bool recursive = true);
+
+	private:
+
+		struct header
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint32_t tile_width_exp;
+			uint32_t pixel_size;
+			uint32_t tiles_x;
+			uint32_t tiles_y;
+			uint64_t data_offset;
+		};
+
+		void map(bool created);
+		void unmap();
+		uint64_t* get_index() const;
+		uint8_t* get_tile_pointer(unsigned int tile_x, unsigned int tile_y) const;
+
+	private:
+
+		std::string filename;
+		unsigned int tile_width_exp;
+		unsigned int tiles_x, tiles_y;
+		unsigned int pixel_size;
+		bool persistent;
+
+		size_t tile_bytes;
+		uint64_t file_size;
+
+#ifdef SYS_WINDOWS
+		void* file;
+		void* mapping;
+#else
+		int file;
+#endif
+
+		uint8_t* mem;
+	};
+
+	typedef std::shared_ptr<TilePack> TilePack_shptr;
+}
+
+#endif
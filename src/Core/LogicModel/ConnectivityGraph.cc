@@ -0,0 +1,228 @@
+/* -*-c++-*-
+
+ This file is part of the IC reverse engineering tool degate.
+
+ Copyright 2008, 2009, 2010 by Martin Schobert
+
+ Degate is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ any later version.
+
+ Degate is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#include <Core/LogicModel/ConnectivityGraph.h>
+#include <Core/LogicModel/LogicModel.h>
+#include <Core/LogicModel/Gate/Gate.h>
+#include <Core/LogicModel/Gate/GatePort.h>
+
+#include <algorithm>
+#include <functional>
+
+using namespace degate;
+
+const ConnectivityGraph::index_t ConnectivityGraph::INVALID_INDEX;
+
+ConnectivityGraph::ConnectivityGraph(LogicModel& lmodel)
+{
+	const size_t gates_count = lmodel.get_gates_count();
+
+	gate_ids.reserve(gates_count);
+	gate_template_ids.reserve(gates_count);
+	gate_port_offsets.reserve(gates_count + 1);
+	gates.reserve(gates_count);
+
+	// Connected ports, the net pointer separates nets without object ID.
+	struct connection
+	{
+		object_id_t net_id;
+		Net const* net;
+		index_t port;
+
+		bool operator<(connection const& other) const
+		{
+			if (net_id != other.net_id) return net_id < other.net_id;
+			if (net != other.net) return std::less<Net const*>()(net, other.net);
+			return port < other.port;
+		}
+	};
+
+	std::vector<connection> connections;
+
+	// Gates are ordered by object ID, ports of a gate as well.
+	for (LogicModel::gate_collection::iterator iter = lmodel.gates_begin(); iter != lmodel.gates_end(); ++iter)
+	{
+		Gate_shptr const& gate = iter->second;
+		assert(gate != nullptr);
+
+		const index_t gate_index = static_cast<index_t>(gate_ids.size());
+
+		gate_ids.push_back(gate->get_object_id());
+		gate_template_ids.push_back(gate->has_template() ? gate->get_gate_template()->get_object_id() : 0);
+		gate_port_offsets.push_back(static_cast<index_t>(port_ids.size()));
+		gates.push_back(gate);
+
+		for (Gate::port_iterator port_iter = gate->ports_begin(); port_iter != gate->ports_end(); ++port_iter)
+		{
+			GatePort_shptr const& port = *port_iter;
+			assert(port != nullptr);
+
+			const index_t port_index_value = static_cast<index_t>(port_ids.size());
+
+			GateTemplatePort_shptr template_port = port->has_template_port() ? port->get_template_port() : nullptr;
+
+			port_ids.push_back(port->get_object_id());
+			port_template_ids.push_back(template_port != nullptr ? template_port->get_object_id() : 0);
+			port_gates.push_back(gate_index);
+			port_nets.push_back(INVALID_INDEX);
+			port_types.push_back(static_cast<uint8_t>(template_port != nullptr
+				                                          ? template_port->get_port_type()
+				                                          : GateTemplatePort::PORT_TYPE_UNDEFINED));
+			ports.push_back(port);
+			port_index[port->get_object_id()] = port_index_value;
+
+			Net_shptr net = port->get_net();
+			if (net != nullptr)
+				connections.push_back({net->get_object_id(), net.get(), port_index_value});
+		}
+	}
+
+	gate_port_offsets.push_back(static_cast<index_t>(port_ids.size()));
+
+	// Group the connections by net, this gives the net ID array and the net rows.
+	std::sort(connections.begin(), connections.end());
+
+	net_ports.reserve(connections.size());
+
+	Net const* current_net = nullptr;
+
+	for (auto const& c : connections)
+	{
+		if (c.net != current_net)
+		{
+			current_net = c.net;
+			net_ids.push_back(c.net_id);
+			net_port_offsets.push_back(static_cast<index_t>(net_ports.size()));
+		}
+
+		port_nets[c.port] = static_cast<index_t>(net_ids.size() - 1);
+		net_ports.push_back(c.port);
+	}
+
+	net_port_offsets.push_back(static_cast<index_t>(net_ports.size()));
+}
+
+ConnectivityGraph::index_t ConnectivityGraph::find_gate(object_id_t gate_id) const
+{
+	auto iter = std::lower_bound(gate_ids.begin(), gate_ids.end(), gate_id);
+	if (iter == gate_ids.end() || *iter != gate_id)
+		return INVALID_INDEX;
+
+	return static_cast<index_t>(iter - gate_ids.begin());
+}
+
+ConnectivityGraph::index_t ConnectivityGraph::find_port(object_id_t port_id) const
+{
+	auto iter = port_index.find(port_id);
+	if (iter == port_index.end())
+		return INVALID_INDEX;
+
+	return iter->second;
+}
+
+ConnectivityGraph::index_t ConnectivityGraph::find_net(object_id_t net_id) const
+{
+	auto iter = std::lower_bound(net_ids.begin(), net_ids.end(), net_id);
+	if (iter == net_ids.end() || *iter != net_id)
+		return INVALID_INDEX;
+
+	return static_cast<index_t>(iter - net_ids.begin());
+}
+
+void ConnectivityGraph::get_port_type_masks(TRAVERSAL_DIRECTION direction, uint8_t& source_mask, uint8_t& target_mask)
+{
+	switch (direction)
+	{
+	case TRAVERSAL_FANOUT:
+		source_mask = GateTemplatePort::PORT_TYPE_OUT;
+		target_mask = GateTemplatePort::PORT_TYPE_IN;
+		break;
+	case TRAVERSAL_FANIN:
+		source_mask = GateTemplatePort::PORT_TYPE_IN;
+		target_mask = GateTemplatePort::PORT_TYPE_OUT;
+		break;
+	default:
+		source_mask = 0;
+		target_mask = 0;
+		break;
+	}
+}
+
+void ConnectivityGraph::expand(index_t gate,
+                               TRAVERSAL_DIRECTION direction,
+                               std::vector<bool>& visited_gates,
+                               std::vector<bool>& visited_nets,
+                               std::vector<index_t>& result) const
+{
+	uint8_t source_mask, target_mask;
+	get_port_type_masks(direction, source_mask, target_mask);
+
+	for (index_t port = gate_port_offsets[gate]; port < gate_port_offsets[gate + 1]; port++)
+	{
+		const index_t net = port_nets[port];
+		if (net == INVALID_INDEX || visited_nets[net] || !match_port_type(port_types[port], source_mask))
+			continue;
+
+		// All targets of a net are reached at once, so a net is never expanded twice.
+		visited_nets[net] = true;
+
+		for (index_t i = net_port_offsets[net]; i < net_port_offsets[net + 1]; i++)
+		{
+			const index_t other = net_ports[i];
+			const index_t other_gate = port_gates[other];
+
+			if (!visited_gates[other_gate] && match_port_type(port_types[other], target_mask))
+			{
+				visited_gates[other_gate] = true;
+				result.push_back(other_gate);
+			}
+		}
+	}
+}
+
+std::vector<ConnectivityGraph::index_t> ConnectivityGraph::get_cone(std::vector<index_t> const& start,
+                                                                    TRAVERSAL_DIRECTION direction,
+                                                                    unsigned int max_depth) const
+{
+	std::vector<index_t> cone;
+
+	breadth_first_search(start, direction, [&](index_t gate, unsigned int depth)
+	{
+		if (depth > 0)
+			cone.push_back(gate);
+		return true;
+	}, max_depth);
+
+	std::sort(cone.begin(), cone.end());
+	return cone;
+}
+
+std::vector<ConnectivityGraph::index_t> ConnectivityGraph::get_fanout_cone(std::vector<index_t> const& start,
+                                                                           unsigned int max_depth) const
+{
+	return get_cone(start, TRAVERSAL_FANOUT, max_depth);
+}
+
+std::vector<ConnectivityGraph::index_t> ConnectivityGraph::get_fanin_cone(std::vector<index_t> const& start,
+                                                                          unsigned int max_depth) const
+{
+	return get_cone(start, TRAVERSAL_FANIN, max_depth);
+}
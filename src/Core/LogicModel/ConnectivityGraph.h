@@ -0,0 +1,367 @@
+/* -*-c++-*-
+
+ This file is part of the IC reverse engineering tool degate.
+
+ Copyright 2008, 2009, 2010 by Martin Schobert
+
+ Degate is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ any later version.
+
+ Degate is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+#ifndef __CONNECTIVITYGRAPH_H__
+#define __CONNECTIVITYGRAPH_H__
+
+#include <Globals.h>
+#include <Core/LogicModel/Gate/GateTemplatePort.h>
+
+#include <climits>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace degate
+{
+	class Gate;
+	typedef std::shared_ptr<Gate> Gate_shptr;
+
+	/**
+	 * @class ConnectivityGraph
+	 * @brief Read-only snapshot of the gate, gate port and net connectivity of a logic model.
+	 *
+	 * Gates, gate ports and nets are numbered with dense indices. Ports of a gate and
+	 * ports of a net are stored in compressed sparse row form (an offset array and a
+	 * flat index array), so that neighbour iteration and graph traversals only walk
+	 * contiguous arrays instead of resolving object IDs through the logic model.
+	 *
+	 * Gate indices follow the object ID order of the logic model and only nets that
+	 * connect at least one gate port are part of the graph.
+	 *
+	 * Connections between gates are not materialized: a gate reaches its neighbours
+	 * through the nets of its ports. Traversals expand each net only once, so large nets
+	 * (clock, reset) don't cost more than their size.
+	 *
+	 * The snapshot is not updated when the logic model changes. Use
+	 * LogicModel::get_connectivity_graph() to get a snapshot that is rebuilt on change.
+	 * A snapshot can be shared between threads.
+	 */
+	class ConnectivityGraph
+	{
+	public:
+
+		typedef uint32_t index_t;
+
+		static const index_t INVALID_INDEX = UINT_MAX;
+
+		/**
+		 * Direction of a traversal. A port drives a net if it is an output (or in-out)
+		 * port and is driven by a net if it is an input (or in-out) port.
+		 */
+		enum TRAVERSAL_DIRECTION
+		{
+			TRAVERSAL_FANOUT,    /**< From driving ports to driven ports. */
+			TRAVERSAL_FANIN,     /**< From driven ports to driving ports. */
+			TRAVERSAL_UNDIRECTED /**< Any port, including ports without type. */
+		};
+
+		/**
+		 * Range of indices in one of the flat arrays.
+		 */
+		class index_range
+		{
+		public:
+
+			index_range(const index_t* first, const index_t* last) : first(first), last(last)
+			{
+			}
+
+			const index_t* begin() const { return first; }
+			const index_t* end() const { return last; }
+			size_t size() const { return last - first; }
+			bool empty() const { return first == last; }
+
+		private:
+			const index_t* first;
+			const index_t* last;
+		};
+
+	private:
+
+		// Gates
+		std::vector<object_id_t> gate_ids;
+		std::vector<object_id_t> gate_template_ids;
+		std::vector<index_t> gate_port_offsets;
+		std::vector<Gate_shptr> gates;
+
+		// Ports
+		std::vector<object_id_t> port_ids;
+		std::vector<object_id_t> port_template_ids;
+		std::vector<index_t> port_gates;
+		std::vector<index_t> port_nets;
+		std::vector<uint8_t> port_types;
+		std::vector<GatePort_shptr> ports;
+		std::unordered_map<object_id_t, index_t> port_index;
+
+		// Nets
+		std::vector<object_id_t> net_ids;
+		std::vector<index_t> net_port_offsets;
+		std::vector<index_t> net_ports;
+
+	private:
+
+		/**
+		 * Check if a port type matches a traversal side (0 matches any port).
+		 */
+		static inline bool match_port_type(uint8_t port_type, uint8_t mask)
+		{
+			return mask == 0 || (port_type & mask) != 0;
+		}
+
+		/**
+		 * Get the port type masks for the source and the target side of a traversal.
+		 */
+		static void get_port_type_masks(TRAVERSAL_DIRECTION direction, uint8_t& source_mask, uint8_t& target_mask);
+
+		/**
+		 * Append all gates reachable from \p gate over one net that are not visited yet.
+		 * Marks the appended gates and the expanded nets as visited.
+		 */
+		void expand(index_t gate,
+		            TRAVERSAL_DIRECTION direction,
+		            std::vector<bool>& visited_gates,
+		            std::vector<bool>& visited_nets,
+		            std::vector<index_t>& result) const;
+
+		/**
+		 * Get all gates reachable from \p start (start gates excluded).
+		 */
+		std::vector<index_t> get_cone(std::vector<index_t> const& start,
+		                              TRAVERSAL_DIRECTION direction,
+		                              unsigned int max_depth) const;
+
+	public:
+
+		/**
+		 * Build the graph in one pass over the gates of a logic model.
+		 */
+		explicit ConnectivityGraph(LogicModel& lmodel);
+
+		/**
+		 * Get the number of gates.
+		 */
+		inline size_t get_gates_count() const { return gate_ids.size(); }
+
+		/**
+		 * Get the number of gate ports.
+		 */
+		inline size_t get_ports_count() const { return port_ids.size(); }
+
+		/**
+		 * Get the number of nets (only nets connected to gate ports).
+		 */
+		inline size_t get_nets_count() const { return net_ids.size(); }
+
+		/**
+		 * Lookup the index of a gate.
+		 * @return Returns INVALID_INDEX if the gate is not part of the graph.
+		 */
+		index_t find_gate(object_id_t gate_id) const;
+
+		/**
+		 * Lookup the index of a gate port.
+		 * @return Returns INVALID_INDEX if the port is not part of the graph.
+		 */
+		index_t find_port(object_id_t port_id) const;
+
+		/**
+		 * Lookup the index of a net.
+		 * @return Returns INVALID_INDEX if the net connects no gate port.
+		 */
+		index_t find_net(object_id_t net_id) const;
+
+		inline object_id_t get_gate_id(index_t gate) const { return gate_ids[gate]; }
+
+		/**
+		 * Get the object ID of the template of a gate (0 if the gate has no template).
+		 */
+		inline object_id_t get_gate_template_id(index_t gate) const { return gate_template_ids[gate]; }
+
+		inline Gate_shptr const& get_gate(index_t gate) const { return gates[gate]; }
+
+		inline object_id_t get_port_id(index_t port) const { return port_ids[port]; }
+
+		/**
+		 * Get the object ID of the template port of a port (0 if the port has no template port).
+		 */
+		inline object_id_t get_port_template_id(index_t port) const { return port_template_ids[port]; }
+
+		inline GatePort_shptr const& get_port(index_t port) const { return ports[port]; }
+
+		inline index_t get_port_gate(index_t port) const { return port_gates[port]; }
+
+		/**
+		 * Get the net of a port.
+		 * @return Returns INVALID_INDEX if the port is not connected.
+		 */
+		inline index_t get_port_net(index_t port) const { return port_nets[port]; }
+
+		inline GateTemplatePort::PORT_TYPE get_port_type(index_t port) const
+		{
+			return static_cast<GateTemplatePort::PORT_TYPE>(port_types[port]);
+		}
+
+		inline object_id_t get_net_id(index_t net) const { return net_ids[net]; }
+
+		/**
+		 * Get the first port of a gate. Ports of a gate have consecutive indices.
+		 */
+		inline index_t get_gate_ports_begin(index_t gate) const { return gate_port_offsets[gate]; }
+
+		/**
+		 * Get the index after the last port of a gate.
+		 */
+		inline index_t get_gate_ports_end(index_t gate) const { return gate_port_offsets[gate + 1]; }
+
+		/**
+		 * Get the gate ports connected to a net.
+		 */
+		inline index_range get_net_ports(index_t net) const
+		{
+			return index_range(net_ports.data() + net_port_offsets[net], net_ports.data() + net_port_offsets[net + 1]);
+		}
+
+		/**
+		 * Call \p f(neighbour_gate, neighbour_port, port) for each port of another gate (or another
+		 * port of the same gate) that shares a net with a port of \p gate, in the given direction.
+		 * A neighbour gate is reported once per connection.
+		 */
+		template<typename F>
+		void for_each_neighbour(index_t gate, TRAVERSAL_DIRECTION direction, F f) const
+		{
+			uint8_t source_mask, target_mask;
+			get_port_type_masks(direction, source_mask, target_mask);
+
+			for (index_t port = gate_port_offsets[gate]; port < gate_port_offsets[gate + 1]; port++)
+			{
+				const index_t net = port_nets[port];
+				if (net == INVALID_INDEX || !match_port_type(port_types[port], source_mask))
+					continue;
+
+				for (index_t other : get_net_ports(net))
+				{
+					if (other != port && match_port_type(port_types[other], target_mask))
+						f(port_gates[other], other, port);
+				}
+			}
+		}
+
+		/**
+		 * Breadth first search from a set of start gates. Each gate is visited at most once.
+		 * @param start The start gates, visited with a depth of 0.
+		 * @param direction The direction to follow.
+		 * @param visitor Called as \p visitor(gate, depth). Neighbours of a gate are only
+		 *   visited if it returns true.
+		 * @param max_depth Gates deeper than this are not visited.
+		 */
+		template<typename F>
+		void breadth_first_search(std::vector<index_t> const& start,
+		                          TRAVERSAL_DIRECTION direction,
+		                          F visitor,
+		                          unsigned int max_depth = UINT_MAX) const
+		{
+			std::vector<bool> visited_gates(get_gates_count(), false);
+			std::vector<bool> visited_nets(get_nets_count(), false);
+			std::vector<index_t> current, next;
+
+			for (index_t gate : start)
+			{
+				if (!visited_gates[gate])
+				{
+					visited_gates[gate] = true;
+					current.push_back(gate);
+				}
+			}
+
+			for (unsigned int depth = 0; !current.empty(); depth++)
+			{
+				for (index_t gate : current)
+				{
+					if (visitor(gate, depth) && depth < max_depth)
+						expand(gate, direction, visited_gates, visited_nets, next);
+				}
+
+				current.swap(next);
+				next.clear();
+			}
+		}
+
+		/**
+		 * Depth first search from a set of start gates. Each gate is visited at most once.
+		 * Parameters are the same as for breadth_first_search().
+		 */
+		template<typename F>
+		void depth_first_search(std::vector<index_t> const& start,
+		                        TRAVERSAL_DIRECTION direction,
+		                        F visitor,
+		                        unsigned int max_depth = UINT_MAX) const
+		{
+			std::vector<bool> visited_gates(get_gates_count(), false);
+			std::vector<bool> visited_nets(get_nets_count(), false);
+			std::vector<std::pair<index_t, unsigned int>> stack;
+			std::vector<index_t> next;
+
+			for (auto iter = start.rbegin(); iter != start.rend(); ++iter)
+			{
+				if (!visited_gates[*iter])
+				{
+					visited_gates[*iter] = true;
+					stack.push_back(std::make_pair(*iter, 0u));
+				}
+			}
+
+			while (!stack.empty())
+			{
+				const index_t gate = stack.back().first;
+				const unsigned int depth = stack.back().second;
+				stack.pop_back();
+
+				if (!visitor(gate, depth) || depth >= max_depth)
+					continue;
+
+				next.clear();
+				expand(gate, direction, visited_gates, visited_nets, next);
+
+				for (auto iter = next.rbegin(); iter != next.rend(); ++iter)
+					stack.push_back(std::make_pair(*iter, depth + 1));
+			}
+		}
+
+		/**
+		 * Get all gates driven, directly or indirectly, by \p start.
+		 * @param start The start gates, they are not part of the result.
+		 * @param max_depth The maximum number of gate levels.
+		 * @return Returns the sorted gate indices.
+		 */
+		std::vector<index_t> get_fanout_cone(std::vector<index_t> const& start, unsigned int max_depth = UINT_MAX) const;
+
+		/**
+		 * Get all gates that drive, directly or indirectly, \p start.
+		 * @see get_fanout_cone()
+		 */
+		std::vector<index_t> get_fanin_cone(std::vector<index_t> const& start, unsigned int max_depth = UINT_MAX) const;
+	};
+
+	typedef std::shared_ptr<const ConnectivityGraph> ConnectivityGraph_shptr;
+}
+
+#endif
@@ -67,6 +67,16 @@ bool GateLibrary::exists_template(object_id_t id) const
 	return templates.find(id) != templates.end();
 }
 
+void GateLibrary::copy_saved_images(GateLibrary const& copy)
+{
+	for (const_template_iterator iter = copy.begin(); iter != copy.end(); ++iter)
+	{
+		template_iterator found = templates.find(iter->first);
+		if (found != templates.end())
+			found->second->copy_saved_images(*iter->second);
+	}
+}
+
 
 GateTemplate_shptr GateLibrary::get_template(object_id_t id)
 {
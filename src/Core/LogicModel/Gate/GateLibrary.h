@@ -106,6 +106,13 @@ namespace degate
 		 */
 		bool exists_template(object_id_t id) const;
 
+		/**
+		 * Take over the image files saved for the templates of a copy of this
+		 * library, e.g. of a project snapshot.
+		 * @see GateTemplate::copy_saved_images()
+		 */
+		void copy_saved_images(GateLibrary const& copy);
+
 		/**
 		 * Check for a name in the gate library.
 		 * @return Returns true, if a template name is already used for a template.
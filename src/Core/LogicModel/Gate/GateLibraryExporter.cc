@@ -35,6 +35,7 @@
 #include <fstream>
 #include <stdexcept>
 #include <list>
+#include <set>
 #include <memory>
 
 
@@ -90,6 +91,53 @@ void GateLibraryExporter::add_gates(QDomDocument& doc,
                                     GateLibrary_shptr gate_lib,
                                     std::string const& directory)
 {
+	// Images that are still stored in files are only decoded if they must be written to
+	// another file. Decode them all before writing anything, because the new file might
+	// be the old file of another template.
+	GateTemplate::image_load_list relocated_images;
+	std::set<std::string> overwritten_files;
+
+	for (GateLibrary::template_iterator iter = gate_lib->begin();
+	     iter != gate_lib->end(); ++iter)
+	{
+		GateTemplate_shptr gate_tmpl((*iter).second);
+
+		for (GateTemplate::image_iterator img_iter = gate_tmpl->images_begin();
+		     img_iter != gate_tmpl->images_end(); ++img_iter)
+		{
+			Layer::LAYER_TYPE layer_type = (*img_iter).first;
+			std::string path = join_pathes(directory, get_image_filename(gate_tmpl, layer_type));
+
+			if (!is_image_file_current(gate_tmpl, layer_type, path))
+			{
+				relocated_images.push_back(std::make_pair(gate_tmpl, layer_type));
+
+				if (file_exists(path))
+					overwritten_files.insert(get_realpath(path));
+			}
+		}
+	}
+
+	// Shared images must not be read from a file while it is rewritten, nor refer to it afterwards.
+	GateTemplate::image_load_list detached_images;
+
+	for (auto const& entry : shared_images)
+	{
+		std::string image_file = entry.first->get_image_file(entry.second);
+
+		if (!image_file.empty() && file_exists(image_file) &&
+			overwritten_files.find(get_realpath(image_file)) != overwritten_files.end())
+		{
+			relocated_images.push_back(entry);
+			detached_images.push_back(entry);
+		}
+	}
+
+	GateTemplate::load_images(relocated_images);
+
+	for (auto const& entry : detached_images)
+		entry.first->detach_image_file(entry.second);
+
 	for (GateLibrary::template_iterator iter = gate_lib->begin();
 	     iter != gate_lib->end(); ++iter)
 	{
@@ -120,6 +168,25 @@ void GateLibraryExporter::add_gates(QDomDocument& doc,
 }
 
 
+std::string GateLibraryExporter::get_image_filename(GateTemplate_shptr gate_tmpl, Layer::LAYER_TYPE layer_type)
+{
+	object_id_t new_oid = oid_rewriter->get_new_object_id(gate_tmpl->get_object_id());
+	boost::format fmter("%1%_%2%.tif");
+	fmter % new_oid % Layer::get_layer_type_as_string(layer_type);
+	return fmter.str();
+}
+
+bool GateLibraryExporter::is_image_file_current(GateTemplate_shptr gate_tmpl, Layer::LAYER_TYPE layer_type,
+                                                std::string const& path)
+{
+	std::string image_file = gate_tmpl->get_image_file(layer_type);
+
+	if (image_file.empty() || !file_exists(image_file) || !file_exists(path))
+		return false;
+
+	return get_realpath(image_file) == get_realpath(path);
+}
+
 void GateLibraryExporter::add_images(QDomDocument& doc,
                                      QDomElement& gate_elem,
                                      GateTemplate_shptr gate_tmpl,
@@ -134,8 +201,6 @@ void GateLibraryExporter::add_images(QDomDocument& doc,
 	     img_iter != gate_tmpl->images_end(); ++img_iter)
 	{
 		Layer::LAYER_TYPE layer_type = (*img_iter).first;
-		GateTemplateImage_shptr img = (*img_iter).second;
-		assert(img != nullptr);
 
 		QDomElement img_elem = doc.createElement("image");
 		if (img_elem.isNull()) throw(std::runtime_error("Failed to create node."));
@@ -143,14 +208,20 @@ void GateLibraryExporter::add_images(QDomDocument& doc,
 		img_elem.setAttribute("layer-type", QString::fromStdString(Layer::get_layer_type_as_string(layer_type)));
 
 		// export the image
-		object_id_t new_oid = oid_rewriter->get_new_object_id(gate_tmpl->get_object_id());
-		boost::format fmter("%1%_%2%.tif");
-		fmter % new_oid % Layer::get_layer_type_as_string(layer_type);
-		std::string filename(fmter.str());
+		std::string filename = get_image_filename(gate_tmpl, layer_type);
+		std::string path = join_pathes(directory, filename);
 
 		img_elem.setAttribute("image", QString::fromStdString(filename));
 
-		save_image<GateTemplateImage>(join_pathes(directory, filename), img);
+		// Only write images that changed since they were loaded or saved.
+		if (!is_image_file_current(gate_tmpl, layer_type, path))
+		{
+			GateTemplateImage_shptr img = gate_tmpl->get_image(layer_type);
+			assert(img != nullptr);
+
+			save_image<GateTemplateImage>(path, img);
+			gate_tmpl->set_image_saved(layer_type, path);
+		}
 
 		images_elem.appendChild(img_elem);
 	}
@@ -24,6 +24,8 @@
 
 #include "Globals.h"
 #include "GateLibrary.h"
+#include "GateTemplate.h"
+#include "Core/LogicModel/Layer.h"
 #include "Core/XML/XMLExporter.h"
 #include "Core/Utils/ObjectIDRewriter.h"
 
@@ -46,6 +48,17 @@ namespace degate
 		void add_images(QDomDocument& doc, QDomElement& gate_elem, GateTemplate_shptr gate_tmpl,
 		                std::string const& directory);
 
+		/**
+		 * Get the file name of an exported template image.
+		 */
+		std::string get_image_filename(GateTemplate_shptr gate_tmpl, Layer::LAYER_TYPE layer_type);
+
+		/**
+		 * Check if a file already holds the current revision of a template image.
+		 */
+		bool is_image_file_current(GateTemplate_shptr gate_tmpl, Layer::LAYER_TYPE layer_type,
+		                           std::string const& path);
+
 		void add_implementations(QDomDocument& doc, QDomElement& gate_elem, GateTemplate_shptr gate_tmpl,
 		                         std::string const& directory);
 
@@ -53,6 +66,8 @@ namespace degate
 
 		ObjectIDRewriter_shptr oid_rewriter;
 
+		GateTemplate::image_load_list shared_images;
+
 	public:
 		GateLibraryExporter(ObjectIDRewriter_shptr _oid_rewriter) : oid_rewriter(_oid_rewriter)
 		{
@@ -68,6 +83,17 @@ namespace degate
 		 * @exception std::runtime_error
 		 */
 		void export_data(std::string const& filename, GateLibrary_shptr gate_lib);
+
+		/**
+		 * Set template images outside of the exported library, that might be backed by
+		 * the same image files, e.g. the images of the project a snapshot was taken
+		 * from. If the export overwrites such a file, the image is decoded before and
+		 * detached from the file (@see GateTemplate::detach_image_file()).
+		 */
+		void set_shared_images(GateTemplate::image_load_list const& images)
+		{
+			shared_images = images;
+		}
 	};
 }
 
@@ -21,9 +21,20 @@
 */
 
 #include <Core/LogicModel/Gate/GateTemplate.h>
+#include <Core/Image/ImageHelper.h>
+#include <Core/Utils/ParallelFor.h>
+
+#include <atomic>
+
+#include <boost/thread.hpp>
 
 using namespace degate;
 
+/**
+ * Source of image revisions, shared by all gate templates.
+ */
+static std::atomic<unsigned long> last_image_revision(0);
+
 void GateTemplate::increment_reference_counter()
 {
 	reference_counter++;
@@ -80,7 +91,12 @@ void GateTemplate::cloneDeepInto(DeepCopyable_shptr dest, oldnew_t* oldnew) cons
 	               });
 
 	// images
-	clone->images = images;
+	{
+		boost::mutex::scoped_lock lock(image_mutex);
+		clone->images = images;
+		clone->image_revisions = image_revisions;
+		clone->image_files = image_files;
+	}
 
 	ColoredObject::cloneDeepInto(dest, oldnew);
 	LogicModelObjectBase::cloneDeepInto(dest, oldnew);
@@ -116,23 +132,135 @@ void GateTemplate::set_image(Layer::LAYER_TYPE layer_type, GateTemplateImage_shp
 {
 	if (img == nullptr) throw InvalidPointerException("Invalid pointer for image.");
 	debug(TM, "set image for template.");
+
+	boost::mutex::scoped_lock lock(image_mutex);
 	images[layer_type] = img;
+	image_revisions[layer_type] = ++last_image_revision;
+	image_files.erase(layer_type);
+}
+
+void GateTemplate::set_image_file(Layer::LAYER_TYPE layer_type, std::string const& path)
+{
+	boost::mutex::scoped_lock lock(image_mutex);
+	images[layer_type] = GateTemplateImage_shptr();
+
+	image_file& file = image_files[layer_type];
+	file.path = path;
+	file.revision = image_revisions[layer_type] = ++last_image_revision;
 }
 
 
 GateTemplateImage_shptr GateTemplate::get_image(Layer::LAYER_TYPE layer_type)
 {
+	boost::mutex::scoped_lock lock(image_mutex);
+
 	image_collection::iterator found = images.find(layer_type);
 	if (found == images.end())
 		throw CollectionLookupException("Can't find reference image.");
-	else return (*found).second;
+
+	if (found->second == nullptr)
+	{
+		// The image is backed by a file, that was not decoded so far.
+		debug(TM, "load image for template from %s.", image_files[layer_type].path.c_str());
+		found->second = load_image<GateTemplateImage>(image_files[layer_type].path);
+	}
+
+	return found->second;
 }
 
 bool GateTemplate::has_image(Layer::LAYER_TYPE layer_type) const
 {
+	boost::mutex::scoped_lock lock(image_mutex);
 	return images.find(layer_type) != images.end();
 }
 
+unsigned long GateTemplate::get_image_revision(Layer::LAYER_TYPE layer_type) const
+{
+	boost::mutex::scoped_lock lock(image_mutex);
+	return find_image_revision(layer_type);
+}
+
+unsigned long GateTemplate::find_image_revision(Layer::LAYER_TYPE layer_type) const
+{
+	auto found = image_revisions.find(layer_type);
+	return found == image_revisions.end() ? 0 : found->second;
+}
+
+bool GateTemplate::is_image_loaded(Layer::LAYER_TYPE layer_type) const
+{
+	boost::mutex::scoped_lock lock(image_mutex);
+
+	auto found = images.find(layer_type);
+	return found != images.end() && found->second != nullptr;
+}
+
+std::string GateTemplate::get_image_file(Layer::LAYER_TYPE layer_type) const
+{
+	boost::mutex::scoped_lock lock(image_mutex);
+
+	auto found = image_files.find(layer_type);
+	if (found == image_files.end() || found->second.revision != find_image_revision(layer_type))
+		return "";
+
+	return found->second.path;
+}
+
+void GateTemplate::set_image_saved(Layer::LAYER_TYPE layer_type, std::string const& path)
+{
+	boost::mutex::scoped_lock lock(image_mutex);
+
+	if (images.find(layer_type) == images.end())
+		throw CollectionLookupException("Can't find reference image.");
+
+	image_file& file = image_files[layer_type];
+	file.path = path;
+	file.revision = find_image_revision(layer_type);
+}
+
+void GateTemplate::copy_saved_images(GateTemplate const& copy)
+{
+	std::map<Layer::LAYER_TYPE, image_file> copy_files;
+	{
+		boost::mutex::scoped_lock lock(copy.image_mutex);
+		copy_files = copy.image_files;
+	}
+
+	boost::mutex::scoped_lock lock(image_mutex);
+
+	for (auto const& entry : copy_files)
+	{
+		// Revisions are unique, the file holds the current image.
+		if (entry.second.revision != 0 && entry.second.revision == find_image_revision(entry.first))
+			image_files[entry.first] = entry.second;
+	}
+}
+
+void GateTemplate::detach_image_file(Layer::LAYER_TYPE layer_type)
+{
+	get_image(layer_type);
+
+	boost::mutex::scoped_lock lock(image_mutex);
+	image_files.erase(layer_type);
+}
+
+void GateTemplate::load_images(image_load_list const& images)
+{
+	image_load_list pending;
+	for (auto const& entry : images)
+	{
+		if (entry.first->has_image(entry.second) && !entry.first->is_image_loaded(entry.second))
+			pending.push_back(entry);
+	}
+
+	if (pending.empty())
+		return;
+
+	parallel_for(pending.size(), [&](size_t i)
+	{
+		pending[i].first->get_image(pending[i].second);
+	});
+}
+
 void GateTemplate::add_template_port(GateTemplatePort_shptr template_port)
 {
 	if (!template_port->has_valid_object_id())
@@ -30,6 +30,10 @@
 #include <set>
 #include <memory>
 #include <map>
+#include <vector>
+#include <utility>
+
+#include <boost/thread/mutex.hpp>
 
 namespace degate
 {
@@ -62,8 +66,20 @@ namespace degate
 		typedef std::map<Layer::LAYER_TYPE, GateTemplateImage_shptr> image_collection;
 		typedef image_collection::iterator image_iterator;
 
+		typedef std::vector<std::pair<GateTemplate_shptr, Layer::LAYER_TYPE>> image_load_list;
+
 	private:
 
+		/**
+		 * An image file that holds a reference image, together with the
+		 * image revision the file content corresponds to.
+		 */
+		struct image_file
+		{
+			std::string path;
+			unsigned long revision;
+		};
+
 		BoundingBox bounding_box;
 		unsigned int reference_counter;
 
@@ -71,9 +87,20 @@ namespace degate
 
 		implementation_collection implementations;
 		image_collection images;
+		std::map<Layer::LAYER_TYPE, unsigned long> image_revisions;
+		std::map<Layer::LAYER_TYPE, image_file> image_files;
+
+		// Guards the images, their revisions and their files.
+		mutable boost::mutex image_mutex;
 
 		std::string logic_class; // e.g. nand, xor, flipflop, buffer, oai
 
+		/**
+		 * Get the revision of a reference image, the image mutex must be held.
+		 * @see get_image_revision()
+		 */
+		unsigned long find_image_revision(Layer::LAYER_TYPE layer_type) const;
+
 	protected:
 
 		/**
@@ -189,6 +216,72 @@ namespace degate
 
 		virtual bool has_image(Layer::LAYER_TYPE layer_type) const;
 
+		/**
+		 * Get the revision of a reference image. Each call of set_image() gives the
+		 * image a new revision, unique among all gate templates. It can be used to
+		 * identify data derived from the image.
+		 * @return Returns the revision, or 0 if there is no image for \p layer_type.
+		 */
+
+		virtual unsigned long get_image_revision(Layer::LAYER_TYPE layer_type) const;
+
+		/**
+		 * Set a reference image for the template that is backed by an image file.
+		 * The file is not decoded here, but on the first call of get_image().
+		 * The image gets a new revision, as with set_image().
+		 */
+
+		virtual void set_image_file(Layer::LAYER_TYPE layer_type, std::string const& path);
+
+		/**
+		 * Check if the reference image for a layer type is decoded and in memory.
+		 * @return Returns false, if there is no image or if it is not loaded yet.
+		 */
+
+		virtual bool is_image_loaded(Layer::LAYER_TYPE layer_type) const;
+
+		/**
+		 * Get the path of the image file that holds the current revision of a reference image.
+		 * @return Returns an empty string, if there is no such file, e.g. because the image
+		 *   was changed with set_image() after it was loaded or saved.
+		 */
+
+		virtual std::string get_image_file(Layer::LAYER_TYPE layer_type) const;
+
+		/**
+		 * Record that the current revision of a reference image was written to a file.
+		 * @see get_image_file()
+		 */
+
+		virtual void set_image_saved(Layer::LAYER_TYPE layer_type, std::string const& path);
+
+		/**
+		 * Take over the image files saved for a copy of this template, e.g. for the
+		 * clone of a project snapshot. Only files of image revisions this template
+		 * still has are taken over.
+		 * @see set_image_saved()
+		 */
+
+		virtual void copy_saved_images(GateTemplate const& copy);
+
+		/**
+		 * Decode a reference image and detach it from its image file, e.g. because
+		 * the file will be overwritten. The image keeps its revision.
+		 * @exception CollectionLookupException This exception is thrown if there
+		 *   is no image for \p layer_type.
+		 */
+
+		virtual void detach_image_file(Layer::LAYER_TYPE layer_type);
+
+		/**
+		 * Decode reference images that are not loaded yet, using multiple threads.
+		 * Entries without an image or with an already loaded image are skipped.
+		 * @param images The template / layer type pairs to load.
+		 * @exception Rethrows the first exception thrown while decoding an image.
+		 */
+
+		static void load_images(image_load_list const& images);
+
 		/**
 		 * Add a template port to a gate template.
 		 * This is an isolated function. The port is just added to the gate template.
@@ -35,51 +35,103 @@ void HlObjectSet::set_object_update_function(std::function<void(PlacedLogicModel
     this->object_update_function = object_update_function;
 }
 
-void HlObjectSet::clear()
+void HlObjectSet::set_objects_update_function(std::function<void(std::vector<PlacedLogicModelObject_shptr> const&)> objects_update_function)
+{
+    this->objects_update_function = objects_update_function;
+}
+
+void HlObjectSet::begin_update()
+{
+	update_depth++;
+}
+
+void HlObjectSet::end_update()
 {
-	highlight(PlacedLogicModelObject::HLIGHTSTATE_NOT);
+	assert(update_depth > 0);
+	if (update_depth == 0 || --update_depth > 0) return;
+
+	if (changed_objects.empty()) return;
+
+	// An object might have changed more than once.
+	std::sort(changed_objects.begin(), changed_objects.end());
+	changed_objects.erase(std::unique(changed_objects.begin(), changed_objects.end()), changed_objects.end());
+
+	std::vector<PlacedLogicModelObject_shptr> objects;
+	objects.swap(changed_objects);
 
-	for(auto & adjacent_object : adjacent_objects)
+	if (objects_update_function)
+		objects_update_function(objects);
+	else if (object_update_function)
 	{
-		unhighlight_adjacent_objects(adjacent_object.second);
+		for (auto& o : objects)
+			object_update_function(o);
 	}
+}
 
-	adjacent_objects.clear();
-	ObjectSet::clear();
+void HlObjectSet::set_highlighted(PlacedLogicModelObject_shptr const& o,
+                                  PlacedLogicModelObject::HIGHLIGHTING_STATE state)
+{
+	if (o->get_highlighted() == state) return;
+
+	o->set_highlighted(state);
+	changed_objects.push_back(o);
 }
 
-void HlObjectSet::highlight(PlacedLogicModelObject::HIGHLIGHTING_STATE state)
+bool HlObjectSet::is_in_highlighted_net(PlacedLogicModelObject_shptr const& o) const
 {
-	for (auto& e : *this)
-    {
-        e->set_highlighted(state);
+	ConnectedLogicModelObject_shptr clo = std::dynamic_pointer_cast<ConnectedLogicModelObject>(o);
+	if (clo == nullptr || clo->get_net() == nullptr) return false;
 
-        if(object_update_function)
-            object_update_function(e);
-    }
+	return highlighted_nets.find(clo->get_net()) != highlighted_nets.end();
 }
 
+void HlObjectSet::clear()
+{
+	begin_update();
+
+	// Only highlighted objects are touched.
+	for (auto& net : highlighted_nets)
+	{
+		for (auto& clo : net.second.objects)
+			set_highlighted(clo, PlacedLogicModelObject::HLIGHTSTATE_NOT);
+	}
+
+	for (auto& e : *this)
+		set_highlighted(e, PlacedLogicModelObject::HLIGHTSTATE_NOT);
+
+	highlighted_nets.clear();
+	selected_nets.clear();
+	ObjectSet::clear();
+
+	end_update();
+}
 
 void HlObjectSet::add(std::shared_ptr<PlacedLogicModelObject> object)
 {
+	begin_update();
+
 	ObjectSet::add(object);
-	object->set_highlighted(PlacedLogicModelObject::HLIGHTSTATE_DIRECT);
+	set_highlighted(object, PlacedLogicModelObject::HLIGHTSTATE_DIRECT);
 
-    if(object_update_function)
-        object_update_function(object);
+	end_update();
 }
 
 void HlObjectSet::add(std::shared_ptr<PlacedLogicModelObject> object,
                       LogicModel_shptr lmodel)
 {
+	begin_update();
+
 	add(object);
 
 	if (ConnectedLogicModelObject_shptr o =
 		std::dynamic_pointer_cast<ConnectedLogicModelObject>(object))
 	{
 		// highlight adjacent objects
-		highlight_adjacent_objects(o, lmodel);
+		if (selected_nets.find(o) == selected_nets.end())
+			highlight_adjacent_objects(o, lmodel);
 	}
+
+	end_update();
 }
 
 
@@ -89,62 +141,70 @@ void HlObjectSet::highlight_adjacent_objects(ConnectedLogicModelObject_shptr o,
 	Net_shptr net = o->get_net();
 	if (net == nullptr) return;
 
+	selected_nets[o] = net;
+
+	// The net might be highlighted already by another selected object.
+	highlighted_net& hl_net = highlighted_nets[net];
+	if (hl_net.selected++ > 0) return;
+
+	hl_net.objects.reserve(net->size());
+
 	// iterate over net
 	for(auto& oid : *net)
 	{
 		PlacedLogicModelObject_shptr plo = lmodel->get_object(oid);
-		ConnectedLogicModelObject_shptr clo =
-			std::dynamic_pointer_cast<ConnectedLogicModelObject>(plo);
 
-		assert(clo != nullptr);
+		// Nets only hold connected objects.
+		assert(std::dynamic_pointer_cast<ConnectedLogicModelObject>(plo) != nullptr);
+		ConnectedLogicModelObject_shptr clo = std::static_pointer_cast<ConnectedLogicModelObject>(plo);
 
-		// remember connnected objects in list
-		if (o != clo)
-		{
-			clo->set_highlighted(PlacedLogicModelObject::HLIGHTSTATE_ADJACENT);
+		// remember connnected objects
+		hl_net.objects.push_back(clo);
 
-            if(object_update_function)
-                object_update_function(clo);
-
-			adjacent_objects[o].push_back(clo);
-		}
+		if (!contains(clo))
+			set_highlighted(clo, PlacedLogicModelObject::HLIGHTSTATE_ADJACENT);
 	}
 }
 
-void HlObjectSet::unhighlight_adjacent_objects(adjacent_objects_t::mapped_type& list)
+void HlObjectSet::unhighlight_adjacent_objects(ConnectedLogicModelObject_shptr o)
 {
-	// iterate over list
-	for(auto& clo : list)
+	auto selected = selected_nets.find(o);
+	if (selected == selected_nets.end()) return;
+
+	auto hl_net = highlighted_nets.find(selected->second);
+	selected_nets.erase(selected);
+
+	assert(hl_net != highlighted_nets.end());
+	if (hl_net == highlighted_nets.end() || --hl_net->second.selected > 0) return;
+
+	std::vector<ConnectedLogicModelObject_shptr> objects;
+	objects.swap(hl_net->second.objects);
+	highlighted_nets.erase(hl_net);
+
+	for(auto& clo : objects)
 	{
-		auto iter = adjacent_objects.find(clo);
-		if (iter == adjacent_objects.end())
-        {
-            clo->set_highlighted(PlacedLogicModelObject::HLIGHTSTATE_NOT);
-
-            if(object_update_function)
-                object_update_function(clo);
-        }
+		// The object might have moved to another highlighted net in the meantime.
+		if (!contains(clo) && !is_in_highlighted_net(clo))
+			set_highlighted(clo, PlacedLogicModelObject::HLIGHTSTATE_NOT);
 	}
-	list.clear();
 }
 
 void HlObjectSet::remove(std::shared_ptr<PlacedLogicModelObject> object)
 {
+	begin_update();
+
 	ObjectSet::remove(object);
 
 	if (ConnectedLogicModelObject_shptr o =
 		std::dynamic_pointer_cast<ConnectedLogicModelObject>(object))
 	{
-		auto iter = adjacent_objects.find(o);
-		if (iter != adjacent_objects.end())
-		{
-			unhighlight_adjacent_objects((*iter).second);
-		}
-		adjacent_objects.erase(iter);
+		unhighlight_adjacent_objects(o);
 	}
 
-	object->set_highlighted(PlacedLogicModelObject::HLIGHTSTATE_NOT);
+	// The object stays highlighted, if it is adjacent to another selected object.
+	set_highlighted(object, is_in_highlighted_net(object) ?
+		                        PlacedLogicModelObject::HLIGHTSTATE_ADJACENT :
+		                        PlacedLogicModelObject::HLIGHTSTATE_NOT);
 
-    if(object_update_function)
-        object_update_function(object);
+	end_update();
 }
@@ -26,6 +26,8 @@
 #include <list>
 #include <map>
 #include <memory>
+#include <vector>
+#include <functional>
 
 #include <Core/LogicModel/ObjectSet.h>
 
@@ -33,34 +35,106 @@ namespace degate
 {
 	/**
 	 * This class represents a collection of highlighted objects.
+	 *
+	 * If a connected object is added together with the logic model, all objects
+	 * of its net are highlighted as adjacent objects. The highlighting of a net is
+	 * reference counted by the number of selected objects of the net, so removing
+	 * an object only touches the objects of its own net.
+	 *
+	 * Objects with a changed highlighting state are collected and reported at the
+	 * end of each operation, or at the end of an update that is enclosed in
+	 * begin_update() and end_update().
 	 */
 	class HlObjectSet : public ObjectSet
 	{
 	private:
-		typedef std::map<ConnectedLogicModelObject_shptr,
-		                 std::list<ConnectedLogicModelObject_shptr>> adjacent_objects_t;
 
-		adjacent_objects_t adjacent_objects;
+		struct highlighted_net
+		{
+			// Number of selected objects of the net.
+			unsigned int selected;
+
+			// The objects of the net, when the net was highlighted.
+			std::vector<ConnectedLogicModelObject_shptr> objects;
+		};
+
+		typedef std::map<Net_shptr, highlighted_net> highlighted_nets_t;
+
+		highlighted_nets_t highlighted_nets;
+
+		// The highlighted net of each selected object.
+		std::map<ConnectedLogicModelObject_shptr, Net_shptr> selected_nets;
 
         std::function<void(PlacedLogicModelObject_shptr)> object_update_function;
+        std::function<void(std::vector<PlacedLogicModelObject_shptr> const&)> objects_update_function;
+
+		unsigned int update_depth = 0;
+		std::vector<PlacedLogicModelObject_shptr> changed_objects;
 
 	private:
 		void highlight_adjacent_objects(ConnectedLogicModelObject_shptr o,
 		                                LogicModel_shptr lmodel);
 
-		void unhighlight_adjacent_objects(adjacent_objects_t::mapped_type& list);
+		void unhighlight_adjacent_objects(ConnectedLogicModelObject_shptr o);
 
-		void highlight(PlacedLogicModelObject::HIGHLIGHTING_STATE state);
+		void set_highlighted(PlacedLogicModelObject_shptr const& o,
+		                     PlacedLogicModelObject::HIGHLIGHTING_STATE state);
+
+		bool is_in_highlighted_net(PlacedLogicModelObject_shptr const& o) const;
 
 	public:
 
 	    /**
 	     * Set a function that will be called every time an object state changed (like the highlight state).
+	     * It is not called if a function for changed objects is set (@see set_objects_update_function).
 	     *
 	     * @param object_update_function : the function to call.
 	     */
 	    void set_object_update_function(std::function<void(PlacedLogicModelObject_shptr)> object_update_function);
 
+	    /**
+	     * Set a function that will be called once with all objects whose state changed
+	     * during an operation (or during an update, @see begin_update).
+	     *
+	     * @param objects_update_function : the function to call.
+	     */
+	    void set_objects_update_function(std::function<void(std::vector<PlacedLogicModelObject_shptr> const&)> objects_update_function);
+
+		/**
+		 * Start an update. Changed objects are reported when the last update ends.
+		 * Updates can be nested.
+		 */
+		void begin_update();
+
+		/**
+		 * End an update and report changed objects if it is the outermost update.
+		 */
+		void end_update();
+
+		/**
+		 * Enclose a scope in an update. The update ends when the guard is destroyed,
+		 * also if the scope is left by an exception.
+		 */
+		class update_guard
+		{
+		public:
+			explicit update_guard(HlObjectSet& set) : set(set)
+			{
+				set.begin_update();
+			}
+
+			~update_guard()
+			{
+				set.end_update();
+			}
+
+			update_guard(update_guard const&) = delete;
+			update_guard& operator=(update_guard const&) = delete;
+
+		private:
+			HlObjectSet& set;
+		};
+
 		void clear();
 		void add(degate::PlacedLogicModelObject_shptr object);
 		void add(degate::PlacedLogicModelObject_shptr object,
@@ -23,6 +23,7 @@
 #include <Core/LogicModel/Layer.h>
 #include <Core/LogicModel/Gate/Gate.h>
 #include <Core/LogicModel/Via/Via.h>
+#include <Core/Image/Manipulation/ImageManipulation.h>
 
 
 #include <memory>
@@ -40,6 +41,17 @@ void Layer::add_object(std::shared_ptr<PlacedLogicModelObject> o)
 		throw DegateLogicException(fmter.str());
 	}
 
+	if (indexing_deferred)
+	{
+		boost::mutex::scoped_lock lock(index_mutex);
+		if (indexing_deferred)
+		{
+			pending_objects.push_back(o);
+			objects[o->get_object_id()] = o;
+			return;
+		}
+	}
+
 	if (RET_IS_NOT_OK(quadtree.insert(o)))
 	{
 		debug(TM, "Failed to insert object into quadtree.");
@@ -50,6 +62,8 @@ void Layer::add_object(std::shared_ptr<PlacedLogicModelObject> o)
 
 void Layer::remove_object(std::shared_ptr<PlacedLogicModelObject> o)
 {
+	build_object_index();
+
 	if (RET_IS_NOT_OK(quadtree.remove(o)))
 	{
 		debug(TM, "Failed to remove object from quadtree.");
@@ -59,10 +73,39 @@ void Layer::remove_object(std::shared_ptr<PlacedLogicModelObject> o)
 	objects.erase(o->get_object_id());
 }
 
+void Layer::defer_object_indexing()
+{
+	boost::mutex::scoped_lock lock(index_mutex);
+	indexing_deferred = true;
+}
+
+void Layer::build_deferred_object_index()
+{
+	boost::mutex::scoped_lock lock(index_mutex);
+	if (!indexing_deferred)
+		return;
+
+	debug(TM, "Insert %d pending objects into the quadtree of layer %d.",
+	      (int)pending_objects.size(), (int)layer_pos);
+
+	if (RET_IS_NOT_OK(quadtree.bulk_insert(std::move(pending_objects))))
+	{
+		debug(TM, "Failed to insert objects into quadtree.");
+		throw DegateRuntimeException("Failed to insert objects into quadtree.");
+	}
+
+	std::vector<PlacedLogicModelObject_shptr>().swap(pending_objects);
+	indexing_deferred = false;
+}
+
 Layer::Layer(BoundingBox const& bbox, Layer::LAYER_TYPE _layer_type) :
 	quadtree(bbox, 100),
 	layer_type(_layer_type),
 	layer_pos(0),
+	image_width(0),
+	image_height(0),
+	last_image_access(0),
+	indexing_deferred(false),
 	enabled(true),
 	layer_id(0)
 {
@@ -73,6 +116,10 @@ Layer::Layer(BoundingBox const& bbox, Layer::LAYER_TYPE _layer_type,
 	quadtree(bbox, 100),
 	layer_type(_layer_type),
 	layer_pos(0),
+	image_width(0),
+	image_height(0),
+	last_image_access(0),
+	indexing_deferred(false),
 	enabled(true),
 	layer_id(0)
 {
@@ -94,7 +141,14 @@ DeepCopyable_shptr Layer::cloneShallow() const
 	clone->enabled = enabled;
 	clone->description = description;
 	clone->layer_id = layer_id;
+
+	boost::mutex::scoped_lock lock(image_mutex);
 	clone->scaling_manager = scaling_manager;
+	clone->integral_image_manager = integral_image_manager;
+	clone->image_directory = image_directory;
+	clone->image_width = image_width;
+	clone->image_height = image_height;
+	clone->alignment = alignment;
 	return clone;
 }
 
@@ -102,19 +156,29 @@ void Layer::cloneDeepInto(DeepCopyable_shptr dest, oldnew_t* oldnew) const
 {
 	auto clone = std::dynamic_pointer_cast<Layer>(dest);
 
-	// quadtree
-	std::vector<quadtree_element_type> quadtree_elems;
-	quadtree.get_all_elements(quadtree_elems);
-	std::for_each(quadtree_elems.begin(), quadtree_elems.end(), [=,&clone](const quadtree_element_type& t)
+	// The quadtree holds the same objects as the object map, so clone the map once
+	// and build the clone's quadtree from it in one go.
+	std::vector<quadtree_element_type> cloned_objects;
+	cloned_objects.reserve(objects.size());
+
+	for (auto const& v : objects)
 	{
-		clone->quadtree.insert(std::dynamic_pointer_cast<PlacedLogicModelObject>(t->cloneDeep(oldnew)));
-	});
+		auto o = std::dynamic_pointer_cast<PlacedLogicModelObject>(v.second->cloneDeep(oldnew));
+		clone->objects.emplace_hint(clone->objects.end(), v.first, o);
+		cloned_objects.push_back(o);
+	}
 
-	// objects
-	std::for_each(objects.begin(), objects.end(), [&](object_collection::value_type v)
+	// A clone of a layer with pending objects stays deferred as well.
+	if (indexing_deferred)
 	{
-		clone->objects[v.first] = std::dynamic_pointer_cast<PlacedLogicModelObject>(v.second->cloneDeep(oldnew));
-	});
+		clone->pending_objects = std::move(cloned_objects);
+		clone->indexing_deferred = true;
+	}
+	else if (RET_IS_NOT_OK(clone->quadtree.bulk_insert(std::move(cloned_objects))))
+	{
+		debug(TM, "Failed to insert objects into quadtree.");
+		throw DegateRuntimeException("Failed to insert objects into quadtree.");
+	}
 }
 
 unsigned int Layer::get_width() const
@@ -177,7 +241,7 @@ void Layer::set_layer_type(LAYER_TYPE _layer_type)
 
 bool Layer::is_empty() const
 {
-	return quadtree.is_empty();
+	return objects.empty() && quadtree.is_empty();
 }
 
 layer_position_t Layer::get_layer_pos() const
@@ -187,6 +251,7 @@ layer_position_t Layer::get_layer_pos() const
 
 Layer::object_iterator Layer::objects_begin()
 {
+	build_object_index();
 	return quadtree.region_iter_begin();
 }
 
@@ -197,11 +262,13 @@ Layer::object_iterator Layer::objects_end()
 
 Layer::qt_region_iterator Layer::region_begin(int min_x, int max_x, int min_y, int max_y)
 {
+	build_object_index();
 	return quadtree.region_iter_begin(min_x, max_x, min_y, max_y);
 }
 
 Layer::qt_region_iterator Layer::region_begin(BoundingBox const& bbox)
 {
+	build_object_index();
 	return quadtree.region_iter_begin(bbox);
 }
 
@@ -212,15 +279,112 @@ Layer::qt_region_iterator Layer::region_end()
 
 void Layer::set_image(BackgroundImage_shptr img)
 {
-	scaling_manager =
+	auto new_scaling_manager =
 		std::make_shared<ScalingManager<BackgroundImage>>
 		(img, img->get_directory());
 
+	new_scaling_manager->create_scalings();
+
+	boost::mutex::scoped_lock lock(image_mutex);
+
+	new_scaling_manager->set_alignment(alignment);
+
+	scaling_manager = new_scaling_manager;
+	integral_image_manager = std::make_shared<IntegralImageManager>(scaling_manager, img->get_directory());
+
+	// Only persistent images can be reloaded from their directory.
+	if (img->is_persistent())
+	{
+		image_directory = img->get_directory();
+		image_width = img->get_width();
+		image_height = img->get_height();
+	}
+	else image_directory.clear();
+
+	last_image_access = std::time(nullptr);
+}
+
+void Layer::set_image_directory(std::string const& directory, unsigned int width, unsigned int height)
+{
+	if (!file_exists(directory))
+	{
+		boost::format fmter("Error in set_image_directory(): The image directory %1% does not exist.");
+		fmter % directory;
+		throw InvalidPathException(fmter.str());
+	}
+
+	boost::mutex::scoped_lock lock(image_mutex);
+
+	scaling_manager.reset();
+	integral_image_manager.reset();
+
+	image_directory = directory;
+	image_width = width;
+	image_height = height;
+}
+
+void Layer::load_image()
+{
+	last_image_access = std::time(nullptr);
+
+	if (scaling_manager != nullptr || image_directory.empty())
+		return;
+
+	debug(TM, "Load background image of layer %d from [%s].", (int)layer_pos, image_directory.c_str());
+
+	BackgroundImage_shptr img = load_degate_image<BackgroundImage>(image_width, image_height, image_directory);
+
+	scaling_manager = std::make_shared<ScalingManager<BackgroundImage>>(img, image_directory);
 	scaling_manager->create_scalings();
+	scaling_manager->set_alignment(alignment);
+
+	integral_image_manager = std::make_shared<IntegralImageManager>(scaling_manager, image_directory);
+}
+
+bool Layer::is_image_loaded() const
+{
+	boost::mutex::scoped_lock lock(image_mutex);
+	return scaling_manager != nullptr;
+}
+
+bool Layer::release_unused_image(std::time_t max_idle_time)
+{
+	boost::mutex::scoped_lock lock(image_mutex);
+
+	if (scaling_manager == nullptr || image_directory.empty())
+		return false;
+
+	if (std::time(nullptr) - last_image_access < max_idle_time)
+		return false;
+
+	// Somebody else still works with the image. The integral image manager
+	// holds a reference to the scaling manager, the scaling manager to the image.
+	if (integral_image_manager.use_count() > 1 ||
+	    scaling_manager.use_count() > (integral_image_manager != nullptr ? 2 : 1) ||
+	    scaling_manager->get_image(1).second.use_count() > 2)
+		return false;
+
+	debug(TM, "Release the background image of layer %d.", (int)layer_pos);
+
+	integral_image_manager.reset();
+	scaling_manager.reset();
+
+	return true;
+}
+
+void Layer::load()
+{
+	build_object_index();
+
+	boost::mutex::scoped_lock lock(image_mutex);
+	load_image();
 }
 
 BackgroundImage_shptr Layer::get_image()
 {
+	boost::mutex::scoped_lock lock(image_mutex);
+	load_image();
+
 	if (scaling_manager != nullptr)
 	{
 		ScalingManager<BackgroundImage>::image_map_element p = scaling_manager->get_image(1);
@@ -231,8 +395,15 @@ BackgroundImage_shptr Layer::get_image()
 
 std::string Layer::get_image_filename() const
 {
+	boost::mutex::scoped_lock lock(image_mutex);
+
 	if (scaling_manager == nullptr)
+	{
+		if (!image_directory.empty())
+			return image_directory;
+
 		throw DegateLogicException("There is no scaling manager.");
+	}
 	else
 	{
 		const ScalingManager<BackgroundImage>::image_map_element p =
@@ -247,26 +418,65 @@ std::string Layer::get_image_filename() const
 
 bool Layer::has_background_image() const
 {
-	return scaling_manager != nullptr;
+	boost::mutex::scoped_lock lock(image_mutex);
+	return scaling_manager != nullptr || !image_directory.empty();
 }
 
 void Layer::unset_image()
 {
 	if(!has_background_image())
 		return;
-	
-	if (scaling_manager == nullptr) throw DegateLogicException("There is no scaling manager.");
+
 	std::string img_dir = get_image_filename();
+
+	boost::mutex::scoped_lock lock(image_mutex);
 	scaling_manager.reset();
+	integral_image_manager.reset();
+	image_directory.clear();
 	debug(TM, "remove directory: %s", img_dir.c_str());
 	remove_directory(img_dir);
 }
 
 ScalingManager_shptr Layer::get_scaling_manager()
 {
+	boost::mutex::scoped_lock lock(image_mutex);
+	load_image();
 	return scaling_manager;
 }
 
+void Layer::set_alignment(AffineTransform const& new_alignment)
+{
+	// Throws, if the alignment is not invertible.
+	new_alignment.inverse();
+
+	boost::mutex::scoped_lock lock(image_mutex);
+
+	if (new_alignment == alignment)
+		return;
+
+	alignment = new_alignment;
+
+	if (scaling_manager != nullptr)
+		scaling_manager->set_alignment(alignment);
+
+	// Integral images hold the pixels of the aligned image.
+	if (integral_image_manager != nullptr)
+		integral_image_manager->invalidate();
+}
+
+AffineTransform Layer::get_alignment() const
+{
+	boost::mutex::scoped_lock lock(image_mutex);
+	return alignment;
+}
+
+IntegralImageManager_shptr Layer::get_integral_image_manager()
+{
+	boost::mutex::scoped_lock lock(image_mutex);
+	load_image();
+	return integral_image_manager;
+}
+
 void Layer::print(std::ostream& os)
 {
 	os
@@ -278,6 +488,7 @@ void Layer::print(std::ostream& os)
 		<< "Background image     : " << (has_background_image() ? get_image_filename() : "none") << std::endl
 		<< std::endl;
 
+	build_object_index();
 	quadtree.print(os);
 }
 
@@ -291,6 +502,7 @@ void Layer::notify_shape_change(object_id_t object_id)
 		throw CollectionLookupException("Error in Layer::notify_shape_change(): "
 			"The object is not in the layer.");
 
+	build_object_index();
 	quadtree.notify_shape_change((*iter).second);
 }
 
@@ -311,6 +523,8 @@ PlacedLogicModelObject_shptr Layer::get_object_at_position(float x, float y, flo
 	PlacedLogicModelObject_shptr object = nullptr;
     auto type = PlacedLogicModelObjectType::NONE;
 
+	build_object_index();
+
 	for (qt_region_iterator iter = quadtree.region_iter_begin(std::floor(x - max_distance),
                                                               std::ceil(x + max_distance),
                                                               std::floor(y - max_distance),
@@ -386,6 +600,8 @@ unsigned int Layer::get_distance_to_gate_boundary(unsigned int x, unsigned int y
                                                   unsigned int width,
                                                   unsigned int height)
 {
+	build_object_index();
+
 	for (Layer::qt_region_iterator iter = quadtree.region_iter_begin(x, x + width, y, y + height);
 	     iter != quadtree.region_iter_end(); ++iter)
 	{
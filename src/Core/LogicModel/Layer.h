@@ -27,13 +27,19 @@
 
 #include "Core/Primitive/Rectangle.h"
 #include "Core/Primitive/QuadTree.h"
+#include "Core/Primitive/AffineTransform.h"
 #include "Core/LogicModel/PlacedLogicModelObject.h"
 
 #include "Core/Image/Image.h"
 #include "Core/Image/Manipulation/ScalingManager.h"
+#include "Core/Image/Manipulation/IntegralImageManager.h"
 
 #include <set>
+#include <vector>
+#include <atomic>
+#include <ctime>
 #include <stdexcept>
+#include <boost/thread/mutex.hpp>
 
 namespace degate
 {
@@ -72,11 +78,26 @@ namespace degate
 		layer_position_t layer_pos;
 
 		std::shared_ptr<ScalingManager<BackgroundImage>> scaling_manager;
+		IntegralImageManager_shptr integral_image_manager;
+
+		// background image that is loaded on first access (@see set_image_directory())
+		std::string image_directory;
+		unsigned int image_width, image_height;
+		std::atomic<std::time_t> last_image_access;
+		mutable boost::mutex image_mutex;
+
+		// maps background image coordinates to project coordinates (@see set_alignment())
+		AffineTransform alignment;
 
 		// store shared pointers to objects, that belong to the layer
 		typedef std::map<object_id_t, PlacedLogicModelObject_shptr> object_collection;
 		object_collection objects;
 
+		// objects that are not inserted into the quadtree yet (@see defer_object_indexing())
+		std::vector<PlacedLogicModelObject_shptr> pending_objects;
+		std::atomic<bool> indexing_deferred;
+		boost::mutex index_mutex;
+
 		bool enabled;
 		std::string description;
 
@@ -102,6 +123,24 @@ namespace degate
 
 		void remove_object(std::shared_ptr<PlacedLogicModelObject> o);
 
+		/**
+		 * Insert pending objects into the quadtree, if indexing is deferred.
+		 * All methods that use the quadtree call this first.
+		 */
+		void build_object_index()
+		{
+			if (indexing_deferred)
+				build_deferred_object_index();
+		}
+
+		void build_deferred_object_index();
+
+		/**
+		 * Load the background image from the image directory, if it is not loaded.
+		 * The image mutex must be locked.
+		 */
+		void load_image();
+
 	public:
 
 
@@ -234,6 +273,56 @@ namespace degate
 
 		void set_image(BackgroundImage_shptr img);
 
+		/**
+		 * Set the background image for a layer, without loading it.
+		 * The image and its ScalingManager are created on first access, e.g. via
+		 * get_image() or get_scaling_manager(), or by load().
+		 * @param directory The directory of the tile based image.
+		 * @param width The width of the image.
+		 * @param height The height of the image.
+		 */
+
+		void set_image_directory(std::string const& directory, unsigned int width, unsigned int height);
+
+		/**
+		 * Check if the background image is loaded.
+		 * @return Returns false, if there is no background image or if it will be loaded on access.
+		 */
+
+		bool is_image_loaded() const;
+
+		/**
+		 * Release the background image, if it was not accessed for a while. It will be
+		 * loaded again on the next access. Only images with an image directory are
+		 * released and only if nobody else holds the scaling manager.
+		 * @param max_idle_time Release the image if it was not accessed for this number of seconds.
+		 * @return Returns true, if the image was released.
+		 */
+
+		bool release_unused_image(std::time_t max_idle_time);
+
+		/**
+		 * Defer the insertion of objects into the quadtree.
+		 * Objects that are added from now on are only registered. They are inserted into the
+		 * quadtree at once, on the first spatial query or by load(). This is used to load
+		 * large logic models, where most layers may never be viewed.
+		 */
+
+		void defer_object_indexing();
+
+		/**
+		 * Check if the layer has objects that are not inserted into the quadtree yet.
+		 */
+
+		bool has_pending_objects() const { return indexing_deferred; }
+
+		/**
+		 * Load all deferred data of the layer now: pending objects and the background image.
+		 * This method is thread safe.
+		 */
+
+		void load();
+
 
 		/**
 		 * Get the background image.
@@ -283,6 +372,31 @@ namespace degate
 
 		ScalingManager_shptr get_scaling_manager();
 
+		/**
+		 * Set the alignment of the layer.
+		 * The alignment maps coordinates of the background image to project coordinates.
+		 * It is applied when background image tiles are read, the image files are not changed.
+		 * @exception DegateRuntimeException This exception is thrown, if the alignment is not invertible.
+		 * @see align_layers()
+		 */
+		void set_alignment(AffineTransform const& new_alignment);
+
+		/**
+		 * Get the alignment of the layer.
+		 */
+		AffineTransform get_alignment() const;
+
+		/**
+		 * Get the integral image manager.
+		 * It gives greyscale versions of the background image and their summation
+		 * tables, computed once and shared by all matching runs.
+		 * @return Returns a shared pointer to the integral image manager. The pointer
+		 *   is a nullptr pointer if there is no background image.
+		 * @see set_image()
+		 */
+
+		IntegralImageManager_shptr get_integral_image_manager();
+
 		/**
 		 * Print the layer.
 		 */
@@ -334,6 +448,8 @@ namespace degate
 		bool exists_type_in_region(unsigned int min_x, unsigned int max_x,
 		                           unsigned int min_y, unsigned int max_y)
 		{
+			build_object_index();
+
 			for (Layer::qt_region_iterator iter = quadtree.region_iter_begin(min_x, max_x, min_y, max_y);
 			     iter != quadtree.region_iter_end(); ++iter)
 			{
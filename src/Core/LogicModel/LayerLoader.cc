@@ -0,0 +1,139 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+  Copyright 2012 Robert Nitsch
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "Core/LogicModel/LayerLoader.h"
+
+using namespace degate;
+
+LayerLoader::LayerLoader(std::time_t release_timeout, unsigned int check_interval) :
+	stop_requested(false),
+	loaded(true),
+	release_timeout(release_timeout),
+	check_interval(check_interval)
+{
+}
+
+LayerLoader::~LayerLoader()
+{
+	stop();
+}
+
+void LayerLoader::start(std::vector<Layer_shptr> const& layers_to_load)
+{
+	stop();
+
+	boost::mutex::scoped_lock lock(mutex);
+
+	layers.assign(layers_to_load.begin(), layers_to_load.end());
+	stop_requested = false;
+	loaded = false;
+	error.clear();
+
+	thread = boost::thread(&LayerLoader::run, this);
+}
+
+void LayerLoader::stop()
+{
+	{
+		boost::mutex::scoped_lock lock(mutex);
+		stop_requested = true;
+	}
+	condition.notify_all();
+
+	if (thread.joinable())
+		thread.join();
+}
+
+void LayerLoader::run()
+{
+	// Load all layers, one after the other.
+	for (auto& weak_layer : layers)
+	{
+		{
+			boost::mutex::scoped_lock lock(mutex);
+			if (stop_requested)
+				break;
+		}
+
+		Layer_shptr layer = weak_layer.lock();
+		if (layer == nullptr)
+			continue;
+
+		try
+		{
+			layer->load();
+		}
+		catch (std::exception const& e)
+		{
+			debug(TM, "Failed to load layer %d: %s", (int)layer->get_layer_pos(), e.what());
+
+			boost::mutex::scoped_lock lock(mutex);
+			if (error.empty())
+				error = e.what();
+		}
+	}
+
+	{
+		boost::mutex::scoped_lock lock(mutex);
+		loaded = true;
+	}
+	condition.notify_all();
+
+	if (release_timeout == 0)
+		return;
+
+	// Release unused images.
+	boost::mutex::scoped_lock lock(mutex);
+	while (!stop_requested)
+	{
+		condition.timed_wait(lock, boost::posix_time::seconds(check_interval));
+		if (stop_requested)
+			break;
+
+		lock.unlock();
+
+		for (auto& weak_layer : layers)
+		{
+			Layer_shptr layer = weak_layer.lock();
+			if (layer != nullptr)
+				layer->release_unused_image(release_timeout);
+		}
+
+		lock.lock();
+	}
+}
+
+void LayerLoader::wait_loaded()
+{
+	boost::mutex::scoped_lock lock(mutex);
+	while (!loaded)
+		condition.wait(lock);
+
+	if (!error.empty())
+		throw DegateRuntimeException("Failed to load a layer: " + error);
+}
+
+bool LayerLoader::is_loaded()
+{
+	boost::mutex::scoped_lock lock(mutex);
+	return loaded;
+}
@@ -0,0 +1,127 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+  Copyright 2012 Robert Nitsch
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __LAYERLOADER_H__
+#define __LAYERLOADER_H__
+
+#include "Globals.h"
+#include "Core/LogicModel/Layer.h"
+
+#include <boost/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <ctime>
+
+/**
+ * Release the background image of a layer, if it was not accessed for this number of seconds.
+ */
+#define LAYER_LOADER_RELEASE_TIMEOUT 600
+
+/**
+ * Number of seconds between two checks for unused layer images.
+ */
+#define LAYER_LOADER_CHECK_INTERVAL 30
+
+namespace degate
+{
+	/**
+	 * Load layers of a project in the background.
+	 *
+	 * After a project is opened, only the current layer is loaded. The layer loader
+	 * loads the remaining layers (quadtree and background image) in a background thread,
+	 * so that switching layers does not block. Layers that are accessed before the loader
+	 * reached them load themselves on first access.
+	 *
+	 * The background images (and their scaled versions) are built on the loader thread,
+	 * while other threads read their own images. This relies on the tile caches being
+	 * thread safe (@see TileCache).
+	 *
+	 * When all layers are loaded, the loader periodically releases background images
+	 * that were not accessed for a while (@see Layer::release_unused_image()).
+	 */
+	class LayerLoader
+	{
+	private:
+
+		std::vector<std::weak_ptr<Layer>> layers;
+
+		boost::thread thread;
+		boost::mutex mutex;
+		boost::condition_variable condition;
+
+		bool stop_requested;
+		bool loaded;
+		std::string error;
+
+		std::time_t release_timeout;
+		unsigned int check_interval;
+
+		void run();
+
+	public:
+
+		/**
+		 * Create a new layer loader.
+		 * @param release_timeout Release layer images that were not used for this number of seconds.
+		 *   Use 0 to never release images.
+		 * @param check_interval Number of seconds between two checks for unused images.
+		 */
+		LayerLoader(std::time_t release_timeout = LAYER_LOADER_RELEASE_TIMEOUT,
+		            unsigned int check_interval = LAYER_LOADER_CHECK_INTERVAL);
+
+		/**
+		 * Stop the background thread.
+		 */
+		~LayerLoader();
+
+		/**
+		 * Start to load the layers in the background. A running loader is stopped first.
+		 * The loader does not keep the layers alive.
+		 * @param layers The layers to load, in the order they should be loaded.
+		 */
+		void start(std::vector<Layer_shptr> const& layers);
+
+		/**
+		 * Stop the background thread.
+		 */
+		void stop();
+
+		/**
+		 * Block until all layers are loaded.
+		 * @throw DegateRuntimeException Is thrown if a layer failed to load.
+		 */
+		void wait_loaded();
+
+		/**
+		 * Check if all layers are loaded.
+		 */
+		bool is_loaded();
+	};
+
+	typedef std::shared_ptr<LayerLoader> LayerLoader_shptr;
+}
+
+#endif
@@ -46,6 +46,25 @@ std::shared_ptr<Layer> LogicModel::get_create_layer(layer_position_t pos)
 	return layers[pos];
 }
 
+void LogicModel::invalidate_connectivity_graph()
+{
+	connectivity_graph.reset();
+}
+
+ConnectivityGraph_shptr LogicModel::get_connectivity_graph()
+{
+	// net changes are not reported to the logic model, they are detected with a global counter
+	const unsigned long revision = Net::get_connections_revision();
+
+	if (connectivity_graph == nullptr || connectivity_graph_revision != revision)
+	{
+		connectivity_graph = std::make_shared<const ConnectivityGraph>(*this);
+		connectivity_graph_revision = revision;
+	}
+
+	return connectivity_graph;
+}
+
 void LogicModel::print(std::ostream& os)
 {
 	os
@@ -127,20 +146,52 @@ LogicModel::~LogicModel()
 {
 }
 
+/**
+ * A cloned placed object, with its object ID.
+ */
+typedef std::pair<object_id_t, PlacedLogicModelObject_shptr> cloned_object;
+
+/**
+ * Fill a collection of a cloned logic model with the clones of all objects of
+ * the \p source collection. Both \p source and \p cloned_objects are ordered by
+ * object ID, so they are walked side by side, type by type, without a lookup
+ * (and a dynamic cast) per object.
+ */
+template <typename Collection>
+static void fill_cloned_collection(Collection const& source,
+                                   Collection& clone,
+                                   std::vector<cloned_object> const& cloned_objects,
+                                   DeepCopyable::oldnew_t* oldnew)
+{
+	typedef typename Collection::mapped_type::element_type object_type;
+
+	std::vector<cloned_object>::const_iterator iter = cloned_objects.begin();
+
+	for (auto const& v : source)
+	{
+		while (iter != cloned_objects.end() && iter->first < v.first)
+			++iter;
+
+		// The clone of an object has the same ID and type.
+		if (iter != cloned_objects.end() && iter->first == v.first)
+			clone.emplace_hint(clone.end(), v.first, std::static_pointer_cast<object_type>(iter->second));
+		else
+			clone.emplace_hint(clone.end(), v.first, std::dynamic_pointer_cast<object_type>(v.second->cloneDeep(oldnew)));
+	}
+}
+
 DeepCopyable_shptr LogicModel::cloneShallow() const
 {
-	auto clone = std::make_shared<LogicModel>(*this);
-	clone->layers.clear();
-	clone->current_layer.reset();
+	// Copy the plain members only. Copying the whole logic model just to clear
+	// its collections afterwards is expensive for large projects.
+	auto clone = std::make_shared<LogicModel>(get_width(), get_height());
+	clone->bounding_box = bounding_box;
 	clone->gate_library.reset();
-	clone->gates.clear();
-	clone->wires.clear();
-	clone->vias.clear();
-	clone->emarkers.clear();
-	clone->annotations.clear();
-	clone->nets.clear();
-	clone->objects.clear();
 	clone->main_module.reset();
+	clone->object_id_counter = object_id_counter;
+	clone->removed_remote_oids = removed_remote_oids;
+	clone->roid_mapping = roid_mapping;
+	clone->port_diameter = port_diameter;
 	return clone;
 }
 
@@ -148,6 +199,9 @@ void LogicModel::cloneDeepInto(DeepCopyable_shptr dest, oldnew_t* oldnew) const
 {
 	auto clone = std::dynamic_pointer_cast<LogicModel>(dest);
 
+	// Every placed object, net and layer is cloned exactly once, pre-size the mapping for them.
+	oldnew->reserve(oldnew->size() + objects.size() + nets.size() + layers.size());
+
 	// layers
 	std::transform(layers.begin(), layers.end(), back_inserter(clone->layers), [&](const Layer_shptr& d)
 	{
@@ -162,46 +216,34 @@ void LogicModel::cloneDeepInto(DeepCopyable_shptr dest, oldnew_t* oldnew) const
 	// gate_library
 	clone->gate_library = std::dynamic_pointer_cast<GateLibrary>(gate_library->cloneDeep(oldnew));
 
-	// gates
-	std::for_each(gates.begin(), gates.end(), [&](const gate_collection::value_type& v)
-	{
-		clone->gates[v.first] = std::dynamic_pointer_cast<Gate>(v.second->cloneDeep(oldnew));
-	});
-
-	// wires
-	std::for_each(wires.begin(), wires.end(), [&](const wire_collection::value_type& v)
-	{
-		clone->wires[v.first] = std::dynamic_pointer_cast<Wire>(v.second->cloneDeep(oldnew));
-	});
-
-	// vias
-	std::for_each(vias.begin(), vias.end(), [&](const via_collection::value_type& v)
-	{
-		clone->vias[v.first] = std::dynamic_pointer_cast<Via>(v.second->cloneDeep(oldnew));
-	});
+	// The layers cloned all placed objects and their object maps are sorted by ID. Merge
+	// them, instead of looking up the clone of every object in the mapping again.
+	std::vector<cloned_object> cloned_objects;
+	cloned_objects.reserve(objects.size());
 
-	// emarkers
-	std::for_each(emarkers.begin(), emarkers.end(), [&](const emarker_collection::value_type& v)
+	for (auto const& layer : clone->layers)
 	{
-		clone->emarkers[v.first] = std::dynamic_pointer_cast<EMarker>(v.second->cloneDeep(oldnew));
-	});
+		const size_t middle = cloned_objects.size();
+		cloned_objects.insert(cloned_objects.end(), layer->objects.begin(), layer->objects.end());
+		std::inplace_merge(cloned_objects.begin(), cloned_objects.begin() + middle, cloned_objects.end(),
+		                   [](cloned_object const& a, cloned_object const& b)
+		                   {
+			                   return a.first < b.first;
+		                   });
+	}
 
-	// annotations
-	std::for_each(annotations.begin(), annotations.end(), [&](const annotation_collection::value_type& v)
-	{
-		clone->annotations[v.first] = std::dynamic_pointer_cast<Annotation>(v.second->cloneDeep(oldnew));
-	});
+	// objects, gates, wires, vias, emarkers and annotations
+	fill_cloned_collection(objects, clone->objects, cloned_objects, oldnew);
+	fill_cloned_collection(gates, clone->gates, cloned_objects, oldnew);
+	fill_cloned_collection(wires, clone->wires, cloned_objects, oldnew);
+	fill_cloned_collection(vias, clone->vias, cloned_objects, oldnew);
+	fill_cloned_collection(emarkers, clone->emarkers, cloned_objects, oldnew);
+	fill_cloned_collection(annotations, clone->annotations, cloned_objects, oldnew);
 
 	// nets
 	std::for_each(nets.begin(), nets.end(), [&](const net_collection::value_type& v)
 	{
-		clone->nets[v.first] = std::dynamic_pointer_cast<Net>(v.second->cloneDeep(oldnew));
-	});
-
-	// objects
-	std::for_each(objects.begin(), objects.end(), [&](const object_collection::value_type& v)
-	{
-		clone->objects[v.first] = std::dynamic_pointer_cast<PlacedLogicModelObject>(v.second->cloneDeep(oldnew));
+		clone->nets.emplace_hint(clone->nets.end(), v.first, std::dynamic_pointer_cast<Net>(v.second->cloneDeep(oldnew)));
 	});
 
 	// main_module
@@ -331,6 +373,7 @@ void LogicModel::remove_annotation(Annotation_shptr o)
 void LogicModel::add_object(int layer_pos, PlacedLogicModelObject_shptr o)
 {
 	if (o == nullptr) throw InvalidPointerException();
+	invalidate_connectivity_graph();
 	if (!o->has_valid_object_id()) o->set_object_id(get_new_object_id());
 	object_id_t object_id = o->get_object_id();
 
@@ -410,6 +453,7 @@ void LogicModel::remove_remote_object(object_id_t remote_id)
 void LogicModel::remove_object(PlacedLogicModelObject_shptr o, bool add_to_remove_list)
 {
 	if (o == nullptr) throw InvalidPointerException();
+	invalidate_connectivity_graph();
 	Layer_shptr layer = o->get_layer();
 	if (layer == nullptr)
 	{
@@ -543,6 +587,9 @@ void LogicModel::update_ports(Gate_shptr gate)
 	if (gate == nullptr)
 		throw InvalidPointerException("Invalid parameter for update_ports()");
 
+	// the template or the port types may have changed
+	invalidate_connectivity_graph();
+
 	GateTemplate_shptr gate_template = gate->get_gate_template();
 
 	debug(TM, "update ports on gate %d", gate->get_object_id());
@@ -635,6 +682,9 @@ void LogicModel::update_ports(Gate_shptr gate)
 		gate->remove_port(*iter);
 		remove_object(*iter);
 	}
+
+	// keep the gate port index of the module hierarchy in sync
+	if (main_module != nullptr) main_module->update_gate_ports(gate);
 }
 
 void LogicModel::update_ports(GateTemplate_shptr gate_template)
@@ -780,6 +830,7 @@ void LogicModel::set_gate_library(GateLibrary_shptr new_gate_lib)
 		// XXX
 	}
 	gate_library = new_gate_lib;
+	invalidate_connectivity_graph();
 }
 
 void LogicModel::add_net(Net_shptr net)
@@ -794,6 +845,7 @@ void LogicModel::add_net(Net_shptr net)
 		throw DegateRuntimeException(f.str());
 	}
 	nets[net->get_object_id()] = net;
+	invalidate_connectivity_graph();
 }
 
 
@@ -846,6 +898,8 @@ void LogicModel::remove_net(Net_shptr net)
 		//nets[net->get_object_id()].reset();
 		size_t n = nets.erase(net->get_object_id());
 		assert(n == 1);
+
+		invalidate_connectivity_graph();
 	}
 }
 
@@ -40,6 +40,7 @@
 #include <Core/LogicModel/Gate/GateLibrary.h>
 #include <Core/LogicModel/Annotation/Annotation.h>
 #include <Core/LogicModel/Module.h>
+#include <Core/LogicModel/ConnectivityGraph.h>
 
 #include <memory>
 #include <set>
@@ -114,6 +115,13 @@ namespace degate
 
 		diameter_t port_diameter = 5;
 
+		/**
+		 * Cached connectivity snapshot, reset on structural changes and
+		 * rebuilt if a net changed since it was built.
+		 */
+		ConnectivityGraph_shptr connectivity_graph;
+		unsigned long connectivity_graph_revision = 0;
+
 	private:
 
 		/**
@@ -223,6 +231,11 @@ namespace degate
 
 		bool exists_layer_id(layer_collection const& layers, layer_id_t lid) const;
 
+		/**
+		 * Drop the cached connectivity graph.
+		 */
+		void invalidate_connectivity_graph();
+
 	public:
 
 		/**
@@ -603,6 +616,17 @@ namespace degate
 		annotation_collection::iterator annotations_end();
 
 
+		/**
+		 * Get a read-only connectivity snapshot of gates, gate ports and nets.
+		 * The snapshot is built on the first call and rebuilt on the next call after
+		 * the logic model or a net changed. Snapshots already handed out stay valid,
+		 * but are not updated.
+		 * Note: changing the type of a template port doesn't invalidate the snapshot,
+		 * call update_ports() afterwards.
+		 */
+		ConnectivityGraph_shptr get_connectivity_graph();
+
+
 		/**
 		 * Print the content of the logic model into an ostream.
 		 */
@@ -23,10 +23,14 @@
 #include <Core/LogicModel/LogicModelHelper.h>
 #include <Core/LogicModel/LogicModelObjectBase.h>
 #include <Core/Utils/TangencyCheck.h>
+#include <Core/Image/Manipulation/ImageRegistration.h>
+#include <Core/Image/Manipulation/MosaicStitching.h>
 
 #include <boost/format.hpp>
 #include <boost/foreach.hpp>
 
+#include <numeric>
+
 using namespace degate;
 
 Layer_shptr degate::get_first_layer(LogicModel_shptr lmodel, Layer::LAYER_TYPE layer_type)
@@ -224,6 +228,40 @@ void degate::load_background_image(Layer_shptr layer,
 	debug(TM, "Done.");
 }
 
+void degate::load_background_mosaic(Layer_shptr layer,
+                                    std::string const& project_dir,
+                                    std::string const& grid_file)
+{
+	if (layer == nullptr)
+		throw InvalidPointerException("Error: you passed an invalid pointer to load_background_mosaic()");
+
+	debug(TM, "Read frame grid %s", grid_file.c_str());
+	MosaicStitcher stitcher(MosaicStitcher::read_frame_grid(grid_file));
+
+	debug(TM, "Refine frame positions.");
+	stitcher.refine_positions();
+
+	boost::format fmter("layer_%1%.dimg");
+	fmter % layer->get_layer_id();
+
+	std::string dir(join_pathes(project_dir, fmter.str()));
+
+	if (layer->has_background_image())
+		layer->unset_image();
+
+	debug(TM, "Create background image in %s", dir.c_str());
+	BackgroundImage_shptr bg_image(new BackgroundImage(layer->get_width(),
+	                                                   layer->get_height(),
+	                                                   dir));
+
+	debug(TM, "Stitch frames.");
+	stitcher.stitch(bg_image);
+
+	debug(TM, "Set image to layer.");
+	layer->set_image(bg_image);
+	debug(TM, "Done.");
+}
+
 
 void degate::clear_logic_model(LogicModel_shptr lmodel, Layer_shptr layer)
 {
@@ -547,94 +585,176 @@ void degate::connect_objects(LogicModel_shptr lmodel,
 }
 
 
-void degate::autoconnect_objects(LogicModel_shptr lmodel, Layer_shptr layer,
-                                 BoundingBox const& search_bbox)
+/**
+ * Connect the objects of each connected component that is formed by tangent object pairs.
+ * A component is connected at once, this creates one net per component instead of one per pair.
+ */
+static void connect_tangent_objects(LogicModel_shptr lmodel,
+                                    std::vector<ConnectedLogicModelObject_shptr> const& objects,
+                                    TangencyBatch::index_pair_collection const& pairs)
 {
-	if (lmodel == nullptr || layer == nullptr)
-		throw InvalidPointerException("You passed an invalid shared pointer.");
+	std::vector<unsigned int> parent(objects.size());
+	std::iota(parent.begin(), parent.end(), 0);
+
+	auto find = [&](unsigned int i)
+	{
+		while (parent[i] != i)
+		{
+			parent[i] = parent[parent[i]];
+			i = parent[i];
+		}
+		return i;
+	};
+
+	std::vector<bool> paired(objects.size(), false);
+
+	for (auto const& p : pairs)
+	{
+		paired[p.first] = paired[p.second] = true;
+
+		const unsigned int a = find(p.first), b = find(p.second);
+		if (a != b)
+			parent[std::max(a, b)] = std::min(a, b);
+	}
+
+	std::map<unsigned int, std::vector<ConnectedLogicModelObject_shptr>> components;
+	for (unsigned int i = 0; i < objects.size(); i++)
+	{
+		if (paired[i])
+			components[find(i)].push_back(objects[i]);
+	}
+
+	for (auto& component : components)
+		connect_objects(lmodel, component.second.begin(), component.second.end());
+}
+
+/**
+ * Check if two objects are not connected already.
+ */
+static bool needs_connection(ConnectedLogicModelObject_shptr o1, ConnectedLogicModelObject_shptr o2)
+{
+	return o1->get_net() == nullptr || o2->get_net() == nullptr || o1->get_net() != o2->get_net();
+}
+
+/**
+ * Get the region that is covered by the bounding boxes of objects in a region of a layer.
+ * Objects that touch the objects in \p search_bbox are within this region.
+ * @return Returns false, if there are no objects of type \p T in the search region.
+ */
+template <typename T>
+static bool get_neighbourhood(Layer_shptr layer, BoundingBox const& search_bbox, BoundingBox& neighbourhood)
+{
+	bool found = false;
 
-	// iterate over connectable objects
 	for (Layer::qt_region_iterator iter = layer->region_begin(search_bbox);
 	     iter != layer->region_end(); ++iter)
 	{
-		ConnectedLogicModelObject_shptr clmo1;
+		if (std::dynamic_pointer_cast<T>(*iter) == nullptr)
+			continue;
 
-		if ((clmo1 = std::dynamic_pointer_cast<ConnectedLogicModelObject>(*iter)) != nullptr)
-		{
-			BoundingBox const& bb = clmo1->get_bounding_box();
-
-			/* Iterate over connectable objects in the region identified
-		   by bounding box bb.
-			*/
-			for (Layer::qt_region_iterator siter = layer->region_begin(bb);
-			     siter != layer->region_end(); ++siter)
-			{
-				ConnectedLogicModelObject_shptr clmo2;
-				if ((clmo2 =
-					std::dynamic_pointer_cast<ConnectedLogicModelObject>(*siter)) != nullptr)
-				{
-					if ((clmo1->get_net() == nullptr ||
-							clmo2->get_net() == nullptr ||
-							clmo1->get_net() != clmo2->get_net()) && // excludes identical objects, too
-						check_object_tangency(std::dynamic_pointer_cast<PlacedLogicModelObject>(clmo1),
-						                      std::dynamic_pointer_cast<PlacedLogicModelObject>(clmo2)))
+		BoundingBox const& bb = (*iter)->get_bounding_box();
 
-						connect_objects(lmodel, clmo1, clmo2);
-				}
-			}
-		}
+		if (!found)
+			neighbourhood = bb;
+		else
+			neighbourhood.set(std::min(neighbourhood.get_min_x(), bb.get_min_x()),
+			                  std::max(neighbourhood.get_max_x(), bb.get_max_x()),
+			                  std::min(neighbourhood.get_min_y(), bb.get_min_y()),
+			                  std::max(neighbourhood.get_max_y(), bb.get_max_y()));
+		found = true;
 	}
+
+	return found;
 }
 
-void autoconnect_interlayer_objects_via_via(LogicModel_shptr lmodel,
-                                            Layer_shptr adjacent_layer,
-                                            BoundingBox const& search_bbox,
-                                            Via_shptr v1,
-                                            Via::DIRECTION v1_dir_criteria,
-                                            Via::DIRECTION v2_dir_criteria)
+void degate::autoconnect_objects(LogicModel_shptr lmodel, Layer_shptr layer,
+                                 BoundingBox const& search_bbox)
 {
-	Via_shptr v2;
+	if (lmodel == nullptr || layer == nullptr)
+		throw InvalidPointerException("You passed an invalid shared pointer.");
+
+	BoundingBox neighbourhood;
+	if (!get_neighbourhood<ConnectedLogicModelObject>(layer, search_bbox, neighbourhood))
+		return;
 
-	for (Layer::qt_region_iterator siter = adjacent_layer->region_begin(search_bbox);
-	     siter != adjacent_layer->region_end(); ++siter)
+	// collect connectable objects in the search region and their neighbours
+	TangencyBatch batch;
+	std::vector<ConnectedLogicModelObject_shptr> objects;
+	std::vector<bool> searched;
+
+	for (Layer::qt_region_iterator iter = layer->region_begin(neighbourhood);
+	     iter != layer->region_end(); ++iter)
 	{
-		if ((v2 = std::dynamic_pointer_cast<Via>(*siter)) != nullptr)
+		if (ConnectedLogicModelObject_shptr clmo = std::dynamic_pointer_cast<ConnectedLogicModelObject>(*iter))
 		{
-			if ((v1->get_net() == nullptr || v2->get_net() == nullptr ||
-					v1->get_net() != v2->get_net()) &&
-				v1->get_direction() == v1_dir_criteria &&
-				v2->get_direction() == v2_dir_criteria &&
-				check_object_tangency(std::dynamic_pointer_cast<Circle>(v1),
-				                      std::dynamic_pointer_cast<Circle>(v2)))
-				connect_objects(lmodel,
-				                std::dynamic_pointer_cast<ConnectedLogicModelObject>(v1),
-				                std::dynamic_pointer_cast<ConnectedLogicModelObject>(v2));
+			batch.add_object(*iter);
+			objects.push_back(clmo);
+			searched.push_back(clmo->get_bounding_box().intersects(search_bbox));
 		}
 	}
+
+	TangencyBatch::index_pair_collection pairs;
+
+	// An unconnected object in the search region, that is tangent to itself, gets a net of its own.
+	for (unsigned int i = 0; i < objects.size(); i++)
+	{
+		if (searched[i] && objects[i]->get_net() == nullptr && batch.check_tangency(i, batch, i))
+			pairs.push_back(std::make_pair(i, i));
+	}
+
+	for (auto const& p : batch.find_tangent_pairs())
+	{
+		if ((searched[p.first] || searched[p.second]) && needs_connection(objects[p.first], objects[p.second]))
+			pairs.push_back(p);
+	}
+
+	connect_tangent_objects(lmodel, objects, pairs);
 }
 
-void autoconnect_interlayer_objects_via_gport(LogicModel_shptr lmodel,
-                                              Layer_shptr adjacent_layer,
-                                              BoundingBox const& search_bbox,
-                                              Via_shptr v1,
-                                              Via::DIRECTION v1_dir_criteria)
+/**
+ * Find vias (and gate ports) on an adjacent layer, that are tangent to vias on a layer.
+ * @param vias The vias on the layer.
+ * @param objects The connectable objects, starting with the vias. Found objects are appended.
+ * @param pairs Tangent pairs, as indices in \p objects.
+ */
+static void find_interlayer_pairs(Layer_shptr adjacent_layer,
+                                  BoundingBox const& neighbourhood,
+                                  TangencyBatch const& vias,
+                                  Via::DIRECTION via_direction,
+                                  Via::DIRECTION adjacent_via_direction,
+                                  bool connect_gate_ports,
+                                  std::vector<ConnectedLogicModelObject_shptr>& objects,
+                                  TangencyBatch::index_pair_collection& pairs)
 {
-	GatePort_shptr v2;
+	TangencyBatch adjacent;
+	const unsigned int offset = objects.size();
 
-	for (Layer::qt_region_iterator siter = adjacent_layer->region_begin(search_bbox);
-	     siter != adjacent_layer->region_end(); ++siter)
+	for (Layer::qt_region_iterator iter = adjacent_layer->region_begin(neighbourhood);
+	     iter != adjacent_layer->region_end(); ++iter)
 	{
-		if ((v2 = std::dynamic_pointer_cast<GatePort>(*siter)) != nullptr)
+		ConnectedLogicModelObject_shptr clmo;
+
+		if (Via_shptr via = std::dynamic_pointer_cast<Via>(*iter))
 		{
-			if ((v1->get_net() == nullptr || v2->get_net() == nullptr ||
-					v1->get_net() != v2->get_net()) &&
-				v1->get_direction() == v1_dir_criteria &&
-				check_object_tangency(std::dynamic_pointer_cast<Circle>(v1),
-				                      std::dynamic_pointer_cast<Circle>(v2)))
-				connect_objects(lmodel,
-				                std::dynamic_pointer_cast<ConnectedLogicModelObject>(v1),
-				                std::dynamic_pointer_cast<ConnectedLogicModelObject>(v2));
+			if (via->get_direction() == adjacent_via_direction)
+				clmo = via;
 		}
+		else if (connect_gate_ports)
+			clmo = std::dynamic_pointer_cast<GatePort>(*iter);
+
+		if (clmo != nullptr)
+		{
+			adjacent.add_object(*iter);
+			objects.push_back(clmo);
+		}
+	}
+
+	for (auto const& p : vias.find_tangent_pairs(adjacent))
+	{
+		Via_shptr via = std::dynamic_pointer_cast<Via>(vias.get_object(p.first));
+
+		if (via->get_direction() == via_direction && needs_connection(objects[p.first], objects[offset + p.second]))
+			pairs.push_back(std::make_pair(p.first, offset + p.second));
 	}
 }
 
@@ -649,32 +769,81 @@ void degate::autoconnect_interlayer_objects(LogicModel_shptr lmodel,
 		layer_above = get_next_enabled_layer(lmodel, layer),
 		layer_below = get_prev_enabled_layer(lmodel, layer);
 
-	Via_shptr v1;
+	BoundingBox neighbourhood;
+	if (!get_neighbourhood<Via>(layer, search_bbox, neighbourhood))
+		return;
+
+	// collect vias in the search region
+	TangencyBatch vias;
+	std::vector<ConnectedLogicModelObject_shptr> objects;
 
-	// iterate over objects
 	for (Layer::qt_region_iterator iter = layer->region_begin(search_bbox);
 	     iter != layer->region_end(); ++iter)
 	{
-		if ((v1 = std::dynamic_pointer_cast<Via>(*iter)) != nullptr)
+		if (Via_shptr via = std::dynamic_pointer_cast<Via>(*iter))
 		{
-			BoundingBox const& bb = v1->get_bounding_box();
+			vias.add_object(via);
+			objects.push_back(via);
+		}
+	}
 
-			/* Iterate over vias one layer above and one layer below
-		   in the region identified by bounding box bb. */
+	/* Connect with vias one layer above and with vias and gate ports one layer below. */
 
-			if (layer_above != nullptr)
-				autoconnect_interlayer_objects_via_via(lmodel, layer_above, bb, v1,
-				                                       Via::DIRECTION_UP, Via::DIRECTION_DOWN);
+	TangencyBatch::index_pair_collection pairs;
 
-			if (layer_below != nullptr)
-			{
-				autoconnect_interlayer_objects_via_via(lmodel, layer_below, bb, v1,
-				                                       Via::DIRECTION_DOWN, Via::DIRECTION_UP);
-				autoconnect_interlayer_objects_via_gport(lmodel, layer_below, bb, v1,
-				                                         Via::DIRECTION_DOWN);
-			}
+	if (layer_above != nullptr)
+		find_interlayer_pairs(layer_above, neighbourhood, vias, Via::DIRECTION_UP, Via::DIRECTION_DOWN, false,
+		                      objects, pairs);
+
+	if (layer_below != nullptr)
+		find_interlayer_pairs(layer_below, neighbourhood, vias, Via::DIRECTION_DOWN, Via::DIRECTION_UP, true,
+		                      objects, pairs);
+
+	connect_tangent_objects(lmodel, objects, pairs);
+}
+
+void degate::align_layers(LogicModel_shptr lmodel)
+{
+	if (lmodel == nullptr)
+		throw InvalidPointerException("You passed an invalid shared pointer.");
+
+	std::vector<Layer_shptr> layers;
+	std::vector<AffineTransform> old_alignments;
+
+	for (layer_position_t pos = 0; pos < lmodel->get_num_layers(); pos++)
+	{
+		Layer_shptr layer = lmodel->get_layer(pos);
+		if (layer == nullptr || !layer->has_background_image())
+			continue;
+
+		layers.push_back(layer);
+		old_alignments.push_back(layer->get_alignment());
+	}
+
+	std::vector<AffineTransform> alignments;
+
+	try
+	{
+		// register the images as they are stored
+		std::vector<ScalingManager_shptr> images;
+		for (auto const& layer : layers)
+		{
+			layer->set_alignment(AffineTransform());
+			images.push_back(layer->get_scaling_manager());
 		}
+
+		alignments = register_images(images);
+	}
+	catch (...)
+	{
+		// Keep the previous alignments.
+		for (unsigned int i = 0; i < layers.size(); i++)
+			layers[i]->set_alignment(old_alignments[i]);
+		throw;
 	}
+
+	for (unsigned int i = 0; i < layers.size(); i++)
+		layers[i]->set_alignment(alignments[i]);
 }
 
 void degate::update_port_diameters(LogicModel_shptr lmodel, diameter_t new_size)
@@ -328,6 +328,18 @@ namespace degate
 	                                    Layer_shptr layer,
 	                                    BoundingBox const& search_bbox);
 
+	/**
+	 * Align the background images of the layers to each other.
+	 * The lowest layer with a background image is the reference, each other layer is
+	 * registered to the layer below and gets an alignment (@see Layer::set_alignment()).
+	 * Previous alignments are replaced, they are kept if the registration fails.
+	 * The background images are not changed.
+	 * @exception InvalidPointerException If you pass an invalid shared pointer for the
+	 *   logic model, then this exception is raised.
+	 * @see register_images()
+	 */
+	void align_layers(LogicModel_shptr lmodel);
+
 
 	/**
 	 * Load an image in a common image format as background image for a layer.
@@ -341,6 +353,19 @@ namespace degate
 	                           std::string const& project_dir,
 	                           std::string const& image_file);
 
+	/**
+	 * Stitch a grid of overlapping frames (e.g. microscope images) into the background
+	 * image of a layer. The frame positions are refined before the frames are blended.
+	 * If there is already a background image, it will be unset and removed from
+	 * the project directory.
+	 * @param grid_file The frame grid file (@see MosaicStitcher::read_frame_grid()).
+	 * @exception InvalidPointerException If you pass an invalid shared pointer for
+	 *   \p layer, then this exception is raised.
+	 */
+	void load_background_mosaic(Layer_shptr layer,
+	                            std::string const& project_dir,
+	                            std::string const& grid_file);
+
 	/**
 	 * Clear the logic model for a layer.
 	 * @exception InvalidPointerException If you pass an invalid shared pointer for
@@ -72,6 +72,11 @@ void LogicModelImporter::import_into(LogicModel_shptr lmodel,
 
 		lmodel->set_gate_library(gate_library);
 
+		// Build the spatial indexes of the layers on first use, not while parsing.
+		for (LogicModel::layer_collection::iterator iter = lmodel->layers_begin();
+		     iter != lmodel->layers_end(); ++iter)
+			(*iter)->defer_object_indexing();
+
 		parse_logic_model_element(root_elem, lmodel);
 
 		// check if the ports of placed standard cell are available and create them if necessary
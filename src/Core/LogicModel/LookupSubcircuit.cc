@@ -0,0 +1,394 @@
+/* -*-c++-*-
+
+ This file is part of the IC reverse engineering tool degate.
+
+ Copyright 2008, 2009, 2010 by Martin Schobert
+
+ Degate is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ any later version.
+
+ Degate is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <Core/LogicModel/LookupSubcircuit.h>
+#include <Core/LogicModel/ConnectivityGraph.h>
+#include <Core/Utils/ParallelFor.h>
+
+#include <algorithm>
+#include <iterator>
+#include <unordered_map>
+
+#include <boost/thread.hpp>
+
+using namespace degate;
+
+typedef ConnectivityGraph::index_t index_t;
+
+namespace
+{
+	enum GATE_ROLE
+	{
+		ROLE_NONE = 0,
+		ROLE_ELEMENT = 1,
+		ROLE_TAP = 2
+	};
+
+	/**
+	 * Number of items a thread takes at once.
+	 */
+	const size_t ITEMS_PER_TASK = 256;
+
+	bool matches_logic_class(std::string const& lclass, std::string const& logic_class)
+	{
+		// same semantic as is_logic_class()
+		return !logic_class.empty() && lclass.compare(0, logic_class.size(), logic_class) == 0;
+	}
+
+	bool matches_port(GatePort_shptr const& port, std::string const& name, GateTemplatePort::PORT_TYPE type)
+	{
+		if (!port->has_template_port())
+			return false;
+
+		GateTemplatePort_shptr const& tmpl_port = port->get_template_port();
+
+		if (name.empty())
+			return (tmpl_port->get_port_type() & type) != 0;
+
+		return tmpl_port->get_name() == name;
+	}
+
+	index_t find_root(std::vector<index_t>& parents, index_t i)
+	{
+		while (parents[i] != i)
+		{
+			parents[i] = parents[parents[i]];
+			i = parents[i];
+		}
+		return i;
+	}
+}
+
+LookupSubcircuit::LookupSubcircuit(LogicModel_shptr lmodel, unsigned int threads) :
+	lmodel(lmodel),
+	threads(threads)
+{
+	if (lmodel == nullptr)
+		throw InvalidPointerException("Invalid pointer passed to LookupSubcircuit().");
+
+	if (this->threads == 0)
+		this->threads = std::max(boost::thread::hardware_concurrency(), 1u);
+}
+
+LookupSubcircuit::~LookupSubcircuit()
+{
+}
+
+LookupSubcircuit::chain_collection LookupSubcircuit::search(SubcircuitPattern const& pattern) const
+{
+	ConnectivityGraph_shptr graph = lmodel->get_connectivity_graph();
+	ConnectivityGraph const& g = *graph;
+
+	const index_t gates_count = static_cast<index_t>(g.get_gates_count());
+
+	//
+	// Roles of the gates and ports of the elements, resolved once per template.
+	//
+
+	std::vector<uint8_t> roles(gates_count, ROLE_NONE);
+	std::vector<index_t> input_ports(gates_count, ConnectivityGraph::INVALID_INDEX);
+	std::vector<index_t> output_ports(gates_count, ConnectivityGraph::INVALID_INDEX);
+	std::vector<index_t> elements;
+
+	std::unordered_map<object_id_t, uint8_t> template_roles;
+	std::unordered_map<object_id_t, uint8_t> template_port_roles; // 1: input, 2: output
+
+	for (index_t gate = 0; gate < gates_count; gate++)
+	{
+		const object_id_t template_id = g.get_gate_template_id(gate);
+		if (template_id == 0)
+			continue;
+
+		auto role_iter = template_roles.find(template_id);
+		if (role_iter == template_roles.end())
+		{
+			std::string const& lclass = g.get_gate(gate)->get_gate_template()->get_logic_class();
+
+			uint8_t role = ROLE_NONE;
+			if (matches_logic_class(lclass, pattern.element_logic_class))
+				role = ROLE_ELEMENT;
+			else
+			{
+				for (auto const& tap_class : pattern.tap_logic_classes)
+					if (matches_logic_class(lclass, tap_class)) role = ROLE_TAP;
+			}
+
+			role_iter = template_roles.insert(std::make_pair(template_id, role)).first;
+		}
+
+		roles[gate] = role_iter->second;
+		if (roles[gate] != ROLE_ELEMENT)
+			continue;
+
+		for (index_t port = g.get_gate_ports_begin(gate); port < g.get_gate_ports_end(gate); port++)
+		{
+			const object_id_t port_template_id = g.get_port_template_id(port);
+
+			auto port_role_iter = template_port_roles.find(port_template_id);
+			if (port_role_iter == template_port_roles.end())
+			{
+				GatePort_shptr const& gate_port = g.get_port(port);
+
+				uint8_t port_role = 0;
+				if (matches_port(gate_port, pattern.element_input_port, GateTemplatePort::PORT_TYPE_IN))
+					port_role |= 1;
+				if (matches_port(gate_port, pattern.element_output_port, GateTemplatePort::PORT_TYPE_OUT))
+					port_role |= 2;
+
+				port_role_iter = template_port_roles.insert(std::make_pair(port_template_id, port_role)).first;
+			}
+
+			if ((port_role_iter->second & 1) && input_ports[gate] == ConnectivityGraph::INVALID_INDEX)
+				input_ports[gate] = port;
+			if ((port_role_iter->second & 2) && output_ports[gate] == ConnectivityGraph::INVALID_INDEX)
+				output_ports[gate] = port;
+		}
+
+		elements.push_back(gate);
+	}
+
+	//
+	// Predecessor of each element, in parallel.
+	//
+
+	std::vector<index_t> predecessors(gates_count, ConnectivityGraph::INVALID_INDEX);
+	std::vector<index_t> predecessor_taps(gates_count, ConnectivityGraph::INVALID_INDEX);
+
+	auto is_element_output = [&](index_t port)
+	{
+		const index_t gate = g.get_port_gate(port);
+		return roles[gate] == ROLE_ELEMENT && output_ports[gate] == port;
+	};
+
+	auto is_driver = [&](index_t port)
+	{
+		return (g.get_port_type(port) & GateTemplatePort::PORT_TYPE_OUT) != 0;
+	};
+
+	parallel_for(elements.size(), [&](size_t i)
+	{
+		const index_t element = elements[i];
+		const index_t input_port = input_ports[element];
+		if (input_port == ConnectivityGraph::INVALID_INDEX)
+			return;
+
+		const index_t net = g.get_port_net(input_port);
+		if (net == ConnectivityGraph::INVALID_INDEX)
+			return;
+
+		index_t direct = ConnectivityGraph::INVALID_INDEX, tap = ConnectivityGraph::INVALID_INDEX;
+		unsigned int direct_count = 0, tap_count = 0;
+
+		for (index_t port : g.get_net_ports(net))
+		{
+			if (port == input_port || !is_driver(port))
+				continue;
+
+			if (is_element_output(port))
+			{
+				direct = g.get_port_gate(port);
+				direct_count++;
+			}
+			else if (roles[g.get_port_gate(port)] == ROLE_TAP)
+			{
+				tap = g.get_port_gate(port);
+				tap_count++;
+			}
+		}
+
+		if (direct_count == 1)
+		{
+			predecessors[element] = direct;
+			return;
+		}
+
+		if (direct_count > 1 || tap_count != 1)
+			return;
+
+		// Through a tap: the element on the tap inputs with the lowest fan-out.
+		index_t best = ConnectivityGraph::INVALID_INDEX;
+		size_t best_fanout = 0;
+		bool ambiguous = false;
+
+		for (index_t tap_port = g.get_gate_ports_begin(tap); tap_port < g.get_gate_ports_end(tap); tap_port++)
+		{
+			const index_t tap_net = g.get_port_net(tap_port);
+			if (tap_net == ConnectivityGraph::INVALID_INDEX || is_driver(tap_port))
+				continue;
+
+			for (index_t port : g.get_net_ports(tap_net))
+			{
+				if (!is_element_output(port))
+					continue;
+
+				const size_t fanout = g.get_net_ports(tap_net).size() - 1;
+
+				if (best == ConnectivityGraph::INVALID_INDEX || fanout < best_fanout)
+				{
+					best = g.get_port_gate(port);
+					best_fanout = fanout;
+					ambiguous = false;
+				}
+				else if (fanout == best_fanout && g.get_port_gate(port) != best)
+					ambiguous = true;
+			}
+		}
+
+		if (best != ConnectivityGraph::INVALID_INDEX && !ambiguous)
+		{
+			predecessors[element] = best;
+			predecessor_taps[element] = tap;
+		}
+	}, threads, ITEMS_PER_TASK);
+
+	//
+	// Successors and connected components of the links.
+	//
+
+	std::vector<index_t> successors(gates_count, ConnectivityGraph::INVALID_INDEX);
+	std::vector<unsigned int> successors_count(gates_count, 0);
+	std::vector<index_t> parents(gates_count);
+
+	for (index_t element : elements)
+		parents[element] = element;
+
+	for (index_t element : elements)
+	{
+		const index_t predecessor = predecessors[element];
+		if (predecessor == ConnectivityGraph::INVALID_INDEX)
+			continue;
+
+		successors[predecessor] = element;
+		successors_count[predecessor]++;
+
+		const index_t a = find_root(parents, element), b = find_root(parents, predecessor);
+		if (a != b)
+			parents[std::max(a, b)] = std::min(a, b);
+	}
+
+	// Components are ordered by their lowest gate index, elements by gate index.
+	std::vector<std::vector<index_t>> components;
+	std::unordered_map<index_t, size_t> component_index;
+
+	for (index_t element : elements)
+	{
+		const index_t root = find_root(parents, element);
+		if (root == element && successors_count[element] == 0 && predecessors[element] == ConnectivityGraph::INVALID_INDEX &&
+			pattern.min_length > 1)
+			continue; // single element
+
+		auto iter = component_index.find(root);
+		if (iter == component_index.end())
+		{
+			iter = component_index.insert(std::make_pair(root, components.size())).first;
+			components.push_back(std::vector<index_t>());
+		}
+
+		components[iter->second].push_back(element);
+	}
+
+	//
+	// Chains of each component, in parallel.
+	//
+
+	std::vector<chain_collection> results(components.size());
+
+	parallel_for(components.size(), [&](size_t c)
+	{
+		std::vector<index_t> const& component = components[c];
+		std::unordered_map<index_t, bool> visited;
+		visited.reserve(component.size());
+
+		auto has_single_predecessor_link = [&](index_t element)
+		{
+			const index_t predecessor = predecessors[element];
+			return predecessor != ConnectivityGraph::INVALID_INDEX && successors_count[predecessor] == 1;
+		};
+
+		auto build_chain = [&](index_t start)
+		{
+			std::vector<index_t> chain_elements;
+
+			index_t current = start;
+			while (true)
+			{
+				visited[current] = true;
+				chain_elements.push_back(current);
+
+				if (successors_count[current] != 1 || visited[successors[current]])
+					break;
+
+				current = successors[current];
+			}
+
+			if (chain_elements.size() < pattern.min_length)
+				return;
+
+			chain result;
+			result.closed = predecessors[start] == chain_elements.back();
+
+			for (index_t element : chain_elements)
+			{
+				result.elements.push_back(g.get_gate(element));
+				result.objects.add(g.get_gate(element));
+
+				// taps between two elements of the chain
+				const index_t tap = predecessor_taps[element];
+				if (tap != ConnectivityGraph::INVALID_INDEX && (element != start || result.closed))
+				{
+					if (!result.objects.contains(g.get_gate(tap)))
+					{
+						result.taps.push_back(g.get_gate(tap));
+						result.objects.add(g.get_gate(tap));
+					}
+				}
+			}
+
+			results[c].push_back(std::move(result));
+		};
+
+		// Open chains start at an element without a single predecessor link.
+		for (index_t element : component)
+		{
+			if (!has_single_predecessor_link(element))
+				build_chain(element);
+		}
+
+		// The remaining elements are on closed loops.
+		for (index_t element : component)
+		{
+			if (!visited[element])
+				build_chain(element);
+		}
+	}, threads, ITEMS_PER_TASK);
+
+	chain_collection chains;
+
+	for (auto& result : results)
+		std::move(result.begin(), result.end(), std::back_inserter(chains));
+
+	std::sort(chains.begin(), chains.end(), [](chain const& a, chain const& b)
+	{
+		return a.elements.front()->get_object_id() < b.elements.front()->get_object_id();
+	});
+
+	return chains;
+}
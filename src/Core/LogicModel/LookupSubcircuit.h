@@ -22,162 +22,119 @@
 #ifndef __LOOKUPSUBCIRCUIT_H__
 #define __LOOKUPSUBCIRCUIT_H__
 
-#include <set>
-#include <memory>
-#include <string>
-
-#include <Core/LogicModel/LogicModelHelper.h>
+#include <Core/LogicModel/LogicModel.h>
+#include <Core/LogicModel/ObjectSet.h>
 
-#include <boost/foreach.hpp>
+#include <string>
+#include <vector>
 
 namespace degate
 {
-	class LookupSubcircuit
+	/**
+	 * Description of a register chain: elements of a logic class whose output port
+	 * feeds the input port of the next element, either directly or through one tap gate.
+	 *
+	 * The default pattern describes shift registers and LFSRs: chains of flipflops
+	 * where Q feeds D, with optional XOR/XNOR taps.
+	 */
+	struct SubcircuitPattern
 	{
-	private:
-
-		LogicModel_shptr lmodel;
-		std::list<Gate_shptr> openlist;
-
-	protected:
-
-		virtual void initialize_openlist()
-		{
-			// initialize openlist
-			for (LogicModel::gate_collection::const_iterator iter = lmodel->gates_begin();
-			     iter != lmodel->gates_end(); ++iter)
-			{
-				Gate_shptr gate = iter->second;
-				assert(gate != nullptr);
-
-				if (is_logic_class(gate, "flipflop") ||
-					is_logic_class(gate, "xor") ||
-					is_logic_class(gate, "xnor"))
-					openlist.push_back(gate);
-			}
-		}
-
-	public:
-
-
 		/**
-		 * Construct a new net.
+		 * Logic class of the chain elements (prefix match, @see is_logic_class()).
 		 */
-
-		LookupSubcircuit(LogicModel_shptr _lmodel) : lmodel(_lmodel)
-		{
-		}
+		std::string element_logic_class = "flipflop";
 
 		/**
-		 * Destroy.
+		 * Name of the template port an element is fed by. If empty, any input port.
 		 */
-		virtual ~LookupSubcircuit()
-		{
-		}
+		std::string element_input_port = "D";
 
-		virtual void search()
-		{
-			initialize_openlist();
+		/**
+		 * Name of the template port that feeds the next element. If empty, any output port.
+		 */
+		std::string element_output_port = "Q";
 
+		/**
+		 * Logic classes of gates allowed between two elements. If empty, elements
+		 * must be directly connected.
+		 */
+		std::vector<std::string> tap_logic_classes = {"xor", "xnor"};
 
-			//Gate_shptr g = openlist.front();
-			//openlist.pop_front();
+		/**
+		 * Minimal number of elements of a chain.
+		 */
+		unsigned int min_length = 3;
+	};
 
-			/*
-			trace_recursive(g);
-	  
-			BOOST_FOREACH(Gate_shptr gate, openlist) {
-	  
-	  
-			}
-			*/
-		}
+	/**
+	 * Search for register chains in the netlist of a logic model.
+	 *
+	 * The search runs on the connectivity graph of the logic model
+	 * (@see LogicModel::get_connectivity_graph()). First each element gets its
+	 * predecessor: the element whose output drives its input, either directly or
+	 * through a single tap gate. Then the elements are split into connected
+	 * components of these links and chains are built for each component. Both steps
+	 * run in parallel.
+	 *
+	 * If a tap gate has inputs from several elements (as in a Galois LFSR), the
+	 * element whose output has the lowest fan-out is the predecessor, the other
+	 * ones are feedback.
+	 */
+	class LookupSubcircuit
+	{
+	public:
 
-		void trace_recursive(Gate_shptr start_gate, std::set<Gate_shptr>& closed_list)
+		/**
+		 * A found register chain.
+		 */
+		struct chain
 		{
-			std::cout << "Gate " << start_gate->get_descriptive_identifier() << " connected with: " << std::endl;
+			/**
+			 * Elements of the chain, in signal order.
+			 */
+			std::vector<Gate_shptr> elements;
 
-			std::set<Gate_shptr> other_gates;
+			/**
+			 * Tap gates between elements of the chain.
+			 */
+			std::vector<Gate_shptr> taps;
 
-			BOOST_FOREACH(Gate_shptr g,
-			              filter_connected_gates(start_gate, GateTemplatePort::PORT_TYPE_OUT, "Q",
-				              "flipflop", GateTemplatePort::PORT_TYPE_IN, "D"))
-				if (closed_list.find(g) != closed_list.end())
-				{
-					other_gates.insert(g);
-					closed_list.insert(g);
-				}
+			/**
+			 * True if the last element feeds the first one (ring counter, LFSR).
+			 */
+			bool closed;
 
-			BOOST_FOREACH(Gate_shptr g,
-			              filter_connected_gates(start_gate, GateTemplatePort::PORT_TYPE_IN, "D",
-				              "flipflop", GateTemplatePort::PORT_TYPE_OUT, "Q"))
-				if (closed_list.find(g) != closed_list.end())
-				{
-					other_gates.insert(g);
-					closed_list.insert(g);
-				}
+			/**
+			 * Elements and taps, ready to be highlighted.
+			 */
+			ObjectSet objects;
+		};
 
-			BOOST_FOREACH(Gate_shptr g2, other_gates)
-			{
-				std::cout << "\tGate " << g2->get_descriptive_identifier() << std::endl;
+		typedef std::vector<chain> chain_collection;
 
-				trace_recursive(g2, closed_list);
-			}
-		}
+		/**
+		 * Create a search.
+		 * @param lmodel The logic model to search in.
+		 * @param threads The number of worker threads. If zero, the number of CPU cores is used.
+		 * @exception InvalidPointerException This exception is thrown, if \p lmodel is a nullptr pointer.
+		 */
+		LookupSubcircuit(LogicModel_shptr lmodel, unsigned int threads = 0);
 
+		/**
+		 * Destroy.
+		 */
+		virtual ~LookupSubcircuit();
 
 		/**
-		 * Check if there is a port on \p gate of type \p src_port_type
-		 * that shares a net with another gate of type \p logic_class.
-		 *
+		 * Search all chains that match a pattern.
+		 * @return Returns the chains, ordered by the object ID of their first gate.
 		 */
-		std::set<Gate_shptr> filter_connected_gates(Gate_shptr gate,
-		                                            GateTemplatePort::PORT_TYPE src_port_type,
-		                                            std::string const& src_port_name,
-		                                            std::string const& logic_class,
-		                                            GateTemplatePort::PORT_TYPE dst_port_type,
-		                                            std::string const& dst_port_name) const
-		{
-			std::set<Gate_shptr> connected;
-
-			for (Gate::port_iterator iter = gate->ports_begin();
-			     iter != gate->ports_end(); ++iter)
-			{
-				GatePort_shptr gport = *iter;
-				if (get_port_type(gport) == src_port_type)
-				{
-					Net_shptr net = gport->get_net();
-					if (net != nullptr)
-					{
-						BOOST_FOREACH(object_id_t oid, *net)
-						{
-							if (oid != gport->get_object_id())
-							{
-								PlacedLogicModelObject_shptr plmo = lmodel->get_object(oid);
-								assert(plmo != nullptr);
-								if (GatePort_shptr other_port = std::dynamic_pointer_cast<GatePort>(plmo))
-								{
-									Gate_shptr other_gate = other_port->get_gate();
-
-									if (is_logic_class(other_gate, logic_class) &&
-										get_port_type(other_port) == dst_port_type)
-									{
-										if ((src_port_name.empty() && dst_port_name.empty()) ||
-											(src_port_name.empty() && dst_port_name == get_template_port_name(
-												other_port)) ||
-											(dst_port_name.empty() && src_port_name == get_template_port_name(gport)) ||
-											(src_port_name == get_template_port_name(gport) &&
-												dst_port_name == get_template_port_name(other_port)))
-											connected.insert(other_gate);
-									}
-								}
-							}
-						}
-					}
-				}
-			}
-			return connected;
-		}
+		chain_collection search(SubcircuitPattern const& pattern = SubcircuitPattern()) const;
+
+	private:
+
+		LogicModel_shptr lmodel;
+		unsigned int threads;
 	};
 }
 
@@ -33,13 +33,17 @@ Module::Module(std::string const& module_name,
                std::string const& _entity_name,
                bool _is_root) :
 	entity_name(_entity_name),
-	is_root(_is_root)
+	is_root(_is_root),
+	parent(nullptr),
+	port_index_valid(true)
 {
 	set_name(module_name);
 }
 
 Module::~Module()
 {
+	for (module_collection::iterator iter = modules.begin(); iter != modules.end(); ++iter)
+		if ((*iter)->parent == this) (*iter)->parent = nullptr;
 }
 
 DeepCopyable_shptr Module::cloneShallow() const
@@ -53,14 +57,17 @@ void Module::cloneDeepInto(DeepCopyable_shptr dest, oldnew_t* oldnew) const
 	auto clone = std::dynamic_pointer_cast<Module>(dest);
 
 	// modules
-	std::transform(modules.begin(), modules.end(), std::inserter(clone->modules, clone->modules.begin()),
+	std::transform(modules.begin(), modules.end(), std::inserter(clone->modules, clone->modules.end()),
 	               [&](const module_collection::value_type& v)
 	               {
 		               return std::dynamic_pointer_cast<Module>(v->cloneDeep(oldnew));
 	               });
 
+	for (module_collection::iterator iter = clone->modules.begin(); iter != clone->modules.end(); ++iter)
+		(*iter)->parent = clone.get();
+
 	// gates
-	std::transform(gates.begin(), gates.end(), std::inserter(clone->gates, clone->gates.begin()),
+	std::transform(gates.begin(), gates.end(), std::inserter(clone->gates, clone->gates.end()),
 	               [&](const gate_collection::value_type& v)
 	               {
 		               return std::dynamic_pointer_cast<Gate>(v->cloneDeep(oldnew));
@@ -72,6 +79,9 @@ void Module::cloneDeepInto(DeepCopyable_shptr dest, oldnew_t* oldnew) const
 		clone->ports[v.first] = std::dynamic_pointer_cast<GatePort>(v.second->cloneDeep(oldnew));
 	});
 
+	// the port index is rebuilt on first use
+	clone->port_index_valid = false;
+
 	LogicModelObjectBase::cloneDeepInto(dest, oldnew);
 }
 
@@ -103,6 +113,8 @@ void Module::add_gate(Gate_shptr gate, bool detect_ports)
 		throw InvalidPointerException("Invalid pointer passed to add_gate().");
 
 	gates.insert(gate);
+	index_gate_ports(gate);
+
 	if (!is_root && detect_ports) determine_module_ports();
 }
 
@@ -115,6 +127,7 @@ bool Module::remove_gate(Gate_shptr gate)
 	gate_collection::const_iterator g_iter = gates.find(gate);
 	if (g_iter != gates.end())
 	{
+		unindex_gate_ports(gate.get());
 		gates.erase(g_iter);
 		if (!is_root) determine_module_ports();
 		return true;
@@ -139,6 +152,17 @@ void Module::add_module(Module_shptr module)
 		throw InvalidPointerException("Invalid pointer passed to add_modue().");
 
 	modules.insert(module);
+	module->parent = this;
+
+	// merge the index of the new sub-hierarchy into the index of this hierarchy
+	Module const* root = get_hierarchy_root();
+	if (root->port_index_valid && module->port_index_valid)
+		root->port_index.insert(module->port_index.begin(), module->port_index.end());
+	else
+		root->port_index_valid = false;
+
+	module->port_index.clear();
+	module->port_index_valid = false;
 }
 
 
@@ -156,6 +180,10 @@ bool Module::remove_module(Module_shptr module)
 		{
 			child->move_gates_recursive(this);
 			modules.erase(iter);
+			child->parent = nullptr;
+			child->port_index_valid = false;
+
+			if (!is_root) determine_module_ports();
 			return true;
 		}
 		else if ((*iter)->remove_module(module) == true)
@@ -173,9 +201,9 @@ void Module::move_gates_recursive(Module* dst_mod)
 	for (gate_collection::iterator g_iter = gates_begin();
 	     g_iter != gates_end(); ++g_iter)
 	{
-		std::cout << "Add gate " << (*g_iter)->get_name() << " to module " << dst_mod->get_name() << std::endl;
+		debug(TM, "Add gate %s to module %s", (*g_iter)->get_name().c_str(), dst_mod->get_name().c_str());
 
-		dst_mod->add_gate(*g_iter);
+		dst_mod->add_gate(*g_iter, false);
 	}
 
 	for (module_collection::iterator iter = modules.begin();
@@ -183,6 +211,126 @@ void Module::move_gates_recursive(Module* dst_mod)
 		(*iter)->move_gates_recursive(dst_mod);
 }
 
+bool Module::update_gate_ports(Gate_shptr gate)
+{
+	if (gate == nullptr)
+		throw InvalidPointerException("Invalid pointer passed to update_gate_ports().");
+
+	if (gates.find(gate) != gates.end())
+	{
+		index_gate_ports(gate);
+		return true;
+	}
+
+	for (module_collection::iterator iter = modules.begin();
+	     iter != modules.end(); ++iter)
+		if ((*iter)->update_gate_ports(gate) == true) return true;
+
+	return false;
+}
+
+Module const* Module::get_hierarchy_root() const
+{
+	Module const* m = this;
+	while (m->parent != nullptr) m = m->parent;
+	return m;
+}
+
+Module::port_index_collection const& Module::get_port_index() const
+{
+	Module const* root = get_hierarchy_root();
+	if (!root->port_index_valid) root->rebuild_port_index();
+	return root->port_index;
+}
+
+void Module::rebuild_port_index() const
+{
+	assert(parent == nullptr);
+
+	port_index.clear();
+	collect_gate_ports(port_index);
+	port_index_valid = true;
+}
+
+void Module::collect_gate_ports(port_index_collection& index) const
+{
+	indexed_gate_ports.clear();
+
+	for (gate_collection::const_iterator g_iter = gates.begin();
+	     g_iter != gates.end(); ++g_iter)
+	{
+		Gate_shptr gate = *g_iter;
+		std::vector<object_id_t>& ids = indexed_gate_ports[gate.get()];
+		ids.reserve(gate->get_ports_number());
+
+		for (Gate::port_const_iterator p_iter = gate->ports_begin();
+		     p_iter != gate->ports_end(); ++p_iter)
+		{
+			if (!(*p_iter)->has_valid_object_id()) continue;
+
+			ids.push_back((*p_iter)->get_object_id());
+			port_index_entry& entry = index[(*p_iter)->get_object_id()];
+			entry.gate_port = *p_iter;
+			entry.owner = const_cast<Module*>(this);
+		}
+	}
+
+	for (module_collection::const_iterator iter = modules.begin();
+	     iter != modules.end(); ++iter)
+		(*iter)->collect_gate_ports(index);
+}
+
+void Module::index_gate_ports(Gate_shptr gate)
+{
+	unindex_gate_ports(gate.get());
+
+	Module const* root = get_hierarchy_root();
+	std::vector<object_id_t>& ids = indexed_gate_ports[gate.get()];
+	ids.reserve(gate->get_ports_number());
+
+	for (Gate::port_const_iterator p_iter = gate->ports_begin();
+	     p_iter != gate->ports_end(); ++p_iter)
+	{
+		if (!(*p_iter)->has_valid_object_id()) continue;
+
+		ids.push_back((*p_iter)->get_object_id());
+
+		if (root->port_index_valid)
+		{
+			port_index_entry& entry = root->port_index[(*p_iter)->get_object_id()];
+			entry.gate_port = *p_iter;
+			entry.owner = this;
+		}
+	}
+}
+
+void Module::unindex_gate_ports(Gate const* gate)
+{
+	auto found = indexed_gate_ports.find(gate);
+	if (found == indexed_gate_ports.end()) return;
+
+	Module const* root = get_hierarchy_root();
+	if (root->port_index_valid)
+	{
+		for (std::vector<object_id_t>::const_iterator iter = found->second.begin();
+		     iter != found->second.end(); ++iter)
+		{
+			port_index_collection::iterator entry = root->port_index.find(*iter);
+			if (entry != root->port_index.end() && entry->second.owner == this)
+				root->port_index.erase(entry);
+		}
+	}
+
+	indexed_gate_ports.erase(found);
+}
+
+bool Module::contains_module(Module const* module) const
+{
+	for (Module const* m = module; m != nullptr; m = m->parent)
+		if (m == this) return true;
+	return false;
+}
+
 Module::module_collection::iterator Module::modules_begin()
 {
 	return modules.begin();
@@ -325,7 +473,6 @@ void Module::determine_module_ports()
 			assert(gate_port != nullptr);
 
 			Net_shptr net = gate_port->get_net();
-			std::cout << "Check net for object gate port " << gate_port->get_descriptive_identifier() << "?\n";
 
 			bool net_already_processed = known_net.find(net) != known_net.end();
 			if ((net != nullptr) && !net_already_processed && !net_completely_internal(net))
@@ -351,12 +498,7 @@ void Module::determine_module_ports()
 						GateTemplatePort_shptr tmpl_port = gate_port->get_template_port();
 						assert(tmpl_port != nullptr); // if a gate has no standard cell type, the gate cannot have a port
 
-						if (net_feeded_internally(net) && tmpl_port->is_inport())
-						{
-							std::cout <<
-								"  Net feeded internally, but port is inport. Will check where the net is driven.\n";
-						}
-						else
+						if (!(net_feeded_internally(net) && tmpl_port->is_inport()))
 						{
 							std::string mod_port_name = gate_port_already_named(ports, gate_port);
 							if (mod_port_name == "")
@@ -372,25 +514,14 @@ void Module::determine_module_ports()
 								while (ports.find(mod_port_name) != ports.end());
 							}
 
-							std::cout << "  New module port: " << gate_port->get_descriptive_identifier() << " == "
-								<< mod_port_name << "\n";
 							new_ports[mod_port_name] = gate_port;
 
 							is_a_port = true;
-							std::cout << "  Set net as known net: " << net->get_descriptive_identifier() << "\n";
 							known_net.insert(net);
 						}
 					}
 				}
 			}
-			else if (net == nullptr)
-			{
-				std::cout << "  Will not check net -- no net.\n";
-			}
-			else if (net_already_processed)
-			{
-				std::cout << "  Will not check net -- already processed " << net->get_descriptive_identifier() << ".\n";
-			}
 		}
 	}
 
@@ -418,10 +549,14 @@ void Module::determine_module_ports()
 
 void Module::determine_module_ports_recursive()
 {
+	// Gate ports may have been changed without notifying the module hierarchy. Rebuild
+	// the index once, so that all lookups below are constant time.
+	if (parent == nullptr) rebuild_port_index();
+
 	for (module_collection::iterator it = modules.begin(); it != modules.end(); ++it)
 	{
-		(*it)->determine_module_ports();
 		(*it)->determine_module_ports_recursive();
+		(*it)->determine_module_ports();
 	}
 }
 
@@ -439,19 +574,11 @@ GatePort_shptr Module::lookup_gate_port_recursive(object_id_t oid) const
 {
 	assert(oid != 0);
 
-	for (gate_collection::const_iterator g_iter = gates.begin();
-	     g_iter != gates.end(); ++g_iter)
-	{
-		Gate_shptr gate = *g_iter;
+	port_index_collection const& index = get_port_index();
 
-		for (Gate::port_const_iterator p_iter = gate->ports_begin();
-		     p_iter != gate->ports_end(); ++p_iter)
-			if ((*p_iter)->get_object_id() == oid) return *p_iter;
-	}
-
-	for (module_collection::const_iterator iter = modules.begin();
-	     iter != modules.end(); ++iter)
-		if (GatePort_shptr gport = (*iter)->lookup_gate_port_recursive(oid)) return gport;
+	port_index_collection::const_iterator found = index.find(oid);
+	if (found != index.end() && contains_module(found->second.owner))
+		return found->second.gate_port;
 
 	return GatePort_shptr();
 }
@@ -25,6 +25,8 @@
 
 #include <map>
 #include <memory>
+#include <unordered_map>
+#include <vector>
 
 #include <Core/LogicModel/LogicModelObjectBase.h>
 #include <Core/LogicModel/LogicModel.h>
@@ -54,6 +56,20 @@ namespace degate
 		typedef std::map<std::string, /* port name */
 		                 GatePort_shptr> port_collection;
 
+	private:
+
+		/**
+		 * Entry of the gate port index: the gate port and the module that
+		 * directly contains the gate.
+		 */
+		struct port_index_entry
+		{
+			GatePort_shptr gate_port;
+			Module* owner;
+		};
+
+		typedef std::unordered_map<object_id_t, port_index_entry> port_index_collection;
+
 	private:
 
 		module_collection modules;
@@ -63,8 +79,49 @@ namespace degate
 		std::string entity_name; // name of a type
 		bool is_root;
 
+		Module* parent; // non-owning, nullptr for the top of a hierarchy
+
+		/*
+		 * Gate port ID to owning module index for the whole hierarchy. Only the top
+		 * module of a hierarchy holds it. It is maintained on add_gate(), remove_gate(),
+		 * add_module() and update_gate_ports(), and rebuilt lazily when invalid.
+		 */
+		mutable port_index_collection port_index;
+		mutable bool port_index_valid;
+
+		// Port IDs recorded for each gate directly contained in this module.
+		mutable std::unordered_map<Gate const*, std::vector<object_id_t>> indexed_gate_ports;
+
 	private:
 
+		/**
+		 * Get the top module of the hierarchy this module belongs to.
+		 */
+		Module const* get_hierarchy_root() const;
+
+		/**
+		 * Get the port index of the hierarchy. Rebuilds the index if necessary.
+		 */
+		port_index_collection const& get_port_index() const;
+
+		/**
+		 * Rebuild the port index. Must be called on the top module of a hierarchy.
+		 */
+		void rebuild_port_index() const;
+
+		void collect_gate_ports(port_index_collection& index) const;
+
+		/**
+		 * (Re-)record the ports of a gate that is directly contained in this module.
+		 */
+		void index_gate_ports(Gate_shptr gate);
+		void unindex_gate_ports(Gate const* gate);
+
+		/**
+		 * Check if \p module is this module or one of its (sub-)children.
+		 */
+		bool contains_module(Module const* module) const;
+
 		/**
 		 * @throw InvalidPointerException This exception is thrown if the parameter is a nullptr pointer.
 		 */
@@ -175,6 +232,15 @@ namespace degate
 
 		bool remove_module(Module_shptr module);
 
+		/**
+		 * Update the gate port index after ports were added to or removed from a gate.
+		 * This method even works if the gate is not a direct child.
+		 * @return Returns true if the gate was found in the module hierarchy, else false.
+		 * @exception InvalidPointerException This exception is thrown, if \p gate is a nullptr pointer.
+		 */
+
+		bool update_gate_ports(Gate_shptr gate);
+
 
 		module_collection::iterator modules_begin();
 		module_collection::iterator modules_end();
@@ -198,7 +264,9 @@ namespace degate
 
 		/**
 		 * Determine ports of children and sub-children (not including the "local"
-		 * module, on which this function is called).
+		 * module, on which this function is called). Sub-children are handled
+		 * before their parents, so that each module sees the final ports of its
+		 * submodules.
 		 */
 		void determine_module_ports_recursive();
 
@@ -30,6 +30,8 @@
 
 using namespace degate;
 
+std::atomic<unsigned long> Net::connections_revision(0);
+
 Net::Net()
 {
 }
@@ -71,6 +73,7 @@ void Net::remove_object(object_id_t oid)
 	if (i != connections.end())
 	{
 		connections.erase(i);
+		connections_revision++;
 	}
 	else
 		throw CollectionLookupException("Can't remove object from the the net, "
@@ -88,8 +91,8 @@ void Net::add_object(object_id_t oid)
 	if (oid == 0)
 		throw InvalidObjectIDException("The object that has to be "
 			"added to the net has no object ID.");
-	else
-		connections.insert(oid);
+	else if (connections.insert(oid).second)
+		connections_revision++;
 }
 
 void Net::add_object(ConnectedLogicModelObject_shptr o)
@@ -103,6 +106,11 @@ unsigned int Net::size() const
 	return connections.size();
 }
 
+unsigned long Net::get_connections_revision()
+{
+	return connections_revision;
+}
+
 const std::string Net::get_descriptive_identifier() const
 {
 	boost::format fmter("Net %1%");
@@ -25,6 +25,7 @@
 
 #include <set>
 #include <memory>
+#include <atomic>
 
 #include <Globals.h>
 #include <Core/LogicModel/LogicModelObjectBase.h>
@@ -57,6 +58,11 @@ namespace degate
 
 		std::set<object_id_t> connections;
 
+		/**
+		 * Incremented on each change of a net (of any net).
+		 */
+		static std::atomic<unsigned long> connections_revision;
+
 	protected:
 
 		/**
@@ -135,6 +141,12 @@ namespace degate
 
 		virtual unsigned int size() const;
 
+		/**
+		 * Get a counter that changes each time an object is added to or removed from any net.
+		 * It is used to detect outdated connectivity snapshots.
+		 */
+		static unsigned long get_connections_revision();
+
 		/**
 		 * Get a human readable description for the object.
 		 */
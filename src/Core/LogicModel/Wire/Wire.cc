@@ -51,8 +51,8 @@ DeepCopyable_shptr Wire::cloneShallow() const
 
 void Wire::cloneDeepInto(DeepCopyable_shptr dest, oldnew_t* oldnew) const
 {
-	auto clone = std::dynamic_pointer_cast<Wire>(dest);
 	Line::cloneDeepInto(dest, oldnew);
+	ConnectedLogicModelObject::cloneDeepInto(dest, oldnew);
 	RemoteObject::cloneDeepInto(dest, oldnew);
 }
 
@@ -0,0 +1,192 @@
+/* -*-c++-*-
+
+ This file is part of the IC reverse engineering tool degate.
+
+ Copyright 2008, 2009, 2010 by Martin Schobert
+
+ Degate is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ any later version.
+
+ Degate is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "Core/Matching/CorrelationKernel.h"
+
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define CORRELATION_KERNEL_X86
+#include <immintrin.h>
+#ifdef COMP_MSC
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(CORRELATION_KERNEL_X86) && defined(COMP_GCC)
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSE2
+#define TARGET_AVX2
+#endif
+
+using namespace degate;
+
+static double correlate_row_scalar(const gs_byte_pixel_t* row, const float* tmpl_row, unsigned int n)
+{
+	double sum = 0;
+
+	for (unsigned int i = 0; i < n; i++)
+	{
+		double f_xy = row[i];
+		double t_xy = tmpl_row[i];
+		sum += f_xy * t_xy;
+	}
+
+	return sum;
+}
+
+#ifdef CORRELATION_KERNEL_X86
+
+TARGET_SSE2 static double correlate_row_sse(const gs_byte_pixel_t* row, const float* tmpl_row, unsigned int n)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128 acc = _mm_setzero_ps();
+	unsigned int i = 0;
+
+	for (; i + 16 <= n; i += 16)
+	{
+		// 16 pixels, widened to 4 x 4 floats
+		const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+		const __m128i lo = _mm_unpacklo_epi8(pixels, zero);
+		const __m128i hi = _mm_unpackhi_epi8(pixels, zero);
+
+		acc = _mm_add_ps(acc, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)),
+		                                 _mm_loadu_ps(tmpl_row + i)));
+		acc = _mm_add_ps(acc, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)),
+		                                 _mm_loadu_ps(tmpl_row + i + 4)));
+		acc = _mm_add_ps(acc, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)),
+		                                 _mm_loadu_ps(tmpl_row + i + 8)));
+		acc = _mm_add_ps(acc, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)),
+		                                 _mm_loadu_ps(tmpl_row + i + 12)));
+	}
+
+	float lanes[4];
+	_mm_storeu_ps(lanes, acc);
+
+	double sum = static_cast<double>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+	return sum + correlate_row_scalar(row + i, tmpl_row + i, n - i);
+}
+
+TARGET_AVX2 static double correlate_row_avx2(const gs_byte_pixel_t* row, const float* tmpl_row, unsigned int n)
+{
+	__m256 acc0 = _mm256_setzero_ps();
+	__m256 acc1 = _mm256_setzero_ps();
+	unsigned int i = 0;
+
+	for (; i + 16 <= n; i += 16)
+	{
+		// 2 x 8 pixels, widened to floats
+		const __m256 f0 = _mm256_cvtepi32_ps(
+			_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(row + i))));
+		const __m256 f1 = _mm256_cvtepi32_ps(
+			_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(row + i + 8))));
+
+		acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(f0, _mm256_loadu_ps(tmpl_row + i)));
+		acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(f1, _mm256_loadu_ps(tmpl_row + i + 8)));
+	}
+
+	float lanes[8];
+	_mm256_storeu_ps(lanes, _mm256_add_ps(acc0, acc1));
+
+	double sum = 0;
+	for (float lane : lanes)
+		sum += lane;
+
+	return sum + correlate_row_scalar(row + i, tmpl_row + i, n - i);
+}
+
+/**
+ * Check if the processor and the operating system support AVX2.
+ */
+static bool is_avx2_available()
+{
+#if defined(COMP_GCC)
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#elif defined(COMP_MSC)
+	int info[4];
+
+	__cpuid(info, 1);
+	const bool osxsave = (info[2] & (1 << 27)) != 0;
+	const bool avx = (info[2] & (1 << 28)) != 0;
+
+	// the operating system must save the ymm registers
+	if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+		return false;
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return false;
+#endif
+}
+
+#endif
+
+bool degate::is_correlation_kernel_supported(CORRELATION_KERNEL kernel)
+{
+	switch (kernel)
+	{
+	case CORRELATION_KERNEL_SCALAR:
+		return true;
+#ifdef CORRELATION_KERNEL_X86
+	case CORRELATION_KERNEL_SSE:
+		return true;
+	case CORRELATION_KERNEL_AVX2:
+	{
+		static const bool avx2 = is_avx2_available();
+		return avx2;
+	}
+#endif
+	default:
+		return false;
+	}
+}
+
+CORRELATION_KERNEL degate::get_best_correlation_kernel()
+{
+	if (is_correlation_kernel_supported(CORRELATION_KERNEL_AVX2))
+		return CORRELATION_KERNEL_AVX2;
+	else if (is_correlation_kernel_supported(CORRELATION_KERNEL_SSE))
+		return CORRELATION_KERNEL_SSE;
+	else
+		return CORRELATION_KERNEL_SCALAR;
+}
+
+row_correlation_function degate::get_row_correlation_function(CORRELATION_KERNEL kernel)
+{
+	if (!is_correlation_kernel_supported(kernel))
+		throw std::invalid_argument("The correlation kernel is not supported.");
+
+	switch (kernel)
+	{
+#ifdef CORRELATION_KERNEL_X86
+	case CORRELATION_KERNEL_SSE:
+		return correlate_row_sse;
+	case CORRELATION_KERNEL_AVX2:
+		return correlate_row_avx2;
+#endif
+	default:
+		return correlate_row_scalar;
+	}
+}
@@ -0,0 +1,69 @@
+/* -*-c++-*-
+
+ This file is part of the IC reverse engineering tool degate.
+
+ Copyright 2008, 2009, 2010 by Martin Schobert
+
+ Degate is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ any later version.
+
+ Degate is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __CORRELATIONKERNEL_H__
+#define __CORRELATIONKERNEL_H__
+
+#include "Prerequisites.h"
+#include "Core/Image/PixelPolicies.h"
+
+namespace degate
+{
+	/**
+	 * Implementations of the inner loop of the cross correlation.
+	 */
+	enum CORRELATION_KERNEL
+	{
+		/** Plain C++, accumulates in double precision. */
+		CORRELATION_KERNEL_SCALAR = 0,
+
+		/** SSE2, accumulates four floats per instruction. */
+		CORRELATION_KERNEL_SSE = 1,
+
+		/** AVX2, accumulates eight floats per instruction. */
+		CORRELATION_KERNEL_AVX2 = 2
+	};
+
+	/**
+	 * Check if a correlation kernel can be used with this build and this processor.
+	 */
+	bool is_correlation_kernel_supported(CORRELATION_KERNEL kernel);
+
+	/**
+	 * Get the fastest correlation kernel that is supported.
+	 */
+	CORRELATION_KERNEL get_best_correlation_kernel();
+
+	/**
+	 * Function type of a row correlation: the sum of \p row[i] * \p tmpl_row[i] for i < \p n.
+	 */
+	typedef double (*row_correlation_function)(const gs_byte_pixel_t* row, const float* tmpl_row, unsigned int n);
+
+	/**
+	 * Get the row correlation of a kernel.
+	 * The SIMD kernels accumulate a row in single precision, so their results
+	 * differ slightly from the scalar kernel.
+	 * @exception std::invalid_argument Throws this exception, if the kernel is not supported.
+	 */
+	row_correlation_function get_row_correlation_function(CORRELATION_KERNEL kernel);
+}
+
+#endif
@@ -68,8 +68,27 @@ std::string ExternalMatching::get_command() const
 	return cmd;
 }
 
+void ExternalMatching::set_worker(ExternalMatchingWorker_shptr worker)
+{
+	this->worker = worker;
+}
+
+ExternalMatchingWorker_shptr ExternalMatching::get_worker() const
+{
+	return worker;
+}
+
 void ExternalMatching::run()
 {
+	if (worker != nullptr)
+	{
+		BOOST_FOREACH(PlacedLogicModelObject_shptr plo, worker->match(img, bounding_box))
+		{
+			lmodel->add_object(layer, plo);
+		}
+		return;
+	}
+
 	// create a temp dir
 	std::string dir = create_temp_directory();
 	assert(is_directory(dir));
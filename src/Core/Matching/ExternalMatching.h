@@ -25,6 +25,7 @@
 #include <Core/Image/Image.h>
 #include <Core/Project/Project.h>
 #include <Core/Matching/TemplateMatching.h>
+#include <Core/Matching/ExternalMatchingWorker.h>
 
 namespace degate
 {
@@ -52,6 +53,10 @@ namespace degate
 	 * The direction is either "up" or "down"
 	 *
 	 * Strings are case sensitive.
+	 *
+	 * Alternatively, a persistent worker process can be set with set_worker().
+	 * The worker is then used instead of the command and is kept running
+	 * between matching runs. See ExternalMatchingWorker.
 	 */
 	class ExternalMatching : public Matching
 	{
@@ -65,6 +70,8 @@ namespace degate
 		std::string cmd;
 		int exit_code;
 
+		ExternalMatchingWorker_shptr worker;
+
 	private:
 
 		std::list<PlacedLogicModelObject_shptr> parse_file(std::string const& filename) const;
@@ -96,6 +103,13 @@ namespace degate
 
 		void set_command(std::string const& cmd);
 		std::string get_command() const;
+
+		/**
+		 * Use a persistent worker process instead of running the command.
+		 * Pass a nullptr pointer to switch back to the command.
+		 */
+		void set_worker(ExternalMatchingWorker_shptr worker);
+		ExternalMatchingWorker_shptr get_worker() const;
 	};
 
 	typedef std::shared_ptr<ExternalMatching> ExternalMatching_shptr;
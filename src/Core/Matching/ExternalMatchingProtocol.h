@@ -0,0 +1,146 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __EXTERNALMATCHINGPROTOCOL_H__
+#define __EXTERNALMATCHINGPROTOCOL_H__
+
+#include <cstdint>
+
+/**
+ * Binary protocol between degate and a persistent external matching worker.
+ *
+ * The worker is started once and reads requests from its standard input. It
+ * writes responses to its standard output. Every message starts with a
+ * message_header, followed by payload_size bytes of payload. All values are in
+ * native byte order, because both processes run on the same machine.
+ *
+ * Message flow:
+ *
+ * - MSG_HELLO: degate sends a hello_payload and the worker answers with a MSG_HELLO
+ *   that holds the protocol version the worker speaks.
+ * - MSG_MATCH: degate sends a match_request followed by tile_count tile_descriptor
+ *   entries. The pixel data of the tiles is in the named shared memory segment
+ *   given by the request. The worker answers with a MSG_RESULTS message: a
+ *   results_header followed by object_count result_object entries. On failure the
+ *   worker can answer with a MSG_ERROR message, whose payload is an error text.
+ * - MSG_SHUTDOWN: the worker terminates. There is no answer.
+ *
+ * The shared memory segment is created by degate. It is opened by name
+ * (shm_open() on POSIX systems) and is reused by later requests as long as the
+ * name does not change.
+ */
+
+#define EXTERNAL_MATCHING_PROTOCOL_MAGIC 0x4d474544u // "DEGM"
+#define EXTERNAL_MATCHING_PROTOCOL_VERSION 1u
+
+#define EXTERNAL_MATCHING_SHM_NAME_SIZE 64
+
+namespace degate
+{
+	namespace external_matching
+	{
+		enum message_type : uint32_t
+		{
+			MSG_HELLO = 1,
+			MSG_MATCH = 2,
+			MSG_RESULTS = 3,
+			MSG_ERROR = 4,
+			MSG_SHUTDOWN = 5
+		};
+
+		/**
+		 * Pixel formats of tiles in shared memory.
+		 */
+		enum pixel_format : uint32_t
+		{
+			PIXEL_FORMAT_RGBA = 1 // 4 bytes per pixel in the order red, green, blue, alpha
+		};
+
+		enum result_object_type : uint32_t
+		{
+			RESULT_WIRE = 1,
+			RESULT_VIA = 2
+		};
+
+		enum via_direction : uint32_t
+		{
+			VIA_UP = 0,
+			VIA_DOWN = 1
+		};
+
+		struct message_header
+		{
+			uint32_t magic;
+			uint32_t type;
+			uint32_t request_id;
+			uint32_t payload_size;
+		};
+
+		struct hello_payload
+		{
+			uint32_t version;
+			uint32_t reserved;
+		};
+
+		struct match_request
+		{
+			char shm_name[EXTERNAL_MATCHING_SHM_NAME_SIZE]; // zero terminated
+			uint64_t shm_size;
+			uint32_t tile_count;
+			uint32_t reserved;
+		};
+
+		struct tile_descriptor
+		{
+			uint64_t offset; // offset of the first pixel in the shared memory segment
+			int32_t x, y; // position of the upper left pixel in the image
+			uint32_t width, height;
+			uint32_t stride; // bytes per row
+			uint32_t format; // a pixel_format
+		};
+
+		struct results_header
+		{
+			uint32_t object_count;
+			uint32_t reserved;
+		};
+
+		/**
+		 * A matched object in image coordinates. Wires use all coordinates,
+		 * vias only x1 and y1.
+		 */
+		struct result_object
+		{
+			uint32_t type; // a result_object_type
+			int32_t x1, y1, x2, y2;
+			uint32_t diameter;
+			uint32_t direction; // a via_direction
+			uint32_t tile; // index of the tile in the request
+		};
+
+		static_assert(sizeof(message_header) == 16, "unexpected padding in message_header");
+		static_assert(sizeof(match_request) == 80, "unexpected padding in match_request");
+		static_assert(sizeof(tile_descriptor) == 32, "unexpected padding in tile_descriptor");
+		static_assert(sizeof(result_object) == 32, "unexpected padding in result_object");
+	}
+}
+
+#endif
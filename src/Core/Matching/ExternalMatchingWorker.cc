@@ -0,0 +1,364 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <Core/Matching/ExternalMatchingWorker.h>
+#include <Core/LogicModel/Via/Via.h>
+#include <Core/LogicModel/Wire/Wire.h>
+#include <Core/Utils/DegateExceptions.h>
+#include <Globals.h>
+#include <Prerequisites.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#include <boost/format.hpp>
+#include <boost/process.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#ifdef SYS_UNIX
+#include <csignal>
+#endif
+
+using namespace degate;
+using namespace degate::external_matching;
+
+namespace bp = boost::process;
+namespace bip = boost::interprocess;
+
+struct ExternalMatchingWorker::worker_process
+{
+	bp::opstream input; // standard input of the worker
+	bp::ipstream output; // standard output of the worker
+	bp::child child;
+};
+
+struct ExternalMatchingWorker::shared_segment
+{
+	std::string name;
+	bip::shared_memory_object shm;
+	bip::mapped_region region;
+
+	shared_segment(std::string const& name, size_t size) :
+		name(name),
+		shm(bip::create_only, name.c_str(), bip::read_write)
+	{
+		shm.truncate(static_cast<bip::offset_t>(size));
+		region = bip::mapped_region(shm, bip::read_write);
+	}
+
+	~shared_segment()
+	{
+		bip::shared_memory_object::remove(name.c_str());
+	}
+
+	size_t get_size() const
+	{
+		return region.get_size();
+	}
+
+	char* get_data() const
+	{
+		return static_cast<char*>(region.get_address());
+	}
+};
+
+
+ExternalMatchingWorker::ExternalMatchingWorker(std::string const& cmd) :
+	cmd(cmd),
+	segment_counter(0),
+	request_id(0),
+	request_count(0)
+{
+}
+
+ExternalMatchingWorker::~ExternalMatchingWorker()
+{
+	stop();
+}
+
+std::string ExternalMatchingWorker::get_command() const
+{
+	return cmd;
+}
+
+unsigned int ExternalMatchingWorker::get_request_count() const
+{
+	return request_count;
+}
+
+bool ExternalMatchingWorker::is_running() const
+{
+	return process != nullptr && process->child.running();
+}
+
+void ExternalMatchingWorker::start()
+{
+	if (is_running()) return;
+
+	stop();
+
+#ifdef SYS_UNIX
+	// A worker that dies must not kill degate while a request is written to it.
+	signal(SIGPIPE, SIG_IGN);
+#endif
+
+	debug(TM, "start external matching worker: %s", cmd.c_str());
+
+	process.reset(new worker_process());
+	try
+	{
+		process->child = bp::child(cmd, bp::std_in < process->input, bp::std_out > process->output);
+	}
+	catch (bp::process_error const& ex)
+	{
+		process.reset();
+		throw DegateRuntimeException(std::string("Can't start the external matching worker: ") + ex.what());
+	}
+
+	try
+	{
+		hello_payload hello = {EXTERNAL_MATCHING_PROTOCOL_VERSION, 0};
+		send_message(MSG_HELLO, std::vector<char>(reinterpret_cast<char*>(&hello),
+		                                          reinterpret_cast<char*>(&hello) + sizeof(hello)));
+
+		std::vector<char> payload;
+		message_header header = receive_message(payload);
+		if (header.type != MSG_HELLO || payload.size() < sizeof(hello_payload))
+			throw DegateRuntimeException("The external matching worker did not answer the handshake.");
+
+		memcpy(&hello, payload.data(), sizeof(hello));
+		if (hello.version != EXTERNAL_MATCHING_PROTOCOL_VERSION)
+			throw DegateRuntimeException("The external matching worker speaks an unsupported protocol version.");
+	}
+	catch (...)
+	{
+		stop();
+		throw;
+	}
+}
+
+void ExternalMatchingWorker::stop()
+{
+	if (process == nullptr) return;
+
+	if (process->child.running())
+	{
+		try
+		{
+			send_message(MSG_SHUTDOWN, std::vector<char>());
+		}
+		catch (DegateRuntimeException const&)
+		{
+			// the worker is gone already
+		}
+
+		process->input.pipe().close();
+
+		if (!process->child.wait_for(std::chrono::seconds(5)))
+		{
+			debug(TM, "external matching worker does not terminate, kill it");
+			process->child.terminate();
+		}
+	}
+
+	process.reset();
+}
+
+void ExternalMatchingWorker::send_message(message_type type, std::vector<char> const& payload)
+{
+	assert(process != nullptr);
+
+	message_header header = {EXTERNAL_MATCHING_PROTOCOL_MAGIC, type, request_id,
+	                         static_cast<uint32_t>(payload.size())};
+
+	process->input.write(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!payload.empty()) process->input.write(payload.data(), payload.size());
+	process->input.flush();
+
+	if (!process->input.good())
+		throw DegateRuntimeException("Can't send a request to the external matching worker.");
+}
+
+message_header ExternalMatchingWorker::receive_message(std::vector<char>& payload)
+{
+	assert(process != nullptr);
+
+	message_header header;
+	process->output.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+	if (process->output.gcount() != sizeof(header))
+		throw DegateRuntimeException("The external matching worker terminated unexpectedly.");
+
+	if (header.magic != EXTERNAL_MATCHING_PROTOCOL_MAGIC)
+		throw DegateRuntimeException("Invalid message from the external matching worker.");
+
+	payload.resize(header.payload_size);
+	if (header.payload_size > 0)
+	{
+		process->output.read(payload.data(), header.payload_size);
+		if (static_cast<uint32_t>(process->output.gcount()) != header.payload_size)
+			throw DegateRuntimeException("The external matching worker terminated unexpectedly.");
+	}
+
+	if (header.type == MSG_ERROR)
+		throw DegateRuntimeException("The external matching worker failed: " +
+		                             std::string(payload.begin(), payload.end()));
+
+	return header;
+}
+
+void ExternalMatchingWorker::reserve_shared_memory(size_t size)
+{
+	if (segment != nullptr && segment->get_size() >= size) return;
+
+	// The segment is replaced with a new name, so that a worker can't keep using a stale mapping.
+	segment.reset();
+
+	boost::format f("degate_matching_%1%_%2%");
+	f % boost::this_process::get_id() % segment_counter++;
+
+	try
+	{
+		segment.reset(new shared_segment(f.str(), size));
+	}
+	catch (bip::interprocess_exception const& ex)
+	{
+		throw DegateRuntimeException(std::string("Can't create shared memory for external matching: ") + ex.what());
+	}
+}
+
+void ExternalMatchingWorker::process_batch(BackgroundImage_shptr img,
+                                           std::vector<tile>::const_iterator begin,
+                                           std::vector<tile>::const_iterator end,
+                                           std::list<PlacedLogicModelObject_shptr>& objects)
+{
+	const unsigned int tile_count = static_cast<unsigned int>(std::distance(begin, end));
+
+	size_t total_size = 0;
+	for (auto iter = begin; iter != end; ++iter)
+		total_size += static_cast<size_t>(iter->width) * iter->height * sizeof(rgba_pixel_t);
+
+	reserve_shared_memory(total_size);
+
+	// payload: the request followed by the tile descriptors
+	std::vector<char> payload(sizeof(match_request) + tile_count * sizeof(tile_descriptor), 0);
+
+	match_request* request = reinterpret_cast<match_request*>(payload.data());
+	strncpy(request->shm_name, segment->name.c_str(), EXTERNAL_MATCHING_SHM_NAME_SIZE - 1);
+	request->shm_size = segment->get_size();
+	request->tile_count = tile_count;
+
+	tile_descriptor* descriptors = reinterpret_cast<tile_descriptor*>(payload.data() + sizeof(match_request));
+
+	size_t offset = 0;
+	for (auto iter = begin; iter != end; ++iter, ++descriptors)
+	{
+		const size_t stride = iter->width * sizeof(rgba_pixel_t);
+
+		for (unsigned int y = 0; y < iter->height; y++)
+			img->raw_copy_row(segment->get_data() + offset + y * stride, iter->x, iter->y + y, iter->width);
+
+		descriptors->offset = offset;
+		descriptors->x = static_cast<int32_t>(iter->x);
+		descriptors->y = static_cast<int32_t>(iter->y);
+		descriptors->width = iter->width;
+		descriptors->height = iter->height;
+		descriptors->stride = static_cast<uint32_t>(stride);
+		descriptors->format = PIXEL_FORMAT_RGBA;
+
+		offset += stride * iter->height;
+	}
+
+	request_id++;
+	send_message(MSG_MATCH, payload);
+	request_count++;
+
+	message_header header = receive_message(payload);
+	if (header.type != MSG_RESULTS || header.request_id != request_id || payload.size() < sizeof(results_header))
+		throw DegateRuntimeException("Unexpected answer from the external matching worker.");
+
+	results_header results;
+	memcpy(&results, payload.data(), sizeof(results));
+
+	if (payload.size() < sizeof(results_header) + static_cast<size_t>(results.object_count) * sizeof(result_object))
+		throw DegateRuntimeException("Truncated answer from the external matching worker.");
+
+	const result_object* result = reinterpret_cast<const result_object*>(payload.data() + sizeof(results_header));
+	for (uint32_t i = 0; i < results.object_count; i++, result++)
+	{
+		if (result->type == RESULT_WIRE)
+			objects.push_back(std::make_shared<Wire>(result->x1, result->y1, result->x2, result->y2, result->diameter));
+		else if (result->type == RESULT_VIA)
+			objects.push_back(std::make_shared<Via>(result->x1, result->y1, result->diameter,
+			                                        result->direction == VIA_UP
+				                                        ? Via::DIRECTION_UP
+				                                        : Via::DIRECTION_DOWN));
+		else
+			debug(TM, "ignoring unknown object type %d from external matching worker", result->type);
+	}
+}
+
+std::list<PlacedLogicModelObject_shptr> ExternalMatchingWorker::match(BackgroundImage_shptr img,
+                                                                      BoundingBox const& bounding_box)
+{
+	if (img == nullptr)
+		throw InvalidPointerException("Invalid pointer for parameter img.");
+
+	const unsigned int min_x = static_cast<unsigned int>(std::max(0.0f, std::floor(bounding_box.get_min_x())));
+	const unsigned int min_y = static_cast<unsigned int>(std::max(0.0f, std::floor(bounding_box.get_min_y())));
+	const unsigned int max_x = std::min(img->get_width(),
+	                                    static_cast<unsigned int>(std::max(0.0f, bounding_box.get_min_x() +
+		                                    bounding_box.get_width())));
+	const unsigned int max_y = std::min(img->get_height(),
+	                                    static_cast<unsigned int>(std::max(0.0f, bounding_box.get_min_y() +
+		                                    bounding_box.get_height())));
+
+	std::vector<tile> tiles;
+	for (unsigned int y = min_y; y < max_y; y += EXTERNAL_MATCHING_TILE_SIZE)
+		for (unsigned int x = min_x; x < max_x; x += EXTERNAL_MATCHING_TILE_SIZE)
+			tiles.push_back({x, y,
+			                 std::min(max_x - x, (unsigned int) EXTERNAL_MATCHING_TILE_SIZE),
+			                 std::min(max_y - y, (unsigned int) EXTERNAL_MATCHING_TILE_SIZE)});
+
+	std::list<PlacedLogicModelObject_shptr> objects;
+	if (tiles.empty()) return objects;
+
+	start();
+
+	try
+	{
+		for (size_t i = 0; i < tiles.size(); i += EXTERNAL_MATCHING_TILES_PER_REQUEST)
+		{
+			size_t n = std::min(tiles.size() - i, (size_t) EXTERNAL_MATCHING_TILES_PER_REQUEST);
+			process_batch(img, tiles.begin() + i, tiles.begin() + i + n, objects);
+		}
+	}
+	catch (...)
+	{
+		stop();
+		throw;
+	}
+
+	return objects;
+}
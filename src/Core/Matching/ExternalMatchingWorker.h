@@ -0,0 +1,146 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __EXTERNALMATCHINGWORKER_H__
+#define __EXTERNALMATCHINGWORKER_H__
+
+#include <Core/Image/Image.h>
+#include <Core/LogicModel/PlacedLogicModelObject.h>
+#include <Core/Matching/ExternalMatchingProtocol.h>
+#include <Core/Primitive/BoundingBox.h>
+
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Maximum edge length of an image tile that is handed over to a worker.
+ */
+#define EXTERNAL_MATCHING_TILE_SIZE 1024
+
+/**
+ * Maximum number of tiles per request.
+ */
+#define EXTERNAL_MATCHING_TILES_PER_REQUEST 16
+
+namespace degate
+{
+	/**
+	 * A long-lived external matching process.
+	 *
+	 * The worker is started once and then serves many matching requests. Image
+	 * regions are split into tiles, that are copied into a shared memory segment,
+	 * and several tiles are sent per request. The protocol is described in
+	 * ExternalMatchingProtocol.h.
+	 *
+	 * This class is not thread safe.
+	 */
+	class ExternalMatchingWorker
+	{
+	public:
+
+		/**
+		 * Create a worker handle. The process is not started yet.
+		 * @param cmd The command line of the worker.
+		 */
+		ExternalMatchingWorker(std::string const& cmd);
+
+		/**
+		 * Stop the worker, if it is running, and release the shared memory.
+		 */
+		~ExternalMatchingWorker();
+
+		/**
+		 * Start the worker process and check the protocol version.
+		 * Does nothing if the worker is already running.
+		 * @exception DegateRuntimeException This exception is thrown if the process
+		 *   cannot be started or if it does not speak the protocol.
+		 */
+		void start();
+
+		/**
+		 * Ask the worker to terminate and wait for it.
+		 */
+		void stop();
+
+		/**
+		 * Check if the worker process is running.
+		 */
+		bool is_running() const;
+
+		/**
+		 * Run the worker on a region of an image. The worker is started if necessary.
+		 * @return Returns the matched objects in image coordinates.
+		 * @exception InvalidPointerException This exception is thrown if \p img is a nullptr pointer.
+		 * @exception DegateRuntimeException This exception is thrown if the worker fails.
+		 *   The worker is stopped in that case.
+		 */
+		std::list<PlacedLogicModelObject_shptr> match(BackgroundImage_shptr img, BoundingBox const& bounding_box);
+
+		/**
+		 * Get the command line of the worker.
+		 */
+		std::string get_command() const;
+
+		/**
+		 * Get the number of match requests sent to the worker so far.
+		 */
+		unsigned int get_request_count() const;
+
+	private:
+
+		struct tile
+		{
+			unsigned int x, y, width, height;
+		};
+
+		struct worker_process;
+		struct shared_segment;
+
+		void send_message(external_matching::message_type type, std::vector<char> const& payload);
+		external_matching::message_header receive_message(std::vector<char>& payload);
+
+		/**
+		 * Make sure the shared memory segment has at least \p size bytes.
+		 */
+		void reserve_shared_memory(size_t size);
+
+		void process_batch(BackgroundImage_shptr img,
+		                   std::vector<tile>::const_iterator begin,
+		                   std::vector<tile>::const_iterator end,
+		                   std::list<PlacedLogicModelObject_shptr>& objects);
+
+	private:
+
+		std::string cmd;
+		std::unique_ptr<worker_process> process;
+		std::unique_ptr<shared_segment> segment;
+
+		unsigned int segment_counter;
+		unsigned int request_id;
+		unsigned int request_count;
+	};
+
+	typedef std::shared_ptr<ExternalMatchingWorker> ExternalMatchingWorker_shptr;
+}
+
+#endif
@@ -0,0 +1,170 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <Core/Matching/PreparedTemplateCache.h>
+#include <Core/Image/Manipulation/ImageManipulation.h>
+
+#include <cstdint>
+
+using namespace degate;
+
+PreparedTemplateImage::PreparedTemplateImage(unsigned int width, unsigned int height) :
+	width(width), height(height), sum_over_zero_mean(0)
+{
+	const size_t padding = PREPARED_TEMPLATE_ALIGNMENT / sizeof(float);
+
+	storage.resize(static_cast<size_t>(width) * height + padding, 0);
+
+	// Align the start of the pixels.
+	uintptr_t address = reinterpret_cast<uintptr_t>(storage.data());
+	uintptr_t misalignment = address % PREPARED_TEMPLATE_ALIGNMENT;
+
+	data = storage.data() + (misalignment == 0 ? 0 : (PREPARED_TEMPLATE_ALIGNMENT - misalignment) / sizeof(float));
+}
+
+
+PreparedTemplateImage_shptr PreparedTemplateCache::create_prepared_image(MemoryImage_GS_BYTE_shptr img)
+{
+	const unsigned int w = img->get_width(), h = img->get_height();
+
+	auto prepared = std::make_shared<PreparedTemplateImage>(w, h);
+
+	double sum = 0;
+	for (unsigned int y = 0; y < h; y++)
+		for (unsigned int x = 0; x < w; x++)
+			sum += img->get_pixel(x, y);
+
+	const double mean = sum / (static_cast<double>(w) * h);
+
+	// subtract mean
+	for (unsigned int y = 0; y < h; y++)
+	{
+		float* row = prepared->data + static_cast<size_t>(y) * w;
+
+		for (unsigned int x = 0; x < w; x++)
+		{
+			row[x] = static_cast<float>(img->get_pixel(x, y) - mean);
+			prepared->sum_over_zero_mean += static_cast<double>(row[x]) * row[x];
+		}
+	}
+
+	return prepared;
+}
+
+PreparedTemplate PreparedTemplateCache::get(GateTemplate_shptr tmpl,
+                                            Layer::LAYER_TYPE layer_type,
+                                            Gate::ORIENTATION orientation,
+                                            unsigned int scaling_factor)
+{
+	assert(tmpl != nullptr);
+	assert(scaling_factor > 0);
+
+	const key_type key(tmpl->get_object_id(), tmpl->get_image_revision(layer_type),
+	                   layer_type, orientation, scaling_factor);
+
+	boost::mutex::scoped_lock lock(mutex);
+
+	cache_type::const_iterator found = cache.find(key);
+	if (found != cache.end())
+		return found->second;
+
+	// get image from template
+	GateTemplateImage_shptr tmpl_img_orig = tmpl->get_image(layer_type);
+
+	const unsigned int
+		w = tmpl_img_orig->get_width(),
+		h = tmpl_img_orig->get_height();
+
+	// get image according to orientation
+	GateTemplateImage_shptr tmpl_img = std::make_shared<GateTemplateImage>(w, h);
+	copy_image(tmpl_img, tmpl_img_orig);
+
+	switch (orientation)
+	{
+	case Gate::ORIENTATION_FLIPPED_UP_DOWN:
+		flip_up_down(tmpl_img);
+		break;
+	case Gate::ORIENTATION_FLIPPED_LEFT_RIGHT:
+		flip_left_right(tmpl_img);
+		break;
+	case Gate::ORIENTATION_FLIPPED_BOTH:
+		flip_both(tmpl_img);
+		break;
+	case Gate::ORIENTATION_NORMAL:
+		break;
+	case Gate::ORIENTATION_UNDEFINED:
+		assert(1 == 0);
+	}
+
+	// greyscale version and scaled greyscale version
+	const unsigned int
+		scaled_w = std::floor(static_cast<double>(w) / scaling_factor),
+		scaled_h = std::floor(static_cast<double>(h) / scaling_factor);
+
+	MemoryImage_GS_BYTE_shptr normal = std::make_shared<MemoryImage_GS_BYTE>(w, h);
+	copy_image(normal, tmpl_img);
+
+	MemoryImage_GS_BYTE_shptr scaled = std::make_shared<MemoryImage_GS_BYTE>(scaled_w, scaled_h);
+	scale_down_by_power_of_2(scaled, tmpl_img);
+
+	PreparedTemplate prepared;
+	prepared.normal = create_prepared_image(normal);
+	prepared.scaled = create_prepared_image(scaled);
+
+	// An older revision of the same image is no longer needed.
+	for (cache_type::iterator iter = cache.begin(); iter != cache.end();)
+	{
+		if (std::get<0>(iter->first) == std::get<0>(key) && std::get<2>(iter->first) == layer_type &&
+			std::get<1>(iter->first) != std::get<1>(key))
+			iter = cache.erase(iter);
+		else
+			++iter;
+	}
+
+	cache[key] = prepared;
+
+	return prepared;
+}
+
+void PreparedTemplateCache::invalidate(object_id_t template_id)
+{
+	boost::mutex::scoped_lock lock(mutex);
+
+	for (cache_type::iterator iter = cache.begin(); iter != cache.end();)
+	{
+		if (std::get<0>(iter->first) == template_id)
+			iter = cache.erase(iter);
+		else
+			++iter;
+	}
+}
+
+void PreparedTemplateCache::clear()
+{
+	boost::mutex::scoped_lock lock(mutex);
+	cache.clear();
+}
+
+size_t PreparedTemplateCache::size() const
+{
+	boost::mutex::scoped_lock lock(mutex);
+	return cache.size();
+}
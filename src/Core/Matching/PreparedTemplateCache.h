@@ -0,0 +1,177 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __PREPAREDTEMPLATECACHE_H__
+#define __PREPAREDTEMPLATECACHE_H__
+
+#include <Core/Primitive/SingletonBase.h>
+#include <Core/LogicModel/Gate/Gate.h>
+#include <Core/LogicModel/Gate/GateTemplate.h>
+
+#include <map>
+#include <memory>
+#include <tuple>
+#include <vector>
+#include <boost/thread.hpp>
+
+/**
+ * Alignment (in bytes) of prepared template pixel buffers.
+ */
+#define PREPARED_TEMPLATE_ALIGNMENT 32
+
+namespace degate
+{
+	/**
+	 * Zero-mean greyscale template image, ready for the correlation.
+	 *
+	 * Pixels are stored as floats in one contiguous, aligned buffer (row after row).
+	 */
+	class PreparedTemplateImage
+	{
+		friend class PreparedTemplateCache;
+
+	private:
+
+		unsigned int width, height;
+		double sum_over_zero_mean;
+
+		std::vector<float> storage;
+		float* data;
+
+	public:
+
+		/**
+		 * Create a prepared template image. All pixels are zero.
+		 */
+		PreparedTemplateImage(unsigned int width, unsigned int height);
+
+		PreparedTemplateImage(PreparedTemplateImage const&) = delete;
+		PreparedTemplateImage& operator=(PreparedTemplateImage const&) = delete;
+
+		unsigned int get_width() const { return width; }
+		unsigned int get_height() const { return height; }
+
+		/**
+		 * Get the sum over the squared zero-mean pixel values.
+		 */
+		double get_sum_over_zero_mean() const { return sum_over_zero_mean; }
+
+		/**
+		 * Get the zero-mean pixel values (width * height floats, aligned on PREPARED_TEMPLATE_ALIGNMENT bytes).
+		 */
+		const float* get_data() const { return data; }
+
+		/**
+		 * Get the zero-mean pixel values of a row.
+		 */
+		const float* get_row(unsigned int y) const
+		{
+			assert(y < height);
+			return data + static_cast<size_t>(y) * width;
+		}
+
+		/**
+		 * Get a zero-mean pixel value.
+		 */
+		float get_pixel(unsigned int x, unsigned int y) const
+		{
+			assert(x < width);
+			return get_row(y)[x];
+		}
+	};
+
+	typedef std::shared_ptr<const PreparedTemplateImage> PreparedTemplateImage_shptr;
+
+	/**
+	 * A gate template image prepared for one orientation and one scaling.
+	 */
+	struct PreparedTemplate
+	{
+		PreparedTemplateImage_shptr normal; /**< Unscaled template. */
+		PreparedTemplateImage_shptr scaled; /**< Template scaled down by the scaling factor. */
+	};
+
+
+	/**
+	 * In-memory cache of prepared gate template images.
+	 *
+	 * Preparing a template (orientation, greyscale conversion, scaling and mean subtraction) is done
+	 * once per template image, layer type, orientation and scaling factor, then shared by all matching runs.
+	 * Entries are keyed by the image revision of the template (@see GateTemplate::get_image_revision()),
+	 * so a changed template image is prepared again. The entries of an older revision are dropped then.
+	 * Call clear() when the gate templates are discarded, e.g. when a project is closed.
+	 *
+	 * This class is thread safe.
+	 */
+	class PreparedTemplateCache : public SingletonBase<PreparedTemplateCache>
+	{
+		friend class SingletonBase<PreparedTemplateCache>;
+
+	private:
+
+		typedef std::tuple<object_id_t, unsigned long, Layer::LAYER_TYPE, Gate::ORIENTATION, unsigned int> key_type;
+		typedef std::map<key_type, PreparedTemplate> cache_type;
+
+		cache_type cache;
+		mutable boost::mutex mutex;
+
+		PreparedTemplateCache()
+		{
+		}
+
+		/**
+		 * Create a zero-mean prepared image from a greyscale image.
+		 */
+		static PreparedTemplateImage_shptr create_prepared_image(MemoryImage_GS_BYTE_shptr img);
+
+	public:
+
+		/**
+		 * Prepare a template for matching, or get it from the cache.
+		 * @param tmpl The gate template.
+		 * @param layer_type The layer type of the template image.
+		 * @param orientation The orientation to match.
+		 * @param scaling_factor The scaling factor for the scaled template.
+		 * @exception CollectionLookupException Thrown if the template has no image for \p layer_type.
+		 */
+		PreparedTemplate get(GateTemplate_shptr tmpl,
+		                     Layer::LAYER_TYPE layer_type,
+		                     Gate::ORIENTATION orientation,
+		                     unsigned int scaling_factor);
+
+		/**
+		 * Drop all prepared images of a gate template, e.g. of a removed one.
+		 */
+		void invalidate(object_id_t template_id);
+
+		/**
+		 * Drop all prepared images.
+		 */
+		void clear();
+
+		/**
+		 * Get the number of cached prepared templates.
+		 */
+		size_t size() const;
+	};
+}
+
+#endif
@@ -34,64 +34,25 @@
 #include <utility>
 #include <boost/foreach.hpp>
 #include <cmath>
+#include <climits>
 
 using namespace degate;
 
-//#define USE_MEDIAN_FILTER 2
-//#define USE_GAUSS_FILTER 5
-
-#if defined(USE_MEDIAN_FILTER) || defined(USE_GAUSS_FILTER)
-#define USE_FILTER
-#endif
-
 TemplateMatching::TemplateMatching()
 {
 	threshold_hc = 0.40;
 	threshold_detection = 0.70;
 	max_step_size_search = 3;
 	scale_down = 1;
+	set_correlation_kernel(get_best_correlation_kernel());
+	offset_normal_x = offset_normal_y = 0;
+	offset_scaled_x = offset_scaled_y = 0;
 }
 
 TemplateMatching::~TemplateMatching()
 {
 }
 
-void TemplateMatching::precalc_sum_tables(TileImage_GS_BYTE_shptr img,
-                                          TileImage_GS_DOUBLE_shptr summation_table_single,
-                                          TileImage_GS_DOUBLE_shptr summation_table_squared)
-{
-	unsigned int x, y;
-
-	for (y = 0; y < img->get_height(); y++)
-		for (x = 0; x < img->get_width(); x++)
-		{
-			summation_table_single->set_pixel(x, y, 0);
-			summation_table_squared->set_pixel(x, y, 0);
-		}
-
-	for (y = 0; y < img->get_height(); y++)
-		for (x = 0; x < img->get_width(); x++)
-		{
-			double f = img->get_pixel_as<gs_double_pixel_t>(x, y);
-
-			double s_l = x > 0 ? summation_table_single->get_pixel(x - 1, y) : 0;
-			double s_o = y > 0 ? summation_table_single->get_pixel(x, y - 1) : 0;
-			double s_lo = x > 0 && y > 0 ? summation_table_single->get_pixel(x - 1, y - 1) : 0;
-
-
-			double s2_l = x > 0 ? summation_table_squared->get_pixel(x - 1, y) : 0;
-			double s2_o = y > 0 ? summation_table_squared->get_pixel(x, y - 1) : 0;
-			double s2_lo = x > 0 && y > 0 ? summation_table_squared->get_pixel(x - 1, y - 1) : 0;
-
-			double f1 = f + s_l + s_o - s_lo;
-			double f2 = f * f + s2_l + s2_o - s2_lo;
-
-			summation_table_single->set_pixel(x, y, f1);
-			summation_table_squared->set_pixel(x, y, f2);
-		}
-}
-
-
 void TemplateMatching::init(BoundingBox const& bounding_box, Project_shptr project)
 {
 	assert(project != nullptr);
@@ -106,12 +67,8 @@ void TemplateMatching::init(BoundingBox const& bounding_box, Project_shptr proje
 	if (this->bounding_box.get_max_y() + 1 > static_cast<int>(project->get_height()))
 		this->bounding_box.set_max_y(LENGTH_TO_MAX(project->get_height()));
 
-	ScalingManager_shptr sm = layer_matching->get_scaling_manager();
-
-	debug(TM, "Prepare background.");
-	prepare_background_images(sm, bounding_box, get_scaling_factor());
-	debug(TM, "Prepare sum tabes.");
-	prepare_sum_tables(gs_img_normal, gs_img_scaled);
+	debug(TM, "Prepare background and sum tables.");
+	prepare_background_images(this->bounding_box, get_scaling_factor());
 }
 
 
@@ -124,105 +81,52 @@ BoundingBox TemplateMatching::get_scaled_bounding_box(BoundingBox const& boundin
 	                   lrint(bounding_box.get_max_y() / scale_down));
 }
 
-void TemplateMatching::prepare_background_images(ScalingManager_shptr sm,
-                                                 BoundingBox const& bounding_box,
+void TemplateMatching::prepare_background_images(BoundingBox const& bounding_box,
                                                  unsigned int scaling_factor)
 {
-	// Get the normal background image and the scaled background image
-	// These images are in RGBA format.
-	const ScalingManager<BackgroundImage>::image_map_element i1 =
-		sm->get_image(1);
-	const ScalingManager<BackgroundImage>::image_map_element i2 =
-		sm->get_image(scaling_factor);
-
-	assert(i1.second != nullptr);
-	assert(i2.second != nullptr);
-	assert(i2.first == get_scaling_factor());
-
-	BackgroundImage_shptr img_normal = i1.second;
-	BackgroundImage_shptr img_scaled = i2.second;
-
-	// Create a greyscaled image for the normal
-	// unscaled background image and the scaled version.
-	BoundingBox scaled_bounding_box =
-		get_scaled_bounding_box(bounding_box, scaling_factor);
-
-
-	gs_img_normal = std::make_shared<TileImage_GS_BYTE>(bounding_box.get_width(),
-	                                                              bounding_box.get_height());
-
-#ifdef USE_FILTER
-
-  TileImage_GS_BYTE_shptr tmp;
-
-  tmp =  TileImage_GS_BYTE_shptr(new TileImage_GS_BYTE(bounding_box.get_width(),
-						       bounding_box.get_height()));;
-
-  extract_partial_image(tmp, img_normal, bounding_box);
-
-#ifdef USE_MEDIAN_FILTER
-
-  median_filter(gs_img_normal, tmp, USE_MEDIAN_FILTER);
-
-
-#elif defined(USE_GAUSS_FILTER)
-
-  int blur_kernel_size = USE_GAUSS_FILTER;
-
-  std::shared_ptr<GaussianBlur>
-    gaussian_blur_kernel(new GaussianBlur(blur_kernel_size, blur_kernel_size, 1.1));
-
-  gaussian_blur_kernel->print();
-
-  convolve(gs_img_normal, tmp, gaussian_blur_kernel);
-
-#endif
+	if (needs_integral_images())
+	{
+		// Get the greyscale versions of the normal background image and of the
+		// scaled background image, with their summation tables. They are computed
+		// once per layer and shared by all matching runs.
+		IntegralImageManager_shptr iim = layer_matching->get_integral_image_manager();
+		assert(iim != nullptr);
 
-#else
-	extract_partial_image(gs_img_normal, img_normal, bounding_box);
-#endif
+		const std::pair<unsigned int, IntegralImage_shptr> i1 = iim->get_integral_image(1);
+		const std::pair<unsigned int, IntegralImage_shptr> i2 = iim->get_integral_image(scaling_factor);
 
+		assert(i1.second != nullptr);
+		assert(i2.second != nullptr);
+		assert(i2.first == get_scaling_factor());
 
-	if (scaling_factor == 1)
-		gs_img_scaled = gs_img_normal;
+		integral_img_normal = i1.second;
+		integral_img_scaled = i2.second;
+	}
 	else
 	{
-		gs_img_scaled = std::make_shared<TileImage_GS_BYTE>(scaled_bounding_box.get_width(),
-		                                                              scaled_bounding_box.get_height());
-
-#ifdef USE_MEDIAN_FILTER
-    tmp =  TileImage_GS_BYTE_shptr(new TileImage_GS_BYTE(bounding_box.get_width(),
-							 bounding_box.get_height()));;
+		// Summation tables are computed later, only for the parts that are searched.
+		ScalingManager_shptr sm = layer_matching->get_scaling_manager();
+		assert(sm != nullptr);
 
-    extract_partial_image(tmp, img_scaled, scaled_bounding_box);
+		const ScalingManager<BackgroundImage>::image_map_element i1 = sm->get_image(1);
+		const ScalingManager<BackgroundImage>::image_map_element i2 = sm->get_image(scaling_factor);
 
-    median_filter(gs_img_scaled, tmp, USE_MEDIAN_FILTER);
-#else
+		assert(i1.second != nullptr);
+		assert(i2.second != nullptr);
+		assert(lrint(i2.first) == get_scaling_factor());
 
-		extract_partial_image(gs_img_scaled, img_scaled, scaled_bounding_box);
-#endif
+		background_normal = i1.second;
+		background_scaled = i2.second;
 	}
 
-	//save_image("/tmp/xxx1.tif", gs_img_normal);
-	//save_image("/tmp/xxx2.tif", gs_img_scaled);
-}
+	// The search happens in coordinates relative to the bounding box.
+	BoundingBox scaled_bounding_box =
+		get_scaled_bounding_box(bounding_box, scaling_factor);
 
-void TemplateMatching::prepare_sum_tables(TileImage_GS_BYTE_shptr gs_img_normal,
-                                          TileImage_GS_BYTE_shptr gs_img_scaled)
-{
-	unsigned int
-		w_n = gs_img_normal->get_width(),
-		h_n = gs_img_normal->get_height(),
-		w_s = gs_img_scaled->get_width(),
-		h_s = gs_img_scaled->get_height();
-
-	sum_table_single_normal = std::make_shared<TileImage_GS_DOUBLE>(w_n, h_n);
-	sum_table_squared_normal = std::make_shared<TileImage_GS_DOUBLE>(w_n, h_n);
-	sum_table_single_scaled = std::make_shared<TileImage_GS_DOUBLE>(w_s, h_s);
-	sum_table_squared_scaled = std::make_shared<TileImage_GS_DOUBLE>(w_s, h_s);
-
-	precalc_sum_tables(gs_img_normal, sum_table_single_normal, sum_table_squared_normal);
-	precalc_sum_tables(gs_img_scaled, sum_table_single_scaled, sum_table_squared_scaled);
+	offset_normal_x = std::max(0.0f, std::floor(bounding_box.get_min_x()));
+	offset_normal_y = std::max(0.0f, std::floor(bounding_box.get_min_y()));
+	offset_scaled_x = std::max(0.0f, std::floor(scaled_bounding_box.get_min_x()));
+	offset_scaled_y = std::max(0.0f, std::floor(scaled_bounding_box.get_min_y()));
 }
 
 
@@ -243,6 +147,12 @@ void TemplateMatching::set_templates(std::list<GateTemplate_shptr> tmpl_set)
 	this->tmpl_set.sort(compare_template_size);
 }
 
+void TemplateMatching::set_correlation_kernel(CORRELATION_KERNEL kernel)
+{
+	correlate_row = get_row_correlation_function(kernel);
+	correlation_kernel = kernel;
+}
+
 void TemplateMatching::set_orientations(std::list<Gate::ORIENTATION> tmpl_orientations)
 {
 	this->tmpl_orientations = tmpl_orientations;
@@ -259,20 +169,42 @@ void TemplateMatching::run()
         return;
 
 	debug(TM, "run template matching");
-	std::list<match_found> matches;
 
 	stats.reset();
-	set_progress_step_size(1.0 / (tmpl_set.size() * tmpl_orientations.size()));
 
-	/*
-	BOOST_FOREACH(GateTemplate_shptr tmpl, tmpl_set) {
-	  BOOST_FOREACH(Gate::ORIENTATION orientation, tmpl_orientations) {
-	    add_task( run2, parameter)
-	  }
+	// Decode template images that were not used so far in parallel, instead of one by one.
+	GateTemplate::image_load_list template_images;
+	BOOST_FOREACH(GateTemplate_shptr tmpl, tmpl_set)
+		template_images.push_back(std::make_pair(tmpl, layer_matching->get_layer_type()));
+	GateTemplate::load_images(template_images);
+
+	std::list<match_found> matches = find_matches();
+
+	if (is_canceled())
+	{
+		reset_progress();
+		return;
 	}
-  
-	wait;
-	*/
+
+	matches.sort(compare_correlation);
+
+	BOOST_FOREACH(match_found const& m, matches)
+	{
+		std::cout << "Try to insert gate of type " << m.tmpl->get_name() << " with corr="
+			<< m.correlation << " at " << m.x << "," << m.y << std::endl;
+		if (add_gate(m.x, m.y, m.tmpl, m.orientation, m.correlation, m.t_hc))
+			std::cout << "\tInserted gate of type " << m.tmpl->get_name() << std::endl;
+	}
+
+	reset_progress();
+}
+
+std::list<TemplateMatching::match_found> TemplateMatching::find_matches()
+{
+	std::list<match_found> matches;
+
+	set_progress_step_size(1.0 / (tmpl_set.size() * tmpl_orientations.size()));
+
 	BOOST_FOREACH(GateTemplate_shptr tmpl, tmpl_set)
 	{
 		BOOST_FOREACH(Gate::ORIENTATION orientation, tmpl_orientations)
@@ -282,8 +214,6 @@ void TemplateMatching::run()
 			set_log_message(f.str());
 
 			prepared_template prep_tmpl_img = prepare_template(tmpl, orientation);
-			//match_single_template(prep_tmpl_img, t_hc, t_det);
-
 
 			std::list<match_found> m = match_single_template(prep_tmpl_img,
 			                                                 threshold_hc,
@@ -294,125 +224,306 @@ void TemplateMatching::run()
 
 			progress_step_done();
 			if (is_canceled())
-			{
-				reset_progress();
-				return;
-			}
+				return matches;
 		}
 	}
 
+	return matches;
+}
+
+std::list<TemplateMatching::match_found> TemplateMatching::find_matches_along_grid(Grid_shptr grid, bool in_rows)
+{
+	assert(grid != nullptr);
+	assert(background_normal != nullptr && background_scaled != nullptr);
 
-	matches.sort(compare_correlation);
+	std::list<match_found> matches;
 
-	BOOST_FOREACH(match_found const& m, matches)
+	std::vector<prepared_template> templates;
+	BOOST_FOREACH(GateTemplate_shptr tmpl, tmpl_set)
 	{
-		std::cout << "Try to insert gate of type " << m.tmpl->get_name() << " with corr="
-			<< m.correlation << " at " << m.x << "," << m.y << std::endl;
-		if (add_gate(m.x, m.y, m.tmpl, m.orientation, m.correlation, m.t_hc))
-			std::cout << "\tInserted gate of type " << m.tmpl->get_name() << std::endl;
+		BOOST_FOREACH(Gate::ORIENTATION orientation, tmpl_orientations)
+			templates.push_back(prepare_template(tmpl, orientation));
 	}
 
-	reset_progress();
-}
+	if (templates.empty())
+		return matches;
 
+	const unsigned int scaling = get_scaling_factor();
+	const unsigned int search_w = bounding_box.get_width();
+	const unsigned int search_h = bounding_box.get_height();
+	const unsigned int search_min_x = bounding_box.get_min_x();
+	const unsigned int search_min_y = bounding_box.get_min_y();
 
-double TemplateMatching::subtract_mean(TempImage_GS_BYTE_shptr img,
-                                       TempImage_GS_DOUBLE_shptr zero_mean_img) const
-{
-	double mean = average(img);
+	// The extent of the bands is the largest template size across the grid lines.
+	unsigned int band_extent = 0, band_extent_scaled = 0;
+	for (auto const& t : templates)
+	{
+		band_extent = std::max(band_extent, in_rows ? t.normal->get_height() : t.normal->get_width());
+		band_extent_scaled = std::max(band_extent_scaled, in_rows ? t.scaled->get_height() : t.scaled->get_width());
+	}
+
+	// Grid offsets within the search area.
+	std::vector<unsigned int> offsets;
+	const int offs_min = in_rows ? search_min_y : search_min_x;
+	const unsigned int search_extent = in_rows ? search_h : search_w;
+
+	for (Grid::grid_iter iter = grid->begin(); iter != grid->end(); ++iter)
+	{
+		if (*iter >= offs_min && static_cast<unsigned int>(*iter - offs_min) < search_extent)
+			offsets.push_back(*iter - offs_min);
+	}
 
-	double sum_over_zero_mean_img = 0;
-	unsigned int x, y;
+	if (offsets.empty())
+	{
+		debug(TM, "There is no grid offset in the search area.");
+		return matches;
+	}
+
+	// The bands reach from the previous to the next grid offset.
+	std::sort(offsets.begin(), offsets.end());
+
+	set_progress_step_size(1.0 / offsets.size());
+
+	IntegralBand band_scaled, band_normal;
+	std::vector<batch_entry> batch(templates.size());
+
+	// Lengths of the bands along the grid lines.
+	const unsigned int length_scaled = (in_rows ? search_w : search_h) / scaling + 2;
+	const unsigned int length_normal = in_rows ? search_w : search_h;
+
+	for (size_t i = 0; i < offsets.size(); i++)
+	{
+		const unsigned int offset = offsets[i];
+
+		boost::format f("Check grid offset %1%");
+		f % (offset + offs_min);
+		set_log_message(f.str());
+
+		// Load the band data for this grid offset, they are shared by all templates.
+		// Hill climbing can move up to the neighbouring grid offsets (to the edges of the
+		// search area for the outer ones), so it finds the same peaks as the full search.
+		const unsigned int offset_scaled = lrint(static_cast<double>(offset) / scaling);
+		const unsigned int prev_offset = i > 0 ? offsets[i - 1] : 0;
+		const unsigned int next_offset = i + 1 < offsets.size() ? offsets[i + 1] : search_extent;
+		const unsigned int band_begin = std::min(prev_offset, offset > TEMPLATE_MATCHING_BAND_MARGIN ?
+		                                                      offset - TEMPLATE_MATCHING_BAND_MARGIN : 0);
+		const unsigned int band_size = std::max(next_offset, offset + TEMPLATE_MATCHING_BAND_MARGIN) -
+			band_begin + band_extent;
+
+		bool loaded;
+		if (in_rows)
+			loaded = band_scaled.load(background_scaled, offset_scaled_x, offset_scaled_y + offset_scaled,
+			                          length_scaled, band_extent_scaled) &&
+				band_normal.load(background_normal, offset_normal_x, offset_normal_y + band_begin,
+				                 length_normal, band_size);
+		else
+			loaded = band_scaled.load(background_scaled, offset_scaled_x + offset_scaled, offset_scaled_y,
+			                          band_extent_scaled, length_scaled) &&
+				band_normal.load(background_normal, offset_normal_x + band_begin, offset_normal_y,
+				                 band_size, length_normal);
 
-	for (y = 0; y < img->get_height(); y++)
-		for (x = 0; x < img->get_width(); x++)
+		if (!loaded)
 		{
-			double tmp = img->get_pixel_as<gs_double_pixel_t>(x, y) - mean;
-			zero_mean_img->set_pixel(x, y, tmp);
-			sum_over_zero_mean_img += tmp * tmp;
+			progress_step_done();
+			continue;
+		}
+
+		search_state state = search_state();
+		state.step_size_search = get_max_step_size();
+
+		// Walk along the band. At each position all templates are evaluated at once.
+		for (unsigned int pos = 1; pos < (in_rows ? search_w : search_h) && !is_canceled();
+		     pos += state.step_size_search)
+		{
+			const unsigned int x = in_rows ? pos : offset;
+			const unsigned int y = in_rows ? offset : pos;
+
+			double max_corr;
+			unsigned int skip;
+
+			if (match_templates_at(band_scaled, band_normal, templates, batch, x, y, in_rows,
+			                       matches, &max_corr, &skip))
+			{
+				// The step size follows the best matching template.
+				adjust_step_size(state, max_corr);
+			}
+			else if (skip == UINT_MAX)
+				break;
+			else
+				state.step_size_search = skip;
 		}
 
+		progress_step_done();
+		if (is_canceled())
+			return matches;
+	}
 
-	return sum_over_zero_mean_img;
+	return matches;
 }
 
-TemplateMatching::prepared_template TemplateMatching::prepare_template(GateTemplate_shptr tmpl,
-                                                                       Gate::ORIENTATION orientation)
+
+template <typename IntegralType>
+bool TemplateMatching::match_templates_at(IntegralType const& master_scaled,
+                                          IntegralType const& master_normal,
+                                          std::vector<prepared_template>& templates,
+                                          std::vector<batch_entry>& batch,
+                                          unsigned int x, unsigned int y,
+                                          bool query_horizontal_distance,
+                                          std::list<match_found>& matches,
+                                          double* max_corr_out,
+                                          unsigned int* skip_out)
 {
-	prepared_template prep;
+	const unsigned int search_w = bounding_box.get_width();
+	const unsigned int search_h = bounding_box.get_height();
+	const unsigned int search_min_x = bounding_box.get_min_x();
+	const unsigned int search_min_y = bounding_box.get_min_y();
 
-	assert(layer_matching->get_layer_type() != Layer::UNDEFINED);
-	assert(tmpl->has_image(layer_matching->get_layer_type()));
+	bool any_active = false;
+	unsigned int skip = UINT_MAX;
 
-	prep.gate_template = tmpl;
-	prep.orientation = orientation;
+	for (unsigned int i = 0; i < templates.size(); i++)
+	{
+		const unsigned int tmpl_w = templates[i].normal->get_width();
+		const unsigned int tmpl_h = templates[i].normal->get_height();
 
-	// get image from template
-	GateTemplateImage_shptr tmpl_img_orig = tmpl->get_image(layer_matching->get_layer_type());
+		batch[i].tmpl_img = nullptr;
 
-	unsigned int
-		w = tmpl_img_orig->get_width(),
-		h = tmpl_img_orig->get_height();
+		// the template must be within the search area and must not overlap a gate
+		if (x + tmpl_w >= search_w || y + tmpl_h > search_h)
+			continue;
 
-	// get image according to orientation
-	GateTemplateImage_shptr tmpl_img(new GateTemplateImage(w, h));
+		const unsigned int dist = layer_insert->get_distance_to_gate_boundary(x + search_min_x, y + search_min_y,
+		                                                                      query_horizontal_distance,
+		                                                                      tmpl_w, tmpl_h);
+		if (dist > 0)
+		{
+			skip = std::min(skip, dist);
+			continue;
+		}
+
+		batch[i].tmpl_img = templates[i].scaled.get();
+		any_active = true;
+	}
 
-	//#ifdef USE_MEDIAN_FILERX
-	//  median_filter(tmpl_img, tmpl_img_orig, 3);
-	//#else
-	copy_image(tmpl_img, tmpl_img_orig);
-	//#endif
+	*skip_out = skip;
 
-	//save_image("/tmp/xxx3.tif", tmpl_img);
+	if (!any_active)
+		return false;
 
-	switch (orientation)
+	calc_batched_xcorr(master_scaled, offset_scaled_x, offset_scaled_y, batch,
+	                   lrint(static_cast<double>(x) / get_scaling_factor()),
+	                   lrint(static_cast<double>(y) / get_scaling_factor()));
+
+	double max_corr = -1;
+
+	for (unsigned int i = 0; i < templates.size(); i++)
 	{
-	case Gate::ORIENTATION_FLIPPED_UP_DOWN:
-		flip_up_down(tmpl_img);
-		break;
-	case Gate::ORIENTATION_FLIPPED_LEFT_RIGHT:
-		flip_left_right(tmpl_img);
-		break;
-	case Gate::ORIENTATION_FLIPPED_BOTH:
-		flip_both(tmpl_img);
-		break;
-	case Gate::ORIENTATION_NORMAL:
-		break;
-	case Gate::ORIENTATION_UNDEFINED:
-		assert(1 == 0); // it is already checked
+		if (batch[i].tmpl_img == nullptr)
+			continue;
+
+		const double corr_val = batch[i].correlation;
+		max_corr = std::max(max_corr, corr_val);
+
+		if (corr_val >= threshold_hc)
+		{
+			unsigned int max_corr_x, max_corr_y;
+			double curr_max_val;
+			hill_climbing(master_normal, x, y, corr_val,
+			              &max_corr_x, &max_corr_y, &curr_max_val,
+			              templates[i].normal);
+
+			if (curr_max_val >= threshold_detection)
+			{
+				matches.push_back(keep_gate_match(max_corr_x + search_min_x,
+				                                  max_corr_y + search_min_y,
+				                                  templates[i], curr_max_val, threshold_hc));
+			}
+		}
 	}
 
-	// create a scaled version of the template image
+	*max_corr_out = max_corr;
+	return true;
+}
 
-	unsigned int
-		scaled_tmpl_width = std::floor(static_cast<double>(w) / get_scaling_factor()),
-		scaled_tmpl_height = std::floor(static_cast<double>(h) / get_scaling_factor());
+std::list<TemplateMatching::match_found> TemplateMatching::find_matches_batched()
+{
+	assert(integral_img_normal != nullptr && integral_img_scaled != nullptr);
 
-	prep.tmpl_img_normal = std::make_shared<TempImage_GS_BYTE>(w, h);
-	copy_image(prep.tmpl_img_normal, tmpl_img);
+	std::list<match_found> matches;
+
+	std::vector<prepared_template> templates;
+	BOOST_FOREACH(GateTemplate_shptr tmpl, tmpl_set)
+	{
+		BOOST_FOREACH(Gate::ORIENTATION orientation, tmpl_orientations)
+			templates.push_back(prepare_template(tmpl, orientation));
+	}
 
-	prep.tmpl_img_scaled = std::make_shared<TempImage_GS_BYTE>(scaled_tmpl_width,
-	                                                                     scaled_tmpl_height);
+	if (templates.empty())
+		return matches;
 
-	scale_down_by_power_of_2(prep.tmpl_img_scaled, tmpl_img);
+	const unsigned int search_w = bounding_box.get_width();
+	const unsigned int search_h = bounding_box.get_height();
 
+	std::vector<batch_entry> batch(templates.size());
 
-	// create zero-mean templates
-	prep.zero_mean_template_normal = std::make_shared<TempImage_GS_DOUBLE>(w, h);
-	prep.zero_mean_template_scaled = std::make_shared<TempImage_GS_DOUBLE>(scaled_tmpl_width,
-	                                                                                   scaled_tmpl_height);
+	set_log_message("Check all cells");
+
+	unsigned int row_step;
+	for (unsigned int y = 1; y < search_h && !is_canceled(); y += row_step)
+	{
+		search_state state = search_state();
+		state.step_size_search = get_max_step_size();
 
+		// The next row follows the smallest step size in this row.
+		row_step = get_max_step_size();
 
-	// subtract mean
+		for (unsigned int x = 1; x < search_w; x += state.step_size_search)
+		{
+			double max_corr;
+			unsigned int skip;
+
+			if (match_templates_at(*integral_img_scaled, *integral_img_normal, templates, batch, x, y, true,
+			                       matches, &max_corr, &skip))
+			{
+				adjust_step_size(state, max_corr);
+				row_step = std::min(row_step, state.step_size_search);
+			}
+			else if (skip == UINT_MAX)
+				break;
+			else
+				state.step_size_search = skip;
+		}
+
+		set_progress(static_cast<double>(y) / search_h);
+	}
+
+	return matches;
+}
+
+
+TemplateMatching::prepared_template TemplateMatching::prepare_template(GateTemplate_shptr tmpl,
+                                                                       Gate::ORIENTATION orientation)
+{
+	prepared_template prep;
+
+	assert(layer_matching->get_layer_type() != Layer::UNDEFINED);
+	assert(tmpl->has_image(layer_matching->get_layer_type()));
+	assert(orientation != Gate::ORIENTATION_UNDEFINED); // it is already checked
+
+	prep.gate_template = tmpl;
+	prep.orientation = orientation;
 
-	prep.sum_over_zero_mean_template_normal = subtract_mean(prep.tmpl_img_normal,
-	                                                        prep.zero_mean_template_normal);
-	prep.sum_over_zero_mean_template_scaled = subtract_mean(prep.tmpl_img_scaled,
-	                                                        prep.zero_mean_template_scaled);
+	// oriented, greyscaled, scaled and zero-mean template images
+	PreparedTemplate prepared = PreparedTemplateCache::get_instance().get(tmpl,
+	                                                                      layer_matching->get_layer_type(),
+	                                                                      orientation,
+	                                                                      get_scaling_factor());
 
+	prep.normal = prepared.normal;
+	prep.scaled = prepared.scaled;
 
-	assert(prep.sum_over_zero_mean_template_normal > 0);
-	assert(prep.sum_over_zero_mean_template_scaled > 0);
+	assert(prep.normal->get_sum_over_zero_mean() > 0);
+	assert(prep.scaled->get_sum_over_zero_mean() > 0);
 
 	return prep;
 }
@@ -491,11 +602,10 @@ TemplateMatching::match_single_template(struct prepared_template& tmpl,
 	{
 		// works on unscaled, but cropped image
 
-		double corr_val = calc_single_xcorr(gs_img_scaled,
-		                                    sum_table_single_scaled,
-		                                    sum_table_squared_scaled,
-		                                    tmpl.zero_mean_template_scaled,
-		                                    tmpl.sum_over_zero_mean_template_scaled,
+		double corr_val = calc_single_xcorr(*integral_img_scaled,
+		                                    offset_scaled_x,
+		                                    offset_scaled_y,
+		                                    *tmpl.scaled,
 		                                    lrint(static_cast<double>(state.x) / get_scaling_factor()),
 		                                    lrint(static_cast<double>(state.y) / get_scaling_factor()));
 
@@ -515,10 +625,9 @@ TemplateMatching::match_single_template(struct prepared_template& tmpl,
 			//debug(TM, "start hill climbing at(%d,%d), corr=%f", state.x, state.y, corr_val);
 			unsigned int max_corr_x, max_corr_y;
 			double curr_max_val;
-			hill_climbing(state.x, state.y, corr_val,
+			hill_climbing(*integral_img_normal, state.x, state.y, corr_val,
 			              &max_corr_x, &max_corr_y, &curr_max_val,
-			              gs_img_normal, tmpl.zero_mean_template_normal,
-			              tmpl.sum_over_zero_mean_template_normal);
+			              tmpl.normal);
 
 			//debug(TM, "hill climbing returned for (%d,%d) corr=%f", max_corr_x, max_corr_y, curr_max_val);
 			if (curr_max_val >= threshold_detection)
@@ -538,13 +647,13 @@ TemplateMatching::match_single_template(struct prepared_template& tmpl,
 }
 
 
-void TemplateMatching::hill_climbing(unsigned int start_x, unsigned int start_y, double xcorr_val,
+template <typename IntegralType>
+void TemplateMatching::hill_climbing(IntegralType const& master,
+                                     unsigned int start_x, unsigned int start_y, double xcorr_val,
                                      unsigned int* max_corr_x_out,
                                      unsigned int* max_corr_y_out,
                                      double* max_xcorr_out,
-                                     const TileImage_GS_BYTE_shptr master,
-                                     const TempImage_GS_DOUBLE_shptr zero_mean_template,
-                                     double sum_over_zero_mean_template) const
+                                     const PreparedTemplateImage_shptr& tmpl_img) const
 {
 	unsigned int max_corr_x = start_x;
 	unsigned int max_corr_y = start_y;
@@ -555,6 +664,8 @@ void TemplateMatching::hill_climbing(unsigned int start_x, unsigned int start_y,
 	//std::list<std::pair<unsigned int, unsigned int> > positions;
 
 	const unsigned int radius = get_max_step_size();
+	const unsigned int width = bounding_box.get_width();
+	const unsigned int height = bounding_box.get_height();
 	const unsigned int size = (2 * radius + 1) * (2 * radius + 1);
 
 	auto positions_x = new unsigned int[size];
@@ -569,8 +680,8 @@ void TemplateMatching::hill_climbing(unsigned int start_x, unsigned int start_y,
 		unsigned int
 			from_x = max_corr_x >= radius ? max_corr_x - radius : 0,
 			from_y = max_corr_y >= radius ? max_corr_y - radius : 0,
-			to_x = max_corr_x + radius < master->get_width() ? max_corr_x + radius : master->get_width(),
-			to_y = max_corr_y + radius < master->get_height() ? max_corr_y + radius : master->get_height();
+			to_x = max_corr_x + radius < width ? max_corr_x + radius : width,
+			to_y = max_corr_y + radius < height ? max_corr_y + radius : height;
 
 		unsigned int i = 0;
 		for (unsigned int _y = from_y; _y < to_y; _y++)
@@ -593,10 +704,9 @@ void TemplateMatching::hill_climbing(unsigned int start_x, unsigned int start_y,
 			//debug(TM, "hill climbing step at (%d,%d)", x, y);
 
 			double curr_corr_val = calc_single_xcorr(master,
-			                                         sum_table_single_normal,
-			                                         sum_table_squared_normal,
-			                                         zero_mean_template,
-			                                         sum_over_zero_mean_template,
+			                                         offset_normal_x,
+			                                         offset_normal_y,
+			                                         *tmpl_img,
 			                                         x, y);
 
 			if (curr_corr_val > max_corr)
@@ -619,69 +729,51 @@ void TemplateMatching::hill_climbing(unsigned int start_x, unsigned int start_y,
 }
 
 
-double TemplateMatching::calc_single_xcorr(const TileImage_GS_BYTE_shptr master,
-                                           const TileImage_GS_DOUBLE_shptr summation_table_single,
-                                           const TileImage_GS_DOUBLE_shptr summation_table_squared,
-                                           const TempImage_GS_DOUBLE_shptr zero_mean_template,
-                                           double sum_over_zero_mean_template,
+template <typename IntegralType>
+double TemplateMatching::calc_single_xcorr(IntegralType const& master,
+                                           unsigned int offset_x,
+                                           unsigned int offset_y,
+                                           const PreparedTemplateImage& tmpl_img,
                                            unsigned int local_x,
                                            unsigned int local_y) const
 {
-	double template_size = zero_mean_template->get_width() * zero_mean_template->get_height();
-	assert(zero_mean_template->get_width() > 0 && zero_mean_template->get_height() > 0);
+	const unsigned int
+		tmpl_w = tmpl_img.get_width(),
+		tmpl_h = tmpl_img.get_height();
 
-	unsigned int
-		x_plus_w = local_x + zero_mean_template->get_width() - 1,
-		y_plus_h = local_y + zero_mean_template->get_height() - 1,
-		lxm1 = local_x - 1, // can wrap, it's checked later
-		lym1 = local_y - 1;
+	double template_size = tmpl_w * tmpl_h;
+	assert(tmpl_w > 0 && tmpl_h > 0);
+
+	const unsigned int
+		x = offset_x + local_x,
+		y = offset_y + local_y;
+
+	// the template must be within the background image
+	if (!master.contains(x, y, tmpl_w, tmpl_h))
+		return -1.0;
 
 	// calculate denominator
 	double
-		f1 = summation_table_single->get_pixel(x_plus_w, y_plus_h),
-		f2 = summation_table_squared->get_pixel(x_plus_w, y_plus_h);
+		f1 = master.get_sum(x, y, x + tmpl_w - 1, y + tmpl_h - 1),
+		f2 = master.get_squared_sum(x, y, x + tmpl_w - 1, y + tmpl_h - 1);
 
-	if (local_x > 0)
-	{
-		f1 -= summation_table_single->get_pixel(lxm1, y_plus_h);
-		f2 -= summation_table_squared->get_pixel(lxm1, y_plus_h);
-	}
-	if (local_y > 0)
-	{
-		f1 -= summation_table_single->get_pixel(x_plus_w, lym1);
-		f2 -= summation_table_squared->get_pixel(x_plus_w, lym1);
-	}
-	if (local_x > 0 && local_y > 0)
-	{
-		f1 += summation_table_single->get_pixel(lxm1, lym1);
-		f2 += summation_table_squared->get_pixel(lxm1, lym1);
-	}
-
-	double denominator = sqrt((f2 - f1 * f1 / template_size) * sum_over_zero_mean_template);
+	double denominator = sqrt((f2 - f1 * f1 / template_size) * tmpl_img.get_sum_over_zero_mean());
 
 	// calculate nummerator
 	if (std::isinf(denominator) || std::isnan(denominator) || denominator == 0)
 	{
 		debug(TM,
 		      "ERROR: The denominator is not a valid number: f1=%f f2=%f template_size=%f sum=%f "
-		      "local_x=%d local_y=%d x_plus_w=%d y_plus_h=%d lxm1=%d lym1=%d",
-		      f1, f2, template_size, sum_over_zero_mean_template,
-		      local_x, local_y, x_plus_w, y_plus_h, lxm1, lym1);
+		      "local_x=%d local_y=%d",
+		      f1, f2, template_size, tmpl_img.get_sum_over_zero_mean(),
+		      local_x, local_y);
 		return -1.0;
 	}
 
-	unsigned int _x, _y;
 	double nummerator = 0;
 
-	for (_y = 0; _y < zero_mean_template->get_height(); _y ++)
-	{
-		for (_x = 0; _x < zero_mean_template->get_width(); _x ++)
-		{
-			double f_xy = master->get_pixel(_x + local_x, _y + local_y);
-			double t_xy = zero_mean_template->get_pixel(_x, _y);
-			nummerator += f_xy * t_xy;
-		}
-	}
+	for (unsigned int _y = 0; _y < tmpl_h; _y++)
+		nummerator += correlate_row(master.get_row(x, y + _y), tmpl_img.get_row(_y), tmpl_w);
 
 	double q = nummerator / denominator;
 
@@ -695,12 +787,104 @@ double TemplateMatching::calc_single_xcorr(const TileImage_GS_BYTE_shptr master,
 	return q;
 }
 
+template <typename IntegralType>
+void TemplateMatching::calc_batched_xcorr(IntegralType const& master,
+                                          unsigned int offset_x,
+                                          unsigned int offset_y,
+                                          std::vector<batch_entry>& batch,
+                                          unsigned int local_x,
+                                          unsigned int local_y) const
+{
+	const unsigned int
+		x = offset_x + local_x,
+		y = offset_y + local_y;
+
+	// Denominators, the window sums are reused for templates of the same size.
+	unsigned int max_h = 0;
+	unsigned int last_w = 0, last_h = 0;
+	double f1 = 0, f2 = 0;
+
+	for (unsigned int i = 0; i < batch.size(); i++)
+	{
+		batch[i].correlation = -1.0;
+		batch[i].nummerator = 0;
+		batch[i].denominator = 0;
+
+		if (batch[i].tmpl_img == nullptr)
+			continue;
+
+		const PreparedTemplateImage& tmpl_img = *batch[i].tmpl_img;
+		const unsigned int
+			tmpl_w = tmpl_img.get_width(),
+			tmpl_h = tmpl_img.get_height();
+
+		assert(tmpl_w > 0 && tmpl_h > 0);
+
+		if (!master.contains(x, y, tmpl_w, tmpl_h))
+			continue;
+
+		if (tmpl_w != last_w || tmpl_h != last_h)
+		{
+			f1 = master.get_sum(x, y, x + tmpl_w - 1, y + tmpl_h - 1);
+			f2 = master.get_squared_sum(x, y, x + tmpl_w - 1, y + tmpl_h - 1);
+			last_w = tmpl_w;
+			last_h = tmpl_h;
+		}
+
+		const double template_size = tmpl_w * tmpl_h;
+		const double denominator = sqrt((f2 - f1 * f1 / template_size) * tmpl_img.get_sum_over_zero_mean());
+
+		if (std::isinf(denominator) || std::isnan(denominator) || denominator == 0)
+			continue;
+
+		batch[i].denominator = denominator;
+		max_h = std::max(max_h, tmpl_h);
+	}
+
+	// Nummerators, each image row is read once for all templates.
+	for (unsigned int _y = 0; _y < max_h; _y++)
+	{
+		const gs_byte_pixel_t* row = master.get_row(x, y + _y);
+
+		for (unsigned int i = 0; i < batch.size(); i++)
+		{
+			if (batch[i].denominator == 0 || batch[i].tmpl_img->get_height() <= _y)
+				continue;
+
+			batch[i].nummerator += correlate_row(row, batch[i].tmpl_img->get_row(_y),
+			                                     batch[i].tmpl_img->get_width());
+		}
+	}
+
+	for (unsigned int i = 0; i < batch.size(); i++)
+	{
+		if (batch[i].denominator != 0)
+			batch[i].correlation = batch[i].nummerator / batch[i].denominator;
+	}
+}
+
+// Instantiated for derived matching classes.
+template double TemplateMatching::calc_single_xcorr<IntegralImage>(IntegralImage const&, unsigned int, unsigned int,
+                                                                   const PreparedTemplateImage&,
+                                                                   unsigned int, unsigned int) const;
+template void TemplateMatching::calc_batched_xcorr<IntegralImage>(IntegralImage const&, unsigned int, unsigned int,
+                                                                  std::vector<batch_entry>&,
+                                                                  unsigned int, unsigned int) const;
+
+std::list<TemplateMatching::match_found> TemplateMatchingNormal::find_matches()
+{
+	if (batched)
+		return find_matches_batched();
+	else
+		return TemplateMatching::find_matches();
+}
+
 bool TemplateMatchingNormal::get_next_pos(struct search_state* state,
                                           struct prepared_template const& tmpl) const
 {
 	unsigned int
-		tmpl_w = tmpl.tmpl_img_normal->get_width(),
-		tmpl_h = tmpl.tmpl_img_normal->get_height();
+		tmpl_w = tmpl.normal->get_width(),
+		tmpl_h = tmpl.normal->get_height();
 
 	if (state->search_area.get_width() < tmpl_w ||
 		state->search_area.get_height() < tmpl_h)
@@ -747,6 +931,36 @@ bool TemplateMatchingNormal::get_next_pos(struct search_state* state,
 }
 
 
+Grid_shptr TemplateMatchingAlongGrid::get_grid(bool is_horizontal_grid) const
+{
+	const RegularGrid_shptr rg = is_horizontal_grid
+		                             ? project->get_regular_horizontal_grid()
+		                             : project->get_regular_vertical_grid();
+	const IrregularGrid_shptr ig = is_horizontal_grid
+		                               ? project->get_irregular_horizontal_grid()
+		                               : project->get_irregular_vertical_grid();
+
+	if (rg->is_enabled()) return rg;
+	else if (ig->is_enabled()) return ig;
+	else return Grid_shptr();
+}
+
+std::list<TemplateMatching::match_found> TemplateMatchingAlongGrid::find_matches()
+{
+	if (!sparse)
+		return TemplateMatching::find_matches();
+
+	// Rows are placed along the offsets of the vertical grid, columns along the horizontal grid.
+	Grid_shptr grid = get_grid(!is_matching_in_rows());
+	if (grid == nullptr)
+	{
+		debug(TM, "There is no grid enabled.");
+		return std::list<match_found>();
+	}
+
+	return find_matches_along_grid(grid, is_matching_in_rows());
+}
+
 bool TemplateMatchingAlongGrid::initialize_state_struct(struct search_state* state,
                                                         int offs_min,
                                                         int offs_max,
@@ -754,15 +968,7 @@ bool TemplateMatchingAlongGrid::initialize_state_struct(struct search_state* sta
 {
 	if (state->grid == nullptr)
 	{
-		const RegularGrid_shptr rg = is_horizontal_grid
-			                             ? project->get_regular_horizontal_grid()
-			                             : project->get_regular_vertical_grid();
-		const IrregularGrid_shptr ig = is_horizontal_grid
-			                               ? project->get_irregular_horizontal_grid()
-			                               : project->get_irregular_vertical_grid();
-
-		if (rg->is_enabled()) state->grid = rg;
-		else if (ig->is_enabled()) state->grid = ig;
+		state->grid = get_grid(is_horizontal_grid);
 
 		if (state->grid != nullptr)
 		{
@@ -815,8 +1021,8 @@ bool TemplateMatchingInRows::get_next_pos(struct search_state* state,
 {
 	// check if the search area is larger then the template
 	unsigned int
-		tmpl_w = tmpl.tmpl_img_normal->get_width(),
-		tmpl_h = tmpl.tmpl_img_normal->get_height();
+		tmpl_w = tmpl.normal->get_width(),
+		tmpl_h = tmpl.normal->get_height();
 
 	if (state->search_area.get_width() < tmpl_w ||
 		state->search_area.get_height() < tmpl_h)
@@ -890,8 +1096,8 @@ bool TemplateMatchingInCols::get_next_pos(struct search_state* state,
 {
 	// check if the search area is larger then the template
 	unsigned int
-		tmpl_w = tmpl.tmpl_img_normal->get_width(),
-		tmpl_h = tmpl.tmpl_img_normal->get_height();
+		tmpl_w = tmpl.normal->get_width(),
+		tmpl_h = tmpl.normal->get_height();
 
 	if (state->search_area.get_width() < tmpl_w ||
 		state->search_area.get_height() < tmpl_h)
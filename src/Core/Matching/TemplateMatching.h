@@ -25,8 +25,20 @@
 #include <Core/Image/Image.h>
 #include <Core/Project/Project.h>
 #include <Core/LogicModel/Layer.h>
+#include <Core/Matching/PreparedTemplateCache.h>
+#include <Core/Image/Manipulation/IntegralBand.h>
+#include <Core/Matching/CorrelationKernel.h>
 #include <Core/Utils/ProgressControl.h>
 
+#include <vector>
+
+/**
+ * Minimum number of full resolution pixels added on both sides of a grid band, to
+ * give room for the hill climbing around the grid positions. Bands reach at least
+ * to the neighbouring grid offsets.
+ */
+#define TEMPLATE_MATCHING_BAND_MARGIN 16
+
 namespace degate
 {
 	/**
@@ -70,17 +82,9 @@ namespace degate
 
 		struct prepared_template
 		{
-			TempImage_GS_BYTE_shptr tmpl_img_normal;
-			TempImage_GS_BYTE_shptr tmpl_img_scaled;
-
-			//TempImage_GS_BYTE_shptr zero_mean_template_normal; // GS_DOUBLE?
-			//TempImage_GS_BYTE_shptr zero_mean_template_scaled;
-
-			TempImage_GS_DOUBLE_shptr zero_mean_template_normal; // GS_DOUBLE?
-			TempImage_GS_DOUBLE_shptr zero_mean_template_scaled;
-
-			double sum_over_zero_mean_template_normal;
-			double sum_over_zero_mean_template_scaled;
+			// zero-mean greyscale templates (@see PreparedTemplateCache)
+			PreparedTemplateImage_shptr normal;
+			PreparedTemplateImage_shptr scaled;
 
 			Gate::ORIENTATION orientation;
 			GateTemplate_shptr gate_template;
@@ -100,6 +104,17 @@ namespace degate
 			                iter_end;
 		};
 
+		/**
+		 * A template in a batched correlation calculation.
+		 */
+		struct batch_entry
+		{
+			const PreparedTemplateImage* tmpl_img; // nullptr, if the template is skipped
+			double correlation; // the result, -1 if it can't be calculated
+
+			double nummerator, denominator; // intermediate values
+		};
+
 		struct TemplateMatchingStatistics stats;
 
 	public:
@@ -121,15 +136,20 @@ namespace degate
 		unsigned int max_step_size_search;
 		unsigned int scale_down;
 
-		// background images in greyscale
-		TileImage_GS_BYTE_shptr gs_img_normal;
-		TileImage_GS_BYTE_shptr gs_img_scaled;
+		CORRELATION_KERNEL correlation_kernel;
+		row_correlation_function correlate_row;
 
-		// summation tables
-		TileImage_GS_DOUBLE_shptr sum_table_single_normal;
-		TileImage_GS_DOUBLE_shptr sum_table_squared_normal;
-		TileImage_GS_DOUBLE_shptr sum_table_single_scaled;
-		TileImage_GS_DOUBLE_shptr sum_table_squared_scaled;
+		// background images in greyscale, with their summation tables
+		IntegralImage_shptr integral_img_normal;
+		IntegralImage_shptr integral_img_scaled;
+
+		// background images, for integral data that is computed per band
+		BackgroundImage_shptr background_normal;
+		BackgroundImage_shptr background_scaled;
+
+		// position of the bounding box within the normal and the scaled image
+		unsigned int offset_normal_x, offset_normal_y;
+		unsigned int offset_scaled_x, offset_scaled_y;
 
 		BoundingBox bounding_box; // bounding box on original unscaled background image
 
@@ -150,32 +170,23 @@ namespace degate
 	private:
 
 
-		void prepare_sum_tables(TileImage_GS_BYTE_shptr gs_img_normal,
-		                        TileImage_GS_BYTE_shptr gs_img_scaled);
-
-		void precalc_sum_tables(TileImage_GS_BYTE_shptr img,
-		                        TileImage_GS_DOUBLE_shptr summation_table_single,
-		                        TileImage_GS_DOUBLE_shptr summation_table_squared);
-
-
 		BoundingBox get_scaled_bounding_box(BoundingBox const& bounding_box,
 		                                    double scale_down) const;
 
-		void prepare_background_images(ScalingManager_shptr sm,
-		                               BoundingBox const& bounding_box,
+		void prepare_background_images(BoundingBox const& bounding_box,
 		                               unsigned int scaling_factor);
 
 		struct prepared_template prepare_template(GateTemplate_shptr tmpl,
 		                                          Gate::ORIENTATION orientation);
 
 
-		void hill_climbing(unsigned int start_x, unsigned int start_y, double xcorr_val,
+		template <typename IntegralType>
+		void hill_climbing(IntegralType const& master,
+		                   unsigned int start_x, unsigned int start_y, double xcorr_val,
 		                   unsigned int* max_corr_x_out,
 		                   unsigned int* max_corr_y_out,
 		                   double* max_xcorr_out,
-		                   const TileImage_GS_BYTE_shptr master,
-		                   const TempImage_GS_DOUBLE_shptr zero_mean_template,
-		                   double sum_over_zero_mean_template) const;
+		                   const PreparedTemplateImage_shptr& tmpl_img) const;
 
 		/**
 		 * Adjust step size depending on correlation value.
@@ -188,30 +199,29 @@ namespace degate
 
 
 		/**
-		 * Calculate a zero mean image from an image and return
-		 * the variance(?).
+		 * Evaluate all templates at a position, with hill climbing for promising
+		 * templates. Templates that leave the search area or overlap a gate are skipped.
+		 * @param master_scaled The scaled image for the correlation.
+		 * @param master_normal The normal image for the hill climbing.
+		 * @param x Coordinate within the search area.
+		 * @param y Coordinate within the search area.
+		 * @param query_horizontal_distance Direction in which gates are skipped.
+		 * @param matches Found matches are appended here.
+		 * @param max_corr_out The highest correlation value.
+		 * @param skip_out The distance to skip, if no template was evaluated (UINT_MAX if no
+		 *   template fits anymore).
+		 * @return Returns false, if no template was evaluated.
 		 */
-		double subtract_mean(TempImage_GS_BYTE_shptr img,
-		                     TempImage_GS_DOUBLE_shptr zero_mean_img) const;
-
-		/**
-		 * Calculate correlation between template and background.
-		 *
-		 * @param master The image where we look for matchings.
-		 * @param summation_table_single
-		 * @param summation_table_squared
-		 * @param zero_mean_template
-		 * @param sum_over_zero_mean_template
-		 * @param local_x Coordinate within \p master.
-		 * @param local_y Coordinate within \p master.
-		 */
-		double calc_single_xcorr(const TileImage_GS_BYTE_shptr master,
-		                         const TileImage_GS_DOUBLE_shptr summation_table_single,
-		                         const TileImage_GS_DOUBLE_shptr summation_table_squared,
-		                         const TempImage_GS_DOUBLE_shptr zero_mean_template,
-		                         double sum_over_zero_mean_template,
-		                         unsigned int local_x,
-		                         unsigned int local_y) const;
+		template <typename IntegralType>
+		bool match_templates_at(IntegralType const& master_scaled,
+		                        IntegralType const& master_normal,
+		                        std::vector<prepared_template>& templates,
+		                        std::vector<batch_entry>& batch,
+		                        unsigned int x, unsigned int y,
+		                        bool query_horizontal_distance,
+		                        std::list<match_found>& matches,
+		                        double* max_corr_out,
+		                        unsigned int* skip_out);
 
 
 		bool add_gate(unsigned int x, unsigned int y,
@@ -225,6 +235,76 @@ namespace degate
 
 	protected:
 
+		/**
+		 * Calculate correlation between template and background.
+		 *
+		 * @param master The image (with its summation tables) where we look for matchings,
+		 *   an IntegralImage or an IntegralBand.
+		 * @param offset_x Position of the search area within \p master.
+		 * @param offset_y Position of the search area within \p master.
+		 * @param tmpl_img The zero-mean template.
+		 * @param local_x Coordinate within the search area.
+		 * @param local_y Coordinate within the search area.
+		 */
+		template <typename IntegralType>
+		double calc_single_xcorr(IntegralType const& master,
+		                         unsigned int offset_x,
+		                         unsigned int offset_y,
+		                         const PreparedTemplateImage& tmpl_img,
+		                         unsigned int local_x,
+		                         unsigned int local_y) const;
+
+		/**
+		 * Calculate the correlation between several templates and the background at
+		 * the same position. The image rows are read once for all templates.
+		 * The results are the same as with calc_single_xcorr().
+		 * @param batch The templates. The correlation values are stored there.
+		 * @see calc_single_xcorr()
+		 */
+		template <typename IntegralType>
+		void calc_batched_xcorr(IntegralType const& master,
+		                        unsigned int offset_x,
+		                        unsigned int offset_y,
+		                        std::vector<batch_entry>& batch,
+		                        unsigned int local_x,
+		                        unsigned int local_y) const;
+
+		/**
+		 * Check if init() must prepare the summation tables of the whole background image.
+		 * Matching modes that compute their own summation tables per band return false.
+		 */
+		virtual bool needs_integral_images() const { return true; }
+
+		/**
+		 * Search all templates in all orientations.
+		 * @return Returns the matches, unsorted.
+		 */
+		virtual std::list<match_found> find_matches();
+
+		/**
+		 * Search all templates in all orientations at once. The background is scanned
+		 * line by line and at each position all templates are evaluated in one pass
+		 * (@see calc_batched_xcorr()).
+		 * @return Returns the matches, unsorted.
+		 */
+		std::list<match_found> find_matches_batched();
+
+		/**
+		 * Search all templates in all orientations along the lines of a grid.
+		 *
+		 * For each grid offset, the greyscale data and summation tables are computed only
+		 * for the band of the background image between the neighbouring grid offsets, that
+		 * templates placed at this offset and the hill climbing around them cover.
+		 * At each position along the band all templates are evaluated in one pass.
+		 *
+		 * @param grid The grid.
+		 * @param in_rows If true, templates are placed with their upper edge on the grid
+		 *   offsets and searched from left to right. Else they are placed with their left
+		 *   edge on the offsets and searched from top to bottom.
+		 * @return Returns the matches, unsorted.
+		 */
+		std::list<match_found> find_matches_along_grid(Grid_shptr grid, bool in_rows);
+
 		/**
 		 * Calculate the next position for a template to background matching.
 		 * @return Returns false if there is no further position.
@@ -297,6 +377,18 @@ namespace degate
 
 		void set_scaling_factor(unsigned int factor) { scale_down = factor; }
 
+		/**
+		 * Get the kernel for the correlation inner loop.
+		 */
+		CORRELATION_KERNEL get_correlation_kernel() const { return correlation_kernel; }
+
+		/**
+		 * Set the kernel for the correlation inner loop.
+		 * The default is the fastest kernel supported by the processor.
+		 * @exception std::invalid_argument Throws this exception, if the kernel is not supported.
+		 */
+		void set_correlation_kernel(CORRELATION_KERNEL kernel);
+
 
 		/**
 		 * Run the template matching.
@@ -351,17 +443,40 @@ namespace degate
 	 */
 	class TemplateMatchingNormal : public TemplateMatching
 	{
+	private:
+
+		bool batched;
+
 	protected:
 		bool get_next_pos(struct search_state* state,
 		                  struct prepared_template const& tmpl) const;
+
+		std::list<match_found> find_matches();
+
 	public:
-		TemplateMatchingNormal()
+		TemplateMatchingNormal() : batched(false)
 		{
 		}
 
 		~TemplateMatchingNormal()
 		{
 		}
+
+		/**
+		 * Enable or disable the batched evaluation, that scans the background once
+		 * for all templates (default: disabled). If disabled, the background is
+		 * scanned once per template and orientation.
+		 *
+		 * The batched scan adapts its step size to the best correlation of all
+		 * templates, so it visits other positions than the scan per template. Hill
+		 * climbing might then stop a pixel away from where it stops otherwise.
+		 */
+		void set_batched_evaluation(bool batched) { this->batched = batched; }
+
+		/**
+		 * Check if the batched evaluation is enabled.
+		 */
+		bool is_batched_evaluation() const { return batched; }
 	};
 
 	typedef std::shared_ptr<TemplateMatchingNormal> TemplateMatchingNormal_shptr;
@@ -373,8 +488,18 @@ namespace degate
 
 	class TemplateMatchingAlongGrid : public TemplateMatching
 	{
+	private:
+
+		bool sparse;
+
 	protected:
 
+		/**
+		 * Get the enabled grid, the regular grid is preferred.
+		 * @return Returns nullptr, if no grid is enabled.
+		 */
+		Grid_shptr get_grid(bool is_horizontal_grid) const;
+
 		bool initialize_state_struct(struct search_state* state,
 		                             int offs_min,
 		                             int offs_max,
@@ -383,11 +508,37 @@ namespace degate
 		virtual bool get_next_pos(struct search_state* state,
 		                          struct prepared_template const& tmpl) const = 0;
 
+		/**
+		 * Check if templates are placed on horizontal grid lines (rows).
+		 */
+		virtual bool is_matching_in_rows() const = 0;
+
+		bool needs_integral_images() const { return !sparse; }
+
+		std::list<match_found> find_matches();
+
 	public:
 
+		TemplateMatchingAlongGrid() : sparse(true)
+		{
+		}
+
 		virtual ~TemplateMatchingAlongGrid()
 		{
 		}
+
+		/**
+		 * Enable or disable the sparse evaluation, that computes summation tables only
+		 * for the grid bands and evaluates all templates at once (default: enabled).
+		 * If disabled, each template is searched on its own, using the summation
+		 * tables of the whole background image. Must be called before init().
+		 */
+		void set_sparse_evaluation(bool sparse) { this->sparse = sparse; }
+
+		/**
+		 * Check if the sparse evaluation is enabled.
+		 */
+		bool is_sparse_evaluation() const { return sparse; }
 	};
 
 
@@ -401,6 +552,7 @@ namespace degate
 		bool get_next_pos(struct search_state* state,
 		                  struct prepared_template const& tmpl) const;
 
+		bool is_matching_in_rows() const { return true; }
 
 	public:
 		TemplateMatchingInRows()
@@ -423,6 +575,9 @@ namespace degate
 
 		bool get_next_pos(struct search_state* state,
 		                  struct prepared_template const& tmpl) const;
+
+		bool is_matching_in_rows() const { return false; }
+
 	public:
 
 		TemplateMatchingInCols()
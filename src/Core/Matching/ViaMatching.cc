@@ -51,10 +51,11 @@ void ViaMatching::init(BoundingBox const& bounding_box, Project_shptr project)
 		throw DegateRuntimeException("No current layer in project.");
 
 
-	ScalingManager_shptr sm = layer->get_scaling_manager();
-	assert(sm != nullptr);
+	IntegralImageManager_shptr iim = layer->get_integral_image_manager();
+	assert(iim != nullptr);
 
-	img = sm->get_image(1).second;
+	// greyscale background image with its summation tables
+	img = iim->get_integral_image(1).second;
 	assert(img != nullptr);
 
 	reset_progress();
@@ -181,9 +182,9 @@ void ViaMatching::run()
 	if (via_down_gs) scan(bounding_box, img, via_down_gs, Via::DIRECTION_DOWN);
 }
 
-template <class BGImageType, class TemplateImageType>
+template <class TemplateImageType>
 double calc_xcorr(unsigned int start_x, unsigned int start_y,
-                  std::shared_ptr<BGImageType> bg_img, double f_avg, double sigma_f,
+                  IntegralImage_shptr bg_img, double f_avg, double sigma_f,
                   std::shared_ptr<TemplateImageType> tmpl_img, double t_avg, double sigma_t)
 {
 	double sum = 0;
@@ -191,9 +192,11 @@ double calc_xcorr(unsigned int start_x, unsigned int start_y,
 
 	for (unsigned int y = 0; y < tmpl_img->get_height(); y++)
 	{
+		const gs_byte_pixel_t* row = bg_img->get_row(start_x, start_y + y);
+
 		for (unsigned int x = 0; x < tmpl_img->get_width(); x++)
 		{
-			double f_xy = bg_img->template get_pixel_as<double>(start_x + x, start_y + y);
+			double f_xy = row[x];
 			double t_xy = tmpl_img->template get_pixel_as<double>(x, y);
 
 			sum += (f_xy - f_avg) * (t_xy - t_avg) / (sigma_f * sigma_t); // extract commons
@@ -233,7 +236,7 @@ bool ViaMatching::add_via(unsigned int x, unsigned int y,
 	return false;
 }
 
-void ViaMatching::scan(BoundingBox const& bbox, BackgroundImage_shptr bg_img,
+void ViaMatching::scan(BoundingBox const& bbox, IntegralImage_shptr bg_img,
                        MemoryImage_GS_BYTE_shptr tmpl_img, Via::DIRECTION direction)
 {
 	std::list<match_found> matches;
@@ -255,13 +258,17 @@ void ViaMatching::scan(BoundingBox const& bbox, BackgroundImage_shptr bg_img,
 		            ? bbox.get_max_y() - tmpl_img->get_height()
 		            : bbox.get_min_y();
 
+	// the template must be within the background image
+	max_x = std::min(max_x, static_cast<int>(bg_img->get_width()) - static_cast<int>(tmpl_img->get_width()) + 1);
+	max_y = std::min(max_y, static_cast<int>(bg_img->get_height()) - static_cast<int>(tmpl_img->get_height()) + 1);
+
 	for (int y = bbox.get_min_y(); y < max_y; y++)
 	{
 		for (int x = bbox.get_min_x(); x < max_x; x++)
 		{
-			average_and_stddev(bg_img, x, y,
-			                   tmpl_img->get_width(), tmpl_img->get_height(),
-			                   &f_avg, &sigma_f);
+			bg_img->get_average_and_stddev(x, y,
+			                               x + tmpl_img->get_width() - 1, y + tmpl_img->get_height() - 1,
+			                               &f_avg, &sigma_f);
 
 			double xcorr = calc_xcorr(x, y,
 			                          bg_img, f_avg, sigma_f,
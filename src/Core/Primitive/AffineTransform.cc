@@ -0,0 +1,112 @@
+/* -*-c++-*-
+
+ This file is part of the IC reverse engineering tool degate.
+
+ Copyright 2008, 2009, 2010 by Martin Schobert
+
+ Degate is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ any later version.
+
+ Degate is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "Globals.h"
+#include "AffineTransform.h"
+#include "Core/Utils/DegateExceptions.h"
+
+#include <cmath>
+#include <limits>
+#include <sstream>
+
+using namespace degate;
+
+AffineTransform::AffineTransform() : a(1), b(0), c(0), d(1), tx(0), ty(0)
+{
+}
+
+AffineTransform::AffineTransform(double a, double b, double c, double d, double tx, double ty) :
+	a(a), b(b), c(c), d(d), tx(tx), ty(ty)
+{
+}
+
+AffineTransform AffineTransform::translation(double tx, double ty)
+{
+	return AffineTransform(1, 0, 0, 1, tx, ty);
+}
+
+AffineTransform AffineTransform::rotation(double angle, double tx, double ty)
+{
+	return AffineTransform(cos(angle), -sin(angle), sin(angle), cos(angle), tx, ty);
+}
+
+bool AffineTransform::operator==(const AffineTransform& other) const
+{
+	return a == other.a && b == other.b && c == other.c && d == other.d && tx == other.tx && ty == other.ty;
+}
+
+bool AffineTransform::operator!=(const AffineTransform& other) const
+{
+	return !(*this == other);
+}
+
+AffineTransform AffineTransform::operator*(const AffineTransform& other) const
+{
+	return AffineTransform(a * other.a + b * other.c,
+	                       a * other.b + b * other.d,
+	                       c * other.a + d * other.c,
+	                       c * other.b + d * other.d,
+	                       a * other.tx + b * other.ty + tx,
+	                       c * other.tx + d * other.ty + ty);
+}
+
+bool AffineTransform::is_identity() const
+{
+	return *this == AffineTransform();
+}
+
+AffineTransform AffineTransform::inverse() const
+{
+	const double det = a * d - b * c;
+	if (std::fabs(det) < std::numeric_limits<double>::epsilon())
+		throw DegateRuntimeException("The affine transformation is not invertible.");
+
+	return AffineTransform(d / det, -b / det, -c / det, a / det,
+	                       (b * ty - d * tx) / det,
+	                       (c * tx - a * ty) / det);
+}
+
+AffineTransform AffineTransform::scaled(double scaling) const
+{
+	return AffineTransform(a, b, c, d, tx / scaling, ty / scaling);
+}
+
+std::string AffineTransform::to_string() const
+{
+	std::ostringstream stm;
+	stm.precision(std::numeric_limits<double>::max_digits10);
+	stm << a << " " << b << " " << c << " " << d << " " << tx << " " << ty;
+	return stm.str();
+}
+
+AffineTransform AffineTransform::from_string(std::string const& str)
+{
+	std::istringstream stm(str);
+
+	double v[6];
+	for (unsigned int i = 0; i < 6; i++)
+	{
+		if (!(stm >> v[i]))
+			throw DegateRuntimeException("Can't parse the affine transformation: " + str);
+	}
+
+	return AffineTransform(v[0], v[1], v[2], v[3], v[4], v[5]);
+}
@@ -0,0 +1,113 @@
+/* -*-c++-*-
+
+ This file is part of the IC reverse engineering tool degate.
+
+ Copyright 2008, 2009, 2010 by Martin Schobert
+
+ Degate is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ any later version.
+
+ Degate is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __AFFINETRANSFORM_H__
+#define __AFFINETRANSFORM_H__
+
+#include <string>
+
+namespace degate
+{
+	/**
+	 * A 2D affine transformation:
+	 *
+	 *   x' = a * x + b * y + tx
+	 *   y' = c * x + d * y + ty
+	 */
+	class AffineTransform
+	{
+	private:
+		double a, b, c, d, tx, ty;
+
+	public:
+
+		/**
+		 * Create the identity transformation.
+		 */
+		AffineTransform();
+
+		AffineTransform(double a, double b, double c, double d, double tx, double ty);
+
+		/**
+		 * Create a translation.
+		 */
+		static AffineTransform translation(double tx, double ty);
+
+		/**
+		 * Create a rotation by \p angle (in radian) around the origin, followed by a translation.
+		 */
+		static AffineTransform rotation(double angle, double tx = 0, double ty = 0);
+
+		bool operator==(const AffineTransform& other) const;
+		bool operator!=(const AffineTransform& other) const;
+
+		/**
+		 * Get the transformation that applies \p other first and then this one.
+		 */
+		AffineTransform operator*(const AffineTransform& other) const;
+
+		double get_a() const { return a; }
+		double get_b() const { return b; }
+		double get_c() const { return c; }
+		double get_d() const { return d; }
+		double get_tx() const { return tx; }
+		double get_ty() const { return ty; }
+
+		/**
+		 * Transform a point.
+		 */
+		inline void apply(double x, double y, double* x_out, double* y_out) const
+		{
+			*x_out = a * x + b * y + tx;
+			*y_out = c * x + d * y + ty;
+		}
+
+		/**
+		 * Check if this is the identity transformation.
+		 */
+		bool is_identity() const;
+
+		/**
+		 * Get the inverse transformation.
+		 * @exception DegateRuntimeException This exception is thrown, if the transformation is not invertible.
+		 */
+		AffineTransform inverse() const;
+
+		/**
+		 * Get the transformation for images that are scaled down by \p scaling.
+		 * The linear part is the same, the translation is divided by \p scaling.
+		 */
+		AffineTransform scaled(double scaling) const;
+
+		/**
+		 * Get the transformation as a string of the six parameters "a b c d tx ty".
+		 */
+		std::string to_string() const;
+
+		/**
+		 * Parse a transformation from a string, as written by to_string().
+		 * @exception DegateRuntimeException This exception is thrown, if the string can't be parsed.
+		 */
+		static AffineTransform from_string(std::string const& str);
+	};
+}
+
+#endif
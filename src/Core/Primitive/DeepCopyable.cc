@@ -27,26 +27,31 @@ namespace degate
 	DeepCopyable_shptr DeepCopyable::cloneDeep(oldnew_t* oldnew) const
 	{
 		auto _this = shared_from_this();
-		if (cloneOnce(_this, oldnew))
+
+		// Single lookup for the common case (already cloned via another path).
+		oldnew_t::const_iterator iter = oldnew->find(_this);
+		if (iter != oldnew->end())
 		{
-			cloneDeepInto((*oldnew)[_this], oldnew);
+			return iter->second;
 		}
-		return (*oldnew)[_this];
+
+		DeepCopyable_shptr clone = cloneShallow();
+		oldnew->emplace(_this, clone);
+		cloneDeepInto(clone, oldnew);
+
+		return clone;
 	}
 
-	bool DeepCopyable::cloneOnce(const c_DeepCopyable_shptr& o,
-	                             std::map<c_DeepCopyable_shptr, DeepCopyable_shptr>* __oldnew)
+	bool DeepCopyable::cloneOnce(const c_DeepCopyable_shptr& o, oldnew_t* oldnew)
 	{
 		assert(o.get() != nullptr);
 
-		std::map<c_DeepCopyable_shptr, DeepCopyable_shptr>& oldnew = *__oldnew;
-		if (oldnew.count(o) > 0)
+		if (oldnew->find(o) != oldnew->end())
 		{
 			return false;
 		}
 
-		DeepCopyable_shptr clone = o->cloneShallow();
-		oldnew[o] = clone;
+		oldnew->emplace(o, o->cloneShallow());
 		return true;
 	}
 }
@@ -21,8 +21,8 @@
 #ifndef DEEPCOPYABLE_H
 #define	DEEPCOPYABLE_H
 
-#include <map>
 #include <memory>
+#include <unordered_map>
 
 namespace degate
 {
@@ -33,7 +33,11 @@ namespace degate
 	class DeepCopyableBase
 	{
 	public:
-		typedef std::map<c_DeepCopyable_shptr, DeepCopyable_shptr> oldnew_t;
+		/**
+		 * Mapping from original objects to their clones. It is hashed because a deep-copy
+		 * of a whole project does one lookup per object, use reserve() before bulk clones.
+		 */
+		typedef std::unordered_map<c_DeepCopyable_shptr, DeepCopyable_shptr> oldnew_t;
 	protected:
 		/**
 		 * @brief Deep-copy all members to \a destination.
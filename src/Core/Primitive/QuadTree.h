@@ -145,6 +145,16 @@ namespace degate
 
 		ret_t insert(T object);
 
+		/**
+		 * Insert many objects into the quadtree at once.
+		 *
+		 * The result is the same tree as inserting the objects one by one, but each
+		 * node is split at most once and objects are distributed level by level,
+		 * instead of walking down from the root and reinserting on every split.
+		 */
+
+		ret_t bulk_insert(std::vector<T> objects);
+
 		/**
 		 * Remove an object from the quadtree.
 		 */
@@ -406,6 +416,55 @@ namespace degate
 		return RET_ERR;
 	}
 
+	template <typename T>
+	ret_t QuadTree<T>::bulk_insert(std::vector<T> objects)
+	{
+		ret_t ret;
+
+		if (objects.empty()) return RET_OK;
+
+		if (is_leave())
+		{
+			if (children.size() + objects.size() <= max_entries || !is_splitable())
+			{
+				children.insert(children.end(), objects.begin(), objects.end());
+				return RET_OK;
+			}
+
+			// Too many objects for a leave: split and distribute the old children too.
+			objects.insert(objects.end(), children.begin(), children.end());
+			children.clear();
+
+			if (RET_IS_NOT_OK(ret = split())) return ret;
+		}
+
+		std::vector<T> subtree_objects[4];
+
+		for (auto& object : objects)
+		{
+			const BoundingBox& bbox =
+				get_bbox_trait_selector<is_pointer<T>::value>::get_bounding_box_for_object(object);
+
+			unsigned int i = 0;
+			while (i < subtree_nodes.size() && !bbox.in_bounding_box(subtree_nodes[i].box)) i++;
+
+			if (i < subtree_nodes.size())
+				subtree_objects[i].push_back(std::move(object));
+			else
+				children.push_back(std::move(object));
+		}
+
+		objects.clear();
+		objects.shrink_to_fit();
+
+		for (unsigned int i = 0; i < subtree_nodes.size(); i++)
+		{
+			if (RET_IS_NOT_OK(ret = subtree_nodes[i].bulk_insert(std::move(subtree_objects[i])))) return ret;
+		}
+
+		return RET_OK;
+	}
+
 	template <typename T>
 	void QuadTree<T>::notify_shape_change(T object)
 	{
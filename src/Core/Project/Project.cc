@@ -37,7 +37,8 @@ using namespace degate;
 Project::Project(length_t width, length_t height) :
 	bounding_box(width, height),
 	logic_model(new LogicModel(width, height)),
-	port_color_manager(new PortColorManager())
+	port_color_manager(new PortColorManager()),
+	layer_loader(new LayerLoader())
 {
 	init_default_values();
 }
@@ -47,7 +48,8 @@ Project::Project(length_t width, length_t height, std::string const& _directory,
 	bounding_box(width, height),
 	directory(_directory),
 	logic_model(new LogicModel(width, height, layers)),
-	port_color_manager(new PortColorManager())
+	port_color_manager(new PortColorManager()),
+	layer_loader(new LayerLoader())
 {
 	init_default_values();
 }
@@ -65,6 +67,7 @@ DeepCopyable_shptr Project::cloneShallow() const
 	clone->irregular_vertical_grid.reset();
 	clone->logic_model.reset();
 	clone->port_color_manager.reset();
+	clone->layer_loader = std::make_shared<LayerLoader>();
 	return clone;
 }
 
@@ -82,6 +85,19 @@ void Project::cloneDeepInto(DeepCopyable_shptr destination, oldnew_t* oldnew) co
 	clone->port_color_manager = std::make_shared<PortColorManager>(*port_color_manager);
 }
 
+ProjectSnapshot_shptr Project::create_snapshot(std::string const& title, bool automatic) const
+{
+	oldnew_t oldnew;
+
+	ProjectSnapshot_shptr snapshot = std::make_shared<ProjectSnapshot>();
+	snapshot->datetime = boost::posix_time::second_clock::local_time();
+	snapshot->title = title;
+	snapshot->clone = std::dynamic_pointer_cast<Project>(cloneDeep(&oldnew));
+	snapshot->automatic = automatic;
+
+	return snapshot;
+}
+
 void Project::set_project_directory(std::string const& _directory)
 {
 	directory = _directory;
@@ -237,6 +253,11 @@ PortColorManager_shptr Project::get_port_color_manager()
 	return port_color_manager;
 }
 
+LayerLoader_shptr Project::get_layer_loader()
+{
+	return layer_loader;
+}
+
 void Project::print(std::ostream& os)
 {
 	os
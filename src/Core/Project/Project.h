@@ -26,6 +26,7 @@
 #include <Core/Primitive/DeepCopyable.h>
 #include <Globals.h>
 #include <Core/LogicModel/LogicModel.h>
+#include <Core/LogicModel/LayerLoader.h>
 #include <Core/Project/PortColorManager.h>
 #include <Core/RuleCheck/RCBase.h>
 
@@ -98,6 +99,8 @@ namespace degate
 
 		PortColorManager_shptr port_color_manager;
 
+		LayerLoader_shptr layer_loader;
+
 		default_colors_t default_colors;
 
 		double pixel_per_um;
@@ -138,6 +141,15 @@ namespace degate
 		void cloneDeepInto(DeepCopyable_shptr destination, oldnew_t* oldnew) const;
 		//@}
 
+		/**
+		 * Create an immutable snapshot of the project. The snapshot holds a deep copy of
+		 * the project, therefore it can be used (e.g. exported) from another thread
+		 * while the project itself is still edited.
+		 * @param title A title that describes the snapshot.
+		 * @param automatic Indicates whether the snapshot was not explicitly requested by the user.
+		 */
+		ProjectSnapshot_shptr create_snapshot(std::string const& title, bool automatic = false) const;
+
 		/**
 		 * Set the project directory.
 		 */
@@ -260,6 +272,13 @@ namespace degate
 
 		PortColorManager_shptr get_port_color_manager();
 
+		/**
+		 * Get the loader, that loads the layers of the project in the background.
+		 * It is started by the project importer.
+		 */
+
+		LayerLoader_shptr get_layer_loader();
+
 		/**
 		 * Dump basic meta data for the project as human readable text into an ostream.
 		 */
@@ -51,27 +51,46 @@ void ProjectExporter::export_all(std::string const& project_directory, Project_s
 	{
 		ObjectIDRewriter_shptr oid_rewriter(new ObjectIDRewriter(enable_oid_rewrite));
 
-		export_data(join_pathes(project_directory, project_file), prj);
+		// All files are written to temporary files first and are renamed when everything was
+		// exported. This way an interrupted export never leaves a half written project behind.
+		std::list<std::string> exported_files;
 
-		LogicModel_shptr lmodel = prj->get_logic_model();
+		std::string prj_filename(join_pathes(project_directory, project_file));
+		export_data(prj_filename + TEMP_EXPORT_SUFFIX, prj);
+		exported_files.push_back(prj_filename);
 
+		LogicModel_shptr lmodel = prj->get_logic_model();
 		if (lmodel != nullptr)
 		{
 			LogicModelExporter lm_exporter(oid_rewriter);
 			string lm_filename(join_pathes(project_directory, lmodel_file));
-			lm_exporter.export_data(lm_filename, lmodel);
 
+			lm_exporter.export_data(lm_filename + TEMP_EXPORT_SUFFIX, lmodel);
+			exported_files.push_back(lm_filename);
 
 			RCVBlacklistExporter rcv_exporter(oid_rewriter);
-			rcv_exporter.export_data(join_pathes(project_directory, rcbl_file), prj->get_rcv_blacklist());
+			string rcbl_filename(join_pathes(project_directory, rcbl_file));
+
+			rcv_exporter.export_data(rcbl_filename + TEMP_EXPORT_SUFFIX, prj->get_rcv_blacklist());
+			exported_files.push_back(rcbl_filename);
 
 			GateLibrary_shptr glib = lmodel->get_gate_library();
 			if (glib != nullptr)
 			{
 				GateLibraryExporter gl_exporter(oid_rewriter);
-				gl_exporter.export_data(join_pathes(project_directory, gatelib_file), glib);
+				gl_exporter.set_shared_images(shared_images);
+				string gl_filename(join_pathes(project_directory, gatelib_file));
+
+				gl_exporter.export_data(gl_filename + TEMP_EXPORT_SUFFIX, glib);
+				exported_files.push_back(gl_filename);
 			}
 		}
+
+		for (std::list<std::string>::const_iterator iter = exported_files.begin();
+		     iter != exported_files.end(); ++iter)
+		{
+			move_file(*iter + TEMP_EXPORT_SUFFIX, *iter);
+		}
 	}
 }
 
@@ -234,6 +253,10 @@ void ProjectExporter::add_layers(QDomDocument& doc,
 		layer_elem.setAttribute("description", QString::fromStdString(layer->get_description()));
 		layer_elem.setAttribute("enabled", QString::fromStdString(layer->is_enabled() ? "true" : "false"));
 
+		AffineTransform alignment = layer->get_alignment();
+		if (!alignment.is_identity())
+			layer_elem.setAttribute("alignment", QString::fromStdString(alignment.to_string()));
+
 		if (layer->has_background_image())
 			layer_elem.setAttribute("image-filename",
 			                        QString::fromStdString(
@@ -24,9 +24,17 @@
 
 #include <Core/XML/XMLExporter.h>
 #include <Core/Project/Project.h>
+#include <Core/LogicModel/Gate/GateTemplate.h>
 
 #include <stdexcept>
 
+/**
+ * Suffix of the temporary files, that are written during a project export.
+ *
+ * @see ProjectExporter::export_all
+ */
+#define TEMP_EXPORT_SUFFIX ".tmp"
+
 namespace degate
 {
 	/**
@@ -55,6 +63,8 @@ namespace degate
 
 		void add_colors(QDomDocument& doc, QDomElement& prj_elem, Project_shptr prj);
 
+		GateTemplate::image_load_list shared_images;
+
 	public:
 		ProjectExporter()
 		{
@@ -73,6 +83,11 @@ namespace degate
 		void export_data(std::string const& filename, Project_shptr prj);
 
 		/**
+		 * Export the project, the logic model, the rule check blacklist and the gate library.
+		 *
+		 * The files are replaced atomically: each file is written to a temporary file
+		 * first and all of them are renamed once the whole project was exported.
+		 *
 		 * @exception InvalidPathException
 		 * @exception InvalidPointerException
 		 * @exception std::runtime_error
@@ -84,6 +99,17 @@ namespace degate
 		                std::string const& lmodel_file = "lmodel.xml",
 		                std::string const& gatelib_file = "gate_library.xml",
 		                std::string const& rcbl_file = "rc_blacklist.xml");
+
+		/**
+		 * Set template images of another project, that might be backed by the image
+		 * files of the exported project, e.g. of the project a snapshot was taken from.
+		 *
+		 * @see GateLibraryExporter::set_shared_images
+		 */
+		void set_shared_images(GateTemplate::image_load_list const& images)
+		{
+			shared_images = images;
+		}
 	};
 }
 
@@ -100,6 +100,21 @@ Project_shptr ProjectImporter::import_all(std::string const& directory)
 				grab_template_images(lmodel, tmpl, bbox);
 			}
 		}
+		// Load the current layer now and all other layers in the background.
+		Layer_shptr current_layer = lmodel->get_current_layer();
+		if (current_layer != nullptr)
+			current_layer->load();
+
+		std::vector<Layer_shptr> layers;
+		if (current_layer != nullptr)
+			layers.push_back(current_layer);
+		for (LogicModel::layer_collection::iterator iter = lmodel->layers_begin();
+		     iter != lmodel->layers_end(); ++iter)
+			if (*iter != current_layer)
+				layers.push_back(*iter);
+
+		prj->get_layer_loader()->start(layers);
+
 		debug(TM, "Project loaded.");
 		//prj->print_all(cout);
 	}
@@ -192,6 +207,19 @@ void ProjectImporter::parse_layers_element(QDomElement const layers_elem, Projec
 			new_layer->set_description(layer_description);
 			new_layer->set_layer_id(layer_id);
 
+			const std::string alignment_str = layer_elem.attribute("alignment").toStdString();
+			if (!alignment_str.empty())
+			{
+				try
+				{
+					new_layer->set_alignment(AffineTransform::from_string(alignment_str));
+				}
+				catch (DegateRuntimeException const& ex)
+				{
+					throw XMLAttributeParseException(ex.what());
+				}
+			}
+
 			lmodel->add_layer(position, new_layer);
 
 			load_background_image(new_layer, image_filename, prj);
@@ -218,16 +246,8 @@ void ProjectImporter::load_background_image(Layer_shptr layer,
 
 			debug(TM, "project importer loads an tile based image from [%s]", image_path_to_load.c_str());
 
-			BackgroundImage_shptr bg_image =
-				load_degate_image<BackgroundImage>(prj->get_width(),
-				                                   prj->get_height(),
-				                                   image_path_to_load);
-
-			if (bg_image == nullptr)
-				throw DegateRuntimeException("Failed to load the background image");
-
-			debug(TM, "Loading done.");
-			layer->set_image(bg_image);
+			// The image is loaded on first access or by the layer loader.
+			layer->set_image_directory(image_path_to_load, prj->get_width(), prj->get_height());
 		}
 		else if (is_file(image_path_to_load))
 		{
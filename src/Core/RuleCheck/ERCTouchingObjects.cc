@@ -0,0 +1,86 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <Core/RuleCheck/RCBase.h>
+#include <Core/RuleCheck/ERCTouchingObjects.h>
+#include <Core/Utils/TangencyCheck.h>
+
+
+#include <memory>
+
+
+using namespace degate;
+
+ERCTouchingObjects::ERCTouchingObjects() :
+	RCBase("touching_objects", "Check for touching objects, that are not connected.", RC_WARNING)
+{
+}
+
+void ERCTouchingObjects::run(LogicModel_shptr lmodel)
+{
+	clear_rc_violations();
+
+	if (lmodel == nullptr) return;
+
+	// iterate over layers
+	debug(TM, "\tRC: iterate over layers.");
+
+	for (LogicModel::layer_collection::iterator l_iter = lmodel->layers_begin();
+	     l_iter != lmodel->layers_end(); ++l_iter)
+	{
+		Layer_shptr layer = *l_iter;
+
+		TangencyBatch batch;
+		std::vector<ConnectedLogicModelObject_shptr> objects;
+
+		for (Layer::object_iterator o_iter = layer->objects_begin();
+		     o_iter != layer->objects_end(); ++o_iter)
+		{
+			if (ConnectedLogicModelObject_shptr o = std::dynamic_pointer_cast<ConnectedLogicModelObject>(*o_iter))
+			{
+				batch.add_object(*o_iter);
+				objects.push_back(o);
+			}
+		}
+
+		for (auto const& p : batch.find_tangent_pairs())
+		{
+			ConnectedLogicModelObject_shptr o1 = objects[p.first], o2 = objects[p.second];
+
+			// Objects of the same net are connected.
+			if (o1->get_net() != nullptr && o1->get_net() == o2->get_net())
+				continue;
+
+			// The ports of a gate may touch each other, they belong to different nets.
+			GatePort_shptr port1 = std::dynamic_pointer_cast<GatePort>(o1);
+			GatePort_shptr port2 = std::dynamic_pointer_cast<GatePort>(o2);
+			if (port1 != nullptr && port2 != nullptr && port1->get_gate() == port2->get_gate())
+				continue;
+
+			boost::format f("Objects %1% and %2% touch each other, but are not connected.");
+			f % o1->get_descriptive_identifier() % o2->get_descriptive_identifier();
+
+			debug(TM, "\tRC: found a violation.");
+			add_rc_violation(std::make_shared<RCViolation>(o1, f.str(),
+			                                               get_rc_class_name()));
+		}
+	}
+}
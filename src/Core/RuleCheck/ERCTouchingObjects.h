@@ -0,0 +1,46 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __ERCTOUCHINGOBJECTS_H__
+#define __ERCTOUCHINGOBJECTS_H__
+
+#include <Core/RuleCheck/RCBase.h>
+#include <Core/LogicModel/LogicModel.h>
+
+namespace degate
+{
+	/**
+	 * Electrical Rule Check that detects objects on the same layer,
+	 * that touch each other, but are not electrically connected.
+	 * Touching ports of the same gate are expected and not reported.
+	 */
+
+	class ERCTouchingObjects : public RCBase
+	{
+	public:
+
+		ERCTouchingObjects();
+
+		void run(LogicModel_shptr lmodel);
+	};
+}
+
+#endif
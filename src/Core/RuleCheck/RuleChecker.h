@@ -25,6 +25,7 @@
 #include <Core/RuleCheck/RCBase.h>
 #include <Core/RuleCheck/ERCOpenPorts.h>
 #include <Core/RuleCheck/ERCNet.h>
+#include <Core/RuleCheck/ERCTouchingObjects.h>
 
 namespace degate
 {
@@ -40,6 +41,7 @@ namespace degate
 		{
 			checks.push_back(RCBase_shptr(new ERCOpenPorts()));
 			checks.push_back(RCBase_shptr(new ERCNet()));
+			checks.push_back(RCBase_shptr(new ERCTouchingObjects()));
 		}
 
 		void run(LogicModel_shptr lmodel)
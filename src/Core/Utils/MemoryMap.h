@@ -61,6 +61,7 @@ namespace degate
 		MAP_STORAGE_TYPE_MEM = 0,
 		MAP_STORAGE_TYPE_PERSISTENT_FILE = 1,
 		MAP_STORAGE_TYPE_TEMP_FILE = 2,
+		MAP_STORAGE_TYPE_VIEW = 3,
 	};
 
 
@@ -90,6 +91,9 @@ namespace degate
 		fd file;
 		T* mem_view;
 
+		// Keeps the memory of a view alive.
+		std::shared_ptr<void> view_owner;
+
 	private:
 		ret_t alloc_memory();
 		ret_t map_file(std::string const& filename);
@@ -133,6 +137,26 @@ namespace degate
 		MemoryMap(unsigned int width, unsigned int height,
 		          MAP_STORAGE_TYPE mode, std::string const& file_to_map);
 
+		/**
+		 * Create a view on memory that is owned by another object, for example
+		 * a part of a larger file mapping. The memory is not released by the view.
+		 * @param width The width of a 2D map.
+		 * @param height The height of a 2D map.
+		 * @param view The memory. It must hold at least width * height elements.
+		 * @param owner The owner of the memory. It is kept alive as long as the view exists.
+		 */
+		MemoryMap(unsigned int width, unsigned int height, T* view, std::shared_ptr<void> const& owner);
+
+		/**
+		 * Create a temporary memory chunk. It is stored in \p buffer, if the buffer is valid.
+		 * Else a temporary file is mapped into memory.
+		 * @param width The width of a 2D map.
+		 * @param height The height of a 2D map.
+		 * @param buffer The memory. It must hold at least width * height elements.
+		 *   The buffer is kept alive as long as the memory chunk exists.
+		 */
+		MemoryMap(unsigned int width, unsigned int height, std::shared_ptr<void> const& buffer);
+
 		/**
 		 * The destructor.
 		 */
@@ -165,12 +189,29 @@ namespace degate
 		 */
 		void raw_copy(void* buf) const;
 
+		/**
+		 * Copy \p n elements of row \p y, starting at column \p x, into a buffer.
+		 * Make sure that the buffer \p buf is large enough to hold n * sizeof(T) bytes.
+		 */
+		void raw_copy_row(void* buf, unsigned int x, unsigned int y, unsigned int n) const;
+
 		/**
 		 * Get the name of the mapped file.
 		 * @returns Returns a string with the mapped file. If the memory
 		 *   chunk is heap and not file based, an empty string is returned.
 		 */
 		std::string const& get_filename() const { return filename; }
+
+		/**
+		 * Get a pointer to the element at (x, y). Elements of a row are contiguous
+		 * and rows are stored one after another.
+		 */
+		inline T* get_pointer(unsigned int x, unsigned int y) const
+		{
+			assert(mem_view != nullptr);
+			assert(x < width && y < height);
+			return mem_view + (static_cast<size_t>(y) * width + x);
+		}
 	};
 
 	template <typename T>
@@ -229,11 +270,62 @@ namespace degate
 	}
 
 
+	template <typename T>
+	MemoryMap<T>::MemoryMap(unsigned int _width, unsigned int _height, T* view,
+	                        std::shared_ptr<void> const& owner) :
+		width(_width), height(_height),
+		storage_type(MAP_STORAGE_TYPE_VIEW),
+		filename(),
+		filesize(0),
+		mem_size(_width * _height * sizeof(T)),
+		file(0),
+#ifdef SYS_WINDOWS
+		mem_file(nullptr),
+#endif
+		mem_view(view),
+		view_owner(owner)
+	{
+		assert(width > 0 && height > 0);
+		assert(mem_view != nullptr);
+	}
+
+	template <typename T>
+	MemoryMap<T>::MemoryMap(unsigned int _width, unsigned int _height,
+	                        std::shared_ptr<void> const& buffer) :
+		width(_width), height(_height),
+		storage_type(buffer != nullptr ? MAP_STORAGE_TYPE_VIEW : MAP_STORAGE_TYPE_TEMP_FILE),
+		filename(),
+		filesize(0),
+		mem_size(_width * _height * sizeof(T)),
+		file(0),
+#ifdef SYS_WINDOWS
+		mem_file(nullptr),
+#endif
+		mem_view(static_cast<T*>(buffer.get())),
+		view_owner(buffer)
+	{
+		assert(width > 0 && height > 0);
+
+		if (is_temp_file())
+		{
+			// Random filename
+			std::string fn = get_temp_file_path();
+			ret_t ret = map_file(fn);
+			if (RET_IS_NOT_OK(ret)) debug(TM, "Can't open a temp file with pattern %s", fn.c_str());
+			assert(RET_IS_OK(ret));
+		}
+	}
+
 	template <typename T>
 	MemoryMap<T>::~MemoryMap()
 	{
 		switch (storage_type)
 		{
+		case MAP_STORAGE_TYPE_VIEW:
+
+			mem_view = nullptr;
+
+			break;
 		case MAP_STORAGE_TYPE_MEM:
 
 			if (mem_view != nullptr) free(mem_view);
@@ -462,6 +554,15 @@ namespace degate
 	}
 
 
+	template <typename T>
+	void MemoryMap<T>::raw_copy_row(void* buf, unsigned int x, unsigned int y, unsigned int n) const
+	{
+		assert(mem_view != nullptr);
+		assert(x + n <= width && y < height);
+		memcpy(buf, mem_view + (y * width + x), n * sizeof(T));
+	}
+
+
 	template <typename T>
 	void* MemoryMap<T>::get_void_ptr(unsigned int x, unsigned int y) const
 	{
@@ -0,0 +1,128 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __PARALLELFOR_H__
+#define __PARALLELFOR_H__
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+
+#include <boost/thread.hpp>
+
+namespace degate
+{
+	/**
+	 * Call \p func(i) for each i in [0, n) on up to \p threads threads.
+	 *
+	 * The threads, including the calling one, take chunks of \p items_per_task
+	 * consecutive items from a shared counter. If \p func throws, no further chunk
+	 * is started and the first exception is rethrown once all threads are done.
+	 *
+	 * @param threads The maximal number of threads, 0 means one per CPU core.
+	 */
+	template<typename F>
+	void parallel_for(size_t n, F const& func, unsigned int threads = 0, size_t items_per_task = 1)
+	{
+		if (n == 0)
+			return;
+
+		if (threads == 0)
+			threads = std::max(boost::thread::hardware_concurrency(), 1u);
+
+		items_per_task = std::max<size_t>(items_per_task, 1);
+		threads = static_cast<unsigned int>(std::min<size_t>(threads, (n + items_per_task - 1) / items_per_task));
+
+		std::atomic<size_t> next(0);
+		std::exception_ptr error;
+		boost::mutex error_mutex;
+
+		auto worker = [&]()
+		{
+			try
+			{
+				for (size_t begin = next.fetch_add(items_per_task); begin < n; begin = next.fetch_add(items_per_task))
+				{
+					const size_t end = std::min(n, begin + items_per_task);
+					for (size_t i = begin; i < end; i++)
+						func(i);
+				}
+			}
+			catch (...)
+			{
+				next = n;
+
+				boost::mutex::scoped_lock lock(error_mutex);
+				if (!error)
+					error = std::current_exception();
+			}
+		};
+
+		boost::thread_group group;
+		try
+		{
+			for (unsigned int i = 1; i < threads; i++)
+				group.create_thread(worker);
+		}
+		catch (...)
+		{
+			// The running threads reference this stack frame.
+			next = n;
+			group.join_all();
+			throw;
+		}
+
+		worker();
+		group.join_all();
+
+		if (error)
+			std::rethrow_exception(error);
+	}
+
+	/**
+	 * Split [0, n) in one range per thread and call \p func(from, to) for each range.
+	 *
+	 * Each range holds at least \p min_items_per_thread items (except if n is smaller).
+	 * Exceptions are handled as in parallel_for().
+	 *
+	 * @param threads The maximal number of threads, 0 means one per CPU core.
+	 */
+	template<typename F>
+	void parallel_for_ranges(size_t n, F const& func, size_t min_items_per_thread = 1, unsigned int threads = 0)
+	{
+		if (threads == 0)
+			threads = std::max(boost::thread::hardware_concurrency(), 1u);
+
+		const size_t ranges = std::max<size_t>(std::min<size_t>(threads, n / std::max<size_t>(min_items_per_thread, 1)), 1);
+		const size_t items_per_range = n / ranges;
+
+		parallel_for(ranges, [&](size_t range)
+		{
+			const size_t from = range * items_per_range;
+			const size_t to = range + 1 == ranges ? n : from + items_per_range;
+
+			func(from, to);
+		}, static_cast<unsigned int>(ranges));
+	}
+}
+
+#endif
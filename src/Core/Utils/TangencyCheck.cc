@@ -19,116 +19,136 @@
 
 */
 
+#include "Prerequisites.h"
 #include <Core/Utils/TangencyCheck.h>
 
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define TANGENCY_CHECK_X86
+#include <emmintrin.h>
+#endif
+
+#if defined(TANGENCY_CHECK_X86) && defined(COMP_GCC)
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#else
+#define TARGET_SSE2
+#endif
+
+using namespace degate;
+
+/**
+ * A line with its line function, as needed by the tangency checks.
+ */
+struct tangency_line
+{
+	float from_x, from_y, to_x, to_y;
+
+	// bounding box
+	float min_x, max_x, min_y, max_y;
+
+	// f(x) = m*x + n, if the line is not vertical
+	double m, n;
+	bool has_function;
+};
+
 /**
  * Calculate the parameter for a linear function f(x) = m*x + n.
  * @return Returns if the parameter can be calculated.
  */
-bool get_line_function_for_wire(degate::Line_shptr l, double* m, double* n)
+static bool get_line_function(float from_x, float from_y, float to_x, float to_y, double* m, double* n)
 {
-	assert(l != nullptr);
-	assert(m != nullptr);
-	assert(n != nullptr);
-
-	int d_y = l->get_to_y() - l->get_from_y();
-	int d_x = l->get_to_x() - l->get_from_x();
+	int d_y = to_y - from_y;
+	int d_x = to_x - from_x;
 
 	if (abs(d_x) == 0) return false;
 	else
 	{
 		*m = static_cast<double>(d_y) / static_cast<double>(d_x);
-		*n = l->get_from_y() - l->get_from_x() * *m;
+		*n = from_y - from_x * *m;
 		return true;
 	}
 }
 
+/**
+ * Calculate the parameter for a linear function f(x) = m*x + n.
+ * @return Returns if the parameter can be calculated.
+ */
+bool get_line_function_for_wire(degate::Line_shptr l, double* m, double* n)
+{
+	assert(l != nullptr);
+	assert(m != nullptr);
+	assert(n != nullptr);
+
+	return get_line_function(l->get_from_x(), l->get_from_y(), l->get_to_x(), l->get_to_y(), m, n);
+}
 
-bool degate::check_object_tangency(Circle_shptr o1,
-                                   Circle_shptr o2)
+static tangency_line make_tangency_line(Line_shptr l)
 {
-	int dx = o1->get_x() - o1->get_x();
-	int dy = o2->get_y() - o1->get_y();
-	return (sqrt(dx * dx + dy * dy) <= (o1->get_diameter() + o2->get_diameter()) / 2.0);
+	BoundingBox const& b = l->get_bounding_box();
+
+	tangency_line line = { l->get_from_x(), l->get_from_y(), l->get_to_x(), l->get_to_y(),
+	                       b.get_min_x(), b.get_max_x(), b.get_min_y(), b.get_max_y(),
+	                       0, 0, false };
+	line.has_function = get_line_function(line.from_x, line.from_y, line.to_x, line.to_y, &line.m, &line.n);
+
+	return line;
 }
 
-bool degate::check_object_tangency(Line_shptr o1,
-                                   Line_shptr o2)
+static bool check_circles_tangency(float x1, float y1, unsigned int diameter1,
+                                   float x2, float y2, unsigned int diameter2)
 {
-	double m1, n1, m2, n2;
-	bool ret1 = get_line_function_for_wire(o1, &m1, &n1);
-	bool ret2 = get_line_function_for_wire(o2, &m2, &n2);
+	int dx = x2 - x1;
+	int dy = y2 - y1;
+	return (sqrt(dx * dx + dy * dy) <= (diameter1 + diameter2) / 2.0);
+}
 
-	if (ret1 && ret2)
+static bool check_lines_tangency(tangency_line const& o1, tangency_line const& o2)
+{
+	if (o1.has_function && o2.has_function)
 	{
-		double xi = - (n1 - n2) / (m1 - m2);
-		double yi = n1 + m1 * xi;
+		double xi = - (o1.n - o2.n) / (o1.m - o2.m);
+		double yi = o1.n + o1.m * xi;
 
-		return ((o1->get_from_x() - xi) * (xi - o1->get_to_x()) >= 0 &&
-			(o2->get_from_x() - xi) * (xi - o2->get_to_x()) >= 0 &&
-			(o1->get_from_y() - yi) * (yi - o1->get_to_y()) >= 0 &&
-			(o2->get_from_y() - yi) * (yi - o2->get_to_y()) >= 0);
+		return ((o1.from_x - xi) * (xi - o1.to_x) >= 0 &&
+			(o2.from_x - xi) * (xi - o2.to_x) >= 0 &&
+			(o1.from_y - yi) * (yi - o1.to_y) >= 0 &&
+			(o2.from_y - yi) * (yi - o2.to_y) >= 0);
 	}
-	else if (!ret1 && !ret2)
+	else if (!o1.has_function && !o2.has_function)
 	{
-		return o1->get_from_x() == o2->get_from_x();
+		return o1.from_x == o2.from_x;
 	}
 	else
 	{
-		Line_shptr v = ret1 ? o2 : o1;
-		Line_shptr l = ret1 ? o1 : o2;
+		tangency_line const& v = o1.has_function ? o2 : o1;
+		tangency_line const& l = o1.has_function ? o1 : o2;
 
-		BoundingBox const& b = v->get_bounding_box();
-
-		if ((l->get_from_x() > b.get_max_x() &&
-				l->get_to_x() > b.get_max_x()) ||
+		if ((l.from_x > v.max_x &&
+				l.to_x > v.max_x) ||
 			// no intersection (line is to right of rectangle).
 
-			(l->get_from_x() > b.get_min_x() &&
-				l->get_to_x() > b.get_min_x()) ||
+			(l.from_x > v.min_x &&
+				l.to_x > v.min_x) ||
 			// no intersection (line is to left of rectangle).
 
-			(l->get_from_y() > b.get_min_y() &&
-				l->get_to_y() > b.get_min_y()) ||
+			(l.from_y > v.min_y &&
+				l.to_y > v.min_y) ||
 			// no intersection (line is above rectangle).
 
-			(l->get_from_y() > b.get_max_y() &&
-				l->get_to_y() > b.get_max_y())
+			(l.from_y > v.max_y &&
+				l.to_y > v.max_y)
 				//no intersection (line is below rectangle).
 		)
 			return false;
 		else
 			return true;
 	}
-
-	return false;
-}
-
-bool degate::check_object_tangency(Rectangle_shptr o1,
-                                   Rectangle_shptr o2)
-{
-	return o1->get_bounding_box().intersects(o2->get_bounding_box());
-}
-
-bool degate::check_object_tangency(Circle_shptr o1,
-                                   Line_shptr o2)
-{
-	BoundingBox const& b = o1->get_bounding_box();
-
-	Rectangle_shptr r(new Rectangle(b.get_min_x(), b.get_max_x(),
-	                                b.get_min_y(), b.get_max_y()));
-
-	return check_object_tangency(o2, r);
 }
 
-bool degate::check_object_tangency(Circle_shptr o1,
-                                   Rectangle_shptr o2)
-{
-	return o1->get_bounding_box().intersects(o2->get_bounding_box());
-}
-
-bool degate::check_object_tangency(Line_shptr l,
-                                   Rectangle_shptr r)
+static bool check_line_rectangle_tangency(float from_x, float from_y, float to_x, float to_y,
+                                          float min_x, float max_x, float min_y, float max_y)
 {
 	// http://stackoverflow.com/questions/99353/how-to-test-if-a-line-segment-intersects-an-axis-aligned-rectange-in-2d
 
@@ -137,19 +157,19 @@ bool degate::check_object_tangency(Line_shptr l,
 
 	int x1, x2, y1, y2;
 
-	if (l->get_from_x() < l->get_to_x())
+	if (from_x < to_x)
 	{
-		x1 = l->get_from_x();
-		y1 = l->get_from_y();
-		x2 = l->get_to_x();
-		y2 = l->get_to_y();
+		x1 = from_x;
+		y1 = from_y;
+		x2 = to_x;
+		y2 = to_y;
 	}
 	else
 	{
-		x2 = l->get_from_x();
-		y2 = l->get_from_y();
-		x1 = l->get_to_x();
-		y1 = l->get_to_y();
+		x2 = from_x;
+		y2 = from_y;
+		x1 = to_x;
+		y1 = to_y;
 	}
 
 	// F(x y) = (y2-y1)x + (x1-x2)y + (x2*y1-x1*y2)
@@ -160,13 +180,13 @@ bool degate::check_object_tangency(Line_shptr l,
 
 	// Calculate F(x,y) for each corner of the rectangle.
 	// If any of the values f[i] is 0, the corner is on the line.
-	int f1 = dy * r->get_min_x() + dx * r->get_min_y() + i;
+	int f1 = dy * min_x + dx * min_y + i;
 	if (f1 == 0) return true;
-	int f2 = dy * r->get_min_x() + dx * r->get_max_y() + i;
+	int f2 = dy * min_x + dx * max_y + i;
 	if (f2 == 0) return true;
-	int f3 = dy * r->get_max_x() + dx * r->get_min_y() + i;
+	int f3 = dy * max_x + dx * min_y + i;
 	if (f3 == 0) return true;
-	int f4 = dy * r->get_max_x() + dx * r->get_max_y() + i;
+	int f4 = dy * max_x + dx * max_y + i;
 	if (f4 == 0) return true;
 
 	/* If all corners are "below" or "above" the line, the
@@ -181,20 +201,20 @@ bool degate::check_object_tangency(Line_shptr l,
 	  Project the endpoint onto the x axis, and check if the
 	  segment's shadow intersects the polygon's shadow. Repeat on the y axis:
 	*/
-	if ((x1 > r->get_max_x() &&
-			x2 > r->get_max_x()) &&
+	if ((x1 > max_x &&
+			x2 > max_x) &&
 		// no intersection (line is to right of rectangle).
 
-		!(x1 > r->get_min_x() &&
-			x2 > r->get_min_x()) &&
+		!(x1 > min_x &&
+			x2 > min_x) &&
 		// no intersection (line is to left of rectangle).
 
-		!(y1 > r->get_max_y() &&
-			y2 > r->get_max_y()) &&
+		!(y1 > max_y &&
+			y2 > max_y) &&
 		// no intersection (line is above rectangle).
 
-		!(y1 < r->get_min_y() &&
-			y2 < r->get_min_y())
+		!(y1 < min_y &&
+			y2 < min_y)
 			//no intersection (line is below rectangle).
 	)
 	{
@@ -205,6 +225,48 @@ bool degate::check_object_tangency(Line_shptr l,
 		return true;
 }
 
+
+bool degate::check_object_tangency(Circle_shptr o1,
+                                   Circle_shptr o2)
+{
+	return check_circles_tangency(o1->get_x(), o1->get_y(), o1->get_diameter(),
+	                              o2->get_x(), o2->get_y(), o2->get_diameter());
+}
+
+bool degate::check_object_tangency(Line_shptr o1,
+                                   Line_shptr o2)
+{
+	return check_lines_tangency(make_tangency_line(o1), make_tangency_line(o2));
+}
+
+bool degate::check_object_tangency(Rectangle_shptr o1,
+                                   Rectangle_shptr o2)
+{
+	return o1->get_bounding_box().intersects(o2->get_bounding_box());
+}
+
+bool degate::check_object_tangency(Circle_shptr o1,
+                                   Line_shptr o2)
+{
+	BoundingBox const& b = o1->get_bounding_box();
+
+	return check_line_rectangle_tangency(o2->get_from_x(), o2->get_from_y(), o2->get_to_x(), o2->get_to_y(),
+	                                     b.get_min_x(), b.get_max_x(), b.get_min_y(), b.get_max_y());
+}
+
+bool degate::check_object_tangency(Circle_shptr o1,
+                                   Rectangle_shptr o2)
+{
+	return o1->get_bounding_box().intersects(o2->get_bounding_box());
+}
+
+bool degate::check_object_tangency(Line_shptr l,
+                                   Rectangle_shptr r)
+{
+	return check_line_rectangle_tangency(l->get_from_x(), l->get_from_y(), l->get_to_x(), l->get_to_y(),
+	                                     r->get_min_x(), r->get_max_x(), r->get_min_y(), r->get_max_y());
+}
+
 bool degate::check_object_tangency(PlacedLogicModelObject_shptr o1,
                                    PlacedLogicModelObject_shptr o2)
 {
@@ -228,11 +290,7 @@ bool degate::check_object_tangency(PlacedLogicModelObject_shptr o1,
 	if (c1 && c2)
 		return check_object_tangency(c1, c2);
 	else if (l1 && l2)
-	{
-		bool ret = check_object_tangency(l1, l2);
-		std::cout << "Check l1/l2: " << ret << std::endl;
-		return ret;
-	}
+		return check_object_tangency(l1, l2);
 	else if (r1 && r2)
 		return check_object_tangency(r1, r2);
 
@@ -253,4 +311,302 @@ bool degate::check_object_tangency(PlacedLogicModelObject_shptr o1,
 		return check_object_tangency(l2, r1);
 
 	assert(1==0);
+	return false;
+}
+
+
+/**
+ * Find the boxes in a range of boxes sorted by min_x, that intersect the box \p q.
+ * The scan stops at the first box that starts right of \p q.
+ */
+TARGET_SSE2 static void find_intersecting_boxes(const float* min_x, const float* max_x,
+                                                const float* min_y, const float* max_y,
+                                                unsigned int begin, unsigned int end,
+                                                float q_min_x, float q_max_x, float q_min_y, float q_max_y,
+                                                std::vector<unsigned int>& found)
+{
+	unsigned int i = begin;
+
+#ifdef TANGENCY_CHECK_X86
+	const __m128 q_min_x4 = _mm_set1_ps(q_min_x);
+	const __m128 q_max_x4 = _mm_set1_ps(q_max_x);
+	const __m128 q_min_y4 = _mm_set1_ps(q_min_y);
+	const __m128 q_max_y4 = _mm_set1_ps(q_max_y);
+
+	for (; i + 4 <= end; i += 4)
+	{
+		const __m128 starts_left = _mm_cmple_ps(_mm_loadu_ps(min_x + i), q_max_x4);
+
+		__m128 intersects = _mm_and_ps(starts_left, _mm_cmpge_ps(_mm_loadu_ps(max_x + i), q_min_x4));
+		intersects = _mm_and_ps(intersects, _mm_cmple_ps(_mm_loadu_ps(min_y + i), q_max_y4));
+		intersects = _mm_and_ps(intersects, _mm_cmpge_ps(_mm_loadu_ps(max_y + i), q_min_y4));
+
+		const int mask = _mm_movemask_ps(intersects);
+		for (unsigned int lane = 0; lane < 4; lane++)
+		{
+			if (mask & (1 << lane))
+				found.push_back(i + lane);
+		}
+
+		// sorted by min_x: all following boxes start right of q
+		if (_mm_movemask_ps(starts_left) != 0xf)
+			return;
+	}
+#endif
+
+	for (; i < end && min_x[i] <= q_max_x; i++)
+	{
+		if (max_x[i] >= q_min_x && min_y[i] <= q_max_y && max_y[i] >= q_min_y)
+			found.push_back(i);
+	}
+}
+
+unsigned int TangencyBatch::add_object(PlacedLogicModelObject_shptr object)
+{
+	if (object == nullptr)
+		throw InvalidPointerException("You passed an invalid shared pointer.");
+
+	const unsigned int index = objects.size();
+
+	if (Circle_shptr c = std::dynamic_pointer_cast<Circle>(object))
+	{
+		shapes.push_back(SHAPE_CIRCLE);
+		shape_indices.push_back(circle_x.size());
+
+		circle_x.push_back(c->get_x());
+		circle_y.push_back(c->get_y());
+		circle_diameter.push_back(c->get_diameter());
+	}
+	else if (Line_shptr l = std::dynamic_pointer_cast<Line>(object))
+	{
+		shapes.push_back(SHAPE_LINE);
+		shape_indices.push_back(line_from_x.size());
+
+		const tangency_line line = make_tangency_line(l);
+		line_from_x.push_back(line.from_x);
+		line_from_y.push_back(line.from_y);
+		line_to_x.push_back(line.to_x);
+		line_to_y.push_back(line.to_y);
+		line_m.push_back(line.m);
+		line_n.push_back(line.n);
+		line_has_function.push_back(line.has_function);
+	}
+	else if (Rectangle_shptr r = std::dynamic_pointer_cast<Rectangle>(object))
+	{
+		shapes.push_back(SHAPE_RECTANGLE);
+		shape_indices.push_back(rect_min_x.size());
+
+		rect_min_x.push_back(r->get_min_x());
+		rect_max_x.push_back(r->get_max_x());
+		rect_min_y.push_back(r->get_min_y());
+		rect_max_y.push_back(r->get_max_y());
+	}
+	else
+		throw DegateRuntimeException("Tangency checks are only possible for circles, lines and rectangles.");
+
+	BoundingBox const& bbox = object->get_bounding_box();
+	min_x.push_back(bbox.get_min_x());
+	max_x.push_back(bbox.get_max_x());
+	min_y.push_back(bbox.get_min_y());
+	max_y.push_back(bbox.get_max_y());
+
+	objects.push_back(object);
+
+	return index;
+}
+
+PlacedLogicModelObject_shptr TangencyBatch::get_object(unsigned int index) const
+{
+	assert(index < objects.size());
+	return objects[index];
+}
+
+unsigned int TangencyBatch::size() const
+{
+	return objects.size();
+}
+
+void TangencyBatch::reserve(unsigned int n)
+{
+	objects.reserve(n);
+	shapes.reserve(n);
+	shape_indices.reserve(n);
+	min_x.reserve(n);
+	max_x.reserve(n);
+	min_y.reserve(n);
+	max_y.reserve(n);
+}
+
+bool TangencyBatch::check_tangency(unsigned int index, TangencyBatch const& other, unsigned int other_index) const
+{
+	assert(index < objects.size());
+	assert(other_index < other.objects.size());
+
+	if (other.min_x[other_index] > max_x[index] ||
+		other.max_x[other_index] < min_x[index] ||
+		other.min_y[other_index] > max_y[index] ||
+		other.max_y[other_index] < min_y[index])
+		return false;
+
+	return check_shapes(index, other, other_index);
+}
+
+bool TangencyBatch::check_shapes(unsigned int index, TangencyBatch const& other, unsigned int other_index) const
+{
+	const unsigned int s1 = shape_indices[index];
+	const unsigned int s2 = other.shape_indices[other_index];
+
+	auto get_line = [](TangencyBatch const& batch, unsigned int object, unsigned int line)
+	{
+		tangency_line l = { batch.line_from_x[line], batch.line_from_y[line], batch.line_to_x[line], batch.line_to_y[line],
+		                    batch.min_x[object], batch.max_x[object], batch.min_y[object], batch.max_y[object],
+		                    batch.line_m[line], batch.line_n[line], batch.line_has_function[line] != 0 };
+		return l;
+	};
+
+	// Same rules as check_object_tangency(), the bounding boxes are known to intersect.
+	switch (shapes[index] * 3 + other.shapes[other_index])
+	{
+	case SHAPE_CIRCLE * 3 + SHAPE_CIRCLE:
+		return check_circles_tangency(circle_x[s1], circle_y[s1], circle_diameter[s1],
+		                              other.circle_x[s2], other.circle_y[s2], other.circle_diameter[s2]);
+
+	case SHAPE_LINE * 3 + SHAPE_LINE:
+		return check_lines_tangency(get_line(*this, index, s1), get_line(other, other_index, s2));
+
+	case SHAPE_CIRCLE * 3 + SHAPE_LINE:
+		return check_line_rectangle_tangency(other.line_from_x[s2], other.line_from_y[s2],
+		                                     other.line_to_x[s2], other.line_to_y[s2],
+		                                     min_x[index], max_x[index], min_y[index], max_y[index]);
+
+	case SHAPE_LINE * 3 + SHAPE_CIRCLE:
+		return check_line_rectangle_tangency(line_from_x[s1], line_from_y[s1], line_to_x[s1], line_to_y[s1],
+		                                     other.min_x[other_index], other.max_x[other_index],
+		                                     other.min_y[other_index], other.max_y[other_index]);
+
+	case SHAPE_LINE * 3 + SHAPE_RECTANGLE:
+		return check_line_rectangle_tangency(line_from_x[s1], line_from_y[s1], line_to_x[s1], line_to_y[s1],
+		                                     other.rect_min_x[s2], other.rect_max_x[s2],
+		                                     other.rect_min_y[s2], other.rect_max_y[s2]);
+
+	case SHAPE_RECTANGLE * 3 + SHAPE_LINE:
+		return check_line_rectangle_tangency(other.line_from_x[s2], other.line_from_y[s2],
+		                                     other.line_to_x[s2], other.line_to_y[s2],
+		                                     rect_min_x[s1], rect_max_x[s1], rect_min_y[s1], rect_max_y[s1]);
+
+	default:
+		// rectangles with rectangles or circles: the bounding boxes intersect
+		return true;
+	}
+}
+
+TangencyBatch::sorted_boxes TangencyBatch::sort_boxes() const
+{
+	sorted_boxes sorted;
+
+	sorted.index.resize(objects.size());
+	for (unsigned int i = 0; i < objects.size(); i++)
+		sorted.index[i] = i;
+
+	std::sort(sorted.index.begin(), sorted.index.end(), [&](unsigned int a, unsigned int b)
+	{
+		return min_x[a] < min_x[b] || (min_x[a] == min_x[b] && a < b);
+	});
+
+	sorted.min_x.reserve(objects.size());
+	sorted.max_x.reserve(objects.size());
+	sorted.min_y.reserve(objects.size());
+	sorted.max_y.reserve(objects.size());
+
+	for (auto i : sorted.index)
+	{
+		sorted.min_x.push_back(min_x[i]);
+		sorted.max_x.push_back(max_x[i]);
+		sorted.min_y.push_back(min_y[i]);
+		sorted.max_y.push_back(max_y[i]);
+	}
+
+	return sorted;
+}
+
+TangencyBatch::index_pair_collection TangencyBatch::find_tangent_pairs() const
+{
+	index_pair_collection pairs;
+
+	const sorted_boxes sorted = sort_boxes();
+	const unsigned int n = sorted.index.size();
+
+	std::vector<unsigned int> found;
+
+	for (unsigned int a = 0; a < n; a++)
+	{
+		found.clear();
+		find_intersecting_boxes(sorted.min_x.data(), sorted.max_x.data(), sorted.min_y.data(), sorted.max_y.data(),
+		                        a + 1, n,
+		                        sorted.min_x[a], sorted.max_x[a], sorted.min_y[a], sorted.max_y[a],
+		                        found);
+
+		for (auto b : found)
+		{
+			const unsigned int i = sorted.index[a], j = sorted.index[b];
+
+			if (check_shapes(i, *this, j))
+				pairs.push_back(std::make_pair(std::min(i, j), std::max(i, j)));
+		}
+	}
+
+	std::sort(pairs.begin(), pairs.end());
+	return pairs;
+}
+
+TangencyBatch::index_pair_collection TangencyBatch::find_tangent_pairs(TangencyBatch const& other) const
+{
+	index_pair_collection pairs;
+
+	const sorted_boxes sorted = sort_boxes();
+	const sorted_boxes other_sorted = other.sort_boxes();
+	const unsigned int n = sorted.index.size(), other_n = other_sorted.index.size();
+
+	std::vector<unsigned int> found;
+
+	// Pairs where the box of the other object starts at or right of the box of this object ...
+	for (unsigned int a = 0; a < n; a++)
+	{
+		const unsigned int begin = std::lower_bound(other_sorted.min_x.begin(), other_sorted.min_x.end(),
+		                                            sorted.min_x[a]) - other_sorted.min_x.begin();
+		found.clear();
+		find_intersecting_boxes(other_sorted.min_x.data(), other_sorted.max_x.data(),
+		                        other_sorted.min_y.data(), other_sorted.max_y.data(),
+		                        begin, other_n,
+		                        sorted.min_x[a], sorted.max_x[a], sorted.min_y[a], sorted.max_y[a],
+		                        found);
+
+		for (auto b : found)
+		{
+			if (check_shapes(sorted.index[a], other, other_sorted.index[b]))
+				pairs.push_back(std::make_pair(sorted.index[a], other_sorted.index[b]));
+		}
+	}
+
+	// ... and where it starts left of it.
+	for (unsigned int b = 0; b < other_n; b++)
+	{
+		const unsigned int begin = std::upper_bound(sorted.min_x.begin(), sorted.min_x.end(),
+		                                            other_sorted.min_x[b]) - sorted.min_x.begin();
+		found.clear();
+		find_intersecting_boxes(sorted.min_x.data(), sorted.max_x.data(), sorted.min_y.data(), sorted.max_y.data(),
+		                        begin, n,
+		                        other_sorted.min_x[b], other_sorted.max_x[b],
+		                        other_sorted.min_y[b], other_sorted.max_y[b],
+		                        found);
+
+		for (auto a : found)
+		{
+			if (check_shapes(sorted.index[a], other, other_sorted.index[b]))
+				pairs.push_back(std::make_pair(sorted.index[a], other_sorted.index[b]));
+		}
+	}
+
+	std::sort(pairs.begin(), pairs.end());
+	return pairs;
 }
@@ -0,0 +1,184 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <Core/Utils/TempStoragePool.h>
+#include <Core/Configuration.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+using namespace degate;
+
+TempStoragePool::state::~state()
+{
+	free_idle_memory(0);
+}
+
+void TempStoragePool::state::free_idle_memory(size_t keep)
+{
+	// Free the largest buffers first.
+	while (stats.idle_memory > keep && !idle.empty())
+	{
+		auto largest = std::prev(idle.end());
+
+		stats.idle_memory -= largest->first;
+		free(largest->second);
+		idle.erase(largest);
+	}
+}
+
+TempStoragePool::TempStoragePool() : s(std::make_shared<state>())
+{
+	Configuration& conf = Configuration::get_instance();
+	s->memory_budget = conf.get_max_temp_memory_size() * 1024 * 1024;
+	s->small_buffer_size = conf.get_small_temp_image_size() * 1024;
+
+	memset(&s->stats, 0, sizeof(statistics));
+}
+
+void TempStoragePool::release_buffer(std::shared_ptr<state> const& s, void* buffer, size_t size)
+{
+	boost::lock_guard<boost::mutex> lock(s->mutex);
+
+	s->stats.memory_in_use -= size;
+
+	if (s->stats.memory_in_use + s->stats.idle_memory + size <= s->memory_budget)
+	{
+		s->idle.insert(std::make_pair(size, buffer));
+		s->stats.idle_memory += size;
+	}
+	else
+		free(buffer);
+}
+
+std::shared_ptr<void> TempStoragePool::acquire(size_t size)
+{
+	if (size == 0) size = 1;
+
+	boost::lock_guard<boost::mutex> lock(s->mutex);
+
+	statistics& stats = s->stats;
+
+	if (size > s->small_buffer_size && stats.memory_in_use + size > s->memory_budget)
+	{
+		stats.temp_files_created++;
+		return std::shared_ptr<void>();
+	}
+
+	void* buffer = nullptr;
+	size_t buffer_size = size;
+
+	// Reuse an idle buffer, that is not much larger than requested.
+	auto found = s->idle.lower_bound(size);
+	if (found != s->idle.end() && found->first <= 2 * size)
+	{
+		buffer = found->second;
+		buffer_size = found->first;
+
+		stats.idle_memory -= buffer_size;
+		s->idle.erase(found);
+
+		memset(buffer, 0, size);
+		stats.reused_buffers++;
+	}
+	else
+	{
+		// Make room for the new buffer.
+		if (stats.memory_in_use + size <= s->memory_budget)
+			s->free_idle_memory(s->memory_budget - stats.memory_in_use - size);
+		else
+			s->free_idle_memory(0);
+
+		buffer = calloc(size, 1);
+		if (buffer == nullptr)
+		{
+			stats.temp_files_created++;
+			return std::shared_ptr<void>();
+		}
+	}
+
+	stats.memory_buffers++;
+	stats.memory_in_use += buffer_size;
+	stats.peak_memory_in_use = std::max(stats.peak_memory_in_use, stats.memory_in_use);
+
+	std::shared_ptr<state> pool_state = s;
+	return std::shared_ptr<void>(buffer, [pool_state, buffer_size](void* p)
+	{
+		release_buffer(pool_state, p, buffer_size);
+	});
+}
+
+void TempStoragePool::release_temp_file()
+{
+	boost::lock_guard<boost::mutex> lock(s->mutex);
+	s->stats.temp_files_removed++;
+}
+
+void TempStoragePool::set_memory_budget(size_t bytes)
+{
+	boost::lock_guard<boost::mutex> lock(s->mutex);
+
+	s->memory_budget = bytes;
+	s->free_idle_memory(bytes > s->stats.memory_in_use ? bytes - s->stats.memory_in_use : 0);
+}
+
+size_t TempStoragePool::get_memory_budget() const
+{
+	boost::lock_guard<boost::mutex> lock(s->mutex);
+	return s->memory_budget;
+}
+
+void TempStoragePool::set_small_buffer_size(size_t bytes)
+{
+	boost::lock_guard<boost::mutex> lock(s->mutex);
+	s->small_buffer_size = bytes;
+}
+
+size_t TempStoragePool::get_small_buffer_size() const
+{
+	boost::lock_guard<boost::mutex> lock(s->mutex);
+	return s->small_buffer_size;
+}
+
+void TempStoragePool::clear()
+{
+	boost::lock_guard<boost::mutex> lock(s->mutex);
+	s->free_idle_memory(0);
+}
+
+TempStoragePool::statistics TempStoragePool::get_statistics() const
+{
+	boost::lock_guard<boost::mutex> lock(s->mutex);
+	return s->stats;
+}
+
+void TempStoragePool::reset_statistics()
+{
+	boost::lock_guard<boost::mutex> lock(s->mutex);
+
+	statistics& stats = s->stats;
+	stats.memory_buffers = 0;
+	stats.reused_buffers = 0;
+	stats.temp_files_created = 0;
+	stats.temp_files_removed = 0;
+	stats.peak_memory_in_use = stats.memory_in_use;
+}
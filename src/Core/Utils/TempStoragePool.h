@@ -0,0 +1,146 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __TEMPSTORAGEPOOL_H__
+#define __TEMPSTORAGEPOOL_H__
+
+#include <Core/Primitive/SingletonBase.h>
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <boost/thread.hpp>
+
+namespace degate
+{
+	/**
+	 * Pool of memory buffers for temporary images.
+	 *
+	 * Temporary images are kept in memory, if they are small or if the memory budget
+	 * for temporary images allows it. Else they are stored in a temporary file. Released
+	 * buffers are kept for reuse, as long as they fit into the budget.
+	 *
+	 * The budget and the size of small images are set from the Configuration.
+	 *
+	 * This class is thread safe.
+	 */
+	class TempStoragePool : public SingletonBase<TempStoragePool>
+	{
+		friend class SingletonBase<TempStoragePool>;
+
+	public:
+
+		/**
+		 * Counters for the temporary storage.
+		 */
+		struct statistics
+		{
+			size_t memory_buffers;     /**< Number of images stored in memory. */
+			size_t reused_buffers;     /**< Number of images stored in a reused buffer. */
+			size_t temp_files_created; /**< Number of images stored in a temporary file. */
+			size_t temp_files_removed; /**< Number of temporary files that were removed. */
+			size_t memory_in_use;      /**< Memory in bytes that is used by images. */
+			size_t peak_memory_in_use; /**< Maximum of memory_in_use. */
+			size_t idle_memory;        /**< Memory in bytes that is kept for reuse. */
+		};
+
+	private:
+
+		struct state
+		{
+			boost::mutex mutex;
+
+			size_t memory_budget;
+			size_t small_buffer_size;
+
+			// idle buffers by size
+			std::multimap<size_t, void*> idle;
+
+			statistics stats;
+
+			~state();
+
+			void free_idle_memory(size_t keep);
+		};
+
+		std::shared_ptr<state> s;
+
+		TempStoragePool();
+
+		/**
+		 * Return a buffer to the pool.
+		 */
+		static void release_buffer(std::shared_ptr<state> const& s, void* buffer, size_t size);
+
+	public:
+
+		/**
+		 * Get a zeroed memory buffer for a temporary image.
+		 * @param size The size in bytes.
+		 * @return Returns the buffer. The buffer is returned to the pool, when the
+		 *   last reference is released. If the image should be stored in a temporary
+		 *   file, a null pointer is returned and the temporary file is counted.
+		 */
+		std::shared_ptr<void> acquire(size_t size);
+
+		/**
+		 * Count the removal of a temporary file of an image.
+		 */
+		void release_temp_file();
+
+		/**
+		 * Set the amount of memory in bytes for temporary images.
+		 */
+		void set_memory_budget(size_t bytes);
+
+		/**
+		 * Get the amount of memory in bytes for temporary images.
+		 */
+		size_t get_memory_budget() const;
+
+		/**
+		 * Set the size in bytes, up to which images are always kept in memory.
+		 */
+		void set_small_buffer_size(size_t bytes);
+
+		/**
+		 * Get the size in bytes, up to which images are always kept in memory.
+		 */
+		size_t get_small_buffer_size() const;
+
+		/**
+		 * Free all buffers that are kept for reuse.
+		 */
+		void clear();
+
+		/**
+		 * Get the counters.
+		 */
+		statistics get_statistics() const;
+
+		/**
+		 * Reset the counters, except the memory in use and idle memory.
+		 */
+		void reset_statistics();
+	};
+}
+
+#endif
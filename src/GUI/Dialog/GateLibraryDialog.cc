@@ -20,6 +20,7 @@
 */
 
 #include "GateLibraryDialog.h"
+#include <Core/Matching/PreparedTemplateCache.h>
 
 namespace degate
 {
@@ -103,6 +104,7 @@ namespace degate
 
             // Delete gate template
             project->get_logic_model()->remove_gate_template(e);
+            PreparedTemplateCache::get_instance().invalidate(e->get_object_id());
         }
 
         list.update_list();
@@ -21,9 +21,12 @@
 
 #include "MainWindow.h"
 #include <GUI/Dialog/ProgressDialog.h>
+#include <Core/Matching/PreparedTemplateCache.h>
 
 #include <memory>
 
+#include <QtConcurrent/QtConcurrent>
+
 #define SECOND(a) a * 1000
 
 namespace degate
@@ -164,6 +167,12 @@ namespace degate
 		background_import_action = layer_menu->addAction("");
 		QObject::connect(background_import_action, SIGNAL(triggered()), this, SLOT(on_menu_layer_import_background()));
 
+		background_mosaic_import_action = layer_menu->addAction("");
+		QObject::connect(background_mosaic_import_action, SIGNAL(triggered()), this, SLOT(on_menu_layer_import_background_mosaic()));
+
+		align_layers_action = layer_menu->addAction("");
+		QObject::connect(align_layers_action, SIGNAL(triggered()), this, SLOT(on_menu_layer_align()));
+
 
 		// Gate menu
 		gate_menu = menu_bar.addMenu("");
@@ -252,6 +261,9 @@ namespace degate
         update_status_bar_layer_info();
 
 		status_bar.addPermanentWidget(&status_bar_coords);
+
+		status_bar.addPermanentWidget(&status_bar_auto_save);
+		status_bar_auto_save.setVisible(false);
 		QObject::connect(workspace, SIGNAL(mouse_coords_changed(int, int)), this, SLOT(change_status_bar_coords(int, int)));
 
         update_status_bar_layer_info();
@@ -321,6 +333,7 @@ namespace degate
         auto_save_timer.start();
 
         QObject::connect(&auto_save_timer, SIGNAL(timeout()), this, SLOT(auto_save()));
+        QObject::connect(&auto_save_watcher, SIGNAL(finished()), this, SLOT(auto_save_finished()));
 	}
 
 	MainWindow::~MainWindow()
@@ -409,6 +422,8 @@ namespace degate
         layer_menu->setTitle(tr("Layer"));
         layers_edit_action->setText(tr("Edit layers"));
         background_import_action->setText(tr("Import background image"));
+        background_mosaic_import_action->setText(tr("Import background mosaic"));
+        align_layers_action->setText(tr("Align layers"));
 
         // Gate menu
         gate_menu->setTitle(tr("Gate"));
@@ -545,7 +560,12 @@ namespace degate
         }
 
 		if(project != nullptr)
+		{
+			auto_save_watcher.waitForFinished();
+
 			project.reset();
+			PreparedTemplateCache::get_instance().clear();
+		}
 
         try
         {
@@ -570,6 +590,9 @@ namespace degate
 		if(project == nullptr)
 			return;
 
+		// Never write the project files concurrently with a running auto save.
+		auto_save_watcher.waitForFinished();
+
 		status_bar.showMessage(tr("Saving project..."));
 
 		ProjectExporter exporter;
@@ -588,6 +611,8 @@ namespace degate
 		if(project == nullptr)
 			return;
 
+		auto_save_watcher.waitForFinished();
+
 		if(project->is_changed())
 		{
 			QMessageBox msgBox(this);
@@ -616,6 +641,9 @@ namespace degate
 		project.reset();
 		project = nullptr;
 		workspace->set_project(nullptr);
+
+		// The prepared images of the gate templates are not needed anymore.
+		PreparedTemplateCache::get_instance().clear();
 		workspace->update_screen();
 
         update_window_title();
@@ -663,6 +691,11 @@ namespace degate
                 if(!file_exists(project_dir))
                     create_directory(project_dir);
 
+                // A running auto save still writes the previous project.
+                auto_save_watcher.waitForFinished();
+
+                PreparedTemplateCache::get_instance().clear();
+
                 project = std::make_shared<Project>(width, height, project_dir, layer_count);
                 project->set_name(project_name);
 
@@ -759,6 +792,53 @@ namespace degate
         project_changed();
 	}
 
+	void MainWindow::on_menu_layer_import_background_mosaic()
+	{
+		if(project == nullptr)
+		{
+			status_bar.showMessage(tr("Failed to import new background mosaic : no project opened."), SECOND(DEFAULT_STATUS_MESSAGE_DURATION));
+			return;
+		}
+
+		status_bar.showMessage(tr("Importing a new background mosaic for the layer..."));
+
+		QString res = QFileDialog::getOpenFileName(this, tr("Select the frame grid file"));
+		const std::string file_name = res.toStdString();
+
+		if(res.isNull())
+        {
+            status_bar.showMessage(tr("New background mosaic import cancelled."), SECOND(DEFAULT_STATUS_MESSAGE_DURATION));
+            return;
+        }
+
+		load_background_mosaic(project->get_logic_model()->get_current_layer(), project->get_project_directory(), file_name);
+
+		workspace->update_screen();
+
+		status_bar.showMessage(tr("Imported a new background mosaic for the layer."), SECOND(DEFAULT_STATUS_MESSAGE_DURATION));
+
+        project_changed();
+	}
+
+	void MainWindow::on_menu_layer_align()
+	{
+		if(project == nullptr)
+		{
+			status_bar.showMessage(tr("Failed to align layers : no project opened."), SECOND(DEFAULT_STATUS_MESSAGE_DURATION));
+			return;
+		}
+
+		status_bar.showMessage(tr("Aligning layers..."));
+
+		align_layers(project->get_logic_model());
+
+		workspace->update_screen();
+
+		status_bar.showMessage(tr("Aligned layers."), SECOND(DEFAULT_STATUS_MESSAGE_DURATION));
+
+        project_changed();
+	}
+
 	void MainWindow::on_menu_gate_new_gate_template()
 	{
 		if(project == nullptr || !workspace->has_area_selection())
@@ -1168,6 +1248,9 @@ namespace degate
 
 	void MainWindow::open_project(const std::string& path)
 	{
+		// A running auto save still writes the previous project.
+		auto_save_watcher.waitForFinished();
+
 		status_bar.showMessage(tr("Importing project/subproject..."));
 
 		ProjectImporter projectImporter;
@@ -1479,7 +1562,80 @@ namespace degate
         {
             auto_save_timer.setInterval(PREFERENCES_HANDLER.get_preferences().auto_save_interval * 60000);
 
-            on_menu_project_save();
+            // The previous auto save is still running, skip this one.
+            if (auto_save_watcher.isRunning())
+                return;
+
+            status_bar_auto_save.setText(tr("Auto saving..."));
+            status_bar_auto_save.setVisible(true);
+
+            // The snapshot is an independent copy of the project, it is exported on a worker
+            // thread while the project can still be edited.
+            ProjectSnapshot_shptr snapshot = project->create_snapshot("Auto save", true);
+            std::string project_directory = project->get_project_directory();
+
+            // The template images of the project can still be backed by the files the snapshot
+            // overwrites, the export decodes them first.
+            GateTemplate::image_load_list project_images;
+            GateLibrary_shptr gate_lib = project->get_logic_model()->get_gate_library();
+            for (auto iter = gate_lib->begin(); iter != gate_lib->end(); ++iter)
+            {
+                for (auto img_iter = iter->second->images_begin(); img_iter != iter->second->images_end(); ++img_iter)
+                    project_images.push_back(std::make_pair(iter->second, img_iter->first));
+            }
+
+            auto_save_project = project;
+            auto_save_snapshot = snapshot;
+
+            project->set_changed(false);
+            update_window_title();
+
+            auto_save_watcher.setFuture(QtConcurrent::run([snapshot, project_directory, project_images]() -> bool
+            {
+                try
+                {
+                    ProjectExporter exporter;
+                    exporter.set_shared_images(project_images);
+                    exporter.export_all(project_directory, snapshot->clone);
+                }
+                catch (std::exception const& ex)
+                {
+                    debug(TM, "Auto save failed: %s", ex.what());
+                    return false;
+                }
+
+                return true;
+            }));
+        }
+    }
+
+    void MainWindow::auto_save_finished()
+    {
+        status_bar_auto_save.setVisible(false);
+
+        ProjectSnapshot_shptr snapshot = auto_save_snapshot;
+        auto_save_snapshot.reset();
+
+        if (auto_save_watcher.result())
+        {
+            // The template images were saved for the snapshot, the project can reuse the files.
+            if (project != nullptr && auto_save_project.lock() == project && snapshot != nullptr)
+            {
+                project->get_logic_model()->get_gate_library()->copy_saved_images(
+                    *snapshot->clone->get_logic_model()->get_gate_library());
+            }
+
+            status_bar.showMessage(tr("Project auto saved."), SECOND(DEFAULT_STATUS_MESSAGE_DURATION));
+            return;
+        }
+
+        status_bar.showMessage(tr("Auto save failed."), SECOND(DEFAULT_STATUS_MESSAGE_DURATION));
+
+        // The changes of the snapshot were not saved, the project is still modified.
+        if (project != nullptr && auto_save_project.lock() == project)
+        {
+            project->set_changed(true);
+            update_window_title();
         }
     }
 }
@@ -46,6 +46,7 @@
 #include <QMessageBox>
 #include <QFileDialog>
 #include <QToolBar>
+#include <QFutureWatcher>
 
 /**
  * This define the default status message duration for the status bar.
@@ -160,6 +161,17 @@ namespace degate
 		 */
 		void on_menu_layer_import_background();
 
+		/**
+		 * Stitch a grid of microscope frames into a new background image for the current layer
+		 * (this open a new window to select the frame grid file, @see load_background_mosaic()).
+		 */
+		void on_menu_layer_import_background_mosaic();
+
+		/**
+		 * Align the background images of all layers to each other (@see align_layers()).
+		 */
+		void on_menu_layer_align();
+
 
 		/* Gate menu */
 		
@@ -320,12 +332,18 @@ namespace degate
          */
         void auto_save();
 
+        /**
+         * Called when the background auto save finished (linked to the auto_save_watcher).
+         */
+        void auto_save_finished();
+
 	private:
 		QMenuBar menu_bar;
 		QToolBar* tool_bar = nullptr;
 		QStatusBar status_bar;
 		QLabel status_bar_coords;
 		QLabel status_bar_layer;
+		QLabel status_bar_auto_save;
 
 		QActionGroup tools_group;
 
@@ -371,6 +389,8 @@ namespace degate
         QMenu* layer_menu;
         QAction* layers_edit_action;
         QAction* background_import_action;
+        QAction* background_mosaic_import_action;
+        QAction* align_layers_action;
 
         // Gate menu
         QMenu* gate_menu;
@@ -420,6 +440,11 @@ namespace degate
 
         // QTimer for auto save
         QTimer auto_save_timer;
+
+        // Auto save runs on a worker thread, the watcher signals its end
+        QFutureWatcher<bool> auto_save_watcher;
+        std::weak_ptr<Project> auto_save_project;
+        ProjectSnapshot_shptr auto_save_snapshot;
 	};
 }
 
@@ -27,6 +27,8 @@
 
 #include <iostream>
 #include <QtConcurrent/QtConcurrent>
+#include <QSaveFile>
+#include <QDataStream>
 
 namespace degate
 {
@@ -131,93 +133,125 @@ namespace degate
     {
         assert(font_context_data != nullptr);
 
-        static unsigned int atlas_count = font_context_data->font_data->font_atlas.size();
+        const std::shared_ptr<FontData>& font_data = font_context_data->font_data;
+        const unsigned int atlas_count = font_data->font_atlas.size();
+        const unsigned int glyph_count = font_data->glyphs.size();
 
-        // If there is no new atlas since last time just add the last glyph (last generated/loaded) to the texture array.
-        if(full_reload == false && atlas_count == font_context_data->font_data->font_atlas.size() && context->functions()->glIsTexture(font_context_data->font_atlas_texture_array) == GL_TRUE)
+        // The texture array needs to be (re)allocated only if the atlas pages don't fit in it anymore.
+        const bool reallocate = full_reload ||
+                                context->functions()->glIsTexture(font_context_data->font_atlas_texture_array) != GL_TRUE ||
+                                atlas_count > font_context_data->atlas_capacity;
+
+        if(reallocate)
         {
-            std::shared_ptr<GlyphData> glyph_data = font_context_data->font_data->glyphs.back();
-            auto atlas = font_context_data->font_data->font_atlas.back();
+            if(context->functions()->glIsTexture(font_context_data->font_atlas_texture_array) == GL_TRUE)
+                context->functions()->glDeleteTextures(1, &font_context_data->font_atlas_texture_array);
 
-            this->context->functions()->glBindTexture(GL_TEXTURE_2D_ARRAY, font_context_data->font_atlas_texture_array);
+            GLuint texture_array_id;
+            this->context->functions()->glGenTextures(1, &texture_array_id);
             assert(this->context->functions()->glGetError() == GL_NO_ERROR);
 
-            this->context->extraFunctions()->glTexSubImage3D(GL_TEXTURE_2D_ARRAY,
-                                                             0,
-                                                             (glyph_data->atlas_position % font_context_data->font_data->atlas_glyph_per_line) * font_context_data->font_data->glyph_width,
-                                                             (glyph_data->atlas_position / font_context_data->font_data->atlas_glyph_per_line) * font_context_data->font_data->glyph_height,
-                                                             atlas_count - 1,
-                                                             font_context_data->font_data->last_generated_glyph_image->width(), font_context_data->font_data->last_generated_glyph_image->height(),
-                                                             1,
-                                                             GL_RGBA,
-                                                             GL_UNSIGNED_BYTE,
-                                                             font_context_data->font_data->last_generated_glyph_image->constBits());
+            this->context->functions()->glBindTexture(GL_TEXTURE_2D_ARRAY, texture_array_id);
+            assert(this->context->functions()->glGetError() == GL_NO_ERROR);
+
+            // Create storage for all font atlas (plus some spare layers for the next atlas pages)
+            const unsigned int capacity = atlas_count + FONT_ATLAS_SPARE_PAGES;
+            this->context->extraFunctions()->glTexImage3D(GL_TEXTURE_2D_ARRAY,
+                                                          0,
+                                                          GL_RGBA,
+                                                          font_data->atlas_width, font_data->atlas_height,
+                                                          capacity,
+                                                          0,
+                                                          GL_RGBA,
+                                                          GL_UNSIGNED_BYTE,
+                                                          nullptr);
 
             assert(this->context->functions()->glGetError() == GL_NO_ERROR);
 
-            this->context->functions()->glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+            this->context->functions()->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_GENERATE_MIPMAP, GL_TRUE);
+            assert(this->context->functions()->glGetError() == GL_NO_ERROR);
 
-            return;
+            this->context->functions()->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            assert(this->context->functions()->glGetError() == GL_NO_ERROR);
+
+            this->context->functions()->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            assert(this->context->functions()->glGetError() == GL_NO_ERROR);
+
+            this->context->functions()->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            assert(this->context->functions()->glGetError() == GL_NO_ERROR);
+
+            this->context->functions()->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            assert(this->context->functions()->glGetError() == GL_NO_ERROR);
+
+            font_context_data->font_atlas_texture_array = texture_array_id;
+            font_context_data->atlas_capacity = capacity;
+            font_context_data->uploaded_atlas_count = 0;
+            font_context_data->uploaded_glyph_count = 0;
+        }
+        else
+        {
+            this->context->functions()->glBindTexture(GL_TEXTURE_2D_ARRAY, font_context_data->font_atlas_texture_array);
+            assert(this->context->functions()->glGetError() == GL_NO_ERROR);
         }
 
-        atlas_count = font_context_data->font_data->font_atlas.size();
+        // Upload only the cells of the new glyphs that belong to an atlas page already in the texture array.
+        // Rows are read directly from the atlas image (no copy), using the atlas width as row length.
+        this->context->functions()->glPixelStorei(GL_UNPACK_ROW_LENGTH, font_data->atlas_width);
 
-        if(context->functions()->glIsTexture(font_context_data->font_atlas_texture_array) == GL_TRUE)
-            context->functions()->glDeleteTextures(1, &font_context_data->font_atlas_texture_array);
+        for(unsigned int i = font_context_data->uploaded_glyph_count; i < glyph_count; i++)
+        {
+            const std::shared_ptr<GlyphData>& glyph_data = font_data->glyphs.at(i);
 
-        GLuint texture_array_id;
-        this->context->functions()->glGenTextures(1, &texture_array_id);
-        assert(this->context->functions()->glGetError() == GL_NO_ERROR);
+            // The whole atlas page will be uploaded below.
+            if(glyph_data->atlas_index >= font_context_data->uploaded_atlas_count)
+                continue;
 
-        this->context->functions()->glBindTexture(GL_TEXTURE_2D_ARRAY, texture_array_id);
-        assert(this->context->functions()->glGetError() == GL_NO_ERROR);
+            const unsigned int column = glyph_data->atlas_position % font_data->atlas_glyph_per_line;
+            const unsigned int row = glyph_data->atlas_position / font_data->atlas_glyph_per_line;
 
-        // Create storage for all font atlas
-        this->context->extraFunctions()->glTexImage3D(GL_TEXTURE_2D_ARRAY,
-                                                      0,
-                                                      GL_RGBA,
-                                                      font_context_data->font_data->atlas_width, font_context_data->font_data->atlas_height,
-                                                      font_context_data->font_data->font_atlas.size(),
-                                                      0,
-                                                      GL_RGBA,
-                                                      GL_UNSIGNED_BYTE,
-                                                      nullptr);
+            const int x_min = static_cast<int>(std::floor(column * font_data->glyph_width));
+            const int y_min = static_cast<int>(std::floor(row * font_data->glyph_height));
+            const int x_max = std::min(static_cast<int>(std::ceil((column + 1) * font_data->glyph_width)), static_cast<int>(font_data->atlas_width));
+            const int y_max = std::min(static_cast<int>(std::ceil((row + 1) * font_data->glyph_height)), static_cast<int>(font_data->atlas_height));
 
-        assert(this->context->functions()->glGetError() == GL_NO_ERROR);
+            if(x_max <= x_min || y_max <= y_min)
+                continue;
+
+            const QImage& atlas = *font_data->font_atlas.at(glyph_data->atlas_index);
 
-        // Fill the storage with all font atlas
-        for(unsigned int i = 0; i < font_context_data->font_data->font_atlas.size(); i++)
-        {
             this->context->extraFunctions()->glTexSubImage3D(GL_TEXTURE_2D_ARRAY,
                                                              0,
-                                                             0, 0, i,
-                                                             font_context_data->font_data->atlas_width, font_context_data->font_data->atlas_height,
+                                                             x_min, y_min, glyph_data->atlas_index,
+                                                             x_max - x_min, y_max - y_min,
                                                              1,
                                                              GL_RGBA,
                                                              GL_UNSIGNED_BYTE,
-                                                             font_context_data->font_data->font_atlas.at(i)->constBits());
+                                                             atlas.constScanLine(y_min) + x_min * 4);
 
             assert(this->context->functions()->glGetError() == GL_NO_ERROR);
         }
 
-        this->context->functions()->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_GENERATE_MIPMAP, GL_TRUE);
-        assert(this->context->functions()->glGetError() == GL_NO_ERROR);
-
-        this->context->functions()->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        assert(this->context->functions()->glGetError() == GL_NO_ERROR);
+        this->context->functions()->glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
 
-        this->context->functions()->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        assert(this->context->functions()->glGetError() == GL_NO_ERROR);
-
-        this->context->functions()->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        assert(this->context->functions()->glGetError() == GL_NO_ERROR);
+        // Upload the new atlas pages
+        for(unsigned int i = font_context_data->uploaded_atlas_count; i < atlas_count; i++)
+        {
+            this->context->extraFunctions()->glTexSubImage3D(GL_TEXTURE_2D_ARRAY,
+                                                             0,
+                                                             0, 0, i,
+                                                             font_data->atlas_width, font_data->atlas_height,
+                                                             1,
+                                                             GL_RGBA,
+                                                             GL_UNSIGNED_BYTE,
+                                                             font_data->font_atlas.at(i)->constBits());
 
-        this->context->functions()->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        assert(this->context->functions()->glGetError() == GL_NO_ERROR);
+            assert(this->context->functions()->glGetError() == GL_NO_ERROR);
+        }
 
         this->context->functions()->glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
 
-        font_context_data->font_atlas_texture_array = texture_array_id;
+        font_context_data->uploaded_atlas_count = atlas_count;
+        font_context_data->uploaded_glyph_count = glyph_count;
     }
 
     void Text::init_context(QOpenGLContext *context)
@@ -274,21 +308,64 @@ namespace degate
     }
 
     std::shared_ptr<GlyphData> Text::generate_glyph(const std::shared_ptr<FontData>& font_data, const Glyph& glyph)
+    {
+        return add_glyph(font_data, render_glyph(font_data->font, font_data->spread, font_data->scale, font_data->padding, glyph));
+    }
+
+    PreparedGlyph Text::render_glyph(const Font& font, float spread, float scale, float padding, const Glyph& glyph)
     {
         // Font
-        QFont qt_font(QString::fromStdString(font_data->font.font_family_name), font_data->font.font_size);
+        QFont qt_font(QString::fromStdString(font.font_family_name), font.font_size);
         qt_font.setStyleStrategy(QFont::NoAntialias);
 
         QFontMetricsF font_metrics(qt_font);
 
+        PreparedGlyph res;
+        res.glyph = glyph;
+        res.char_advance = font_metrics.horizontalAdvance(glyph);
+        res.char_width = font_metrics.boundingRect(glyph).width();
+
+        // Distance field generator
+        DistanceFieldGenerator dfg(spread * scale, scale);
+
+        // Scaled font
+        QFont scaled_font(QString::fromStdString(font.font_family_name), font.font_size * scale);
+        scaled_font.setStyleStrategy(QFont::NoAntialias);
+        QFontMetricsF scaled_font_metric(scaled_font);
+
+        // Glyph image
+        QImage temp_glyph_image(std::ceil(scaled_font_metric.maxWidth() + padding * 2.0 * scale), std::ceil(scaled_font_metric.height() + padding * 2.0 * scale), QImage::Format_ARGB32);
+
+        // Glyph painter
+        QPainter glyph_painter(&temp_glyph_image);
+        glyph_painter.setBackgroundMode(Qt::TransparentMode);
+        glyph_painter.setCompositionMode (QPainter::CompositionMode_Source);
+        glyph_painter.setPen(qRgba(0, 0, 0, 0));
+        glyph_painter.fillRect(0, 0, temp_glyph_image.width(), temp_glyph_image.height(), Qt::transparent);
+        glyph_painter.setCompositionMode (QPainter::CompositionMode_SourceOver);
+        glyph_painter.setPen(qRgba(255, 255, 255, 255));
+        glyph_painter.setFont(scaled_font);
+
+        // Glyph draw
+        glyph_painter.drawText(QPointF(padding * scale, scaled_font_metric.ascent() + padding * scale), glyph);
+        glyph_painter.end();
+
+        // Distance field conversion
+        res.image = dfg.generate_distance_field(temp_glyph_image);
+
+        return res;
+    }
+
+    std::shared_ptr<GlyphData> Text::add_glyph(const std::shared_ptr<FontData>& font_data, const PreparedGlyph& prepared_glyph)
+    {
         auto glyph_data = std::make_shared<GlyphData>();
         font_data->glyphs.push_back(glyph_data);
 
-        glyph_data->glyph = glyph;
+        glyph_data->glyph = prepared_glyph.glyph;
         glyph_data->atlas_position = (font_data->glyphs.size() - 1) % font_data->glyph_per_atlas;
         glyph_data->atlas_index = (font_data->glyphs.size() - 1) / font_data->glyph_per_atlas;
-        glyph_data->char_advance = font_metrics.horizontalAdvance(glyph);
-        glyph_data->char_width = font_metrics.boundingRect(glyph).width();
+        glyph_data->char_advance = prepared_glyph.char_advance;
+        glyph_data->char_width = prepared_glyph.char_width;
 
         // Font image
         std::shared_ptr<QImage> font_image;
@@ -314,57 +391,99 @@ namespace degate
         QPainter painter(font_image.get());
         painter.setBackgroundMode(Qt::TransparentMode);
         painter.setCompositionMode (QPainter::CompositionMode_SourceOver);
-        painter.setPen(qRgba(255, 255, 255, 255));
-        painter.setFont(qt_font);
 
-        // Distance field generator
-        DistanceFieldGenerator dfg(font_data->spread * font_data->scale, font_data->scale);
+        painter.drawImage(QPointF((glyph_data->atlas_position % font_data->atlas_glyph_per_line) * (font_data->glyph_width), (glyph_data->atlas_position / font_data->atlas_glyph_per_line) * (font_data->glyph_height)), *prepared_glyph.image);
 
-        // Scaled font
-        QFont scaled_font(QString::fromStdString(font_data->font.font_family_name), font_data->font.font_size * font_data->scale);
-        scaled_font.setStyleStrategy(QFont::NoAntialias);
-        QFontMetricsF scaled_font_metric(scaled_font);
+        font_data->as_changed = true;
 
-        // Glyph image
-        QImage temp_glyph_image(std::ceil(scaled_font_metric.maxWidth() + font_data->padding * 2.0 * font_data->scale), std::ceil(scaled_font_metric.height() + font_data->padding * 2.0 * font_data->scale), QImage::Format_ARGB32);
+        return glyph_data;
+    }
 
-        // Glyph painter
-        QPainter glyph_painter(&temp_glyph_image);
-        glyph_painter.setBackgroundMode(Qt::TransparentMode);
-        glyph_painter.setCompositionMode (QPainter::CompositionMode_Source);
-        glyph_painter.setPen(qRgba(0, 0, 0, 0));
-        glyph_painter.fillRect(0, 0, temp_glyph_image.width(), temp_glyph_image.height(), Qt::transparent);
-        glyph_painter.setCompositionMode (QPainter::CompositionMode_SourceOver);
-        glyph_painter.setPen(qRgba(255, 255, 255, 255));
-        glyph_painter.setFont(scaled_font);
+    void Text::integrate_pending_glyphs(const std::shared_ptr<FontData>& font_data)
+    {
+        std::vector<PreparedGlyph> pending_glyphs;
 
-        // Glyph draw
-        glyph_painter.drawText(QPointF(font_data->padding * font_data->scale, scaled_font_metric.ascent() + font_data->padding * font_data->scale), glyph);
+        {
+            std::lock_guard<std::mutex> lock(font_data->pending_glyphs_mutex);
+            pending_glyphs.swap(font_data->pending_glyphs);
+            font_data->has_pending_glyphs = false;
+        }
 
-        font_data->last_generated_glyph_image = dfg.generate_distance_field(temp_glyph_image);
+        for(auto& prepared_glyph : pending_glyphs)
+        {
+            // The glyph may have been generated synchronously in the meantime.
+            if(find_glyph(font_data, prepared_glyph.glyph) == nullptr)
+                add_glyph(font_data, prepared_glyph);
+        }
+    }
 
-        // Distance field conversion
-        painter.drawImage(QPointF((glyph_data->atlas_position % font_data->atlas_glyph_per_line) * (font_data->glyph_width), (glyph_data->atlas_position / font_data->atlas_glyph_per_line) * (font_data->glyph_height)), *font_data->last_generated_glyph_image);
+    std::shared_ptr<GlyphData> Text::find_glyph(const std::shared_ptr<FontData>& font_data, const Glyph& glyph)
+    {
+        for(auto& g : font_data->glyphs)
+        {
+            if(g->glyph == glyph)
+                return g;
+        }
 
-        font_data->as_changed = true;
+        return nullptr;
+    }
 
-        return glyph_data;
+    void Text::pregenerate_glyphs(const Font& font, const QString& text)
+    {
+        std::shared_ptr<FontData> font_data = search_font(font);
+
+        if(font_data == nullptr)
+            return;
+
+        std::vector<Glyph> missing_glyphs;
+        for(const Glyph& g : text)
+        {
+            // Already generated, loaded or requested.
+            if(!font_data->requested_glyphs.insert(g.unicode()).second)
+                continue;
+
+            if(find_glyph(font_data, g) == nullptr)
+                missing_glyphs.push_back(g);
+        }
+
+        if(missing_glyphs.empty())
+            return;
+
+        // The font parameters never change after creation, the worker only touches the pending glyphs list.
+        QtConcurrent::run([font_data, missing_glyphs]()
+        {
+            for(const Glyph& g : missing_glyphs)
+            {
+                PreparedGlyph prepared_glyph = render_glyph(font_data->font, font_data->spread, font_data->scale, font_data->padding, g);
+
+                std::lock_guard<std::mutex> lock(font_data->pending_glyphs_mutex);
+                font_data->pending_glyphs.push_back(prepared_glyph);
+                font_data->has_pending_glyphs = true;
+            }
+        });
     }
 
     std::shared_ptr<GlyphData> Text::get_glyph(const Glyph& glyph)
     {
-        if(font_context_data.lock() == nullptr || font_context_data.lock()->font_data == nullptr)
+        std::shared_ptr<FontContextData> current_font_context_data = font_context_data.lock();
+
+        if(current_font_context_data == nullptr || current_font_context_data->font_data == nullptr)
             return nullptr;
 
-        for(auto& g : font_context_data.lock()->font_data->glyphs)
-        {
-            if(g->glyph == glyph)
-                return g;
-        }
+        const std::shared_ptr<FontData>& font_data = current_font_context_data->font_data;
+
+        // Add glyphs generated in the background (if any).
+        if(font_data->has_pending_glyphs)
+            integrate_pending_glyphs(font_data);
 
-        std::shared_ptr<GlyphData> res = generate_glyph(font_context_data.lock()->font_data, glyph);
+        std::shared_ptr<GlyphData> res = find_glyph(font_data, glyph);
 
-        font_context->reload_font_context(font_context_data.lock());
+        if(res == nullptr)
+            res = generate_glyph(font_data, glyph);
+
+        // Upload new glyphs/atlas (added by this text, by another context or in the background).
+        if(current_font_context_data->uploaded_glyph_count < font_data->glyphs.size() || current_font_context_data->uploaded_atlas_count < font_data->font_atlas.size())
+            font_context->reload_font_context(current_font_context_data);
 
         return res;
     }
@@ -447,34 +566,30 @@ namespace degate
         }
     }
 
-    std::shared_ptr<FontData> Text::load_font(const Font& font)
+    std::string Text::get_font_cache_file_path(const Font& font, float spread, float scale)
     {
-        if(font.font_size == 0 || font.font_family_name.empty())
-            return nullptr;
+        QString file_name = QString("%1_%2_%3_%4" FONT_CACHE_EXTENSION).arg(QString::fromStdString(font.font_family_name))
+                                                                        .arg(font.font_size)
+                                                                        .arg(spread)
+                                                                        .arg(scale);
 
-        // Fonts config file
+        return DEGATE_IN_CACHE(file_name.toStdString());
+    }
 
+    void Text::remove_legacy_font_cache()
+    {
         if(!QFile::exists(QString::fromStdString(DEGATE_IN_CONFIGURATION(FONTS_CONFIG_FILE_NAME))))
-        {
-            return nullptr;
-        }
+            return;
 
         QFile config_file(QString::fromStdString(DEGATE_IN_CONFIGURATION(FONTS_CONFIG_FILE_NAME)));
-        if(!config_file.open(QIODevice::ReadWrite | QIODevice::Text))
+        if(config_file.open(QIODevice::ReadOnly | QIODevice::Text))
         {
-            return nullptr;
-        }
-
-        QDomDocument doc;
-        doc.setContent(&config_file);
-        QDomElement root = doc.firstChildElement("config");
-        QDomElement font_elem;
+            QDomDocument doc;
+            doc.setContent(&config_file);
+            QDomElement root = doc.firstChildElement("config");
 
-        // If file version differs clear all fonts in the cache and reset the font configuration file.
-        if(root.attribute("file_version").toInt() != FONT_FILE_VERSION)
-        {
             QDomNodeList list = root.elementsByTagName("font");
-            for (int x = 0; x < list.length(); x++)
+            for (int x = 0; x < list.count(); x++)
             {
                 QDomElement node = list.at(x).toElement();
 
@@ -485,114 +600,135 @@ namespace degate
                 if(!font_config_file_path.isEmpty())
                     QFile::remove(font_config_file_path);
 
-                if(!font_atlas_file_path.isEmpty() && font_count != 0)
+                if(!font_atlas_file_path.isEmpty())
                 {
                     for(unsigned int i = 0; i < font_count; i++)
-                    QFile::remove(font_atlas_file_path + QString::number(i + 1) + FONT_ATLAS_EXTENSION);
+                        QFile::remove(font_atlas_file_path + QString::number(i + 1) + FONT_ATLAS_EXTENSION);
                 }
             }
 
-            // Clear the file
-            config_file.resize(0);
-
             config_file.close();
+        }
 
+        QFile::remove(QString::fromStdString(DEGATE_IN_CONFIGURATION(FONTS_CONFIG_FILE_NAME)));
+    }
+
+    std::shared_ptr<FontData> Text::load_font(const Font& font)
+    {
+        if(font.font_size == 0 || font.font_family_name.empty())
             return nullptr;
-        }
 
-        // Search the desired font in the file.
-        QDomNodeList list = root.elementsByTagName("font");
-        for (int x = 0; x < list.count(); x++)
-        {
-            QDomElement node = list.at(x).toElement();
+        // Fonts from older versions were stored as a xml config file, text files and png images.
+        remove_legacy_font_cache();
 
-            if(node.attribute("font_size").toUInt() == font.font_size && node.attribute("font_family_name") == QString::fromStdString(font.font_family_name))
-            {
-                font_elem = node;
-                break;
-            }
-        }
+        QString cache_file_path = QString::fromStdString(get_font_cache_file_path(font, FONT_DFG_SPREAD, FONT_DFG_SCALE));
 
-        if(font_elem.isNull())
-        {
-            config_file.close();
+        if(!QFile::exists(cache_file_path))
             return nullptr;
-        }
 
-        QString font_config_file_path = font_elem.attribute("font_config_file_path");
-        QString font_atlas_file_path = font_elem.attribute("font_atlas_file_path");
-        unsigned int font_count = font_elem.attribute("font_atlas_count").toUInt();
+        QFile cache_file(cache_file_path);
+        if(!cache_file.open(QIODevice::ReadOnly))
+            return nullptr;
+
+        QDataStream stream(&cache_file);
+        stream.setVersion(QDataStream::Qt_5_0);
+        stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+        // Header
+        quint32 magic = 0, version = 0;
+        stream >> magic >> version;
 
-        if(font_config_file_path.isEmpty() || font_atlas_file_path.isEmpty() || font_count == 0)
+        // If the file version differs, remove the cache file (it will be regenerated).
+        if(stream.status() != QDataStream::Ok || magic != FONT_CACHE_MAGIC || version != FONT_FILE_VERSION)
         {
-            root.removeChild(font_elem);
-            config_file.close();
+            cache_file.close();
+            QFile::remove(cache_file_path);
+
             return nullptr;
         }
 
+        // Key
+        QString font_family_name;
+        quint32 font_size = 0;
+        float spread = 0, scale = 0;
+        stream >> font_family_name >> font_size >> spread >> scale;
 
-        // Font config file
-
-        QFile font_config_file(font_config_file_path);
-        if(!font_config_file.open(QIODevice::ReadOnly | QIODevice::Text))
+        if(font_family_name.toStdString() != font.font_family_name || font_size != font.font_size || spread != FONT_DFG_SPREAD || scale != FONT_DFG_SCALE)
             return nullptr;
 
         std::shared_ptr<FontData> font_data = std::make_shared<FontData>();
         font_data->font = font;
+        font_data->spread = spread;
+        font_data->scale = scale;
+
+        // Metrics
+        quint32 atlas_width = 0, atlas_height = 0, atlas_glyph_per_line = 0, atlas_glyph_per_column = 0, glyph_per_atlas = 0;
+        stream >> font_data->default_glyph_height
+               >> font_data->glyph_width
+               >> font_data->glyph_height
+               >> atlas_width
+               >> atlas_height
+               >> atlas_glyph_per_line
+               >> atlas_glyph_per_column
+               >> glyph_per_atlas
+               >> font_data->padding;
+
+        font_data->atlas_width = atlas_width;
+        font_data->atlas_height = atlas_height;
+        font_data->atlas_glyph_per_line = atlas_glyph_per_line;
+        font_data->atlas_glyph_per_column = atlas_glyph_per_column;
+        font_data->glyph_per_atlas = glyph_per_atlas;
+
+        if(stream.status() != QDataStream::Ok || atlas_width == 0 || atlas_height == 0 || atlas_glyph_per_line == 0 || glyph_per_atlas == 0)
+            return nullptr;
 
-        QTextStream font_config_file_stream(&font_config_file);
-        font_config_file_stream.setCodec("UTF-8");
+        // Glyphs
+        quint32 glyph_count = 0;
+        stream >> glyph_count;
 
-        if(font_config_file_stream.readLine().toUInt() != font_data->font.font_size || font_config_file_stream.readLine().toStdString() != font_data->font.font_family_name)
+        for(unsigned int i = 0; i < glyph_count && stream.status() == QDataStream::Ok; i++)
         {
-            config_file.close();
-            font_config_file.close();
-            return nullptr;
+            quint16 unicode = 0;
+            quint32 atlas_position = 0, atlas_index = 0;
+
+            auto glyph = std::make_shared<GlyphData>();
+            stream >> unicode >> glyph->char_width >> glyph->char_advance >> atlas_position >> atlas_index;
+
+            glyph->glyph = Glyph(unicode);
+            glyph->atlas_position = atlas_position;
+            glyph->atlas_index = atlas_index;
+            font_data->glyphs.push_back(glyph);
         }
 
-        font_data->default_glyph_height = font_config_file_stream.readLine().toFloat();
-        font_data->glyph_width = font_config_file_stream.readLine().toFloat();
-        font_data->glyph_height = font_config_file_stream.readLine().toFloat();
-        font_data->atlas_width = font_config_file_stream.readLine().toUInt();
-        font_data->atlas_height = font_config_file_stream.readLine().toUInt();
-        font_data->atlas_glyph_per_line = font_config_file_stream.readLine().toUInt();
-        font_data->atlas_glyph_per_column = font_config_file_stream.readLine().toUInt();
-        font_data->glyph_per_atlas = font_config_file_stream.readLine().toUInt();
-        font_data->padding = font_config_file_stream.readLine().toFloat();
-        font_data->spread = font_config_file_stream.readLine().toFloat();
-        font_data->scale = font_config_file_stream.readLine().toFloat();
-        font_data->as_changed = false;
-        unsigned int glyph_count = font_config_file_stream.readLine().toUInt();
+        // Font atlas (raw ARGB32 pixels)
+        quint32 atlas_count = 0;
+        stream >> atlas_count;
+
+        if(stream.status() != QDataStream::Ok || atlas_count == 0)
+            return nullptr;
 
-        // Font atlas file
-        for(unsigned int i = 0; i < font_count; i++)
+        for(unsigned int i = 0; i < atlas_count; i++)
         {
-            font_data->font_atlas.push_back(std::make_shared<QImage>(font_atlas_file_path + QString::number(i + 1) + FONT_ATLAS_EXTENSION));
+            auto atlas = std::make_shared<QImage>(font_data->atlas_width, font_data->atlas_height, QImage::Format_ARGB32);
+            const int atlas_size = atlas->bytesPerLine() * atlas->height();
 
-            if(font_data->font_atlas.at(i)->isNull())
-            {
-                root.removeChild(font_elem);
-                config_file.close();
-                font_config_file.close();
+            if(atlas->isNull() || stream.readRawData(reinterpret_cast<char*>(atlas->bits()), atlas_size) != atlas_size)
                 return nullptr;
-            }
+
+            font_data->font_atlas.push_back(atlas);
         }
 
-        // Load glyphs
-        for(unsigned int i = 0; i < glyph_count; i++)
+        for(auto& glyph : font_data->glyphs)
         {
-            auto glyph = std::make_shared<GlyphData>();
-            glyph->glyph = font_config_file_stream.readLine().at(0);
-            glyph->char_width = font_config_file_stream.readLine().toFloat();
-            glyph->char_advance = font_config_file_stream.readLine().toFloat();
-            glyph->atlas_position = font_config_file_stream.readLine().toUInt();
-            glyph->atlas_index = font_config_file_stream.readLine().toUInt();
+            if(glyph->atlas_index >= font_data->font_atlas.size())
+                return nullptr;
+
             glyph->atlas = font_data->font_atlas.at(glyph->atlas_index);
-            font_data->glyphs.push_back(glyph);
         }
 
-        font_config_file.close();
-        config_file.close();
+        font_data->as_changed = false;
+
+        cache_file.close();
 
         return font_data;
     }
@@ -602,132 +738,66 @@ namespace degate
         if(font_data == nullptr)
             return;
 
-        CHECK_PATH(DEGATE_CONFIGURATION_PATH)
-
-        // Fonts config file
-
-        QFile config_file(QString::fromStdString(DEGATE_IN_CONFIGURATION(FONTS_CONFIG_FILE_NAME)));
-        QDomDocument doc;
-        QDomElement root;
-        QDomElement font_elem;
+        CHECK_PATH(DEGATE_CACHE_PATH)
 
-        // Check if the config file exists
-        if(!QFile::exists(QString::fromStdString(DEGATE_IN_CONFIGURATION(FONTS_CONFIG_FILE_NAME))))
+        // The file is written next to the old one and then swapped, a crash can't leave a truncated cache file.
+        QSaveFile cache_file(QString::fromStdString(get_font_cache_file_path(font_data->font, font_data->spread, font_data->scale)));
+        if(!cache_file.open(QIODevice::WriteOnly))
         {
-            if(!config_file.open(QIODevice::ReadWrite | QIODevice::Truncate | QIODevice::Text))
-            {
-                throw FileSystemException("Can't create the font config file.");
-            }
-
-            root = doc.createElement("config");
-            root.setAttribute("file_version", FONT_FILE_VERSION);
-            doc.appendChild(root);
-            font_elem = doc.createElement("font");
+            throw FileSystemException("Can't create the font cache file.");
         }
-        else
-        {
-            if(!config_file.open(QIODevice::ReadWrite | QIODevice::Text))
-            {
-                throw FileSystemException("Can't create the font config file.");
-            }
-
-            doc.setContent(&config_file);
-            root = doc.firstChildElement("config");
-
-            if(root.isNull())
-            {
-                root = doc.createElement("config");
-                root.setAttribute("file_version", FONT_FILE_VERSION);
-                doc.appendChild(root);
-                font_elem = doc.createElement("font");
-            }
-            else
-            {
-                // Search the desired font in the file.
-                QDomNodeList list = root.elementsByTagName("font");
-                for (int x = 0; x < list.count(); x++)
-                {
-                    QDomElement node = list.at(x).toElement();
 
-                    if(node.attribute("font_size").toUInt() == font_data->font.font_size && node.attribute("font_family_name") == QString::fromStdString(font_data->font.font_family_name))
-                    {
-                        font_elem = node;
-                        break;
-                    }
-                }
+        QDataStream stream(&cache_file);
+        stream.setVersion(QDataStream::Qt_5_0);
+        stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+        // Header
+        stream << static_cast<quint32>(FONT_CACHE_MAGIC) << static_cast<quint32>(FONT_FILE_VERSION);
+
+        // Key
+        stream << QString::fromStdString(font_data->font.font_family_name)
+               << static_cast<quint32>(font_data->font.font_size)
+               << font_data->spread
+               << font_data->scale;
+
+        // Metrics
+        stream << font_data->default_glyph_height
+               << font_data->glyph_width
+               << font_data->glyph_height
+               << static_cast<quint32>(font_data->atlas_width)
+               << static_cast<quint32>(font_data->atlas_height)
+               << static_cast<quint32>(font_data->atlas_glyph_per_line)
+               << static_cast<quint32>(font_data->atlas_glyph_per_column)
+               << static_cast<quint32>(font_data->glyph_per_atlas)
+               << font_data->padding;
+
+        // Glyphs
+        stream << static_cast<quint32>(font_data->glyphs.size());
 
-                if(font_elem.isNull())
-                {
-                    font_elem = doc.createElement("font");
-                }
-            }
+        for(auto& glyph_data : font_data->glyphs)
+        {
+            stream << static_cast<quint16>(glyph_data->glyph.unicode())
+                   << glyph_data->char_width
+                   << glyph_data->char_advance
+                   << static_cast<quint32>(glyph_data->atlas_position)
+                   << static_cast<quint32>(glyph_data->atlas_index);
         }
 
-        CHECK_PATH(DEGATE_CACHE_PATH)
-
-        std::string font_config_file_path = DEGATE_IN_CACHE(font_data->font.font_family_name + "_" + std::to_string(font_data->font.font_size) + ".fnt");
-        std::string font_atlas_file_path = DEGATE_IN_CACHE(font_data->font.font_family_name + "_" + std::to_string(font_data->font.font_size) + "_");
-
-        font_elem.setAttribute("font_size", font_data->font.font_size);
-        font_elem.setAttribute("font_family_name", QString::fromStdString(font_data->font.font_family_name));
-        font_elem.setAttribute("font_config_file_path", QString::fromStdString(font_config_file_path));
-        font_elem.setAttribute("font_atlas_file_path", QString::fromStdString(font_atlas_file_path));
-        font_elem.setAttribute("font_atlas_count", QString::number(font_data->font_atlas.size()));
-
-        root.appendChild(font_elem);
-
-        // Clear the file
-        config_file.resize(0);
-
-        QTextStream config_file_stream(&config_file);
-        config_file_stream << doc.toString();
-
-        config_file.close();
+        // Font atlas (raw ARGB32 pixels)
+        stream << static_cast<quint32>(font_data->font_atlas.size());
 
-
-        // Font config file
-
-        QFile font_config_file(QString::fromStdString(font_config_file_path));
-        if(!font_config_file.open(QIODevice::ReadWrite | QIODevice::Truncate | QIODevice::Text))
+        for(auto& atlas : font_data->font_atlas)
         {
-            throw FileSystemException("Can't create the font config file.");
+            assert(atlas->format() == QImage::Format_ARGB32);
+            stream.writeRawData(reinterpret_cast<const char*>(atlas->constBits()), atlas->bytesPerLine() * atlas->height());
         }
 
-        QTextStream font_config_file_stream(&font_config_file);
-        font_config_file_stream.setCodec("UTF-8");
-
-        font_config_file_stream << font_data->font.font_size << endl;
-        font_config_file_stream << QString::fromStdString(font_data->font.font_family_name) << endl;
-        font_config_file_stream << font_data->default_glyph_height << endl;
-        font_config_file_stream << font_data->glyph_width << endl;
-        font_config_file_stream << font_data->glyph_height << endl;
-        font_config_file_stream << font_data->atlas_width << endl;
-        font_config_file_stream << font_data->atlas_height << endl;
-        font_config_file_stream << font_data->atlas_glyph_per_line << endl;
-        font_config_file_stream << font_data->atlas_glyph_per_column << endl;
-        font_config_file_stream << font_data->glyph_per_atlas << endl;
-        font_config_file_stream << font_data->padding << endl;
-        font_config_file_stream << font_data->spread << endl;
-        font_config_file_stream << font_data->scale << endl;
-        font_config_file_stream << font_data->glyphs.size() << endl;
-
-        for(auto& glyph_data : font_data->glyphs)
+        if(stream.status() != QDataStream::Ok || !cache_file.commit())
         {
-            font_config_file_stream << glyph_data->glyph << endl;
-            font_config_file_stream << glyph_data->char_width << endl;
-            font_config_file_stream << glyph_data->char_advance << endl;
-            font_config_file_stream << glyph_data->atlas_position << endl;
-            font_config_file_stream << glyph_data->atlas_index << endl;
+            throw FileSystemException("Can't write the font cache file.");
         }
 
-        font_config_file.close();
-
-
-        // Save font atlas
-
-        for(unsigned int i = 0; i < font_data->font_atlas.size(); i++)
-            font_data->font_atlas.at(i)->save(QString::fromStdString(font_atlas_file_path) + QString::number(i + 1) + FONT_ATLAS_EXTENSION);
-
+        font_data->as_changed = false;
     }
 
     Text::Text(QWidget* parent, const std::string& font_family_name, const unsigned font_size) : parent(parent), font(Font{font_size, font_family_name})
@@ -807,9 +877,9 @@ namespace degate
             y -= padding * 2.0f * size_factor;
 
 
-        // Fill vbo
+        // Fill vbo (all vertices of the sub text are uploaded at once)
 
-        font_context->context->functions()->glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        std::vector<TextVertex2D> vertices(string.size() * 6);
 
         TextVertex2D temp;
         temp.color = final_color;
@@ -834,34 +904,41 @@ namespace degate
             QVector2D uv_start((glyph->atlas_position % glyph_per_line) * (font_context_data.lock()->font_data->glyph_width) / atlas_width, (static_cast<float>(glyph->atlas_position / glyph_per_line) * (font_context_data.lock()->font_data->glyph_height)) / atlas_height);
             QVector2D uv_end(uv_start.x() + (char_width + padding * 2.0) / atlas_width, uv_start.y() + (font_context_data.lock()->font_data->glyph_height) / atlas_height);
 
+            TextVertex2D* glyph_vertices = &vertices[i * 6];
+
             temp.pos = QVector2D(pos_start.x(), pos_start.y());
             temp.tex_uv = QVector2D(uv_start.x(), uv_start.y());
-            font_context->context->functions()->glBufferSubData(GL_ARRAY_BUFFER, offset * 6 * sizeof(TextVertex2D) + i * 6 * sizeof(TextVertex2D) + 0 * sizeof(TextVertex2D), sizeof(TextVertex2D), &temp);
+            glyph_vertices[0] = temp;
 
             temp.pos = QVector2D(pos_end.x(), pos_start.y());
             temp.tex_uv = QVector2D(uv_end.x(), uv_start.y());
-            font_context->context->functions()->glBufferSubData(GL_ARRAY_BUFFER, offset * 6 * sizeof(TextVertex2D) + i * 6 * sizeof(TextVertex2D) + 1 * sizeof(TextVertex2D), sizeof(TextVertex2D), &temp);
+            glyph_vertices[1] = temp;
 
             temp.pos = QVector2D(pos_start.x(), pos_end.y());
             temp.tex_uv = QVector2D(uv_start.x(), uv_end.y());
-            font_context->context->functions()->glBufferSubData(GL_ARRAY_BUFFER, offset * 6 * sizeof(TextVertex2D) + i * 6 * sizeof(TextVertex2D) + 2 * sizeof(TextVertex2D), sizeof(TextVertex2D), &temp);
+            glyph_vertices[2] = temp;
 
             temp.pos = QVector2D(pos_start.x(), pos_end.y());
             temp.tex_uv = QVector2D(uv_start.x(), uv_end.y());
-            font_context->context->functions()->glBufferSubData(GL_ARRAY_BUFFER, offset * 6 * sizeof(TextVertex2D) + i * 6 * sizeof(TextVertex2D) + 3 * sizeof(TextVertex2D), sizeof(TextVertex2D), &temp);
+            glyph_vertices[3] = temp;
 
             temp.pos = QVector2D(pos_end.x(), pos_start.y());
             temp.tex_uv = QVector2D(uv_end.x(), uv_start.y());
-            font_context->context->functions()->glBufferSubData(GL_ARRAY_BUFFER, offset * 6 * sizeof(TextVertex2D) + i * 6 * sizeof(TextVertex2D) + 4 * sizeof(TextVertex2D), sizeof(TextVertex2D), &temp);
+            glyph_vertices[4] = temp;
 
             temp.pos = QVector2D(pos_end.x(), pos_end.y());
             temp.tex_uv = QVector2D(uv_end.x(), uv_end.y());
-            font_context->context->functions()->glBufferSubData(GL_ARRAY_BUFFER, offset * 6 * sizeof(TextVertex2D) + i * 6 * sizeof(TextVertex2D) + 5 * sizeof(TextVertex2D), sizeof(TextVertex2D), &temp);
+            glyph_vertices[5] = temp;
 
             pixel_size += char_width * size_factor;
         }
 
-        font_context->context->functions()->glBindBuffer(GL_ARRAY_BUFFER, 0);
+        if(!vertices.empty())
+        {
+            font_context->context->functions()->glBindBuffer(GL_ARRAY_BUFFER, vbo);
+            font_context->context->functions()->glBufferSubData(GL_ARRAY_BUFFER, offset * 6 * sizeof(TextVertex2D), vertices.size() * sizeof(TextVertex2D), vertices.data());
+            font_context->context->functions()->glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
 
         return {pixel_size, font_context_data.lock()->font_data->glyph_height * size_factor};
     }
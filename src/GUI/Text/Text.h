@@ -24,6 +24,9 @@
 
 #include <QtOpenGL/QtOpenGL>
 #include <map>
+#include <set>
+#include <mutex>
+#include <atomic>
 
 #define FONT_DFG_SPREAD 4.0
 #define FONT_DFG_SCALE 8.0
@@ -36,7 +39,16 @@
 #define FONTS_CONFIG_FILE_NAME "font.config"
 #define FONT_ATLAS_EXTENSION ".png"
 
-#define FONT_FILE_VERSION 2
+#define FONT_CACHE_EXTENSION ".fatlas"
+#define FONT_CACHE_MAGIC 0x44474641
+
+#define FONT_FILE_VERSION 3
+
+/**
+ * Number of additional (empty) atlas layers allocated in an OpenGL texture array.
+ * New atlas pages can be uploaded into them without reallocating the whole texture array.
+ */
+#define FONT_ATLAS_SPARE_PAGES 2
 
 namespace degate
 {
@@ -80,6 +92,20 @@ namespace degate
          unsigned int atlas_index;      /**< The index of the atlas where the glyph belongs to. */
      };
 
+    /**
+     * @struct PreparedGlyph
+     * @brief A rendered distance field glyph that is not yet part of a font atlas.
+     *
+     * Prepared glyphs are generated on worker threads and added to the atlas later (@see Text::pregenerate_glyphs).
+     */
+     struct PreparedGlyph
+     {
+         Glyph glyph;                   /**< The glyph. */
+         float char_width;              /**< The width of the bounding box of the glyph. */
+         float char_advance;            /**< The advance of the glyph. */
+         std::shared_ptr<QImage> image; /**< The distance field image of the glyph. */
+     };
+
     /**
      * @struct FontData
      * @brief Describe a generated/loaded font.
@@ -103,7 +129,11 @@ namespace degate
         std::vector<std::shared_ptr<QImage>> font_atlas;    /**< The font atlas. */
         std::vector<std::shared_ptr<GlyphData>> glyphs;     /**< The list of glyphs. */
         bool as_changed = true;                             /**< Tell if the font needs to be saved again (or not, if it didn't change) */
-        std::shared_ptr<QImage> last_generated_glyph_image; /**< Store the last generated glyph image (for gpu reload) */
+
+        std::mutex pending_glyphs_mutex;                    /**< Protect pending_glyphs (filled from worker threads). */
+        std::vector<PreparedGlyph> pending_glyphs;          /**< Glyphs generated in the background, not yet added to an atlas. */
+        std::atomic<bool> has_pending_glyphs{false};        /**< Tell if pending_glyphs is not empty (to avoid locking). */
+        std::set<ushort> requested_glyphs;                  /**< Glyphs requested for background generation (GUI thread only). */
     };
 
     /**
@@ -112,7 +142,10 @@ namespace degate
      struct FontContextData
      {
          std::shared_ptr<FontData> font_data;   /**< The font data of the font */
-         GLuint font_atlas_texture_array;       /**< The associated font atlas OpenGL texture array */
+         GLuint font_atlas_texture_array = 0;   /**< The associated font atlas OpenGL texture array */
+         unsigned int atlas_capacity = 0;       /**< The number of layers allocated in the texture array. */
+         unsigned int uploaded_atlas_count = 0; /**< The number of atlas pages already uploaded to the texture array. */
+         unsigned int uploaded_glyph_count = 0; /**< The number of glyphs already uploaded to the texture array. */
      };
 
     /**
@@ -142,6 +175,9 @@ namespace degate
         /**
          * Synchronize the font atlas from memory with opengl texture array.
          *
+         * Only new atlas pages and new glyphs are uploaded. The texture array is only reallocated if
+         * the atlas pages don't fit into the allocated layers anymore.
+         *
          * @param font_context_data : the font context data to reload.
          * @param full_reload : force a full reload of all atlas (it will destroy and then load all atlas for the font in the gpu).
          */
@@ -190,6 +226,17 @@ namespace degate
          */
         static void save_fonts_to_cache();
 
+        /**
+         * Generate all missing glyphs of a text in the background.
+         * Generated glyphs are added to the font atlas the next time a glyph of the font is requested.
+         *
+         * This is used to prepare the glyphs of all names of a project when it is loaded.
+         *
+         * @param font : the font.
+         * @param text : all glyphs of this text will be generated.
+         */
+        static void pregenerate_glyphs(const Font& font, const QString& text);
+
         /**
          * Create a text.
          *
@@ -263,6 +310,53 @@ namespace degate
          */
         static std::shared_ptr<GlyphData> generate_glyph(const std::shared_ptr<FontData>& font_data, const Glyph& glyph);
 
+        /**
+         * Render the distance field image of a glyph. This doesn't modify the font data, so it can be called from worker threads.
+         *
+         * @param font : the font.
+         * @param spread : the spread of the Distance Field method.
+         * @param scale : the scale of the Distance Field method.
+         * @param padding : the padding around the glyph.
+         * @param glyph : the glyph.
+         *
+         * @return Returns the rendered glyph.
+         */
+        static PreparedGlyph render_glyph(const Font& font, float spread, float scale, float padding, const Glyph& glyph);
+
+        /**
+         * Add a rendered glyph to the font atlas.
+         *
+         * @param font_data : the FontData associated to the font.
+         * @param prepared_glyph : the rendered glyph.
+         *
+         * @return Returns the new glyph data.
+         */
+        static std::shared_ptr<GlyphData> add_glyph(const std::shared_ptr<FontData>& font_data, const PreparedGlyph& prepared_glyph);
+
+        /**
+         * Add all glyphs generated in the background to the font atlas.
+         *
+         * @param font_data : the FontData associated to the font.
+         */
+        static void integrate_pending_glyphs(const std::shared_ptr<FontData>& font_data);
+
+        /**
+         * Search a glyph in the already generated/loaded glyphs of a font.
+         *
+         * @return Returns the glyph data or nullptr if the glyph doesn't exist yet.
+         */
+        static std::shared_ptr<GlyphData> find_glyph(const std::shared_ptr<FontData>& font_data, const Glyph& glyph);
+
+        /**
+         * Get the path of the cache file of a font. The cache file is keyed by font family, font size, spread and scale.
+         */
+        static std::string get_font_cache_file_path(const Font& font, float spread, float scale);
+
+        /**
+         * Remove the cache files of older degate versions (font.config, .fnt and .png files).
+         */
+        static void remove_legacy_font_cache();
+
         /**
          * Load a font from the cache.
          *
@@ -0,0 +1,382 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "BackgroundResidencyManager.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace degate
+{
+    BackgroundResidencyManager::BackgroundResidencyManager(const ScalingManager_shptr& scaling_manager,
+                                                           size_t budget,
+                                                           unsigned int prefetch_border,
+                                                           bool asynchronous)
+            : asynchronous(asynchronous), budget(budget), prefetch_border(prefetch_border)
+    {
+        assert(scaling_manager != nullptr);
+
+        for(auto step : scaling_manager->get_zoom_steps())
+        {
+            auto element = scaling_manager->get_image(step);
+
+            if(element.second != nullptr)
+                levels[static_cast<unsigned int>(lrint(element.first))] = element.second;
+        }
+
+        if(asynchronous)
+            worker_thread = std::thread(&BackgroundResidencyManager::worker, this);
+    }
+
+    BackgroundResidencyManager::~BackgroundResidencyManager()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+
+        work_condition.notify_all();
+
+        if(worker_thread.joinable())
+            worker_thread.join();
+    }
+
+    void BackgroundResidencyManager::set_loaded_callback(const std::function<void()>& callback)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        loaded_callback = callback;
+    }
+
+    void BackgroundResidencyManager::set_viewport(const BoundingBox& viewport, double scale)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        if(levels.empty())
+            return;
+
+        frame++;
+
+        // Select the level with the lowest resolution that is still at least the screen resolution.
+        current_level = levels.begin()->first;
+        for(auto& e : levels)
+        {
+            if(e.first <= std::max(scale, 1.0))
+                current_level = e.first;
+        }
+
+        BackgroundImage_shptr image = get_level_image(current_level);
+        const unsigned int tile_size = image->get_tile_size();
+
+        // Tiles scheduled for the previous viewport but not loaded yet are dropped.
+        for(auto& key : queue)
+        {
+            auto it = tiles.find(key);
+            if(it != tiles.end() && it->second.state == TILE_QUEUED)
+                tiles.erase(it);
+        }
+        queue.clear();
+        visible_tiles.clear();
+
+        // Viewport in the level image coordinates.
+        const float min_x = std::max(viewport.get_min_x() / static_cast<float>(current_level), 0.0f);
+        const float min_y = std::max(viewport.get_min_y() / static_cast<float>(current_level), 0.0f);
+        const float max_x = std::min(viewport.get_max_x() / static_cast<float>(current_level), static_cast<float>(image->get_width()) - 1.0f);
+        const float max_y = std::min(viewport.get_max_y() / static_cast<float>(current_level), static_cast<float>(image->get_height()) - 1.0f);
+
+        if(max_x >= min_x && max_y >= min_y)
+        {
+            const int first_tx = static_cast<int>(min_x) / tile_size, last_tx = static_cast<int>(max_x) / tile_size;
+            const int first_ty = static_cast<int>(min_y) / tile_size, last_ty = static_cast<int>(max_y) / tile_size;
+
+            // Visible tiles first
+            for(int ty = first_ty; ty <= last_ty; ty++)
+            {
+                for(int tx = first_tx; tx <= last_tx; tx++)
+                {
+                    BackgroundTileKey key{current_level, tx * tile_size, ty * tile_size};
+                    visible_tiles.push_back(key);
+                    schedule(key);
+                }
+            }
+
+            // Then the tiles around them
+            const int last_image_tx = (image->get_width() - 1) / tile_size;
+            const int last_image_ty = (image->get_height() - 1) / tile_size;
+            const int border = static_cast<int>(prefetch_border);
+
+            for(int ty = std::max(first_ty - border, 0); ty <= std::min(last_ty + border, last_image_ty); ty++)
+            {
+                for(int tx = std::max(first_tx - border, 0); tx <= std::min(last_tx + border, last_image_tx); tx++)
+                {
+                    if(tx >= first_tx && tx <= last_tx && ty >= first_ty && ty <= last_ty)
+                        continue;
+
+                    schedule(BackgroundTileKey{current_level, tx * tile_size, ty * tile_size});
+                }
+            }
+        }
+
+        evict();
+
+        if(!asynchronous)
+        {
+            while(!queue.empty())
+                load_tile(lock);
+        }
+        else
+        {
+            work_condition.notify_one();
+        }
+    }
+
+    unsigned int BackgroundResidencyManager::get_level() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return current_level;
+    }
+
+    std::vector<BackgroundTileKey> BackgroundResidencyManager::get_visible_tiles() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return visible_tiles;
+    }
+
+    BoundingBox BackgroundResidencyManager::get_tile_bounding_box(const BackgroundTileKey& key) const
+    {
+        const float tile_size = static_cast<float>(get_level_image(key.level)->get_tile_size());
+        const float level = static_cast<float>(key.level);
+
+        return BoundingBox(key.x * level, (key.x + tile_size) * level, key.y * level, (key.y + tile_size) * level);
+    }
+
+    std::vector<LoadedBackgroundTile> BackgroundResidencyManager::take_loaded_tiles()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        std::vector<LoadedBackgroundTile> res;
+        res.swap(loaded_tiles);
+
+        for(auto& e : res)
+        {
+            auto it = tiles.find(e.key);
+            if(it != tiles.end())
+                it->second.state = TILE_RESIDENT;
+        }
+
+        evict();
+
+        return res;
+    }
+
+    void BackgroundResidencyManager::release_staging_buffer(const StagingBuffer_shptr& buffer)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if(buffer != nullptr && staging_pool.size() < BACKGROUND_STAGING_POOL_SIZE)
+            staging_pool.push_back(buffer);
+    }
+
+    std::vector<BackgroundTileKey> BackgroundResidencyManager::take_evicted_tiles()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        std::vector<BackgroundTileKey> res;
+        res.swap(evicted_tiles);
+
+        return res;
+    }
+
+    bool BackgroundResidencyManager::is_resident(const BackgroundTileKey& key) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto it = tiles.find(key);
+        return it != tiles.end() && it->second.state == TILE_RESIDENT;
+    }
+
+    size_t BackgroundResidencyManager::get_resident_count() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        return std::count_if(tiles.begin(), tiles.end(), [](const std::pair<const BackgroundTileKey, TileState>& e)
+        {
+            return e.second.state == TILE_RESIDENT;
+        });
+    }
+
+    size_t BackgroundResidencyManager::get_max_resident_tiles() const
+    {
+        if(levels.empty())
+            return 0;
+
+        const size_t tile_size = levels.begin()->second->get_tile_size();
+        const size_t tile_bytes = tile_size * tile_size * sizeof(rgba_pixel_t);
+
+        return std::max<size_t>(budget / tile_bytes, 1);
+    }
+
+    void BackgroundResidencyManager::wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        idle_condition.wait(lock, [this]() { return (queue.empty() && !loading) || stop; });
+    }
+
+    void BackgroundResidencyManager::worker()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        while(true)
+        {
+            work_condition.wait(lock, [this]() { return stop || !queue.empty(); });
+
+            if(stop)
+                break;
+
+            load_tile(lock);
+        }
+
+        idle_condition.notify_all();
+    }
+
+    void BackgroundResidencyManager::load_tile(std::unique_lock<std::mutex>& lock)
+    {
+        assert(!queue.empty());
+
+        BackgroundTileKey key = queue.front();
+        queue.pop_front();
+
+        BackgroundImage_shptr image = get_level_image(key.level);
+        const unsigned int tile_size = image->get_tile_size();
+        StagingBuffer_shptr buffer = get_staging_buffer(tile_size);
+
+        // The copy is done without the lock, so the viewport can change meanwhile.
+        loading = true;
+        lock.unlock();
+
+        image->raw_copy(buffer->data(), key.x, key.y);
+
+        lock.lock();
+
+        bool loaded = false;
+
+        auto it = tiles.find(key);
+        if(it != tiles.end() && it->second.state == TILE_QUEUED)
+        {
+            it->second.state = TILE_LOADED;
+            loaded_tiles.push_back(LoadedBackgroundTile{key, tile_size, buffer});
+            loaded = true;
+        }
+        else if(staging_pool.size() < BACKGROUND_STAGING_POOL_SIZE)
+        {
+            staging_pool.push_back(buffer);
+        }
+
+        if(loaded && asynchronous && loaded_callback)
+        {
+            std::function<void()> callback = loaded_callback;
+
+            lock.unlock();
+            callback();
+            lock.lock();
+        }
+
+        loading = false;
+
+        if(queue.empty())
+            idle_condition.notify_all();
+    }
+
+    StagingBuffer_shptr BackgroundResidencyManager::get_staging_buffer(unsigned int tile_size)
+    {
+        const size_t size = static_cast<size_t>(tile_size) * tile_size;
+
+        while(!staging_pool.empty())
+        {
+            StagingBuffer_shptr buffer = staging_pool.back();
+            staging_pool.pop_back();
+
+            if(buffer->size() == size)
+                return buffer;
+        }
+
+        return std::make_shared<std::vector<rgba_pixel_t>>(size);
+    }
+
+    void BackgroundResidencyManager::evict()
+    {
+        const size_t max_resident_tiles = get_max_resident_tiles();
+
+        std::vector<std::pair<unsigned long, BackgroundTileKey>> candidates;
+        size_t resident_count = 0;
+
+        for(auto& e : tiles)
+        {
+            if(e.second.state != TILE_RESIDENT)
+                continue;
+
+            resident_count++;
+
+            // Tiles needed by the current viewport (visible or prefetched) are never evicted.
+            if(e.second.last_use != frame)
+                candidates.emplace_back(e.second.last_use, e.first);
+        }
+
+        if(resident_count <= max_resident_tiles)
+            return;
+
+        std::sort(candidates.begin(), candidates.end(), [](const std::pair<unsigned long, BackgroundTileKey>& a, const std::pair<unsigned long, BackgroundTileKey>& b)
+        {
+            return a.first < b.first;
+        });
+
+        for(auto& e : candidates)
+        {
+            if(resident_count <= max_resident_tiles)
+                break;
+
+            tiles.erase(e.second);
+            evicted_tiles.push_back(e.second);
+            resident_count--;
+        }
+    }
+
+    void BackgroundResidencyManager::schedule(const BackgroundTileKey& key)
+    {
+        auto it = tiles.find(key);
+
+        if(it != tiles.end())
+        {
+            it->second.last_use = frame;
+            return;
+        }
+
+        tiles[key] = TileState{TILE_QUEUED, frame};
+        queue.push_back(key);
+    }
+
+    BackgroundImage_shptr BackgroundResidencyManager::get_level_image(unsigned int level) const
+    {
+        auto it = levels.find(level);
+        assert(it != levels.end());
+
+        return it->second;
+    }
+}
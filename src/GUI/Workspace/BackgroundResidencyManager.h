@@ -0,0 +1,244 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __BACKGROUNDRESIDENCYMANAGER_H__
+#define __BACKGROUNDRESIDENCYMANAGER_H__
+
+#include "Core/Image/Image.h"
+#include "Core/Image/Manipulation/ScalingManager.h"
+#include "Core/Primitive/BoundingBox.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Default memory budget (in bytes) for background tiles kept in video memory.
+ */
+#define BACKGROUND_RESIDENCY_BUDGET (256 * 1024 * 1024)
+
+/**
+ * Default number of tiles prefetched around the visible tiles.
+ */
+#define BACKGROUND_PREFETCH_BORDER 1
+
+/**
+ * Maximum number of staging buffers kept for reuse.
+ */
+#define BACKGROUND_STAGING_POOL_SIZE 8
+
+namespace degate
+{
+    /**
+     * @struct BackgroundTileKey
+     * @brief Identify a tile of a level of the background image pyramid.
+     */
+    struct BackgroundTileKey
+    {
+        unsigned int level; /**< The scaling factor of the pyramid level (1, 2, 4...). */
+        unsigned int x;     /**< The x pixel coordinate of the tile in the level image. */
+        unsigned int y;     /**< The y pixel coordinate of the tile in the level image. */
+
+        bool operator<(const BackgroundTileKey& other) const
+        {
+            if(level != other.level)
+                return level < other.level;
+            if(y != other.y)
+                return y < other.y;
+            return x < other.x;
+        }
+
+        bool operator==(const BackgroundTileKey& other) const
+        {
+            return level == other.level && x == other.x && y == other.y;
+        }
+    };
+
+    typedef std::shared_ptr<std::vector<rgba_pixel_t>> StagingBuffer_shptr;
+
+    /**
+     * @struct LoadedBackgroundTile
+     * @brief Pixel data of a tile, loaded in a staging buffer and ready to be uploaded.
+     */
+    struct LoadedBackgroundTile
+    {
+        BackgroundTileKey key;        /**< The tile. */
+        unsigned int tile_size;       /**< The width and height of the tile. */
+        StagingBuffer_shptr data;     /**< The pixels (tile_size * tile_size). */
+    };
+
+    /**
+     * @class BackgroundResidencyManager
+     * @brief Decide which tiles of the background image pyramid must be in video memory for the current viewport.
+     *
+     * For each viewport, the pyramid level with the lowest resolution that is still at least the screen resolution
+     * is selected. Visible tiles of this level are loaded first, then the tiles around them (prefetch).
+     * Tiles are loaded on a worker thread (with raw_copy()) into pooled staging buffers.
+     *
+     * The manager doesn't touch OpenGL: the owner takes the loaded tiles to upload them
+     * (@see take_loaded_tiles) and deletes the textures of evicted tiles (@see take_evicted_tiles).
+     * When there are more resident tiles than allowed by the memory budget, the least recently used
+     * tiles are evicted (visible tiles are never evicted).
+     *
+     * Images are read from the worker thread, tile caches are thread safe (@see TileCache).
+     */
+    class BackgroundResidencyManager
+    {
+    public:
+
+        /**
+         * Create a residency manager for the images of a scaling manager.
+         *
+         * @param scaling_manager : the scaling manager of the layer (gives the image pyramid).
+         * @param budget : the maximum size (in bytes) of resident tiles.
+         * @param prefetch_border : the number of tiles to prefetch around the visible ones.
+         * @param asynchronous : if false, tiles are loaded in set_viewport() instead of on a worker thread.
+         */
+        BackgroundResidencyManager(const ScalingManager_shptr& scaling_manager,
+                                   size_t budget = BACKGROUND_RESIDENCY_BUDGET,
+                                   unsigned int prefetch_border = BACKGROUND_PREFETCH_BORDER,
+                                   bool asynchronous = true);
+
+        /**
+         * Stop the worker thread (after the current tile load).
+         */
+        ~BackgroundResidencyManager();
+
+        /**
+         * Set a function called (from the worker thread) each time a tile has been loaded.
+         */
+        void set_loaded_callback(const std::function<void()>& callback);
+
+        /**
+         * Set the current viewport. This selects the pyramid level and the visible tiles, and schedules tile loads.
+         *
+         * @param viewport : the viewport (in pixels of the full resolution image).
+         * @param scale : number of image pixels per screen pixel.
+         */
+        void set_viewport(const BoundingBox& viewport, double scale);
+
+        /**
+         * Get the selected pyramid level (scaling factor).
+         */
+        unsigned int get_level() const;
+
+        /**
+         * Get the visible tiles for the current viewport.
+         */
+        std::vector<BackgroundTileKey> get_visible_tiles() const;
+
+        /**
+         * Get the area covered by a tile (in pixels of the full resolution image).
+         */
+        BoundingBox get_tile_bounding_box(const BackgroundTileKey& key) const;
+
+        /**
+         * Get all tiles loaded since the last call. These tiles are then considered resident.
+         * Staging buffers should be given back with release_staging_buffer() after the upload.
+         */
+        std::vector<LoadedBackgroundTile> take_loaded_tiles();
+
+        /**
+         * Give back a staging buffer for reuse.
+         */
+        void release_staging_buffer(const StagingBuffer_shptr& buffer);
+
+        /**
+         * Get all tiles evicted since the last call (their textures must be deleted).
+         */
+        std::vector<BackgroundTileKey> take_evicted_tiles();
+
+        /**
+         * Check if a tile is resident (taken with take_loaded_tiles() and not evicted).
+         */
+        bool is_resident(const BackgroundTileKey& key) const;
+
+        /**
+         * Get the number of resident tiles.
+         */
+        size_t get_resident_count() const;
+
+        /**
+         * Get the maximum number of resident tiles (from the memory budget).
+         */
+        size_t get_max_resident_tiles() const;
+
+        /**
+         * Wait until all scheduled tiles are loaded.
+         */
+        void wait();
+
+    private:
+
+        enum TILE_STATE
+        {
+            TILE_QUEUED,
+            TILE_LOADED,
+            TILE_RESIDENT
+        };
+
+        struct TileState
+        {
+            TILE_STATE state;
+            unsigned long last_use;
+        };
+
+        void worker();
+        void load_tile(std::unique_lock<std::mutex>& lock);
+        StagingBuffer_shptr get_staging_buffer(unsigned int tile_size);
+        void evict();
+        void schedule(const BackgroundTileKey& key);
+        BackgroundImage_shptr get_level_image(unsigned int level) const;
+
+        std::map<unsigned int, BackgroundImage_shptr> levels;
+
+        mutable std::mutex mutex;
+        std::condition_variable work_condition;
+        std::condition_variable idle_condition;
+        std::thread worker_thread;
+        bool stop = false;
+        bool loading = false;
+        const bool asynchronous;
+
+        std::map<BackgroundTileKey, TileState> tiles;
+        std::deque<BackgroundTileKey> queue;
+        std::vector<LoadedBackgroundTile> loaded_tiles;
+        std::vector<BackgroundTileKey> evicted_tiles;
+        std::vector<BackgroundTileKey> visible_tiles;
+        std::vector<StagingBuffer_shptr> staging_pool;
+
+        std::function<void()> loaded_callback;
+
+        unsigned int current_level = 1;
+        unsigned long frame = 0;
+        size_t budget;
+        unsigned int prefetch_border;
+    };
+
+    typedef std::shared_ptr<BackgroundResidencyManager> BackgroundResidencyManager_shptr;
+}
+
+#endif //__BACKGROUNDRESIDENCYMANAGER_H__
@@ -23,13 +23,6 @@
 
 namespace degate
 {
-	struct AnnotationsVertex2D
-	{
-		QVector2D pos;
-		QVector3D color;
-		float alpha;
-	};
-
 	WorkspaceAnnotations::WorkspaceAnnotations(QWidget* parent) : WorkspaceElement(parent), text(parent)
 	{
 
@@ -105,31 +98,34 @@ namespace degate
 		}
         annotations_count = annotations.size();
 
+		annotation_vertices.resize(annotations_count);
+		annotation_line_vertices.resize(annotations_count);
+
 		if(annotations_count == 0)
 			return;
 
-		context->glBindBuffer(GL_ARRAY_BUFFER, vbo);
-
-		context->glBufferData(GL_ARRAY_BUFFER, annotations_count * 6 * sizeof(AnnotationsVertex2D), nullptr, GL_STATIC_DRAW);
-
-		context->glBindBuffer(GL_ARRAY_BUFFER, line_vbo);
-
-		context->glBufferData(GL_ARRAY_BUFFER, annotations_count * 8 * sizeof(AnnotationsVertex2D), nullptr, GL_STATIC_DRAW);
-
-		context->glBindBuffer(GL_ARRAY_BUFFER, 0);
-
 		unsigned text_size = 0;
 
 		unsigned index = 0;
 		for(auto& e : annotations)
 		{
-			create_annotation(e, index);
 			e->set_index(index);
 
 			text_size += e->get_name().length();
 			index++;
 		}
 
+		// Build all vertices on the CPU side (in parallel), then upload each buffer at once.
+
+		build_vertices(annotations_count, [&](size_t begin, size_t end)
+		{
+			for(size_t i = begin; i < end; i++)
+				create_annotation(annotations[i], annotation_vertices.get_object_vertices(i), annotation_line_vertices.get_object_vertices(i));
+		});
+
+		annotation_vertices.upload(context, vbo);
+		annotation_line_vertices.upload(context, line_vbo);
+
 		text.update(text_size);
 
 		unsigned text_offset = 0;
@@ -149,7 +145,20 @@ namespace degate
 		if(annotation == nullptr)
 			return;
 
-		create_annotation(annotation, annotation->get_index());
+		// Only the range of this annotation is updated, with the next flush.
+		WorkspaceVertex2D* vertices = annotation_vertices.update_object_vertices(annotation->get_index());
+		WorkspaceVertex2D* line_vertices = annotation_line_vertices.update_object_vertices(annotation->get_index());
+
+		if(vertices == nullptr || line_vertices == nullptr)
+			return;
+
+		create_annotation(annotation, vertices, line_vertices);
+	}
+
+	void WorkspaceAnnotations::flush()
+	{
+		annotation_vertices.flush(context, vbo);
+		annotation_line_vertices.flush(context, line_vbo);
 	}
 
 	void WorkspaceAnnotations::draw(const QMatrix4x4& projection)
@@ -164,28 +173,28 @@ namespace degate
 		context->glBindBuffer(GL_ARRAY_BUFFER, vbo);
 
 		program->enableAttributeArray("pos");
-		program->setAttributeBuffer("pos", GL_FLOAT, 0, 2, sizeof(AnnotationsVertex2D));
+		program->setAttributeBuffer("pos", GL_FLOAT, 0, 2, sizeof(WorkspaceVertex2D));
 
 		program->enableAttributeArray("color");
-		program->setAttributeBuffer("color", GL_FLOAT, 2 * sizeof(float), 3, sizeof(AnnotationsVertex2D));
+		program->setAttributeBuffer("color", GL_FLOAT, 2 * sizeof(float), 3, sizeof(WorkspaceVertex2D));
 
 		program->enableAttributeArray("alpha");
-		program->setAttributeBuffer("alpha", GL_FLOAT, 5 * sizeof(float), 1, sizeof(AnnotationsVertex2D));
+		program->setAttributeBuffer("alpha", GL_FLOAT, 5 * sizeof(float), 1, sizeof(WorkspaceVertex2D));
 
-		context->glDrawArrays(GL_TRIANGLES, 0, annotations_count * 6);
+		context->glDrawArrays(GL_TRIANGLES, 0, annotations_count * RECTANGLE_VERTICES_COUNT);
 
 		context->glBindBuffer(GL_ARRAY_BUFFER, line_vbo);
 
 		program->enableAttributeArray("pos");
-		program->setAttributeBuffer("pos", GL_FLOAT, 0, 2, sizeof(AnnotationsVertex2D));
+		program->setAttributeBuffer("pos", GL_FLOAT, 0, 2, sizeof(WorkspaceVertex2D));
 
 		program->enableAttributeArray("color");
-		program->setAttributeBuffer("color", GL_FLOAT, 2 * sizeof(float), 3, sizeof(AnnotationsVertex2D));
+		program->setAttributeBuffer("color", GL_FLOAT, 2 * sizeof(float), 3, sizeof(WorkspaceVertex2D));
 
 		program->enableAttributeArray("alpha");
-		program->setAttributeBuffer("alpha", GL_FLOAT, 5 * sizeof(float), 1, sizeof(AnnotationsVertex2D));
+		program->setAttributeBuffer("alpha", GL_FLOAT, 5 * sizeof(float), 1, sizeof(WorkspaceVertex2D));
 
-		context->glDrawArrays(GL_LINES, 0, annotations_count * 8);
+		context->glDrawArrays(GL_LINES, 0, annotations_count * RECTANGLE_OUTLINE_VERTICES_COUNT);
 
 		context->glBindBuffer(GL_ARRAY_BUFFER, 0);
 
@@ -200,40 +209,15 @@ namespace degate
 		text.draw(projection);
 	}
 
-	void WorkspaceAnnotations::create_annotation(Annotation_shptr& annotation, unsigned index)
+	void WorkspaceAnnotations::create_annotation(const Annotation_shptr& annotation, WorkspaceVertex2D* vertices, WorkspaceVertex2D* line_vertices) const
 	{
-		if(annotation == nullptr)
-			return;
-
-		context->glBindBuffer(GL_ARRAY_BUFFER, vbo);
-
 		// Vertices and colors
 
         color_t color = annotation->get_fill_color() == 0 ? project->get_default_color(DEFAULT_COLOR_ANNOTATION) : annotation->get_fill_color();
 
         color = highlight_color_by_state(color, annotation->get_highlighted());
 
-        AnnotationsVertex2D temp;
-		temp.color = QVector3D(MASK_R(color) / 255.0, MASK_G(color) / 255.0, MASK_B(color) / 255.0);
-		temp.alpha = MASK_A(color) / 255.0;
-
-		temp.pos = QVector2D(annotation->get_min_x(), annotation->get_min_y());
-		context->glBufferSubData(GL_ARRAY_BUFFER, index * 6 * sizeof(AnnotationsVertex2D) + 0 * sizeof(AnnotationsVertex2D), sizeof(AnnotationsVertex2D), &temp);
-
-		temp.pos = QVector2D(annotation->get_max_x(), annotation->get_min_y());
-		context->glBufferSubData(GL_ARRAY_BUFFER, index * 6 * sizeof(AnnotationsVertex2D) + 1 * sizeof(AnnotationsVertex2D), sizeof(AnnotationsVertex2D), &temp);
-
-		temp.pos = QVector2D(annotation->get_min_x(), annotation->get_max_y());
-		context->glBufferSubData(GL_ARRAY_BUFFER, index * 6 * sizeof(AnnotationsVertex2D) + 2 * sizeof(AnnotationsVertex2D), sizeof(AnnotationsVertex2D), &temp);
-
-		temp.pos = QVector2D(annotation->get_max_x(), annotation->get_min_y());
-		context->glBufferSubData(GL_ARRAY_BUFFER, index * 6 * sizeof(AnnotationsVertex2D) + 4 * sizeof(AnnotationsVertex2D), sizeof(AnnotationsVertex2D), &temp);
-
-		temp.pos = QVector2D(annotation->get_min_x(), annotation->get_max_y());
-		context->glBufferSubData(GL_ARRAY_BUFFER, index * 6 * sizeof(AnnotationsVertex2D) + 3 * sizeof(AnnotationsVertex2D), sizeof(AnnotationsVertex2D), &temp);
-
-		temp.pos = QVector2D(annotation->get_max_x(), annotation->get_max_y());
-		context->glBufferSubData(GL_ARRAY_BUFFER, index * 6 * sizeof(AnnotationsVertex2D) + 5 * sizeof(AnnotationsVertex2D), sizeof(AnnotationsVertex2D), &temp);
+		build_rectangle(vertices, annotation->get_min_x(), annotation->get_min_y(), annotation->get_max_x(), annotation->get_max_y(), color);
 
 
 		// Lines
@@ -242,35 +226,6 @@ namespace degate
 
         color = highlight_color_by_state(color, annotation->get_highlighted());
 
-		context->glBindBuffer(GL_ARRAY_BUFFER, line_vbo);
-
-		temp.color = QVector3D(MASK_R(color) / 255.0, MASK_G(color) / 255.0, MASK_B(color) / 255.0);
-		temp.alpha = MASK_A(color) / 255.0;
-
-		temp.pos = QVector2D(annotation->get_min_x(), annotation->get_min_y());
-		context->glBufferSubData(GL_ARRAY_BUFFER, index * 8 * sizeof(AnnotationsVertex2D) + 0 * sizeof(AnnotationsVertex2D), sizeof(AnnotationsVertex2D), &temp);
-
-		temp.pos = QVector2D(annotation->get_max_x(), annotation->get_min_y());
-		context->glBufferSubData(GL_ARRAY_BUFFER, index * 8 * sizeof(AnnotationsVertex2D) + 1 * sizeof(AnnotationsVertex2D), sizeof(AnnotationsVertex2D), &temp);
-
-		temp.pos = QVector2D(annotation->get_min_x(), annotation->get_min_y());
-		context->glBufferSubData(GL_ARRAY_BUFFER, index * 8 * sizeof(AnnotationsVertex2D) + 2 * sizeof(AnnotationsVertex2D), sizeof(AnnotationsVertex2D), &temp);
-
-		temp.pos = QVector2D(annotation->get_min_x(), annotation->get_max_y());
-		context->glBufferSubData(GL_ARRAY_BUFFER, index * 8 * sizeof(AnnotationsVertex2D) + 3 * sizeof(AnnotationsVertex2D), sizeof(AnnotationsVertex2D), &temp);
-
-		temp.pos = QVector2D(annotation->get_max_x(), annotation->get_min_y());
-		context->glBufferSubData(GL_ARRAY_BUFFER, index * 8 * sizeof(AnnotationsVertex2D) + 4 * sizeof(AnnotationsVertex2D), sizeof(AnnotationsVertex2D), &temp);
-
-		temp.pos = QVector2D(annotation->get_max_x(), annotation->get_max_y());
-		context->glBufferSubData(GL_ARRAY_BUFFER, index * 8 * sizeof(AnnotationsVertex2D) + 5 * sizeof(AnnotationsVertex2D), sizeof(AnnotationsVertex2D), &temp);
-
-		temp.pos = QVector2D(annotation->get_min_x(), annotation->get_max_y());
-		context->glBufferSubData(GL_ARRAY_BUFFER, index * 8 * sizeof(AnnotationsVertex2D) + 6 * sizeof(AnnotationsVertex2D), sizeof(AnnotationsVertex2D), &temp);
-
-		temp.pos = QVector2D(annotation->get_max_x(), annotation->get_max_y());
-		context->glBufferSubData(GL_ARRAY_BUFFER, index * 8 * sizeof(AnnotationsVertex2D) + 7 * sizeof(AnnotationsVertex2D), sizeof(AnnotationsVertex2D), &temp);
-
-		context->glBindBuffer(GL_ARRAY_BUFFER, 0);
+		build_rectangle_outline(line_vertices, annotation->get_min_x(), annotation->get_min_y(), annotation->get_max_x(), annotation->get_max_y(), color);
 	}
 }
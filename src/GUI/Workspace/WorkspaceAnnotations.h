@@ -23,6 +23,7 @@
 #define __WORKSPACEANNOTATIONS_H__
 
 #include "WorkspaceElement.h"
+#include "WorkspaceVertexBuilder.h"
 #include "GUI/Text/Text.h"
 
 namespace degate
@@ -71,6 +72,11 @@ namespace degate
 		 */
 		void update(Annotation_shptr& annotation);
 
+		/**
+		 * Upload the vertices of updated annotations.
+		 */
+		void flush() override;
+
 		/**
 	     * Draw all annotations (draw the square and outline buffers).
 	     * 
@@ -87,18 +93,22 @@ namespace degate
 
 	private:
 		/**
-		 * Create an annotation in OpenGL buffers.
+		 * Build the vertices of an annotation (CPU side only, thread safe).
 		 *
 		 * @param annotation : the annotation object.
-		 * @param index : the index of the annotation for OpenGL buffers.
+		 * @param vertices : where to write the square vertices (@see RECTANGLE_VERTICES_COUNT).
+		 * @param line_vertices : where to write the outline vertices (@see RECTANGLE_OUTLINE_VERTICES_COUNT).
 		 */
-		void create_annotation(Annotation_shptr& annotation, unsigned index);
+		void create_annotation(const Annotation_shptr& annotation, WorkspaceVertex2D* vertices, WorkspaceVertex2D* line_vertices) const;
 
 		/* Border buffer */
 		GLuint line_vbo = 0;
 		Text text;
 		unsigned annotations_count = 0;
 
+		WorkspaceVertexBuffer annotation_vertices{RECTANGLE_VERTICES_COUNT};
+		WorkspaceVertexBuffer annotation_line_vertices{RECTANGLE_OUTLINE_VERTICES_COUNT};
+
 	};
 }
 
@@ -78,43 +78,103 @@ namespace degate
 
 	void WorkspaceBackground::update()
 	{
-		free_textures();
-
 		if (project == nullptr)
+		{
+			free_textures();
 			return;
+		}
 
-		ScalingManager_shptr smgr = project->get_logic_model()->get_current_layer()->get_scaling_manager();
+		Layer_shptr layer = project->get_logic_model()->get_current_layer();
+		ScalingManager_shptr smgr = layer->get_scaling_manager();
+		const AffineTransform layer_alignment = layer->get_alignment();
 
-		if(smgr == nullptr)
+		// Same layer image, resident textures are still valid.
+		if (smgr == scaling_manager && layer_alignment == alignment && residency_manager != nullptr)
 			return;
 
-		ScalingManager<BackgroundImage>::image_map_element elem = smgr->get_image(1/*scale*/); //Todo: fix scaling manager
+		free_textures();
 
-		background_image = elem.second;
-		if (background_image == nullptr)
+		if (smgr == nullptr)
 			return;
 
-		context->glBindBuffer(GL_ARRAY_BUFFER, vbo);
+		scaling_manager = smgr;
+		alignment = layer_alignment;
+		residency_manager = std::make_shared<BackgroundResidencyManager>(scaling_manager);
 
-		context->glBufferData(GL_ARRAY_BUFFER, background_image->get_tiles_number() * 6 * sizeof(BackgroundVertex2D), nullptr, GL_STATIC_DRAW);
+		// Redraw when new tiles are available (the callback is called from the loading thread).
+		QWidget* widget = parent;
+		residency_manager->set_loaded_callback([widget]()
+		{
+			QMetaObject::invokeMethod(widget, "update", Qt::QueuedConnection);
+		});
+
+		residency_manager->set_viewport(viewport, scale);
+	}
+
+	void WorkspaceBackground::viewport_update(const BoundingBox& new_viewport, float new_scale)
+	{
+		viewport = new_viewport;
+		scale = new_scale;
+
+		if (residency_manager != nullptr)
+			residency_manager->set_viewport(viewport, scale);
+	}
 
-		unsigned index = 0;
-		for (unsigned int x = 0; x < background_image->get_width(); x += background_image->get_tile_size())
+	void WorkspaceBackground::draw(const QMatrix4x4& projection)
+	{
+		if (project == nullptr || residency_manager == nullptr)
+			return;
+
+		// Textures of evicted tiles are deleted before and after the upload of loaded tiles,
+		// since taking loaded tiles can evict others.
+		auto delete_evicted_textures = [this]()
 		{
-			for (unsigned int y = 0; y < background_image->get_height(); y += background_image->get_tile_size())
+			for (auto& key : residency_manager->take_evicted_tiles())
 			{
-				background_textures.push_back(create_background_tile(x, y, 1/*elem.first*/, index)); //Todo: fix scaling manager
+				auto it = background_textures.find(key);
+				if (it == background_textures.end())
+					continue;
 
-				index++;
+				context->glDeleteTextures(1, &it->second);
+				background_textures.erase(it);
 			}
+		};
+
+		delete_evicted_textures();
+
+		for (auto& tile : residency_manager->take_loaded_tiles())
+		{
+			auto it = background_textures.find(tile.key);
+			if (it != background_textures.end())
+				context->glDeleteTextures(1, &it->second);
+
+			background_textures[tile.key] = create_background_tile(tile);
+			residency_manager->release_staging_buffer(tile.data);
 		}
 
-		context->glBindBuffer(GL_ARRAY_BUFFER, 0);
-	}
+		delete_evicted_textures();
 
-	void WorkspaceBackground::draw(const QMatrix4x4& projection)
-	{
-		if (project == nullptr)
+		// Coarse levels first, so finer tiles are drawn on top of them (coarse tiles fill gaps while loading).
+		std::vector<GLuint> textures;
+		std::vector<BackgroundVertex2D> vertices;
+
+		for (auto it = background_textures.rbegin(); it != background_textures.rend(); ++it)
+		{
+			const BoundingBox box = residency_manager->get_tile_bounding_box(it->first);
+			if (!box.intersects(viewport))
+				continue;
+
+			textures.push_back(it->second);
+
+			vertices.push_back({QVector2D(box.get_min_x(), box.get_min_y()), QVector2D(0, 0)});
+			vertices.push_back({QVector2D(box.get_max_x(), box.get_min_y()), QVector2D(1, 0)});
+			vertices.push_back({QVector2D(box.get_min_x(), box.get_max_y()), QVector2D(0, 1)});
+			vertices.push_back({QVector2D(box.get_max_x(), box.get_min_y()), QVector2D(1, 0)});
+			vertices.push_back({QVector2D(box.get_min_x(), box.get_max_y()), QVector2D(0, 1)});
+			vertices.push_back({QVector2D(box.get_max_x(), box.get_max_y()), QVector2D(1, 1)});
+		}
+
+		if (textures.empty())
 			return;
 
 		program->bind();
@@ -123,6 +183,7 @@ namespace degate
 		program->setUniformValue("mvp", projection);
 
 		context->glBindBuffer(GL_ARRAY_BUFFER, vbo);
+		context->glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(BackgroundVertex2D), &vertices[0], GL_STREAM_DRAW);
 
 		program->enableAttributeArray("pos");
 		program->setAttributeBuffer("pos", GL_FLOAT, 0, 2, sizeof(BackgroundVertex2D));
@@ -130,13 +191,10 @@ namespace degate
 		program->enableAttributeArray("texCoord");
 		program->setAttributeBuffer("texCoord", GL_FLOAT, 2 * sizeof(float), 2, sizeof(BackgroundVertex2D));
 
-		unsigned index = 0;
-		for (auto& e : background_textures)
+		for (unsigned index = 0; index < textures.size(); index++)
 		{
-			context->glBindTexture(GL_TEXTURE_2D, e);
+			context->glBindTexture(GL_TEXTURE_2D, textures[index]);
 			context->glDrawArrays(GL_TRIANGLES, index * 6, 6);
-
-			index++;
 		}
 
 		context->glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -149,35 +207,24 @@ namespace degate
 
 	void WorkspaceBackground::free_textures()
 	{
+		// Stop the loading thread first.
+		residency_manager = nullptr;
+		scaling_manager = nullptr;
+
 		if(background_textures.empty())
 			return;
 
-		context->glDeleteTextures(background_textures.size(), &background_textures[0]);
+		for (auto& e : background_textures)
+			context->glDeleteTextures(1, &e.second);
 
 		background_textures.clear();
 	}
 
-	GLuint WorkspaceBackground::create_background_tile(unsigned x, unsigned y, float pre_scaling, unsigned index)
+	GLuint WorkspaceBackground::create_background_tile(const LoadedBackgroundTile& tile)
 	{
-		assert(project != nullptr);
-		assert(background_image != nullptr);
-
-		const unsigned int tile_width = background_image->get_tile_size();
-
-		// Real pixel coordinates
-		float min_x = (static_cast<float>(x)) * pre_scaling;
-		float min_y = (static_cast<float>(y)) * pre_scaling;
-		float max_x = min_x + static_cast<float>(tile_width) * pre_scaling;
-		float max_y = min_y + static_cast<float>(tile_width) * pre_scaling;
-
-
-		// Texture
+		assert(tile.data != nullptr);
 
-		auto data = new GLuint[tile_width * tile_width];
-		assert(data != nullptr);
-
-		memset(data, 0, tile_width * tile_width * sizeof(GLuint));
-		background_image->raw_copy(data, x, y);
+		const unsigned int tile_width = tile.tile_size;
 
 		GLuint texture = 0;
 
@@ -209,43 +256,11 @@ namespace degate
 		             0, // border
 		             GL_RGBA,
 		             GL_UNSIGNED_BYTE,
-		             data);
+		             tile.data->data());
 		assert(context->glGetError() == GL_NO_ERROR);
 
-		delete[] data;
-
 		context->glBindTexture(GL_TEXTURE_2D, 0);
 
-
-		// Vertices
-
-		BackgroundVertex2D temp;
-
-		temp.pos = QVector2D(min_x, min_y);
-		temp.texCoord = QVector2D(0, 0);
-		context->glBufferSubData(GL_ARRAY_BUFFER, index * 6 * sizeof(BackgroundVertex2D) + 0 * sizeof(BackgroundVertex2D), sizeof(BackgroundVertex2D), &temp);
-
-		temp.pos = QVector2D(max_x, min_y);
-		temp.texCoord = QVector2D(1, 0);
-		context->glBufferSubData(GL_ARRAY_BUFFER, index * 6 * sizeof(BackgroundVertex2D) + 1 * sizeof(BackgroundVertex2D), sizeof(BackgroundVertex2D), &temp);
-
-		temp.pos = QVector2D(min_x, max_y);
-		temp.texCoord = QVector2D(0, 1);
-		context->glBufferSubData(GL_ARRAY_BUFFER, index * 6 * sizeof(BackgroundVertex2D) + 2 * sizeof(BackgroundVertex2D), sizeof(BackgroundVertex2D), &temp);
-
-		temp.pos = QVector2D(max_x, min_y);
-		temp.texCoord = QVector2D(1, 0);
-		context->glBufferSubData(GL_ARRAY_BUFFER, index * 6 * sizeof(BackgroundVertex2D) + 3 * sizeof(BackgroundVertex2D), sizeof(BackgroundVertex2D), &temp);
-
-		temp.pos = QVector2D(min_x, max_y);
-		temp.texCoord = QVector2D(0, 1);
-		context->glBufferSubData(GL_ARRAY_BUFFER, index * 6 * sizeof(BackgroundVertex2D) + 4 * sizeof(BackgroundVertex2D), sizeof(BackgroundVertex2D), &temp);
-
-		temp.pos = QVector2D(max_x, max_y);
-		temp.texCoord = QVector2D(1, 1);
-		context->glBufferSubData(GL_ARRAY_BUFFER, index * 6 * sizeof(BackgroundVertex2D) + 5 * sizeof(BackgroundVertex2D), sizeof(BackgroundVertex2D), &temp);
-
-
 		return texture;
 	}
 }
@@ -23,8 +23,9 @@
 #define __WORKSPACEBACKGROUND_H__
 
 #include "WorkspaceElement.h"
+#include "BackgroundResidencyManager.h"
 
-#include <vector>
+#include <map>
 
 namespace degate
 {
@@ -32,6 +33,9 @@ namespace degate
 	/**
 	 * @class WorkspaceBackground
 	 * @brief Draw the current layer image (as background).
+	 *
+	 * Only tiles of the viewport are uploaded, from the pyramid level matching the zoom (@see BackgroundResidencyManager).
+	 * Tiles are loaded in the background, while they are not available tiles of coarser levels (if any) are drawn instead.
 	 */
 	class WorkspaceBackground : public WorkspaceElement
 	{
@@ -52,12 +56,20 @@ namespace degate
 		void init() override;
 
 		/**
-	     * Update the background (all textures are reloaded).
+	     * Update the background. Textures are reloaded only if the layer image or its alignment changed.
 	     */
 		void update() override;
 
 		/**
-	     * Draw the background (all tiles will be draw).
+		 * Update the viewport, this will schedule the load of the newly visible tiles.
+		 *
+		 * @param viewport : the new viewport.
+		 * @param scale : number of image pixels per screen pixel.
+		 */
+		void viewport_update(const BoundingBox& viewport, float scale);
+
+		/**
+	     * Draw the background (all resident tiles of the viewport will be draw).
 	     * 
 	     * @param projection : the projection matrix to apply. 
 	     */
@@ -70,19 +82,21 @@ namespace degate
 
 	private:
 		/**
-		 * Create a background tile (OpenGL texture and vertices).
-		 * 
-		 * @param x
-		 * @param y
-		 * @param pre_scaling : scaling of the image.
-		 * @param index : index of the tile.
+		 * Create the OpenGL texture of a loaded tile.
+		 *
+		 * @param tile : the loaded tile.
 		 *
 		 * @return Returns the OpenGL texture ID of the tile.
 		 */
-		GLuint create_background_tile(unsigned int x, unsigned int y, float pre_scaling, unsigned index);
+		GLuint create_background_tile(const LoadedBackgroundTile& tile);
+
+		std::map<BackgroundTileKey, GLuint> background_textures;
+		BackgroundResidencyManager_shptr residency_manager = nullptr;
+		ScalingManager_shptr scaling_manager = nullptr;
+		AffineTransform alignment;
 
-		std::vector<GLuint> background_textures;
-		BackgroundImage_shptr background_image = nullptr;
+		BoundingBox viewport;
+		float scale = 1;
 	};
 }
 
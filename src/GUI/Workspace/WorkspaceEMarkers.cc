@@ -25,13 +25,6 @@
 
 namespace degate
 {
-    struct EMarkersVertex2D
-    {
-        QVector2D pos;
-        QVector3D color;
-        float alpha;
-    };
-
     WorkspaceEMarkers::WorkspaceEMarkers(QWidget *parent) : WorkspaceElement(parent), text(parent)
     {
 
@@ -102,27 +95,32 @@ namespace degate
         }
         emarkers_count = emarkers.size();
 
+        emarker_vertices.resize(emarkers_count);
+
         if(emarkers_count == 0)
             return;
 
-        context->glBindBuffer(GL_ARRAY_BUFFER, vbo);
-
-        context->glBufferData(GL_ARRAY_BUFFER, emarkers_count * 6 * sizeof(EMarkersVertex2D), nullptr, GL_STATIC_DRAW);
-
-        context->glBindBuffer(GL_ARRAY_BUFFER, 0);
-
         unsigned text_size = 0;
 
         unsigned index = 0;
         for(auto& e : emarkers)
         {
-            create_emarker(e, index);
             e->set_index(index);
 
             text_size += e->get_name().length();
             index++;
         }
 
+        // Build all vertices on the CPU side (in parallel), then upload the buffer at once.
+
+        build_vertices(emarkers_count, [&](size_t begin, size_t end)
+        {
+            for(size_t i = begin; i < end; i++)
+                create_emarker(emarkers[i], emarker_vertices.get_object_vertices(i));
+        });
+
+        emarker_vertices.upload(context, vbo);
+
         text.update(text_size);
 
         unsigned text_offset = 0;
@@ -142,7 +140,18 @@ namespace degate
         if(emarker == nullptr)
             return;
 
-        create_emarker(emarker, emarker->get_index());
+        // Only the range of this emarker is updated, with the next flush.
+        WorkspaceVertex2D* vertices = emarker_vertices.update_object_vertices(emarker->get_index());
+
+        if(vertices == nullptr)
+            return;
+
+        create_emarker(emarker, vertices);
+    }
+
+    void WorkspaceEMarkers::flush()
+    {
+        emarker_vertices.flush(context, vbo);
     }
 
     void WorkspaceEMarkers::draw(const QMatrix4x4 &projection)
@@ -157,15 +166,15 @@ namespace degate
         context->glBindBuffer(GL_ARRAY_BUFFER, vbo);
 
         program->enableAttributeArray("pos");
-        program->setAttributeBuffer("pos", GL_FLOAT, 0, 2, sizeof(EMarkersVertex2D));
+        program->setAttributeBuffer("pos", GL_FLOAT, 0, 2, sizeof(WorkspaceVertex2D));
 
         program->enableAttributeArray("color");
-        program->setAttributeBuffer("color", GL_FLOAT, 2 * sizeof(float), 3, sizeof(EMarkersVertex2D));
+        program->setAttributeBuffer("color", GL_FLOAT, 2 * sizeof(float), 3, sizeof(WorkspaceVertex2D));
 
         program->enableAttributeArray("alpha");
-        program->setAttributeBuffer("alpha", GL_FLOAT, 5 * sizeof(float), 1, sizeof(EMarkersVertex2D));
+        program->setAttributeBuffer("alpha", GL_FLOAT, 5 * sizeof(float), 1, sizeof(WorkspaceVertex2D));
 
-        context->glDrawArrays(GL_TRIANGLES, 0, emarkers_count * 6);
+        context->glDrawArrays(GL_TRIANGLES, 0, emarkers_count * RECTANGLE_VERTICES_COUNT);
 
         context->glBindBuffer(GL_ARRAY_BUFFER, 0);
 
@@ -180,41 +189,16 @@ namespace degate
         text.draw(projection);
     }
 
-    void WorkspaceEMarkers::create_emarker(EMarker_shptr &emarker, unsigned int index)
+    void WorkspaceEMarkers::create_emarker(const EMarker_shptr& emarker, WorkspaceVertex2D* vertices) const
     {
-        if(emarker == nullptr)
-            return;
-
-        context->glBindBuffer(GL_ARRAY_BUFFER, vbo);
-
         // Vertices and colors
 
         color_t color = emarker->get_fill_color() == 0 ? project->get_default_color(DEFAULT_COLOR_EMARKER) : emarker->get_fill_color();
 
         color = highlight_color_by_state(color, emarker->get_highlighted());
 
-        EMarkersVertex2D temp;
-        temp.color = QVector3D(MASK_R(color) / 255.0, MASK_G(color) / 255.0, MASK_B(color) / 255.0);
-        temp.alpha = MASK_A(color) / 255.0;
+        const float radius = emarker->get_diameter() / 2.0;
 
-        temp.pos = QVector2D(emarker->get_x() - emarker->get_diameter() / 2.0, emarker->get_y() - emarker->get_diameter() / 2.0);
-        context->glBufferSubData(GL_ARRAY_BUFFER, index * 6 * sizeof(EMarkersVertex2D) + 0 * sizeof(EMarkersVertex2D), sizeof(EMarkersVertex2D), &temp);
-
-        temp.pos = QVector2D(emarker->get_x() + emarker->get_diameter() / 2.0, emarker->get_y() - emarker->get_diameter() / 2.0);
-        context->glBufferSubData(GL_ARRAY_BUFFER, index * 6 * sizeof(EMarkersVertex2D) + 1 * sizeof(EMarkersVertex2D), sizeof(EMarkersVertex2D), &temp);
-
-        temp.pos = QVector2D(emarker->get_x() + emarker->get_diameter() / 2.0, emarker->get_y() + emarker->get_diameter() / 2.0);
-        context->glBufferSubData(GL_ARRAY_BUFFER, index * 6 * sizeof(EMarkersVertex2D) + 2 * sizeof(EMarkersVertex2D), sizeof(EMarkersVertex2D), &temp);
-
-        temp.pos = QVector2D(emarker->get_x() - emarker->get_diameter() / 2.0, emarker->get_y() - emarker->get_diameter() / 2.0);
-        context->glBufferSubData(GL_ARRAY_BUFFER, index * 6 * sizeof(EMarkersVertex2D) + 4 * sizeof(EMarkersVertex2D), sizeof(EMarkersVertex2D), &temp);
-
-        temp.pos = QVector2D(emarker->get_x() - emarker->get_diameter() / 2.0, emarker->get_y() + emarker->get_diameter() / 2.0);
-        context->glBufferSubData(GL_ARRAY_BUFFER, index * 6 * sizeof(EMarkersVertex2D) + 3 * sizeof(EMarkersVertex2D), sizeof(EMarkersVertex2D), &temp);
-
-        temp.pos = QVector2D(emarker->get_x() + emarker->get_diameter() / 2.0, emarker->get_y() + emarker->get_diameter() / 2.0);
-        context->glBufferSubData(GL_ARRAY_BUFFER, index * 6 * sizeof(EMarkersVertex2D) + 5 * sizeof(EMarkersVertex2D), sizeof(EMarkersVertex2D), &temp);
-
-        context->glBindBuffer(GL_ARRAY_BUFFER, 0);
+        build_rectangle(vertices, emarker->get_x() - radius, emarker->get_y() - radius, emarker->get_x() + radius, emarker->get_y() + radius, color);
     }
-}
\ No newline at end of file
+}
@@ -23,6 +23,7 @@
 #define __WORKSPACEEMARKER_H__
 
 #include <GUI/Workspace/WorkspaceElement.h>
+#include <GUI/Workspace/WorkspaceVertexBuilder.h>
 #include <Core/LogicModel/EMarker/EMarker.h>
 #include <GUI/Text/Text.h>
 
@@ -69,6 +70,11 @@ namespace degate
          */
         void update(EMarker_shptr& emarker);
 
+        /**
+         * Upload the vertices of updated emarkers.
+         */
+        void flush() override;
+
         /**
          * Draw all emarkers (draw the square and outline buffers).
          *
@@ -85,16 +91,18 @@ namespace degate
 
     private:
         /**
-		 * Create an emarker in OpenGL buffers.
+		 * Build the vertices of an emarker (CPU side only, thread safe).
 		 *
 		 * @param emarker : the emarker object.
-		 * @param index : the index of the annotation for OpenGL buffers.
+		 * @param vertices : where to write the vertices (@see RECTANGLE_VERTICES_COUNT).
 		 */
-        void create_emarker(EMarker_shptr& emarker, unsigned index);
+        void create_emarker(const EMarker_shptr& emarker, WorkspaceVertex2D* vertices) const;
 
         Text text;
         unsigned emarkers_count = 0;
 
+        WorkspaceVertexBuffer emarker_vertices{RECTANGLE_VERTICES_COUNT};
+
     };
 }
 
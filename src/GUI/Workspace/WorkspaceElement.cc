@@ -52,4 +52,8 @@ namespace degate
 
 		context->glGenBuffers(1, &vbo);
 	}
+
+	void WorkspaceElement::flush()
+	{
+	}
 }
@@ -74,6 +74,12 @@ namespace degate
 	     */
 		virtual void update() = 0;
 
+		/**
+	     * Upload the vertices of objects that were updated since the last frame.
+	     * Called once per frame before drawing.
+	     */
+		virtual void flush();
+
 		/**
 	     * Draw.
 	     * 
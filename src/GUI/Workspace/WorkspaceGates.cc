@@ -25,13 +25,6 @@
 
 namespace degate
 {
-	struct GatesVertex2D
-	{
-		QVector2D pos;
-		QVector3D color;
-		float alpha;
-	};
-
     WorkspaceGates::WorkspaceGates(QWidget* parent)
             : WorkspaceElement(parent),
               gate_template_name_text(parent),
@@ -95,27 +88,31 @@ namespace degate
 
 	void WorkspaceGates::update()
 	{
-		if(project == nullptr || project->get_logic_model()->get_gates_count() == 0)
+		if(project == nullptr)
 			return;
 
-		context->glBindBuffer(GL_ARRAY_BUFFER, vbo);
-
-		context->glBufferData(GL_ARRAY_BUFFER, project->get_logic_model()->get_gates_count() * 6 * sizeof(GatesVertex2D), nullptr, GL_STATIC_DRAW);
-
-		context->glBindBuffer(GL_ARRAY_BUFFER, line_vbo);
-
-		context->glBufferData(GL_ARRAY_BUFFER, project->get_logic_model()->get_gates_count() * 8 * sizeof(GatesVertex2D), nullptr, GL_STATIC_DRAW);
-
-		context->glBindBuffer(GL_ARRAY_BUFFER, 0);
+		if(project->get_logic_model()->get_gates_count() == 0)
+		{
+			gate_vertices.resize(0);
+			gate_line_vertices.resize(0);
+			port_vertices.resize(0);
+			return;
+		}
 
 		unsigned gate_template_name_text_size = 0;
 		unsigned port_name_text_size = 0;
         ports_count = 0;
 
+		std::vector<Gate_shptr> gates;
+		std::vector<unsigned> ports_offsets;
+		gates.reserve(project->get_logic_model()->get_gates_count());
+		ports_offsets.reserve(project->get_logic_model()->get_gates_count());
+
 		unsigned index = 0;
 		for(LogicModel::gate_collection::iterator iter = project->get_logic_model()->gates_begin(); iter != project->get_logic_model()->gates_end(); ++iter)
 		{
-			create_gate(iter->second, index);
+			gates.push_back(iter->second);
+			ports_offsets.push_back(ports_count);
 			iter->second->set_index(index);
 
             gate_template_name_text_size += iter->second->get_gate_template()->get_name().length();
@@ -133,47 +130,57 @@ namespace degate
 			index++;
 		}
 
-        gate_template_name_text.update(gate_template_name_text_size);
-        port_name_text.update(port_name_text_size);
+		// Build all vertices on the CPU side (in parallel), then upload each buffer at once.
 
-		context->glBindBuffer(GL_ARRAY_BUFFER, port_vbo);
+		gate_vertices.resize(gates.size());
+		gate_line_vertices.resize(gates.size());
+		port_vertices.resize(ports_count);
+
+		build_vertices(gates.size(), [&](size_t begin, size_t end)
+		{
+			for(size_t i = begin; i < end; i++)
+			{
+				create_gate(gates[i], gate_vertices.get_object_vertices(i), gate_line_vertices.get_object_vertices(i));
 
-		context->glBufferData(GL_ARRAY_BUFFER, ports_count * 9 * sizeof(GatesVertex2D), nullptr, GL_STATIC_DRAW);
+				if(gates[i]->get_ports_number() > 0)
+					create_ports(gates[i], ports_offsets[i], port_vertices.get_object_vertices(ports_offsets[i]));
+			}
+		});
 
-		context->glBindBuffer(GL_ARRAY_BUFFER, 0);
+		gate_vertices.upload(context, vbo);
+		gate_line_vertices.upload(context, line_vbo);
+		port_vertices.upload(context, port_vbo);
+
+        gate_template_name_text.update(gate_template_name_text_size);
+        port_name_text.update(port_name_text_size);
 
 		unsigned gate_template_name_text_offset = 0;
 		unsigned port_name_text_offset = 0;
-		unsigned ports_index = 0;
 
-		for(auto iter = project->get_logic_model()->gates_begin(); iter != project->get_logic_model()->gates_end(); ++iter)
+		for(auto& gate : gates)
 		{
-		    std::string text = iter->second->get_gate_template()->get_name();
+		    std::string text = gate->get_gate_template()->get_name();
 
-            if(!iter->second->get_name().empty())
-                text += " [" + iter->second->get_name() + "]";
+            if(!gate->get_name().empty())
+                text += " [" + gate->get_name() + "]";
 
             gate_template_name_text.add_sub_text(gate_template_name_text_offset,
-                                                 iter->second->get_min_x() + TEXT_PADDING,
-                                                 iter->second->get_min_y() + TEXT_PADDING,
+                                                 gate->get_min_x() + TEXT_PADDING,
+                                                 gate->get_min_y() + TEXT_PADDING,
                                                  text.c_str(),
                                                  10,
                                                  QVector3D(255, 255, 255),
                                                  1,
                                                  false,
                                                  false,
-                                                 iter->second->get_max_x() - iter->second->get_min_x() - TEXT_PADDING * 2);
+                                                 gate->get_max_x() - gate->get_min_x() - TEXT_PADDING * 2);
 
-			create_ports(iter->second, ports_index);
+            gate_template_name_text_offset += gate->get_gate_template()->get_name().length();
 
-            gate_template_name_text_offset += iter->second->get_gate_template()->get_name().length();
+            if(!gate->get_name().empty())
+                gate_template_name_text_offset += gate->get_name().length() + 3;
 
-            if(!iter->second->get_name().empty())
-                gate_template_name_text_offset += iter->second->get_name().length() + 3;
-
-			ports_index += iter->second->get_ports_number();
-
-			for(auto port_iter = iter->second->ports_begin(); port_iter != iter->second->ports_end(); ++port_iter)
+			for(auto port_iter = gate->ports_begin(); port_iter != gate->ports_end(); ++port_iter)
 			{
 				unsigned x = (*port_iter)->get_x();
 				unsigned y = (*port_iter)->get_y() + (*port_iter)->get_diameter() / 2.0 + TEXT_PADDING;
@@ -197,7 +204,21 @@ namespace degate
 		if(gate == nullptr)
 			return;
 
-		create_gate(gate, gate->get_index());
+		// Only the range of this gate is updated, with the next flush.
+		WorkspaceVertex2D* vertices = gate_vertices.update_object_vertices(gate->get_index());
+		WorkspaceVertex2D* line_vertices = gate_line_vertices.update_object_vertices(gate->get_index());
+
+		if(vertices == nullptr || line_vertices == nullptr)
+			return;
+
+		create_gate(gate, vertices, line_vertices);
+	}
+
+	void WorkspaceGates::flush()
+	{
+		gate_vertices.flush(context, vbo);
+		gate_line_vertices.flush(context, line_vbo);
+		port_vertices.flush(context, port_vbo);
 	}
 
 	void WorkspaceGates::draw(const QMatrix4x4& projection)
@@ -212,28 +233,28 @@ namespace degate
 		context->glBindBuffer(GL_ARRAY_BUFFER, vbo);
 
 		program->enableAttributeArray("pos");
-		program->setAttributeBuffer("pos", GL_FLOAT, 0, 2, sizeof(GatesVertex2D));
+		program->setAttributeBuffer("pos", GL_FLOAT, 0, 2, sizeof(WorkspaceVertex2D));
 
 		program->enableAttributeArray("color");
-		program->setAttributeBuffer("color", GL_FLOAT, 2 * sizeof(float), 3, sizeof(GatesVertex2D));
+		program->setAttributeBuffer("color", GL_FLOAT, 2 * sizeof(float), 3, sizeof(WorkspaceVertex2D));
 
 		program->enableAttributeArray("alpha");
-		program->setAttributeBuffer("alpha", GL_FLOAT, 5 * sizeof(float), 1, sizeof(GatesVertex2D));
+		program->setAttributeBuffer("alpha", GL_FLOAT, 5 * sizeof(float), 1, sizeof(WorkspaceVertex2D));
 
-		context->glDrawArrays(GL_TRIANGLES, 0, project->get_logic_model()->get_gates_count() * 6);
+		context->glDrawArrays(GL_TRIANGLES, 0, project->get_logic_model()->get_gates_count() * RECTANGLE_VERTICES_COUNT);
 
 		context->glBindBuffer(GL_ARRAY_BUFFER, line_vbo);
 
 		program->enableAttributeArray("pos");
-		program->setAttributeBuffer("pos", GL_FLOAT, 0, 2, sizeof(GatesVertex2D));
+		program->setAttributeBuffer("pos", GL_FLOAT, 0, 2, sizeof(WorkspaceVertex2D));
 
 		program->enableAttributeArray("color");
-		program->setAttributeBuffer("color", GL_FLOAT, 2 * sizeof(float), 3, sizeof(GatesVertex2D));
+		program->setAttributeBuffer("color", GL_FLOAT, 2 * sizeof(float), 3, sizeof(WorkspaceVertex2D));
 
 		program->enableAttributeArray("alpha");
-		program->setAttributeBuffer("alpha", GL_FLOAT, 5 * sizeof(float), 1, sizeof(GatesVertex2D));
+		program->setAttributeBuffer("alpha", GL_FLOAT, 5 * sizeof(float), 1, sizeof(WorkspaceVertex2D));
 
-		context->glDrawArrays(GL_LINES, 0, project->get_logic_model()->get_gates_count() * 8);
+		context->glDrawArrays(GL_LINES, 0, project->get_logic_model()->get_gates_count() * RECTANGLE_OUTLINE_VERTICES_COUNT);
 
 		context->glBindBuffer(GL_ARRAY_BUFFER, 0);
 
@@ -260,15 +281,15 @@ namespace degate
 		context->glBindBuffer(GL_ARRAY_BUFFER, port_vbo);
 
 		program->enableAttributeArray("pos");
-		program->setAttributeBuffer("pos", GL_FLOAT, 0, 2, sizeof(GatesVertex2D));
+		program->setAttributeBuffer("pos", GL_FLOAT, 0, 2, sizeof(WorkspaceVertex2D));
 
 		program->enableAttributeArray("color");
-		program->setAttributeBuffer("color", GL_FLOAT, 2 * sizeof(float), 3, sizeof(GatesVertex2D));
+		program->setAttributeBuffer("color", GL_FLOAT, 2 * sizeof(float), 3, sizeof(WorkspaceVertex2D));
 
 		program->enableAttributeArray("alpha");
-		program->setAttributeBuffer("alpha", GL_FLOAT, 5 * sizeof(float), 1, sizeof(GatesVertex2D));
+		program->setAttributeBuffer("alpha", GL_FLOAT, 5 * sizeof(float), 1, sizeof(WorkspaceVertex2D));
 
-		context->glDrawArrays(GL_TRIANGLES, 0, ports_count * 9);
+		context->glDrawArrays(GL_TRIANGLES, 0, ports_count * PORT_VERTICES_COUNT);
 
 		context->glBindBuffer(GL_ARRAY_BUFFER, 0);
 
@@ -283,41 +304,15 @@ namespace degate
         port_name_text.draw(projection);
 	}
 
-	void WorkspaceGates::create_gate(Gate_shptr& gate, unsigned index)
+	void WorkspaceGates::create_gate(const Gate_shptr& gate, WorkspaceVertex2D* vertices, WorkspaceVertex2D* line_vertices) const
 	{
-		if(gate == nullptr)
-			return;
-
-		context->glBindBuffer(GL_ARRAY_BUFFER, vbo);
-
-
 		// Vertices and colors
 
         color_t color = gate->get_gate_template()->get_fill_color() == 0 ? project->get_default_color(DEFAULT_COLOR_GATE) : gate->get_gate_template()->get_fill_color();
 
 		color = highlight_color_by_state(color, gate->get_highlighted());
 
-		GatesVertex2D temp;
-		temp.color = QVector3D(MASK_R(color) / 255.0, MASK_G(color) / 255.0, MASK_B(color) / 255.0);
-		temp.alpha = MASK_A(color) / 255.0;
-
-		temp.pos = QVector2D(gate->get_min_x(), gate->get_min_y());
-		context->glBufferSubData(GL_ARRAY_BUFFER, index * 6 * sizeof(GatesVertex2D) + 0 * sizeof(GatesVertex2D), sizeof(GatesVertex2D), &temp);
-
-		temp.pos = QVector2D(gate->get_max_x(), gate->get_min_y());
-		context->glBufferSubData(GL_ARRAY_BUFFER, index * 6 * sizeof(GatesVertex2D) + 1 * sizeof(GatesVertex2D), sizeof(GatesVertex2D), &temp);
-
-		temp.pos = QVector2D(gate->get_min_x(), gate->get_max_y());
-		context->glBufferSubData(GL_ARRAY_BUFFER, index * 6 * sizeof(GatesVertex2D) + 2 * sizeof(GatesVertex2D), sizeof(GatesVertex2D), &temp);
-
-		temp.pos = QVector2D(gate->get_max_x(), gate->get_min_y());
-		context->glBufferSubData(GL_ARRAY_BUFFER, index * 6 * sizeof(GatesVertex2D) + 4 * sizeof(GatesVertex2D), sizeof(GatesVertex2D), &temp);
-
-		temp.pos = QVector2D(gate->get_min_x(), gate->get_max_y());
-		context->glBufferSubData(GL_ARRAY_BUFFER, index * 6 * sizeof(GatesVertex2D) + 3 * sizeof(GatesVertex2D), sizeof(GatesVertex2D), &temp);
-
-		temp.pos = QVector2D(gate->get_max_x(), gate->get_max_y());
-		context->glBufferSubData(GL_ARRAY_BUFFER, index * 6 * sizeof(GatesVertex2D) + 5 * sizeof(GatesVertex2D), sizeof(GatesVertex2D), &temp);
+		build_rectangle(vertices, gate->get_min_x(), gate->get_min_y(), gate->get_max_x(), gate->get_max_y(), color);
 
 
 		// Lines
@@ -326,147 +321,17 @@ namespace degate
 
         color = highlight_color_by_state(color, gate->get_highlighted());
 
-		context->glBindBuffer(GL_ARRAY_BUFFER, line_vbo);
-
-		temp.color = QVector3D(MASK_R(color) / 255.0, MASK_G(color) / 255.0, MASK_B(color) / 255.0);
-		temp.alpha = MASK_A(color) / 255.0;
-
-		temp.pos = QVector2D(gate->get_min_x(), gate->get_min_y());
-		context->glBufferSubData(GL_ARRAY_BUFFER, index * 8 * sizeof(GatesVertex2D) + 0 * sizeof(GatesVertex2D), sizeof(GatesVertex2D), &temp);
-
-		temp.pos = QVector2D(gate->get_max_x(), gate->get_min_y());
-		context->glBufferSubData(GL_ARRAY_BUFFER, index * 8 * sizeof(GatesVertex2D) + 1 * sizeof(GatesVertex2D), sizeof(GatesVertex2D), &temp);
-
-		temp.pos = QVector2D(gate->get_min_x(), gate->get_min_y());
-		context->glBufferSubData(GL_ARRAY_BUFFER, index * 8 * sizeof(GatesVertex2D) + 2 * sizeof(GatesVertex2D), sizeof(GatesVertex2D), &temp);
-
-		temp.pos = QVector2D(gate->get_min_x(), gate->get_max_y());
-		context->glBufferSubData(GL_ARRAY_BUFFER, index * 8 * sizeof(GatesVertex2D) + 3 * sizeof(GatesVertex2D), sizeof(GatesVertex2D), &temp);
-
-		temp.pos = QVector2D(gate->get_max_x(), gate->get_min_y());
-		context->glBufferSubData(GL_ARRAY_BUFFER, index * 8 * sizeof(GatesVertex2D) + 4 * sizeof(GatesVertex2D), sizeof(GatesVertex2D), &temp);
-
-		temp.pos = QVector2D(gate->get_max_x(), gate->get_max_y());
-		context->glBufferSubData(GL_ARRAY_BUFFER, index * 8 * sizeof(GatesVertex2D) + 5 * sizeof(GatesVertex2D), sizeof(GatesVertex2D), &temp);
-
-		temp.pos = QVector2D(gate->get_min_x(), gate->get_max_y());
-		context->glBufferSubData(GL_ARRAY_BUFFER, index * 8 * sizeof(GatesVertex2D) + 6 * sizeof(GatesVertex2D), sizeof(GatesVertex2D), &temp);
-
-		temp.pos = QVector2D(gate->get_max_x(), gate->get_max_y());
-		context->glBufferSubData(GL_ARRAY_BUFFER, index * 8 * sizeof(GatesVertex2D) + 7 * sizeof(GatesVertex2D), sizeof(GatesVertex2D), &temp);
-
-		context->glBindBuffer(GL_ARRAY_BUFFER, 0);
+		build_rectangle_outline(line_vertices, gate->get_min_x(), gate->get_min_y(), gate->get_max_x(), gate->get_max_y(), color);
 	}
 
-	void draw_port_in_out(QOpenGLFunctions* context, float x, float y, unsigned size, QVector3D color, float alpha, unsigned offset)
+	void WorkspaceGates::create_port(const GatePort_shptr& port, WorkspaceVertex2D* vertices) const
 	{
-		GatesVertex2D temp;
-
-		temp.color = color;
-		temp.alpha = alpha;
-
-		int mid = size / 2.0;
-
-		temp.pos = QVector2D(x - mid, y - mid);
-		context->glBufferSubData(GL_ARRAY_BUFFER, offset * 9 * sizeof(GatesVertex2D) + 0 * sizeof(GatesVertex2D), sizeof(GatesVertex2D), &temp);
-
-		temp.pos = QVector2D(x - mid, y + mid);
-		context->glBufferSubData(GL_ARRAY_BUFFER, offset * 9 * sizeof(GatesVertex2D) + 1 * sizeof(GatesVertex2D), sizeof(GatesVertex2D), &temp);
-
-		temp.pos = QVector2D(x + mid, y - mid);
-		context->glBufferSubData(GL_ARRAY_BUFFER, offset * 9 * sizeof(GatesVertex2D) + 2 * sizeof(GatesVertex2D), sizeof(GatesVertex2D), &temp);
-
-		temp.pos = QVector2D(x + mid, y - mid);
-		context->glBufferSubData(GL_ARRAY_BUFFER, offset * 9 * sizeof(GatesVertex2D) + 3 * sizeof(GatesVertex2D), sizeof(GatesVertex2D), &temp);
-
-		temp.pos = QVector2D(x, y);
-		context->glBufferSubData(GL_ARRAY_BUFFER, offset * 9 * sizeof(GatesVertex2D) + 4 * sizeof(GatesVertex2D), sizeof(GatesVertex2D), &temp);
-
-		temp.pos = QVector2D(x + mid, y + mid);
-		context->glBufferSubData(GL_ARRAY_BUFFER, offset * 9 * sizeof(GatesVertex2D) + 5 * sizeof(GatesVertex2D), sizeof(GatesVertex2D), &temp);
-
-		temp.pos = QVector2D(x, y);
-		context->glBufferSubData(GL_ARRAY_BUFFER, offset * 9 * sizeof(GatesVertex2D) + 6 * sizeof(GatesVertex2D), sizeof(GatesVertex2D), &temp);
-
-		temp.pos = QVector2D(x + mid, y + mid);
-		context->glBufferSubData(GL_ARRAY_BUFFER, offset * 9 * sizeof(GatesVertex2D) + 7 * sizeof(GatesVertex2D), sizeof(GatesVertex2D), &temp);
-
-		temp.pos = QVector2D(x - mid, y + mid);
-		context->glBufferSubData(GL_ARRAY_BUFFER, offset * 9 * sizeof(GatesVertex2D) + 8 * sizeof(GatesVertex2D), sizeof(GatesVertex2D), &temp);
-	}
-
-	void draw_port_in(QOpenGLFunctions* context, float x, float y, unsigned size, QVector3D color, float alpha, unsigned offset)
-	{
-		GatesVertex2D temp;
-
-		temp.color = color;
-		temp.alpha = alpha;
-
-		int mid = size / 2.0;
-
-		temp.pos = QVector2D(x - mid, y - mid);
-		context->glBufferSubData(GL_ARRAY_BUFFER, offset * 9 * sizeof(GatesVertex2D) + 0 * sizeof(GatesVertex2D), sizeof(GatesVertex2D), &temp);
-
-		temp.pos = QVector2D(x + mid, y - mid);
-		context->glBufferSubData(GL_ARRAY_BUFFER, offset * 9 * sizeof(GatesVertex2D) + 1 * sizeof(GatesVertex2D), sizeof(GatesVertex2D), &temp);
-
-		temp.pos = QVector2D(x, y);
-		context->glBufferSubData(GL_ARRAY_BUFFER, offset * 9 * sizeof(GatesVertex2D) + 2 * sizeof(GatesVertex2D), sizeof(GatesVertex2D), &temp);
-
-		temp.pos = QVector2D(x + mid, y - mid);
-		context->glBufferSubData(GL_ARRAY_BUFFER, offset * 9 * sizeof(GatesVertex2D) + 3 * sizeof(GatesVertex2D), sizeof(GatesVertex2D), &temp);
-
-		temp.pos = QVector2D(x + mid, y + mid);
-		context->glBufferSubData(GL_ARRAY_BUFFER, offset * 9 * sizeof(GatesVertex2D) + 4 * sizeof(GatesVertex2D), sizeof(GatesVertex2D), &temp);
-
-		temp.pos = QVector2D(x, y);
-		context->glBufferSubData(GL_ARRAY_BUFFER, offset * 9 * sizeof(GatesVertex2D) + 5 * sizeof(GatesVertex2D), sizeof(GatesVertex2D), &temp);
-
-		temp.pos = QVector2D(x + mid, y + mid);
-		context->glBufferSubData(GL_ARRAY_BUFFER, offset * 9 * sizeof(GatesVertex2D) + 6 * sizeof(GatesVertex2D), sizeof(GatesVertex2D), &temp);
-
-		temp.pos = QVector2D(x - mid, y + mid);
-		context->glBufferSubData(GL_ARRAY_BUFFER, offset * 9 * sizeof(GatesVertex2D) + 7 * sizeof(GatesVertex2D), sizeof(GatesVertex2D), &temp);
-
-		temp.pos = QVector2D(x, y);
-		context->glBufferSubData(GL_ARRAY_BUFFER, offset * 9 * sizeof(GatesVertex2D) + 8 * sizeof(GatesVertex2D), sizeof(GatesVertex2D), &temp);
-	}
-
-	void draw_port_out(QOpenGLFunctions* context, float x, float y, unsigned size, QVector3D color, float alpha, unsigned offset)
-	{
-		GatesVertex2D temp;
-
-		temp.color = color;
-		temp.alpha = alpha;
-
-		int mid = size / 2.0;
-
-		temp.pos = QVector2D(x - mid, y - mid);
-		context->glBufferSubData(GL_ARRAY_BUFFER, offset * 9 * sizeof(GatesVertex2D) + 0 * sizeof(GatesVertex2D), sizeof(GatesVertex2D), &temp);
-
-		temp.pos = QVector2D(x, y - mid);
-		context->glBufferSubData(GL_ARRAY_BUFFER, offset * 9 * sizeof(GatesVertex2D) + 1 * sizeof(GatesVertex2D), sizeof(GatesVertex2D), &temp);
-
-		temp.pos = QVector2D(x, y + mid);
-		context->glBufferSubData(GL_ARRAY_BUFFER, offset * 9 * sizeof(GatesVertex2D) + 2 * sizeof(GatesVertex2D), sizeof(GatesVertex2D), &temp);
-
-		temp.pos = QVector2D(x - mid, y - mid);
-		context->glBufferSubData(GL_ARRAY_BUFFER, offset * 9 * sizeof(GatesVertex2D) + 3 * sizeof(GatesVertex2D), sizeof(GatesVertex2D), &temp);
-
-		temp.pos = QVector2D(x - mid, y + mid);
-		context->glBufferSubData(GL_ARRAY_BUFFER, offset * 9 * sizeof(GatesVertex2D) + 4 * sizeof(GatesVertex2D), sizeof(GatesVertex2D), &temp);
-
-		temp.pos = QVector2D(x, y + mid);
-		context->glBufferSubData(GL_ARRAY_BUFFER, offset * 9 * sizeof(GatesVertex2D) + 5 * sizeof(GatesVertex2D), sizeof(GatesVertex2D), &temp);
-
-		temp.pos = QVector2D(x, y - mid);
-		context->glBufferSubData(GL_ARRAY_BUFFER, offset * 9 * sizeof(GatesVertex2D) + 6 * sizeof(GatesVertex2D), sizeof(GatesVertex2D), &temp);
+		GateTemplatePort_shptr tmpl_port = port->get_template_port();
+		color_t color = tmpl_port->get_fill_color() == 0 ? project->get_default_color(DEFAULT_COLOR_GATE_PORT) : tmpl_port->get_fill_color();
 
-		temp.pos = QVector2D(x + mid, y);
-		context->glBufferSubData(GL_ARRAY_BUFFER, offset * 9 * sizeof(GatesVertex2D) + 7 * sizeof(GatesVertex2D), sizeof(GatesVertex2D), &temp);
+		color = highlight_color_by_state(color, port->get_highlighted());
 
-		temp.pos = QVector2D(x, y + mid);
-		context->glBufferSubData(GL_ARRAY_BUFFER, offset * 9 * sizeof(GatesVertex2D) + 8 * sizeof(GatesVertex2D), sizeof(GatesVertex2D), &temp);
+		build_port(vertices, tmpl_port->get_port_type(), port->get_x(), port->get_y(), port->get_diameter(), color);
 	}
 
 	void WorkspaceGates::update(GatePort_shptr& port)
@@ -474,71 +339,25 @@ namespace degate
 		if(port == nullptr)
 			return;
 
-		context->glBindBuffer(GL_ARRAY_BUFFER, port_vbo);
-
-		GateTemplatePort_shptr tmpl_port = port->get_template_port();
-		color_t color = tmpl_port->get_fill_color() == 0 ? project->get_default_color(DEFAULT_COLOR_GATE_PORT) : tmpl_port->get_fill_color();
+		// Only the range of this port is updated, with the next flush.
+		WorkspaceVertex2D* vertices = port_vertices.update_object_vertices(port->get_index());
 
-		color = highlight_color_by_state(color, port->get_highlighted());
-
-		switch(tmpl_port->get_port_type()) 
-		{
-			case GateTemplatePort::PORT_TYPE_UNDEFINED:
-				draw_port_in_out(context, port->get_x(), port->get_y(), port->get_diameter(), QVector3D(MASK_R(color) / 255.0, MASK_G(color) / 255.0, MASK_B(color) / 255.0), MASK_A(color) / 255.0, port->get_index());
-				break;
-		    case GateTemplatePort::PORT_TYPE_IN:
-			    draw_port_in(context, port->get_x(), port->get_y(), port->get_diameter(), QVector3D(MASK_R(color) / 255.0, MASK_G(color) / 255.0, MASK_B(color) / 255.0), MASK_A(color) / 255.0, port->get_index());
-			    break;
-		    case GateTemplatePort::PORT_TYPE_OUT:
-			    draw_port_out(context, port->get_x(), port->get_y(), port->get_diameter(), QVector3D(MASK_R(color) / 255.0, MASK_G(color) / 255.0, MASK_B(color) / 255.0), MASK_A(color) / 255.0, port->get_index());
-			    break;
-		    case GateTemplatePort::PORT_TYPE_INOUT:
-			    draw_port_in_out(context, port->get_x(), port->get_y(), port->get_diameter(), QVector3D(MASK_R(color) / 255.0, MASK_G(color) / 255.0, MASK_B(color) / 255.0), MASK_A(color) / 255.0, port->get_index());
-			    break;
-			default:
-				draw_port_in_out(context, port->get_x(), port->get_y(), port->get_diameter(), QVector3D(MASK_R(color) / 255.0, MASK_G(color) / 255.0, MASK_B(color) / 255.0), MASK_A(color) / 255.0, port->get_index());
-				break;
-		}
+		if(vertices == nullptr)
+			return;
 
-		context->glBindBuffer(GL_ARRAY_BUFFER, 0);
+		create_port(port, vertices);
 	}
 
-	void WorkspaceGates::create_ports(Gate_shptr& gate, unsigned index)
+	void WorkspaceGates::create_ports(const Gate_shptr& gate, unsigned index, WorkspaceVertex2D* vertices) const
 	{
-		context->glBindBuffer(GL_ARRAY_BUFFER, port_vbo);
-
 		for(Gate::port_iterator iter = gate->ports_begin(); iter != gate->ports_end(); ++iter)
 		{
-			GatePort_shptr port = *iter;
-			GateTemplatePort_shptr tmpl_port = port->get_template_port();
-			color_t color = tmpl_port->get_fill_color() == 0 ? project->get_default_color(DEFAULT_COLOR_GATE_PORT) : tmpl_port->get_fill_color();
-
-			color = highlight_color_by_state(color, port->get_highlighted());
+			create_port(*iter, vertices);
 
-			switch(tmpl_port->get_port_type()) 
-			{
-				case GateTemplatePort::PORT_TYPE_UNDEFINED:
-					draw_port_in_out(context, port->get_x(), port->get_y(), port->get_diameter(), QVector3D(MASK_R(color) / 255.0, MASK_G(color) / 255.0, MASK_B(color) / 255.0), MASK_A(color) / 255.0, index);
-					break;
-			    case GateTemplatePort::PORT_TYPE_IN:
-				    draw_port_in(context, port->get_x(), port->get_y(), port->get_diameter(), QVector3D(MASK_R(color) / 255.0, MASK_G(color) / 255.0, MASK_B(color) / 255.0), MASK_A(color) / 255.0, index);
-				    break;
-			    case GateTemplatePort::PORT_TYPE_OUT:
-				    draw_port_out(context, port->get_x(), port->get_y(), port->get_diameter(), QVector3D(MASK_R(color) / 255.0, MASK_G(color) / 255.0, MASK_B(color) / 255.0), MASK_A(color) / 255.0, index);
-				    break;
-			    case GateTemplatePort::PORT_TYPE_INOUT:
-				    draw_port_in_out(context, port->get_x(), port->get_y(), port->get_diameter(), QVector3D(MASK_R(color) / 255.0, MASK_G(color) / 255.0, MASK_B(color) / 255.0), MASK_A(color) / 255.0, index);
-				    break;
-				default:
-					draw_port_in_out(context, port->get_x(), port->get_y(), port->get_diameter(), QVector3D(MASK_R(color) / 255.0, MASK_G(color) / 255.0, MASK_B(color) / 255.0), MASK_A(color) / 255.0, index);
-					break;
-			}
-
-			port->set_index(index);
+			(*iter)->set_index(index);
 
+			vertices += PORT_VERTICES_COUNT;
 			index++;
 		}
-
-		context->glBindBuffer(GL_ARRAY_BUFFER, 0);
 	}
 }
@@ -23,6 +23,7 @@
 #define __WORKSPACEGATES_H__
 
 #include "WorkspaceElement.h"
+#include "WorkspaceVertexBuilder.h"
 #include "GUI/Text/Text.h"
 
 namespace degate
@@ -63,7 +64,7 @@ namespace degate
 		void update() override;
 
 		/**
-		 * Update a specific gate.
+		 * Update a specific gate (only the range of the gate is uploaded, with the next flush).
 		 * 
 		 * @param gate : the gate object.
 		 */
@@ -76,6 +77,11 @@ namespace degate
 		 */
 		void update(GatePort_shptr& port);
 
+		/**
+		 * Upload the vertices of updated gates and ports.
+		 */
+		void flush() override;
+
 		/**
 	     * Draw all gates.
 	     * 
@@ -106,20 +112,30 @@ namespace degate
 
 	private:
 		/**
-		 * Create a gate in OpenGL buffers.
+		 * Build the vertices of a gate (CPU side only, thread safe).
 		 *
 		 * @param gate : the gate object.
-		 * @param index : the index of the gate for OpenGL buffers.
+		 * @param vertices : where to write the square vertices (@see RECTANGLE_VERTICES_COUNT).
+		 * @param line_vertices : where to write the outline vertices (@see RECTANGLE_OUTLINE_VERTICES_COUNT).
 		 */
-		void create_gate(Gate_shptr& gate, unsigned index);
+		void create_gate(const Gate_shptr& gate, WorkspaceVertex2D* vertices, WorkspaceVertex2D* line_vertices) const;
 
 		/**
-		 * Create all ports of a specific gate in OpenGL buffers.
+		 * Build the vertices of a port (CPU side only, thread safe).
+		 *
+		 * @param port : the port object.
+		 * @param vertices : where to write the port vertices (@see PORT_VERTICES_COUNT).
+		 */
+		void create_port(const GatePort_shptr& port, WorkspaceVertex2D* vertices) const;
+
+		/**
+		 * Build the vertices of all ports of a specific gate (CPU side only, thread safe).
 		 *
 		 * @param gate : the gate object.
-		 * @param index : the index of the gate for OpenGL buffers.
+		 * @param index : the index of the first port of the gate for OpenGL buffers.
+		 * @param vertices : where to write the vertices of the ports of the gate.
 		 */
-		void create_ports(Gate_shptr& gate, unsigned index);
+		void create_ports(const Gate_shptr& gate, unsigned index, WorkspaceVertex2D* vertices) const;
 
 		Text gate_template_name_text;
 		Text port_name_text;
@@ -127,6 +143,10 @@ namespace degate
 		GLuint port_vbo = 0;
 		unsigned ports_count = 0;
 
+		WorkspaceVertexBuffer gate_vertices{RECTANGLE_VERTICES_COUNT};
+		WorkspaceVertexBuffer gate_line_vertices{RECTANGLE_OUTLINE_VERTICES_COUNT};
+		WorkspaceVertexBuffer port_vertices{PORT_VERTICES_COUNT};
+
 	};
 }
 
@@ -43,7 +43,7 @@ namespace degate
 		setCursor(Qt::CrossCursor);
 		setMouseTracking(true);
 
-		selected_objects.set_object_update_function(std::bind(&WorkspaceRenderer::update_object, this, std::placeholders::_1));
+		selected_objects.set_objects_update_function(std::bind(&WorkspaceRenderer::update_objects, this, std::placeholders::_1));
 	}
 
 	WorkspaceRenderer::~WorkspaceRenderer()
@@ -84,6 +84,25 @@ namespace degate
 
 		project = new_project;
 
+		// Prepare in the background the glyphs of all names that will be displayed.
+		if(project != nullptr)
+		{
+			QString names;
+
+			LogicModel_shptr logic_model = project->get_logic_model();
+			for(auto iter = logic_model->objects_begin(); iter != logic_model->objects_end(); ++iter)
+				names += QString::fromStdString(iter->second->get_name());
+
+			GateLibrary_shptr gate_library = logic_model->get_gate_library();
+			if(gate_library != nullptr)
+			{
+				for(auto iter = gate_library->begin(); iter != gate_library->end(); ++iter)
+					names += QString::fromStdString(iter->second->get_name());
+			}
+
+			Text::pregenerate_glyphs(Font{FONT_DEFAULT_SIZE, FONT_DEFAULT_FAMILY}, names);
+		}
+
 		background.set_project(new_project);
 		gates.set_project(new_project);
 		annotations.set_project(new_project);
@@ -321,6 +340,13 @@ namespace degate
 
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+		// Upload objects updated since the last frame, one range per buffer.
+		gates.flush();
+		annotations.flush();
+		emarkers.flush();
+		vias.flush();
+		wires.flush();
+
 		background.draw(projection);
 
 		if(draw_wires)
@@ -400,9 +426,33 @@ namespace degate
 
     void WorkspaceRenderer::update_object(PlacedLogicModelObject_shptr object)
     {
-        if(object == nullptr)
+        if(object == nullptr || project == nullptr)
             return;
 
+        update_object_vertices(object, project->get_logic_model()->get_current_layer());
+
+        update();
+    }
+
+    void WorkspaceRenderer::update_objects(const std::vector<PlacedLogicModelObject_shptr>& objects)
+    {
+        if(objects.empty() || project == nullptr)
+            return;
+
+        Layer_shptr current_layer = project->get_logic_model()->get_current_layer();
+
+        for(auto& object : objects)
+        {
+            if(object != nullptr)
+                update_object_vertices(object, current_layer);
+        }
+
+        // The buffers are uploaded once with the next frame.
+        update();
+    }
+
+    void WorkspaceRenderer::update_object_vertices(const PlacedLogicModelObject_shptr& object, const Layer_shptr& current_layer)
+    {
         if (Gate_shptr gate = std::dynamic_pointer_cast<Gate>(object))
         {
             gates.update(gate);
@@ -412,7 +462,7 @@ namespace degate
             gates.update(gate_port);
         }
 
-        if(object->get_layer() == project->get_logic_model()->get_current_layer())
+        if(object->get_layer() == current_layer)
         {
             if(Annotation_shptr annotation = std::dynamic_pointer_cast<Annotation>(object))
             {
@@ -431,8 +481,6 @@ namespace degate
                 wires.update(wire);
             }
         }
-
-        update();
     }
 
 	void WorkspaceRenderer::set_projection(float scale_factor, float new_center_x, float new_center_y)
@@ -448,6 +496,7 @@ namespace degate
 		viewport_max_y = center_y + (static_cast<float>(height()) * scale) / 2.0;
 
         regular_grid.viewport_update(BoundingBox(viewport_min_x, viewport_max_x, viewport_min_y, viewport_max_y));
+        background.viewport_update(BoundingBox(viewport_min_x, viewport_max_x, viewport_min_y, viewport_max_y), scale);
 
         if (draw_grid)
             regular_grid.update();
@@ -582,6 +631,9 @@ namespace degate
 
             Layer_shptr layer = project->get_logic_model()->get_current_layer();
 
+            // All selected objects are updated at once.
+            HlObjectSet::update_guard update(selected_objects);
+
             // Current layer
             for(Layer::qt_region_iterator iter = layer->region_begin(bb); iter != layer->region_end(); ++iter)
             {
@@ -186,12 +186,22 @@ namespace degate
 		 */
         void update_object(PlacedLogicModelObject_shptr object);
 
+        /**
+         * Update objects of the workspace, buffers are uploaded once with the next frame.
+         */
+        void update_objects(const std::vector<PlacedLogicModelObject_shptr>& objects);
+
 	protected:
 		/**
 		 * Destroy all OpenGL textures.
 		 */
 		void free_textures();
 
+        /**
+         * Update the vertices of an object (without requesting a new frame).
+         */
+        void update_object_vertices(const PlacedLogicModelObject_shptr& object, const Layer_shptr& current_layer);
+
         /**
          * Delete all opengl objects (called when QOpenGLContext::aboutToBeDestroyed signal is emitted).
          */
@@ -0,0 +1,298 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "WorkspaceVertexBuilder.h"
+
+#include <QtConcurrent/QtConcurrent>
+#include <QThread>
+
+namespace degate
+{
+    static inline void set_vertex_color(WorkspaceVertex2D& vertex, color_t color)
+    {
+        vertex.color = QVector3D(MASK_R(color) / 255.0, MASK_G(color) / 255.0, MASK_B(color) / 255.0);
+        vertex.alpha = MASK_A(color) / 255.0;
+    }
+
+    static inline void set_vertices_color(WorkspaceVertex2D* vertices, unsigned int count, color_t color)
+    {
+        WorkspaceVertex2D temp;
+        set_vertex_color(temp, color);
+
+        for(unsigned int i = 0; i < count; i++)
+        {
+            vertices[i].color = temp.color;
+            vertices[i].alpha = temp.alpha;
+        }
+    }
+
+    void build_rectangle(WorkspaceVertex2D* vertices, float min_x, float min_y, float max_x, float max_y, color_t color)
+    {
+        set_vertices_color(vertices, RECTANGLE_VERTICES_COUNT, color);
+
+        vertices[0].pos = QVector2D(min_x, min_y);
+        vertices[1].pos = QVector2D(max_x, min_y);
+        vertices[2].pos = QVector2D(min_x, max_y);
+        vertices[3].pos = QVector2D(min_x, max_y);
+        vertices[4].pos = QVector2D(max_x, min_y);
+        vertices[5].pos = QVector2D(max_x, max_y);
+    }
+
+    void build_rectangle_outline(WorkspaceVertex2D* vertices, float min_x, float min_y, float max_x, float max_y, color_t color)
+    {
+        set_vertices_color(vertices, RECTANGLE_OUTLINE_VERTICES_COUNT, color);
+
+        vertices[0].pos = QVector2D(min_x, min_y);
+        vertices[1].pos = QVector2D(max_x, min_y);
+        vertices[2].pos = QVector2D(min_x, min_y);
+        vertices[3].pos = QVector2D(min_x, max_y);
+        vertices[4].pos = QVector2D(max_x, min_y);
+        vertices[5].pos = QVector2D(max_x, max_y);
+        vertices[6].pos = QVector2D(min_x, max_y);
+        vertices[7].pos = QVector2D(max_x, max_y);
+    }
+
+    void build_wire(WorkspaceVertex2D* vertices, float from_x, float from_y, float to_x, float to_y, float diameter, color_t color)
+    {
+        set_vertices_color(vertices, WIRE_VERTICES_COUNT, color);
+
+        float radius = diameter / 2.0f;
+
+        QVector2D difference_vector(to_x - from_x, to_y - from_y);
+
+        QVector2D parallel_vector = difference_vector;
+        parallel_vector.normalize();
+        to_x += radius * parallel_vector.x();
+        from_x -= radius * parallel_vector.x();
+        to_y += radius * parallel_vector.y();
+        from_y -= radius * parallel_vector.y();
+        QVector2D perpendicular_vector(difference_vector.y(), -difference_vector.x());
+        perpendicular_vector.normalize();
+
+        vertices[0].pos = QVector2D(from_x + perpendicular_vector.x() * radius, from_y + perpendicular_vector.y() * radius);
+        vertices[1].pos = QVector2D(from_x - perpendicular_vector.x() * radius, from_y - perpendicular_vector.y() * radius);
+        vertices[2].pos = QVector2D(to_x + perpendicular_vector.x() * radius, to_y + perpendicular_vector.y() * radius);
+        vertices[3].pos = QVector2D(to_x - perpendicular_vector.x() * radius, to_y - perpendicular_vector.y() * radius);
+        vertices[4].pos = QVector2D(to_x + perpendicular_vector.x() * radius, to_y + perpendicular_vector.y() * radius);
+        vertices[5].pos = QVector2D(from_x - perpendicular_vector.x() * radius, from_y - perpendicular_vector.y() * radius);
+    }
+
+    void build_via(WorkspaceVertex2D* vertices, float x, float y, float diameter, color_t color)
+    {
+        set_vertices_color(vertices, VIA_VERTICES_COUNT, color);
+
+        const float hole_radius = diameter / 4.0f;
+        const float radius = diameter / 2.0f;
+
+        // Rect 1
+        vertices[0].pos = QVector2D(x - radius, y - radius);
+        vertices[1].pos = QVector2D(x - hole_radius, y - radius);
+        vertices[2].pos = QVector2D(x - radius, y + radius);
+        vertices[3].pos = QVector2D(x - hole_radius, y + radius);
+        vertices[4].pos = QVector2D(x - radius, y + radius);
+        vertices[5].pos = QVector2D(x - hole_radius, y - radius);
+
+        // Rect 2
+        vertices[6].pos = QVector2D(x - hole_radius, y - radius);
+        vertices[7].pos = QVector2D(x + hole_radius, y - radius);
+        vertices[8].pos = QVector2D(x - hole_radius, y - hole_radius);
+        vertices[9].pos = QVector2D(x - hole_radius, y - hole_radius);
+        vertices[10].pos = QVector2D(x + hole_radius, y - radius);
+        vertices[11].pos = QVector2D(x + hole_radius, y - hole_radius);
+
+        // Rect 3
+        vertices[12].pos = QVector2D(x + hole_radius, y - radius);
+        vertices[13].pos = QVector2D(x + radius, y - radius);
+        vertices[14].pos = QVector2D(x + hole_radius, y + radius);
+        vertices[15].pos = QVector2D(x + radius, y - radius);
+        vertices[16].pos = QVector2D(x + radius, y + radius);
+        vertices[17].pos = QVector2D(x + hole_radius, y + radius);
+
+        // Rect 4
+        vertices[18].pos = QVector2D(x - hole_radius, y + hole_radius);
+        vertices[19].pos = QVector2D(x - hole_radius, y + radius);
+        vertices[20].pos = QVector2D(x + hole_radius, y + hole_radius);
+        vertices[21].pos = QVector2D(x + hole_radius, y + hole_radius);
+        vertices[22].pos = QVector2D(x + hole_radius, y + radius);
+        vertices[23].pos = QVector2D(x - hole_radius, y + radius);
+    }
+
+    void build_port(WorkspaceVertex2D* vertices, GateTemplatePort::PORT_TYPE port_type, float x, float y, unsigned int diameter, color_t color)
+    {
+        set_vertices_color(vertices, PORT_VERTICES_COUNT, color);
+
+        int mid = diameter / 2.0;
+
+        switch(port_type)
+        {
+            case GateTemplatePort::PORT_TYPE_IN:
+                vertices[0].pos = QVector2D(x - mid, y - mid);
+                vertices[1].pos = QVector2D(x + mid, y - mid);
+                vertices[2].pos = QVector2D(x, y);
+                vertices[3].pos = QVector2D(x + mid, y - mid);
+                vertices[4].pos = QVector2D(x + mid, y + mid);
+                vertices[5].pos = QVector2D(x, y);
+                vertices[6].pos = QVector2D(x + mid, y + mid);
+                vertices[7].pos = QVector2D(x - mid, y + mid);
+                vertices[8].pos = QVector2D(x, y);
+                break;
+            case GateTemplatePort::PORT_TYPE_OUT:
+                vertices[0].pos = QVector2D(x - mid, y - mid);
+                vertices[1].pos = QVector2D(x, y - mid);
+                vertices[2].pos = QVector2D(x, y + mid);
+                vertices[3].pos = QVector2D(x - mid, y - mid);
+                vertices[4].pos = QVector2D(x - mid, y + mid);
+                vertices[5].pos = QVector2D(x, y + mid);
+                vertices[6].pos = QVector2D(x, y - mid);
+                vertices[7].pos = QVector2D(x + mid, y);
+                vertices[8].pos = QVector2D(x, y + mid);
+                break;
+            default: // In/out and undefined
+                vertices[0].pos = QVector2D(x - mid, y - mid);
+                vertices[1].pos = QVector2D(x - mid, y + mid);
+                vertices[2].pos = QVector2D(x + mid, y - mid);
+                vertices[3].pos = QVector2D(x + mid, y - mid);
+                vertices[4].pos = QVector2D(x, y);
+                vertices[5].pos = QVector2D(x + mid, y + mid);
+                vertices[6].pos = QVector2D(x, y);
+                vertices[7].pos = QVector2D(x + mid, y + mid);
+                vertices[8].pos = QVector2D(x - mid, y + mid);
+                break;
+        }
+    }
+
+    void build_vertices(size_t object_count, const std::function<void(size_t begin, size_t end)>& build_range)
+    {
+        if(object_count == 0)
+            return;
+
+        const size_t task_count = std::min<size_t>(std::max(QThread::idealThreadCount(), 1),
+                                                   (object_count + VERTEX_BUILDER_MIN_OBJECTS_PER_TASK - 1) / VERTEX_BUILDER_MIN_OBJECTS_PER_TASK);
+
+        if(task_count <= 1)
+        {
+            build_range(0, object_count);
+            return;
+        }
+
+        // Each range writes to its own part of the vertex arrays, no synchronization is needed.
+        std::vector<std::pair<size_t, size_t>> ranges;
+        const size_t range_size = (object_count + task_count - 1) / task_count;
+        for(size_t begin = 0; begin < object_count; begin += range_size)
+            ranges.emplace_back(begin, std::min(begin + range_size, object_count));
+
+        QtConcurrent::blockingMap(ranges, [&build_range](const std::pair<size_t, size_t>& range)
+        {
+            build_range(range.first, range.second);
+        });
+    }
+
+    WorkspaceVertexBuffer::WorkspaceVertexBuffer(unsigned int vertices_per_object)
+            : vertices_per_object(vertices_per_object), modified_begin(0), modified_end(0)
+    {
+    }
+
+    void WorkspaceVertexBuffer::resize(size_t object_count)
+    {
+        vertices.resize(object_count * vertices_per_object);
+        modified_begin = 0;
+        modified_end = 0;
+    }
+
+    WorkspaceVertex2D* WorkspaceVertexBuffer::get_object_vertices(size_t index)
+    {
+        assert(index < get_object_count());
+        return &vertices[index * vertices_per_object];
+    }
+
+    WorkspaceVertex2D* WorkspaceVertexBuffer::update_object_vertices(size_t index)
+    {
+        if(index >= get_object_count())
+            return nullptr;
+
+        const size_t begin = index * vertices_per_object;
+        const size_t end = begin + vertices_per_object;
+
+        if(modified_begin == modified_end)
+        {
+            modified_begin = begin;
+            modified_end = end;
+        }
+        else
+        {
+            modified_begin = std::min(modified_begin, begin);
+            modified_end = std::max(modified_end, end);
+        }
+
+        return &vertices[begin];
+    }
+
+    size_t WorkspaceVertexBuffer::get_object_count() const
+    {
+        return vertices.size() / vertices_per_object;
+    }
+
+    size_t WorkspaceVertexBuffer::get_vertices_count() const
+    {
+        return vertices.size();
+    }
+
+    bool WorkspaceVertexBuffer::is_modified() const
+    {
+        return modified_begin != modified_end;
+    }
+
+    size_t WorkspaceVertexBuffer::get_modified_begin() const
+    {
+        return modified_begin;
+    }
+
+    size_t WorkspaceVertexBuffer::get_modified_end() const
+    {
+        return modified_end;
+    }
+
+    void WorkspaceVertexBuffer::upload(QOpenGLFunctions* context, GLuint vbo)
+    {
+        context->glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        context->glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(WorkspaceVertex2D), vertices.data(), GL_STATIC_DRAW);
+        context->glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        modified_begin = 0;
+        modified_end = 0;
+    }
+
+    void WorkspaceVertexBuffer::flush(QOpenGLFunctions* context, GLuint vbo)
+    {
+        if(!is_modified())
+            return;
+
+        context->glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        context->glBufferSubData(GL_ARRAY_BUFFER,
+                                 modified_begin * sizeof(WorkspaceVertex2D),
+                                 (modified_end - modified_begin) * sizeof(WorkspaceVertex2D),
+                                 &vertices[modified_begin]);
+        context->glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        modified_begin = 0;
+        modified_end = 0;
+    }
+}
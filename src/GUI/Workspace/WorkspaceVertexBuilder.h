@@ -0,0 +1,194 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __WORKSPACEVERTEXBUILDER_H__
+#define __WORKSPACEVERTEXBUILDER_H__
+
+#include "Core/Image/Image.h"
+#include "Core/LogicModel/Gate/GateTemplatePort.h"
+
+#include <QVector2D>
+#include <QVector3D>
+#include <QOpenGLFunctions>
+#include <functional>
+#include <vector>
+
+/**
+ * Number of vertices of a filled rectangle (2 triangles).
+ */
+#define RECTANGLE_VERTICES_COUNT 6
+
+/**
+ * Number of vertices of a rectangle outline (4 lines).
+ */
+#define RECTANGLE_OUTLINE_VERTICES_COUNT 8
+
+/**
+ * Number of vertices of a wire (2 triangles).
+ */
+#define WIRE_VERTICES_COUNT 6
+
+/**
+ * Number of vertices of a via (4 rectangles around the hole).
+ */
+#define VIA_VERTICES_COUNT 24
+
+/**
+ * Number of vertices of a gate port (3 triangles).
+ */
+#define PORT_VERTICES_COUNT 9
+
+/**
+ * Minimum number of objects handled by one task when vertices are built in parallel.
+ */
+#define VERTEX_BUILDER_MIN_OBJECTS_PER_TASK 4096
+
+namespace degate
+{
+    /**
+     * @struct WorkspaceVertex2D
+     * @brief Vertex layout shared by all workspace elements (position, color and alpha).
+     */
+    struct WorkspaceVertex2D
+    {
+        QVector2D pos;
+        QVector3D color;
+        float alpha;
+    };
+
+    typedef std::vector<WorkspaceVertex2D> WorkspaceVertices;
+
+    /*
+     * The following functions only fill CPU side vertex arrays, they don't need an OpenGL context.
+     * The vertices are written at the given address, the caller is responsible to reserve the right number of vertices.
+     */
+
+    /**
+     * Build a filled rectangle (@see RECTANGLE_VERTICES_COUNT).
+     */
+    void build_rectangle(WorkspaceVertex2D* vertices, float min_x, float min_y, float max_x, float max_y, color_t color);
+
+    /**
+     * Build a rectangle outline (@see RECTANGLE_OUTLINE_VERTICES_COUNT).
+     */
+    void build_rectangle_outline(WorkspaceVertex2D* vertices, float min_x, float min_y, float max_x, float max_y, color_t color);
+
+    /**
+     * Build a wire, a rectangle from one point to another with rounded (squared) ends (@see WIRE_VERTICES_COUNT).
+     */
+    void build_wire(WorkspaceVertex2D* vertices, float from_x, float from_y, float to_x, float to_y, float diameter, color_t color);
+
+    /**
+     * Build a via, a square with a hole in the center (@see VIA_VERTICES_COUNT).
+     */
+    void build_via(WorkspaceVertex2D* vertices, float x, float y, float diameter, color_t color);
+
+    /**
+     * Build a gate port, the shape depends on the port type (@see PORT_VERTICES_COUNT).
+     */
+    void build_port(WorkspaceVertex2D* vertices, GateTemplatePort::PORT_TYPE port_type, float x, float y, unsigned int diameter, color_t color);
+
+    /**
+     * Call build_range on ranges [begin, end[ that cover [0, object_count[.
+     * Ranges are processed in parallel if there are enough objects.
+     *
+     * @param object_count : the total number of objects.
+     * @param build_range : the function that builds the vertices of the objects of a range, it must be thread safe.
+     */
+    void build_vertices(size_t object_count, const std::function<void(size_t begin, size_t end)>& build_range);
+
+    /**
+     * @class WorkspaceVertexBuffer
+     * @brief CPU side copy of a vertex buffer object, that coalesces updates of single objects.
+     *
+     * Each object has the same number of vertices and is identified by its index.
+     * Updated objects are only written to the CPU side copy, the modified range
+     * is uploaded with a single call per frame (@see flush).
+     */
+    class WorkspaceVertexBuffer
+    {
+    public:
+
+        /**
+         * Create a vertex buffer.
+         *
+         * @param vertices_per_object : the number of vertices of each object.
+         */
+        WorkspaceVertexBuffer(unsigned int vertices_per_object);
+
+        /**
+         * Resize the buffer (content is not kept).
+         *
+         * @param object_count : the new number of objects.
+         */
+        void resize(size_t object_count);
+
+        /**
+         * Get the vertices of an object, without marking them as modified.
+         */
+        WorkspaceVertex2D* get_object_vertices(size_t index);
+
+        /**
+         * Get the vertices of an object to update them, they will be uploaded with the next flush.
+         * Returns nullptr if the index is out of range (the buffer was not built yet).
+         */
+        WorkspaceVertex2D* update_object_vertices(size_t index);
+
+        /**
+         * Get the number of objects.
+         */
+        size_t get_object_count() const;
+
+        /**
+         * Get the number of vertices.
+         */
+        size_t get_vertices_count() const;
+
+        /**
+         * Check if vertices were modified since the last upload.
+         */
+        bool is_modified() const;
+
+        /**
+         * Get the modified range of vertices [begin, end[.
+         */
+        size_t get_modified_begin() const;
+        size_t get_modified_end() const;
+
+        /**
+         * Upload the whole buffer (buffer object is resized).
+         */
+        void upload(QOpenGLFunctions* context, GLuint vbo);
+
+        /**
+         * Upload the modified range, if any, with a single call.
+         */
+        void flush(QOpenGLFunctions* context, GLuint vbo);
+
+    private:
+        unsigned int vertices_per_object;
+        WorkspaceVertices vertices;
+        size_t modified_begin;
+        size_t modified_end;
+    };
+}
+
+#endif //__WORKSPACEVERTEXBUILDER_H__
@@ -25,13 +25,6 @@
 
 namespace degate
 {
-    struct ViasVertex2D
-    {
-        QVector2D pos;
-        QVector3D color;
-        float alpha;
-    };
-
     WorkspaceVias::WorkspaceVias(QWidget *parent) : WorkspaceElement(parent), text(parent)
     {
 
@@ -102,27 +95,32 @@ namespace degate
         }
         vias_count = vias.size();
 
+        via_vertices.resize(vias_count);
+
         if(vias_count == 0)
             return;
 
-        context->glBindBuffer(GL_ARRAY_BUFFER, vbo);
-
-        context->glBufferData(GL_ARRAY_BUFFER, vias_count * 24 * sizeof(ViasVertex2D), nullptr, GL_STATIC_DRAW);
-
-        context->glBindBuffer(GL_ARRAY_BUFFER, 0);
-
         unsigned text_size = 0;
 
         unsigned index = 0;
         for(auto& e : vias)
         {
-            create_via(e, index);
             e->set_index(index);
 
             text_size += e->get_name().length();
             index++;
         }
 
+        // Build all vertices on the CPU side (in parallel), then upload the buffer at once.
+
+        build_vertices(vias_count, [&](size_t begin, size_t end)
+        {
+            for(size_t i = begin; i < end; i++)
+                create_via(vias[i], via_vertices.get_object_vertices(i));
+        });
+
+        via_vertices.upload(context, vbo);
+
         text.update(text_size);
 
         unsigned text_offset = 0;
@@ -142,7 +140,18 @@ namespace degate
         if(via == nullptr)
             return;
 
-        create_via(via, via->get_index());
+        // Only the range of this via is updated, with the next flush.
+        WorkspaceVertex2D* vertices = via_vertices.update_object_vertices(via->get_index());
+
+        if(vertices == nullptr)
+            return;
+
+        create_via(via, vertices);
+    }
+
+    void WorkspaceVias::flush()
+    {
+        via_vertices.flush(context, vbo);
     }
 
     void WorkspaceVias::draw(const QMatrix4x4& projection)
@@ -157,15 +166,15 @@ namespace degate
         context->glBindBuffer(GL_ARRAY_BUFFER, vbo);
 
         program->enableAttributeArray("pos");
-        program->setAttributeBuffer("pos", GL_FLOAT, 0, 2, sizeof(ViasVertex2D));
+        program->setAttributeBuffer("pos", GL_FLOAT, 0, 2, sizeof(WorkspaceVertex2D));
 
         program->enableAttributeArray("color");
-        program->setAttributeBuffer("color", GL_FLOAT, 2 * sizeof(float), 3, sizeof(ViasVertex2D));
+        program->setAttributeBuffer("color", GL_FLOAT, 2 * sizeof(float), 3, sizeof(WorkspaceVertex2D));
 
         program->enableAttributeArray("alpha");
-        program->setAttributeBuffer("alpha", GL_FLOAT, 5 * sizeof(float), 1, sizeof(ViasVertex2D));
+        program->setAttributeBuffer("alpha", GL_FLOAT, 5 * sizeof(float), 1, sizeof(WorkspaceVertex2D));
 
-        context->glDrawArrays(GL_TRIANGLES, 0, vias_count * 24);
+        context->glDrawArrays(GL_TRIANGLES, 0, vias_count * VIA_VERTICES_COUNT);
 
         context->glBindBuffer(GL_ARRAY_BUFFER, 0);
 
@@ -180,15 +189,8 @@ namespace degate
         text.draw(projection);
     }
 
-    void WorkspaceVias::create_via(Via_shptr &via, unsigned int index)
+    void WorkspaceVias::create_via(const Via_shptr& via, WorkspaceVertex2D* vertices) const
     {
-        if(via == nullptr)
-            return;
-
-        context->glBindBuffer(GL_ARRAY_BUFFER, vbo);
-
-        const float hole_radius = via->get_diameter() / 4.0;
-
         // Vertices and colors
 
         color_t color;
@@ -202,96 +204,6 @@ namespace degate
 
         color = highlight_color_by_state(color, via->get_highlighted());
 
-        ViasVertex2D temp;
-        temp.color = QVector3D(MASK_R(color) / 255.0, MASK_G(color) / 255.0, MASK_B(color) / 255.0);
-        temp.alpha = MASK_A(color) / 255.0;
-
-
-        // Rect 1
-
-        temp.pos = QVector2D(via->get_x() - via->get_diameter() / 2.0, via->get_y() - via->get_diameter() / 2.0);
-        context->glBufferSubData(GL_ARRAY_BUFFER, index * 24 * sizeof(ViasVertex2D) + 0 * sizeof(ViasVertex2D), sizeof(ViasVertex2D), &temp);
-
-        temp.pos = QVector2D(via->get_x() - hole_radius, via->get_y() - via->get_diameter() / 2.0);
-        context->glBufferSubData(GL_ARRAY_BUFFER, index * 24 * sizeof(ViasVertex2D) + 1 * sizeof(ViasVertex2D), sizeof(ViasVertex2D), &temp);
-
-        temp.pos = QVector2D(via->get_x() - via->get_diameter() / 2.0, via->get_y() + via->get_diameter() / 2.0);
-        context->glBufferSubData(GL_ARRAY_BUFFER, index * 24 * sizeof(ViasVertex2D) + 2 * sizeof(ViasVertex2D), sizeof(ViasVertex2D), &temp);
-
-        temp.pos = QVector2D(via->get_x() - hole_radius, via->get_y() + via->get_diameter() / 2.0);
-        context->glBufferSubData(GL_ARRAY_BUFFER, index * 24 * sizeof(ViasVertex2D) + 3 * sizeof(ViasVertex2D), sizeof(ViasVertex2D), &temp);
-
-        temp.pos = QVector2D(via->get_x() - via->get_diameter() / 2.0, via->get_y() + via->get_diameter() / 2.0);
-        context->glBufferSubData(GL_ARRAY_BUFFER, index * 24 * sizeof(ViasVertex2D) + 4 * sizeof(ViasVertex2D), sizeof(ViasVertex2D), &temp);
-
-        temp.pos = QVector2D(via->get_x() - hole_radius, via->get_y() - via->get_diameter() / 2.0);
-        context->glBufferSubData(GL_ARRAY_BUFFER, index * 24 * sizeof(ViasVertex2D) + 5 * sizeof(ViasVertex2D), sizeof(ViasVertex2D), &temp);
-
-
-        // Rect 2
-
-        temp.pos = QVector2D(via->get_x() - hole_radius, via->get_y() - via->get_diameter() / 2.0);
-        context->glBufferSubData(GL_ARRAY_BUFFER, index * 24 * sizeof(ViasVertex2D) + 6 * sizeof(ViasVertex2D), sizeof(ViasVertex2D), &temp);
-
-        temp.pos = QVector2D(via->get_x() + hole_radius, via->get_y() - via->get_diameter() / 2.0);
-        context->glBufferSubData(GL_ARRAY_BUFFER, index * 24 * sizeof(ViasVertex2D) + 7 * sizeof(ViasVertex2D), sizeof(ViasVertex2D), &temp);
-
-        temp.pos = QVector2D(via->get_x() - hole_radius, via->get_y() - hole_radius);
-        context->glBufferSubData(GL_ARRAY_BUFFER, index * 24 * sizeof(ViasVertex2D) + 8 * sizeof(ViasVertex2D), sizeof(ViasVertex2D), &temp);
-
-        temp.pos = QVector2D(via->get_x() - hole_radius, via->get_y() - hole_radius);
-        context->glBufferSubData(GL_ARRAY_BUFFER, index * 24 * sizeof(ViasVertex2D) + 9 * sizeof(ViasVertex2D), sizeof(ViasVertex2D), &temp);
-
-        temp.pos = QVector2D(via->get_x() + hole_radius, via->get_y() - via->get_diameter() / 2.0);
-        context->glBufferSubData(GL_ARRAY_BUFFER, index * 24 * sizeof(ViasVertex2D) + 10 * sizeof(ViasVertex2D), sizeof(ViasVertex2D), &temp);
-
-        temp.pos = QVector2D(via->get_x() + hole_radius, via->get_y() - hole_radius);
-        context->glBufferSubData(GL_ARRAY_BUFFER, index * 24 * sizeof(ViasVertex2D) + 11 * sizeof(ViasVertex2D), sizeof(ViasVertex2D), &temp);
-
-
-
-        // Rect 3
-
-        temp.pos = QVector2D(via->get_x() + hole_radius, via->get_y() - via->get_diameter() / 2.0);
-        context->glBufferSubData(GL_ARRAY_BUFFER, index * 24 * sizeof(ViasVertex2D) + 12 * sizeof(ViasVertex2D), sizeof(ViasVertex2D), &temp);
-
-        temp.pos = QVector2D(via->get_x() + via->get_diameter() / 2.0, via->get_y() - via->get_diameter() / 2.0);
-        context->glBufferSubData(GL_ARRAY_BUFFER, index * 24 * sizeof(ViasVertex2D) + 13 * sizeof(ViasVertex2D), sizeof(ViasVertex2D), &temp);
-
-        temp.pos = QVector2D(via->get_x() + hole_radius, via->get_y() + via->get_diameter() / 2.0);
-        context->glBufferSubData(GL_ARRAY_BUFFER, index * 24 * sizeof(ViasVertex2D) + 14 * sizeof(ViasVertex2D), sizeof(ViasVertex2D), &temp);
-
-        temp.pos = QVector2D(via->get_x() + via->get_diameter() / 2.0, via->get_y() - via->get_diameter() / 2.0);
-        context->glBufferSubData(GL_ARRAY_BUFFER, index * 24 * sizeof(ViasVertex2D) + 15 * sizeof(ViasVertex2D), sizeof(ViasVertex2D), &temp);
-
-        temp.pos = QVector2D(via->get_x() + via->get_diameter() / 2.0, via->get_y() + via->get_diameter() / 2.0);
-        context->glBufferSubData(GL_ARRAY_BUFFER, index * 24 * sizeof(ViasVertex2D) + 16 * sizeof(ViasVertex2D), sizeof(ViasVertex2D), &temp);
-
-        temp.pos = QVector2D(via->get_x() + hole_radius, via->get_y() + via->get_diameter() / 2.0);
-        context->glBufferSubData(GL_ARRAY_BUFFER, index * 24 * sizeof(ViasVertex2D) + 17 * sizeof(ViasVertex2D), sizeof(ViasVertex2D), &temp);
-
-
-
-        // Rect 4
-
-        temp.pos = QVector2D(via->get_x() - hole_radius, via->get_y() + hole_radius);
-        context->glBufferSubData(GL_ARRAY_BUFFER, index * 24 * sizeof(ViasVertex2D) + 18 * sizeof(ViasVertex2D), sizeof(ViasVertex2D), &temp);
-
-        temp.pos = QVector2D(via->get_x() - hole_radius, via->get_y() + via->get_diameter() / 2.0);
-        context->glBufferSubData(GL_ARRAY_BUFFER, index * 24 * sizeof(ViasVertex2D) + 19 * sizeof(ViasVertex2D), sizeof(ViasVertex2D), &temp);
-
-        temp.pos = QVector2D(via->get_x() + hole_radius, via->get_y() + hole_radius);
-        context->glBufferSubData(GL_ARRAY_BUFFER, index * 24 * sizeof(ViasVertex2D) + 20 * sizeof(ViasVertex2D), sizeof(ViasVertex2D), &temp);
-
-        temp.pos = QVector2D(via->get_x() + hole_radius, via->get_y() + hole_radius);
-        context->glBufferSubData(GL_ARRAY_BUFFER, index * 24 * sizeof(ViasVertex2D) + 21 * sizeof(ViasVertex2D), sizeof(ViasVertex2D), &temp);
-
-        temp.pos = QVector2D(via->get_x() + hole_radius, via->get_y() + via->get_diameter() / 2.0);
-        context->glBufferSubData(GL_ARRAY_BUFFER, index * 24 * sizeof(ViasVertex2D) + 22 * sizeof(ViasVertex2D), sizeof(ViasVertex2D), &temp);
-
-        temp.pos = QVector2D(via->get_x() - hole_radius, via->get_y() + via->get_diameter() / 2.0);
-        context->glBufferSubData(GL_ARRAY_BUFFER, index * 24 * sizeof(ViasVertex2D) + 23 * sizeof(ViasVertex2D), sizeof(ViasVertex2D), &temp);
-
-        context->glBindBuffer(GL_ARRAY_BUFFER, 0);
+        build_via(vertices, via->get_x(), via->get_y(), via->get_diameter(), color);
     }
-}
\ No newline at end of file
+}
@@ -23,6 +23,7 @@
 #define __WORKSPACEVIA_H__
 
 #include <GUI/Workspace/WorkspaceElement.h>
+#include <GUI/Workspace/WorkspaceVertexBuilder.h>
 #include <Core/LogicModel/Via/Via.h>
 #include <GUI/Text/Text.h>
 
@@ -68,6 +69,11 @@ namespace degate
          */
         void update(Via_shptr& via);
 
+        /**
+         * Upload the vertices of updated vias.
+         */
+        void flush() override;
+
         /**
          * Draw all vias (draw the square and outline buffers).
          *
@@ -84,16 +90,18 @@ namespace degate
 
     private:
         /**
-		 * Create an via in OpenGL buffers.
+		 * Build the vertices of a via (CPU side only, thread safe).
 		 *
 		 * @param via : the via object.
-		 * @param index : the index of the annotation for OpenGL buffers.
+		 * @param vertices : where to write the vertices (@see VIA_VERTICES_COUNT).
 		 */
-        void create_via(Via_shptr& via, unsigned index);
+        void create_via(const Via_shptr& via, WorkspaceVertex2D* vertices) const;
 
         Text text;
         unsigned vias_count = 0;
 
+        WorkspaceVertexBuffer via_vertices{VIA_VERTICES_COUNT};
+
     };
 }
 
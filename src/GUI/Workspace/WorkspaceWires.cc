@@ -23,13 +23,6 @@
 
 namespace degate
 {
-    struct WiresVertex2D
-    {
-        QVector2D pos;
-        QVector3D color;
-        float alpha;
-    };
-
     WorkspaceWires::WorkspaceWires(QWidget *parent) : WorkspaceElement(parent)
     {
 
@@ -98,22 +91,27 @@ namespace degate
         }
         wires_count = wires.size();
 
+        wire_vertices.resize(wires_count);
+
         if(wires_count == 0)
             return;
 
-        context->glBindBuffer(GL_ARRAY_BUFFER, vbo);
-
-        context->glBufferData(GL_ARRAY_BUFFER, wires_count * 6 * sizeof(WiresVertex2D), nullptr, GL_STATIC_DRAW);
-
-        context->glBindBuffer(GL_ARRAY_BUFFER, 0);
-
         unsigned index = 0;
         for(auto& e : wires)
         {
-            create_wire(e, index);
             e->set_index(index);
             index++;
         }
+
+        // Build all vertices on the CPU side (in parallel), then upload the buffer at once.
+
+        build_vertices(wires_count, [&](size_t begin, size_t end)
+        {
+            for(size_t i = begin; i < end; i++)
+                create_wire(wires[i], wire_vertices.get_object_vertices(i));
+        });
+
+        wire_vertices.upload(context, vbo);
     }
 
     void WorkspaceWires::update(Wire_shptr &wire)
@@ -121,7 +119,18 @@ namespace degate
         if(wire == nullptr)
             return;
 
-        create_wire(wire, wire->get_index());
+        // Only the range of this wire is updated, with the next flush.
+        WorkspaceVertex2D* vertices = wire_vertices.update_object_vertices(wire->get_index());
+
+        if(vertices == nullptr)
+            return;
+
+        create_wire(wire, vertices);
+    }
+
+    void WorkspaceWires::flush()
+    {
+        wire_vertices.flush(context, vbo);
     }
 
     void WorkspaceWires::draw(const QMatrix4x4 &projection)
@@ -136,67 +145,29 @@ namespace degate
         context->glBindBuffer(GL_ARRAY_BUFFER, vbo);
 
         program->enableAttributeArray("pos");
-        program->setAttributeBuffer("pos", GL_FLOAT, 0, 2, sizeof(WiresVertex2D));
+        program->setAttributeBuffer("pos", GL_FLOAT, 0, 2, sizeof(WorkspaceVertex2D));
 
         program->enableAttributeArray("color");
-        program->setAttributeBuffer("color", GL_FLOAT, 2 * sizeof(float), 3, sizeof(WiresVertex2D));
+        program->setAttributeBuffer("color", GL_FLOAT, 2 * sizeof(float), 3, sizeof(WorkspaceVertex2D));
 
         program->enableAttributeArray("alpha");
-        program->setAttributeBuffer("alpha", GL_FLOAT, 5 * sizeof(float), 1, sizeof(WiresVertex2D));
+        program->setAttributeBuffer("alpha", GL_FLOAT, 5 * sizeof(float), 1, sizeof(WorkspaceVertex2D));
 
-        context->glDrawArrays(GL_TRIANGLES, 0, wires_count * 6);
+        context->glDrawArrays(GL_TRIANGLES, 0, wires_count * WIRE_VERTICES_COUNT);
 
         context->glBindBuffer(GL_ARRAY_BUFFER, 0);
 
         program->release();
     }
 
-    void WorkspaceWires::create_wire(Wire_shptr &wire, unsigned int index)
+    void WorkspaceWires::create_wire(const Wire_shptr& wire, WorkspaceVertex2D* vertices) const
     {
-        if(wire == nullptr)
-            return;
-
-        context->glBindBuffer(GL_ARRAY_BUFFER, vbo);
-
         // Vertices and colors
 
         color_t color = wire->get_fill_color() == 0 ? project->get_default_color(DEFAULT_COLOR_EMARKER) : wire->get_fill_color();
 
         color = highlight_color_by_state(color, wire->get_highlighted());
 
-        WiresVertex2D temp;
-        temp.color = QVector3D(MASK_R(color) / 255.0, MASK_G(color) / 255.0, MASK_B(color) / 255.0);
-        temp.alpha = MASK_A(color) / 255.0;
-
-        float radius = static_cast<float>(wire->get_diameter()) / 2.0f;
-
-        QVector2D difference_vector(wire->get_to_x() - wire->get_from_x(), wire->get_to_y() - wire->get_from_y());
-
-        QVector2D parallel_vector = difference_vector;
-        parallel_vector.normalize();
-        float to_x = wire->get_to_x() + radius * parallel_vector.x(), from_x = wire->get_from_x() - radius * parallel_vector.x();
-        float to_y = wire->get_to_y() + radius * parallel_vector.y(), from_y = wire->get_from_y() - radius * parallel_vector.y();
-        QVector2D perpendicular_vector(difference_vector.y(), -difference_vector.x());
-        perpendicular_vector.normalize();
-
-        temp.pos = QVector2D(from_x + perpendicular_vector.x() * radius, from_y + perpendicular_vector.y() * radius);
-        context->glBufferSubData(GL_ARRAY_BUFFER, index * 6 * sizeof(WiresVertex2D) + 0 * sizeof(WiresVertex2D), sizeof(WiresVertex2D), &temp);
-
-        temp.pos = QVector2D(from_x - perpendicular_vector.x() * radius, from_y - perpendicular_vector.y() * radius);
-        context->glBufferSubData(GL_ARRAY_BUFFER, index * 6 * sizeof(WiresVertex2D) + 1 * sizeof(WiresVertex2D), sizeof(WiresVertex2D), &temp);
-
-        temp.pos = QVector2D(to_x + perpendicular_vector.x() * radius, to_y + perpendicular_vector.y() * radius);
-        context->glBufferSubData(GL_ARRAY_BUFFER, index * 6 * sizeof(WiresVertex2D) + 2 * sizeof(WiresVertex2D), sizeof(WiresVertex2D), &temp);
-
-        temp.pos = QVector2D(to_x + perpendicular_vector.x() * radius, to_y + perpendicular_vector.y() * radius);
-        context->glBufferSubData(GL_ARRAY_BUFFER, index * 6 * sizeof(WiresVertex2D) + 4 * sizeof(WiresVertex2D), sizeof(WiresVertex2D), &temp);
-
-        temp.pos = QVector2D(to_x - perpendicular_vector.x() * radius, to_y - perpendicular_vector.y() * radius);
-        context->glBufferSubData(GL_ARRAY_BUFFER, index * 6 * sizeof(WiresVertex2D) + 3 * sizeof(WiresVertex2D), sizeof(WiresVertex2D), &temp);
-
-        temp.pos = QVector2D(from_x - perpendicular_vector.x() * radius, from_y - perpendicular_vector.y() * radius);
-        context->glBufferSubData(GL_ARRAY_BUFFER, index * 6 * sizeof(WiresVertex2D) + 5 * sizeof(WiresVertex2D), sizeof(WiresVertex2D), &temp);
-
-        context->glBindBuffer(GL_ARRAY_BUFFER, 0);
+        build_wire(vertices, wire->get_from_x(), wire->get_from_y(), wire->get_to_x(), wire->get_to_y(), wire->get_diameter(), color);
     }
-}
\ No newline at end of file
+}
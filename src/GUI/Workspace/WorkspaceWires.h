@@ -23,6 +23,7 @@
 #define ___WORKSPACEWIRES_H__
 
 #include <GUI/Workspace/WorkspaceElement.h>
+#include <GUI/Workspace/WorkspaceVertexBuilder.h>
 #include <Core/LogicModel/Wire/Wire.h>
 #include <GUI/Text/Text.h>
 
@@ -69,6 +70,11 @@ namespace degate
          */
         void update(Wire_shptr& wire);
 
+        /**
+         * Upload the vertices of updated wires.
+         */
+        void flush() override;
+
         /**
          * Draw all wires (draw the square and outline buffers).
          *
@@ -79,15 +85,17 @@ namespace degate
 
     private:
         /**
-		 * Create an wire in OpenGL buffers.
+		 * Build the vertices of a wire (CPU side only, thread safe).
 		 *
 		 * @param wire : the wire object.
-		 * @param index : the index of the annotation for OpenGL buffers.
+		 * @param vertices : where to write the vertices (@see WIRE_VERTICES_COUNT).
 		 */
-        void create_wire(Wire_shptr& wire, unsigned index);
+        void create_wire(const Wire_shptr& wire, WorkspaceVertex2D* vertices) const;
 
         unsigned wires_count = 0;
 
+        WorkspaceVertexBuffer wire_vertices{WIRE_VERTICES_COUNT};
+
     };
 }
 
@@ -0,0 +1,171 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#ifndef __TESTOBJECTFACTORY_H__
+#define __TESTOBJECTFACTORY_H__
+
+#include <Core/LogicModel/LogicModel.h>
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace degate
+{
+    /**
+     * Creates gate templates, gates and nets for tests.
+     *
+     * With a logic model, object IDs are taken from the logic model and the created
+     * gates and nets are added to it. Otherwise object IDs are counted by the factory.
+     */
+    class TestObjectFactory
+    {
+    public:
+
+        typedef std::vector<std::pair<std::string, GateTemplatePort::PORT_TYPE>> port_list;
+
+        explicit TestObjectFactory(LogicModel_shptr lmodel = nullptr) : lmodel(lmodel), next_oid(1)
+        {
+        }
+
+        object_id_t get_new_object_id()
+        {
+            return lmodel != nullptr ? lmodel->get_new_object_id() : next_oid++;
+        }
+
+        /**
+         * Create a gate template with named ports.
+         * @param logic_class The logic class of the template, it is not set if empty.
+         */
+        GateTemplate_shptr create_template(std::string const& name, port_list const& ports,
+                                           std::string const& logic_class = "")
+        {
+            GateTemplate_shptr tmpl(new GateTemplate(10, 10));
+            tmpl->set_object_id(get_new_object_id());
+            tmpl->set_name(name);
+
+            if (!logic_class.empty())
+                tmpl->set_logic_class(logic_class);
+
+            for (auto const& p : ports)
+            {
+                GateTemplatePort_shptr port(new GateTemplatePort(1, 1, p.second));
+                port->set_object_id(get_new_object_id());
+                port->set_name(p.first);
+                tmpl->add_template_port(port);
+            }
+
+            return tmpl;
+        }
+
+        /**
+         * Create a gate from a template and connect its ports by template port name.
+         * Ports without a net stay unconnected.
+         */
+        Gate_shptr create_gate(GateTemplate_shptr tmpl, std::map<std::string, Net_shptr> const& nets)
+        {
+            Gate_shptr gate = new_gate();
+            gate->set_gate_template(tmpl);
+
+            for (auto iter = tmpl->ports_begin(); iter != tmpl->ports_end(); ++iter)
+            {
+                auto net = nets.find((*iter)->get_name());
+                add_port(gate, *iter, net != nets.end() ? net->second : nullptr);
+            }
+
+            add_gate(gate);
+            return gate;
+        }
+
+        /**
+         * Create a gate without a template. Each port gets its own template port.
+         * @param nets The nets of the ports, nullptr leaves a port unconnected.
+         */
+        Gate_shptr create_gate(std::vector<GateTemplatePort::PORT_TYPE> const& types = {},
+                               std::vector<Net_shptr> const& nets = {})
+        {
+            Gate_shptr gate = new_gate();
+
+            for (size_t i = 0; i < types.size(); i++)
+                create_port(gate, types[i], nets[i]);
+
+            add_gate(gate);
+            return gate;
+        }
+
+        /**
+         * Add a port with its own template port to a gate.
+         * @param net The net of the port, nullptr leaves it unconnected.
+         */
+        GatePort_shptr create_port(Gate_shptr gate, GateTemplatePort::PORT_TYPE type, Net_shptr net)
+        {
+            GateTemplatePort_shptr tmpl_port(new GateTemplatePort(1, 1, type));
+            tmpl_port->set_object_id(get_new_object_id());
+
+            return add_port(gate, tmpl_port, net);
+        }
+
+        Net_shptr create_net()
+        {
+            Net_shptr net(new Net());
+            net->set_object_id(get_new_object_id());
+
+            if (lmodel != nullptr)
+                lmodel->add_net(net);
+
+            return net;
+        }
+
+    private:
+
+        Gate_shptr new_gate()
+        {
+            Gate_shptr gate(new Gate(0, 10, 0, 10, Gate::ORIENTATION_NORMAL));
+            gate->set_object_id(get_new_object_id());
+            gate->set_name("g" + std::to_string(gate->get_object_id()));
+            return gate;
+        }
+
+        GatePort_shptr add_port(Gate_shptr gate, GateTemplatePort_shptr tmpl_port, Net_shptr net)
+        {
+            GatePort_shptr port(new GatePort(gate, tmpl_port));
+            port->set_object_id(get_new_object_id());
+            gate->add_port(port);
+
+            if (net != nullptr)
+                port->set_net(net);
+
+            return port;
+        }
+
+        void add_gate(Gate_shptr gate)
+        {
+            if (lmodel != nullptr)
+                lmodel->add_object(0, gate);
+        }
+
+        LogicModel_shptr lmodel;
+        object_id_t next_oid;
+    };
+}
+
+#endif
@@ -0,0 +1,189 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <GUI/Workspace/BackgroundResidencyManager.h>
+#include <Core/Utils/FileSystem.h>
+
+#include "catch.hpp"
+
+#include <atomic>
+#include <cstring>
+
+using namespace degate;
+
+static BackgroundImage_shptr create_test_image(const std::string& directory)
+{
+    // 600x500 image with 256x256 tiles (3x2 tiles).
+    BackgroundImage_shptr image = std::make_shared<BackgroundImage>(600, 500, directory, true, 8);
+
+    for (unsigned int y = 0; y < image->get_height(); y++)
+        for (unsigned int x = 0; x < image->get_width(); x++)
+            image->set_pixel(x, y, MERGE_CHANNELS(x & 0xff, y & 0xff, (x + y) & 0xff, 0xff));
+
+    return image;
+}
+
+TEST_CASE("Test background residency level and visible tiles", "[BackgroundResidencyManager]")
+{
+    std::string directory = create_temp_directory();
+
+    BackgroundImage_shptr image = create_test_image(directory);
+    ScalingManager_shptr scaling_manager = std::make_shared<ScalingManager<BackgroundImage>>(image, directory, 128);
+    scaling_manager->create_scalings();
+
+    {
+        BackgroundResidencyManager manager(scaling_manager, BACKGROUND_RESIDENCY_BUDGET, 0, false);
+
+        // One image pixel per screen pixel
+        manager.set_viewport(BoundingBox(0, 255, 0, 255), 1);
+        REQUIRE(manager.get_level() == 1);
+
+        auto visible = manager.get_visible_tiles();
+        REQUIRE(visible.size() == 1);
+        REQUIRE(visible[0] == (BackgroundTileKey{1, 0, 0}));
+
+        // Zoom in, still full resolution
+        manager.set_viewport(BoundingBox(300, 310, 300, 310), 0.25);
+        REQUIRE(manager.get_level() == 1);
+        visible = manager.get_visible_tiles();
+        REQUIRE(visible.size() == 1);
+        REQUIRE(visible[0] == (BackgroundTileKey{1, 256, 256}));
+
+        // Whole image at full resolution
+        manager.set_viewport(BoundingBox(-100, 700, -100, 600), 1);
+        REQUIRE(manager.get_visible_tiles().size() == 6);
+
+        // Zoom out, lower resolution levels are used
+        manager.set_viewport(BoundingBox(0, 599, 0, 499), 2.5);
+        REQUIRE(manager.get_level() == 2);
+        REQUIRE(manager.get_visible_tiles().size() == 1);
+
+        manager.set_viewport(BoundingBox(0, 599, 0, 499), 100);
+        REQUIRE(manager.get_level() == 8);
+
+        // Tile area in full resolution coordinates
+        BoundingBox box = manager.get_tile_bounding_box(BackgroundTileKey{1, 256, 0});
+        REQUIRE(box.get_min_x() == Approx(256));
+        REQUIRE(box.get_max_x() == Approx(512));
+        REQUIRE(box.get_min_y() == Approx(0));
+        REQUIRE(box.get_max_y() == Approx(256));
+
+        // Outside of the image
+        manager.set_viewport(BoundingBox(1000, 2000, 1000, 2000), 1);
+        REQUIRE(manager.get_visible_tiles().empty());
+    }
+
+    remove_directory(directory);
+}
+
+TEST_CASE("Test background residency tile loading", "[BackgroundResidencyManager]")
+{
+    std::string directory = create_temp_directory();
+
+    BackgroundImage_shptr image = create_test_image(directory);
+    ScalingManager_shptr scaling_manager = std::make_shared<ScalingManager<BackgroundImage>>(image, directory, 128);
+    scaling_manager->create_scalings();
+
+    {
+        std::atomic<unsigned int> loaded_count(0);
+
+        BackgroundResidencyManager manager(scaling_manager, BACKGROUND_RESIDENCY_BUDGET, 1, true);
+        manager.set_loaded_callback([&loaded_count]() { loaded_count++; });
+
+        // Visible tile (0, 0) and its neighbours (256, 0), (0, 256) and (256, 256)
+        manager.set_viewport(BoundingBox(0, 100, 0, 100), 1);
+        manager.wait();
+
+        auto loaded = manager.take_loaded_tiles();
+        REQUIRE(loaded.size() == 4);
+        REQUIRE(loaded_count == 4);
+        REQUIRE(manager.get_resident_count() == 4);
+        REQUIRE(manager.is_resident(BackgroundTileKey{1, 0, 0}));
+        REQUIRE(manager.is_resident(BackgroundTileKey{1, 256, 256}));
+        REQUIRE_FALSE(manager.is_resident(BackgroundTileKey{1, 512, 0}));
+
+        // Visible tiles are loaded first
+        REQUIRE(loaded[0].key == (BackgroundTileKey{1, 0, 0}));
+
+        // Staging buffers hold the tile pixels
+        std::vector<rgba_pixel_t> expected(256 * 256);
+        for (auto& tile : loaded)
+        {
+            REQUIRE(tile.tile_size == 256);
+            REQUIRE(tile.data->size() == expected.size());
+
+            image->raw_copy(expected.data(), tile.key.x, tile.key.y);
+            REQUIRE(memcmp(expected.data(), tile.data->data(), expected.size() * sizeof(rgba_pixel_t)) == 0);
+
+            manager.release_staging_buffer(tile.data);
+        }
+
+        // Already resident tiles are not loaded again
+        manager.set_viewport(BoundingBox(10, 50, 10, 50), 1);
+        manager.wait();
+        REQUIRE(manager.take_loaded_tiles().empty());
+    }
+
+    remove_directory(directory);
+}
+
+TEST_CASE("Test background residency eviction", "[BackgroundResidencyManager]")
+{
+    std::string directory = create_temp_directory();
+
+    BackgroundImage_shptr image = create_test_image(directory);
+    ScalingManager_shptr scaling_manager = std::make_shared<ScalingManager<BackgroundImage>>(image, directory, 128);
+    scaling_manager->create_scalings();
+
+    {
+        // Budget of 2 tiles, no prefetch
+        BackgroundResidencyManager manager(scaling_manager, 2 * 256 * 256 * sizeof(rgba_pixel_t), 0, false);
+        REQUIRE(manager.get_max_resident_tiles() == 2);
+
+        manager.set_viewport(BoundingBox(0, 100, 0, 100), 1);
+        REQUIRE(manager.take_loaded_tiles().size() == 1);
+
+        manager.set_viewport(BoundingBox(300, 400, 0, 100), 1);
+        REQUIRE(manager.take_loaded_tiles().size() == 1);
+
+        manager.set_viewport(BoundingBox(0, 100, 300, 400), 1);
+        REQUIRE(manager.take_loaded_tiles().size() == 1);
+
+        // The least recently used tile is evicted
+        REQUIRE(manager.get_resident_count() == 2);
+        REQUIRE_FALSE(manager.is_resident(BackgroundTileKey{1, 0, 0}));
+        REQUIRE(manager.is_resident(BackgroundTileKey{1, 256, 0}));
+        REQUIRE(manager.is_resident(BackgroundTileKey{1, 0, 256}));
+
+        auto evicted = manager.take_evicted_tiles();
+        REQUIRE(evicted.size() == 1);
+        REQUIRE(evicted[0] == (BackgroundTileKey{1, 0, 0}));
+        REQUIRE(manager.take_evicted_tiles().empty());
+
+        // Visible tiles are kept even if they exceed the budget
+        manager.set_viewport(BoundingBox(0, 599, 0, 499), 1);
+        REQUIRE(manager.take_loaded_tiles().size() == 4);
+        REQUIRE(manager.get_resident_count() == 6);
+        REQUIRE(manager.take_evicted_tiles().empty());
+    }
+
+    remove_directory(directory);
+}
@@ -0,0 +1,207 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#include <Core/Image/Image.h>
+#include <Core/Image/CompressedTilePack.h>
+#include <Core/Image/TilePack.h>
+#include <Core/Utils/FileSystem.h>
+
+#include "catch.hpp"
+
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#ifdef __linux__
+#include <csignal>
+#include <sys/resource.h>
+#endif
+
+using namespace degate;
+
+static void fill_tile(std::vector<uint32_t>& tile, unsigned int seed)
+{
+    for (unsigned int i = 0; i < tile.size(); i++)
+        tile[i] = 0xff000000 | ((seed + i / 64) & 0xff) * 0x010101;
+}
+
+TEST_CASE("Test compressed tile pack", "[CompressedTilePack]")
+{
+    std::string directory = create_temp_directory();
+    std::string filename = join_pathes(directory, COMPRESSED_TILE_PACK_FILENAME);
+
+    std::vector<uint32_t> tile(64 * 64), read(64 * 64);
+
+    {
+        CompressedTilePack pack(filename, 6, 4, 3, 4);
+        REQUIRE(pack.get_tile_bytes() == 64 * 64 * 4);
+
+        for (unsigned int y = 0; y < 3; y++)
+            for (unsigned int x = 0; x < 4; x++)
+            {
+                fill_tile(tile, y * 4 + x);
+                pack.write_tile(x, y, tile.data());
+            }
+
+        // Pending tiles are readable.
+        pack.read_tile(3, 2, read.data());
+        REQUIRE(read == tile);
+
+        pack.flush();
+
+        // Smooth content compresses well.
+        REQUIRE(pack.get_compressed_size() < 12 * pack.get_tile_bytes() / 4);
+
+        // Prefetched tiles are handed out once.
+        pack.prefetch(1, 1);
+        pack.read_tile(1, 1, read.data());
+        fill_tile(tile, 5);
+        REQUIRE(read == tile);
+
+        // Overwrite a tile.
+        fill_tile(tile, 100);
+        pack.write_tile(0, 0, tile.data());
+
+        REQUIRE_THROWS(pack.read_tile(4, 0, read.data()));
+    }
+
+    {
+        CompressedTilePack pack(filename, 6, 4, 3, 4);
+
+        pack.read_tile(0, 0, read.data());
+        fill_tile(tile, 100);
+        REQUIRE(read == tile);
+
+        for (unsigned int y = 0; y < 3; y++)
+            for (unsigned int x = 0; x < 4; x++)
+            {
+                pack.prefetch(x + 1, y);
+                pack.read_tile(x, y, read.data());
+                fill_tile(tile, x == 0 && y == 0 ? 100 : y * 4 + x);
+                REQUIRE(read == tile);
+            }
+    }
+
+    // A different tile layout is rejected.
+    REQUIRE_THROWS(CompressedTilePack(filename, 5, 4, 3, 4));
+
+    remove_directory(directory);
+}
+
+#ifdef __linux__
+TEST_CASE("Test compressed tile pack write errors", "[CompressedTilePack]")
+{
+    std::string directory = create_temp_directory();
+    std::string filename = join_pathes(directory, COMPRESSED_TILE_PACK_FILENAME);
+
+    std::vector<uint32_t> tile(64 * 64), read(64 * 64);
+    fill_tile(tile, 7);
+
+    {
+        CompressedTilePack pack(filename, 6, 2, 2, 4);
+        pack.flush();
+
+        // Simulate a full disk: the file can't grow anymore.
+        struct rlimit old_limit, limit;
+        getrlimit(RLIMIT_FSIZE, &old_limit);
+        limit = old_limit;
+        limit.rlim_cur = boost::filesystem::file_size(filename);
+
+        void (*old_handler)(int) = signal(SIGXFSZ, SIG_IGN);
+        setrlimit(RLIMIT_FSIZE, &limit);
+
+        pack.write_tile(1, 0, tile.data());
+
+        bool flushed = true;
+        try
+        {
+            pack.flush();
+        }
+        catch (DegateRuntimeException const&)
+        {
+            flushed = false;
+        }
+
+        setrlimit(RLIMIT_FSIZE, &old_limit);
+        signal(SIGXFSZ, old_handler);
+
+        REQUIRE(flushed == false);
+
+        // The tile is kept in memory.
+        pack.read_tile(1, 0, read.data());
+        REQUIRE(read == tile);
+
+        // Written on the next flush.
+        pack.flush();
+    }
+
+    {
+        CompressedTilePack pack(filename, 6, 2, 2, 4);
+        pack.read_tile(1, 0, read.data());
+        REQUIRE(read == tile);
+    }
+
+    remove_directory(directory);
+}
+#endif
+
+TEST_CASE("Test compressed tile image", "[CompressedTilePack]")
+{
+    std::string directory = create_temp_directory();
+
+    {
+        BackgroundImage_shptr img(new BackgroundImage(200, 150, directory, true, 5));
+        for (unsigned int y = 0; y < 150; y++)
+            for (unsigned int x = 0; x < 200; x++)
+                img->set_pixel(x, y, y * 200 + x);
+    }
+
+    REQUIRE(TilePack::is_tile_pack_directory(directory) == true);
+    REQUIRE(CompressedTilePack::convert_directory(directory) == 1);
+    REQUIRE(TilePack::is_tile_pack_directory(directory) == false);
+    REQUIRE(CompressedTilePack::is_compressed_tile_pack_directory(directory) == true);
+
+    {
+        // Read with read-ahead and modify a part of the image.
+        BackgroundImage_shptr img(new BackgroundImage(200, 150, directory, true, 5));
+        for (unsigned int y = 0; y < 150; y += 3)
+            for (unsigned int x = 0; x < 200; x += 7)
+                REQUIRE(img->get_pixel(x, y) == y * 200 + x);
+
+        for (unsigned int y = 40; y < 80; y++)
+            for (unsigned int x = 40; x < 80; x++)
+                img->set_pixel(x, y, 1);
+    }
+
+    {
+        BackgroundImage_shptr img(new BackgroundImage(200, 150, directory, true, 5));
+        for (unsigned int y = 0; y < 150; y += 3)
+            for (unsigned int x = 0; x < 200; x += 7)
+            {
+                bool modified = x >= 40 && x < 80 && y >= 40 && y < 80;
+                REQUIRE(img->get_pixel(x, y) == (modified ? 1 : y * 200 + x));
+            }
+    }
+
+    remove_directory(directory);
+}
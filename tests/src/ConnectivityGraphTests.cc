@@ -0,0 +1,200 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <Core/LogicModel/LogicModel.h>
+#include <Core/LogicModel/ConnectivityGraph.h>
+
+#include "TestObjectFactory.h"
+#include "catch.hpp"
+
+using namespace degate;
+
+TEST_CASE("Test connectivity graph", "[ConnectivityGraph]")
+{
+    LogicModel_shptr lmodel(new LogicModel(100, 100, 1));
+    TestObjectFactory factory(lmodel);
+
+    Net_shptr n1(new Net()), n2(new Net());
+    lmodel->add_net(n1);
+    lmodel->add_net(n2);
+
+    const auto IN = GateTemplatePort::PORT_TYPE_IN;
+    const auto OUT = GateTemplatePort::PORT_TYPE_OUT;
+
+    // g1 -> n1 -> g2, g4 and g2 -> n2 -> g3, g5 is not connected
+    Gate_shptr g1 = factory.create_gate({OUT}, {n1});
+    Gate_shptr g2 = factory.create_gate({IN, OUT}, {n1, n2});
+    Gate_shptr g3 = factory.create_gate({IN}, {n2});
+    Gate_shptr g4 = factory.create_gate({IN}, {n1});
+    Gate_shptr g5 = factory.create_gate({IN}, {nullptr});
+
+    ConnectivityGraph_shptr graph = lmodel->get_connectivity_graph();
+    REQUIRE(graph != nullptr);
+
+    REQUIRE(graph->get_gates_count() == 5);
+    REQUIRE(graph->get_ports_count() == 6);
+    REQUIRE(graph->get_nets_count() == 2);
+
+    const ConnectivityGraph::index_t i1 = graph->find_gate(g1->get_object_id());
+    const ConnectivityGraph::index_t i2 = graph->find_gate(g2->get_object_id());
+    const ConnectivityGraph::index_t i3 = graph->find_gate(g3->get_object_id());
+    const ConnectivityGraph::index_t i4 = graph->find_gate(g4->get_object_id());
+    const ConnectivityGraph::index_t i5 = graph->find_gate(g5->get_object_id());
+
+    REQUIRE(i1 != ConnectivityGraph::INVALID_INDEX);
+    REQUIRE(graph->get_gate(i1) == g1);
+    REQUIRE(graph->get_gate_id(i4) == g4->get_object_id());
+    REQUIRE(graph->find_gate(n1->get_object_id()) == ConnectivityGraph::INVALID_INDEX);
+
+    SECTION("Ports and nets")
+    {
+        REQUIRE(graph->get_gate_ports_end(i2) - graph->get_gate_ports_begin(i2) == 2);
+
+        const ConnectivityGraph::index_t net = graph->find_net(n1->get_object_id());
+        REQUIRE(net != ConnectivityGraph::INVALID_INDEX);
+        REQUIRE(graph->get_net_ports(net).size() == 3);
+
+        for (auto port : graph->get_net_ports(net))
+            REQUIRE(graph->get_port_net(port) == net);
+
+        const ConnectivityGraph::index_t port = graph->find_port((*g1->ports_begin())->get_object_id());
+        REQUIRE(port != ConnectivityGraph::INVALID_INDEX);
+        REQUIRE(graph->get_port_gate(port) == i1);
+        REQUIRE(graph->get_port_type(port) == OUT);
+
+        // Unconnected port
+        REQUIRE(graph->get_port_net(graph->get_gate_ports_begin(i5)) == ConnectivityGraph::INVALID_INDEX);
+    }
+
+    SECTION("Neighbours")
+    {
+        std::vector<ConnectivityGraph::index_t> fanout;
+        graph->for_each_neighbour(i1, ConnectivityGraph::TRAVERSAL_FANOUT,
+                                  [&](ConnectivityGraph::index_t gate, ConnectivityGraph::index_t, ConnectivityGraph::index_t)
+                                  {
+                                      fanout.push_back(gate);
+                                  });
+
+        std::sort(fanout.begin(), fanout.end());
+        REQUIRE(fanout == std::vector<ConnectivityGraph::index_t>({i2, i4}));
+
+        unsigned int count = 0;
+        graph->for_each_neighbour(i1, ConnectivityGraph::TRAVERSAL_FANIN,
+                                  [&](ConnectivityGraph::index_t, ConnectivityGraph::index_t, ConnectivityGraph::index_t)
+                                  {
+                                      count++;
+                                  });
+
+        REQUIRE(count == 0);
+    }
+
+    SECTION("Cones")
+    {
+        REQUIRE(graph->get_fanout_cone({i1}) == std::vector<ConnectivityGraph::index_t>({i2, i3, i4}));
+        REQUIRE(graph->get_fanout_cone({i1}, 1) == std::vector<ConnectivityGraph::index_t>({i2, i4}));
+        REQUIRE(graph->get_fanin_cone({i3}) == std::vector<ConnectivityGraph::index_t>({i1, i2}));
+        REQUIRE(graph->get_fanin_cone({i1}).empty());
+        REQUIRE(graph->get_fanout_cone({i5}).empty());
+    }
+
+    SECTION("Traversals")
+    {
+        std::vector<unsigned int> depths(graph->get_gates_count(), UINT_MAX);
+
+        graph->breadth_first_search({i4}, ConnectivityGraph::TRAVERSAL_UNDIRECTED,
+                                    [&](ConnectivityGraph::index_t gate, unsigned int depth)
+                                    {
+                                        REQUIRE(depths[gate] == UINT_MAX);
+                                        depths[gate] = depth;
+                                        return true;
+                                    });
+
+        REQUIRE(depths[i4] == 0);
+        REQUIRE(depths[i1] == 1);
+        REQUIRE(depths[i2] == 1);
+        REQUIRE(depths[i3] == 2);
+        REQUIRE(depths[i5] == UINT_MAX);
+
+        std::vector<ConnectivityGraph::index_t> order;
+
+        graph->depth_first_search({i1}, ConnectivityGraph::TRAVERSAL_FANOUT,
+                                  [&](ConnectivityGraph::index_t gate, unsigned int)
+                                  {
+                                      order.push_back(gate);
+                                      return true;
+                                  });
+
+        REQUIRE(order.size() == 4);
+        REQUIRE(order[0] == i1);
+
+        // g3 is only reached through g2, depth first visits it directly after g2.
+        auto g2_position = std::find(order.begin(), order.end(), i2);
+        REQUIRE(g2_position != order.end());
+        REQUIRE(*(g2_position + 1) == i3);
+
+        // Stop the search on g2.
+        order.clear();
+        graph->depth_first_search({i1}, ConnectivityGraph::TRAVERSAL_FANOUT,
+                                  [&](ConnectivityGraph::index_t gate, unsigned int)
+                                  {
+                                      order.push_back(gate);
+                                      return gate != i2;
+                                  });
+
+        REQUIRE(order.size() == 3);
+        REQUIRE(std::find(order.begin(), order.end(), i3) == order.end());
+    }
+}
+
+TEST_CASE("Test connectivity graph updates", "[ConnectivityGraph]")
+{
+    LogicModel_shptr lmodel(new LogicModel(100, 100, 1));
+    TestObjectFactory factory(lmodel);
+
+    Net_shptr net(new Net());
+    lmodel->add_net(net);
+
+    Gate_shptr g1 = factory.create_gate({GateTemplatePort::PORT_TYPE_OUT}, {net});
+    Gate_shptr g2 = factory.create_gate({GateTemplatePort::PORT_TYPE_IN}, {nullptr});
+
+    ConnectivityGraph_shptr graph = lmodel->get_connectivity_graph();
+
+    // The snapshot is cached as long as nothing changes.
+    REQUIRE(lmodel->get_connectivity_graph() == graph);
+    REQUIRE(graph->get_fanout_cone({graph->find_gate(g1->get_object_id())}).empty());
+
+    // Connecting a port is detected.
+    (*g2->ports_begin())->set_net(net);
+
+    ConnectivityGraph_shptr updated = lmodel->get_connectivity_graph();
+    REQUIRE(updated != graph);
+    REQUIRE(updated->get_fanout_cone({updated->find_gate(g1->get_object_id())}).size() == 1);
+
+    // The old snapshot is unchanged.
+    REQUIRE(graph->get_fanout_cone({graph->find_gate(g1->get_object_id())}).empty());
+
+    // Removing a gate is detected.
+    lmodel->remove_object(g2);
+
+    updated = lmodel->get_connectivity_graph();
+    REQUIRE(updated->get_gates_count() == 1);
+    REQUIRE(updated->find_gate(g2->get_object_id()) == ConnectivityGraph::INVALID_INDEX);
+}
@@ -0,0 +1,74 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <Core/Matching/CorrelationKernel.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "catch.hpp"
+
+using namespace degate;
+
+TEST_CASE("Test correlation kernels", "[CorrelationKernel]")
+{
+    REQUIRE(is_correlation_kernel_supported(CORRELATION_KERNEL_SCALAR));
+    REQUIRE(is_correlation_kernel_supported(get_best_correlation_kernel()));
+
+    // Row lengths around the vector sizes, with unaligned starts
+    std::vector<gs_byte_pixel_t> row(300);
+    std::vector<float> tmpl_row(300);
+
+    srand(42);
+    for (unsigned int i = 0; i < row.size(); i++)
+    {
+        row[i] = rand() % 256;
+        tmpl_row[i] = static_cast<float>(rand() % 512) / 2.0f - 128.0f;
+    }
+
+    row_correlation_function scalar = get_row_correlation_function(CORRELATION_KERNEL_SCALAR);
+
+    for (auto kernel : {CORRELATION_KERNEL_SCALAR, CORRELATION_KERNEL_SSE, CORRELATION_KERNEL_AVX2})
+    {
+        if (!is_correlation_kernel_supported(kernel))
+        {
+            REQUIRE_THROWS_AS(get_row_correlation_function(kernel), std::invalid_argument);
+            continue;
+        }
+
+        row_correlation_function correlate_row = get_row_correlation_function(kernel);
+
+        for (unsigned int n : {0u, 1u, 7u, 8u, 15u, 16u, 17u, 31u, 33u, 100u, 255u})
+            for (unsigned int offset : {0u, 1u, 3u})
+            {
+                double expected = 0;
+                for (unsigned int i = 0; i < n; i++)
+                    expected += static_cast<double>(row[offset + i]) * tmpl_row[offset + i];
+
+                REQUIRE(scalar(&row[offset], &tmpl_row[offset], n) == expected);
+
+                // SIMD kernels accumulate in single precision
+                const double result = correlate_row(&row[offset], &tmpl_row[offset], n);
+                REQUIRE(std::fabs(result - expected) <= 1e-5 * (1.0 + std::fabs(expected)) + 1e-2);
+            }
+    }
+}
@@ -0,0 +1,121 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <Core/Matching/ExternalMatchingWorker.h>
+#include <Core/LogicModel/Via/Via.h>
+#include <Core/LogicModel/Wire/Wire.h>
+#include <Core/Utils/FileSystem.h>
+
+#include "catch.hpp"
+
+using namespace degate;
+
+static BackgroundImage_shptr create_worker_test_image(const std::string& directory)
+{
+    BackgroundImage_shptr image = std::make_shared<BackgroundImage>(2500, 1300, directory);
+
+    for (unsigned int y = 0; y < image->get_height(); y++)
+        for (unsigned int x = 0; x < image->get_width(); x++)
+            image->set_pixel(x, y, MERGE_CHANNELS(0, 0, 0, 0xff));
+
+    return image;
+}
+
+static Via_shptr find_via(std::list<PlacedLogicModelObject_shptr> const& objects, int x, int y)
+{
+    for (auto const& o : objects)
+    {
+        Via_shptr via = std::dynamic_pointer_cast<Via>(o);
+        if (via != nullptr && via->get_x() == x && via->get_y() == y) return via;
+    }
+    return Via_shptr();
+}
+
+TEST_CASE("Test external matching worker", "[ExternalMatchingWorker]")
+{
+    std::string directory = create_temp_directory();
+    BackgroundImage_shptr image = create_worker_test_image(directory);
+
+    // the region is split into 3x2 tiles: x from 100, 1124, 2148 and y from 50, 1074
+    const int dots[][3] = {
+        {500, 60, 255},
+        {1200, 1000, 255},
+        {2250, 500, 100},
+        {101, 1100, 255},
+        {2200, 1249, 255}
+    };
+
+    for (auto const& dot : dots)
+        image->set_pixel(dot[0], dot[1], MERGE_CHANNELS(dot[2], dot[2], dot[2], 0xff));
+
+    ExternalMatchingWorker worker(DEGATE_TEST_MATCHING_WORKER);
+    REQUIRE_FALSE(worker.is_running());
+
+    std::list<PlacedLogicModelObject_shptr> objects = worker.match(image, BoundingBox(100, 2300, 50, 1250));
+
+    REQUIRE(worker.is_running());
+    REQUIRE(worker.get_request_count() == 1);
+    REQUIRE(objects.size() == 6);
+
+    for (auto const& dot : dots)
+    {
+        Via_shptr via = find_via(objects, dot[0], dot[1]);
+        REQUIRE(via != nullptr);
+        REQUIRE(via->get_direction() == (dot[2] > 200 ? Via::DIRECTION_UP : Via::DIRECTION_DOWN));
+    }
+
+    // the tile without a dot
+    unsigned int wires = 0;
+    for (auto const& o : objects)
+    {
+        if (Wire_shptr wire = std::dynamic_pointer_cast<Wire>(o))
+        {
+            REQUIRE(wire->get_from_x() == 1124);
+            REQUIRE(wire->get_from_y() == 1074);
+            REQUIRE(wire->get_to_x() == 2147);
+            wires++;
+        }
+    }
+    REQUIRE(wires == 1);
+
+    // the worker process is reused
+    objects = worker.match(image, BoundingBox(2240, 2260, 490, 510));
+    REQUIRE(worker.get_request_count() == 2);
+    REQUIRE(objects.size() == 1);
+    REQUIRE(find_via(objects, 2250, 500) != nullptr);
+
+    // an empty region does not need the worker
+    objects = worker.match(image, BoundingBox(3000, 3100, 0, 100));
+    REQUIRE(objects.empty());
+    REQUIRE(worker.get_request_count() == 2);
+
+    worker.stop();
+    REQUIRE_FALSE(worker.is_running());
+
+    remove_directory(directory);
+}
+
+TEST_CASE("Test external matching worker that can't be started", "[ExternalMatchingWorker]")
+{
+    ExternalMatchingWorker worker("/nonexistent/degate-matching-worker");
+    REQUIRE_THROWS_AS(worker.start(), DegateRuntimeException);
+    REQUIRE_FALSE(worker.is_running());
+}
@@ -24,8 +24,12 @@
 #include <Core/LogicModel/Gate/GateLibrary.h>
 #include <Core/LogicModel/Gate/GateTemplate.h>
 #include <Core/LogicModel/Gate/GateTemplatePort.h>
+#include <Core/Image/ImageHelper.h>
 
 #include <memory>
+#include <ctime>
+
+#include <boost/filesystem.hpp>
 
 #include "catch.hpp"
 
@@ -61,4 +65,165 @@ TEST_CASE("Gate library exporter", "[GateLibraryExporter]")
      */
     GateLibraryImporter reimporter;
     GateLibrary_shptr glib2(reimporter.import(filename));
-}
\ No newline at end of file
+}
+TEST_CASE("Gate library exporter only writes changed images", "[GateLibraryExporter]")
+{
+    GateLibraryImporter importer;
+
+    std::string filename("tests_files/test_project/gate_library.xml");
+    REQUIRE(file_exists(filename) == true);
+
+    GateLibrary_shptr glib(importer.import(filename));
+    REQUIRE(glib != nullptr);
+    REQUIRE(glib->begin() != glib->end());
+
+    GateTemplate_shptr tmpl = glib->begin()->second;
+    REQUIRE(tmpl->images_begin() != tmpl->images_end());
+
+    Layer::LAYER_TYPE layer_type = tmpl->images_begin()->first;
+
+    // Images are decoded on first use.
+    REQUIRE(tmpl->is_image_loaded(layer_type) == false);
+
+    std::string image_file = tmpl->get_image_file(layer_type);
+    REQUIRE(file_exists(image_file) == true);
+
+    std::time_t mtime = boost::filesystem::last_write_time(image_file);
+
+    GateLibraryExporter exporter(std::make_shared<ObjectIDRewriter>(false));
+    exporter.export_data(filename, glib);
+
+    // Unchanged images are neither decoded nor rewritten.
+    REQUIRE(tmpl->is_image_loaded(layer_type) == false);
+    REQUIRE(boost::filesystem::last_write_time(image_file) == mtime);
+
+    // A changed image is written again.
+    GateTemplateImage_shptr img = tmpl->get_image(layer_type);
+    REQUIRE(img != nullptr);
+
+    tmpl->set_image(layer_type, img);
+    REQUIRE(tmpl->get_image_file(layer_type).empty());
+
+    exporter.export_data(filename, glib);
+
+    REQUIRE(get_realpath(tmpl->get_image_file(layer_type)) == get_realpath(image_file));
+}
+
+TEST_CASE("Gate template image files", "[GateLibraryExporter]")
+{
+    GateTemplate_shptr tmpl = std::make_shared<GateTemplate>(10, 10);
+    tmpl->set_object_id(1);
+
+    REQUIRE(tmpl->has_image(Layer::LOGIC) == false);
+    REQUIRE(tmpl->get_image_file(Layer::LOGIC).empty());
+
+    tmpl->set_image_file(Layer::LOGIC, "does_not_exist.tif");
+    unsigned long revision = tmpl->get_image_revision(Layer::LOGIC);
+
+    REQUIRE(tmpl->has_image(Layer::LOGIC) == true);
+    REQUIRE(tmpl->is_image_loaded(Layer::LOGIC) == false);
+    REQUIRE(tmpl->get_image_file(Layer::LOGIC) == "does_not_exist.tif");
+
+    // The image is decoded on access.
+    REQUIRE_THROWS_AS(tmpl->get_image(Layer::LOGIC), InvalidPathException);
+
+    GateTemplate::image_load_list images;
+    images.push_back(std::make_pair(tmpl, Layer::LOGIC));
+    REQUIRE_THROWS_AS(GateTemplate::load_images(images), InvalidPathException);
+
+    // Replacing the image detaches it from its file.
+    tmpl->set_image(Layer::LOGIC, std::make_shared<GateTemplateImage>(10, 10));
+
+    REQUIRE(tmpl->is_image_loaded(Layer::LOGIC) == true);
+    REQUIRE(tmpl->get_image_revision(Layer::LOGIC) > revision);
+    REQUIRE(tmpl->get_image_file(Layer::LOGIC).empty());
+
+    tmpl->set_image_saved(Layer::LOGIC, "saved.tif");
+    REQUIRE(tmpl->get_image_file(Layer::LOGIC) == "saved.tif");
+
+    REQUIRE_THROWS_AS(tmpl->set_image_saved(Layer::METAL, "saved.tif"), CollectionLookupException);
+
+    // Loading skips images that are already in memory.
+    GateTemplate::load_images(images);
+}
+
+TEST_CASE("Gate library saved images of a copy", "[GateLibraryExporter]")
+{
+    GateLibrary_shptr glib = std::make_shared<GateLibrary>();
+
+    GateTemplate_shptr tmpl = std::make_shared<GateTemplate>(10, 10);
+    tmpl->set_object_id(1);
+    tmpl->set_image(Layer::LOGIC, std::make_shared<GateTemplateImage>(10, 10));
+    tmpl->set_image(Layer::METAL, std::make_shared<GateTemplateImage>(10, 10));
+    glib->add_template(tmpl);
+
+    // The images are saved for a copy, as for a project snapshot.
+    DeepCopyable::oldnew_t oldnew;
+    GateLibrary_shptr copy = std::dynamic_pointer_cast<GateLibrary>(glib->cloneDeep(&oldnew));
+    GateTemplate_shptr copy_tmpl = copy->get_template(1);
+
+    copy_tmpl->set_image_saved(Layer::LOGIC, "logic.tif");
+    copy_tmpl->set_image_saved(Layer::METAL, "metal.tif");
+    REQUIRE(tmpl->get_image_file(Layer::LOGIC).empty());
+
+    // An image that changed in the meantime keeps its pending state.
+    tmpl->set_image(Layer::METAL, std::make_shared<GateTemplateImage>(10, 10));
+
+    glib->copy_saved_images(*copy);
+
+    REQUIRE(tmpl->get_image_file(Layer::LOGIC) == "logic.tif");
+    REQUIRE(tmpl->get_image_file(Layer::METAL).empty());
+}
+
+TEST_CASE("Gate library exporter detaches overwritten shared images", "[GateLibraryExporter]")
+{
+    std::string directory = create_temp_directory();
+
+    GateTemplateImage_shptr first_img = std::make_shared<GateTemplateImage>(10, 10);
+    first_img->set_pixel(0, 0, MERGE_CHANNELS(0xff, 0, 0, 0xff));
+
+    GateTemplateImage_shptr second_img = std::make_shared<GateTemplateImage>(10, 10);
+    second_img->set_pixel(0, 0, MERGE_CHANNELS(0, 0xff, 0, 0xff));
+
+    // The second template is backed by "1_logic.tif", the file name the rewritten
+    // object ID 1 of the first template gets.
+    std::string shared_file = join_pathes(directory, "1_logic.tif");
+    save_image<GateTemplateImage>(shared_file, second_img);
+
+    GateLibrary_shptr glib = std::make_shared<GateLibrary>();
+
+    GateTemplate_shptr first = std::make_shared<GateTemplate>(10, 10);
+    first->set_object_id(5);
+    first->set_image(Layer::LOGIC, first_img);
+    glib->add_template(first);
+
+    GateTemplate_shptr second = std::make_shared<GateTemplate>(10, 10);
+    second->set_object_id(7);
+    second->set_image_file(Layer::LOGIC, shared_file);
+    glib->add_template(second);
+
+    // Export a copy, as for a project snapshot.
+    DeepCopyable::oldnew_t oldnew;
+    GateLibrary_shptr copy = std::dynamic_pointer_cast<GateLibrary>(glib->cloneDeep(&oldnew));
+
+    GateTemplate::image_load_list shared_images;
+    shared_images.push_back(std::make_pair(first, Layer::LOGIC));
+    shared_images.push_back(std::make_pair(second, Layer::LOGIC));
+
+    GateLibraryExporter exporter(std::make_shared<ObjectIDRewriter>());
+    exporter.set_shared_images(shared_images);
+    exporter.export_data(join_pathes(directory, "gate_library.xml"), copy);
+
+    // The file now holds the image of the first template, the second one was decoded before.
+    REQUIRE(second->is_image_loaded(Layer::LOGIC) == true);
+    REQUIRE(second->get_image_file(Layer::LOGIC).empty());
+    REQUIRE(second->get_image(Layer::LOGIC)->get_pixel(0, 0) == static_cast<rgba_pixel_t>(MERGE_CHANNELS(0, 0xff, 0, 0xff)));
+
+    // The saved files are taken over afterwards.
+    glib->copy_saved_images(*copy);
+
+    REQUIRE(get_realpath(first->get_image_file(Layer::LOGIC)) == get_realpath(shared_file));
+    REQUIRE(get_realpath(second->get_image_file(Layer::LOGIC)) == get_realpath(join_pathes(directory, "2_logic.tif")));
+
+    remove_directory(directory);
+}
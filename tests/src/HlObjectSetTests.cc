@@ -0,0 +1,154 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#include <Core/LogicModel/LogicModel.h>
+#include <Core/LogicModel/HlObjectSet.h>
+#include <Core/LogicModel/Via/Via.h>
+#include <Core/LogicModel/Net.h>
+
+#include "catch.hpp"
+
+#include <stdexcept>
+
+using namespace degate;
+
+TEST_CASE("Test highlighting of adjacent objects", "[HlObjectSet]")
+{
+    LogicModel_shptr lmodel(new LogicModel(1000, 1000, 1));
+
+    Net_shptr net(new Net());
+    lmodel->add_net(net);
+
+    std::vector<Via_shptr> vias;
+    for (unsigned int i = 0; i < 100; i++)
+    {
+        Via_shptr via(new Via(5 + i * 5, 10, 2));
+        lmodel->add_object(0, via);
+        via->set_net(net);
+        vias.push_back(via);
+    }
+
+    Via_shptr other(new Via(500, 500, 2));
+    lmodel->add_object(0, other);
+
+    std::vector<std::vector<PlacedLogicModelObject_shptr>> updates;
+
+    HlObjectSet set;
+    set.set_objects_update_function([&](std::vector<PlacedLogicModelObject_shptr> const& objects)
+    {
+        updates.push_back(objects);
+    });
+
+    // One update with all objects of the net.
+    set.add(vias[0], lmodel);
+    REQUIRE(updates.size() == 1);
+    REQUIRE(updates[0].size() == 100);
+    REQUIRE(vias[0]->get_highlighted() == PlacedLogicModelObject::HLIGHTSTATE_DIRECT);
+    REQUIRE(vias[99]->get_highlighted() == PlacedLogicModelObject::HLIGHTSTATE_ADJACENT);
+    REQUIRE(other->get_highlighted() == PlacedLogicModelObject::HLIGHTSTATE_NOT);
+
+    // The net is highlighted already, only the selected object changes.
+    set.add(vias[1], lmodel);
+    REQUIRE(updates.size() == 2);
+    REQUIRE(updates[1].size() == 1);
+    REQUIRE(vias[1]->get_highlighted() == PlacedLogicModelObject::HLIGHTSTATE_DIRECT);
+
+    // Another selected object of the net keeps the net highlighted.
+    set.remove(vias[0]);
+    REQUIRE(updates.size() == 3);
+    REQUIRE(updates[2].size() == 1);
+    REQUIRE(vias[0]->get_highlighted() == PlacedLogicModelObject::HLIGHTSTATE_ADJACENT);
+    REQUIRE(vias[50]->get_highlighted() == PlacedLogicModelObject::HLIGHTSTATE_ADJACENT);
+
+    set.remove(vias[1]);
+    REQUIRE(updates.size() == 4);
+    REQUIRE(updates[3].size() == 100);
+    for (auto& via : vias)
+        REQUIRE(via->get_highlighted() == PlacedLogicModelObject::HLIGHTSTATE_NOT);
+
+    // Nothing to report.
+    set.clear();
+    REQUIRE(updates.size() == 4);
+}
+
+TEST_CASE("Test batched highlight updates", "[HlObjectSet]")
+{
+    LogicModel_shptr lmodel(new LogicModel(1000, 1000, 1));
+
+    std::vector<Via_shptr> vias;
+    for (unsigned int i = 0; i < 10; i++)
+    {
+        Via_shptr via(new Via(5 + i * 5, 10, 2));
+        lmodel->add_object(0, via);
+        vias.push_back(via);
+    }
+
+    unsigned int calls = 0;
+    std::vector<PlacedLogicModelObject_shptr> updated;
+
+    HlObjectSet set;
+    set.set_object_update_function([&](PlacedLogicModelObject_shptr o)
+    {
+        calls++;
+        updated.push_back(o);
+    });
+
+    set.begin_update();
+    for (auto& via : vias)
+        set.add(via, lmodel);
+    set.remove(vias[0]);
+    set.add(vias[0]);
+
+    // Nothing is reported before the update ends.
+    REQUIRE(calls == 0);
+
+    set.end_update();
+
+    // Each changed object is reported once.
+    REQUIRE(calls == 10);
+    REQUIRE(set.size() == 10);
+
+    calls = 0;
+    set.clear();
+    REQUIRE(calls == 10);
+    REQUIRE(set.empty());
+    for (auto& via : vias)
+        REQUIRE(via->get_highlighted() == PlacedLogicModelObject::HLIGHTSTATE_NOT);
+
+    // An update guard ends the update, also if an exception is thrown.
+    calls = 0;
+    try
+    {
+        HlObjectSet::update_guard update(set);
+        set.add(vias[0]);
+        throw std::runtime_error("failed");
+    }
+    catch (std::runtime_error const&)
+    {
+    }
+
+    REQUIRE(calls == 1);
+
+    set.add(vias[1]);
+    REQUIRE(calls == 2);
+}
@@ -0,0 +1,269 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <Core/Image/Manipulation/ImageRegistration.h>
+#include <Core/LogicModel/LogicModelHelper.h>
+#include <Core/Utils/FileSystem.h>
+
+#include <cmath>
+
+#include "catch.hpp"
+
+using namespace degate;
+
+/**
+ * Smooth random texture, defined for non integer coordinates.
+ */
+static double get_texture_value(double x, double y)
+{
+    auto hash = [](int x, int y)
+    {
+        unsigned int h = static_cast<unsigned int>(x) * 374761393u + static_cast<unsigned int>(y) * 668265263u;
+        h = (h ^ (h >> 13)) * 1274126177u;
+        return static_cast<double>((h ^ (h >> 16)) & 0xff);
+    };
+
+    double value = 0;
+
+    for (double cell : {23.0, 7.0})
+    {
+        const double cx = x / cell, cy = y / cell;
+        const int ix = static_cast<int>(std::floor(cx)), iy = static_cast<int>(std::floor(cy));
+        const double fx = cx - ix, fy = cy - iy;
+
+        value += 0.5 * ((1 - fy) * ((1 - fx) * hash(ix, iy) + fx * hash(ix + 1, iy)) +
+                        fy * ((1 - fx) * hash(ix, iy + 1) + fx * hash(ix + 1, iy + 1)));
+    }
+
+    return value;
+}
+
+/**
+ * Create a textured image. Pixel (x, y) shows the texture at transform(x, y).
+ */
+static ScalingManager_shptr create_registration_test_image(AffineTransform const& transform)
+{
+    std::string directory = create_temp_directory();
+
+    BackgroundImage_shptr image = std::make_shared<BackgroundImage>(512, 512, directory, true, 8);
+
+    for (unsigned int y = 0; y < image->get_height(); y++)
+        for (unsigned int x = 0; x < image->get_width(); x++)
+        {
+            double tx, ty;
+            transform.apply(x, y, &tx, &ty);
+
+            const unsigned int g = static_cast<unsigned int>(lrint(get_texture_value(tx, ty)));
+            image->set_pixel(x, y, MERGE_CHANNELS(g, g, g, 0xff));
+        }
+
+    ScalingManager_shptr scaling_manager = std::make_shared<ScalingManager<BackgroundImage>>(image, directory, 128);
+    scaling_manager->create_scalings();
+
+    return scaling_manager;
+}
+
+static void check_transform(AffineTransform const& result, AffineTransform const& expected, double tolerance)
+{
+    const double points[][2] = {{0, 0}, {511, 0}, {0, 511}, {511, 511}, {256, 256}};
+
+    for (auto const& p : points)
+    {
+        double rx, ry, ex, ey;
+        result.apply(p[0], p[1], &rx, &ry);
+        expected.apply(p[0], p[1], &ex, &ey);
+
+        REQUIRE(std::abs(rx - ex) < tolerance);
+        REQUIRE(std::abs(ry - ey) < tolerance);
+    }
+}
+
+TEST_CASE("Test affine transform", "[ImageRegistration]")
+{
+    const AffineTransform rotation = AffineTransform::rotation(0.1, 12.5, -3);
+    const AffineTransform translation = AffineTransform::translation(4, 8);
+
+    REQUIRE(AffineTransform().is_identity());
+    REQUIRE(!rotation.is_identity());
+
+    const AffineTransform identity = rotation * rotation.inverse();
+    REQUIRE(identity.get_a() == Approx(1));
+    REQUIRE(identity.get_b() == Approx(0).margin(1e-12));
+    REQUIRE(identity.get_tx() == Approx(0).margin(1e-9));
+    REQUIRE(identity.get_ty() == Approx(0).margin(1e-9));
+
+    // the right transform is applied first
+    double x, y;
+    (translation * rotation).apply(3, 7, &x, &y);
+
+    double ex, ey;
+    rotation.apply(3, 7, &ex, &ey);
+    REQUIRE(x == Approx(ex + 4));
+    REQUIRE(y == Approx(ey + 8));
+
+    // serialization
+    REQUIRE(AffineTransform::from_string(rotation.to_string()) == rotation);
+    REQUIRE_THROWS_AS(AffineTransform::from_string("1 0 0"), DegateRuntimeException);
+    REQUIRE_THROWS_AS(AffineTransform(0, 0, 0, 0, 1, 1).inverse(), DegateRuntimeException);
+
+    // scaled coordinates
+    rotation.scaled(4).apply(10, 20, &x, &y);
+    rotation.apply(40, 80, &ex, &ey);
+    REQUIRE(x == Approx(ex / 4));
+    REQUIRE(y == Approx(ey / 4));
+}
+
+TEST_CASE("Test aligned tile image", "[ImageRegistration]")
+{
+    std::string directory = create_temp_directory();
+
+    BackgroundImage_shptr image = std::make_shared<BackgroundImage>(300, 200, directory, true, 6);
+
+    for (unsigned int y = 0; y < image->get_height(); y++)
+        for (unsigned int x = 0; x < image->get_width(); x++)
+            image->set_pixel(x, y, MERGE_CHANNELS((x & 0xff), (y & 0xff), ((x + y) & 0xff), 0xff));
+
+    image->set_alignment(AffineTransform::translation(10, 5));
+
+    // pixel (x, y) of the image is shown at (x + 10, y + 5)
+    REQUIRE(image->get_pixel(10, 5) == static_cast<rgba_pixel_t>(MERGE_CHANNELS(0, 0, 0, 0xff)));
+    REQUIRE(image->get_pixel(110, 55) == static_cast<rgba_pixel_t>(MERGE_CHANNELS(100, 50, 150, 0xff)));
+    REQUIRE(image->get_pixel(299, 199) == static_cast<rgba_pixel_t>(MERGE_CHANNELS((289 & 0xff), 194, ((289 + 194) & 0xff), 0xff)));
+
+    // outside of the image
+    REQUIRE(image->get_pixel(5, 5) == 0);
+    REQUIRE(image->get_pixel(10, 2) == 0);
+
+    std::vector<rgba_pixel_t> row(20);
+    image->raw_copy_row(row.data(), 100, 55, row.size());
+    for (unsigned int i = 0; i < row.size(); i++)
+        REQUIRE(row[i] == MERGE_CHANNELS(90 + i, 50, 140 + i, 0xff));
+
+    image->set_alignment(AffineTransform());
+    REQUIRE(image->get_pixel(110, 55) == static_cast<rgba_pixel_t>(MERGE_CHANNELS(110, 55, 165, 0xff)));
+}
+
+TEST_CASE("Test phase correlation", "[ImageRegistration]")
+{
+    const unsigned int size = 64;
+    std::vector<float> reference(size * size), moving(size * size);
+
+    for (unsigned int y = 0; y < size; y++)
+        for (unsigned int x = 0; x < size; x++)
+        {
+            reference[y * size + x] = static_cast<float>(get_texture_value(x + 100, y + 100));
+            moving[y * size + x] = static_cast<float>(get_texture_value(x + 100 - 5, y + 100 + 3));
+        }
+
+    // moving(x + 5, y - 3) == reference(x, y)
+    double dx, dy;
+    double peak = phase_correlation(reference, moving, size, &dx, &dy);
+
+    REQUIRE(peak > IMAGE_REGISTRATION_MIN_PEAK);
+    REQUIRE(dx == Approx(5).margin(0.5));
+    REQUIRE(dy == Approx(-3).margin(0.5));
+}
+
+TEST_CASE("Test affine transform fit", "[ImageRegistration]")
+{
+    const AffineTransform expected = AffineTransform::rotation(0.05, 20, -10);
+
+    std::vector<PointCorrespondence> correspondences;
+    for (unsigned int y = 0; y < 5; y++)
+        for (unsigned int x = 0; x < 5; x++)
+        {
+            PointCorrespondence p;
+            p.moving_x = x * 100;
+            p.moving_y = y * 100;
+            expected.apply(p.moving_x, p.moving_y, &p.reference_x, &p.reference_y);
+            correspondences.push_back(p);
+        }
+
+    // an outlier
+    correspondences[7].reference_x += 50;
+
+    check_transform(fit_affine_transform(correspondences), expected, 0.01);
+
+    // two points: translation only
+    correspondences.resize(2);
+    check_transform(fit_affine_transform(correspondences), AffineTransform::translation(20, -10), 30);
+
+    REQUIRE(fit_affine_transform(std::vector<PointCorrespondence>()).is_identity());
+}
+
+TEST_CASE("Test image registration", "[ImageRegistration]")
+{
+    // The texture coordinates of the moving images: moving(x, y) shows the texture at transform(x, y).
+    const AffineTransform translation = AffineTransform::translation(13, -21);
+    const AffineTransform rotation = AffineTransform::rotation(0.02, -7, 9);
+
+    std::vector<ScalingManager_shptr> images;
+    images.push_back(create_registration_test_image(AffineTransform()));
+    images.push_back(create_registration_test_image(translation));
+    images.push_back(create_registration_test_image(rotation));
+
+    std::vector<AffineTransform> result = register_images(images);
+
+    REQUIRE(result.size() == 3);
+    REQUIRE(result[0].is_identity());
+    check_transform(result[1], translation, 1.0);
+    check_transform(result[2], rotation, 1.5);
+
+    // Aligned images show the texture at their project coordinates.
+    images[2]->set_alignment(result[2]);
+    BackgroundImage_shptr aligned = images[2]->get_image(1).second;
+
+    for (unsigned int y = 100; y < 400; y += 37)
+        for (unsigned int x = 100; x < 400; x += 41)
+            REQUIRE(std::abs(static_cast<int>(aligned->get_pixel_as<gs_byte_pixel_t>(x, y)) -
+                             lrint(get_texture_value(x, y))) < 24);
+}
+
+TEST_CASE("Test layer alignment", "[ImageRegistration]")
+{
+    const AffineTransform translation = AffineTransform::translation(-9, 14);
+
+    LogicModel_shptr lmodel(new LogicModel(512, 512, 2));
+    Layer_shptr layer0 = lmodel->get_layer(0);
+    Layer_shptr layer1 = lmodel->get_layer(1);
+
+    layer0->set_image(create_registration_test_image(AffineTransform())->get_image(1).second);
+    layer1->set_image(create_registration_test_image(translation)->get_image(1).second);
+
+    align_layers(lmodel);
+
+    REQUIRE(layer0->get_alignment().is_identity());
+    check_transform(layer1->get_alignment(), translation, 1.0);
+
+    // A failed registration keeps the previous alignments.
+    const AffineTransform alignment0 = AffineTransform::translation(1, 2);
+    const AffineTransform alignment1 = AffineTransform::rotation(0.01, 3, 4);
+    layer0->set_alignment(alignment0);
+
+    std::string missing_directory = create_temp_directory();
+    layer1->set_image_directory(missing_directory, 512, 512);
+    layer1->set_alignment(alignment1);
+    remove_directory(missing_directory);
+
+    REQUIRE_THROWS(align_layers(lmodel));
+    REQUIRE(layer0->get_alignment() == alignment0);
+    REQUIRE(layer1->get_alignment() == alignment1);
+}
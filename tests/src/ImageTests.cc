@@ -24,6 +24,7 @@
 #include <Core/Image/TIFFReader.h>
 #include <Core/Image/TIFFWriter.h>
 #include <Core/Image/ImageReaderFactory.h>
+#include <Core/Image/ImageHistogram.h>
 
 #include "catch.hpp"
 
@@ -56,6 +57,62 @@ TEST_CASE("Test rgba in temporary file", "[ImageTests]")
     REQUIRE(MASK_A(p) == 26);
 }
 
+TEST_CASE("Test temporary image storage", "[ImageTests]")
+{
+    TempStoragePool& pool = TempStoragePool::get_instance();
+
+    const size_t budget = pool.get_memory_budget();
+    const size_t small_size = pool.get_small_buffer_size();
+
+    pool.clear();
+    pool.set_memory_budget(100 * 100 * sizeof(double));
+    pool.set_small_buffer_size(20 * 20 * sizeof(double));
+    pool.reset_statistics();
+
+    {
+        // Fits into the budget.
+        TempImage_GS_DOUBLE img(100, 100);
+        REQUIRE(!img.is_stored_in_file());
+        REQUIRE(img.get_pixel(99, 99) == 0);
+        img.set_pixel(99, 99, 0.5);
+        REQUIRE(img.get_pixel(99, 99) == 0.5);
+
+        // Exceeds the budget.
+        TempImage_GS_DOUBLE large(100, 10);
+        REQUIRE(large.is_stored_in_file());
+        large.set_pixel(99, 9, 0.25);
+        REQUIRE(large.get_pixel(99, 9) == 0.25);
+
+        // Small images are always in memory.
+        TempImage_GS_BYTE small(20, 20);
+        REQUIRE(!small.is_stored_in_file());
+
+        TempStoragePool::statistics stats = pool.get_statistics();
+        REQUIRE(stats.memory_buffers == 2);
+        REQUIRE(stats.temp_files_created == 1);
+        REQUIRE(stats.memory_in_use == 100 * 100 * sizeof(double) + 20 * 20);
+    }
+
+    TempStoragePool::statistics stats = pool.get_statistics();
+    REQUIRE(stats.temp_files_removed == 1);
+    REQUIRE(stats.memory_in_use == 0);
+    REQUIRE(stats.idle_memory == 100 * 100 * sizeof(double));
+
+    {
+        // The buffer is reused and cleared.
+        TempImage_GS_DOUBLE img(100, 100);
+        REQUIRE(!img.is_stored_in_file());
+        REQUIRE(img.get_pixel(99, 99) == 0);
+        REQUIRE(pool.get_statistics().reused_buffers == 1);
+    }
+
+    pool.clear();
+    REQUIRE(pool.get_statistics().idle_memory == 0);
+
+    pool.set_memory_budget(budget);
+    pool.set_small_buffer_size(small_size);
+}
+
 TEST_CASE("Test type traits", "[ImageTests]")
 {
     REQUIRE(degate::is_pointer<TileImage_RGBA>::value == false);
@@ -162,4 +219,60 @@ TEST_CASE("Test pixel conversion", "[ImageTests]")
 
     rgba_pixel_t rd = convert_pixel<rgba_pixel_t, gs_double_pixel_t>(4.0);
     REQUIRE((unsigned)MERGE_CHANNELS(4, 4, 4, 255) == rd);
-}
\ No newline at end of file
+}
+
+TEST_CASE("Test image histogram", "[ImageTests]")
+{
+    TileImage_RGBA_shptr img(new TileImage_RGBA(600, 500, 8));
+
+    for (unsigned int y = 0; y < img->get_height(); y++)
+        for (unsigned int x = 0; x < img->get_width(); x++)
+            img->set_pixel(x, y, MERGE_CHANNELS(x % 256, y % 256, 0, 255));
+
+    RedChannelImageHistogram area_hist, pixel_hist;
+    BoundingBox bb(3, 599, 7, 499);
+
+    area_hist.add_area(img, bb);
+
+    for (unsigned int y = 7; y <= 499; y++)
+        for (unsigned int x = 3; x <= 599; x++)
+            pixel_hist.add(MASK_R(img->get_pixel(x, y)));
+
+    REQUIRE(area_hist.get_counts() == pixel_hist.get_counts());
+
+    for (unsigned int v = 0; v < 255; v++)
+        REQUIRE(area_hist.get(v) == Approx(pixel_hist.get(v)));
+
+    // Merging two equal histograms doesn't change the frequencies.
+    area_hist.merge(pixel_hist);
+    REQUIRE(area_hist.get_counts() == 2 * pixel_hist.get_counts());
+    REQUIRE(area_hist.get(42) == Approx(pixel_hist.get(42)));
+
+    // The upper boundary has its own class, values beyond are put into the last class.
+    SaturationImageHistogram sat_hist;
+    sat_hist.add(1.0);
+    REQUIRE(sat_hist.get(1.0) == Approx(1.0));
+    REQUIRE(sat_hist.get(0.995) == Approx(0));
+    REQUIRE(sat_hist.get(2.0) == Approx(1.0));
+}
+
+TEST_CASE("Test image histogram edge values", "[ImageTests]")
+{
+    RedChannelImageHistogram hist;
+
+    hist.add(0);
+    hist.add(254);
+    hist.add(255);
+    hist.add(255);
+
+    REQUIRE(hist.get(0) == Approx(0.25));
+    REQUIRE(hist.get(1) == Approx(0));
+    REQUIRE(hist.get(254) == Approx(0.25));
+    REQUIRE(hist.get(255) == Approx(0.5));
+
+    HueImageHistogram hue_hist;
+    hue_hist.add(359);
+    hue_hist.add(360);
+    REQUIRE(hue_hist.get(359) == Approx(0.5));
+    REQUIRE(hue_hist.get(360) == Approx(0.5));
+}
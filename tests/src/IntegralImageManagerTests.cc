@@ -0,0 +1,234 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <Core/Image/Manipulation/IntegralImageManager.h>
+#include <Core/Image/Manipulation/IntegralBand.h>
+#include <Core/Image/Manipulation/ImageManipulation.h>
+#include <Core/Image/TilePack.h>
+#include <Core/Utils/FileSystem.h>
+
+#include "catch.hpp"
+
+using namespace degate;
+
+static BackgroundImage_shptr create_integral_test_image(const std::string& directory)
+{
+    // 700x600 image with 256x256 tiles
+    BackgroundImage_shptr image = std::make_shared<BackgroundImage>(700, 600, directory, true, 8);
+
+    for (unsigned int y = 0; y < image->get_height(); y++)
+        for (unsigned int x = 0; x < image->get_width(); x++)
+            image->set_pixel(x, y, MERGE_CHANNELS((x * 7 + y) & 0xff, (x ^ y) & 0xff, (x * y) & 0xff, 0xff));
+
+    return image;
+}
+
+static void check_integral_image(IntegralImage_shptr integral_image, BackgroundImage_shptr image)
+{
+    REQUIRE(integral_image->get_width() == image->get_width());
+    REQUIRE(integral_image->get_height() == image->get_height());
+
+    for (unsigned int y = 0; y < image->get_height(); y += 13)
+        for (unsigned int x = 0; x < image->get_width(); x += 17)
+            REQUIRE(integral_image->get_pixel(x, y) == image->get_pixel_as<gs_byte_pixel_t>(x, y));
+
+    const unsigned int rectangles[][4] = {
+        {0, 0, 0, 0},
+        {0, 0, 699, 599},
+        {10, 20, 300, 280},
+        {250, 250, 260, 270},
+        {511, 100, 699, 599},
+        {699, 599, 699, 599}
+    };
+
+    for (auto const& r : rectangles)
+    {
+        uint64_t sum = 0, squared_sum = 0;
+
+        for (unsigned int y = r[1]; y <= r[3]; y++)
+            for (unsigned int x = r[0]; x <= r[2]; x++)
+            {
+                uint64_t g = image->get_pixel_as<gs_byte_pixel_t>(x, y);
+                sum += g;
+                squared_sum += g * g;
+            }
+
+        REQUIRE(integral_image->get_sum(r[0], r[1], r[2], r[3]) == sum);
+        REQUIRE(integral_image->get_squared_sum(r[0], r[1], r[2], r[3]) == squared_sum);
+    }
+
+    double avg, stddev;
+    integral_image->get_average_and_stddev(5, 5, 5, 5, &avg, &stddev);
+    REQUIRE(avg == Approx(image->get_pixel_as<gs_byte_pixel_t>(5, 5)));
+    REQUIRE(stddev == Approx(0));
+}
+
+TEST_CASE("Test integral image computation", "[IntegralImageManager]")
+{
+    std::string directory = create_temp_directory();
+
+    BackgroundImage_shptr image = create_integral_test_image(directory);
+    ScalingManager_shptr scaling_manager = std::make_shared<ScalingManager<BackgroundImage>>(image, directory, 128);
+    scaling_manager->create_scalings();
+
+    IntegralImageManager manager(scaling_manager, directory);
+
+    auto normal = manager.get_integral_image(1);
+    REQUIRE(normal.first == 1);
+    check_integral_image(normal.second, image);
+
+    // Same object for the next requests
+    REQUIRE(manager.get_integral_image(1).second == normal.second);
+
+    // Scaled level
+    auto scaled = manager.get_integral_image(4);
+    REQUIRE(scaled.first == 4);
+    REQUIRE(scaled.second->get_width() == scaling_manager->get_image(4).second->get_width());
+    REQUIRE(scaled.second->get_sum(0, 0, 0, 0) == scaling_manager->get_image(4).second->get_pixel_as<gs_byte_pixel_t>(0, 0));
+
+    remove_directory(directory);
+}
+
+TEST_CASE("Test integral image persistence and invalidation", "[IntegralImageManager]")
+{
+    std::string directory = create_temp_directory();
+
+    BackgroundImage_shptr image = create_integral_test_image(directory);
+    ScalingManager_shptr scaling_manager = std::make_shared<ScalingManager<BackgroundImage>>(image, directory, 128);
+    scaling_manager->create_scalings();
+
+    {
+        IntegralImageManager manager(scaling_manager, directory);
+        manager.get_integral_image(1);
+    }
+
+    REQUIRE(file_exists(join_pathes(directory, "integral_1.info")));
+
+    // Stored integral image is reused
+    {
+        IntegralImageManager manager(scaling_manager, directory);
+        check_integral_image(manager.get_integral_image(1).second, image);
+    }
+
+    // Modified image
+    {
+        IntegralImageManager manager(scaling_manager, directory);
+        manager.get_integral_image(1);
+
+        image->set_pixel(3, 4, MERGE_CHANNELS(0xff, 0xff, 0xff, 0xff));
+        manager.invalidate();
+        REQUIRE_FALSE(file_exists(join_pathes(directory, "integral_1.info")));
+
+        IntegralImage_shptr integral_image = manager.get_integral_image(1).second;
+        REQUIRE(integral_image->get_pixel(3, 4) == 0xff);
+        check_integral_image(integral_image, image);
+    }
+
+    remove_directory(directory);
+}
+
+TEST_CASE("Test integral images of replaced packed images", "[IntegralImageManager]")
+{
+    std::string directory = create_temp_directory();
+
+    {
+        BackgroundImage_shptr image = create_integral_test_image(directory);
+        ScalingManager_shptr scaling_manager = std::make_shared<ScalingManager<BackgroundImage>>(image, directory, 128);
+
+        IntegralImageManager manager(scaling_manager, directory);
+        manager.get_integral_image(1);
+    }
+
+    REQUIRE(file_exists(join_pathes(directory, TILE_PACK_FILENAME)));
+    REQUIRE(file_exists(join_pathes(directory, "integral_1.info")));
+
+    // Replace the tile pack file by an image of the same size, the integral image files are kept.
+    remove_file(join_pathes(directory, TILE_PACK_FILENAME));
+
+    BackgroundImage_shptr image = std::make_shared<BackgroundImage>(700, 600, directory, true, 8);
+    for (unsigned int y = 0; y < image->get_height(); y++)
+        for (unsigned int x = 0; x < image->get_width(); x++)
+            image->set_pixel(x, y, MERGE_CHANNELS(((x + y) & 0xff), 0, 0, 0xff));
+
+    ScalingManager_shptr scaling_manager = std::make_shared<ScalingManager<BackgroundImage>>(image, directory, 128);
+    IntegralImageManager manager(scaling_manager, directory);
+
+    check_integral_image(manager.get_integral_image(1).second, image);
+
+    remove_directory(directory);
+}
+
+TEST_CASE("Test integral bands", "[IntegralImageManager]")
+{
+    std::string directory = create_temp_directory();
+
+    BackgroundImage_shptr image = create_integral_test_image(directory);
+    ScalingManager_shptr scaling_manager = std::make_shared<ScalingManager<BackgroundImage>>(image, directory, 128);
+    scaling_manager->create_scalings();
+
+    IntegralImageManager manager(scaling_manager, directory);
+    IntegralImage_shptr integral_image = manager.get_integral_image(1).second;
+
+    IntegralBand band;
+
+    // A row band and a column band, the second load reuses the buffers.
+    const unsigned int bands[][4] = {
+        {0, 250, 700, 40},
+        {300, 0, 30, 600}
+    };
+
+    for (auto const& b : bands)
+    {
+        REQUIRE(band.load(image, b[0], b[1], b[2], b[3]));
+        REQUIRE(band.get_min_x() == b[0]);
+        REQUIRE(band.get_min_y() == b[1]);
+        REQUIRE(band.get_width() == b[2]);
+        REQUIRE(band.get_height() == b[3]);
+
+        REQUIRE(band.contains(b[0], b[1], b[2], b[3]));
+        REQUIRE_FALSE(band.contains(b[0], b[1], b[2] + 1, b[3]));
+        REQUIRE_FALSE(band.contains(b[0] + 1, b[1], b[2], b[3]));
+        REQUIRE_FALSE((b[1] > 0 && band.contains(b[0], b[1] - 1, 1, 1)));
+
+        for (unsigned int y = b[1]; y < b[1] + b[3]; y += 7)
+            for (unsigned int x = b[0]; x < b[0] + b[2]; x += 11)
+            {
+                REQUIRE(band.get_pixel(x, y) == integral_image->get_pixel(x, y));
+
+                const unsigned int max_x = std::min(x + 17, b[0] + b[2] - 1);
+                const unsigned int max_y = std::min(y + 9, b[1] + b[3] - 1);
+
+                REQUIRE(band.get_sum(x, y, max_x, max_y) == integral_image->get_sum(x, y, max_x, max_y));
+                REQUIRE(band.get_squared_sum(x, y, max_x, max_y) ==
+                        integral_image->get_squared_sum(x, y, max_x, max_y));
+            }
+    }
+
+    // Clipped to the image
+    REQUIRE(band.load(image, 690, 590, 100, 100));
+    REQUIRE(band.get_width() == 10);
+    REQUIRE(band.get_height() == 10);
+    REQUIRE(band.get_sum(690, 590, 699, 599) == integral_image->get_sum(690, 590, 699, 599));
+
+    REQUIRE_FALSE(band.load(image, 700, 0, 10, 10));
+
+    remove_directory(directory);
+}
@@ -0,0 +1,219 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+#include <Core/LogicModel/LogicModel.h>
+#include <Core/LogicModel/LayerLoader.h>
+#include <Core/LogicModel/Via/Via.h>
+#include <Core/LogicModel/Net.h>
+#include <Core/Utils/FileSystem.h>
+
+#include "catch.hpp"
+
+using namespace degate;
+
+TEST_CASE("Test deferred object indexing", "[Layer]")
+{
+    LogicModel_shptr lmodel(new LogicModel(100, 100, 2));
+
+    Layer_shptr layer0 = lmodel->get_layer(0);
+    Layer_shptr layer1 = lmodel->get_layer(1);
+
+    layer0->defer_object_indexing();
+    layer1->defer_object_indexing();
+
+    // A net that spans both layers.
+    Net_shptr net(new Net());
+    lmodel->add_net(net);
+
+    Via_shptr via0(new Via(20, 20, 5, Via::DIRECTION_DOWN));
+    Via_shptr via1(new Via(20, 20, 5, Via::DIRECTION_UP));
+    lmodel->add_object(0, via0);
+    lmodel->add_object(1, via1);
+    via0->set_net(net);
+    via1->set_net(net);
+
+    for (unsigned int i = 0; i < 50; i++)
+        lmodel->add_object(0, Via_shptr(new Via(30 + i, 60, 2)));
+
+    REQUIRE(layer0->has_pending_objects() == true);
+    REQUIRE(layer1->has_pending_objects() == true);
+    REQUIRE(layer0->is_empty() == false);
+
+    // Objects are known to the logic model before the quadtree is built.
+    REQUIRE(lmodel->get_object(via0->get_object_id()) == via0);
+    REQUIRE(net->size() == 2);
+
+    // A spatial query builds the index.
+    REQUIRE(layer0->get_object_at_position(20, 20) == via0);
+    REQUIRE(layer0->has_pending_objects() == false);
+
+    unsigned int count = 0;
+    for (Layer::qt_region_iterator iter = layer0->region_begin(0, 100, 0, 100); iter != layer0->region_end(); ++iter)
+        count++;
+    REQUIRE(count == 51);
+
+    // The other layer is still pending, but the net is complete.
+    REQUIRE(layer1->has_pending_objects() == true);
+    REQUIRE(via1->get_net() == net);
+
+    // Objects can be removed before the index is built.
+    lmodel->remove_object(via1);
+    REQUIRE(layer1->has_pending_objects() == false);
+    REQUIRE(layer1->objects_begin() == layer1->objects_end());
+    REQUIRE(net->size() == 1);
+
+    // Adding objects after the index was built inserts them directly.
+    lmodel->add_object(0, Via_shptr(new Via(80, 80, 2)));
+    REQUIRE(layer0->has_pending_objects() == false);
+    REQUIRE(layer0->get_object_at_position(80, 80) != nullptr);
+}
+
+TEST_CASE("Test layer loader", "[Layer]")
+{
+    LogicModel_shptr lmodel(new LogicModel(100, 100, 3));
+
+    std::vector<Layer_shptr> layers;
+    for (unsigned int i = 0; i < 3; i++)
+    {
+        Layer_shptr layer = lmodel->get_layer(i);
+        layer->defer_object_indexing();
+        lmodel->add_object(i, Via_shptr(new Via(10 + i, 10, 2)));
+        layers.push_back(layer);
+    }
+
+    LayerLoader loader(0);
+    loader.start(layers);
+    loader.wait_loaded();
+
+    REQUIRE(loader.is_loaded() == true);
+    for (auto& layer : layers)
+        REQUIRE(layer->has_pending_objects() == false);
+
+    loader.stop();
+}
+
+TEST_CASE("Test layer loader with background images", "[Layer]")
+{
+    const unsigned int size = 512;
+
+    auto write_image = [&](std::string const& directory, unsigned int layer_pos)
+    {
+        BackgroundImage_shptr img(new BackgroundImage(size, size, directory, true));
+        for (unsigned int y = 0; y < size; y++)
+            for (unsigned int x = 0; x < size; x++)
+                img->set_pixel(x, y, MERGE_CHANNELS((x & 0xff), (y & 0xff), layer_pos, 255));
+    };
+
+    std::vector<std::string> directories;
+    std::vector<Layer_shptr> layers;
+
+    for (unsigned int i = 0; i < 3; i++)
+    {
+        directories.push_back(create_temp_directory());
+        write_image(directories[i], i);
+
+        Layer_shptr layer(new Layer(BoundingBox(size, size), Layer::LOGIC));
+        layer->set_image_directory(directories[i], size, size);
+        layers.push_back(layer);
+    }
+
+    // The current layer is used while the loader builds the images of the other layers.
+    BackgroundImage_shptr current = layers[0]->get_image();
+
+    LayerLoader loader(0);
+    loader.start(std::vector<Layer_shptr>(layers.begin() + 1, layers.end()));
+
+    unsigned int errors = 0;
+    while (!loader.is_loaded())
+    {
+        for (unsigned int y = 0; y < size; y += 3)
+            for (unsigned int x = 0; x < size; x += 5)
+                if (current->get_pixel(x, y) != MERGE_CHANNELS((x & 0xff), (y & 0xff), 0, 255))
+                    errors++;
+    }
+
+    loader.wait_loaded();
+    REQUIRE(errors == 0);
+
+    for (unsigned int i = 1; i < 3; i++)
+    {
+        REQUIRE(layers[i]->is_image_loaded() == true);
+        REQUIRE(layers[i]->get_image()->get_pixel(300, 200) == MERGE_CHANNELS((300 & 0xff), 200, i, 255));
+    }
+
+    loader.stop();
+    current.reset();
+    layers.clear();
+
+    for (auto const& directory : directories)
+        remove_directory(directory);
+}
+
+TEST_CASE("Test lazy background image", "[Layer]")
+{
+    std::string img_dir(create_temp_directory());
+
+    {
+        BackgroundImage_shptr img(new BackgroundImage(64, 64, img_dir, true));
+        for (unsigned int y = 0; y < 64; y++)
+            for (unsigned int x = 0; x < 64; x++)
+                img->set_pixel(x, y, MERGE_CHANNELS(x, y, 0, 255));
+
+        Layer layer(BoundingBox(64, 64), Layer::LOGIC);
+        layer.set_image(img);
+    }
+
+    Layer_shptr layer(new Layer(BoundingBox(64, 64), Layer::LOGIC));
+    layer->set_image_directory(img_dir, 64, 64);
+
+    REQUIRE(layer->has_background_image() == true);
+    REQUIRE(layer->is_image_loaded() == false);
+    REQUIRE(layer->get_image_filename() == img_dir);
+
+    // The image is loaded on first access.
+    BackgroundImage_shptr img = layer->get_image();
+    REQUIRE(layer->is_image_loaded() == true);
+    REQUIRE(img->get_pixel(10, 20) == static_cast<rgba_pixel_t>(MERGE_CHANNELS(10, 20, 0, 255)));
+
+    // Images that are in use are not released.
+    REQUIRE(layer->release_unused_image(0) == false);
+    img.reset();
+
+    REQUIRE(layer->release_unused_image(0) == true);
+    REQUIRE(layer->is_image_loaded() == false);
+
+    REQUIRE(layer->get_scaling_manager() != nullptr);
+    REQUIRE(layer->is_image_loaded() == true);
+    REQUIRE(layer->get_image()->get_pixel(10, 20) == static_cast<rgba_pixel_t>(MERGE_CHANNELS(10, 20, 0, 255)));
+
+    // Not idle long enough.
+    REQUIRE(layer->release_unused_image(3600) == false);
+
+    ScalingManager_shptr smgr = layer->get_scaling_manager();
+    REQUIRE(layer->release_unused_image(0) == false);
+    smgr.reset();
+
+    REQUIRE(layer->release_unused_image(0) == true);
+
+    layer->unset_image();
+    REQUIRE(layer->has_background_image() == false);
+}
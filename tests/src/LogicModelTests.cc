@@ -22,6 +22,8 @@
 #include <Core/LogicModel/Wire/Wire.h>
 #include <Core/LogicModel/LogicModel.h>
 
+#include <set>
+
 #include "catch.hpp"
 
 using namespace degate;
@@ -125,4 +127,143 @@ TEST_CASE("Test add and retrieve wire", "[LogicModel]")
     }
 
     REQUIRE(i > 0);
-}
\ No newline at end of file
+}
+/**
+ * Get the IDs of the objects of a layer in a region, through the quadtree.
+ */
+static std::set<object_id_t> get_region_ids(Layer_shptr layer, BoundingBox const& bbox)
+{
+    std::set<object_id_t> ids;
+    for (Layer::qt_region_iterator iter = layer->region_begin(bbox); iter != layer->region_end(); ++iter)
+        ids.insert((*iter)->get_object_id());
+    return ids;
+}
+
+TEST_CASE("Test deep clone", "[LogicModel]")
+{
+    LogicModel_shptr lmodel(new LogicModel(1000, 1000, 2));
+
+    GateTemplate_shptr tmpl(new GateTemplate(10, 10));
+    tmpl->set_object_id(lmodel->get_new_object_id());
+    for (auto type : {GateTemplatePort::PORT_TYPE_IN, GateTemplatePort::PORT_TYPE_OUT})
+    {
+        GateTemplatePort_shptr tmpl_port(new GateTemplatePort(type == GateTemplatePort::PORT_TYPE_IN ? 1 : 8, 5, type));
+        tmpl_port->set_object_id(lmodel->get_new_object_id());
+        tmpl->add_template_port(tmpl_port);
+    }
+    lmodel->add_gate_template(tmpl);
+
+    // A row of gates connected by wires and vias, plus emarkers and annotations.
+    GatePort_shptr previous;
+    for (unsigned int i = 0; i < 300; i++)
+    {
+        const unsigned int x = (i % 30) * 30 + 5, y = (i / 30) * 30 + 5;
+
+        Gate_shptr gate(new Gate(x, x + 9, y, y + 9, Gate::ORIENTATION_NORMAL));
+        gate->set_object_id(lmodel->get_new_object_id());
+        gate->set_name("gate " + std::to_string(i));
+        gate->set_gate_template(tmpl);
+        lmodel->add_object(0, gate);
+        lmodel->update_ports(gate);
+
+        GatePort_shptr in, out;
+        for (auto iter = gate->ports_begin(); iter != gate->ports_end(); ++iter)
+            ((*iter)->get_template_port()->get_port_type() == GateTemplatePort::PORT_TYPE_IN ? in : out) = *iter;
+
+        if (previous != nullptr && i % 30 != 0)
+        {
+            Net_shptr net(new Net());
+            lmodel->add_net(net);
+
+            Wire_shptr wire(new Wire(previous->get_x(), previous->get_y(), in->get_x(), in->get_y(), 3));
+            Via_shptr via(new Via(previous->get_x(), previous->get_y(), 4, Via::DIRECTION_DOWN));
+            lmodel->add_object(1, wire);
+            lmodel->add_object(1, via);
+
+            previous->set_net(net);
+            wire->set_net(net);
+            via->set_net(net);
+            in->set_net(net);
+        }
+
+        previous = out;
+
+        if (i % 10 == 0)
+        {
+            lmodel->add_object(1, EMarker_shptr(new EMarker(x + 2, y + 2)));
+            lmodel->add_object(1, Annotation_shptr(new Annotation(x, x + 20, y, y + 20)));
+        }
+    }
+
+    DeepCopyable::oldnew_t oldnew;
+    LogicModel_shptr clone = std::dynamic_pointer_cast<LogicModel>(lmodel->cloneDeep(&oldnew));
+    REQUIRE(clone != nullptr);
+    REQUIRE(clone != lmodel);
+
+    // Same objects, nothing shared.
+    REQUIRE(std::distance(clone->objects_begin(), clone->objects_end()) ==
+            std::distance(lmodel->objects_begin(), lmodel->objects_end()));
+    REQUIRE(std::distance(clone->nets_begin(), clone->nets_end()) ==
+            std::distance(lmodel->nets_begin(), lmodel->nets_end()));
+    REQUIRE(clone->get_gates_count() == lmodel->get_gates_count());
+    REQUIRE(clone->get_vias_count() == lmodel->get_vias_count());
+    REQUIRE(clone->get_annotations_count() == lmodel->get_annotations_count());
+
+    for (auto iter = lmodel->objects_begin(); iter != lmodel->objects_end(); ++iter)
+    {
+        PlacedLogicModelObject_shptr o = iter->second;
+        PlacedLogicModelObject_shptr c = clone->get_object(iter->first);
+
+        REQUIRE(c != o);
+        REQUIRE(c->get_object_id() == o->get_object_id());
+        REQUIRE(c->get_object_type_name() == o->get_object_type_name());
+        REQUIRE(c->get_name() == o->get_name());
+        REQUIRE(c->get_bounding_box() == o->get_bounding_box());
+
+        // The clone lives on the layers of the cloned logic model.
+        REQUIRE(c->get_layer() != nullptr);
+        REQUIRE(c->get_layer() == clone->get_layer(o->get_layer()->get_layer_pos()));
+
+        if (ConnectedLogicModelObject_shptr co = std::dynamic_pointer_cast<ConnectedLogicModelObject>(o))
+        {
+            ConnectedLogicModelObject_shptr cc = std::dynamic_pointer_cast<ConnectedLogicModelObject>(c);
+            REQUIRE(cc != nullptr);
+
+            if (co->get_net() == nullptr)
+                REQUIRE(cc->get_net() == nullptr);
+            else
+            {
+                REQUIRE(cc->get_net() == clone->get_net(co->get_net()->get_object_id()));
+                REQUIRE(cc->get_net()->size() == co->get_net()->size());
+            }
+        }
+
+        if (Gate_shptr gate = std::dynamic_pointer_cast<Gate>(o))
+        {
+            Gate_shptr cloned_gate = std::dynamic_pointer_cast<Gate>(c);
+            REQUIRE(cloned_gate->get_gate_template() == clone->get_gate_library()->get_template(tmpl->get_object_id()));
+            REQUIRE(cloned_gate->get_ports_number() == gate->get_ports_number());
+
+            for (auto port = cloned_gate->ports_begin(); port != cloned_gate->ports_end(); ++port)
+            {
+                REQUIRE((*port)->get_gate() == cloned_gate);
+                REQUIRE(clone->get_object((*port)->get_object_id()) == *port);
+            }
+        }
+    }
+
+    // The quadtrees answer region queries the same way.
+    for (layer_position_t pos = 0; pos < 2; pos++)
+    {
+        Layer_shptr layer = lmodel->get_layer(pos), cloned_layer = clone->get_layer(pos);
+
+        for (auto const& bbox : {BoundingBox(0, 999, 0, 999), BoundingBox(100, 300, 50, 200), BoundingBox(0, 10, 0, 10)})
+            REQUIRE(get_region_ids(cloned_layer, bbox) == get_region_ids(layer, bbox));
+    }
+
+    REQUIRE(std::distance(clone->get_main_module()->gates_begin(), clone->get_main_module()->gates_end()) == 300);
+
+    // Changes on the clone don't affect the original.
+    clone->remove_object(clone->get_object(lmodel->gates_begin()->first));
+    REQUIRE(lmodel->get_gates_count() == 300);
+}
@@ -0,0 +1,180 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <Core/LogicModel/LogicModel.h>
+#include <Core/LogicModel/LookupSubcircuit.h>
+
+#include "TestObjectFactory.h"
+#include "catch.hpp"
+
+#include <map>
+
+using namespace degate;
+
+TEST_CASE("Test register chain search", "[LookupSubcircuit]")
+{
+    LogicModel_shptr lmodel(new LogicModel(100, 100, 1));
+    TestObjectFactory factory(lmodel);
+
+    GateTemplate_shptr dff = factory.create_template("flipflop-d", {{"D", GateTemplatePort::PORT_TYPE_IN},
+                                                                    {"CLK", GateTemplatePort::PORT_TYPE_IN},
+                                                                    {"Q", GateTemplatePort::PORT_TYPE_OUT}}, "flipflop-d");
+    GateTemplate_shptr xor2 = factory.create_template("xor", {{"A", GateTemplatePort::PORT_TYPE_IN},
+                                                              {"B", GateTemplatePort::PORT_TYPE_IN},
+                                                              {"Y", GateTemplatePort::PORT_TYPE_OUT}}, "xor");
+    GateTemplate_shptr inv = factory.create_template("inverter", {{"A", GateTemplatePort::PORT_TYPE_IN},
+                                                                  {"Y", GateTemplatePort::PORT_TYPE_OUT}}, "inverter");
+
+    // All flipflops share the clock: it must not connect the chains.
+    Net_shptr clock = factory.create_net();
+
+    // Shift register with 5 stages, the last stage drives an inverter.
+    std::vector<Gate_shptr> shift_register;
+    Net_shptr previous = factory.create_net();
+    for (unsigned i = 0; i < 5; i++)
+    {
+        Net_shptr q = factory.create_net();
+        shift_register.push_back(factory.create_gate(dff, {{"D", previous}, {"CLK", clock}, {"Q", q}}));
+        previous = q;
+    }
+    factory.create_gate(inv, {{"A", previous}, {"Y", factory.create_net()}});
+
+    // Fibonacci LFSR with 4 stages, stage 0 is fed by Q2 xor Q3.
+    std::vector<Gate_shptr> fibonacci;
+    std::vector<Net_shptr> fq;
+    Net_shptr feedback = factory.create_net();
+    for (unsigned i = 0; i < 4; i++)
+        fq.push_back(factory.create_net());
+    for (unsigned i = 0; i < 4; i++)
+        fibonacci.push_back(factory.create_gate(dff, {{"D", i == 0 ? feedback : fq[i - 1]}, {"CLK", clock}, {"Q", fq[i]}}));
+    Gate_shptr fibonacci_tap = factory.create_gate(xor2, {{"A", fq[2]}, {"B", fq[3]}, {"Y", feedback}});
+
+    // Galois LFSR with 4 stages, stage 2 is fed by Q1 xor Q3.
+    std::vector<Gate_shptr> galois;
+    std::vector<Net_shptr> gq;
+    Net_shptr tapped = factory.create_net();
+    for (unsigned i = 0; i < 4; i++)
+        gq.push_back(factory.create_net());
+    for (unsigned i = 0; i < 4; i++)
+    {
+        Net_shptr d = i == 0 ? gq[3] : (i == 2 ? tapped : gq[i - 1]);
+        galois.push_back(factory.create_gate(dff, {{"D", d}, {"CLK", clock}, {"Q", gq[i]}}));
+    }
+    Gate_shptr galois_tap = factory.create_gate(xor2, {{"A", gq[1]}, {"B", gq[3]}, {"Y", tapped}});
+
+    // Two flipflops only.
+    Net_shptr short_q = factory.create_net();
+    factory.create_gate(dff, {{"D", factory.create_net()}, {"CLK", clock}, {"Q", short_q}});
+    factory.create_gate(dff, {{"D", short_q}, {"CLK", clock}, {"Q", factory.create_net()}});
+
+    SECTION("Default pattern")
+    {
+        for (unsigned int threads : {1u, 4u})
+        {
+            LookupSubcircuit lookup(lmodel, threads);
+            LookupSubcircuit::chain_collection chains = lookup.search();
+
+            REQUIRE(chains.size() == 3);
+
+            // Ordered by the first gate.
+            REQUIRE(chains[0].elements == shift_register);
+            REQUIRE(chains[0].taps.empty());
+            REQUIRE(chains[0].closed == false);
+            REQUIRE(chains[0].objects.size() == 5);
+
+            REQUIRE(chains[1].elements == fibonacci);
+            REQUIRE(chains[1].taps == std::vector<Gate_shptr>({fibonacci_tap}));
+            REQUIRE(chains[1].closed == true);
+            REQUIRE(chains[1].objects.size() == 5);
+            REQUIRE(chains[1].objects.contains(fibonacci_tap));
+
+            REQUIRE(chains[2].elements == galois);
+            REQUIRE(chains[2].taps == std::vector<Gate_shptr>({galois_tap}));
+            REQUIRE(chains[2].closed == true);
+        }
+    }
+
+    SECTION("Without taps")
+    {
+        SubcircuitPattern pattern;
+        pattern.tap_logic_classes.clear();
+        pattern.min_length = 2;
+
+        LookupSubcircuit lookup(lmodel);
+        LookupSubcircuit::chain_collection chains = lookup.search(pattern);
+
+        // The LFSRs are open at their tap.
+        REQUIRE(chains.size() == 4);
+        REQUIRE(chains[0].elements == shift_register);
+        REQUIRE(chains[1].elements == fibonacci);
+        REQUIRE(chains[1].closed == false);
+        REQUIRE(chains[2].elements == std::vector<Gate_shptr>({galois[2], galois[3], galois[0], galois[1]}));
+        REQUIRE(chains[2].closed == false);
+        REQUIRE(chains[3].elements.size() == 2);
+    }
+
+    SECTION("Other elements")
+    {
+        SubcircuitPattern pattern;
+        pattern.element_logic_class = "inverter";
+        pattern.element_input_port = "";
+        pattern.element_output_port = "";
+        pattern.min_length = 1;
+
+        LookupSubcircuit lookup(lmodel);
+        REQUIRE(lookup.search(pattern).size() == 1);
+    }
+}
+
+TEST_CASE("Test parallel register chain search", "[LookupSubcircuit]")
+{
+    LogicModel_shptr lmodel(new LogicModel(100, 100, 1));
+    TestObjectFactory factory(lmodel);
+
+    GateTemplate_shptr dff = factory.create_template("flipflop", {{"D", GateTemplatePort::PORT_TYPE_IN},
+                                                                  {"Q", GateTemplatePort::PORT_TYPE_OUT}}, "flipflop");
+
+    // Enough chains to split the work between threads.
+    const unsigned int chains_count = 500;
+
+    for (unsigned int c = 0; c < chains_count; c++)
+    {
+        Net_shptr previous = factory.create_net();
+        for (unsigned int i = 0; i < 3 + c % 4; i++)
+        {
+            Net_shptr q = factory.create_net();
+            factory.create_gate(dff, {{"D", previous}, {"Q", q}});
+            previous = q;
+        }
+    }
+
+    LookupSubcircuit::chain_collection serial = LookupSubcircuit(lmodel, 1).search();
+    LookupSubcircuit::chain_collection parallel = LookupSubcircuit(lmodel, 4).search();
+
+    REQUIRE(serial.size() == chains_count);
+    REQUIRE(parallel.size() == chains_count);
+
+    for (unsigned int c = 0; c < chains_count; c++)
+    {
+        REQUIRE(serial[c].elements.size() == 3 + c % 4);
+        REQUIRE(parallel[c].elements == serial[c].elements);
+    }
+}
@@ -0,0 +1,151 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <Core/LogicModel/LogicModel.h>
+#include <Core/LogicModel/Module.h>
+
+#include "TestObjectFactory.h"
+#include "catch.hpp"
+
+using namespace degate;
+
+static TestObjectFactory factory;
+
+static std::vector<Gate_shptr> external_gates;
+
+static void connect_external(Net_shptr net)
+{
+    // a gate port outside of the module hierarchy
+    Gate_shptr gate = factory.create_gate();
+    factory.create_port(gate, GateTemplatePort::PORT_TYPE_OUT, net);
+    external_gates.push_back(gate);
+}
+
+static bool has_module_port(Module_shptr module, GatePort_shptr gate_port)
+{
+    for (auto iter = module->ports_begin(); iter != module->ports_end(); ++iter)
+        if (iter->second == gate_port) return true;
+    return false;
+}
+
+static unsigned count_module_ports(Module_shptr module)
+{
+    return static_cast<unsigned>(std::distance(module->ports_begin(), module->ports_end()));
+}
+
+TEST_CASE("Test module port detection", "[Module]")
+{
+    Net_shptr n1(new Net()), n2(new Net()), n3(new Net());
+
+    Gate_shptr g1 = factory.create_gate(), g2 = factory.create_gate(), g3 = factory.create_gate();
+
+    GatePort_shptr p1a = factory.create_port(g1, GateTemplatePort::PORT_TYPE_OUT, n1);
+    GatePort_shptr p1b = factory.create_port(g1, GateTemplatePort::PORT_TYPE_OUT, n2);
+    GatePort_shptr p2a = factory.create_port(g2, GateTemplatePort::PORT_TYPE_IN, n1);
+    GatePort_shptr p2b = factory.create_port(g2, GateTemplatePort::PORT_TYPE_IN, n3);
+    GatePort_shptr p3a = factory.create_port(g3, GateTemplatePort::PORT_TYPE_IN, n2);
+    GatePort_shptr p3b = factory.create_port(g3, GateTemplatePort::PORT_TYPE_OUT, n3);
+
+    Module_shptr root(new Module("main", "", true));
+    Module_shptr sub(new Module("sub"));
+
+    // the sub-module is filled before it is attached, as the importer does
+    sub->add_gate(g1, false);
+    sub->add_gate(g2, false);
+    root->add_module(sub);
+    root->add_gate(g3);
+
+    root->determine_module_ports_recursive();
+
+    // n1 is internal, n2 is driven from inside and n3 from outside
+    REQUIRE(count_module_ports(sub) == 2);
+    REQUIRE(has_module_port(sub, p1b));
+    REQUIRE(has_module_port(sub, p2b));
+    REQUIRE(!has_module_port(sub, p1a));
+
+    SECTION("Remove a gate")
+    {
+        REQUIRE(root->remove_gate(g1));
+
+        // n1 now is driven by a gate outside the module
+        REQUIRE(count_module_ports(sub) == 2);
+        REQUIRE(has_module_port(sub, p2a));
+        REQUIRE(has_module_port(sub, p2b));
+    }
+
+    SECTION("Add a port to a gate")
+    {
+        Net_shptr n4(new Net());
+        connect_external(n4);
+        GatePort_shptr p2c = factory.create_port(g2, GateTemplatePort::PORT_TYPE_IN, n4);
+
+        REQUIRE(root->update_gate_ports(g2));
+        sub->determine_module_ports();
+
+        REQUIRE(count_module_ports(sub) == 3);
+        REQUIRE(has_module_port(sub, p2c));
+    }
+
+    SECTION("Remove a sub-module")
+    {
+        REQUIRE(root->remove_module(sub));
+        REQUIRE(root->modules_begin() == root->modules_end());
+        REQUIRE(std::distance(root->gates_begin(), root->gates_end()) == 3);
+    }
+}
+
+TEST_CASE("Test module port detection in nested modules", "[Module]")
+{
+    Module_shptr root(new Module("main", "", true));
+    Module_shptr parent = root;
+
+    std::vector<Module_shptr> chain;
+    std::vector<Net_shptr> nets;
+
+    // a chain of nested modules, each containing an inverter-like gate driving the next one
+    Net_shptr input(new Net());
+    connect_external(input);
+    Net_shptr previous = input;
+
+    for (unsigned i = 0; i < 8; i++)
+    {
+        Module_shptr module(new Module("m" + std::to_string(i)));
+        parent->add_module(module);
+
+        Net_shptr output(new Net());
+        Gate_shptr gate = factory.create_gate();
+        factory.create_port(gate, GateTemplatePort::PORT_TYPE_IN, previous);
+        factory.create_port(gate, GateTemplatePort::PORT_TYPE_OUT, output);
+        module->add_gate(gate);
+
+        chain.push_back(module);
+        previous = output;
+        parent = module;
+    }
+
+    connect_external(previous);
+
+    root->determine_module_ports_recursive();
+
+    // every module of the chain has exactly one input and one output
+    for (auto& module : chain)
+        REQUIRE(count_module_ports(module) == 2);
+}
@@ -0,0 +1,166 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <Core/Image/Manipulation/MosaicStitching.h>
+#include <Core/Utils/FileSystem.h>
+
+#include <cmath>
+#include <fstream>
+
+#include "catch.hpp"
+
+using namespace degate;
+
+/**
+ * Random texture, smoothed on two scales.
+ */
+static unsigned int get_mosaic_texture_value(int x, int y)
+{
+    auto hash = [](int x, int y)
+    {
+        unsigned int h = static_cast<unsigned int>(x) * 374761393u + static_cast<unsigned int>(y) * 668265263u;
+        h = (h ^ (h >> 13)) * 1274126177u;
+        return (h ^ (h >> 16)) & 0xff;
+    };
+
+    unsigned int value = 0;
+
+    for (int cell : {19, 5})
+    {
+        const int ix = (x + 1000 * cell) / cell, iy = (y + 1000 * cell) / cell;
+        const int fx = (x + 1000 * cell) % cell, fy = (y + 1000 * cell) % cell;
+
+        value += ((cell - fy) * ((cell - fx) * hash(ix, iy) + fx * hash(ix + 1, iy)) +
+                  fy * ((cell - fx) * hash(ix, iy + 1) + fx * hash(ix + 1, iy + 1))) / (2 * cell * cell);
+    }
+
+    return value;
+}
+
+TEST_CASE("Test frame grid file", "[MosaicStitching]")
+{
+    std::string directory = create_temp_directory();
+    std::string grid_file = join_pathes(directory, "grid.txt");
+
+    {
+        std::ofstream file(grid_file);
+        file << "# file x y" << std::endl
+             << "frame_0_0.tif 0 0" << std::endl
+             << std::endl
+             << "  frame_1_0.tif\t900 -5" << std::endl
+             << "/tmp/frame_0_1.tif 3 700" << std::endl;
+    }
+
+    std::vector<MosaicFrame> frames = MosaicStitcher::read_frame_grid(grid_file);
+
+    REQUIRE(frames.size() == 3);
+    REQUIRE(frames[0].image_file == join_pathes(directory, "frame_0_0.tif"));
+    REQUIRE(frames[0].x == 0);
+    REQUIRE(frames[0].y == 0);
+    REQUIRE(frames[1].image_file == join_pathes(directory, "frame_1_0.tif"));
+    REQUIRE(frames[1].x == 900);
+    REQUIRE(frames[1].y == -5);
+    REQUIRE(frames[2].image_file == "/tmp/frame_0_1.tif");
+    REQUIRE(frames[2].y == 700);
+
+    {
+        std::ofstream file(grid_file, std::ios::app);
+        file << "frame_1_1.tif 900" << std::endl;
+    }
+
+    REQUIRE_THROWS_AS(MosaicStitcher::read_frame_grid(grid_file), InvalidFileFormatException);
+    REQUIRE_THROWS_AS(MosaicStitcher::read_frame_grid(join_pathes(directory, "missing.txt")), InvalidPathException);
+
+    remove_directory(directory);
+}
+
+TEST_CASE("Test mosaic stitching", "[MosaicStitching]")
+{
+    // 3x3 frames of 200x150 pixels with an overlap of 64 pixels
+    const int frame_width = 200, frame_height = 150, step_x = 136, step_y = 86;
+
+    // offsets of the frames from their nominal positions (e.g. stage errors)
+    const int errors[][2] = {{0, 0}, {3, -2}, {-4, 1}, {2, 4}, {-1, -3}, {5, 2}, {-3, 0}, {1, -4}, {4, 3}};
+
+    std::vector<MosaicFrame> frames;
+    for (int row = 0; row < 3; row++)
+        for (int column = 0; column < 3; column++)
+        {
+            MosaicFrame frame;
+            frame.image_file = std::to_string(row * 3 + column);
+            frame.x = column * step_x;
+            frame.y = row * step_y;
+            frames.push_back(frame);
+        }
+
+    unsigned int loaded_frames = 0;
+
+    auto frame_loader = [&](MosaicFrame const& frame)
+    {
+        const int index = std::stoi(frame.image_file);
+        TempImage_RGBA_shptr image = std::make_shared<TempImage_RGBA>(frame_width, frame_height);
+
+        for (int y = 0; y < frame_height; y++)
+            for (int x = 0; x < frame_width; x++)
+            {
+                const unsigned int g = get_mosaic_texture_value(frame.x + errors[index][0] + x,
+                                                                frame.y + errors[index][1] + y);
+                image->set_pixel(x, y, MERGE_CHANNELS(g, g, g, 0xff));
+            }
+
+        loaded_frames++;
+        return image;
+    };
+
+    MosaicStitcher stitcher(frames, frame_loader);
+
+    stitcher.refine_positions();
+    REQUIRE(loaded_frames == frames.size());
+
+    // The frames are placed relative to each other, the mosaic may be shifted as a whole.
+    for (unsigned int i = 1; i < frames.size(); i++)
+    {
+        REQUIRE(stitcher.get_position_x(i) - stitcher.get_position_x(0) ==
+                Approx(frames[i].x + errors[i][0]).margin(0.5));
+        REQUIRE(stitcher.get_position_y(i) - stitcher.get_position_y(0) ==
+                Approx(frames[i].y + errors[i][1]).margin(0.5));
+    }
+
+    const int shift_x = lrint(stitcher.get_position_x(0)), shift_y = lrint(stitcher.get_position_y(0));
+
+    std::string directory = create_temp_directory();
+    BackgroundImage_shptr image = std::make_shared<BackgroundImage>(500, 400, directory, true, 6);
+
+    stitcher.stitch(image);
+    REQUIRE(loaded_frames == 2 * frames.size());
+
+    for (int y = 10; y < 2 * step_y + frame_height - 10; y += 7)
+        for (int x = 10; x < 2 * step_x + frame_width - 10; x += 11)
+        {
+            const int expected = get_mosaic_texture_value(x - shift_x, y - shift_y);
+            REQUIRE(std::abs(static_cast<int>(image->get_pixel_as<gs_byte_pixel_t>(x, y)) - expected) <= 2);
+        }
+
+    // outside of the frames
+    REQUIRE(image->get_pixel(499, 399) == 0);
+
+    remove_directory(directory);
+}
@@ -0,0 +1,97 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <Core/Utils/ParallelFor.h>
+
+#include "catch.hpp"
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+using namespace degate;
+
+TEST_CASE("Test parallel for", "[ParallelFor]")
+{
+    for (unsigned int threads : {1u, 3u, 8u})
+    {
+        for (size_t items_per_task : {1, 7, 1000})
+        {
+            std::vector<std::atomic<int>> calls(1001);
+            for (auto& c : calls)
+                c = 0;
+
+            parallel_for(calls.size(), [&](size_t i) { calls[i]++; }, threads, items_per_task);
+
+            for (auto& c : calls)
+                REQUIRE(c == 1);
+        }
+    }
+
+    bool called = false;
+    parallel_for(0, [&](size_t) { called = true; });
+    REQUIRE_FALSE(called);
+}
+
+TEST_CASE("Test parallel for exceptions", "[ParallelFor]")
+{
+    std::atomic<size_t> calls(0);
+
+    REQUIRE_THROWS_AS(parallel_for(1000, [&](size_t i)
+    {
+        calls++;
+        if (i == 10)
+            throw std::runtime_error("failed");
+    }, 4), std::runtime_error);
+
+    // No new item is started after the failure.
+    REQUIRE(calls < 1000);
+}
+
+TEST_CASE("Test parallel for ranges", "[ParallelFor]")
+{
+    for (size_t n : {0, 1, 5, 100, 1001})
+    {
+        std::vector<std::atomic<int>> calls(n);
+        for (auto& c : calls)
+            c = 0;
+
+        std::atomic<unsigned int> ranges(0);
+        std::atomic<bool> bad_range(false);
+
+        parallel_for_ranges(n, [&](size_t from, size_t to)
+        {
+            if (from > to || (to - from < 50 && (from != 0 || to != n)))
+                bad_range = true;
+
+            ranges++;
+            for (size_t i = from; i < to; i++)
+                calls[i]++;
+        }, 50, 4);
+
+        REQUIRE_FALSE(bad_range);
+        REQUIRE(ranges >= 1);
+        REQUIRE(ranges <= 4);
+
+        for (auto& c : calls)
+            REQUIRE(c == 1);
+    }
+}
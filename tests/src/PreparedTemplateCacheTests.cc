@@ -0,0 +1,129 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <Core/Matching/PreparedTemplateCache.h>
+
+#include "catch.hpp"
+
+#include <cstdint>
+
+using namespace degate;
+
+static GateTemplateImage_shptr create_template_image(unsigned int width, unsigned int height, unsigned int seed)
+{
+    GateTemplateImage_shptr img = std::make_shared<GateTemplateImage>(width, height);
+
+    for (unsigned int y = 0; y < height; y++)
+        for (unsigned int x = 0; x < width; x++)
+        {
+            uint8_t v = (x * 13 + y * 7 + seed) & 0xff;
+            img->set_pixel(x, y, MERGE_CHANNELS(v, v, v, 0xff));
+        }
+
+    return img;
+}
+
+TEST_CASE("Test prepared template images", "[PreparedTemplateCache]")
+{
+    PreparedTemplateCache& cache = PreparedTemplateCache::get_instance();
+    cache.clear();
+
+    GateTemplate_shptr tmpl = std::make_shared<GateTemplate>(30, 20);
+    tmpl->set_object_id(42);
+
+    REQUIRE(tmpl->get_image_revision(Layer::LOGIC) == 0);
+    tmpl->set_image(Layer::LOGIC, create_template_image(30, 20, 0));
+    REQUIRE(tmpl->get_image_revision(Layer::LOGIC) > 0);
+
+    PreparedTemplate normal = cache.get(tmpl, Layer::LOGIC, Gate::ORIENTATION_NORMAL, 2);
+    PreparedTemplate flipped = cache.get(tmpl, Layer::LOGIC, Gate::ORIENTATION_FLIPPED_LEFT_RIGHT, 2);
+
+    REQUIRE(normal.normal->get_width() == 30);
+    REQUIRE(normal.normal->get_height() == 20);
+    REQUIRE(normal.scaled->get_width() == 15);
+    REQUIRE(normal.scaled->get_height() == 10);
+
+    // Aligned buffers
+    REQUIRE(reinterpret_cast<uintptr_t>(normal.normal->get_data()) % PREPARED_TEMPLATE_ALIGNMENT == 0);
+    REQUIRE(reinterpret_cast<uintptr_t>(normal.scaled->get_data()) % PREPARED_TEMPLATE_ALIGNMENT == 0);
+
+    // Zero mean
+    double sum = 0, squared_sum = 0;
+    for (unsigned int y = 0; y < 20; y++)
+        for (unsigned int x = 0; x < 30; x++)
+        {
+            sum += normal.normal->get_pixel(x, y);
+            squared_sum += normal.normal->get_pixel(x, y) * normal.normal->get_pixel(x, y);
+        }
+
+    REQUIRE(sum == Approx(0).margin(1e-2));
+    REQUIRE(normal.normal->get_sum_over_zero_mean() == Approx(squared_sum));
+    REQUIRE(normal.normal->get_sum_over_zero_mean() > 0);
+
+    // Orientation
+    for (unsigned int y = 0; y < 20; y++)
+        for (unsigned int x = 0; x < 30; x++)
+            REQUIRE(flipped.normal->get_pixel(29 - x, y) == normal.normal->get_pixel(x, y));
+
+    // Cached
+    REQUIRE(cache.size() == 2);
+    REQUIRE(cache.get(tmpl, Layer::LOGIC, Gate::ORIENTATION_NORMAL, 2).normal == normal.normal);
+    REQUIRE(cache.size() == 2);
+
+    // Other scaling
+    REQUIRE(cache.get(tmpl, Layer::LOGIC, Gate::ORIENTATION_NORMAL, 4).scaled->get_width() == 7);
+    REQUIRE(cache.size() == 3);
+}
+
+TEST_CASE("Test prepared template invalidation", "[PreparedTemplateCache]")
+{
+    PreparedTemplateCache& cache = PreparedTemplateCache::get_instance();
+    cache.clear();
+
+    GateTemplate_shptr tmpl = std::make_shared<GateTemplate>(16, 16);
+    tmpl->set_object_id(7);
+    tmpl->set_image(Layer::LOGIC, create_template_image(16, 16, 0));
+
+    unsigned long revision = tmpl->get_image_revision(Layer::LOGIC);
+
+    PreparedTemplate before = cache.get(tmpl, Layer::LOGIC, Gate::ORIENTATION_NORMAL, 1);
+    REQUIRE(cache.size() == 1);
+
+    // New image
+    tmpl->set_image(Layer::LOGIC, create_template_image(16, 16, 100));
+    REQUIRE(tmpl->get_image_revision(Layer::LOGIC) != revision);
+
+    // The new revision replaces the entry of the old one.
+    PreparedTemplate after = cache.get(tmpl, Layer::LOGIC, Gate::ORIENTATION_NORMAL, 1);
+    REQUIRE(after.normal != before.normal);
+    REQUIRE(cache.size() == 1);
+
+    bool same = true;
+    for (unsigned int y = 0; y < 16; y++)
+        for (unsigned int x = 0; x < 16; x++)
+            same = same && after.normal->get_pixel(x, y) == before.normal->get_pixel(x, y);
+
+    REQUIRE_FALSE(same);
+
+    // Removed template
+    cache.invalidate(7);
+    REQUIRE(cache.size() == 0);
+}
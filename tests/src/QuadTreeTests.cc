@@ -27,6 +27,8 @@
 #include <Core/Primitive/QuadTree.h>
 #include <Core/LogicModel/Via/Via.h>
 
+#include <set>
+
 #include "catch.hpp"
 
 using namespace degate;
@@ -177,4 +179,50 @@ TEST_CASE("Test overlapping objects", "[QuadTree]")
     delete g;
     delete v;
     delete qtree;
-}
\ No newline at end of file
+}
+
+TEST_CASE("Test quad tree bulk insert", "[QuadTree]")
+{
+    const BoundingBox bbox(0, 1000, 0, 1000);
+    QuadTree<PlacedLogicModelObject_shptr> incremental(bbox, 4);
+    QuadTree<PlacedLogicModelObject_shptr> bulk(bbox, 4);
+
+    // Small gates spread over the tree and some large ones that stay in inner nodes.
+    std::vector<PlacedLogicModelObject_shptr> gates;
+    for (unsigned int i = 0; i < 500; i++)
+    {
+        const int x = (i * 37) % 990, y = (i * 91) % 990;
+        gates.push_back(Gate_shptr(new Gate(x, x + 9, y, y + 9)));
+    }
+    for (unsigned int i = 0; i < 10; i++)
+        gates.push_back(Gate_shptr(new Gate(400, 600, i * 90, i * 90 + 100)));
+
+    for (auto& gate : gates)
+        REQUIRE(RET_IS_OK(incremental.insert(gate)));
+
+    // Half first (into an empty tree), the rest into the already split tree.
+    REQUIRE(RET_IS_OK(bulk.bulk_insert(std::vector<PlacedLogicModelObject_shptr>(gates.begin(), gates.begin() + 250))));
+    REQUIRE(RET_IS_OK(bulk.bulk_insert(std::vector<PlacedLogicModelObject_shptr>(gates.begin() + 250, gates.end()))));
+    REQUIRE(RET_IS_OK(bulk.bulk_insert(std::vector<PlacedLogicModelObject_shptr>())));
+
+    REQUIRE(bulk.total_size() == gates.size());
+    REQUIRE(bulk.depth() == incremental.depth());
+
+    for (auto const& region : {BoundingBox(0, 1000, 0, 1000), BoundingBox(480, 620, 480, 620),
+                               BoundingBox(0, 100, 900, 1000), BoundingBox(500, 500, 500, 500)})
+    {
+        std::set<PlacedLogicModelObject_shptr> expected, found;
+
+        for (auto it = incremental.region_iter_begin(region); it != incremental.region_iter_end(); ++it)
+            expected.insert(*it);
+
+        for (auto it = bulk.region_iter_begin(region); it != bulk.region_iter_end(); ++it)
+            found.insert(*it);
+
+        REQUIRE(found == expected);
+    }
+
+    // The bulk built tree stays usable for single updates.
+    REQUIRE(RET_IS_OK(bulk.remove(gates.front())));
+    REQUIRE(bulk.total_size() == gates.size() - 1);
+}
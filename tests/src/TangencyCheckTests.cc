@@ -0,0 +1,202 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <Core/LogicModel/LogicModel.h>
+#include <Core/LogicModel/LogicModelHelper.h>
+#include <Core/LogicModel/Via/Via.h>
+#include <Core/LogicModel/Wire/Wire.h>
+#include <Core/LogicModel/EMarker/EMarker.h>
+#include <Core/RuleCheck/ERCTouchingObjects.h>
+#include <Core/Utils/TangencyCheck.h>
+
+#include <random>
+
+#include "TestObjectFactory.h"
+#include "catch.hpp"
+
+using namespace degate;
+
+static std::vector<PlacedLogicModelObject_shptr> random_objects(std::mt19937& rng, unsigned int count)
+{
+    std::uniform_int_distribution<int> pos(0, 200), len(-20, 20), dia(1, 8), kind(0, 5);
+    std::vector<PlacedLogicModelObject_shptr> objects;
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        int x = pos(rng), y = pos(rng);
+
+        switch (kind(rng))
+        {
+            case 0:
+                objects.push_back(std::make_shared<Via>(x, y, dia(rng)));
+                break;
+            case 1:
+                objects.push_back(std::make_shared<EMarker>(x, y, dia(rng)));
+                break;
+            case 2:
+                objects.push_back(std::make_shared<Wire>(x, y, x + len(rng), y + len(rng), dia(rng)));
+                break;
+            case 3:
+                objects.push_back(std::make_shared<Wire>(x, y, x, y + len(rng), dia(rng)));
+                break;
+            case 4:
+                objects.push_back(std::make_shared<Wire>(x, y, x + len(rng), y, dia(rng)));
+                break;
+            default:
+                objects.push_back(std::make_shared<Gate>(x, x + dia(rng) * 3, y, y + dia(rng) * 3));
+                break;
+        }
+    }
+
+    return objects;
+}
+
+TEST_CASE("Test tangency batch", "[TangencyCheck]")
+{
+    std::mt19937 rng(42);
+
+    std::vector<PlacedLogicModelObject_shptr> objects = random_objects(rng, 300);
+    std::vector<PlacedLogicModelObject_shptr> others = random_objects(rng, 100);
+
+    TangencyBatch batch, other_batch;
+    for (auto& o : objects)
+        batch.add_object(o);
+    for (auto& o : others)
+        other_batch.add_object(o);
+
+    REQUIRE(batch.size() == objects.size());
+    REQUIRE(batch.get_object(7) == objects[7]);
+
+    // Pairs within a batch, compared with the pairwise checks.
+    TangencyBatch::index_pair_collection expected;
+    for (unsigned int i = 0; i < objects.size(); i++)
+    {
+        for (unsigned int j = i + 1; j < objects.size(); j++)
+        {
+            if (check_object_tangency(objects[i], objects[j]))
+                expected.push_back(std::make_pair(i, j));
+        }
+    }
+
+    REQUIRE(!expected.empty());
+    REQUIRE(batch.find_tangent_pairs() == expected);
+
+    // Pairs between two batches.
+    expected.clear();
+    for (unsigned int i = 0; i < objects.size(); i++)
+    {
+        for (unsigned int j = 0; j < others.size(); j++)
+        {
+            if (check_object_tangency(objects[i], others[j]))
+                expected.push_back(std::make_pair(i, j));
+
+            REQUIRE(batch.check_tangency(i, other_batch, j) == check_object_tangency(objects[i], others[j]));
+        }
+    }
+
+    REQUIRE(!expected.empty());
+    REQUIRE(batch.find_tangent_pairs(other_batch) == expected);
+
+    REQUIRE_THROWS_AS(batch.add_object(PlacedLogicModelObject_shptr()), InvalidPointerException);
+    REQUIRE(TangencyBatch().find_tangent_pairs().empty());
+}
+
+TEST_CASE("Test autoconnect with tangency batches", "[TangencyCheck]")
+{
+    LogicModel_shptr lmodel(new LogicModel(1000, 1000, 2));
+    Layer_shptr layer = lmodel->get_layer(0);
+
+    // Two chains of touching vias and wires and a single via.
+    Via_shptr v1(new Via(10, 10, 4, Via::DIRECTION_UP));
+    Wire_shptr w1(new Wire(10, 10, 100, 10, 2));
+    Via_shptr v2(new Via(100, 10, 4));
+    Wire_shptr w2(new Wire(100, 10, 100, 100, 2));
+
+    Via_shptr v3(new Via(500, 500, 4));
+    Wire_shptr w3(new Wire(500, 500, 600, 500, 2));
+
+    Via_shptr v4(new Via(800, 800, 4));
+
+    for (auto o : std::vector<PlacedLogicModelObject_shptr>{v1, w1, v2, w2, v3, w3, v4})
+        lmodel->add_object(layer, o);
+
+    // v1-w1, w1-v2, w1-w2, v2-w2 and v3-w3 touch each other.
+    ERCTouchingObjects erc;
+    erc.run(lmodel);
+    REQUIRE(erc.get_rc_violations().size() == 5);
+
+    autoconnect_objects(lmodel, layer, BoundingBox(0, 1000, 0, 1000));
+
+    REQUIRE(v1->get_net() != nullptr);
+    REQUIRE(v1->get_net() == w1->get_net());
+    REQUIRE(v1->get_net() == v2->get_net());
+    REQUIRE(v1->get_net() == w2->get_net());
+    REQUIRE(v3->get_net() != nullptr);
+    REQUIRE(v3->get_net() == w3->get_net());
+    REQUIRE(v3->get_net() != v1->get_net());
+    REQUIRE(v4->get_net() != nullptr);
+    REQUIRE(v4->get_net() != v1->get_net());
+    REQUIRE(v4->get_net() != v3->get_net());
+
+    erc.run(lmodel);
+    REQUIRE(erc.get_rc_violations().size() == 0);
+
+    // A via on the layer above, that matches v1.
+    Via_shptr v5(new Via(10, 10, 4, Via::DIRECTION_DOWN));
+    Via_shptr v6(new Via(500, 500, 4, Via::DIRECTION_DOWN));
+    lmodel->add_object(1, v5);
+    lmodel->add_object(1, v6);
+
+    autoconnect_interlayer_objects(lmodel, layer, BoundingBox(0, 1000, 0, 1000));
+
+    REQUIRE(v5->get_net() == v1->get_net());
+    REQUIRE(v6->get_net() == nullptr);
+}
+
+TEST_CASE("Test touching objects rule check", "[TangencyCheck]")
+{
+    LogicModel_shptr lmodel(new LogicModel(1000, 1000, 1));
+    TestObjectFactory factory(lmodel);
+
+    // The ports of a gate touch each other, but belong to different nets.
+    Net_shptr in = factory.create_net(), out = factory.create_net();
+    factory.create_gate({GateTemplatePort::PORT_TYPE_IN, GateTemplatePort::PORT_TYPE_OUT}, {in, out});
+
+    // A wire ends on a via of its net.
+    Via_shptr via(new Via(100, 100, 4));
+    Wire_shptr wire(new Wire(100, 100, 200, 100, 2));
+    lmodel->add_object(0, via);
+    lmodel->add_object(0, wire);
+
+    Net_shptr net = factory.create_net();
+    via->set_net(net);
+    wire->set_net(net);
+
+    ERCTouchingObjects erc;
+    erc.run(lmodel);
+    REQUIRE(erc.get_rc_violations().size() == 0);
+
+    // An unconnected via overlaps the via, but not the wire.
+    Via_shptr other(new Via(97, 100, 4));
+    lmodel->add_object(0, other);
+    erc.run(lmodel);
+    REQUIRE(erc.get_rc_violations().size() == 1);
+}
@@ -0,0 +1,452 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <Core/Matching/TemplateMatching.h>
+#include <Core/Matching/PreparedTemplateCache.h>
+#include <Core/Project/Project.h>
+#include <Core/Utils/FileSystem.h>
+
+#include "catch.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+#include <set>
+#include <tuple>
+#include <vector>
+
+using namespace degate;
+
+namespace
+{
+    /**
+     * Expose the search internals of the line by line matching.
+     */
+    class TestTemplateMatching : public TemplateMatchingNormal
+    {
+    public:
+
+        using TemplateMatching::batch_entry;
+
+        std::list<match_found> get_matches()
+        {
+            return find_matches();
+        }
+
+        double single_xcorr(IntegralImage const& master, PreparedTemplateImage const& tmpl_img,
+                            unsigned int x, unsigned int y) const
+        {
+            return calc_single_xcorr(master, 0, 0, tmpl_img, x, y);
+        }
+
+        void batched_xcorr(IntegralImage const& master, std::vector<batch_entry>& batch,
+                           unsigned int x, unsigned int y) const
+        {
+            calc_batched_xcorr(master, 0, 0, batch, x, y);
+        }
+    };
+
+    /**
+     * Expose the search of the grid based matching.
+     */
+    template<typename Base>
+    class TestTemplateMatchingAlongGrid : public Base
+    {
+    public:
+
+        std::list<TemplateMatching::match_found> get_matches()
+        {
+            return this->find_matches();
+        }
+    };
+
+    typedef std::tuple<unsigned int, unsigned int, object_id_t, int> gate_placement;
+
+    /**
+     * A template image made of 4x4 pixel blocks, so the correlation peak is a few pixels wide.
+     */
+    GateTemplateImage_shptr create_block_image(unsigned int width, unsigned int height, unsigned int seed)
+    {
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<int> value(0, 255);
+
+        std::vector<uint8_t> blocks(((width + 3) / 4) * ((height + 3) / 4));
+        for (auto& b : blocks)
+            b = value(rng);
+
+        GateTemplateImage_shptr img = std::make_shared<GateTemplateImage>(width, height);
+        for (unsigned int y = 0; y < height; y++)
+            for (unsigned int x = 0; x < width; x++)
+            {
+                uint8_t v = blocks[(y / 4) * ((width + 3) / 4) + x / 4];
+                img->set_pixel(x, y, MERGE_CHANNELS(v, v, v, 0xff));
+            }
+
+        return img;
+    }
+
+    /**
+     * A project with a noisy background. The templates are copied into the background
+     * at the given placements.
+     */
+    struct MatchingFixture
+    {
+        std::string project_directory, image_directory;
+        Project_shptr project;
+        Layer_shptr layer;
+        std::vector<GateTemplate_shptr> templates;
+
+        MatchingFixture(std::vector<gate_placement> const& placements)
+        {
+            // Wide enough for a scaled background image (@see ScalingManager).
+            const unsigned int width = 1100, height = 300;
+
+            project_directory = create_temp_directory();
+            image_directory = create_temp_directory();
+
+            project = std::make_shared<Project>(width, height, project_directory, 1);
+            layer = project->get_logic_model()->get_layer(0);
+            layer->set_layer_type(Layer::LOGIC);
+
+            const unsigned int sizes[][2] = {{40, 30}, {40, 30}, {24, 36}};
+            for (unsigned int i = 0; i < 3; i++)
+            {
+                GateTemplate_shptr tmpl = std::make_shared<GateTemplate>(sizes[i][0], sizes[i][1]);
+                tmpl->set_object_id(100 + i);
+                tmpl->set_image(Layer::LOGIC, create_block_image(sizes[i][0], sizes[i][1], i + 1));
+                templates.push_back(tmpl);
+            }
+
+            std::mt19937 rng(42);
+            std::uniform_int_distribution<int> noise(100, 120);
+
+            BackgroundImage_shptr img = std::make_shared<BackgroundImage>(width, height, image_directory, true);
+            for (unsigned int y = 0; y < height; y++)
+                for (unsigned int x = 0; x < width; x++)
+                {
+                    uint8_t v = noise(rng);
+                    img->set_pixel(x, y, MERGE_CHANNELS(v, v, v, 0xff));
+                }
+
+            for (auto const& p : placements)
+            {
+                GateTemplate_shptr tmpl = templates[std::get<2>(p) - 100];
+                GateTemplateImage_shptr tmpl_img = tmpl->get_image(Layer::LOGIC);
+                const bool flipped = std::get<3>(p) == Gate::ORIENTATION_FLIPPED_LEFT_RIGHT;
+
+                for (unsigned int y = 0; y < tmpl->get_height(); y++)
+                    for (unsigned int x = 0; x < tmpl->get_width(); x++)
+                        img->set_pixel(std::get<0>(p) + x, std::get<1>(p) + y,
+                                       tmpl_img->get_pixel(flipped ? tmpl->get_width() - 1 - x : x, y));
+            }
+
+            layer->set_image(img);
+        }
+
+        ~MatchingFixture()
+        {
+            layer->unset_image();
+            project.reset();
+            layer.reset();
+
+            remove_directory(image_directory);
+            remove_directory(project_directory);
+        }
+
+        void init(TemplateMatching& matching, unsigned int scaling_factor)
+        {
+            matching.set_templates(std::list<GateTemplate_shptr>(templates.begin(), templates.end()));
+            matching.set_orientations({Gate::ORIENTATION_NORMAL, Gate::ORIENTATION_FLIPPED_LEFT_RIGHT});
+            matching.set_layers(layer, layer);
+            matching.set_scaling_factor(scaling_factor);
+            matching.init(BoundingBox(0, project->get_width() - 1, 0, project->get_height() - 1), project);
+        }
+    };
+
+    /**
+     * Get the gates for a match list. As in TemplateMatching::run(), the best matches are
+     * kept and matches that overlap a kept match are dropped. Hill climbing might end next
+     * to a gate, depending on where it started.
+     */
+    std::set<gate_placement> get_placements(std::list<TemplateMatching::match_found> matches)
+    {
+        matches.sort([](TemplateMatching::match_found const& a, TemplateMatching::match_found const& b)
+        {
+            return a.correlation > b.correlation;
+        });
+
+        std::vector<TemplateMatching::match_found> kept;
+        for (auto const& m : matches)
+        {
+            bool overlaps = false;
+            for (auto const& k : kept)
+                overlaps = overlaps || (m.x < k.x + k.tmpl->get_width() && k.x < m.x + m.tmpl->get_width() &&
+                                        m.y < k.y + k.tmpl->get_height() && k.y < m.y + m.tmpl->get_height());
+
+            if (!overlaps)
+                kept.push_back(m);
+        }
+
+        std::set<gate_placement> placements;
+        for (auto const& m : kept)
+            placements.insert(gate_placement(m.x, m.y, m.tmpl->get_object_id(), m.orientation));
+        return placements;
+    }
+
+    /**
+     * Check that two placement sets hold the same gates, with positions that differ by
+     * at most \p tolerance pixels. With a scaled background, the search variants start
+     * hill climbing at other positions, and hill climbing does not move along the row
+     * or column of its current position, so it might stop next to a gate.
+     */
+    bool same_gates(std::set<gate_placement> const& a, std::set<gate_placement> const& b, unsigned int tolerance)
+    {
+        if (a.size() != b.size())
+            return false;
+
+        for (auto const& p : a)
+        {
+            bool found = false;
+            for (auto const& q : b)
+                found = found || (std::get<2>(p) == std::get<2>(q) && std::get<3>(p) == std::get<3>(q) &&
+                                  std::abs(static_cast<int>(std::get<0>(p)) - static_cast<int>(std::get<0>(q))) <= static_cast<int>(tolerance) &&
+                                  std::abs(static_cast<int>(std::get<1>(p)) - static_cast<int>(std::get<1>(q))) <= static_cast<int>(tolerance));
+
+            if (!found)
+                return false;
+        }
+
+        return true;
+    }
+
+    const std::vector<gate_placement> test_placements = {
+        gate_placement(30, 40, 100, Gate::ORIENTATION_NORMAL),
+        gate_placement(120, 40, 101, Gate::ORIENTATION_NORMAL),
+        gate_placement(220, 50, 102, Gate::ORIENTATION_NORMAL),
+        gate_placement(300, 150, 100, Gate::ORIENTATION_FLIPPED_LEFT_RIGHT),
+        gate_placement(60, 180, 102, Gate::ORIENTATION_FLIPPED_LEFT_RIGHT),
+        gate_placement(180, 200, 101, Gate::ORIENTATION_FLIPPED_LEFT_RIGHT)
+    };
+}
+
+TEST_CASE("Test batched correlation", "[TemplateMatching]")
+{
+    MatchingFixture fixture(test_placements);
+
+    TestTemplateMatching matching;
+    fixture.init(matching, 1);
+
+    IntegralImage_shptr master = fixture.layer->get_integral_image_manager()->get_integral_image(1).second;
+    REQUIRE(master != nullptr);
+
+    // All templates in both orientations, two templates have the same size.
+    std::vector<PreparedTemplateImage_shptr> images;
+    for (auto const& tmpl : fixture.templates)
+        for (Gate::ORIENTATION orientation : {Gate::ORIENTATION_NORMAL, Gate::ORIENTATION_FLIPPED_LEFT_RIGHT})
+            images.push_back(PreparedTemplateCache::get_instance().get(tmpl, Layer::LOGIC, orientation, 1).normal);
+
+    std::vector<TestTemplateMatching::batch_entry> batch(images.size() + 1);
+
+    // Positions at the placements, next to them, in the background and at the image borders.
+    std::vector<std::pair<unsigned int, unsigned int>> positions;
+    for (auto const& p : test_placements)
+        for (int d : {-2, 0, 1})
+            positions.emplace_back(std::get<0>(p) + d, std::get<1>(p) + d);
+    for (unsigned int y = 0; y < 300; y += 37)
+        for (unsigned int x = 0; x < 1100; x += 53)
+            positions.emplace_back(x, y);
+    positions.emplace_back(1060, 270);
+    positions.emplace_back(1076, 264);
+    positions.emplace_back(1099, 299);
+
+    for (auto const& pos : positions)
+    {
+        for (unsigned int i = 0; i < images.size(); i++)
+            batch[i].tmpl_img = images[i].get();
+
+        // A skipped template.
+        batch[images.size()].tmpl_img = nullptr;
+
+        matching.batched_xcorr(*master, batch, pos.first, pos.second);
+
+        for (unsigned int i = 0; i < images.size(); i++)
+            REQUIRE(batch[i].correlation == Approx(matching.single_xcorr(*master, *images[i], pos.first, pos.second)).margin(1e-9));
+
+        REQUIRE(batch[images.size()].correlation == -1.0);
+    }
+
+    // The placed templates correlate at their position.
+    batch.assign(1, TestTemplateMatching::batch_entry());
+    batch[0].tmpl_img = images[0].get();
+    matching.batched_xcorr(*master, batch, 30, 40);
+    REQUIRE(batch[0].correlation > 0.99);
+}
+
+TEST_CASE("Test batched template matching", "[TemplateMatching]")
+{
+    MatchingFixture fixture(test_placements);
+
+    for (unsigned int scaling_factor : {1, 2})
+    {
+        TestTemplateMatching batched, single;
+        REQUIRE(single.is_batched_evaluation() == false);
+
+        batched.set_batched_evaluation(true);
+        fixture.init(batched, scaling_factor);
+        fixture.init(single, scaling_factor);
+
+        std::set<gate_placement> batched_placements = get_placements(batched.get_matches());
+        std::set<gate_placement> single_placements = get_placements(single.get_matches());
+
+        const std::set<gate_placement> expected(test_placements.begin(), test_placements.end());
+
+        if (scaling_factor == 1)
+        {
+            // Without a scaled background, hill climbing starts close enough to reach the gates.
+            REQUIRE(batched_placements == single_placements);
+            REQUIRE(batched_placements == expected);
+        }
+        else
+        {
+            REQUIRE(same_gates(batched_placements, single_placements, 2));
+            REQUIRE(same_gates(batched_placements, expected, 2));
+            REQUIRE(same_gates(single_placements, expected, 2));
+        }
+    }
+}
+
+TEST_CASE("Test template matching along a grid", "[TemplateMatching]")
+{
+    // Rows are placed along the vertical grid offsets, columns along the horizontal ones.
+    const std::vector<gate_placement> row_placements = {
+        gate_placement(100, 60, 100, Gate::ORIENTATION_NORMAL),
+        gate_placement(400, 60, 102, Gate::ORIENTATION_NORMAL),
+        gate_placement(250, 180, 101, Gate::ORIENTATION_FLIPPED_LEFT_RIGHT),
+        gate_placement(700, 180, 100, Gate::ORIENTATION_FLIPPED_LEFT_RIGHT)
+    };
+
+    const std::vector<gate_placement> col_placements = {
+        gate_placement(90, 20, 100, Gate::ORIENTATION_NORMAL),
+        gate_placement(90, 200, 102, Gate::ORIENTATION_FLIPPED_LEFT_RIGHT),
+        gate_placement(450, 110, 101, Gate::ORIENTATION_NORMAL),
+        gate_placement(810, 40, 100, Gate::ORIENTATION_FLIPPED_LEFT_RIGHT)
+    };
+
+    for (bool in_rows : {true, false})
+    {
+        std::vector<gate_placement> const& placements = in_rows ? row_placements : col_placements;
+        MatchingFixture fixture(placements);
+
+        RegularGrid_shptr grid = in_rows ? fixture.project->get_regular_vertical_grid()
+                                         : fixture.project->get_regular_horizontal_grid();
+        grid->set_range(0, in_rows ? fixture.project->get_height() : fixture.project->get_width());
+        grid->set_distance(in_rows ? 60 : 90);
+        grid->set_enabled(true);
+
+        for (unsigned int scaling_factor : {1, 2})
+        {
+            std::set<gate_placement> sparse_placements, dense_placements;
+
+            if (in_rows)
+            {
+                TestTemplateMatchingAlongGrid<TemplateMatchingInRows> sparse, dense;
+                REQUIRE(sparse.is_sparse_evaluation() == true);
+                dense.set_sparse_evaluation(false);
+
+                fixture.init(sparse, scaling_factor);
+                fixture.init(dense, scaling_factor);
+                sparse_placements = get_placements(sparse.get_matches());
+                dense_placements = get_placements(dense.get_matches());
+            }
+            else
+            {
+                TestTemplateMatchingAlongGrid<TemplateMatchingInCols> sparse, dense;
+                REQUIRE(sparse.is_sparse_evaluation() == true);
+                dense.set_sparse_evaluation(false);
+
+                fixture.init(sparse, scaling_factor);
+                fixture.init(dense, scaling_factor);
+                sparse_placements = get_placements(sparse.get_matches());
+                dense_placements = get_placements(dense.get_matches());
+            }
+
+            const std::set<gate_placement> expected(placements.begin(), placements.end());
+
+            if (scaling_factor == 1)
+            {
+                REQUIRE(sparse_placements == dense_placements);
+                REQUIRE(sparse_placements == expected);
+            }
+            else
+            {
+                REQUIRE(same_gates(sparse_placements, dense_placements, 2));
+                REQUIRE(same_gates(sparse_placements, expected, 2));
+                REQUIRE(same_gates(dense_placements, expected, 2));
+            }
+        }
+    }
+}
+
+TEST_CASE("Test template matching along a grid with a peak beside the grid offset", "[TemplateMatching]")
+{
+    MatchingFixture fixture({});
+
+    // The background brightens from top to bottom up to y = 85. The template is taken from
+    // y = 80, it correlates best there. Hill climbing starts at the grid offset 60 and moves
+    // towards y = 80, more than TEMPLATE_MATCHING_BAND_MARGIN pixels away.
+    auto brightness = [](unsigned int y)
+    {
+        return static_cast<uint8_t>(std::min(y, 85u) * 5 / 2);
+    };
+
+    BackgroundImage_shptr img = fixture.layer->get_image();
+    for (unsigned int y = 0; y < fixture.project->get_height(); y++)
+        for (unsigned int x = 0; x < fixture.project->get_width(); x++)
+            img->set_pixel(x, y, MERGE_CHANNELS(brightness(y), brightness(y), brightness(y), 0xff));
+
+    GateTemplate_shptr tmpl = std::make_shared<GateTemplate>(40, 30);
+    tmpl->set_object_id(100);
+    GateTemplateImage_shptr tmpl_img = std::make_shared<GateTemplateImage>(40, 30);
+    for (unsigned int y = 0; y < 30; y++)
+        for (unsigned int x = 0; x < 40; x++)
+            tmpl_img->set_pixel(x, y, MERGE_CHANNELS(brightness(80 + y), brightness(80 + y), brightness(80 + y), 0xff));
+    tmpl->set_image(Layer::LOGIC, tmpl_img);
+
+    RegularGrid_shptr grid = fixture.project->get_regular_vertical_grid();
+    grid->set_range(0, fixture.project->get_height());
+    grid->set_distance(60);
+    grid->set_enabled(true);
+
+    TestTemplateMatchingAlongGrid<TemplateMatchingInRows> matching;
+    matching.set_templates({tmpl});
+    matching.set_orientations({Gate::ORIENTATION_NORMAL});
+    matching.set_layers(fixture.layer, fixture.layer);
+    matching.set_scaling_factor(1);
+    matching.init(BoundingBox(0, fixture.project->get_width() - 1, 0, fixture.project->get_height() - 1),
+                  fixture.project);
+
+    std::list<TemplateMatching::match_found> matches = matching.get_matches();
+    REQUIRE(matches.size() > 0);
+
+    // Hill climbing reached the peak, as in the full search.
+    for (auto const& m : matches)
+        REQUIRE(m.y == 80);
+}
@@ -0,0 +1,191 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+
+#include <Core/Image/Image.h>
+#include <Core/Image/TilePack.h>
+#include <Core/Utils/FileSystem.h>
+
+#include "catch.hpp"
+
+#include <atomic>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+using namespace degate;
+
+TEST_CASE("Test tile pack persistence", "[TilePack]")
+{
+    std::string filename = get_temp_file_path();
+
+    {
+        TilePack pack(filename, 4, 3, 2, 4);
+        REQUIRE(pack.get_tile_bytes() == 16 * 16 * 4);
+
+        for (unsigned int y = 0; y < 2; y++)
+            for (unsigned int x = 0; x < 3; x++)
+            {
+                uint32_t* tile = static_cast<uint32_t*>(pack.get_tile(x, y));
+                for (unsigned int i = 0; i < 16 * 16; i++)
+                    tile[i] = (y * 3 + x) * 1000 + i;
+                pack.release_tile(x, y);
+            }
+
+        REQUIRE_THROWS(pack.get_tile(3, 0));
+    }
+
+    {
+        TilePack pack(filename, 4, 3, 2, 4);
+
+        for (unsigned int y = 0; y < 2; y++)
+            for (unsigned int x = 0; x < 3; x++)
+            {
+                uint32_t* tile = static_cast<uint32_t*>(pack.get_tile(x, y));
+                REQUIRE(tile[0] == (y * 3 + x) * 1000);
+                REQUIRE(tile[255] == (y * 3 + x) * 1000 + 255);
+            }
+    }
+
+    // A different tile layout is rejected.
+    REQUIRE_THROWS(TilePack(filename, 5, 3, 2, 4));
+    REQUIRE_THROWS(TilePack(filename, 4, 3, 2, 1));
+
+    remove_file(filename);
+}
+
+TEST_CASE("Test tile image uses a tile pack", "[TilePack]")
+{
+    std::string directory = create_temp_directory();
+
+    {
+        BackgroundImage_shptr img(new BackgroundImage(100, 70, directory, true, 5));
+        for (unsigned int y = 0; y < 70; y++)
+            for (unsigned int x = 0; x < 100; x++)
+                img->set_pixel(x, y, y * 100 + x);
+    }
+
+    REQUIRE(TilePack::is_tile_pack_directory(directory) == true);
+    REQUIRE(TilePack::is_tile_file_directory(directory) == false);
+
+    {
+        BackgroundImage_shptr img(new BackgroundImage(100, 70, directory, true, 5));
+        REQUIRE(img->get_pixel(0, 0) == 0);
+        REQUIRE(img->get_pixel(99, 69) == 69 * 100 + 99);
+        REQUIRE(img->get_pixel(40, 33) == 33 * 100 + 40);
+    }
+
+    remove_directory(directory);
+}
+
+TEST_CASE("Test tile file directory conversion", "[TilePack]")
+{
+    std::string directory = create_temp_directory();
+    std::string sub_directory = join_pathes(directory, "scaling_2.dimg");
+    create_directory(sub_directory);
+
+    // Write tiles in the one file per tile layout.
+    for (std::string const& dir : {directory, sub_directory})
+        for (unsigned int y = 0; y < 2; y++)
+            for (unsigned int x = 0; x < 2; x++)
+            {
+                std::vector<uint32_t> data(32 * 32);
+                for (unsigned int i = 0; i < data.size(); i++)
+                    data[i] = (y * 32 + i / 32) * 100 + x * 32 + i % 32;
+
+                std::ofstream out(join_pathes(dir, std::to_string(x) + "_" + std::to_string(y) + ".dat").c_str(),
+                                  std::ios::binary);
+                out.write(reinterpret_cast<const char*>(data.data()), data.size() * sizeof(uint32_t));
+            }
+
+    REQUIRE(TilePack::is_tile_file_directory(directory) == true);
+
+    {
+        // Old directories are still readable.
+        BackgroundImage_shptr img(new BackgroundImage(64, 64, directory, true, 5));
+        REQUIRE(img->get_pixel(40, 50) == 50 * 100 + 40);
+    }
+
+    REQUIRE(TilePack::convert_directory(directory) == 2);
+
+    REQUIRE(TilePack::is_tile_file_directory(directory) == false);
+    REQUIRE(TilePack::is_tile_file_directory(sub_directory) == false);
+    REQUIRE(TilePack::is_tile_pack_directory(sub_directory) == true);
+    REQUIRE(file_exists(join_pathes(directory, "0_0.dat")) == false);
+
+    {
+        BackgroundImage_shptr img(new BackgroundImage(64, 64, directory, true, 5));
+        for (unsigned int y = 0; y < 64; y += 7)
+            for (unsigned int x = 0; x < 64; x += 5)
+                REQUIRE(img->get_pixel(x, y) == y * 100 + x);
+    }
+
+    // Nothing left to convert.
+    REQUIRE(TilePack::convert_directory(directory) == 0);
+
+    remove_directory(directory);
+}
+
+TEST_CASE("Test concurrent tile image reads", "[TilePack]")
+{
+    // Two images of 64 tiles (4 MB each), together larger than the global tile cache
+    // (256 MB by default). Reading one image removes tiles of the other one.
+    const unsigned int tiles = 8, tile_size = 1024;
+
+    std::vector<std::string> directories;
+    std::vector<BackgroundImage_shptr> images;
+
+    for (unsigned int i = 0; i < 2; i++)
+    {
+        directories.push_back(create_temp_directory());
+        images.push_back(std::make_shared<BackgroundImage>(tiles * tile_size, tiles * tile_size, directories[i], false, 10));
+
+        for (unsigned int ty = 0; ty < tiles; ty++)
+            for (unsigned int tx = 0; tx < tiles; tx++)
+                images[i]->set_pixel(tx * tile_size + i, ty * tile_size, i * 1000 + ty * tiles + tx);
+    }
+
+    std::atomic<unsigned int> errors(0);
+
+    auto read = [&](unsigned int i)
+    {
+        for (unsigned int round = 0; round < 20; round++)
+            for (unsigned int ty = 0; ty < tiles; ty++)
+                for (unsigned int tx = 0; tx < tiles; tx++)
+                    if (images[i]->get_pixel(tx * tile_size + i, ty * tile_size) != i * 1000 + ty * tiles + tx)
+                        errors++;
+    };
+
+    // Two readers per image, readers of the same image share its tile cache.
+    std::vector<std::thread> readers;
+    for (unsigned int i = 0; i < 4; i++)
+        readers.emplace_back(read, i % 2);
+
+    for (auto& reader : readers)
+        reader.join();
+
+    REQUIRE(errors == 0);
+
+    images.clear();
+    for (auto const& directory : directories)
+        remove_directory(directory);
+}
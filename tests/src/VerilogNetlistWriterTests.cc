@@ -0,0 +1,169 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <Core/Generator/VerilogModuleGenerator.h>
+#include <Core/Generator/VerilogNetlistWriter.h>
+#include <Core/Project/ProjectImporter.h>
+#include <Core/LogicModel/LogicModel.h>
+
+#include "TestObjectFactory.h"
+#include "catch.hpp"
+
+#include <sstream>
+
+using namespace degate;
+
+static TestObjectFactory factory;
+static std::vector<Gate_shptr> external_gates;
+
+static GateTemplate_shptr create_template(std::string const& name, bool with_implementation)
+{
+    GateTemplate_shptr tmpl = factory.create_template(name, {{"A", GateTemplatePort::PORT_TYPE_IN},
+                                                             {"Y", GateTemplatePort::PORT_TYPE_OUT}});
+
+    if (with_implementation)
+        tmpl->set_implementation(GateTemplate::VERILOG, "module dg_" + name + " (a, y);\nendmodule\n\n");
+
+    return tmpl;
+}
+
+/**
+ * Build a module with \p depth levels of sub-modules. Each module has \p fan_out sub-modules
+ * and a chain of \p gates gates.
+ */
+static void build_hierarchy(Module_shptr module, unsigned depth, unsigned fan_out, unsigned gates,
+                            std::vector<GateTemplate_shptr> const& templates, Net_shptr in, Net_shptr out)
+{
+    Net_shptr previous = in;
+
+    for (unsigned i = 0; i < gates; i++)
+    {
+        Net_shptr next = i + 1 == gates && depth == 0 ? out : factory.create_net();
+        Gate_shptr gate = factory.create_gate(templates[(depth + i) % templates.size()], {{"A", previous}, {"Y", next}});
+        module->add_gate(gate, false);
+        previous = next;
+    }
+
+    if (depth == 0) return;
+
+    for (unsigned i = 0; i < fan_out; i++)
+    {
+        Module_shptr sub(new Module(module->get_name() + "_" + std::to_string(i)));
+        sub->set_object_id(factory.get_new_object_id());
+        module->add_module(sub);
+
+        Net_shptr next = i + 1 == fan_out ? out : factory.create_net();
+        build_hierarchy(sub, depth - 1, fan_out, gates, templates, previous, next);
+        previous = next;
+    }
+}
+
+static Module_shptr create_hierarchy(unsigned depth, unsigned fan_out, unsigned gates)
+{
+    std::vector<GateTemplate_shptr> templates;
+    templates.push_back(create_template("inv", true));
+    templates.push_back(create_template("buf", false));
+    templates.push_back(create_template("dly", true));
+
+    Module_shptr root(new Module("main_module", "", true));
+    root->set_object_id(factory.get_new_object_id());
+
+    Net_shptr in = factory.create_net(), out = factory.create_net();
+    build_hierarchy(root, depth, fan_out, gates, templates, in, out);
+
+    // drive the input and sink the output from outside the hierarchy
+    external_gates.push_back(factory.create_gate(templates[0], {{"A", factory.create_net()}, {"Y", in}}));
+    external_gates.push_back(factory.create_gate(templates[0], {{"A", out}, {"Y", factory.create_net()}}));
+
+    root->determine_module_ports_recursive();
+    return root;
+}
+
+static std::string write_netlist(Module_shptr root, unsigned int threads)
+{
+    std::ostringstream stream;
+    VerilogNetlistWriter writer(root, false, threads);
+    writer.write(stream);
+    return stream.str();
+}
+
+static unsigned count_occurrences(std::string const& str, std::string const& pattern)
+{
+    unsigned n = 0;
+    for (size_t pos = str.find(pattern); pos != std::string::npos; pos = str.find(pattern, pos + 1))
+        n++;
+    return n;
+}
+
+TEST_CASE("Test Verilog netlist writer on the test project", "[VerilogNetlistWriter]")
+{
+    ProjectImporter importer;
+    Project_shptr prj(importer.import_all("tests_files/test_project/project.xml"));
+    REQUIRE(prj != nullptr);
+
+    Module_shptr main_module = prj->get_logic_model()->get_main_module();
+    REQUIRE(main_module != nullptr);
+
+    VerilogModuleGenerator generator(main_module);
+    const std::string expected = generator.generate();
+
+    REQUIRE(write_netlist(main_module, 1) == expected);
+    REQUIRE(write_netlist(main_module, 4) == expected);
+}
+
+TEST_CASE("Test Verilog netlist writer against the module generator", "[VerilogNetlistWriter]")
+{
+    // with a single level of sub-modules, the module generator writes each module once
+    Module_shptr root = create_hierarchy(1, 40, 5);
+
+    VerilogModuleGenerator generator(root);
+    const std::string expected = generator.generate();
+
+    REQUIRE(count_occurrences(expected, "module dg_main_module_") == 40);
+    REQUIRE(count_occurrences(expected, "endmodule") == 40 + 1 + 2);
+
+    REQUIRE(write_netlist(root, 1) == expected);
+    REQUIRE(write_netlist(root, 3) == expected);
+}
+
+TEST_CASE("Test Verilog netlist writer on nested modules", "[VerilogNetlistWriter]")
+{
+    Module_shptr root = create_hierarchy(3, 4, 3);
+
+    const std::string netlist = write_netlist(root, 1);
+
+    // each module is defined exactly once, after the modules it instantiates
+    REQUIRE(count_occurrences(netlist, "module dg_main_module_0_1_2 (") == 1);
+    REQUIRE(count_occurrences(netlist, "module dg_main_module_0_1 (") == 1);
+    REQUIRE(count_occurrences(netlist, "module dg_main_module (") == 1);
+    REQUIRE(netlist.find("module dg_main_module_0_1_2 (") < netlist.find("module dg_main_module_0_1 ("));
+    REQUIRE(netlist.find("module dg_main_module_0_1 (") < netlist.find("module dg_main_module_0 ("));
+    REQUIRE(count_occurrences(netlist, "endmodule") == 4 * 4 * 4 + 4 * 4 + 4 + 1 + 2);
+
+    // the module generator defines nested modules several times, but starts the same way
+    VerilogModuleGenerator generator(root);
+    const size_t first_duplicate = netlist.find("endmodule", netlist.find("module dg_main_module_0_0_3 ("));
+    REQUIRE(generator.generate().compare(0, first_duplicate, netlist, 0, first_duplicate) == 0);
+
+    // the output does not depend on the number of threads
+    REQUIRE(write_netlist(root, 2) == netlist);
+    REQUIRE(write_netlist(root, 5) == netlist);
+}
@@ -0,0 +1,178 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include <GUI/Workspace/WorkspaceVertexBuilder.h>
+
+#include "catch.hpp"
+
+#include <atomic>
+
+using namespace degate;
+
+TEST_CASE("Build rectangle vertices", "[WorkspaceVertexBuilder]")
+{
+    const color_t color = MERGE_CHANNELS(255u, 0u, 51u, 255u);
+
+    WorkspaceVertex2D vertices[RECTANGLE_VERTICES_COUNT];
+    build_rectangle(vertices, 10, 20, 30, 40, color);
+
+    // Two triangles: (min, min), (max, min), (min, max) and (min, max), (max, min), (max, max).
+    REQUIRE(vertices[0].pos == QVector2D(10, 20));
+    REQUIRE(vertices[1].pos == QVector2D(30, 20));
+    REQUIRE(vertices[2].pos == QVector2D(10, 40));
+    REQUIRE(vertices[3].pos == QVector2D(10, 40));
+    REQUIRE(vertices[4].pos == QVector2D(30, 20));
+    REQUIRE(vertices[5].pos == QVector2D(30, 40));
+
+    for(auto& vertex : vertices)
+    {
+        REQUIRE(vertex.color.x() == Approx(1.0));
+        REQUIRE(vertex.color.y() == Approx(0.0));
+        REQUIRE(vertex.color.z() == Approx(0.2));
+        REQUIRE(vertex.alpha == Approx(1.0));
+    }
+
+    WorkspaceVertex2D line_vertices[RECTANGLE_OUTLINE_VERTICES_COUNT];
+    build_rectangle_outline(line_vertices, 10, 20, 30, 40, color);
+
+    // Top, left, right and bottom lines.
+    REQUIRE(line_vertices[0].pos == QVector2D(10, 20));
+    REQUIRE(line_vertices[1].pos == QVector2D(30, 20));
+    REQUIRE(line_vertices[2].pos == QVector2D(10, 20));
+    REQUIRE(line_vertices[3].pos == QVector2D(10, 40));
+    REQUIRE(line_vertices[4].pos == QVector2D(30, 20));
+    REQUIRE(line_vertices[5].pos == QVector2D(30, 40));
+    REQUIRE(line_vertices[6].pos == QVector2D(10, 40));
+    REQUIRE(line_vertices[7].pos == QVector2D(30, 40));
+}
+
+TEST_CASE("Build wire, via and port vertices", "[WorkspaceVertexBuilder]")
+{
+    // Horizontal wire from (0, 0) to (10, 0) with a diameter of 4: the rectangle is extended by the radius on both ends.
+    WorkspaceVertex2D wire_vertices[WIRE_VERTICES_COUNT];
+    build_wire(wire_vertices, 0, 0, 10, 0, 4, 0);
+
+    for(auto& vertex : wire_vertices)
+    {
+        REQUIRE((vertex.pos.x() == Approx(-2) || vertex.pos.x() == Approx(12)));
+        REQUIRE((vertex.pos.y() == Approx(-2) || vertex.pos.y() == Approx(2)));
+    }
+
+    // All vertices of a via are inside its bounding box and none of them is in the hole.
+    WorkspaceVertex2D via_vertices[VIA_VERTICES_COUNT];
+    build_via(via_vertices, 100, 100, 8, 0);
+
+    for(auto& vertex : via_vertices)
+    {
+        REQUIRE(vertex.pos.x() >= 96);
+        REQUIRE(vertex.pos.x() <= 104);
+        REQUIRE(vertex.pos.y() >= 96);
+        REQUIRE(vertex.pos.y() <= 104);
+        REQUIRE(!(vertex.pos.x() > 98 && vertex.pos.x() < 102 && vertex.pos.y() > 98 && vertex.pos.y() < 102));
+    }
+
+    WorkspaceVertex2D port_vertices[PORT_VERTICES_COUNT];
+    build_port(port_vertices, GateTemplatePort::PORT_TYPE_IN, 50, 50, 6, 0);
+
+    // The center of an input port is the common vertex of its 3 triangles.
+    REQUIRE(port_vertices[2].pos == QVector2D(50, 50));
+    REQUIRE(port_vertices[5].pos == QVector2D(50, 50));
+    REQUIRE(port_vertices[8].pos == QVector2D(50, 50));
+}
+
+TEST_CASE("Build vertices by range", "[WorkspaceVertexBuilder]")
+{
+    SECTION("No object")
+    {
+        bool called = false;
+        build_vertices(0, [&](size_t, size_t) { called = true; });
+
+        REQUIRE(called == false);
+    }
+
+    SECTION("Every object is built exactly once")
+    {
+        const size_t object_count = VERTEX_BUILDER_MIN_OBJECTS_PER_TASK * 5 + 17;
+
+        WorkspaceVertices vertices(object_count * RECTANGLE_VERTICES_COUNT);
+        std::vector<unsigned char> built(object_count, 0);
+        std::atomic<bool> invalid_range(false);
+
+        // Ranges can be built on worker threads, so no REQUIRE here.
+        build_vertices(object_count, [&](size_t begin, size_t end)
+        {
+            if(begin >= end || end > object_count)
+                invalid_range = true;
+
+            for(size_t i = begin; i < end; i++)
+            {
+                build_rectangle(&vertices[i * RECTANGLE_VERTICES_COUNT], i, i, i + 1, i + 1, 0);
+                built[i]++;
+            }
+        });
+
+        REQUIRE(invalid_range == false);
+
+        for(size_t i = 0; i < object_count; i++)
+        {
+            REQUIRE(built[i] == 1);
+            REQUIRE(vertices[i * RECTANGLE_VERTICES_COUNT].pos == QVector2D(i, i));
+            REQUIRE(vertices[i * RECTANGLE_VERTICES_COUNT + 5].pos == QVector2D(i + 1, i + 1));
+        }
+    }
+}
+
+TEST_CASE("Vertex buffer modified range", "[WorkspaceVertexBuilder]")
+{
+    WorkspaceVertexBuffer buffer(RECTANGLE_VERTICES_COUNT);
+
+    // Not built yet.
+    REQUIRE(buffer.update_object_vertices(0) == nullptr);
+    REQUIRE(buffer.is_modified() == false);
+
+    buffer.resize(10);
+
+    REQUIRE(buffer.get_object_count() == 10);
+    REQUIRE(buffer.get_vertices_count() == 10 * RECTANGLE_VERTICES_COUNT);
+    REQUIRE(buffer.is_modified() == false);
+
+    // Reading vertices doesn't modify the buffer.
+    buffer.get_object_vertices(4);
+    REQUIRE(buffer.is_modified() == false);
+
+    // The modified range covers all updated objects.
+    REQUIRE(buffer.update_object_vertices(5) == buffer.get_object_vertices(5));
+    REQUIRE(buffer.get_modified_begin() == 5 * RECTANGLE_VERTICES_COUNT);
+    REQUIRE(buffer.get_modified_end() == 6 * RECTANGLE_VERTICES_COUNT);
+
+    buffer.update_object_vertices(2);
+    buffer.update_object_vertices(7);
+    REQUIRE(buffer.get_modified_begin() == 2 * RECTANGLE_VERTICES_COUNT);
+    REQUIRE(buffer.get_modified_end() == 8 * RECTANGLE_VERTICES_COUNT);
+
+    // Out of range updates are ignored.
+    REQUIRE(buffer.update_object_vertices(10) == nullptr);
+    REQUIRE(buffer.get_modified_end() == 8 * RECTANGLE_VERTICES_COUNT);
+
+    // Resizing means a full upload.
+    buffer.resize(3);
+    REQUIRE(buffer.is_modified() == false);
+}
@@ -0,0 +1,197 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+ * A minimal external matching worker for the tests. It speaks the protocol from
+ * ExternalMatchingProtocol.h and reports one via per tile at the brightest pixel
+ * (the first one in row order). The via points up if the pixel is brighter than
+ * 200 and down otherwise. Tiles without any non-black pixel produce a wire along
+ * the top edge of the tile instead.
+ */
+
+#include <Core/Matching/ExternalMatchingProtocol.h>
+#include <Prerequisites.h>
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#ifdef SYS_WINDOWS
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+using namespace degate::external_matching;
+namespace bip = boost::interprocess;
+
+static bool read_all(void* buf, size_t size)
+{
+	return size == 0 || fread(buf, 1, size, stdin) == size;
+}
+
+static void send(message_type type, uint32_t request_id, std::vector<char> const& payload)
+{
+	message_header header = {EXTERNAL_MATCHING_PROTOCOL_MAGIC, type, request_id,
+	                         static_cast<uint32_t>(payload.size())};
+	fwrite(&header, sizeof(header), 1, stdout);
+	if (!payload.empty()) fwrite(payload.data(), 1, payload.size(), stdout);
+	fflush(stdout);
+}
+
+static void send_error(uint32_t request_id, std::string const& text)
+{
+	send(MSG_ERROR, request_id, std::vector<char>(text.begin(), text.end()));
+}
+
+static result_object match_tile(char const* pixels, tile_descriptor const& tile, uint32_t index)
+{
+	unsigned int best = 0, best_x = 0, best_y = 0;
+
+	for (unsigned int y = 0; y < tile.height; y++)
+	{
+		unsigned char const* row = reinterpret_cast<unsigned char const*>(pixels + y * tile.stride);
+		for (unsigned int x = 0; x < tile.width; x++)
+		{
+			// channel order red, green, blue, alpha
+			unsigned int grey = (75 * row[4 * x] + 147 * row[4 * x + 1] + 35 * row[4 * x + 2]) >> 8;
+			if (grey > best)
+			{
+				best = grey;
+				best_x = x;
+				best_y = y;
+			}
+		}
+	}
+
+	result_object obj;
+	memset(&obj, 0, sizeof(obj));
+	obj.tile = index;
+
+	if (best == 0)
+	{
+		obj.type = RESULT_WIRE;
+		obj.x1 = tile.x;
+		obj.y1 = tile.y;
+		obj.x2 = tile.x + static_cast<int32_t>(tile.width) - 1;
+		obj.y2 = tile.y;
+		obj.diameter = 3;
+	}
+	else
+	{
+		obj.type = RESULT_VIA;
+		obj.x1 = obj.x2 = tile.x + static_cast<int32_t>(best_x);
+		obj.y1 = obj.y2 = tile.y + static_cast<int32_t>(best_y);
+		obj.diameter = 5;
+		obj.direction = best > 200 ? VIA_UP : VIA_DOWN;
+	}
+
+	return obj;
+}
+
+int main()
+{
+#ifdef SYS_WINDOWS
+	_setmode(_fileno(stdin), _O_BINARY);
+	_setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+	std::string shm_name;
+	std::unique_ptr<bip::mapped_region> region;
+
+	message_header header;
+	while (read_all(&header, sizeof(header)))
+	{
+		if (header.magic != EXTERNAL_MATCHING_PROTOCOL_MAGIC) return 1;
+
+		std::vector<char> payload(header.payload_size);
+		if (!read_all(payload.data(), payload.size())) return 1;
+
+		if (header.type == MSG_HELLO)
+		{
+			hello_payload hello = {EXTERNAL_MATCHING_PROTOCOL_VERSION, 0};
+			send(MSG_HELLO, header.request_id, std::vector<char>(reinterpret_cast<char*>(&hello),
+			                                                     reinterpret_cast<char*>(&hello) + sizeof(hello)));
+		}
+		else if (header.type == MSG_MATCH)
+		{
+			if (payload.size() < sizeof(match_request))
+			{
+				send_error(header.request_id, "truncated request");
+				continue;
+			}
+
+			match_request request;
+			memcpy(&request, payload.data(), sizeof(request));
+			request.shm_name[EXTERNAL_MATCHING_SHM_NAME_SIZE - 1] = 0;
+
+			if (payload.size() < sizeof(match_request) + request.tile_count * sizeof(tile_descriptor))
+			{
+				send_error(header.request_id, "truncated tile list");
+				continue;
+			}
+
+			// keep the mapping as long as the segment does not change
+			if (region == nullptr || shm_name != request.shm_name)
+			{
+				try
+				{
+					bip::shared_memory_object shm(bip::open_only, request.shm_name, bip::read_only);
+					region.reset(new bip::mapped_region(shm, bip::read_only));
+					shm_name = request.shm_name;
+				}
+				catch (bip::interprocess_exception const& ex)
+				{
+					region.reset();
+					send_error(header.request_id, ex.what());
+					continue;
+				}
+			}
+
+			std::vector<char> results(sizeof(results_header) + request.tile_count * sizeof(result_object));
+			results_header* rh = reinterpret_cast<results_header*>(results.data());
+			rh->object_count = request.tile_count;
+			rh->reserved = 0;
+
+			tile_descriptor const* tiles = reinterpret_cast<tile_descriptor const*>(payload.data() +
+				sizeof(match_request));
+			result_object* objects = reinterpret_cast<result_object*>(results.data() + sizeof(results_header));
+
+			for (uint32_t i = 0; i < request.tile_count; i++)
+			{
+				char const* pixels = static_cast<char const*>(region->get_address()) + tiles[i].offset;
+				objects[i] = match_tile(pixels, tiles[i], i);
+			}
+
+			send(MSG_RESULTS, header.request_id, results);
+		}
+		else if (header.type == MSG_SHUTDOWN)
+			return 0;
+		else
+			send_error(header.request_id, "unknown message type");
+	}
+
+	return 0;
+}
@@ -0,0 +1,75 @@
+/* -*-c++-*-
+
+  This file is part of the IC reverse engineering tool degate.
+
+  Copyright 2008, 2009, 2010 by Martin Schobert
+
+  Degate is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  any later version.
+
+  Degate is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with degate. If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+
+/**
+ * Convert the image directories of a project (or of a single image) from the one
+ * file per tile layout of older degate versions into tile pack files, or into
+ * compressed tile pack files.
+ */
+
+#include "Core/Image/TilePack.h"
+#include "Core/Image/CompressedTilePack.h"
+#include "Core/Utils/FileSystem.h"
+
+#include <cstring>
+#include <iostream>
+
+using namespace degate;
+
+int main(int argc, char** argv)
+{
+	bool compress = argc == 3 && strcmp(argv[1], "--compress") == 0;
+
+	if ((argc != 2 && !compress) || strcmp(argv[1], "--help") == 0 || strcmp(argv[1], "-h") == 0)
+	{
+		std::cerr << "Usage: " << argv[0] << " [--compress] <project or image directory>" << std::endl
+			<< std::endl
+			<< "Converts all image directories with one file per tile (N_M.dat) into" << std::endl
+			<< "a single '" << TILE_PACK_FILENAME << "' file. The tile files are removed." << std::endl
+			<< std::endl
+			<< "With --compress, tile files and '" << TILE_PACK_FILENAME << "' files are converted" << std::endl
+			<< "into a compressed '" << COMPRESSED_TILE_PACK_FILENAME << "' file." << std::endl;
+		return argc == 2 ? 0 : 1;
+	}
+
+	std::string directory(argv[argc - 1]);
+	if (!is_directory(directory))
+	{
+		std::cerr << "Error: " << directory << " is not a directory." << std::endl;
+		return 1;
+	}
+
+	try
+	{
+		unsigned int converted = compress ?
+			                         CompressedTilePack::convert_directory(directory) :
+			                         TilePack::convert_directory(directory);
+		std::cerr << "Converted " << converted << " image directories." << std::endl;
+	}
+	catch (std::exception const& ex)
+	{
+		std::cerr << "Error: " << ex.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}